@@ -5,6 +5,7 @@
 
 #include "galay-ssl/async/ssl_socket.h"
 #include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_trust_store.h"
 #include "ssl_stats.h"
 #include <galay-kernel/kernel/task.h>
 #include <iostream>
@@ -212,7 +213,8 @@ Task<void> sslClient(SslContext* ctx,
 void runClientThread(const std::string& host, uint16_t port,
                      int connections, int requestsPerConn,
                      size_t payloadBytes, bool statsEnabled,
-                     int connectRetries) {
+                     int connectRetries,
+                     std::shared_ptr<SslTrustStore> trust) {
     ThreadMetrics metrics;
 
     // 创建 SSL 上下文
@@ -226,14 +228,14 @@ void runClientThread(const std::string& host, uint16_t port,
 
     configureBenchmarkTlsContext(ctx);
 
-    // 加载CA证书，即使不验证（用于建立信任链）
-    auto caResult = ctx.loadCACertificate("certs/ca.crt");
-    if (!caResult) {
+    // 挂接进程内共享的 CA 信任库，即使不验证（用于建立信任链）
+    if (!trust) {
         metrics.errors += static_cast<uint64_t>(connections);
         metrics.connections_done += static_cast<uint64_t>(connections);
         mergeThreadMetrics(metrics);
         return;
     }
+    ctx.setTrustStore(std::move(trust));
 
     // 不验证服务器证书（测试用）
     ctx.setVerifyMode(SslVerifyMode::None);
@@ -296,6 +298,12 @@ int main(int argc, char* argv[]) {
     const bool statsEnabled = statsEnv != nullptr && statsEnv[0] != '\0' && std::string(statsEnv) != "0";
     bench::sslStatsSetEnabled(statsEnabled);
 
+    // CA 只解析一次，所有线程的上下文共享同一个信任库；加载失败时各线程按错误计数
+    std::shared_ptr<SslTrustStore> trust;
+    if (auto loaded = SslTrustStore::fromFile("certs/ca.crt"); loaded) {
+        trust = std::move(*loaded);
+    }
+
     auto startTime = std::chrono::high_resolution_clock::now();
 
     int baseConns = connections / threads;
@@ -309,7 +317,7 @@ int main(int argc, char* argv[]) {
             continue;
         }
         workers.emplace_back(runClientThread, host, port, conns, requestsPerConn,
-                             payloadBytes, statsEnabled, connectRetries);
+                             payloadBytes, statsEnabled, connectRetries, trust);
     }
 
     for (auto& t : workers) {
@@ -3,8 +3,16 @@
  * @brief SSL 服务端性能测试
  */
 
+#include "galay-ssl/async/ssl_handshake_admission.h"
 #include "galay-ssl/async/ssl_socket.h"
+#include "galay-ssl/ssl/ssl_accept_filter.h"
+#include "galay-ssl/ssl/ssl_cert_router.h"
 #include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_context_reloader.h"
+#include "galay-ssl/ssl/ssl_keyless.h"
+#include "galay-ssl/ssl/ssl_ocsp_stapler.h"
+#include "galay-ssl/ssl/ssl_shm_session_cache.h"
+#include "galay-ssl/ssl/ssl_trust_store.h"
 #include <galay-kernel/kernel/task.h>
 #include <iostream>
 #include <atomic>
@@ -13,9 +21,12 @@
 #include <cstring>
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <memory>
+#include <optional>
 #include <thread>
 #include <vector>
+#include <unistd.h>
 
 #ifdef USE_KQUEUE
 #include <galay-kernel/kernel/kqueue_scheduler.h>
@@ -47,7 +58,8 @@ void configureBenchmarkTlsContext(SslContext& ctx) {
 }
 
 std::unique_ptr<SslContext> createBenchmarkServerContext(const std::string& certFile,
-                                                         const std::string& keyFile) {
+                                                         const std::string& keyFile,
+                                                         const std::shared_ptr<SslKeylessClient>& keyless) {
     auto ctx = std::make_unique<SslContext>(SslMethod::TLS_1_3_Server);
     if (!ctx->isValid()) {
         return nullptr;
@@ -60,6 +72,11 @@ std::unique_ptr<SslContext> createBenchmarkServerContext(const std::string& cert
         return nullptr;
     }
 
+    // keyless：私钥只在签名进程中，上下文以证书公钥挂接客户端
+    if (keyless) {
+        return ctx->setPrivateKeyOffload(keyless) ? std::move(ctx) : nullptr;
+    }
+
     auto keyResult = ctx->loadPrivateKey(keyFile);
     if (!keyResult) {
         return nullptr;
@@ -78,11 +95,22 @@ void signalHandler(int) {
     g_running = false;
 }
 
-Task<void> handleClient(SslContext* ctx, GHandle handle) {
-    SslSocket client(ctx, handle);
+Task<void> handleClient(std::shared_ptr<SslContext> ctx, GHandle handle, SslHandshakeAdmission* admission) {
+    SslSocket client(std::move(ctx), handle);
     client.option().handleNonBlock();
 
+    SslHandshakePermit permit;
+    if (admission) {
+        auto acquired = co_await admission->acquire();
+        if (!acquired) {
+            co_await client.close();
+            co_return;
+        }
+        permit = std::move(*acquired);
+    }
+
     auto handshakeResult = co_await client.handshake();
+    permit.release();
     if (!handshakeResult) {
         co_await client.close();
         co_return;
@@ -118,6 +146,9 @@ Task<void> handleClient(SslContext* ctx, GHandle handle) {
 
 Task<void> sslServer(IOScheduler* scheduler,
                      SslContext* ctx,
+                     SslContextReloader* reloader,
+                     SslHandshakeAdmission* admission,
+                     SslAcceptFilter* acceptFilter,
                      uint16_t port,
                      int backlog,
                      int workerIndex,
@@ -145,6 +176,9 @@ Task<void> sslServer(IOScheduler* scheduler,
         logErrno("listen failed");
         co_return;
     }
+    if (acceptFilter) {
+        SslAcceptFilter::enableDeferAccept(listener.handle().fd);
+    }
 
     std::cout << "SSL Server worker " << (workerIndex + 1) << "/" << workerCount
               << " listening on port " << port << std::endl;
@@ -156,7 +190,14 @@ Task<void> sslServer(IOScheduler* scheduler,
             logErrno("accept failed");
             continue;
         }
-        if (!scheduleTask(scheduler, handleClient(ctx, acceptResult.value()))) {
+        if (acceptFilter && !acceptFilter->screen(acceptResult->fd)) {
+            ::close(acceptResult->fd);
+            continue;
+        }
+        // 热重载时每个连接持有接受时的上下文；否则以不拥有的别名引用传递
+        auto connectionCtx = reloader ? reloader->current()
+                                      : std::shared_ptr<SslContext>(std::shared_ptr<SslContext>(), ctx);
+        if (!scheduleTask(scheduler, handleClient(std::move(connectionCtx), acceptResult.value(), admission))) {
             std::cerr << "spawn failed for client handler" << std::endl;
         }
     }
@@ -185,7 +226,196 @@ int main(int argc, char* argv[]) {
     signal(SIGTERM, signalHandler);
     signal(SIGPIPE, SIG_IGN);
 
+    // GALAY_SSL_SESSION_CACHE=<capacity>：所有 worker 共享一个分片 session 缓存
+    std::shared_ptr<SslSessionStore> sessionCache;
+    if (const char* cacheEnv = std::getenv("GALAY_SSL_SESSION_CACHE"); cacheEnv && cacheEnv[0] != '\0') {
+        const size_t capacity = static_cast<size_t>(std::max(1L, std::atol(cacheEnv)));
+        sessionCache = std::make_shared<SslSessionCache>(SslSessionCacheOptions{.capacity = capacity});
+    }
+    // GALAY_SSL_SHM_SESSION_CACHE=<path>：多个 SO_REUSEPORT 进程共享同一映射文件，优先于进程内缓存
+    if (const char* shmEnv = std::getenv("GALAY_SSL_SHM_SESSION_CACHE"); shmEnv && shmEnv[0] != '\0') {
+        auto shmCache = SslShmSessionCache::open(shmEnv);
+        if (!shmCache) {
+            std::cerr << "Failed to open shared session cache " << shmEnv << ": "
+                      << shmCache.error().message() << std::endl;
+            return 1;
+        }
+        sessionCache = std::move(*shmCache);
+    }
+    // GALAY_SSL_TICKET_KEY=<path>：从 80 字节密钥文件启用无状态 ticket，同一文件的进程之间互相恢复
+    std::shared_ptr<SslTicketKeyRing> ticketKeys;
+    if (const char* ticketEnv = std::getenv("GALAY_SSL_TICKET_KEY"); ticketEnv && ticketEnv[0] != '\0') {
+        auto ring = SslTicketKeyRing::fromFile(ticketEnv);
+        if (!ring) {
+            std::cerr << "Failed to load ticket key " << ticketEnv << ": "
+                      << ring.error().message() << std::endl;
+            return 1;
+        }
+        ticketKeys = std::move(*ring);
+    }
+
+    // GALAY_SSL_OCSP_DIR=<dir>：从目录读取 <序列号>.der 形式的 OCSP 响应，后台刷新并在握手时附加
+    std::shared_ptr<SslOcspStapler> ocspStapler;
+    if (const char* ocspEnv = std::getenv("GALAY_SSL_OCSP_DIR"); ocspEnv && ocspEnv[0] != '\0') {
+        auto stapler = SslOcspStapler::create({.directory = ocspEnv});
+        if (!stapler) {
+            std::cerr << "Failed to create OCSP stapler for " << ocspEnv << ": "
+                      << stapler.error().message() << std::endl;
+            return 1;
+        }
+        ocspStapler = std::move(*stapler);
+    }
+
+    // GALAY_SSL_CHAIN_CA=<file>：以该 CA 文件为信任锚，为每个上下文预构建证书链，握手不再逐次拼链
+    std::shared_ptr<SslTrustStore> chainAnchors;
+    if (const char* chainEnv = std::getenv("GALAY_SSL_CHAIN_CA"); chainEnv && chainEnv[0] != '\0') {
+        auto anchors = SslTrustStore::fromFile(chainEnv);
+        if (!anchors) {
+            std::cerr << "Failed to load chain anchors " << chainEnv << ": "
+                      << anchors.error().message() << std::endl;
+            return 1;
+        }
+        chainAnchors = std::move(*anchors);
+    }
+
+    // GALAY_SSL_CERT_COMPRESSION=<zlib,brotli,zstd|none>：按偏好预压缩证书链（none 关闭压缩），
+    // 同时开启握手字节统计，退出时输出握手消息与证书消息的字节数
+    std::optional<std::vector<SslCertCompression>> certCompression;
+    if (const char* compressEnv = std::getenv("GALAY_SSL_CERT_COMPRESSION"); compressEnv && compressEnv[0] != '\0') {
+        std::vector<SslCertCompression> algorithms;
+        const std::string value = compressEnv;
+        for (size_t begin = 0; begin <= value.size();) {
+            const size_t end = std::min(value.find(',', begin), value.size());
+            const std::string name = value.substr(begin, end - begin);
+            if (name == "zlib") {
+                algorithms.push_back(SslCertCompression::Zlib);
+            } else if (name == "brotli") {
+                algorithms.push_back(SslCertCompression::Brotli);
+            } else if (name == "zstd") {
+                algorithms.push_back(SslCertCompression::Zstd);
+            } else if (name != "none") {
+                std::cerr << "Unknown certificate compression " << name << std::endl;
+                return 1;
+            }
+            begin = end + 1;
+        }
+        certCompression = std::move(algorithms);
+    }
+
+    // 路由与热重载新建的上下文与 worker 上下文使用相同的 session、证书链、证书压缩与 OCSP 配置
+    auto configureShared = [sessionCache, ticketKeys, chainAnchors, certCompression, ocspStapler](
+                               SslContext& ctx) -> std::expected<void, SslError> {
+        configureBenchmarkTlsContext(ctx);
+        if (certCompression) {
+            ctx.setHandshakeByteStats(true);
+        }
+        if (sessionCache) {
+            ctx.setSessionTimeout(300);
+            ctx.setSessionCache(sessionCache);
+        }
+        if (ticketKeys) {
+            ctx.setSessionTimeout(300);
+            ctx.setSessionTicketKeys(ticketKeys);
+        }
+        // 路由的前端上下文没有证书，不构建证书链也不登记 OCSP
+        if (SSL_CTX_get0_certificate(ctx.native()) == nullptr) {
+            return {};
+        }
+        if (chainAnchors) {
+            if (auto built = ctx.buildCertificateChain(chainAnchors); !built) {
+                return built;
+            }
+        }
+        if (certCompression) {
+            if (auto compressed = ctx.setCertificateCompression(*certCompression); !compressed) {
+                return compressed;
+            }
+        }
+        if (ocspStapler) {
+            return ctx.setOcspStapler(ocspStapler);
+        }
+        return {};
+    };
+
+    // GALAY_SSL_CERT_DIR=<dir>：所有 worker 的监听共用一个按 SNI 选证书的路由，证书按需从目录加载
+    std::shared_ptr<SslCertRouter> certRouter;
+    if (const char* dirEnv = std::getenv("GALAY_SSL_CERT_DIR"); dirEnv && dirEnv[0] != '\0') {
+        auto router = SslCertRouter::create({
+            .method = SslMethod::TLS_1_3_Server,
+            .directory = dirEnv,
+            .configure = configureShared,
+        });
+        if (!router) {
+            std::cerr << "Failed to create certificate router for " << dirEnv << ": "
+                      << router.error().message() << std::endl;
+            return 1;
+        }
+        certRouter = std::move(*router);
+    }
+
+    // GALAY_SSL_RELOAD_INTERVAL=<seconds>：所有 worker 共用一个可热重载的上下文，按间隔检查证书 / 私钥文件，
+    // 变化后新连接使用新证书，已有连接不受影响
+    std::shared_ptr<SslContextReloader> reloader;
+    int reloadInterval = 0;
+    const char* reloadEnv = std::getenv("GALAY_SSL_RELOAD_INTERVAL");
+    if (!certRouter && reloadEnv && reloadEnv[0] != '\0') {
+        reloadInterval = std::max(1, std::atoi(reloadEnv));
+        auto created = SslContextReloader::create({
+            .method = SslMethod::TLS_1_3_Server,
+            .certFile = certFile,
+            .keyFile = keyFile,
+            .configure = configureShared,
+        });
+        if (!created) {
+            std::cerr << "Failed to create reloadable context: " << created.error().message() << std::endl;
+            return 1;
+        }
+        reloader = std::move(*created);
+    }
+
+    // GALAY_SSL_KEYLESS=<socket path>：私钥运算交给 keyless_signer 进程，key_file 参数被忽略
+    std::shared_ptr<SslKeylessClient> keyless;
+    if (const char* keylessEnv = std::getenv("GALAY_SSL_KEYLESS"); keylessEnv && keylessEnv[0] != '\0') {
+        keyless = std::make_shared<SslKeylessClient>(keylessEnv);
+    }
+
+    // GALAY_SSL_HANDSHAKE_LIMIT=<n>[:adaptive]：每个 worker 同时进行的握手不超过 n，超出的排队或丢弃
+    std::optional<SslHandshakeAdmissionOptions> admissionOptions;
+    if (const char* limitEnv = std::getenv("GALAY_SSL_HANDSHAKE_LIMIT"); limitEnv && limitEnv[0] != '\0') {
+        SslHandshakeAdmissionOptions options;
+        options.maxInflight = static_cast<size_t>(std::max(1L, std::atol(limitEnv)));
+        options.adaptive = std::strstr(limitEnv, ":adaptive") != nullptr;
+        admissionOptions = options;
+    }
+
+    // GALAY_SSL_ACCEPT_RATE=<per-source>[:<global>]：握手前按源地址与全局速率筛查，被拒绝的连接直接关闭
+    std::shared_ptr<SslAcceptFilter> acceptFilter;
+    if (const char* rateEnv = std::getenv("GALAY_SSL_ACCEPT_RATE"); rateEnv && rateEnv[0] != '\0') {
+        SslAcceptFilterOptions options;
+        options.perSourceRate = std::atof(rateEnv);
+        options.perSourceBurst = static_cast<uint32_t>(std::max(1.0, options.perSourceRate * 2));
+        if (const char* global = std::strchr(rateEnv, ':')) {
+            options.globalRate = std::atof(global + 1);
+        }
+        acceptFilter = std::make_shared<SslAcceptFilter>(options);
+    }
+
+    // GALAY_SSL_SECOND_CERT=<cert>:<key>：每个 worker 上下文再加载一对另一密钥类型的证书（ECDSA + RSA 双证书）
+    std::string secondCertFile;
+    std::string secondKeyFile;
+    if (const char* secondEnv = std::getenv("GALAY_SSL_SECOND_CERT"); secondEnv && secondEnv[0] != '\0') {
+        const std::string value = secondEnv;
+        const size_t colon = value.find(':');
+        if (colon == std::string::npos) {
+            return 1;
+        }
+        secondCertFile = value.substr(0, colon);
+        secondKeyFile = value.substr(colon + 1);
+    }
+
+    // admission 在 scheduler 之后析构：调度器销毁协程时归还的许可仍有去处
     struct BenchWorker {
+        std::unique_ptr<SslHandshakeAdmission> admission;
         std::unique_ptr<SslContext> ctx;
         std::unique_ptr<TestScheduler> scheduler;
     };
@@ -194,14 +424,50 @@ int main(int argc, char* argv[]) {
     workers.reserve(workerCount);
 
     for (int i = 0; i < workerCount; ++i) {
-        auto ctx = createBenchmarkServerContext(certFile, keyFile);
+        auto ctx = createBenchmarkServerContext(certFile, keyFile, keyless);
         if (!ctx) {
             return 1;
         }
+        if (!secondCertFile.empty() && !ctx->loadCertificateKeyPair(secondCertFile, secondKeyFile)) {
+            return 1;
+        }
+        if (sessionCache) {
+            ctx->setSessionTimeout(300);
+            ctx->setSessionCache(sessionCache);
+        }
+        if (ticketKeys) {
+            ctx->setSessionTimeout(300);
+            ctx->setSessionTicketKeys(ticketKeys);
+        }
+        if (chainAnchors) {
+            if (auto built = ctx->buildCertificateChain(chainAnchors); !built) {
+                std::cerr << "Failed to build certificate chain: " << built.error().message() << std::endl;
+                return 1;
+            }
+        }
+        if (certCompression) {
+            ctx->setHandshakeByteStats(true);
+            if (auto compressed = ctx->setCertificateCompression(*certCompression); !compressed) {
+                std::cerr << "Failed to enable certificate compression: " << compressed.error().message() << std::endl;
+                return 1;
+            }
+        }
+        if (ocspStapler) {
+            if (auto attached = ctx->setOcspStapler(ocspStapler); !attached) {
+                std::cerr << "Failed to enable OCSP stapling: " << attached.error().message() << std::endl;
+                return 1;
+            }
+        }
 
+        auto scheduler = std::make_unique<TestScheduler>();
+        std::unique_ptr<SslHandshakeAdmission> admission;
+        if (admissionOptions) {
+            admission = std::make_unique<SslHandshakeAdmission>(scheduler.get(), *admissionOptions);
+        }
         workers.push_back(BenchWorker{
+            .admission = std::move(admission),
             .ctx = std::move(ctx),
-            .scheduler = std::make_unique<TestScheduler>(),
+            .scheduler = std::move(scheduler),
         });
     }
 
@@ -212,15 +478,25 @@ int main(int argc, char* argv[]) {
         workers[static_cast<size_t>(i)].scheduler->start();
         scheduleTask(*workers[static_cast<size_t>(i)].scheduler,
                      sslServer(workers[static_cast<size_t>(i)].scheduler.get(),
-                               workers[static_cast<size_t>(i)].ctx.get(),
+                               certRouter ? certRouter->context() : workers[static_cast<size_t>(i)].ctx.get(),
+                               reloader.get(),
+                               workers[static_cast<size_t>(i)].admission.get(),
+                               acceptFilter.get(),
                                port,
                                backlog,
                                i,
                                workerCount));
     }
 
+    int elapsed = 0;
     while (g_running) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (reloader && ++elapsed % reloadInterval == 0) {
+            if (auto reloaded = reloader->reloadIfChanged(); !reloaded) {
+                std::cerr << "Certificate reload failed, keeping current context: "
+                          << reloaded.error().message() << std::endl;
+            }
+        }
     }
 
     for (auto it = workers.rbegin(); it != workers.rend(); ++it) {
@@ -231,6 +507,114 @@ int main(int argc, char* argv[]) {
     std::cout << "Total connections: " << g_connections << std::endl;
     std::cout << "Total bytes received: " << g_bytes_recv << std::endl;
     std::cout << "Total bytes sent: " << g_bytes_sent << std::endl;
+    if (sessionCache) {
+        const auto stats = sessionCache->stats();
+        std::cout << "Session cache: hits=" << stats.hits
+                  << " misses=" << stats.misses
+                  << " inserts=" << stats.inserts
+                  << " evictions=" << stats.evictions
+                  << " size=" << stats.size << std::endl;
+    }
+    if (keyless) {
+        const auto stats = keyless->stats();
+        std::cout << "Keyless: requests=" << stats.requests
+                  << " batches=" << stats.batches
+                  << " failures=" << stats.failures
+                  << " timeouts=" << stats.timeouts
+                  << " reconnects=" << stats.reconnects << std::endl;
+    }
+    for (const auto& worker : workers) {
+        if (!worker.admission) {
+            continue;
+        }
+        const auto stats = worker.admission->stats();
+        std::cout << "Handshake admission: admitted=" << stats.admitted
+                  << " queued=" << stats.queuedTotal
+                  << " shed=" << stats.shed
+                  << " limit=" << stats.limit
+                  << " loop_latency_us=" << stats.loopLatency.count() << std::endl;
+    }
+    if (!secondCertFile.empty()) {
+        SslCertificateStats total;
+        for (const auto& worker : workers) {
+            const auto stats = worker.ctx->certificateStats();
+            total.ecdsa += stats.ecdsa;
+            total.rsa += stats.rsa;
+            total.other += stats.other;
+        }
+        std::cout << "Certificates: ecdsa=" << total.ecdsa
+                  << " rsa=" << total.rsa
+                  << " other=" << total.other << std::endl;
+    }
+    if (certCompression) {
+        // 路由只统计前端上下文（连接由它创建），热重载只统计当前代的上下文
+        std::vector<const SslContext*> contexts;
+        for (const auto& worker : workers) {
+            contexts.push_back(worker.ctx.get());
+        }
+        if (certRouter) {
+            contexts.push_back(certRouter->context());
+        }
+        const auto current = reloader ? reloader->current() : nullptr;
+        if (current) {
+            contexts.push_back(current.get());
+        }
+        SslHandshakeByteStats total;
+        for (const SslContext* ctx : contexts) {
+            const auto stats = ctx->handshakeByteStats();
+            total.handshakes += stats.handshakes;
+            total.bytesSent += stats.bytesSent;
+            total.bytesReceived += stats.bytesReceived;
+            total.certificateBytesSent += stats.certificateBytesSent;
+            total.compressedCertificatesSent += stats.compressedCertificatesSent;
+        }
+        std::cout << "Handshake bytes: handshakes=" << total.handshakes
+                  << " sent=" << total.bytesSent
+                  << " received=" << total.bytesReceived
+                  << " certificate_sent=" << total.certificateBytesSent
+                  << " compressed_certificates=" << total.compressedCertificatesSent << std::endl;
+    }
+    if (reloader) {
+        const auto stats = reloader->stats();
+        std::cout << "Context reload: generation=" << stats.generation
+                  << " reloads=" << stats.reloads
+                  << " failures=" << stats.failures << std::endl;
+    }
+    if (ocspStapler) {
+        const auto stats = ocspStapler->stats();
+        std::cout << "OCSP stapling: stapled=" << stats.stapled
+                  << " unavailable=" << stats.unavailable
+                  << " refreshes=" << stats.refreshes
+                  << " refresh_failures=" << stats.refreshFailures
+                  << " certificates=" << stats.certificates << std::endl;
+    }
+    if (certRouter) {
+        const auto stats = certRouter->stats();
+        std::cout << "Cert router: hosts=" << stats.hosts
+                  << " resident=" << stats.resident
+                  << " hits=" << stats.hits
+                  << " loads=" << stats.loads
+                  << " load_failures=" << stats.loadFailures
+                  << " evictions=" << stats.evictions
+                  << " unknown=" << stats.unknown << std::endl;
+    }
+    if (acceptFilter) {
+        const auto stats = acceptFilter->stats();
+        std::cout << "Accept filter: accepted=" << stats.accepted
+                  << " rejected_source=" << stats.rejectedSource
+                  << " rejected_global=" << stats.rejectedGlobal
+                  << " rejected_protocol=" << stats.rejectedProtocol
+                  << " hello_pending=" << stats.helloPending
+                  << " evictions=" << stats.evictions << std::endl;
+    }
+    if (ticketKeys) {
+        const auto stats = ticketKeys->stats();
+        std::cout << "Session tickets: issued=" << stats.issued
+                  << " resumed=" << stats.resumed
+                  << " renewed=" << stats.renewed
+                  << " unknown_key=" << stats.unknownKey
+                  << " rotations=" << stats.rotations << std::endl;
+    }
 
     return 0;
 }
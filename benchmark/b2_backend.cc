@@ -0,0 +1,345 @@
+/**
+ * @file b2_backend.cc
+ * @brief 同一二进制内按运行时参数选择 IO 后端的 SSL Echo 压测
+ *
+ * @details 服务端与客户端各占一个调度器线程，走 loopback；同一组参数依次在选定的后端上执行，
+ * 便于在同一台机器、同一份二进制上对比 epoll 与 io_uring。可用后端取决于编译期开关：
+ * 单后端构建只有一个选项，开启 GALAY_SSL_DUAL_BACKEND 后 epoll 与 io_uring 同时可用。
+ */
+
+#include "galay-ssl/async/ssl_socket.h"
+#include "galay-ssl/ssl/ssl_context.h"
+#include <galay-kernel/kernel/task.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef USE_KQUEUE
+#include <galay-kernel/kernel/kqueue_scheduler.h>
+#endif
+#ifdef USE_IOURING
+#include <galay-kernel/kernel/io_uring_scheduler.h>
+#endif
+#ifdef USE_EPOLL
+#include <galay-kernel/kernel/epoll_scheduler.h>
+#endif
+
+using namespace galay::ssl;
+using namespace galay::kernel;
+
+namespace {
+
+struct BenchOptions {
+    int connections = 100;
+    int requestsPerConn = 1000;
+    size_t payloadBytes = 47;
+    uint16_t port = 9443;
+};
+
+struct BenchRun {
+    std::atomic<bool> serving{true};
+    std::atomic<bool> listening{false};
+    std::atomic<int> clientsDone{0};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> errors{0};
+};
+
+struct BackendResult {
+    std::string name;
+    bool ok = false;
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    uint64_t bytes = 0;
+    int64_t durationMs = 0;
+};
+
+std::atomic<bool> g_interrupted{false};
+
+void signalHandler(int) {
+    g_interrupted = true;
+}
+
+void configureBenchmarkTlsContext(SslContext& ctx) {
+    ctx.setSessionCacheMode(SSL_SESS_CACHE_OFF);
+    ctx.setSessionTimeout(0);
+    if (ctx.native()) {
+        SSL_CTX_set_options(ctx.native(), SSL_OP_NO_TICKET);
+    }
+}
+
+Task<void> echoSession(SslContext* ctx, GHandle handle, BenchRun* run) {
+    SslSocket peer(ctx, handle);
+    peer.option().handleNonBlock();
+
+    if (!co_await peer.handshake()) {
+        run->errors++;
+        co_await peer.close();
+        co_return;
+    }
+
+    std::vector<char> buffer(64 * 1024);
+    while (run->serving) {
+        auto recvResult = co_await peer.recv(buffer.data(), buffer.size());
+        if (!recvResult || recvResult.value().size() == 0) {
+            break;
+        }
+        auto& bytes = recvResult.value();
+        auto sendResult = co_await peer.send(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        if (!sendResult) {
+            break;
+        }
+    }
+
+    co_await peer.shutdown();
+    co_await peer.close();
+}
+
+template <typename SchedulerT>
+Task<void> echoServer(SchedulerT* scheduler, SslContext* ctx, uint16_t port, BenchRun* run) {
+    SslSocket listener(ctx);
+    listener.option().handleReuseAddr();
+    listener.option().handleNonBlock();
+    if (!listener.bind(Host(IPType::IPV4, "127.0.0.1", port)) || !listener.listen(4096)) {
+        run->errors++;
+        run->serving = false;
+        co_return;
+    }
+    run->listening = true;
+
+    while (run->serving) {
+        Host clientHost;
+        auto acceptResult = co_await listener.accept(&clientHost);
+        if (!acceptResult) {
+            continue;
+        }
+        scheduleTask(scheduler, echoSession(ctx, acceptResult.value(), run));
+    }
+
+    co_await listener.close();
+}
+
+Task<void> echoClient(SslContext* ctx, const BenchOptions* options, const std::string* message, BenchRun* run) {
+    SslSocket socket(ctx);
+    socket.option().handleNonBlock();
+
+    bool ok = static_cast<bool>(co_await socket.connect(Host(IPType::IPV4, "127.0.0.1", options->port)));
+    ok = ok && static_cast<bool>(co_await socket.handshake());
+
+    std::vector<char> buffer(std::max<size_t>(message->size(), 1));
+    for (int i = 0; ok && i < options->requestsPerConn && !g_interrupted; ++i) {
+        auto sendResult = co_await socket.send(message->data(), message->size());
+        if (!sendResult) {
+            ok = false;
+            break;
+        }
+        size_t remaining = message->size();
+        while (remaining > 0) {
+            auto recvResult = co_await socket.recv(buffer.data(), remaining);
+            if (!recvResult || recvResult.value().size() == 0) {
+                ok = false;
+                break;
+            }
+            remaining -= recvResult.value().size();
+        }
+        if (!ok) {
+            break;
+        }
+        run->requests++;
+        run->bytes += message->size() * 2;
+    }
+
+    if (!ok) {
+        run->errors++;
+    }
+    co_await socket.shutdown();
+    co_await socket.close();
+    run->clientsDone++;
+}
+
+template <typename SchedulerT>
+BackendResult runBackend(const std::string& name, const BenchOptions& options) {
+    BackendResult result;
+    result.name = name;
+
+    SslContext serverCtx(SslMethod::TLS_1_3_Server);
+    SslContext clientCtx(SslMethod::TLS_1_3_Client);
+    if (!serverCtx.isValid() || !clientCtx.isValid() ||
+        !serverCtx.loadCertificate("certs/server.crt") ||
+        !serverCtx.loadPrivateKey("certs/server.key")) {
+        std::cerr << "[" << name << "] failed to load certs/server.crt or certs/server.key" << std::endl;
+        return result;
+    }
+    configureBenchmarkTlsContext(serverCtx);
+    configureBenchmarkTlsContext(clientCtx);
+    clientCtx.setVerifyMode(SslVerifyMode::None);
+
+    BenchRun run;
+    const std::string message(options.payloadBytes, 'x');
+
+    SchedulerT serverScheduler;
+    SchedulerT clientScheduler;
+    serverScheduler.start();
+    clientScheduler.start();
+    scheduleTask(serverScheduler, echoServer(&serverScheduler, &serverCtx, options.port, &run));
+
+    while (!run.listening && run.serving && !g_interrupted) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    if (run.listening) {
+        for (int i = 0; i < options.connections; ++i) {
+            scheduleTask(clientScheduler, echoClient(&clientCtx, &options, &message, &run));
+        }
+        while (run.clientsDone.load() < options.connections && !g_interrupted) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    run.serving = false;
+    clientScheduler.stop();
+    serverScheduler.stop();
+
+    result.ok = run.listening.load();
+    result.requests = run.requests.load();
+    result.errors = run.errors.load();
+    result.bytes = run.bytes.load();
+    result.durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    return result;
+}
+
+std::vector<std::string> availableBackends() {
+    std::vector<std::string> names;
+#ifdef USE_EPOLL
+    names.emplace_back("epoll");
+#endif
+#ifdef USE_IOURING
+    names.emplace_back("io_uring");
+#endif
+#ifdef USE_KQUEUE
+    names.emplace_back("kqueue");
+#endif
+    return names;
+}
+
+bool runByName(const std::string& name, const BenchOptions& options, BackendResult& result) {
+#ifdef USE_EPOLL
+    if (name == "epoll") {
+        result = runBackend<EpollScheduler>(name, options);
+        return true;
+    }
+#endif
+#ifdef USE_IOURING
+    if (name == "io_uring") {
+        result = runBackend<IOUringScheduler>(name, options);
+        return true;
+    }
+#endif
+#ifdef USE_KQUEUE
+    if (name == "kqueue") {
+        result = runBackend<KqueueScheduler>(name, options);
+        return true;
+    }
+#endif
+    (void)options;
+    (void)result;
+    return false;
+}
+
+void printResult(const BackendResult& result, const BenchOptions& options) {
+    std::cout << "\nBackend: " << result.name << std::endl;
+    std::cout << "Connections: " << options.connections
+              << ", Requests/conn: " << options.requestsPerConn
+              << ", Payload bytes: " << options.payloadBytes << std::endl;
+    std::cout << "Total requests: " << result.requests << std::endl;
+    std::cout << "Total errors: " << result.errors << std::endl;
+    std::cout << "Duration: " << result.durationMs << " ms" << std::endl;
+    if (result.durationMs > 0) {
+        const double rps = static_cast<double>(result.requests) * 1000.0 / static_cast<double>(result.durationMs);
+        const double mbps = static_cast<double>(result.bytes) / 1024.0 / 1024.0 * 1000.0 /
+                            static_cast<double>(result.durationMs);
+        std::cout << "Requests/sec: " << rps << std::endl;
+        std::cout << "Throughput: " << mbps << " MB/s" << std::endl;
+    }
+}
+
+void printUsage(const char* prog) {
+    std::cerr << "Usage: " << prog
+              << " <backend|all|list> [connections] [requests_per_conn] [payload_bytes] [port]" << std::endl;
+    std::cerr << "Available backends:";
+    for (const auto& name : availableBackends()) {
+        std::cerr << " " << name;
+    }
+    std::cerr << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const std::string backend = argv[1];
+    if (backend == "list") {
+        for (const auto& name : availableBackends()) {
+            std::cout << name << std::endl;
+        }
+        return 0;
+    }
+
+    BenchOptions options;
+    if (argc >= 3) {
+        options.connections = std::max(1, std::stoi(argv[2]));
+    }
+    if (argc >= 4) {
+        options.requestsPerConn = std::max(1, std::stoi(argv[3]));
+    }
+    if (argc >= 5) {
+        options.payloadBytes = std::max<size_t>(1, static_cast<size_t>(std::stoull(argv[4])));
+    }
+    if (argc >= 6) {
+        options.port = static_cast<uint16_t>(std::stoi(argv[5]));
+    }
+
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::string> targets;
+    if (backend == "all") {
+        targets = availableBackends();
+    } else {
+        targets.push_back(backend);
+    }
+
+    int exitCode = 0;
+    for (size_t i = 0; i < targets.size() && !g_interrupted; ++i) {
+        BenchOptions runOptions = options;
+        // 每个后端换一个端口，避免上一轮 TIME_WAIT 干扰
+        runOptions.port = static_cast<uint16_t>(options.port + i);
+
+        BackendResult result;
+        if (!runByName(targets[i], runOptions, result)) {
+            std::cerr << "backend '" << targets[i] << "' is not compiled into this binary" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        printResult(result, runOptions);
+        if (!result.ok || result.errors > 0) {
+            exitCode = 1;
+        }
+    }
+
+    return exitCode;
+}
@@ -0,0 +1,254 @@
+/**
+ * @file b3_resume.cc
+ * @brief 完整握手与两种 session 恢复方式的握手 CPU 对比
+ *
+ * @details 客户端与服务端都在当前线程内用 Memory BIO 直连，不经过网络与调度器，
+ * 只统计握手本身的 CPU。每种模式先做一次完整握手拿到 session，之后每轮都尝试恢复：
+ * - full：服务端关闭缓存与 ticket，每轮都是完整握手
+ * - cache：服务端挂 SslSessionCache，按 session id（TLS 1.2）/ 有状态 ticket（TLS 1.3）恢复
+ * - ticket：服务端挂 SslTicketKeyRing，无状态 ticket 恢复
+ * 服务端 CPU 用 CLOCK_THREAD_CPUTIME_ID 只累计服务端 doHandshake() 的耗时。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_session_cache.h"
+#include "galay-ssl/ssl/ssl_ticket_keys.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+enum class ResumeMode {
+    Full,
+    Cache,
+    Ticket,
+};
+
+struct ModeResult {
+    uint64_t handshakes = 0;
+    uint64_t resumed = 0;
+    uint64_t failures = 0;
+    int64_t serverCpuNs = 0;
+    int64_t totalCpuNs = 0;
+};
+
+int64_t cpuNowNs(clockid_t clock) {
+    timespec ts{};
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+const char* modeName(ResumeMode mode) {
+    switch (mode) {
+        case ResumeMode::Full:
+            return "full";
+        case ResumeMode::Cache:
+            return "cache";
+        case ResumeMode::Ticket:
+            return "ticket";
+    }
+    return "unknown";
+}
+
+bool transferPending(SslEngine& from, SslEngine& to) {
+    std::array<char, 16384> buffer{};
+    while (from.pendingEncryptedOutput() > 0) {
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        if (produced <= 0 || to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) != produced) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool stepOk(SslIOResult ret) {
+    return ret == SslIOResult::Success || ret == SslIOResult::WantRead || ret == SslIOResult::WantWrite;
+}
+
+/**
+ * @brief 完成一次握手，返回客户端得到的 session；serverCpuNs 累加服务端握手 CPU
+ */
+SSL_SESSION* handshakeOnce(SslContext& clientCtx, SslContext& serverCtx, SSL_SESSION* resume,
+                           bool& reused, int64_t& serverCpuNs) {
+    SslEngine client(&clientCtx);
+    SslEngine server(&serverCtx);
+    if (!client.initMemoryBIO() || !server.initMemoryBIO()) {
+        return nullptr;
+    }
+    client.setConnectState();
+    server.setAcceptState();
+    if (resume) {
+        client.setSession(resume);
+    }
+
+    for (int i = 0; i < 64; ++i) {
+        if (!client.isHandshakeCompleted() && !stepOk(client.doHandshake())) {
+            return nullptr;
+        }
+        if (!transferPending(client, server)) {
+            return nullptr;
+        }
+        if (!server.isHandshakeCompleted()) {
+            const int64_t begin = cpuNowNs(CLOCK_THREAD_CPUTIME_ID);
+            const auto ret = server.doHandshake();
+            serverCpuNs += cpuNowNs(CLOCK_THREAD_CPUTIME_ID) - begin;
+            if (!stepOk(ret)) {
+                return nullptr;
+            }
+        }
+        if (!transferPending(server, client)) {
+            return nullptr;
+        }
+        if (client.isHandshakeCompleted() && server.isHandshakeCompleted()) {
+            // TLS 1.3 的 NewSessionTicket 在握手后到达，读一次让客户端处理
+            std::array<char, 16> scratch{};
+            size_t bytesRead = 0;
+            (void)client.read(scratch.data(), scratch.size(), bytesRead);
+            reused = server.isSessionReused();
+            SSL_SESSION* session = SSL_get1_session(client.native());
+            (void)server.shutdown();
+            (void)client.shutdown();
+            return session;
+        }
+    }
+    return nullptr;
+}
+
+std::unique_ptr<SslContext> createServerContext(bool tls13, ResumeMode mode,
+                                                const std::string& certFile, const std::string& keyFile) {
+    auto ctx = std::make_unique<SslContext>(tls13 ? SslMethod::TLS_1_3_Server : SslMethod::TLS_1_2_Server);
+    if (!ctx->isValid() || !ctx->loadCertificate(certFile) || !ctx->loadPrivateKey(keyFile)) {
+        std::cerr << "Failed to create server context: " << ctx->error().message() << std::endl;
+        return nullptr;
+    }
+    switch (mode) {
+        case ResumeMode::Full:
+            ctx->setSessionCacheMode(SSL_SESS_CACHE_OFF);
+            break;
+        case ResumeMode::Cache:
+            ctx->setSessionCache(std::make_shared<SslSessionCache>());
+            break;
+        case ResumeMode::Ticket:
+            // 关闭内置缓存，确保 TLS 1.2 恢复只走 ticket
+            ctx->setSessionCacheMode(SSL_SESS_CACHE_OFF);
+            ctx->setSessionTicketKeys(std::make_shared<SslTicketKeyRing>());
+            break;
+    }
+    return ctx;
+}
+
+ModeResult runMode(bool tls13, ResumeMode mode, int handshakes,
+                   const std::string& certFile, const std::string& keyFile) {
+    ModeResult result;
+    auto serverCtx = createServerContext(tls13, mode, certFile, keyFile);
+    if (!serverCtx) {
+        result.failures = 1;
+        return result;
+    }
+    SslContext clientCtx(tls13 ? SslMethod::TLS_1_3_Client : SslMethod::TLS_1_2_Client);
+    // 客户端只使用显式传入的 session，避免内置缓存的副作用
+    clientCtx.setSessionCacheMode(SSL_SESS_CACHE_OFF);
+
+    // 预热：拿到第一个 session，不计入统计
+    bool reused = false;
+    int64_t ignored = 0;
+    SSL_SESSION* session = handshakeOnce(clientCtx, *serverCtx, nullptr, reused, ignored);
+    if (!session) {
+        result.failures = 1;
+        return result;
+    }
+
+    const int64_t totalBegin = cpuNowNs(CLOCK_PROCESS_CPUTIME_ID);
+    for (int i = 0; i < handshakes; ++i) {
+        SSL_SESSION* next = handshakeOnce(clientCtx, *serverCtx, session, reused, result.serverCpuNs);
+        if (!next) {
+            ++result.failures;
+            continue;
+        }
+        ++result.handshakes;
+        if (reused) {
+            ++result.resumed;
+        }
+        // 续签后的 ticket 才是服务端期望的最新 ticket
+        SSL_SESSION_free(session);
+        session = next;
+    }
+    result.totalCpuNs = cpuNowNs(CLOCK_PROCESS_CPUTIME_ID) - totalBegin;
+    SSL_SESSION_free(session);
+    return result;
+}
+
+void printResult(const char* version, ResumeMode mode, const ModeResult& result, const ModeResult& baseline) {
+    const double handshakes = static_cast<double>(std::max<uint64_t>(1, result.handshakes));
+    const double serverUs = static_cast<double>(result.serverCpuNs) / handshakes / 1000.0;
+    const double totalUs = static_cast<double>(result.totalCpuNs) / handshakes / 1000.0;
+    const double baselineUs = static_cast<double>(baseline.serverCpuNs) /
+                              static_cast<double>(std::max<uint64_t>(1, baseline.handshakes)) / 1000.0;
+    const double saved = baselineUs > 0.0 ? (1.0 - serverUs / baselineUs) * 100.0 : 0.0;
+
+    std::cout << std::left << std::setw(8) << version
+              << std::setw(8) << modeName(mode)
+              << std::right << std::setw(12) << result.handshakes
+              << std::setw(10) << result.resumed
+              << std::setw(10) << result.failures
+              << std::fixed << std::setprecision(1)
+              << std::setw(14) << serverUs
+              << std::setw(14) << totalUs
+              << std::setw(12) << saved << "%" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+        std::cout << "Usage: " << argv[0] << " [handshakes] [tls12|tls13|all] [cert_file] [key_file]" << std::endl;
+        return 0;
+    }
+
+    const int handshakes = argc >= 2 ? std::max(1, std::atoi(argv[1])) : 2000;
+    const std::string version = argc >= 3 ? argv[2] : "all";
+    const std::string certFile = argc >= 4 ? argv[3] : "certs/server.crt";
+    const std::string keyFile = argc >= 5 ? argv[4] : "certs/server.key";
+    if (version != "tls12" && version != "tls13" && version != "all") {
+        std::cerr << "Unknown version: " << version << std::endl;
+        return 1;
+    }
+
+    std::cout << "Handshakes per mode: " << handshakes << std::endl;
+    std::cout << std::left << std::setw(8) << "version"
+              << std::setw(8) << "mode"
+              << std::right << std::setw(12) << "handshakes"
+              << std::setw(10) << "resumed"
+              << std::setw(10) << "failures"
+              << std::setw(14) << "server us/hs"
+              << std::setw(14) << "total us/hs"
+              << std::setw(13) << "server saved" << std::endl;
+
+    bool ok = true;
+    for (const bool tls13 : {false, true}) {
+        if ((tls13 && version == "tls12") || (!tls13 && version == "tls13")) {
+            continue;
+        }
+        const char* name = tls13 ? "TLS1.3" : "TLS1.2";
+        const ModeResult full = runMode(tls13, ResumeMode::Full, handshakes, certFile, keyFile);
+        printResult(name, ResumeMode::Full, full, full);
+        for (const ResumeMode mode : {ResumeMode::Cache, ResumeMode::Ticket}) {
+            const ModeResult result = runMode(tls13, mode, handshakes, certFile, keyFile);
+            printResult(name, mode, result, full);
+            ok = ok && result.failures == 0;
+        }
+        ok = ok && full.failures == 0;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+/**
+ * @file b4_keyshare.cc
+ * @brief 服务端现场生成 ECDHE 临时密钥与 SslKeySharePool 预生成的握手延迟对比
+ *
+ * @details 客户端与服务端都在当前线程内用 Memory BIO 直连，不经过网络与调度器。
+ * 每轮都是完整握手（服务端关闭 session 缓存），按组与协议版本分别运行：
+ * - inline：普通 SslContext，服务端在握手线程上生成 key share
+ * - pool：以 SslKeySharePool 构造的服务端上下文，key share 由后台线程预生成
+ * 服务端 CPU 用 CLOCK_THREAD_CPUTIME_ID 只累计服务端 doHandshake() 的耗时，
+ * 墙钟延迟取服务端各步 doHandshake() 墙钟之和的 p50 / p99。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_key_share_pool.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+struct ModeResult {
+    uint64_t handshakes = 0;
+    uint64_t failures = 0;
+    uint64_t served = 0;
+    uint64_t misses = 0;
+    int64_t serverCpuNs = 0;
+    std::vector<int64_t> serverWallNs;
+};
+
+int64_t cpuNowNs(clockid_t clock) {
+    timespec ts{};
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+bool transferPending(SslEngine& from, SslEngine& to) {
+    std::array<char, 16384> buffer{};
+    while (from.pendingEncryptedOutput() > 0) {
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        if (produced <= 0 || to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) != produced) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool stepOk(SslIOResult ret) {
+    return ret == SslIOResult::Success || ret == SslIOResult::WantRead || ret == SslIOResult::WantWrite;
+}
+
+/**
+ * @brief 完成一次完整握手，serverCpuNs / serverWallNs 为服务端 doHandshake() 的耗时
+ */
+bool handshakeOnce(SslContext& clientCtx, SslContext& serverCtx, int64_t& serverCpuNs, int64_t& serverWallNs) {
+    SslEngine client(&clientCtx);
+    SslEngine server(&serverCtx);
+    if (!client.initMemoryBIO() || !server.initMemoryBIO()) {
+        return false;
+    }
+    client.setConnectState();
+    server.setAcceptState();
+
+    for (int i = 0; i < 64; ++i) {
+        if (!client.isHandshakeCompleted() && !stepOk(client.doHandshake())) {
+            return false;
+        }
+        if (!transferPending(client, server)) {
+            return false;
+        }
+        if (!server.isHandshakeCompleted()) {
+            const int64_t cpuBegin = cpuNowNs(CLOCK_THREAD_CPUTIME_ID);
+            const auto wallBegin = std::chrono::steady_clock::now();
+            const auto ret = server.doHandshake();
+            serverWallNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - wallBegin).count();
+            serverCpuNs += cpuNowNs(CLOCK_THREAD_CPUTIME_ID) - cpuBegin;
+            if (!stepOk(ret)) {
+                return false;
+            }
+        }
+        if (!transferPending(server, client)) {
+            return false;
+        }
+        if (client.isHandshakeCompleted() && server.isHandshakeCompleted()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ModeResult runMode(bool tls13, const std::string& group, const std::shared_ptr<SslKeySharePool>& pool,
+                   int handshakes, const std::string& certFile, const std::string& keyFile) {
+    ModeResult result;
+    SslContext serverCtx(tls13 ? SslMethod::TLS_1_3_Server : SslMethod::TLS_1_2_Server, pool);
+    SslContext clientCtx(tls13 ? SslMethod::TLS_1_3_Client : SslMethod::TLS_1_2_Client);
+    if (!serverCtx.isValid() || !serverCtx.loadCertificate(certFile) || !serverCtx.loadPrivateKey(keyFile) ||
+        SSL_CTX_set1_groups_list(serverCtx.native(), group.c_str()) != 1 ||
+        SSL_CTX_set1_groups_list(clientCtx.native(), group.c_str()) != 1) {
+        std::cerr << "Failed to create contexts for " << group << std::endl;
+        result.failures = 1;
+        return result;
+    }
+    serverCtx.setSessionCacheMode(SSL_SESS_CACHE_OFF);
+    clientCtx.setSessionCacheMode(SSL_SESS_CACHE_OFF);
+
+    // 预热，不计入统计
+    int64_t ignoredCpu = 0;
+    int64_t ignoredWall = 0;
+    if (!handshakeOnce(clientCtx, serverCtx, ignoredCpu, ignoredWall)) {
+        result.failures = 1;
+        return result;
+    }
+
+    const SslKeySharePoolStats before = pool ? pool->stats() : SslKeySharePoolStats{};
+    result.serverWallNs.reserve(static_cast<size_t>(handshakes));
+    for (int i = 0; i < handshakes; ++i) {
+        int64_t wallNs = 0;
+        if (!handshakeOnce(clientCtx, serverCtx, result.serverCpuNs, wallNs)) {
+            ++result.failures;
+            continue;
+        }
+        ++result.handshakes;
+        result.serverWallNs.push_back(wallNs);
+    }
+    if (pool) {
+        const auto after = pool->stats();
+        result.served = after.served - before.served;
+        result.misses = after.misses - before.misses;
+    }
+    return result;
+}
+
+double percentileUs(std::vector<int64_t> samples, double percentile) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    const size_t index = std::min(samples.size() - 1, static_cast<size_t>(percentile * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(index), samples.end());
+    return static_cast<double>(samples[index]) / 1000.0;
+}
+
+void printResult(const char* version, const std::string& group, const char* mode,
+                 const ModeResult& result, const ModeResult& baseline) {
+    const double handshakes = static_cast<double>(std::max<uint64_t>(1, result.handshakes));
+    const double serverUs = static_cast<double>(result.serverCpuNs) / handshakes / 1000.0;
+    const double baselineUs = static_cast<double>(baseline.serverCpuNs) /
+                              static_cast<double>(std::max<uint64_t>(1, baseline.handshakes)) / 1000.0;
+    const double saved = baselineUs > 0.0 ? (1.0 - serverUs / baselineUs) * 100.0 : 0.0;
+
+    std::cout << std::left << std::setw(8) << version
+              << std::setw(8) << group
+              << std::setw(8) << mode
+              << std::right << std::setw(12) << result.handshakes
+              << std::setw(10) << result.failures
+              << std::setw(10) << result.served
+              << std::setw(10) << result.misses
+              << std::fixed << std::setprecision(1)
+              << std::setw(14) << serverUs
+              << std::setw(10) << percentileUs(result.serverWallNs, 0.50)
+              << std::setw(10) << percentileUs(result.serverWallNs, 0.99)
+              << std::setw(12) << saved << "%" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+        std::cout << "Usage: " << argv[0] << " [handshakes] [tls12|tls13|all] [cert_file] [key_file]" << std::endl;
+        return 0;
+    }
+
+    const int handshakes = argc >= 2 ? std::max(1, std::atoi(argv[1])) : 2000;
+    const std::string version = argc >= 3 ? argv[2] : "all";
+    const std::string certFile = argc >= 4 ? argv[3] : "certs/server.crt";
+    const std::string keyFile = argc >= 5 ? argv[4] : "certs/server.key";
+    if (version != "tls12" && version != "tls13" && version != "all") {
+        std::cerr << "Unknown version: " << version << std::endl;
+        return 1;
+    }
+
+    auto pool = SslKeySharePool::create();
+    if (!pool) {
+        std::cerr << "Failed to create key share pool: " << pool.error().message() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Handshakes per mode: " << handshakes << std::endl;
+    std::cout << std::left << std::setw(8) << "version"
+              << std::setw(8) << "group"
+              << std::setw(8) << "mode"
+              << std::right << std::setw(12) << "handshakes"
+              << std::setw(10) << "failures"
+              << std::setw(10) << "served"
+              << std::setw(10) << "misses"
+              << std::setw(14) << "server us/hs"
+              << std::setw(10) << "p50 us"
+              << std::setw(10) << "p99 us"
+              << std::setw(13) << "server saved" << std::endl;
+
+    bool ok = true;
+    for (const bool tls13 : {false, true}) {
+        if ((tls13 && version == "tls12") || (!tls13 && version == "tls13")) {
+            continue;
+        }
+        const char* name = tls13 ? "TLS1.3" : "TLS1.2";
+        for (const std::string group : {"X25519", "P-256"}) {
+            const ModeResult inlineResult = runMode(tls13, group, nullptr, handshakes, certFile, keyFile);
+            printResult(name, group, "inline", inlineResult, inlineResult);
+            const ModeResult pooled = runMode(tls13, group, *pool, handshakes, certFile, keyFile);
+            printResult(name, group, "pool", pooled, inlineResult);
+            ok = ok && inlineResult.failures == 0 && pooled.failures == 0;
+        }
+    }
+
+    const auto stats = (*pool)->stats();
+    std::cout << "Pool generated: " << stats.generated << ", served: " << stats.served
+              << ", misses: " << stats.misses << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+/**
+ * @file b5_psk.cc
+ * @brief TLS 1.3 证书握手与外部 PSK 握手（psk_dhe_ke / psk_ke）的握手速率对比
+ *
+ * @details 客户端与服务端都在当前线程内用 Memory BIO 直连，不经过网络与调度器。
+ * 每轮都是完整握手（关闭 session 缓存与 ticket），分别运行：
+ * - cert：服务端证书 + ECDHE，客户端用 CA 验证证书链
+ * - psk_dhe：SslPskStore 外部 PSK + ECDHE，不发送、不验证证书
+ * - psk_ke：外部 PSK，不做 ECDHE（需要 OpenSSL 3.3+ 的服务端偏好，否则仍协商 psk_dhe_ke，见 ecdhe 列）
+ * 速率按两端合计的墙钟计算，CPU 用 CLOCK_THREAD_CPUTIME_ID 分别累计两端 doHandshake() 的耗时。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_psk_store.h"
+#include <openssl/rand.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+struct ModeResult {
+    uint64_t handshakes = 0;
+    uint64_t failures = 0;
+    uint64_t ecdhe = 0;         ///< 实际做了 ECDHE 的握手数
+    int64_t wallNs = 0;
+    int64_t serverCpuNs = 0;
+    int64_t clientCpuNs = 0;
+};
+
+int64_t cpuNowNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+bool transferPending(SslEngine& from, SslEngine& to) {
+    std::array<char, 16384> buffer{};
+    while (from.pendingEncryptedOutput() > 0) {
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        if (produced <= 0 || to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) != produced) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool stepOk(SslIOResult ret) {
+    return ret == SslIOResult::Success || ret == SslIOResult::WantRead || ret == SslIOResult::WantWrite;
+}
+
+/**
+ * @brief 步进一端的握手并累计其线程 CPU
+ */
+bool step(SslEngine& engine, int64_t& cpuNs) {
+    if (engine.isHandshakeCompleted()) {
+        return true;
+    }
+    const int64_t begin = cpuNowNs();
+    const auto ret = engine.doHandshake();
+    cpuNs += cpuNowNs() - begin;
+    return stepOk(ret);
+}
+
+/**
+ * @brief 完成一次完整握手，usedEcdhe 返回客户端是否收到了服务端的临时公钥
+ */
+bool handshakeOnce(SslContext& clientCtx, SslContext& serverCtx, ModeResult& result, bool& usedEcdhe) {
+    SslEngine client(&clientCtx);
+    SslEngine server(&serverCtx);
+    if (!client.initMemoryBIO() || !server.initMemoryBIO()) {
+        return false;
+    }
+    client.setConnectState();
+    server.setAcceptState();
+
+    for (int i = 0; i < 64; ++i) {
+        if (!step(client, result.clientCpuNs) || !transferPending(client, server)) {
+            return false;
+        }
+        if (!step(server, result.serverCpuNs) || !transferPending(server, client)) {
+            return false;
+        }
+        if (client.isHandshakeCompleted() && server.isHandshakeCompleted()) {
+            EVP_PKEY* peer = nullptr;
+            usedEcdhe = SSL_get_peer_tmp_key(client.native(), &peer) == 1;
+            EVP_PKEY_free(peer);
+            return true;
+        }
+    }
+    return false;
+}
+
+ModeResult run(SslContext& clientCtx, SslContext& serverCtx, int handshakes) {
+    ModeResult result;
+    serverCtx.setSessionCacheMode(SSL_SESS_CACHE_OFF);
+    clientCtx.setSessionCacheMode(SSL_SESS_CACHE_OFF);
+
+    // 预热，不计入统计
+    ModeResult ignored;
+    bool usedEcdhe = false;
+    if (!handshakeOnce(clientCtx, serverCtx, ignored, usedEcdhe)) {
+        result.failures = 1;
+        return result;
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < handshakes; ++i) {
+        if (!handshakeOnce(clientCtx, serverCtx, result, usedEcdhe)) {
+            ++result.failures;
+            continue;
+        }
+        ++result.handshakes;
+        result.ecdhe += usedEcdhe ? 1 : 0;
+    }
+    result.wallNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+ModeResult runCertificate(int handshakes, const std::string& certFile, const std::string& keyFile,
+                          const std::string& caFile) {
+    SslContext serverCtx(SslMethod::TLS_1_3_Server);
+    SslContext clientCtx(SslMethod::TLS_1_3_Client);
+    if (!serverCtx.isValid() || !serverCtx.loadCertificate(certFile) || !serverCtx.loadPrivateKey(keyFile) ||
+        !clientCtx.loadCACertificate(caFile)) {
+        std::cerr << "Failed to load " << certFile << " / " << keyFile << " / " << caFile << std::endl;
+        ModeResult failed;
+        failed.failures = 1;
+        return failed;
+    }
+    clientCtx.setVerifyMode(SslVerifyMode::Peer);
+    return run(clientCtx, serverCtx, handshakes);
+}
+
+ModeResult runPsk(int handshakes, const std::shared_ptr<SslPskStore>& keys, SslPskMode mode) {
+    SslContext serverCtx(SslMethod::TLS_1_3_Server);
+    SslContext clientCtx(SslMethod::TLS_1_3_Client);
+    if (!serverCtx.setPreSharedKeys(keys, mode) || !clientCtx.setPreSharedKeys(keys, mode)) {
+        std::cerr << "Failed to configure PSK" << std::endl;
+        ModeResult failed;
+        failed.failures = 1;
+        return failed;
+    }
+    return run(clientCtx, serverCtx, handshakes);
+}
+
+void printResult(const char* mode, const ModeResult& result, const ModeResult& baseline) {
+    const double handshakes = static_cast<double>(std::max<uint64_t>(1, result.handshakes));
+    const double rate = result.wallNs > 0 ? static_cast<double>(result.handshakes) * 1e9 / result.wallNs : 0.0;
+    const double baselineRate = baseline.wallNs > 0
+        ? static_cast<double>(baseline.handshakes) * 1e9 / baseline.wallNs : 0.0;
+
+    std::cout << std::left << std::setw(10) << mode
+              << std::right << std::setw(12) << result.handshakes
+              << std::setw(10) << result.failures
+              << std::setw(8) << result.ecdhe
+              << std::fixed << std::setprecision(1)
+              << std::setw(12) << rate
+              << std::setw(14) << static_cast<double>(result.serverCpuNs) / handshakes / 1000.0
+              << std::setw(14) << static_cast<double>(result.clientCpuNs) / handshakes / 1000.0
+              << std::setprecision(2)
+              << std::setw(10) << (baselineRate > 0.0 ? rate / baselineRate : 0.0) << "x" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+        std::cout << "Usage: " << argv[0] << " [handshakes] [cert_file] [key_file] [ca_file]" << std::endl;
+        return 0;
+    }
+
+    const int handshakes = argc >= 2 ? std::max(1, std::atoi(argv[1])) : 2000;
+    const std::string certFile = argc >= 3 ? argv[2] : "certs/server.crt";
+    const std::string keyFile = argc >= 4 ? argv[3] : "certs/server.key";
+    const std::string caFile = argc >= 5 ? argv[4] : "certs/ca.crt";
+
+    auto keys = SslPskStore::create({.clientIdentity = "bench"});
+    std::vector<unsigned char> secret(32);
+    if (!keys || RAND_bytes(secret.data(), static_cast<int>(secret.size())) != 1 ||
+        !(*keys)->add("bench", std::move(secret))) {
+        std::cerr << "Failed to create PSK store" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Handshakes per mode: " << handshakes << std::endl;
+    std::cout << std::left << std::setw(10) << "mode"
+              << std::right << std::setw(12) << "handshakes"
+              << std::setw(10) << "failures"
+              << std::setw(8) << "ecdhe"
+              << std::setw(12) << "hs/s"
+              << std::setw(14) << "server us/hs"
+              << std::setw(14) << "client us/hs"
+              << std::setw(11) << "vs cert" << std::endl;
+
+    const ModeResult cert = runCertificate(handshakes, certFile, keyFile, caFile);
+    printResult("cert", cert, cert);
+    const ModeResult pskDhe = runPsk(handshakes, *keys, SslPskMode::PskDheKe);
+    printResult("psk_dhe", pskDhe, cert);
+    const ModeResult pskKe = runPsk(handshakes, *keys, SslPskMode::PskKe);
+    printResult("psk_ke", pskKe, cert);
+
+    const auto stats = (*keys)->stats();
+    std::cout << "PSK found: " << stats.found << ", unknown: " << stats.unknown << std::endl;
+    return cert.failures == 0 && pskDhe.failures == 0 && pskKe.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file keyless_signer.cc
+ * @brief 参考签名进程：持有私钥，为 GALAY_SSL_KEYLESS 模式的 b1_server 应答私钥运算
+ */
+
+#include "galay-ssl/ssl/ssl_keyless.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <thread>
+
+using namespace galay::ssl;
+
+namespace {
+
+std::atomic<bool> g_running{true};
+
+void signalHandler(int) {
+    g_running = false;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " <socket_path> <key_file> [key_file...]" << std::endl;
+        return 1;
+    }
+
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    signal(SIGPIPE, SIG_IGN);
+
+    SslKeylessSigner signer(argv[1]);
+    for (int i = 2; i < argc; ++i) {
+        if (auto added = signer.addKey(argv[i]); !added) {
+            std::cerr << "Failed to load key " << argv[i] << ": " << added.error().message() << std::endl;
+            return 1;
+        }
+    }
+    if (auto started = signer.start(); !started) {
+        std::cerr << "Failed to listen on " << argv[1] << ": " << started.error().message() << std::endl;
+        return 1;
+    }
+    std::cout << "Keyless signer listening on " << argv[1] << " with " << (argc - 2) << " key(s)" << std::endl;
+
+    while (g_running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    signer.stop();
+
+    const auto stats = signer.stats();
+    std::cout << "\nFinal stats:" << std::endl;
+    std::cout << "Requests: " << stats.requests << std::endl;
+    std::cout << "Batches: " << stats.batches << std::endl;
+    std::cout << "Errors: " << stats.errors << std::endl;
+    return 0;
+}
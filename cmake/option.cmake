@@ -5,5 +5,6 @@ option(BUILD_BENCHMARKS "Build benchmark executables" ON)
 option(BUILD_EXAMPLES "Build example executables" ON)
 option(BUILD_SHARED_LIBS "Build shared library" ON)
 option(DISABLE_IOURING "Disable io_uring and use epoll on Linux" OFF)
+option(GALAY_SSL_DUAL_BACKEND "Compile both io_uring and epoll SSL awaitable paths on Linux (requires a dual-backend galay-kernel)" OFF)
 option(ENABLE_LTO "Enable IPO/LTO for Release builds" ON)
 option(BUILD_MODULE_EXAMPLES "Build C++23 module(import/export) examples" OFF)
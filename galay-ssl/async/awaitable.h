@@ -2,6 +2,15 @@
 #define GALAY_SSL_AWAITABLE_H
 
 #include "ssl_await.h"
+#include "ssl_flush.h"
+#include <galay-kernel/kernel/io_scheduler.hpp>
+#include <galay-kernel/kernel/task.h>
+#include <chrono>
+#include <coroutine>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <utility>
 
 namespace galay::ssl
 {
@@ -11,8 +20,8 @@ struct SslRecvAwaitable
     using Base = SslStateMachineAwaitable<detail::SslSingleRecvMachine>;
 
     SslRecvAwaitable(IOController* controller, SslSocket* socket,
-                     char* buffer, size_t length)
-        : Base(controller, socket, detail::SslSingleRecvMachine(buffer, length)) {}
+                     char* buffer, size_t length, bool early_data = false)
+        : Base(controller, socket, detail::SslSingleRecvMachine(buffer, length, early_data)) {}
 
     using Base::await_ready;
     using Base::await_resume;
@@ -20,27 +29,264 @@ struct SslRecvAwaitable
     using Base::timeout;
 };
 
-struct SslSendAwaitable : public SslStateMachineAwaitable<detail::SslSingleSendMachine> {
+/**
+ * @brief SslSocket::send() 返回的可等待对象
+ *
+ * @details 连接正由 SslFlushQueue 排空、且本次数据会使积压超过 maxPendingBytes（或已有 send 在等待）时，
+ * 先挂起到排空任务上，由它在本轮积压写完后代为加密入队再恢复；其余情况直接推进发送状态机。
+ * timeout() 只作用于发送状态机，不限制等待排空的时间。
+ */
+class SslSendAwaitable : public SslStateMachineAwaitable<detail::SslSingleSendMachine>
+{
+public:
     using Base = SslStateMachineAwaitable<detail::SslSingleSendMachine>;
 
     SslSendAwaitable(IOController* controller, SslSocket* socket,
                      const char* buffer, size_t length)
-        : Base(controller, socket, detail::SslSingleSendMachine(buffer, length)) {}
+        : Base(controller, socket, detail::SslSingleSendMachine(buffer, length))
+        , m_target(socket)
+    {
+        m_waiter.buffer = buffer;
+        m_waiter.length = length;
+    }
+
+    ~SslSendAwaitable();
+
+    SslSendAwaitable(const SslSendAwaitable&) = delete;
+    SslSendAwaitable& operator=(const SslSendAwaitable&) = delete;
+
+    bool await_ready();
+
+    template <typename Promise>
+    bool await_suspend(std::coroutine_handle<Promise> handle)
+    {
+        if (m_drain) {
+            m_waiter.handle = handle;
+            m_drain->waiters.push_back(&m_waiter);
+            return true;
+        }
+        return Base::await_suspend(handle);
+    }
+
+    std::expected<size_t, SslError> await_resume();
+
+    SslSendAwaitable& timeout(std::chrono::milliseconds timeout)
+    {
+        Base::timeout(timeout);
+        return *this;
+    }
+
+private:
+    SslSocket* m_target;
+    std::shared_ptr<SslFlushDrain> m_drain;     ///< 挂起等待的排空；为空表示走发送状态机
+    SslFlushDrain::Waiter m_waiter;
+};
+
+/**
+ * @brief 单轮握手：在套接字上推进到成功、失败或需要等待后台运算（kHandshakeWantAsync）为止
+ */
+struct SslHandshakeStepAwaitable : public SslStateMachineAwaitable<detail::SslSingleHandshakeMachine> {
+    using Base = SslStateMachineAwaitable<detail::SslSingleHandshakeMachine>;
+
+    SslHandshakeStepAwaitable(IOController* controller, SslSocket* socket)
+        : Base(controller, socket, detail::SslSingleHandshakeMachine{}) {}
 
     using Base::await_ready;
     using Base::await_resume;
     using Base::await_suspend;
+    using Base::timeout;
 };
 
-struct SslHandshakeAwaitable : public SslStateMachineAwaitable<detail::SslSingleHandshakeMachine> {
-    using Base = SslStateMachineAwaitable<detail::SslSingleHandshakeMachine>;
+/**
+ * @brief 单轮握手 + 首个请求，遇到 kHandshakeWantAsync 时停下；progress 记录已随握手写出的字节数
+ */
+struct SslHandshakeSendStepAwaitable
+    : public SslStateMachineAwaitable<detail::SslHandshakeSendMachine> {
+    using Base = SslStateMachineAwaitable<detail::SslHandshakeSendMachine>;
 
-    SslHandshakeAwaitable(IOController* controller, SslSocket* socket)
-        : Base(controller, socket, detail::SslSingleHandshakeMachine{}) {}
+    SslHandshakeSendStepAwaitable(IOController* controller, SslSocket* socket,
+                                  const char* buffer, size_t length, bool early_data = false,
+                                  std::optional<SslError> error = std::nullopt, size_t* progress = nullptr)
+        : Base(controller, socket,
+               detail::SslHandshakeSendMachine(buffer, length, early_data, std::move(error), progress)) {}
 
     using Base::await_ready;
     using Base::await_resume;
     using Base::await_suspend;
+    using Base::timeout;
+};
+
+namespace detail {
+
+/**
+ * @brief 等待后台运算的握手任务与调用方 awaitable 共享的状态
+ *
+ * @details awaitable 先析构（调用方协程被销毁）时清空 handle，任务随后不再推进也不恢复调用方
+ */
+template <typename ResultT>
+struct SslAsyncHandshakeState {
+    std::coroutine_handle<> handle;
+    std::optional<ResultT> result;
+};
+
+/**
+ * @brief 握手 awaitable 的公共部分：上下文没有后台运算时直接等待单轮 step（不分配任务、不经调度器），
+ * 否则在调用方所在调度器上起一个任务逐轮推进，kHandshakeWantAsync 时等待 asyncWaitFd() 后继续
+ *
+ * @details timeout() 限制整个握手，包括等待签名线程、keyless 签名进程或证书加载的时间
+ */
+template <typename DerivedT, typename StepT, typename ResultT>
+class SslAsyncHandshakeAwaitable
+{
+public:
+    using State = SslAsyncHandshakeState<ResultT>;
+
+    SslAsyncHandshakeAwaitable(const SslAsyncHandshakeAwaitable&) = delete;
+    SslAsyncHandshakeAwaitable& operator=(const SslAsyncHandshakeAwaitable&) = delete;
+
+    ~SslAsyncHandshakeAwaitable()
+    {
+        if (m_state) {
+            m_state->handle = nullptr;
+        }
+    }
+
+    bool await_ready() { return !m_async && m_step.await_ready(); }
+
+    template <typename PromiseT>
+    bool await_suspend(std::coroutine_handle<PromiseT> handle)
+    {
+        if (!m_async) {
+            return m_step.await_suspend(handle);
+        }
+        m_state = std::make_shared<State>();
+        m_state->handle = handle;
+        auto context = galay::kernel::detail::makeAwaitContext(handle);
+        if (!scheduleTask(context.scheduler, static_cast<DerivedT*>(this)->start(m_state, m_timeout))) {
+            m_state->result = std::unexpected(SslError(SslErrorCode::kHandshakeFailed));
+            return false;
+        }
+        return true;
+    }
+
+    ResultT await_resume()
+    {
+        if (!m_async) {
+            return m_step.await_resume();
+        }
+        return std::move(*m_state->result);
+    }
+
+protected:
+    template <typename... StepArgs>
+    explicit SslAsyncHandshakeAwaitable(bool async, StepArgs&&... args)
+        : m_step(std::forward<StepArgs>(args)...)
+        , m_async(async)
+    {}
+
+    void setTimeout(std::chrono::milliseconds timeout)
+    {
+        m_timeout = timeout;
+        m_step.timeout(timeout);
+    }
+
+private:
+    StepT m_step;
+    bool m_async;
+    std::optional<std::chrono::milliseconds> m_timeout;
+    std::shared_ptr<State> m_state;
+};
+
+} // namespace detail
+
+/**
+ * @brief SslSocket::handshake() 返回的可等待对象
+ *
+ * @details 普通上下文直接在调用协程上推进握手。上下文开启了 SslContext::asyncHandshake()
+ * （私钥卸载、keyless、证书路由）时，遇到 WantAsync 等待 SslEngine::asyncWaitFd() 后继续，
+ * 调用方只看到成功或真正的失败；timeout() 限制整个握手。
+ */
+class SslHandshakeAwaitable
+    : public detail::SslAsyncHandshakeAwaitable<SslHandshakeAwaitable, SslHandshakeStepAwaitable,
+                                                std::expected<void, SslError>>
+{
+public:
+    SslHandshakeAwaitable(IOController* controller, SslSocket* socket, bool async)
+        : SslAsyncHandshakeAwaitable(async, controller, socket)
+        , m_controller(controller)
+        , m_socket(socket)
+    {}
+
+    SslHandshakeAwaitable& timeout(std::chrono::milliseconds timeout)
+    {
+        setTimeout(timeout);
+        return *this;
+    }
+
+private:
+    friend SslAsyncHandshakeAwaitable;
+
+    Task<void> start(std::shared_ptr<State> state, std::optional<std::chrono::milliseconds> timeout)
+    {
+        return run(std::move(state), m_controller, m_socket, timeout);
+    }
+
+    static Task<void> run(std::shared_ptr<State> state, IOController* controller, SslSocket* socket,
+                          std::optional<std::chrono::milliseconds> timeout);
+
+    IOController* m_controller;
+    SslSocket* m_socket;
+};
+
+/**
+ * @brief SslSocket::handshakeAndSend() / connectAndSend() 返回的可等待对象
+ *
+ * @details 普通上下文直接在调用协程上推进，首个请求随客户端 Finished 写出。上下文开启了
+ * SslContext::asyncHandshake()（如客户端证书私钥卸载）时，遇到 WantAsync 等待 asyncWaitFd()
+ * 后继续握手，再把尚未写出的请求按普通 send 写出；timeout() 限制整个过程。
+ */
+class SslHandshakeSendAwaitable
+    : public detail::SslAsyncHandshakeAwaitable<SslHandshakeSendAwaitable, SslHandshakeSendStepAwaitable,
+                                                std::expected<size_t, SslError>>
+{
+public:
+    SslHandshakeSendAwaitable(IOController* controller, SslSocket* socket, bool async,
+                              const char* buffer, size_t length, bool early_data = false,
+                              std::optional<SslError> error = std::nullopt)
+        : SslAsyncHandshakeAwaitable(async, controller, socket, buffer, length, early_data, error)
+        , m_controller(controller)
+        , m_socket(socket)
+        , m_buffer(buffer)
+        , m_length(length)
+        , m_earlyData(early_data)
+        , m_error(std::move(error))
+    {}
+
+    SslHandshakeSendAwaitable& timeout(std::chrono::milliseconds timeout)
+    {
+        setTimeout(timeout);
+        return *this;
+    }
+
+private:
+    friend SslAsyncHandshakeAwaitable;
+
+    Task<void> start(std::shared_ptr<State> state, std::optional<std::chrono::milliseconds> timeout)
+    {
+        return run(std::move(state), m_controller, m_socket, m_buffer, m_length, m_earlyData, std::move(m_error),
+                   timeout);
+    }
+
+    static Task<void> run(std::shared_ptr<State> state, IOController* controller, SslSocket* socket,
+                          const char* buffer, size_t length, bool early_data, std::optional<SslError> error,
+                          std::optional<std::chrono::milliseconds> timeout);
+
+    IOController* m_controller;
+    SslSocket* m_socket;
+    const char* m_buffer;
+    size_t m_length;
+    bool m_earlyData;
+    std::optional<SslError> m_error;
 };
 
 struct SslShutdownAwaitable : public SslStateMachineAwaitable<detail::SslSingleShutdownMachine> {
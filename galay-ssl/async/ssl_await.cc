@@ -11,6 +11,7 @@ namespace {
 
 constexpr size_t kCipherBufSize = 16384;
 constexpr size_t kMaxDrainBytes = 64 * 1024;
+constexpr size_t kMaxCoalescedBytes = 16 * 1024;  ///< 随握手合并写出的明文上限（一个 TLS 记录）
 
 bool ensureBufferSize(std::vector<char>& buffer, size_t required)
 {
@@ -159,6 +160,45 @@ std::expected<void, SslError> SslOperationDriver::takeShutdownResult()
     return result;
 }
 
+void SslOperationDriver::writeFirstEarlyData()
+{
+    m_handshake.first_early = false;
+    SslEngine& engine = m_socket->m_engine;
+    if (engine.isHandshakeCompleted() || engine.maxEarlyData() == 0) {
+        return;  // session 不允许 0-RTT，请求随 Finished 写出
+    }
+    size_t written = 0;
+    if (engine.writeEarlyData(m_handshake.first_write, m_handshake.first_length, written) == SslIOResult::Success) {
+        m_handshake.first_written = written;
+        m_handshake.first_early_sent = true;
+    }
+}
+
+void SslOperationDriver::coalesceFirstWrite()
+{
+    if (m_handshake.first_write == nullptr) {
+        return;
+    }
+    SslEngine& engine = m_socket->m_engine;
+    if (m_handshake.first_early_sent && engine.earlyDataStatus() != SslEarlyDataStatus::Accepted) {
+        m_handshake.first_written = 0;  // 0-RTT 被拒绝，服务端丢弃了 early data，整段重发
+    }
+    m_handshake.first_early_sent = false;
+
+    // 在 flush 之前加密进同一个输出缓冲，与客户端 Finished 共用一次写
+    const size_t limit = std::min(m_handshake.first_length, m_handshake.first_written + kMaxCoalescedBytes);
+    while (m_handshake.first_written < limit) {
+        size_t written = 0;
+        if (engine.write(m_handshake.first_write + m_handshake.first_written,
+                         limit - m_handshake.first_written, written) != SslIOResult::Success ||
+            written == 0) {
+            break;  // 剩余部分由握手后的 send 写出
+        }
+        m_handshake.first_written += written;
+    }
+    m_handshake.first_write = nullptr;
+}
+
 void SslOperationDriver::setHandshakeFailure(SslError error)
 {
     m_handshake.result = std::unexpected(std::move(error));
@@ -192,7 +232,7 @@ void SslOperationDriver::setShutdownSuccess()
     resetContexts();
 }
 
-void SslOperationDriver::startHandshake()
+void SslOperationDriver::startHandshake(const char* first_write, size_t first_length, bool early_data)
 {
     clearOperation();
     resetHandshakeState();
@@ -200,13 +240,18 @@ void SslOperationDriver::startHandshake()
     resetSendState();
     resetShutdownState();
     m_operation = OperationKind::kHandshake;
+    if (first_write != nullptr && first_length > 0) {
+        m_handshake.first_write = first_write;
+        m_handshake.first_length = first_length;
+        m_handshake.first_early = early_data;
+    }
 
     if (m_socket == nullptr || !m_socket->isValid() || !m_socket->initEngine()) {
         setHandshakeFailure(SslError(SslErrorCode::kHandshakeFailed));
     }
 }
 
-void SslOperationDriver::startRecv(char* buffer, size_t length)
+void SslOperationDriver::startRecv(char* buffer, size_t length, bool early_data)
 {
     clearOperation();
     resetHandshakeState();
@@ -216,6 +261,7 @@ void SslOperationDriver::startRecv(char* buffer, size_t length)
     m_operation = OperationKind::kRecv;
     m_recv.plain_buffer = buffer;
     m_recv.plain_length = length;
+    m_recv.early_data = early_data;
 
     if (m_socket == nullptr || !m_socket->isValid() || !m_socket->m_engineInitialized) {
         setRecvFailure(SslError(SslErrorCode::kReadFailed));
@@ -242,7 +288,7 @@ void SslOperationDriver::startSend(const char* buffer, size_t length)
         setSendFailure(SslError(SslErrorCode::kWriteFailed));
         return;
     }
-    if (length == 0) {
+    if (length == 0 && m_socket->m_engine.pendingEncryptedOutput() == 0) {
         m_send.result = size_t{0};
         m_send.result_set = true;
     }
@@ -301,11 +347,12 @@ SslOperationDriver::RecvPollAction SslOperationDriver::drainRecvPlaintext()
     size_t total_read = 0;
     while (total_read < m_recv.plain_length) {
         size_t bytes_read = 0;
-        const SslIOResult ssl_ret = m_socket->m_engine.read(
-            m_recv.plain_buffer + total_read,
-            m_recv.plain_length - total_read,
-            bytes_read
-        );
+        char* const out = m_recv.plain_buffer + total_read;
+        const size_t room = m_recv.plain_length - total_read;
+        // early data 读完（或未被接受）时返回 ZeroReturn，与对端关闭一样以空结果结束本次读取
+        const SslIOResult ssl_ret = m_recv.early_data
+            ? m_socket->m_engine.readEarlyData(out, room, bytes_read)
+            : m_socket->m_engine.read(out, room, bytes_read);
 
         if (ssl_ret == SslIOResult::Success && bytes_read > 0) {
             total_read += bytes_read;
@@ -431,6 +478,41 @@ bool SslOperationDriver::fillSendChunk()
     }
 }
 
+bool SslOperationDriver::trySendDeferred()
+{
+    SslFlushQueue* queue = m_socket->m_flushQueue;
+    const size_t remaining = m_send.plain_length - m_send.plain_offset;
+    if (!m_socket->m_flushDraining &&
+        m_socket->m_engine.pendingEncryptedOutput() + remaining > queue->m_options.maxPendingBytes) {
+        // 积压过多说明对端读得慢，回退为普通 send 以获得背压；
+        // 排空进行中时回退会与排空任务争用写方向，超限的 send 已在 SslSendAwaitable 中挂起等待排空
+        ++queue->m_stats.fallback_sends;
+        return false;
+    }
+
+    while (m_send.plain_offset < m_send.plain_length) {
+        size_t bytes_written = 0;
+        const SslIOResult ssl_ret = m_socket->m_engine.write(
+            m_send.plain_buffer + m_send.plain_offset,
+            m_send.plain_length - m_send.plain_offset,
+            bytes_written
+        );
+        if (ssl_ret != SslIOResult::Success || bytes_written == 0) {
+            // WantRead（如重协商）与错误都交给普通路径处理，已加密部分保留在 wbio 中
+            ++queue->m_stats.fallback_sends;
+            return false;
+        }
+        m_send.plain_offset += bytes_written;
+    }
+
+    m_send.result = m_send.plain_length;
+    m_send.result_set = true;
+    ++queue->m_stats.deferred_sends;
+    queue->enqueue(m_socket);
+    queue->flushIfDue();
+    return true;
+}
+
 SslOperationDriver::WaitAction SslOperationDriver::poll()
 {
     switch (m_operation) {
@@ -465,9 +547,14 @@ SslOperationDriver::WaitAction SslOperationDriver::pollHandshake()
         return {WaitKind::kRead, &m_recv_context};
     }
 
+    if (m_handshake.first_early) {
+        writeFirstEarlyData();
+    }
+
     const SslIOResult ret = m_socket->m_engine.doHandshake();
     switch (ret) {
     case SslIOResult::Success:
+        coalesceFirstWrite();
         if (m_socket->m_engine.pendingEncryptedOutput() > 0) {
             if (!prepareWriteFromPending(m_handshake_buffer, SslErrorCode::kHandshakeFailed)) {
                 setHandshakeFailure(SslError(SslErrorCode::kHandshakeFailed));
@@ -501,6 +588,19 @@ SslOperationDriver::WaitAction SslOperationDriver::pollHandshake()
             return {};
         }
         return {WaitKind::kRead, &m_recv_context};
+    case SslIOResult::WantAsync:
+        // 私钥运算在签名线程上进行：先发出已产生的握手消息，再由 SslHandshakeAwaitable 等待 async fd
+        if (m_socket->m_engine.pendingEncryptedOutput() > 0) {
+            if (!prepareWriteFromPending(m_handshake_buffer, SslErrorCode::kHandshakeFailed)) {
+                setHandshakeFailure(SslError::fromOpenSSL(SslErrorCode::kHandshakeFailed));
+                return {};
+            }
+            m_handshake.flush_success = false;
+            m_handshake.wait_read_after_write = false;
+            return {WaitKind::kWrite, &m_send_context};
+        }
+        setHandshakeFailure(SslError(SslErrorCode::kHandshakeWantAsync));
+        return {};
     case SslIOResult::ZeroReturn:
         setHandshakeFailure(SslError(SslErrorCode::kPeerClosed));
         return {};
@@ -532,6 +632,13 @@ SslOperationDriver::WaitAction SslOperationDriver::pollRecv()
         }
         return {WaitKind::kWrite, &m_send_context};
     case RecvPollAction::kNeedRecv:
+        if (m_recv.early_data && m_socket->m_engine.pendingEncryptedOutput() > 0) {
+            // 服务端首轮消息必须先发出，客户端收到 Finished 后才会结束 early data
+            if (!prepareRecvSendChunk()) {
+                return {};
+            }
+            return {WaitKind::kWrite, &m_send_context};
+        }
         if (!prepareReadBuffer(m_recv_cipher_buffer)) {
             setRecvFailure(SslError(SslErrorCode::kReadFailed));
             return {};
@@ -559,6 +666,10 @@ SslOperationDriver::WaitAction SslOperationDriver::pollSend()
     if (m_send_context.m_length > 0) {
         return {WaitKind::kWrite, &m_send_context};
     }
+    // 零长度 send 用于写出积压，不走延迟路径
+    if (m_socket->m_flushQueue != nullptr && m_send.plain_length > 0 && trySendDeferred()) {
+        return {};
+    }
     if (fillSendChunk()) {
         return {WaitKind::kWrite, &m_send_context};
     }
@@ -609,6 +720,7 @@ SslOperationDriver::WaitAction SslOperationDriver::pollShutdown()
             return {};
         }
         return {WaitKind::kRead, &m_recv_context};
+    case SslIOResult::WantAsync:
     case SslIOResult::Syscall:
     case SslIOResult::Error:
         setShutdownSuccess();
@@ -15,6 +15,25 @@
 #include <utility>
 #include <vector>
 
+/**
+ * @brief SSL 状态机 awaitable 编译的后端入口
+ *
+ * @details 单后端构建只编译对应的一组 SequenceAwaitableBase 钩子；开启 GALAY_SSL_DUAL_BACKEND
+ * （同时定义 USE_IOURING 与 USE_EPOLL）时两组钩子同时编译，同一二进制可在运行时按调度器类型选择后端。
+ * 两组钩子都只是薄适配层，真正的推进逻辑在 completeActiveTask() / pump() 中共享。
+ */
+#if defined(USE_IOURING)
+#define GALAY_SSL_HAS_IOURING_PATH 1
+#else
+#define GALAY_SSL_HAS_IOURING_PATH 0
+#endif
+
+#if !defined(USE_IOURING) || defined(USE_EPOLL)
+#define GALAY_SSL_HAS_REACTOR_PATH 1
+#else
+#define GALAY_SSL_HAS_REACTOR_PATH 0
+#endif
+
 namespace galay::ssl
 {
 
@@ -39,6 +58,7 @@ struct SslMachineAction {
     size_t read_length = 0;
     const char* write_buffer = nullptr;
     size_t write_length = 0;
+    bool early_data = false;
     std::optional<ResultT> result;
     std::optional<SslError> error;
 
@@ -54,6 +74,19 @@ struct SslMachineAction {
         return action;
     }
 
+    /**
+     * @brief 握手并把首个请求随客户端最后一轮握手报文写出
+     * @param early_data session 允许时先把请求作为 0-RTT early data 随 ClientHello 发出
+     */
+    static SslMachineAction handshakeWithWrite(const char* buffer, size_t length, bool early_data = false)
+    {
+        SslMachineAction action = handshake();
+        action.write_buffer = buffer;
+        action.write_length = length;
+        action.early_data = early_data;
+        return action;
+    }
+
     static SslMachineAction recv(char* buffer, size_t length)
     {
         SslMachineAction action;
@@ -63,6 +96,13 @@ struct SslMachineAction {
         return action;
     }
 
+    static SslMachineAction recvEarly(char* buffer, size_t length)
+    {
+        SslMachineAction action = recv(buffer, length);
+        action.early_data = true;
+        return action;
+    }
+
     static SslMachineAction send(const char* buffer, size_t length)
     {
         SslMachineAction action;
@@ -265,8 +305,8 @@ public:
 
     explicit SslOperationDriver(SslSocket* socket);
 
-    void startHandshake();
-    void startRecv(char* buffer, size_t length);
+    void startHandshake(const char* first_write = nullptr, size_t first_length = 0, bool early_data = false);
+    void startRecv(char* buffer, size_t length, bool early_data = false);
     void startSend(const char* buffer, size_t length);
     void startShutdown();
 
@@ -277,6 +317,7 @@ public:
     bool completed() const;
 
     std::expected<void, SslError> takeHandshakeResult();
+    size_t handshakeWritten() const { return m_handshake.first_written; }
     std::expected<Bytes, SslError> takeRecvResult();
     std::expected<size_t, SslError> takeSendResult();
     std::expected<void, SslError> takeShutdownResult();
@@ -324,8 +365,11 @@ private:
     bool prepareWriteFromPending(std::vector<char>& buffer, SslErrorCode error_code);
     bool prepareRecvSendChunk();
     bool fillSendChunk();
+    bool trySendDeferred();
     RecvPollAction drainRecvPlaintext();
 
+    void writeFirstEarlyData();
+    void coalesceFirstWrite();
     void setHandshakeFailure(SslError error);
     void setRecvFailure(SslError error);
     void setSendFailure(SslError error);
@@ -343,11 +387,17 @@ private:
         bool flush_success = false;
         bool wait_read_after_write = false;
         bool read_pending = false;
+        const char* first_write = nullptr;  ///< 随握手写出的首个请求
+        size_t first_length = 0;
+        size_t first_written = 0;           ///< 已交给引擎加密的字节数
+        bool first_early = false;           ///< 尚未尝试以 early data 写出
+        bool first_early_sent = false;      ///< 已作为 early data 写出
     } m_handshake;
 
     struct RecvState {
         char* plain_buffer = nullptr;
         size_t plain_length = 0;
+        bool early_data = false;    ///< 握手完成前读取 TLS 1.3 early data
         bool result_set = false;
         std::expected<Bytes, SslError> result{};
     } m_recv;
@@ -479,7 +529,7 @@ public:
         }
     }
 
-#ifdef USE_IOURING
+#if GALAY_SSL_HAS_IOURING_PATH
     SequenceProgress prepareForSubmit() override
     {
         return pump();
@@ -490,28 +540,20 @@ public:
         if (!m_has_active_task) {
             return pump();
         }
-        if (m_active_kind == ActiveKind::kRead) {
-            if (!m_driver.recvContext().handleComplete(cqe, handle)) {
-                return SequenceProgress::kNeedWait;
-            }
-            auto io_result = std::move(m_driver.recvContext().m_result);
-            clearActiveTask();
-            m_driver.onRead(std::move(io_result));
-            return pump();
-        }
-        if (m_active_kind == ActiveKind::kWrite) {
-            if (!m_driver.sendContext().handleComplete(cqe, handle)) {
-                return SequenceProgress::kNeedWait;
-            }
-            auto io_result = std::move(m_driver.sendContext().m_result);
-            clearActiveTask();
-            m_driver.onWrite(std::move(io_result));
+        switch (completeActiveTask(cqe, handle)) {
+        case ActiveStep::kWaiting:
+            return SequenceProgress::kNeedWait;
+        case ActiveStep::kAdvanced:
             return pump();
+        case ActiveStep::kInvalid:
+            break;
         }
         setFailure(SslError(SslErrorCode::kUnknown));
         return SequenceProgress::kCompleted;
     }
-#else
+#endif
+
+#if GALAY_SSL_HAS_REACTOR_PATH
     SequenceProgress prepareForSubmit(GHandle handle) override
     {
         for (size_t i = 0; i < kInlineTransitionCap; ++i) {
@@ -522,23 +564,13 @@ public:
             if (!m_has_active_task) {
                 return SequenceProgress::kCompleted;
             }
-            if (m_active_kind == ActiveKind::kRead) {
-                if (!m_driver.recvContext().handleComplete(handle)) {
-                    return SequenceProgress::kNeedWait;
-                }
-                auto io_result = std::move(m_driver.recvContext().m_result);
-                clearActiveTask();
-                m_driver.onRead(std::move(io_result));
-                continue;
-            }
-            if (m_active_kind == ActiveKind::kWrite) {
-                if (!m_driver.sendContext().handleComplete(handle)) {
-                    return SequenceProgress::kNeedWait;
-                }
-                auto io_result = std::move(m_driver.sendContext().m_result);
-                clearActiveTask();
-                m_driver.onWrite(std::move(io_result));
+            switch (completeActiveTask(handle)) {
+            case ActiveStep::kWaiting:
+                return SequenceProgress::kNeedWait;
+            case ActiveStep::kAdvanced:
                 continue;
+            case ActiveStep::kInvalid:
+                break;
             }
             setFailure(SslError(SslErrorCode::kUnknown));
             return SequenceProgress::kCompleted;
@@ -553,23 +585,13 @@ public:
         if (!m_has_active_task) {
             return prepareForSubmit(handle);
         }
-        if (m_active_kind == ActiveKind::kRead) {
-            if (!m_driver.recvContext().handleComplete(handle)) {
-                return SequenceProgress::kNeedWait;
-            }
-            auto io_result = std::move(m_driver.recvContext().m_result);
-            clearActiveTask();
-            m_driver.onRead(std::move(io_result));
-            return prepareForSubmit(handle);
-        }
-        if (m_active_kind == ActiveKind::kWrite) {
-            if (!m_driver.sendContext().handleComplete(handle)) {
-                return SequenceProgress::kNeedWait;
-            }
-            auto io_result = std::move(m_driver.sendContext().m_result);
-            clearActiveTask();
-            m_driver.onWrite(std::move(io_result));
+        switch (completeActiveTask(handle)) {
+        case ActiveStep::kWaiting:
+            return SequenceProgress::kNeedWait;
+        case ActiveStep::kAdvanced:
             return prepareForSubmit(handle);
+        case ActiveStep::kInvalid:
+            break;
         }
         setFailure(SslError(SslErrorCode::kUnknown));
         return SequenceProgress::kCompleted;
@@ -583,6 +605,12 @@ private:
         kWrite,
     };
 
+    enum class ActiveStep : uint8_t {
+        kWaiting,   ///< 后端尚未完成当前 IO
+        kAdvanced,  ///< IO 结果已交给 driver，可以继续推进
+        kInvalid,   ///< 没有可完成的活动任务
+    };
+
     static constexpr size_t kInlineTransitionCap = 64;
 
     static SslError bridgeSequenceError(const IOError& error)
@@ -636,10 +664,41 @@ private:
         m_active_kind = ActiveKind::kNone;
     }
 
+    /**
+     * @brief 后端无关的活动任务完成逻辑
+     * @param args 透传给 IO 上下文 handleComplete() 的后端参数（io_uring 为 cqe + handle，reactor 为 handle）
+     */
+    template <typename... BackendArgs>
+    ActiveStep completeActiveTask(BackendArgs... args)
+    {
+        if (m_active_kind == ActiveKind::kRead) {
+            if (!m_driver.recvContext().handleComplete(args...)) {
+                return ActiveStep::kWaiting;
+            }
+            auto io_result = std::move(m_driver.recvContext().m_result);
+            clearActiveTask();
+            m_driver.onRead(std::move(io_result));
+            return ActiveStep::kAdvanced;
+        }
+        if (m_active_kind == ActiveKind::kWrite) {
+            if (!m_driver.sendContext().handleComplete(args...)) {
+                return ActiveStep::kWaiting;
+            }
+            auto io_result = std::move(m_driver.sendContext().m_result);
+            clearActiveTask();
+            m_driver.onWrite(std::move(io_result));
+            return ActiveStep::kAdvanced;
+        }
+        return ActiveStep::kInvalid;
+    }
+
     void deliverDriverResult()
     {
         switch (m_running_signal) {
         case SslMachineSignal::kHandshake:
+            if constexpr (requires { m_machine.onHandshakeWrite(size_t{}); }) {
+                m_machine.onHandshakeWrite(m_driver.handshakeWritten());
+            }
             m_machine.onHandshake(m_driver.takeHandshakeResult());
             break;
         case SslMachineSignal::kRecv:
@@ -665,7 +724,7 @@ private:
             return SequenceProgress::kNeedWait;
         case SslMachineSignal::kHandshake:
             m_running_signal = SslMachineSignal::kHandshake;
-            m_driver.startHandshake();
+            m_driver.startHandshake(action.write_buffer, action.write_length, action.early_data);
             return SequenceProgress::kNeedWait;
         case SslMachineSignal::kRecv:
             if (action.read_buffer == nullptr && action.read_length != 0) {
@@ -673,7 +732,7 @@ private:
                 return SequenceProgress::kCompleted;
             }
             m_running_signal = SslMachineSignal::kRecv;
-            m_driver.startRecv(action.read_buffer, action.read_length);
+            m_driver.startRecv(action.read_buffer, action.read_length, action.early_data);
             return SequenceProgress::kNeedWait;
         case SslMachineSignal::kSend:
             if (action.write_buffer == nullptr && action.write_length != 0) {
@@ -803,18 +862,94 @@ struct SslSingleHandshakeMachine {
     std::optional<result_type> m_result;
 };
 
+/**
+ * @brief 握手 + 首个请求：请求尽量随客户端 Finished（或 0-RTT 时随 ClientHello）写出，
+ * 未能合并的剩余部分在握手后按普通 send 写出
+ */
+struct SslHandshakeSendMachine {
+    using result_type = std::expected<size_t, SslError>;
+
+    SslHandshakeSendMachine(const char* buffer, size_t length, bool early_data = false,
+                            std::optional<SslError> error = std::nullopt, size_t* progress = nullptr)
+        : m_buffer(buffer)
+        , m_length(length)
+        , m_early_data(early_data)
+        , m_error(std::move(error))
+        , m_progress(progress) {}
+
+    SslMachineAction<result_type> advance()
+    {
+        if (m_result.has_value()) {
+            return SslMachineAction<result_type>::complete(std::move(*m_result));
+        }
+        if (m_error.has_value()) {
+            return SslMachineAction<result_type>::fail(std::move(*m_error));
+        }
+        if (!m_handshake_done) {
+            return SslMachineAction<result_type>::handshakeWithWrite(m_buffer, m_length, m_early_data);
+        }
+        if (m_written < m_length) {
+            return SslMachineAction<result_type>::send(m_buffer + m_written, m_length - m_written);
+        }
+        return SslMachineAction<result_type>::complete(m_length);
+    }
+
+    void onHandshakeWrite(size_t written)
+    {
+        m_written = written;
+        if (m_progress != nullptr) {
+            *m_progress = written;
+        }
+    }
+
+    void onHandshake(std::expected<void, SslError> result)
+    {
+        if (!result) {
+            m_result = std::unexpected(result.error());
+            return;
+        }
+        m_handshake_done = true;
+    }
+
+    void onRecv(std::expected<Bytes, SslError>) {}
+
+    void onSend(std::expected<size_t, SslError> result)
+    {
+        if (!result) {
+            m_result = std::unexpected(result.error());
+            return;
+        }
+        m_result = m_written + result.value();
+    }
+
+    void onShutdown(std::expected<void, SslError>) {}
+
+    const char* m_buffer = nullptr;
+    size_t m_length = 0;
+    size_t m_written = 0;
+    bool m_early_data = false;
+    bool m_handshake_done = false;
+    std::optional<SslError> m_error;
+    size_t* m_progress = nullptr;   ///< 握手中已写出字节数的外部记录（等待后台运算后继续时使用）
+    std::optional<result_type> m_result;
+};
+
 struct SslSingleRecvMachine {
     using result_type = std::expected<Bytes, SslError>;
 
-    SslSingleRecvMachine(char* buffer, size_t length)
+    SslSingleRecvMachine(char* buffer, size_t length, bool early_data = false)
         : m_buffer(buffer)
-        , m_length(length) {}
+        , m_length(length)
+        , m_early_data(early_data) {}
 
     SslMachineAction<result_type> advance()
     {
         if (m_result.has_value()) {
             return SslMachineAction<result_type>::complete(std::move(*m_result));
         }
+        if (m_early_data) {
+            return SslMachineAction<result_type>::recvEarly(m_buffer, m_length);
+        }
         return SslMachineAction<result_type>::recv(m_buffer, m_length);
     }
 
@@ -825,6 +960,7 @@ struct SslSingleRecvMachine {
 
     char* m_buffer = nullptr;
     size_t m_length = 0;
+    bool m_early_data = false;
     std::optional<result_type> m_result;
 };
 
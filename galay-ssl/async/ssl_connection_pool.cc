@@ -0,0 +1,318 @@
+#include "ssl_connection_pool.h"
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <functional>
+
+namespace galay::ssl
+{
+
+namespace {
+
+constexpr size_t kAbsorbBufSize = 4096;
+
+void hashCombine(size_t& seed, size_t value)
+{
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+} // anonymous namespace
+
+size_t SslPoolKeyHash::operator()(const SslPoolKey& key) const
+{
+    size_t seed = std::hash<std::string>{}(key.host);
+    hashCombine(seed, std::hash<uint16_t>{}(key.port));
+    hashCombine(seed, std::hash<std::string>{}(key.sni));
+    hashCombine(seed, std::hash<const void*>{}(key.ctx));
+    return seed;
+}
+
+SslConnectionPool::SslConnectionPool(IOScheduler* scheduler, SslConnectionPoolOptions options)
+    : m_scheduler(scheduler)
+    , m_options(options)
+{
+    m_options.maxColdDials = std::max<size_t>(1, m_options.maxColdDials);
+    m_options.minIdlePerKey = std::min(m_options.minIdlePerKey, m_options.maxIdlePerKey);
+}
+
+SslConnectionPool::~SslConnectionPool()
+{
+    for (auto& [key, target] : m_targets) {
+        target->pool = nullptr;
+        for (auto& entry : target->idle) {
+            if (entry.socket->handle().fd >= 0) {
+                ::close(entry.socket->handle().fd);
+            }
+        }
+        target->idle.clear();
+        // 等待者看到 pool 为空后直接返回错误；进行中的建连由其协程持有的 Target 引用收尾
+        wakeAll(*target);
+    }
+}
+
+Task<SslConnectionPool::AcquireResult> SslConnectionPool::acquire(SslContext* ctx, Host host, std::string sni)
+{
+    SslPoolKey key{std::string(host.ip()), host.port(), std::move(sni), ctx};
+    std::shared_ptr<Target> target = targetFor(key, host);
+    attachSessionCache(ctx);
+
+    for (;;) {
+        if (auto socket = takeIdle(*target, Clock::now())) {
+            ++m_stats.hits;
+            refill(key, *target);
+            co_return SslPooledConnection{std::move(socket), std::move(key), true};
+        }
+        if (mayDial(*target)) {
+            break;
+        }
+        ++m_stats.waits;
+        co_await WaitAwaitable{target.get()};
+        if (target->pool == nullptr) {
+            co_return std::unexpected(SslError(SslErrorCode::kConnectFailed));
+        }
+    }
+
+    auto dialed = co_await dial(key, target);
+    if (!dialed) {
+        co_return std::unexpected(dialed.error());
+    }
+    co_return SslPooledConnection{std::move(*dialed), std::move(key), false};
+}
+
+void SslConnectionPool::release(SslPooledConnection connection, bool reusable)
+{
+    if (!connection.socket) {
+        return;
+    }
+    auto it = m_targets.find(connection.key);
+    if (!reusable || it == m_targets.end() || !connection.socket->isHandshakeCompleted()) {
+        discard(std::move(connection.socket));
+        return;
+    }
+    putIdle(*it->second, std::move(connection.socket));
+}
+
+size_t SslConnectionPool::prewarm(SslContext* ctx, const Host& host, const std::string& sni, size_t count)
+{
+    SslPoolKey key{std::string(host.ip()), host.port(), sni, ctx};
+    std::shared_ptr<Target> target = targetFor(key, host);
+    attachSessionCache(ctx);
+
+    const size_t wanted = std::min(count == 0 ? m_options.minIdlePerKey : count, m_options.maxIdlePerKey);
+    const size_t have = target->idle.size() + target->warming;
+    size_t started = 0;
+    for (size_t i = have; i < wanted; ++i) {
+        ++target->warming;
+        if (!scheduleTask(m_scheduler, warmOne(key, target))) {
+            --target->warming;
+            break;
+        }
+        ++started;
+    }
+    return started;
+}
+
+size_t SslConnectionPool::evictExpired(Clock::time_point now)
+{
+    size_t evicted = 0;
+    for (auto& [key, target] : m_targets) {
+        auto expired = [&](const IdleConnection& entry) {
+            return now - entry.since >= m_options.idleTimeout;
+        };
+        auto first = std::stable_partition(target->idle.begin(), target->idle.end(),
+                                           [&](const IdleConnection& entry) { return !expired(entry); });
+        for (auto it = first; it != target->idle.end(); ++it) {
+            discard(std::move(it->socket));
+            ++evicted;
+        }
+        target->idle.erase(first, target->idle.end());
+    }
+    m_stats.evicted += evicted;
+    return evicted;
+}
+
+size_t SslConnectionPool::idle() const
+{
+    size_t total = 0;
+    for (const auto& [key, target] : m_targets) {
+        total += target->idle.size();
+    }
+    return total;
+}
+
+SslConnectionPoolStats SslConnectionPool::stats() const
+{
+    SslConnectionPoolStats result = m_stats;
+    result.idle = idle();
+    return result;
+}
+
+std::shared_ptr<SslConnectionPool::Target> SslConnectionPool::targetFor(const SslPoolKey& key, const Host& host)
+{
+    auto [it, inserted] = m_targets.try_emplace(key);
+    if (inserted) {
+        it->second = std::make_shared<Target>();
+        it->second->pool = this;
+        it->second->host = host;
+    }
+    return it->second;
+}
+
+bool SslConnectionPool::mayDial(const Target& target) const
+{
+    // 冷目标只放行少量建连，其余等待其 session 以便恢复握手
+    return target.warm || target.connecting < m_options.maxColdDials;
+}
+
+std::unique_ptr<SslSocket> SslConnectionPool::takeIdle(Target& target, Clock::time_point now)
+{
+    while (!target.idle.empty()) {
+        IdleConnection entry = std::move(target.idle.back());
+        target.idle.pop_back();
+        if (now - entry.since < m_options.idleTimeout && absorbPending(*entry.socket)) {
+            return std::move(entry.socket);
+        }
+        ++m_stats.evicted;
+        discard(std::move(entry.socket));
+    }
+    return nullptr;
+}
+
+void SslConnectionPool::putIdle(Target& target, std::unique_ptr<SslSocket> socket)
+{
+    if (target.idle.size() >= m_options.maxIdlePerKey || !absorbPending(*socket)) {
+        discard(std::move(socket));
+        return;
+    }
+    target.idle.push_back({std::move(socket), Clock::now()});
+    wakeAll(target);
+}
+
+void SslConnectionPool::refill(const SslPoolKey& key, Target& target)
+{
+    if (m_options.minIdlePerKey > 0 && target.idle.size() + target.warming < m_options.minIdlePerKey) {
+        (void)prewarm(key.ctx, target.host, key.sni);
+    }
+}
+
+void SslConnectionPool::attachSessionCache(SslContext* ctx)
+{
+    // 默认不改动调用方的上下文，只有显式开启时才挂接连接池的缓存
+    if (!m_options.attachSessionCache || !ctx || ctx->clientSessionCache()) {
+        return;
+    }
+    if (!m_sessions) {
+        m_sessions = std::make_shared<SslClientSessionCache>();
+    }
+    ctx->setClientSessionCache(m_sessions);
+}
+
+void SslConnectionPool::discard(std::unique_ptr<SslSocket> socket)
+{
+    if (!socket || socket->handle().fd < 0) {
+        return;
+    }
+    const int fd = socket->handle().fd;
+    if (!scheduleTask(m_scheduler, closeSocket(std::move(socket)))) {
+        ::close(fd);
+    }
+}
+
+void SslConnectionPool::wakeAll(Target& target)
+{
+    // 先取出等待队列再恢复：被恢复的协程可能立即重新排队
+    std::deque<std::coroutine_handle<>> waiters;
+    waiters.swap(target.waiters);
+    for (auto handle : waiters) {
+        handle.resume();
+    }
+}
+
+Task<SslConnectionPool::DialResult> SslConnectionPool::dial(SslPoolKey key, std::shared_ptr<Target> target)
+{
+    ++target->connecting;
+    ++m_stats.dials;
+
+    const IPType type = target->host.sockAddr()->sa_family == AF_INET6 ? IPType::IPV6 : IPType::IPV4;
+    auto socket = std::make_unique<SslSocket>(key.ctx, type);
+    std::expected<size_t, SslError> connected = std::unexpected(SslError(SslErrorCode::kConnectFailed));
+    if (socket->isValid() && (key.sni.empty() || socket->setHostname(key.sni))) {
+        SslConnectOptions options;
+        options.fastOpen = m_options.fastOpen;
+        connected = co_await socket->connectAndSend(target->host, nullptr, 0, options);
+    }
+    --target->connecting;
+
+    if (target->pool == nullptr) {
+        // 连接池已在建连期间析构：只收尾本连接，不再访问连接池
+        if (socket->handle().fd >= 0) {
+            co_await socket->close();
+        }
+        co_return std::unexpected(SslError(SslErrorCode::kConnectFailed));
+    }
+    if (!connected) {
+        ++m_stats.failures;
+        wakeAll(*target);
+        if (socket->handle().fd >= 0) {
+            co_await socket->close();
+        }
+        co_return std::unexpected(connected.error());
+    }
+
+    if (socket->isSessionReused()) {
+        ++m_stats.resumed;
+    }
+    // 已随握手到达的 NewSessionTicket 先交给客户端缓存，等待者随后建连即可恢复
+    (void)absorbPending(*socket);
+    target->warm = true;
+    wakeAll(*target);
+    co_return std::move(socket);
+}
+
+Task<void> SslConnectionPool::warmOne(SslPoolKey key, std::shared_ptr<Target> target)
+{
+    while (target->pool != nullptr && !mayDial(*target)) {
+        co_await WaitAwaitable{target.get()};
+    }
+    if (target->pool == nullptr) {
+        co_return;
+    }
+    auto dialed = co_await dial(key, target);
+    --target->warming;
+    if (dialed && target->pool != nullptr) {
+        putIdle(*target, std::move(*dialed));
+    }
+}
+
+Task<void> SslConnectionPool::closeSocket(std::unique_ptr<SslSocket> socket)
+{
+    co_await socket->close();
+}
+
+bool SslConnectionPool::absorbPending(SslSocket& socket)
+{
+    const int fd = socket.handle().fd;
+    SslEngine* engine = socket.engine();
+    char cipher[kAbsorbBufSize];
+    for (;;) {
+        const ssize_t n = ::recv(fd, cipher, sizeof(cipher), MSG_DONTWAIT);
+        if (n == 0) {
+            return false;  // 对端已关闭
+        }
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        if (engine->feedEncryptedInput(cipher, static_cast<size_t>(n)) != static_cast<int>(n)) {
+            return false;
+        }
+        char plain[256];
+        size_t bytes_read = 0;
+        // 只有 ticket / KeyUpdate 等握手后消息是预期的：读出应用数据说明协议状态已不同步
+        if (engine->read(plain, sizeof(plain), bytes_read) != SslIOResult::WantRead) {
+            return false;
+        }
+    }
+}
+
+} // namespace galay::ssl
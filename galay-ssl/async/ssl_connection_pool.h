@@ -0,0 +1,226 @@
+#ifndef GALAY_SSL_CONNECTION_POOL_H
+#define GALAY_SSL_CONNECTION_POOL_H
+
+#include "galay-ssl/common/error.h"
+#include "galay-ssl/ssl/ssl_client_session_cache.h"
+#include "ssl_socket.h"
+#include <galay-kernel/common/host.hpp>
+#include <galay-kernel/kernel/io_scheduler.hpp>
+#include <galay-kernel/kernel/task.h>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 连接池的目标 key：对端地址 + SNI + 上下文
+ */
+struct SslPoolKey {
+    std::string host;               ///< 对端 IP
+    uint16_t port = 0;              ///< 对端端口
+    std::string sni;                ///< SNI，空表示不发送
+    SslContext* ctx = nullptr;      ///< 建连使用的客户端上下文（不拥有）
+
+    bool operator==(const SslPoolKey&) const = default;
+};
+
+struct SslPoolKeyHash {
+    size_t operator()(const SslPoolKey& key) const;
+};
+
+/**
+ * @brief 连接池配置
+ */
+struct SslConnectionPoolOptions {
+    size_t maxIdlePerKey = 16;                  ///< 每个目标最多保留的空闲连接，超出的归还直接关闭
+    size_t minIdlePerKey = 0;                   ///< 预热目标：prewarm() 默认补足到该数量，取走空闲连接后后台补足
+    size_t maxColdDials = 1;                    ///< 目标尚未成功建连过时同时进行的建连数，其余请求等待其结果
+    std::chrono::seconds idleTimeout{30};       ///< 空闲连接的最长保留时间
+    bool fastOpen = false;                      ///< 新建连接时使用 TCP Fast Open
+    bool attachSessionCache = false;            ///< 上下文未挂接客户端 session 缓存时挂接连接池自己的缓存
+                                                ///< （会修改调用方的 SslContext）
+};
+
+/**
+ * @brief 连接池统计
+ */
+struct SslConnectionPoolStats {
+    uint64_t hits = 0;          ///< 直接取到空闲连接的次数
+    uint64_t dials = 0;         ///< 新建连接次数（含预热）
+    uint64_t resumed = 0;       ///< 新建连接中恢复了 session 的次数
+    uint64_t waits = 0;         ///< 因 single-flight 等待首个建连的次数
+    uint64_t failures = 0;      ///< 建连或握手失败次数
+    uint64_t evicted = 0;       ///< 超时或健康检查失败而关闭的空闲连接数
+    size_t idle = 0;            ///< 当前空闲连接数
+};
+
+/**
+ * @brief 从连接池取出的连接
+ *
+ * @details 使用完毕后交还 SslConnectionPool::release()；直接析构只会丢弃对象而不关闭 socket。
+ */
+struct SslPooledConnection {
+    std::unique_ptr<SslSocket> socket;
+    SslPoolKey key;
+    bool reused = false;        ///< 是否来自空闲连接（false 表示本次新建）
+
+    SslSocket* operator->() const { return socket.get(); }
+    SslSocket& operator*() const { return *socket; }
+    explicit operator bool() const { return socket != nullptr; }
+};
+
+/**
+ * @brief 已握手 TLS 客户端连接池
+ *
+ * @details 按 (host, port, SNI, SslContext) 保存空闲且已完成握手的 SslSocket：
+ * - acquire() 优先取空闲连接（LIFO），取出前做超时与健康检查：非阻塞读出已到达的记录交给引擎，
+ *   处理 TLS 1.3 NewSessionTicket，遇到对端关闭、close_notify 或未预期的应用数据则丢弃该连接
+ * - 没有空闲连接时用 SslSocket::connectAndSend() 新建；目标尚未成功建连过时最多
+ *   maxColdDials 个建连同时进行，其余请求等待首个结果，随后的建连即可恢复其 session
+ * - 连接池不修改调用方的上下文；上下文挂接了 SslClientSessionCache 时新建连接自动恢复 session，
+ *   也可以开启 attachSessionCache 让连接池为未挂接缓存的上下文挂接自己的缓存
+ * - prewarm() 在后台建立连接放入空闲列表
+ *
+ * @example
+ * @code
+ * SslConnectionPool pool(scheduler, {.minIdlePerKey = 4});
+ * pool.prewarm(&ctx, Host(IPType::IPV4, "10.0.0.8", 443), "api.example.com");
+ *
+ * auto conn = co_await pool.acquire(&ctx, Host(IPType::IPV4, "10.0.0.8", 443), "api.example.com");
+ * if (conn) {
+ *     co_await (*conn)->send(request.data(), request.size());
+ *     auto reply = co_await (*conn)->recv(buffer, sizeof(buffer));
+ *     pool.release(std::move(*conn), reply.has_value());
+ * }
+ * @endcode
+ *
+ * @note
+ * - 连接池与其连接属于同一个 IO 调度器线程，不做加锁，必须在该线程上析构
+ * - 归还前应确保请求/响应已完整收发，连接上不能残留未读的应用数据
+ * - 析构时直接关闭空闲连接的 fd，不发送 close_notify；挂起等待的 acquire() 立即返回 kConnectFailed，
+ *   进行中的建连与预热完成后自行关闭连接，不再访问连接池
+ */
+class SslConnectionPool
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using AcquireResult = std::expected<SslPooledConnection, SslError>;
+
+    explicit SslConnectionPool(IOScheduler* scheduler, SslConnectionPoolOptions options = {});
+    ~SslConnectionPool();
+
+    SslConnectionPool(const SslConnectionPool&) = delete;
+    SslConnectionPool& operator=(const SslConnectionPool&) = delete;
+
+    /**
+     * @brief 取出一个已握手的连接
+     *
+     * @param ctx 客户端上下文
+     * @param host 对端地址
+     * @param sni SNI，空表示不发送
+     * @return 成功返回连接；新建失败返回建连 / 握手错误
+     */
+    Task<AcquireResult> acquire(SslContext* ctx, Host host, std::string sni = {});
+
+    /**
+     * @brief 归还连接
+     *
+     * @param connection acquire() 返回的连接
+     * @param reusable false 表示连接状态不可信（如请求出错），直接关闭
+     */
+    void release(SslPooledConnection connection, bool reusable = true);
+
+    /**
+     * @brief 在后台为目标建立连接，补足到 count 个空闲连接
+     *
+     * @param count 目标空闲数，0 表示使用 minIdlePerKey
+     * @return 本次发起的建连数
+     */
+    size_t prewarm(SslContext* ctx, const Host& host, const std::string& sni = {}, size_t count = 0);
+
+    /**
+     * @brief 关闭超过 idleTimeout 的空闲连接
+     * @return 关闭的连接数
+     */
+    size_t evictExpired(Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 当前空闲连接总数
+     */
+    size_t idle() const;
+
+    /**
+     * @brief 统计快照
+     */
+    SslConnectionPoolStats stats() const;
+
+    const SslConnectionPoolOptions& options() const { return m_options; }
+
+private:
+    struct IdleConnection {
+        std::unique_ptr<SslSocket> socket;
+        Clock::time_point since;
+    };
+
+    struct Target {
+        SslConnectionPool* pool = nullptr;              ///< 所属连接池，连接池析构后为 nullptr
+        Host host;
+        std::vector<IdleConnection> idle;               ///< 尾部为最近归还
+        std::deque<std::coroutine_handle<>> waiters;    ///< 等待 single-flight 建连结果的协程
+        size_t connecting = 0;                          ///< 进行中的建连数
+        size_t warming = 0;                             ///< 进行中的预热建连数
+        bool warm = false;                              ///< 是否已成功建连过
+    };
+
+    /**
+     * @brief 挂起直到目标的建连完成或有连接归还
+     */
+    struct WaitAwaitable {
+        Target* target;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { target->waiters.push_back(handle); }
+        void await_resume() const noexcept {}
+    };
+
+    using DialResult = std::expected<std::unique_ptr<SslSocket>, SslError>;
+
+    std::shared_ptr<Target> targetFor(const SslPoolKey& key, const Host& host);
+    bool mayDial(const Target& target) const;
+    std::unique_ptr<SslSocket> takeIdle(Target& target, Clock::time_point now);
+    void putIdle(Target& target, std::unique_ptr<SslSocket> socket);
+    void refill(const SslPoolKey& key, Target& target);
+    void attachSessionCache(SslContext* ctx);
+    void discard(std::unique_ptr<SslSocket> socket);
+    void wakeAll(Target& target);
+
+    // 建连与预热协程持有 Target 的引用：连接池析构后它们仍可能被恢复，恢复后先检查 target->pool
+    Task<DialResult> dial(SslPoolKey key, std::shared_ptr<Target> target);
+    Task<void> warmOne(SslPoolKey key, std::shared_ptr<Target> target);
+    Task<void> closeSocket(std::unique_ptr<SslSocket> socket);
+
+    /**
+     * @brief 非阻塞读出空闲连接上已到达的记录交给引擎
+     * @return false 表示连接已不可复用
+     */
+    static bool absorbPending(SslSocket& socket);
+
+    IOScheduler* m_scheduler;
+    SslConnectionPoolOptions m_options;
+    std::shared_ptr<SslClientSessionCache> m_sessions;
+    std::unordered_map<SslPoolKey, std::shared_ptr<Target>, SslPoolKeyHash> m_targets;
+    SslConnectionPoolStats m_stats;
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_CONNECTION_POOL_H
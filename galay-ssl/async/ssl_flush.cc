@@ -0,0 +1,338 @@
+#include "ssl_flush.h"
+#include "ssl_socket.h"
+#include <galay-kernel/common/sleep.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <sys/socket.h>
+
+namespace galay::ssl
+{
+
+namespace {
+
+/**
+ * @brief 截止期限定时器的最短睡眠
+ */
+constexpr std::chrono::milliseconds kTimerTick{1};
+
+} // namespace
+
+SslFlushQueue::SslFlushQueue(SslFlushOptions options)
+    : m_options(options)
+{}
+
+SslFlushQueue::SslFlushQueue(IOScheduler* scheduler, SslFlushOptions options)
+    : m_scheduler(scheduler)
+    , m_options(options)
+{
+    // 截止期限由毫秒级定时器触发，更短的 maxDelay 无法兑现，按定时器精度处理
+    m_options.maxDelay = std::max<std::chrono::microseconds>(m_options.maxDelay, kTimerTick);
+}
+
+SslFlushQueue::~SslFlushQueue()
+{
+    *m_alive = false;
+    detachAll();
+}
+
+void SslFlushQueue::enqueue(SslSocket* socket)
+{
+    if (socket == nullptr || socket->m_flushSlot != kNotQueued) {
+        return;
+    }
+
+    // 排空中的连接不参与截止期限，只有第一个待 flush 的连接开始计时
+    if (m_sockets.size() == m_draining) {
+        m_oldest = Clock::now();
+    }
+    if (socket->m_flushDraining) {
+        ++m_draining;
+    }
+    socket->m_flushSlot = m_sockets.size();
+    m_sockets.push_back(socket);
+    armTimer();
+}
+
+void SslFlushQueue::remove(SslSocket* socket)
+{
+    if (socket == nullptr || socket->m_flushSlot == kNotQueued) {
+        return;
+    }
+
+    const size_t slot = socket->m_flushSlot;
+    if (slot < m_sockets.size() && m_sockets[slot] == socket) {
+        m_sockets[slot] = m_sockets.back();
+        m_sockets[slot]->m_flushSlot = slot;
+        m_sockets.pop_back();
+        if (socket->m_flushDraining) {
+            --m_draining;
+        }
+    }
+    socket->m_flushSlot = kNotQueued;
+
+    if (m_sockets.size() == m_draining) {
+        m_oldest = Clock::time_point::max();
+    }
+}
+
+void SslFlushQueue::rebind(SslSocket* from, SslSocket* to)
+{
+    const size_t slot = to->m_flushSlot;
+    if (slot != kNotQueued && slot < m_sockets.size() && m_sockets[slot] == from) {
+        m_sockets[slot] = to;
+    }
+}
+
+void SslFlushQueue::detachAll()
+{
+    for (SslSocket* socket : m_sockets) {
+        socket->m_flushSlot = kNotQueued;
+        socket->m_flushQueue = nullptr;
+    }
+    m_sockets.clear();
+    m_draining = 0;
+    m_oldest = Clock::time_point::max();
+}
+
+bool SslFlushQueue::flushSocket(SslSocket* socket, size_t& written)
+{
+    const int fd = socket->m_controller.m_handle.fd;
+    if (fd < 0) {
+        return true;
+    }
+
+    while (true) {
+        const char* data = nullptr;
+        const size_t pending = socket->m_engine.peekEncryptedOutput(&data);
+        if (pending == 0) {
+            return true;
+        }
+
+        const ssize_t n = ::send(fd, data, pending, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            const size_t sent = static_cast<size_t>(n);
+            socket->m_engine.consumeEncryptedOutput(sent);
+            written += sent;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            ++m_stats.would_block;
+            return false;
+        }
+
+        // 连接级错误不在这里上抛：密文保留在引擎中，由该连接的下一次 IO 得到真实错误
+        ++m_stats.errors;
+        return true;
+    }
+}
+
+size_t SslFlushQueue::flush()
+{
+    ++m_stats.flushes;
+    if (m_sockets.empty()) {
+        return 0;
+    }
+
+    size_t written = 0;
+    size_t keep = 0;
+    std::vector<SslSocket*> blocked;
+    for (size_t i = 0; i < m_sockets.size(); ++i) {
+        SslSocket* socket = m_sockets[i];
+        // 排空任务持有的密文副本尚未写完，这里直接写 wbio 会打乱顺序
+        if (!socket->m_flushDraining) {
+            ++m_stats.flushed_sockets;
+            if (flushSocket(socket, written)) {
+                socket->m_flushSlot = kNotQueued;
+                continue;
+            }
+            if (m_scheduler != nullptr) {
+                blocked.push_back(socket);
+            }
+        }
+        socket->m_flushSlot = keep;
+        m_sockets[keep++] = socket;
+    }
+    m_sockets.resize(keep);
+    m_stats.flushed_bytes += written;
+    for (SslSocket* socket : blocked) {
+        startDrain(socket);
+    }
+
+    // 仍有积压的连接从本次 flush 起重新计时，避免下一轮立刻被判定为超期
+    m_oldest = m_sockets.size() == m_draining ? Clock::time_point::max() : Clock::now();
+    return written;
+}
+
+bool SslFlushQueue::flushIfDue(Clock::time_point now)
+{
+    if (m_sockets.empty() || now < deadline()) {
+        return false;
+    }
+    flush();
+    return true;
+}
+
+SslFlushQueue::Clock::time_point SslFlushQueue::deadline() const
+{
+    if (m_sockets.size() == m_draining) {
+        return Clock::time_point::max();
+    }
+    return m_oldest + m_options.maxDelay;
+}
+
+void SslFlushQueue::armTimer()
+{
+    if (m_scheduler != nullptr && !m_timerRunning) {
+        m_timerRunning = scheduleTask(m_scheduler, deadlineLoop(m_alive));
+    }
+}
+
+void SslFlushQueue::startDrain(SslSocket* socket)
+{
+    auto state = std::make_shared<SslFlushDrain>();
+    state->socket = socket;
+    state->scheduler = m_scheduler;
+    state->limit = m_options.maxPendingBytes;
+    socket->m_drain = state;
+    socket->m_flushDraining = true;
+    if (!scheduleTask(m_scheduler, drain(m_alive, std::move(state)))) {
+        // 投递失败时留在队列里，下一次 flush 再试
+        socket->m_drain.reset();
+        socket->m_flushDraining = false;
+        return;
+    }
+    ++m_draining;
+    ++m_stats.drains;
+}
+
+Task<void> SslFlushQueue::deadlineLoop(std::shared_ptr<bool> alive)
+{
+    for (;;) {
+        const auto due = deadline();
+        if (due == Clock::time_point::max()) {
+            m_timerRunning = false;
+            co_return;
+        }
+        co_await galay::kernel::sleep(
+            std::max(kTimerTick, std::chrono::ceil<std::chrono::milliseconds>(due - Clock::now())));
+        if (!*alive) {
+            co_return;
+        }
+        flushIfDue();
+    }
+}
+
+Task<void> SslFlushQueue::drain(std::shared_ptr<bool> alive, std::shared_ptr<SslFlushDrain> state)
+{
+    std::expected<size_t, SslError> result = 0;
+    size_t admitted = 0;
+    // 零长度 send 经连接自身的写路径写出积压：写缓冲区满时等待可写，排空期间追加的密文一并写出；
+    // 每轮写完后把挂起的超限 send 代为入队，积压因此始终受上限约束
+    while (state->socket != nullptr) {
+        result = co_await state->socket->send(nullptr, 0);
+        if (state->socket == nullptr || !result || state->waiters.empty()) {
+            break;
+        }
+        admitted += admitWaiters(*state);
+        resumeWaiters(*state);
+    }
+
+    SslSocket* socket = state->socket;
+    if (socket != nullptr) {
+        // 连接可能已换绑到其他队列；remove() 按排空状态维护所在队列的计数，所以先于清除标志
+        SslFlushQueue* queue = socket->m_flushQueue;
+        if (queue != nullptr) {
+            queue->remove(socket);
+        }
+        socket->m_flushDraining = false;
+        socket->m_drain.reset();
+        state->socket = nullptr;
+        if (queue != nullptr && socket->m_engine.pendingEncryptedOutput() > 0) {
+            // 写完到恢复之间又有延迟 send 追加的密文，交回给队列
+            queue->enqueue(socket);
+        }
+    }
+    if (*alive) {
+        m_stats.drain_waits += admitted;
+        if (!result) {
+            // 与 flushSocket() 相同，连接级错误留给该连接的下一次 IO
+            ++m_stats.errors;
+        }
+    }
+
+    // 写出失败时仍在等待的 send 不再有机会入队
+    for (SslFlushDrain::Waiter* waiter : state->waiters) {
+        waiter->result = std::unexpected(SslError(SslErrorCode::kWriteFailed));
+        state->waking.push_back(waiter);
+    }
+    state->waiters.clear();
+    resumeWaiters(*state);
+}
+
+void SslFlushQueue::abandon(const std::shared_ptr<SslFlushDrain>& state)
+{
+    state->socket = nullptr;
+    for (SslFlushDrain::Waiter* waiter : state->waiters) {
+        waiter->result = std::unexpected(SslError(SslErrorCode::kWriteFailed));
+        state->waking.push_back(waiter);
+    }
+    state->waiters.clear();
+    // 不在 close() / 析构的调用栈里内联恢复；投递失败时由排空任务结束时恢复
+    if (!state->waking.empty() && state->scheduler != nullptr) {
+        scheduleTask(state->scheduler, resumeLater(state));
+    }
+}
+
+Task<void> SslFlushQueue::resumeLater(std::shared_ptr<SslFlushDrain> state)
+{
+    resumeWaiters(*state);
+    co_return;
+}
+
+size_t SslFlushQueue::admitWaiters(SslFlushDrain& state)
+{
+    SslSocket* socket = state.socket;
+    size_t admitted = 0;
+    while (!state.waiters.empty()) {
+        SslFlushDrain::Waiter* waiter = state.waiters.front();
+        const size_t pending = socket->m_engine.pendingEncryptedOutput();
+        if (pending > 0 && pending + waiter->length > state.limit) {
+            break;
+        }
+        state.waiters.pop_front();
+        ++admitted;
+
+        size_t offset = 0;
+        while (offset < waiter->length) {
+            size_t bytes_written = 0;
+            const SslIOResult ret = socket->m_engine.write(waiter->buffer + offset, waiter->length - offset,
+                                                           bytes_written);
+            if (ret != SslIOResult::Success || bytes_written == 0) {
+                break;
+            }
+            offset += bytes_written;
+        }
+        if (offset < waiter->length) {
+            waiter->result = std::unexpected(SslError::fromOpenSSL(SslErrorCode::kWriteFailed));
+        } else {
+            waiter->result = waiter->length;
+        }
+        state.waking.push_back(waiter);
+    }
+    return admitted;
+}
+
+void SslFlushQueue::resumeWaiters(SslFlushDrain& state)
+{
+    while (!state.waking.empty()) {
+        SslFlushDrain::Waiter* waiter = state.waking.front();
+        state.waking.erase(state.waking.begin());
+        // 恢复后该 send 所在的协程帧可能随即销毁，或连接被关闭；之后只经 state 访问
+        waiter->handle.resume();
+    }
+}
+
+} // namespace galay::ssl
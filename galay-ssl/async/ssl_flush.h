@@ -0,0 +1,214 @@
+#ifndef GALAY_SSL_FLUSH_H
+#define GALAY_SSL_FLUSH_H
+
+#include "galay-ssl/common/error.h"
+#include <galay-kernel/kernel/io_scheduler.hpp>
+#include <galay-kernel/kernel/task.h>
+#include <chrono>
+#include <cstddef>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <memory>
+#include <vector>
+
+namespace galay::ssl
+{
+
+using namespace galay::kernel;
+
+class SslSocket;
+
+/**
+ * @brief 延迟刷写配置
+ */
+struct SslFlushOptions {
+    /// 密文在队列中的最长停留时间（flush 截止期限）；以调度器构造队列时按定时器精度（1 ms）向上取整
+    std::chrono::microseconds maxDelay{200};
+    size_t maxPendingBytes = 256 * 1024;         ///< 单连接允许积压的密文上限，超过后回退为普通 send
+};
+
+/**
+ * @brief 延迟刷写统计
+ */
+struct SslFlushStats {
+    uint64_t deferred_sends = 0;    ///< 以延迟模式完成的 send 次数
+    uint64_t fallback_sends = 0;    ///< 因积压超限回退为普通 send 的次数
+    uint64_t flushes = 0;           ///< flush() 调用次数
+    uint64_t flushed_sockets = 0;   ///< 被 flush 处理过的连接次数
+    uint64_t flushed_bytes = 0;     ///< flush 实际写出的密文字节数
+    uint64_t would_block = 0;       ///< 写缓冲区已满、留待下次 flush（或转为等待可写）的次数
+    uint64_t drains = 0;            ///< 写缓冲区已满后转为等待可写、经连接自身写路径写出的次数
+    uint64_t drain_waits = 0;       ///< 排空进行中积压超限、挂起到排空写出后才入队的 send 次数
+    uint64_t errors = 0;            ///< 写出失败次数（错误留给该连接的下一次 IO 处理）
+};
+
+/**
+ * @brief 一次排空的共享状态，由排空任务、连接与挂起等待排空的 send 共同持有
+ *
+ * @details 连接关闭、析构时把 socket 置空，排空任务恢复后不再访问它；连接移动时随之更新。
+ */
+struct SslFlushDrain {
+    /**
+     * @brief 积压超限、等待排空的 send，节点位于 SslSendAwaitable 中
+     */
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        const char* buffer = nullptr;
+        size_t length = 0;
+        std::expected<size_t, SslError> result = 0;
+    };
+
+    SslSocket* socket = nullptr;        ///< 正在排空的连接；关闭或析构后为空
+    IOScheduler* scheduler = nullptr;   ///< 排空所在调度器，用于取消后恢复等待者
+    size_t limit = 0;                   ///< 积压上限（队列的 maxPendingBytes）
+    std::deque<Waiter*> waiters;        ///< 按到达顺序等待入队的 send
+    std::vector<Waiter*> waking;        ///< 已有结果、尚未恢复的 send
+};
+
+/**
+ * @brief 跨连接延迟刷写队列
+ *
+ * @details 绑定到 SslFlushQueue 的 SslSocket 执行 send() 时只把明文加密进引擎的 wbio，
+ * 不再为每个 awaitable 单独提交写请求；连接被登记到队列中，由 flush() 在一次调度循环末尾
+ * 逐个连接以非阻塞 ::send 写出。省下的是每次 send 的等待与调度开销，不是系统调用：
+ * 每个连接仍各自 ::send，写出后已发送的密文从 wbio 按块读出丢弃，并非零拷贝。
+ * 适用于“一个事件触发成百上千个 TLS 连接写出”的广播场景。
+ *
+ * 以调度器构造时，队列自己负责截止期限与写缓冲区已满后的续写：有积压时一个定时任务睡到
+ * deadline() 后执行 flushIfDue()，定时器精度为 1 ms，因此 maxDelay 不足 1 ms 时按 1 ms 处理（延迟 send 入队时
+ * 仍会顺带检查截止期限）；flush() 遇到写缓冲区已满的连接，改为在该连接上发起一次零长度 send()，
+ * 由连接自身的写路径等待可写并写完积压。排空期间新的延迟 send 在上限内照常追加到同一积压中，
+ * 会使积压超过 maxPendingBytes 的 send 挂起，等本轮积压写完后由排空任务代为加密入队再恢复。
+ * 不带调度器构造时两者都由调用方负责：按 deadline() 调用 flush()，积压留待下次 flush。
+ *
+ * @example
+ * @code
+ * SslFlushQueue queue({.maxDelay = std::chrono::microseconds(500)});
+ * for (auto& peer : peers) {
+ *     peer.setFlushQueue(&queue);
+ * }
+ * // 一次事件中向所有连接写出
+ * for (auto& peer : peers) {
+ *     co_await peer.send(msg.data(), msg.size());   // 立即完成，仅加密入队
+ * }
+ * queue.flush();                                     // 一次批量写出
+ * @endcode
+ *
+ * @note
+ * - 队列与其登记的 SslSocket 必须属于同一个 IO 调度器线程，不做加锁
+ * - 写缓冲区已满时剩余密文保留在引擎中，连接留在队列等待下一次 flush（或可写后由排空写出）；
+ *   之后在该连接上发起的普通 IO 也会先写出这些密文，顺序不会被打乱
+ * - 排空进行中（SslSocket::flushDraining()）相当于该连接上有一个 send 在途：不要在该连接上 shutdown()
+ *   或移动连接；close() 与析构会取消排空、丢弃未写出的密文，挂起等待排空的 send 以 kWriteFailed 恢复
+ * - 队列必须比绑定到它的连接活得更久；析构时只解除仍在队列中的连接，且不会自动 flush；
+ *   析构后残留的定时任务与排空任务不再访问它
+ */
+class SslFlushQueue
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit SslFlushQueue(SslFlushOptions options = {});
+
+    /**
+     * @param scheduler 队列所属调度器：截止期限由定时任务触发，写缓冲区已满的连接等待可写后写出
+     */
+    explicit SslFlushQueue(IOScheduler* scheduler, SslFlushOptions options = {});
+
+    ~SslFlushQueue();
+
+    SslFlushQueue(const SslFlushQueue&) = delete;
+    SslFlushQueue& operator=(const SslFlushQueue&) = delete;
+
+    /**
+     * @brief 逐个写出所有已登记连接的密文（排空进行中的连接除外）
+     * @return 本次写出的密文字节数
+     */
+    size_t flush();
+
+    /**
+     * @brief 若最早登记的密文已到截止期限则执行 flush()
+     * @param now 当前时间
+     * @return 是否执行了 flush
+     */
+    bool flushIfDue(Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 当前队列的 flush 截止时间；没有待 flush 的连接（为空或都在排空）时返回 time_point::max()
+     */
+    Clock::time_point deadline() const;
+
+    /**
+     * @brief 已登记、等待写出的连接数
+     */
+    size_t size() const { return m_sockets.size(); }
+
+    /**
+     * @brief 队列是否为空
+     */
+    bool empty() const { return m_sockets.empty(); }
+
+    /**
+     * @brief 获取配置
+     */
+    const SslFlushOptions& options() const { return m_options; }
+
+    /**
+     * @brief 获取统计
+     */
+    const SslFlushStats& stats() const { return m_stats; }
+
+private:
+    friend class SslSocket;
+    friend class SslOperationDriver;
+
+    static constexpr size_t kNotQueued = static_cast<size_t>(-1);
+
+    void enqueue(SslSocket* socket);
+    void remove(SslSocket* socket);
+    void rebind(SslSocket* from, SslSocket* to);
+    void detachAll();
+
+    /**
+     * @brief 写出单个连接的密文
+     * @return true 表示该连接的密文已全部写出
+     */
+    bool flushSocket(SslSocket* socket, size_t& written);
+
+    void armTimer();
+    void startDrain(SslSocket* socket);
+    Task<void> deadlineLoop(std::shared_ptr<bool> alive);
+    Task<void> drain(std::shared_ptr<bool> alive, std::shared_ptr<SslFlushDrain> state);
+
+    /**
+     * @brief 把等待排空的 send 按到达顺序加密进引擎，积压达到上限时停下（积压为空时至少接纳一个）
+     * @return 接纳的 send 个数
+     */
+    static size_t admitWaiters(SslFlushDrain& state);
+
+    /**
+     * @brief 逐个恢复已有结果的 send；恢复期间节点可能被销毁并自行摘除
+     */
+    static void resumeWaiters(SslFlushDrain& state);
+
+    /**
+     * @brief 连接关闭或析构时放弃排空：等待中的 send 以 kWriteFailed 投递到调度器恢复
+     */
+    static void abandon(const std::shared_ptr<SslFlushDrain>& state);
+    static Task<void> resumeLater(std::shared_ptr<SslFlushDrain> state);
+
+    IOScheduler* m_scheduler = nullptr;
+    SslFlushOptions m_options;
+    SslFlushStats m_stats;
+    std::shared_ptr<bool> m_alive = std::make_shared<bool>(true);
+    std::vector<SslSocket*> m_sockets;
+    size_t m_draining = 0;          ///< m_sockets 中排空进行中的连接数
+    bool m_timerRunning = false;
+    Clock::time_point m_oldest{Clock::time_point::max()};
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_FLUSH_H
@@ -0,0 +1,300 @@
+#include "ssl_handshake_admission.h"
+#include <galay-kernel/common/sleep.hpp>
+#include <algorithm>
+
+namespace galay::ssl
+{
+
+namespace {
+
+/**
+ * @brief 自适应模式两次减小上限之间的最短间隔，避免同一波延迟被重复惩罚
+ */
+constexpr std::chrono::milliseconds kDecreaseInterval{10};
+
+/**
+ * @brief 排队定时器的最短睡眠；只剩投递失败的节点待重投时按该间隔重试
+ */
+constexpr std::chrono::milliseconds kTimerTick{1};
+
+} // namespace
+
+// ==================== SslHandshakePermit ====================
+
+SslHandshakePermit::SslHandshakePermit(SslHandshakePermit&& other) noexcept
+    : m_admission(other.m_admission)
+{
+    other.m_admission = nullptr;
+}
+
+SslHandshakePermit& SslHandshakePermit::operator=(SslHandshakePermit&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_admission = other.m_admission;
+        other.m_admission = nullptr;
+    }
+    return *this;
+}
+
+void SslHandshakePermit::release()
+{
+    if (SslHandshakeAdmission* admission = m_admission) {
+        m_admission = nullptr;
+        admission->release();
+    }
+}
+
+// ==================== SslAdmissionAwaitable ====================
+
+SslAdmissionAwaitable::~SslAdmissionAwaitable()
+{
+    // 协程在排队或等待恢复时被销毁：不能把悬空的节点留给准入对象
+    if (m_waiter.state != Waiter::State::Idle) {
+        m_admission->cancel(&m_waiter);
+    }
+}
+
+bool SslAdmissionAwaitable::await_ready()
+{
+    m_admission->shedExpired(Clock::now());
+    if (m_admission->tryAdmit()) {
+        m_waiter.admitted = true;
+        return true;
+    }
+    if (m_admission->m_queue.size() >= m_admission->m_options.maxQueued) {
+        m_admission->m_shed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void SslAdmissionAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+    m_waiter.handle = handle;
+    m_waiter.enqueued = Clock::now();
+    m_admission->enqueue(&m_waiter);
+}
+
+std::expected<SslHandshakePermit, SslError> SslAdmissionAwaitable::await_resume()
+{
+    if (!m_waiter.admitted) {
+        return std::unexpected(SslError(SslErrorCode::kHandshakeShed));
+    }
+    return SslHandshakePermit(m_admission);
+}
+
+// ==================== SslHandshakeAdmission ====================
+
+SslHandshakeAdmission::SslHandshakeAdmission(IOScheduler* scheduler, SslHandshakeAdmissionOptions options)
+    : m_scheduler(scheduler)
+    , m_options(options)
+{
+    m_options.maxInflight = std::max<size_t>(1, m_options.maxInflight);
+    m_options.minInflight = std::clamp<size_t>(m_options.minInflight, 1, m_options.maxInflight);
+    m_limit = m_options.maxInflight;
+    m_limitSnapshot.store(m_limit, std::memory_order_relaxed);
+}
+
+SslHandshakeAdmission::~SslHandshakeAdmission()
+{
+    *m_alive = false;
+}
+
+bool SslHandshakeAdmission::tryAdmit()
+{
+    // 有人排队时新来的握手也排到队尾，保持先来先得
+    if (!m_queue.empty() || m_inflight >= m_limit) {
+        return false;
+    }
+    ++m_inflight;
+    m_admitted.fetch_add(1, std::memory_order_relaxed);
+    m_inflightSnapshot.store(m_inflight, std::memory_order_relaxed);
+    return true;
+}
+
+void SslHandshakeAdmission::enqueue(Waiter* waiter)
+{
+    waiter->state = Waiter::State::Queued;
+    m_queue.push_back(waiter);
+    m_queuedTotal.fetch_add(1, std::memory_order_relaxed);
+    m_queuedSnapshot.store(m_queue.size(), std::memory_order_relaxed);
+    armTimer();
+}
+
+void SslHandshakeAdmission::cancel(Waiter* waiter)
+{
+    if (waiter->state == Waiter::State::Queued) {
+        m_queue.erase(std::find(m_queue.begin(), m_queue.end(), waiter));
+        m_queuedSnapshot.store(m_queue.size(), std::memory_order_relaxed);
+    } else {
+        m_waking.erase(std::find(m_waking.begin(), m_waking.end(), waiter));
+        // 名额已经记在它名下，却再也不会有许可去归还
+        if (waiter->admitted) {
+            release();
+        }
+    }
+    waiter->state = Waiter::State::Idle;
+}
+
+void SslHandshakeAdmission::release()
+{
+    if (m_inflight > 0) {
+        --m_inflight;
+    }
+    dispatch();
+}
+
+void SslHandshakeAdmission::dispatch()
+{
+    repost();
+    shedExpired(Clock::now());
+    while (m_inflight < m_limit && !m_queue.empty()) {
+        Waiter* waiter = m_queue.front();
+        m_queue.pop_front();
+        ++m_inflight;
+        m_admitted.fetch_add(1, std::memory_order_relaxed);
+        waiter->admitted = true;
+        wake(waiter);
+    }
+    m_inflightSnapshot.store(m_inflight, std::memory_order_relaxed);
+    m_queuedSnapshot.store(m_queue.size(), std::memory_order_relaxed);
+}
+
+void SslHandshakeAdmission::shedExpired(Clock::time_point now)
+{
+    // 队列按入队时间有序，只需检查队首
+    bool changed = false;
+    while (!m_queue.empty() && now - m_queue.front()->enqueued >= m_options.queueTimeout) {
+        Waiter* waiter = m_queue.front();
+        m_queue.pop_front();
+        m_shed.fetch_add(1, std::memory_order_relaxed);
+        waiter->admitted = false;
+        wake(waiter);
+        changed = true;
+    }
+    if (changed) {
+        m_queuedSnapshot.store(m_queue.size(), std::memory_order_relaxed);
+    }
+}
+
+void SslHandshakeAdmission::wake(Waiter* waiter)
+{
+    waiter->state = Waiter::State::Waking;
+    waiter->woken = Clock::now();
+    waiter->ticket = ++m_nextTicket;
+    m_waking.push_back(waiter);
+    post(waiter);
+}
+
+void SslHandshakeAdmission::post(Waiter* waiter)
+{
+    // 投递到调度器队尾，不在 release()/dispatch() 的调用栈里内联恢复
+    waiter->posted = scheduleTask(m_scheduler, resumeWaiter(m_alive, waiter, waiter->ticket));
+    if (!waiter->posted) {
+        armTimer();
+    }
+}
+
+void SslHandshakeAdmission::repost()
+{
+    for (Waiter* waiter : m_waking) {
+        if (!waiter->posted) {
+            post(waiter);
+        }
+    }
+}
+
+void SslHandshakeAdmission::armTimer()
+{
+    if (!m_timerRunning) {
+        m_timerRunning = scheduleTask(m_scheduler, shedLoop(m_alive));
+    }
+}
+
+Task<void> SslHandshakeAdmission::resumeWaiter(std::shared_ptr<bool> alive, Waiter* waiter, uint64_t ticket)
+{
+    if (!*alive) {
+        co_return;
+    }
+    // 节点所在的协程帧可能已被销毁（cancel() 已把它摘掉），或同一地址上已是新的节点
+    auto it = std::find(m_waking.begin(), m_waking.end(), waiter);
+    if (it == m_waking.end() || waiter->ticket != ticket) {
+        co_return;
+    }
+    m_waking.erase(it);
+    waiter->state = Waiter::State::Idle;
+    observe(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - waiter->woken));
+    // 恢复后 waiter 所在的协程帧可能随即销毁，之后不再访问
+    waiter->handle.resume();
+}
+
+Task<void> SslHandshakeAdmission::shedLoop(std::shared_ptr<bool> alive)
+{
+    for (;;) {
+        // 睡到队首的截止时间；队列已空时只剩待重投的节点
+        auto wait = kTimerTick;
+        if (!m_queue.empty()) {
+            const auto deadline = m_queue.front()->enqueued + m_options.queueTimeout;
+            wait = std::max(kTimerTick, std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now()));
+        }
+        co_await galay::kernel::sleep(wait);
+        if (!*alive) {
+            co_return;
+        }
+        dispatch();
+        const bool unposted = std::any_of(m_waking.begin(), m_waking.end(), [](Waiter* w) { return !w->posted; });
+        if (m_queue.empty() && !unposted) {
+            m_timerRunning = false;
+            co_return;
+        }
+    }
+}
+
+void SslHandshakeAdmission::observeLoopLatency(std::chrono::microseconds latency)
+{
+    observe(std::chrono::duration_cast<std::chrono::nanoseconds>(latency));
+}
+
+void SslHandshakeAdmission::observe(std::chrono::nanoseconds latency)
+{
+    // EWMA，权重 1/8
+    m_latency = m_latency.count() == 0 ? latency : m_latency + (latency - m_latency) / 8;
+    m_latencySnapshotUs.store(std::chrono::duration_cast<std::chrono::microseconds>(m_latency).count(),
+                              std::memory_order_relaxed);
+    if (!m_options.adaptive) {
+        return;
+    }
+
+    const auto now = Clock::now();
+    const auto target = std::chrono::duration_cast<std::chrono::nanoseconds>(m_options.targetLatency);
+    if (m_latency > target) {
+        if (m_limit > m_options.minInflight && now - m_lastAdjust >= kDecreaseInterval) {
+            m_limit = std::max(m_options.minInflight, m_limit - std::max<size_t>(1, m_limit / 4));
+            m_lastAdjust = now;
+            m_limitSnapshot.store(m_limit, std::memory_order_relaxed);
+        }
+        return;
+    }
+    const bool binding = !m_queue.empty() || m_inflight >= m_limit;
+    if (m_latency < target / 2 && binding && m_limit < m_options.maxInflight) {
+        ++m_limit;
+        m_limitSnapshot.store(m_limit, std::memory_order_relaxed);
+        dispatch();
+    }
+}
+
+SslHandshakeAdmissionStats SslHandshakeAdmission::stats() const
+{
+    SslHandshakeAdmissionStats result;
+    result.admitted = m_admitted.load(std::memory_order_relaxed);
+    result.queuedTotal = m_queuedTotal.load(std::memory_order_relaxed);
+    result.shed = m_shed.load(std::memory_order_relaxed);
+    result.inflight = m_inflightSnapshot.load(std::memory_order_relaxed);
+    result.queued = m_queuedSnapshot.load(std::memory_order_relaxed);
+    result.limit = m_limitSnapshot.load(std::memory_order_relaxed);
+    result.loopLatency = std::chrono::microseconds(m_latencySnapshotUs.load(std::memory_order_relaxed));
+    return result;
+}
+
+} // namespace galay::ssl
@@ -0,0 +1,247 @@
+#ifndef GALAY_SSL_HANDSHAKE_ADMISSION_H
+#define GALAY_SSL_HANDSHAKE_ADMISSION_H
+
+#include "galay-ssl/common/error.h"
+#include <galay-kernel/kernel/io_scheduler.hpp>
+#include <galay-kernel/kernel/task.h>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <memory>
+#include <vector>
+
+namespace galay::ssl
+{
+
+using namespace galay::kernel;
+
+class SslHandshakeAdmission;
+
+/**
+ * @brief 握手准入配置
+ */
+struct SslHandshakeAdmissionOptions {
+    size_t maxInflight = 64;                            ///< 同时进行的握手上限（自适应模式下为上界）
+    size_t maxQueued = 1024;                            ///< 排队上限，排满后新握手直接丢弃；0 表示满额即丢弃
+    std::chrono::milliseconds queueTimeout{1000};       ///< 排队超过该时长的握手被丢弃（由排队定时器检查）
+    bool adaptive = false;                              ///< 按事件循环延迟自动调整并发上限
+    size_t minInflight = 4;                             ///< 自适应模式下并发上限的下界
+    std::chrono::microseconds targetLatency{2000};      ///< 自适应模式的事件循环延迟目标
+};
+
+/**
+ * @brief 握手准入统计
+ */
+struct SslHandshakeAdmissionStats {
+    uint64_t admitted = 0;                      ///< 获得许可的握手数（含排队后获得）
+    uint64_t queuedTotal = 0;                   ///< 曾进入排队的握手数
+    uint64_t shed = 0;                          ///< 被丢弃的握手数（排队已满或排队超时）
+    size_t inflight = 0;                        ///< 持有许可、正在握手的连接数
+    size_t queued = 0;                          ///< 正在排队的握手数
+    size_t limit = 0;                           ///< 当前并发上限
+    std::chrono::microseconds loopLatency{0};   ///< 事件循环延迟的平滑估计
+};
+
+/**
+ * @brief 握手许可，析构或 release() 时归还并唤醒下一个排队的握手
+ */
+class SslHandshakePermit
+{
+public:
+    SslHandshakePermit() = default;
+    ~SslHandshakePermit() { release(); }
+
+    SslHandshakePermit(SslHandshakePermit&& other) noexcept;
+    SslHandshakePermit& operator=(SslHandshakePermit&& other) noexcept;
+    SslHandshakePermit(const SslHandshakePermit&) = delete;
+    SslHandshakePermit& operator=(const SslHandshakePermit&) = delete;
+
+    /**
+     * @brief 提前归还许可（握手完成后即可归还，不必等连接关闭）
+     */
+    void release();
+
+    bool valid() const { return m_admission != nullptr; }
+
+private:
+    friend class SslHandshakeAdmission;
+    friend class SslAdmissionAwaitable;
+
+    explicit SslHandshakePermit(SslHandshakeAdmission* admission)
+        : m_admission(admission)
+    {}
+
+    SslHandshakeAdmission* m_admission = nullptr;
+};
+
+/**
+ * @brief SslHandshakeAdmission::acquire() 返回的可等待对象
+ *
+ * @details 有空闲名额且无人排队时不挂起；否则进入排队，名额释放后经调度器恢复。
+ * 排队已满或排队超时返回 kHandshakeShed。挂起中的协程被销毁时，析构把自己从队列中摘除；
+ * 已获得名额但尚未恢复时一并归还名额。
+ */
+class SslAdmissionAwaitable
+{
+public:
+    ~SslAdmissionAwaitable();
+
+    SslAdmissionAwaitable(const SslAdmissionAwaitable&) = delete;
+    SslAdmissionAwaitable& operator=(const SslAdmissionAwaitable&) = delete;
+
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> handle);
+    std::expected<SslHandshakePermit, SslError> await_resume();
+
+private:
+    friend class SslHandshakeAdmission;
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 排队节点，位于挂起协程的帧内
+     */
+    struct Waiter {
+        enum class State {
+            Idle,       ///< 未挂起或已恢复
+            Queued,     ///< 在 m_queue 中排队
+            Waking,     ///< 已出队、等待调度器恢复
+        };
+
+        std::coroutine_handle<> handle;
+        Clock::time_point enqueued;
+        Clock::time_point woken;
+        uint64_t ticket = 0;        ///< 每次唤醒递增，恢复任务据此确认节点仍是当初那一个
+        State state = State::Idle;
+        bool admitted = false;
+        bool posted = false;        ///< 恢复任务已投递到调度器
+    };
+
+    explicit SslAdmissionAwaitable(SslHandshakeAdmission* admission)
+        : m_admission(admission)
+    {}
+
+    SslHandshakeAdmission* m_admission;
+    Waiter m_waiter;
+};
+
+/**
+ * @brief 单调度器的握手准入控制
+ *
+ * @details 连接风暴下大量新握手与已建立连接平等竞争调度器，握手的非对称运算把已有连接的
+ * 尾延迟拉高。准入控制限制同一调度器上同时进行的握手数：超出上限的握手在排队中等待
+ * （此时尚未分配 SSL 对象、不占 CPU），排队已满或等待过久时直接丢弃。
+ *
+ * 名额释放后，下一个排队的握手不在释放处内联恢复，而是经 scheduleTask() 作为新任务投递到
+ * 调度器队尾。这里没有真正的优先级：投递时已经排在队列中的任务（包括已就绪的数据连接 IO）
+ * 先于被唤醒的握手执行，之后才就绪的 IO 则按调度器的正常顺序与握手竞争，握手开始后也不会被抢占。
+ * 投递失败时不内联恢复，节点留在唤醒列表中，由下一次准入决策或排队定时器重新投递。
+ * 投递到实际恢复之间的间隔即事件循环延迟，自适应模式据此按 AIMD 调整上限：
+ * 平滑延迟超过 targetLatency 时乘性减小，低于一半且上限正在生效时加一。
+ *
+ * 队列非空时有一个定时任务睡到队首的截止时间，丢弃超时的排队者，
+ * 因此没有新的申请或归还时排队超时也会按时生效。
+ *
+ * @example
+ * @code
+ * SslHandshakeAdmission admission(scheduler, {.maxInflight = 32, .adaptive = true});
+ *
+ * Task<void> serve(SslContext* ctx, GHandle handle) {
+ *     auto permit = co_await admission.acquire();
+ *     SslSocket conn(ctx, handle);
+ *     if (!permit) {                       // kHandshakeShed
+ *         co_await conn.close();
+ *         co_return;
+ *     }
+ *     auto handshake = co_await conn.handshake();
+ *     permit->release();
+ *     ...
+ * }
+ * @endcode
+ *
+ * @note
+ * - 与 SslFlushQueue 相同，acquire() 与许可的归还必须在构造时给定的调度器线程上进行；
+ *   stats() 可在任意线程读取
+ * - 准入对象必须比所有许可与排队中的协程活得更久；析构后残留的定时任务与恢复任务不再访问它
+ */
+class SslHandshakeAdmission
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param scheduler 所属调度器，排队的握手经它恢复
+     */
+    explicit SslHandshakeAdmission(IOScheduler* scheduler, SslHandshakeAdmissionOptions options = {});
+
+    ~SslHandshakeAdmission();
+
+    SslHandshakeAdmission(const SslHandshakeAdmission&) = delete;
+    SslHandshakeAdmission& operator=(const SslHandshakeAdmission&) = delete;
+
+    /**
+     * @brief 申请一次握手许可
+     * @return SslAdmissionAwaitable，成功时得到 SslHandshakePermit，被丢弃时返回 kHandshakeShed
+     */
+    SslAdmissionAwaitable acquire() { return SslAdmissionAwaitable(this); }
+
+    /**
+     * @brief 提供一次外部测得的事件循环延迟样本（如定时器的超时偏差）
+     * @details 队列为空时没有唤醒延迟可测，自适应模式也可以靠这些样本调整上限
+     */
+    void observeLoopLatency(std::chrono::microseconds latency);
+
+    /**
+     * @brief 统计快照
+     */
+    SslHandshakeAdmissionStats stats() const;
+
+    const SslHandshakeAdmissionOptions& options() const { return m_options; }
+
+private:
+    friend class SslHandshakePermit;
+    friend class SslAdmissionAwaitable;
+
+    using Waiter = SslAdmissionAwaitable::Waiter;
+
+    bool tryAdmit();
+    void enqueue(Waiter* waiter);
+    void cancel(Waiter* waiter);
+    void release();
+    void dispatch();
+    void shedExpired(Clock::time_point now);
+    void wake(Waiter* waiter);
+    void post(Waiter* waiter);
+    void repost();
+    void armTimer();
+    void observe(std::chrono::nanoseconds latency);
+    Task<void> resumeWaiter(std::shared_ptr<bool> alive, Waiter* waiter, uint64_t ticket);
+    Task<void> shedLoop(std::shared_ptr<bool> alive);
+
+    IOScheduler* m_scheduler;
+    SslHandshakeAdmissionOptions m_options;
+    std::shared_ptr<bool> m_alive = std::make_shared<bool>(true);
+    std::deque<Waiter*> m_queue;
+    std::vector<Waiter*> m_waking;      ///< 已出队、尚未恢复的节点
+    uint64_t m_nextTicket = 0;
+    bool m_timerRunning = false;
+    size_t m_inflight = 0;
+    size_t m_limit;
+    std::chrono::nanoseconds m_latency{0};
+    Clock::time_point m_lastAdjust{};
+    std::atomic<uint64_t> m_admitted{0};
+    std::atomic<uint64_t> m_queuedTotal{0};
+    std::atomic<uint64_t> m_shed{0};
+    std::atomic<size_t> m_inflightSnapshot{0};
+    std::atomic<size_t> m_queuedSnapshot{0};
+    std::atomic<size_t> m_limitSnapshot{0};
+    std::atomic<int64_t> m_latencySnapshotUs{0};
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_HANDSHAKE_ADMISSION_H
@@ -0,0 +1,139 @@
+#include "ssl_handshake_pool.h"
+#include <unistd.h>
+#include <optional>
+
+namespace galay::ssl
+{
+
+SslHandshakePool::SslHandshakePool(std::vector<IOScheduler*> handshakeSchedulers,
+                                   std::vector<IOScheduler*> dataSchedulers,
+                                   SslConnectionHandler handler,
+                                   SslHandshakePoolOptions options)
+    : m_workers(std::make_unique<Worker[]>(handshakeSchedulers.size()))
+    , m_workerCount(handshakeSchedulers.size())
+    , m_dataSchedulers(std::move(dataSchedulers))
+    , m_handler(std::move(handler))
+    , m_options(options)
+{
+    for (size_t i = 0; i < m_workerCount; ++i) {
+        m_workers[i].scheduler = handshakeSchedulers[i];
+        if (m_options.admission) {
+            m_workers[i].admission = std::make_unique<SslHandshakeAdmission>(handshakeSchedulers[i],
+                                                                             *m_options.admission);
+        }
+    }
+}
+
+bool SslHandshakePool::submit(SslContext* ctx, GHandle handle)
+{
+    // 不拥有的上下文以空控制块的别名 shared_ptr 传递
+    return submit(std::shared_ptr<SslContext>(std::shared_ptr<SslContext>(), ctx), handle);
+}
+
+bool SslHandshakePool::submit(std::shared_ptr<SslContext> ctx, GHandle handle)
+{
+    if (m_options.acceptFilter && !m_options.acceptFilter->screen(handle.fd)) {
+        m_filtered.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    Worker* worker = m_dataSchedulers.empty() ? nullptr : pickWorker();
+    if (worker == nullptr) {
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    worker->inflight.fetch_add(1, std::memory_order_relaxed);
+    if (!scheduleTask(worker->scheduler, handshake(std::move(ctx), handle, worker))) {
+        worker->inflight.fetch_sub(1, std::memory_order_relaxed);
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    m_submitted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+SslHandshakePoolStats SslHandshakePool::stats() const
+{
+    SslHandshakePoolStats result;
+    result.submitted = m_submitted.load(std::memory_order_relaxed);
+    result.rejected = m_rejected.load(std::memory_order_relaxed);
+    result.filtered = m_filtered.load(std::memory_order_relaxed);
+    result.completed = m_completed.load(std::memory_order_relaxed);
+    result.failed = m_failed.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < m_workerCount; ++i) {
+        result.inflight += m_workers[i].inflight.load(std::memory_order_relaxed);
+        if (m_workers[i].admission) {
+            const auto admission = m_workers[i].admission->stats();
+            result.shed += admission.shed;
+            result.queued += admission.queued;
+        }
+    }
+    return result;
+}
+
+SslHandshakePool::Worker* SslHandshakePool::pickWorker()
+{
+    // 选择进行中握手最少的调度器；并发提交时上限可能被略微超出
+    Worker* best = nullptr;
+    size_t best_inflight = m_options.maxInflightPerWorker;
+    for (size_t i = 0; i < m_workerCount; ++i) {
+        const size_t inflight = m_workers[i].inflight.load(std::memory_order_relaxed);
+        if (inflight < best_inflight) {
+            best = &m_workers[i];
+            best_inflight = inflight;
+        }
+    }
+    return best;
+}
+
+IOScheduler* SslHandshakePool::pickDataScheduler()
+{
+    const size_t index = m_nextData.fetch_add(1, std::memory_order_relaxed);
+    return m_dataSchedulers[index % m_dataSchedulers.size()];
+}
+
+Task<void> SslHandshakePool::handshake(std::shared_ptr<SslContext> ctx, GHandle handle, Worker* worker)
+{
+    SslSocket socket(std::move(ctx), handle);
+    socket.option().handleNonBlock();
+
+    std::expected<void, SslError> result;
+    SslHandshakePermit permit;
+    if (worker->admission) {
+        auto acquired = co_await worker->admission->acquire();
+        if (acquired) {
+            permit = std::move(*acquired);
+        } else {
+            result = std::unexpected(acquired.error());
+        }
+    }
+    if (result) {
+        result = co_await socket.handshake().timeout(m_options.handshakeTimeout);
+    }
+    permit.release();
+
+    std::optional<SslSocketHandoff> handoff;
+    if (result) {
+        // detach() 在交出前注销并关闭原 fd，连接由 dup 出的 fd 继续持有
+        if (auto detached = co_await socket.detach()) {
+            handoff.emplace(std::move(*detached));
+        }
+    }
+    if (!handoff) {
+        co_await socket.close();
+    }
+    worker->inflight.fetch_sub(1, std::memory_order_relaxed);
+
+    if (!handoff) {
+        m_failed.fetch_add(1, std::memory_order_relaxed);
+        co_return;
+    }
+    const int fd = handoff->handle.fd;
+    if (!scheduleTask(pickDataScheduler(), m_handler(SslSocket(std::move(*handoff))))) {
+        ::close(fd);
+        m_failed.fetch_add(1, std::memory_order_relaxed);
+        co_return;
+    }
+    m_completed.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace galay::ssl
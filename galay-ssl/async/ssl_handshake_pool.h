@@ -0,0 +1,151 @@
+#ifndef GALAY_SSL_HANDSHAKE_POOL_H
+#define GALAY_SSL_HANDSHAKE_POOL_H
+
+#include "galay-ssl/common/error.h"
+#include "galay-ssl/ssl/ssl_accept_filter.h"
+#include "galay-ssl/ssl/ssl_context.h"
+#include "ssl_handshake_admission.h"
+#include "ssl_socket.h"
+#include <galay-kernel/kernel/io_scheduler.hpp>
+#include <galay-kernel/kernel/task.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 握手调度器池配置
+ */
+struct SslHandshakePoolOptions {
+    std::chrono::milliseconds handshakeTimeout{10000};  ///< 整个握手（含等待签名）的超时
+    size_t maxInflightPerWorker = 4096;                 ///< 每个握手调度器同时进行的握手上限，全部满时 submit() 拒绝
+    std::optional<SslHandshakeAdmissionOptions> admission;  ///< 设置后每个握手调度器按该配置做准入控制
+    std::shared_ptr<SslAcceptFilter> acceptFilter;      ///< 设置后 submit() 先经该过滤器筛查，可与监听循环共享
+};
+
+/**
+ * @brief 握手调度器池统计
+ */
+struct SslHandshakePoolStats {
+    uint64_t submitted = 0;     ///< 接受的连接数
+    uint64_t rejected = 0;      ///< 因握手调度器全满或投递失败被拒绝的连接数
+    uint64_t filtered = 0;      ///< 被 acceptFilter 拒绝的连接数（不计入 rejected）
+    uint64_t completed = 0;     ///< 握手成功并交给数据调度器的连接数
+    uint64_t failed = 0;        ///< 握手失败、超时或迁移失败的连接数
+    uint64_t shed = 0;          ///< 被准入控制丢弃的连接数（同时计入 failed）
+    size_t inflight = 0;        ///< 已提交、尚未结束握手的连接数（含排队中的）
+    size_t queued = 0;          ///< 在准入控制中排队的连接数
+};
+
+/**
+ * @brief 已握手连接的处理函数，在数据调度器上运行
+ */
+using SslConnectionHandler = std::function<Task<void>(SslSocket socket)>;
+
+/**
+ * @brief 握手调度器池：握手与数据面分离的服务端流水线
+ *
+ * @details 接受的连接先交给一组只做握手的调度器完成 TLS 握手（含私钥卸载的等待），
+ * 成功后以 co_await SslSocket::detach() 在握手调度器上注销原 fd 并取出 fd + SslEngine，
+ * 再按轮询交给数据调度器，由 handler 以新 SslSocket 继续收发。握手 CPU 因此与批量 IO
+ * 核心隔离，两组调度器可以分别扩缩。
+ *
+ * @example
+ * @code
+ * SslHandshakePool pool({hs0, hs1}, {io0, io1, io2, io3},
+ *     [](SslSocket conn) -> Task<void> {
+ *         char buffer[4096];
+ *         while (auto received = co_await conn.recv(buffer, sizeof(buffer))) {
+ *             if (received->size() == 0 || !co_await conn.send(buffer, received->size())) break;
+ *         }
+ *         co_await conn.close();
+ *     });
+ *
+ * for (;;) {
+ *     auto accepted = co_await listener.accept(&client_host);
+ *     if (accepted && !pool.submit(&ctx, accepted.value())) {
+ *         ::close(accepted->fd);
+ *     }
+ * }
+ * @endcode
+ *
+ * 设置 SslHandshakePoolOptions::admission 后，每个握手调度器各有一个 SslHandshakeAdmission：
+ * 超过并发上限的握手排队，排满或超时的连接直接关闭。设置 SslHandshakePoolOptions::acceptFilter 后，
+ * submit() 在投递前以 SslAcceptFilter::screen() 筛查，被拒绝的连接不分配任何 SSL 资源。
+ *
+ * @note
+ * - submit() 可在任意线程调用；池必须比所有已提交的连接活得更久
+ * - handler 接管连接后负责 close()；握手失败的连接由池关闭
+ */
+class SslHandshakePool
+{
+public:
+    /**
+     * @param handshakeSchedulers 只做握手的调度器，不能为空
+     * @param dataSchedulers 握手完成后承载连接的调度器，不能为空
+     * @param handler 已握手连接的处理函数
+     */
+    SslHandshakePool(std::vector<IOScheduler*> handshakeSchedulers,
+                     std::vector<IOScheduler*> dataSchedulers,
+                     SslConnectionHandler handler,
+                     SslHandshakePoolOptions options = {});
+
+    SslHandshakePool(const SslHandshakePool&) = delete;
+    SslHandshakePool& operator=(const SslHandshakePool&) = delete;
+
+    /**
+     * @brief 提交一个已接受的连接
+     *
+     * @param ctx 服务端上下文
+     * @param handle accept 得到的句柄
+     * @return false 表示未接管（被接入过滤拒绝、握手调度器全满或投递失败），调用方负责关闭句柄
+     */
+    bool submit(SslContext* ctx, GHandle handle);
+
+    /**
+     * @brief 提交一个已接受的连接，连接持有上下文引用直到结束（上下文热重载时使用）
+     * @see submit(SslContext*, GHandle)
+     */
+    bool submit(std::shared_ptr<SslContext> ctx, GHandle handle);
+
+    /**
+     * @brief 统计快照
+     */
+    SslHandshakePoolStats stats() const;
+
+    const SslHandshakePoolOptions& options() const { return m_options; }
+
+private:
+    struct Worker {
+        IOScheduler* scheduler = nullptr;
+        std::atomic<size_t> inflight{0};
+        std::unique_ptr<SslHandshakeAdmission> admission;
+    };
+
+    Task<void> handshake(std::shared_ptr<SslContext> ctx, GHandle handle, Worker* worker);
+    Worker* pickWorker();
+    IOScheduler* pickDataScheduler();
+
+    std::unique_ptr<Worker[]> m_workers;
+    size_t m_workerCount = 0;
+    std::vector<IOScheduler*> m_dataSchedulers;
+    SslConnectionHandler m_handler;
+    SslHandshakePoolOptions m_options;
+    std::atomic<size_t> m_nextData{0};
+    std::atomic<uint64_t> m_submitted{0};
+    std::atomic<uint64_t> m_rejected{0};
+    std::atomic<uint64_t> m_filtered{0};
+    std::atomic<uint64_t> m_completed{0};
+    std::atomic<uint64_t> m_failed{0};
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_HANDSHAKE_POOL_H
@@ -1,7 +1,12 @@
 #include "ssl_socket.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
 
 namespace galay::ssl
@@ -35,37 +40,94 @@ SslSocket::SslSocket(SslContext* ctx, GHandle handle)
     initEngine();
 }
 
+SslSocket::SslSocket(std::shared_ptr<SslContext> ctx, GHandle handle)
+    : m_controller(handle)
+    , m_ctx(ctx.get())
+    , m_engine(std::move(ctx))
+    , m_isServer(true)
+    , m_engineInitialized(false)
+    , m_recvCipherBuffer()
+    , m_sendCipherBuffer()
+{
+    initEngine();
+}
+
+SslSocket::SslSocket(SslSocketHandoff&& handoff)
+    : m_controller(handoff.handle)
+    , m_ctx(handoff.ctx)
+    , m_engine(std::move(handoff.engine))
+    , m_isServer(handoff.isServer)
+    , m_engineInitialized(m_engine.isValid())
+{
+}
+
 SslSocket::~SslSocket()
 {
     // 不自动关闭，需要显式调用 close()
+    detachFlushQueue();
+    cancelDrain();
 }
 
 SslSocket::SslSocket(SslSocket&& other) noexcept
     : m_controller(std::move(other.m_controller))
+    , m_keyWaitController(std::move(other.m_keyWaitController))
     , m_ctx(other.m_ctx)
     , m_engine(std::move(other.m_engine))
     , m_isServer(other.m_isServer)
     , m_engineInitialized(other.m_engineInitialized)
+    , m_sessionRestored(other.m_sessionRestored)
+    , m_peerKey(std::move(other.m_peerKey))
     , m_recvCipherBuffer(std::move(other.m_recvCipherBuffer))
     , m_sendCipherBuffer(std::move(other.m_sendCipherBuffer))
+    , m_flushQueue(other.m_flushQueue)
+    , m_flushSlot(other.m_flushSlot)
+    , m_flushDraining(other.m_flushDraining)
+    , m_drain(std::move(other.m_drain))
 {
+    if (m_flushQueue) {
+        m_flushQueue->rebind(&other, this);
+    }
+    if (m_drain) {
+        m_drain->socket = this;
+    }
     other.m_ctx = nullptr;
     other.m_engineInitialized = false;
+    other.m_flushQueue = nullptr;
+    other.m_flushSlot = SslFlushQueue::kNotQueued;
+    other.m_flushDraining = false;
 }
 
 SslSocket& SslSocket::operator=(SslSocket&& other) noexcept
 {
     if (this != &other) {
+        detachFlushQueue();
+        cancelDrain();
         m_controller = std::move(other.m_controller);
+        m_keyWaitController = std::move(other.m_keyWaitController);
         m_ctx = other.m_ctx;
         m_engine = std::move(other.m_engine);
         m_isServer = other.m_isServer;
         m_engineInitialized = other.m_engineInitialized;
+        m_sessionRestored = other.m_sessionRestored;
+        m_peerKey = std::move(other.m_peerKey);
         m_recvCipherBuffer = std::move(other.m_recvCipherBuffer);
         m_sendCipherBuffer = std::move(other.m_sendCipherBuffer);
+        m_flushQueue = other.m_flushQueue;
+        m_flushSlot = other.m_flushSlot;
+        m_flushDraining = other.m_flushDraining;
+        m_drain = std::move(other.m_drain);
+        if (m_flushQueue) {
+            m_flushQueue->rebind(&other, this);
+        }
+        if (m_drain) {
+            m_drain->socket = this;
+        }
 
         other.m_ctx = nullptr;
         other.m_engineInitialized = false;
+        other.m_flushQueue = nullptr;
+        other.m_flushSlot = SslFlushQueue::kNotQueued;
+        other.m_flushDraining = false;
     }
     return *this;
 }
@@ -123,12 +185,19 @@ AcceptAwaitable SslSocket::accept(Host* clientHost)
     return AcceptAwaitable(&m_controller, clientHost);
 }
 
-ConnectAwaitable SslSocket::connect(const Host& host)
+void SslSocket::prepareClient(const Host& host)
 {
     // 连接前初始化 SSL 引擎为客户端模式
     m_isServer = false;
     initEngine();
+    if (m_ctx && m_ctx->clientSessionCache()) {
+        m_peerKey = std::string(host.ip()) + ":" + std::to_string(host.port());
+    }
+}
 
+ConnectAwaitable SslSocket::connect(const Host& host)
+{
+    prepareClient(host);
     return ConnectAwaitable(&m_controller, host);
 }
 
@@ -138,8 +207,216 @@ SslHandshakeAwaitable SslSocket::handshake()
     if (!m_engineInitialized) {
         initEngine();
     }
+    restoreClientSession();
+
+    return SslHandshakeAwaitable(&m_controller, this, m_ctx && m_ctx->asyncHandshake());
+}
+
+namespace {
 
-    return SslHandshakeAwaitable(&m_controller, this);
+std::optional<std::chrono::steady_clock::time_point> handshakeDeadline(
+    std::optional<std::chrono::milliseconds> timeout)
+{
+    if (!timeout) {
+        return std::nullopt;
+    }
+    return std::chrono::steady_clock::now() + *timeout;
+}
+
+/**
+ * @brief 距截止时间的剩余预算；没有设置超时时返回 nullopt
+ */
+std::optional<std::chrono::milliseconds> handshakeBudget(
+    const std::optional<std::chrono::steady_clock::time_point>& deadline)
+{
+    if (!deadline) {
+        return std::nullopt;
+    }
+    const auto left = *deadline - std::chrono::steady_clock::now();
+    return std::max(std::chrono::ceil<std::chrono::milliseconds>(left), std::chrono::milliseconds(0));
+}
+
+bool budgetExhausted(const std::optional<std::chrono::milliseconds>& budget)
+{
+    return budget && budget->count() == 0;
+}
+
+} // namespace
+
+Task<void> SslHandshakeAwaitable::run(std::shared_ptr<State> state, IOController* controller, SslSocket* socket,
+                                      std::optional<std::chrono::milliseconds> timeout)
+{
+    const auto deadline = handshakeDeadline(timeout);
+    std::expected<void, SslError> result = std::unexpected(SslError(SslErrorCode::kTimeout));
+    while (state->handle) {
+        auto budget = handshakeBudget(deadline);
+        if (budgetExhausted(budget)) {
+            result = std::unexpected(SslError(SslErrorCode::kTimeout));
+            break;
+        }
+        if (budget) {
+            result = co_await SslHandshakeStepAwaitable(controller, socket).timeout(*budget);
+        } else {
+            result = co_await SslHandshakeStepAwaitable(controller, socket);
+        }
+        if (result || result.error().code() != SslErrorCode::kHandshakeWantAsync || !state->handle) {
+            break;
+        }
+        result = co_await socket->waitAsyncJob(handshakeBudget(deadline));
+        if (!result) {
+            break;
+        }
+    }
+    if (state->handle) {
+        state->result = std::move(result);
+        state->handle.resume();
+    }
+}
+
+Task<void> SslHandshakeSendAwaitable::run(std::shared_ptr<State> state, IOController* controller,
+                                          SslSocket* socket, const char* buffer, size_t length, bool early_data,
+                                          std::optional<SslError> error,
+                                          std::optional<std::chrono::milliseconds> timeout)
+{
+    const auto deadline = handshakeDeadline(timeout);
+    size_t written = 0;
+    std::expected<size_t, SslError> result = std::unexpected(SslError(SslErrorCode::kTimeout));
+    if (timeout) {
+        result = co_await SslHandshakeSendStepAwaitable(controller, socket, buffer, length, early_data,
+                                                        std::move(error), &written).timeout(*timeout);
+    } else {
+        result = co_await SslHandshakeSendStepAwaitable(controller, socket, buffer, length, early_data,
+                                                        std::move(error), &written);
+    }
+
+    // 等待后台运算后只继续握手：请求已无法随 Finished 合并，握手完成后按普通 send 写出剩余部分
+    bool resumed = false;
+    while (state->handle && !result && result.error().code() == SslErrorCode::kHandshakeWantAsync) {
+        resumed = true;
+        if (auto waited = co_await socket->waitAsyncJob(handshakeBudget(deadline)); !waited) {
+            result = std::unexpected(waited.error());
+            break;
+        }
+        auto budget = handshakeBudget(deadline);
+        if (budgetExhausted(budget)) {
+            result = std::unexpected(SslError(SslErrorCode::kTimeout));
+            break;
+        }
+        std::expected<void, SslError> handshaken;
+        if (budget) {
+            handshaken = co_await SslHandshakeStepAwaitable(controller, socket).timeout(*budget);
+        } else {
+            handshaken = co_await SslHandshakeStepAwaitable(controller, socket);
+        }
+        if (!handshaken) {
+            result = std::unexpected(handshaken.error());
+        } else {
+            result = 0;
+        }
+    }
+
+    if (state->handle && resumed && result) {
+        // early data 已随 ClientHello 写出但被服务端拒绝时整段重发
+        if (written > 0 && socket->m_engine.earlyDataStatus() != SslEarlyDataStatus::Accepted) {
+            written = 0;
+        }
+        result = written;
+        auto budget = handshakeBudget(deadline);
+        if (written < length && budgetExhausted(budget)) {
+            result = std::unexpected(SslError(SslErrorCode::kTimeout));
+        } else if (written < length) {
+            std::expected<size_t, SslError> sent;
+            if (budget) {
+                sent = co_await SslSendAwaitable(controller, socket, buffer + written, length - written)
+                           .timeout(*budget);
+            } else {
+                sent = co_await SslSendAwaitable(controller, socket, buffer + written, length - written);
+            }
+            result = sent ? std::expected<size_t, SslError>(written + *sent) : sent;
+        }
+    }
+    if (state->handle) {
+        state->result = std::move(result);
+        state->handle.resume();
+    }
+}
+
+RecvAwaitable SslSocket::waitPrivateKey()
+{
+    // 等待 fd 随 SSL 对象创建一次，之后保持不变
+    const int fd = m_engine.asyncWaitFd();
+    if (m_keyWaitController.m_handle.fd != fd) {
+        GHandle handle = GHandle::invalid();
+        handle.fd = fd;
+        m_keyWaitController = IOController(handle);
+    }
+    return RecvAwaitable(&m_keyWaitController, &m_keyWaitByte, 1);
+}
+
+Task<std::expected<void, SslError>> SslSocket::waitAsyncJob(std::optional<std::chrono::milliseconds> budget)
+{
+    if (budget && budget->count() == 0) {
+        co_return std::unexpected(SslError(SslErrorCode::kTimeout));
+    }
+    // 后台运算结束（成功或失败）时 fd 可读，再推进一轮握手即得到结果
+    if (budget) {
+        auto waited = co_await waitPrivateKey().timeout(*budget);
+        if (!waited) {
+            co_return std::unexpected(SslError(IOError::contains(waited.error().code(), kTimeout)
+                                                   ? SslErrorCode::kTimeout
+                                                   : SslErrorCode::kHandshakeFailed));
+        }
+        co_return std::expected<void, SslError>{};
+    }
+    if (!co_await waitPrivateKey()) {
+        co_return std::unexpected(SslError(SslErrorCode::kHandshakeFailed));
+    }
+    co_return std::expected<void, SslError>{};
+}
+
+SslHandshakeSendAwaitable SslSocket::handshakeAndSend(const char* buffer, size_t length, bool early_data)
+{
+    if (!m_engineInitialized) {
+        initEngine();
+    }
+    restoreClientSession();
+
+    return SslHandshakeSendAwaitable(&m_controller, this, m_ctx && m_ctx->asyncHandshake(), buffer, length,
+                                     early_data);
+}
+
+SslHandshakeSendAwaitable SslSocket::connectAndSend(const Host& host, const char* buffer, size_t length,
+                                                    SslConnectOptions options)
+{
+    prepareClient(host);
+    restoreClientSession();
+
+    const int fd = m_controller.m_handle.fd;
+    std::optional<SslError> error;
+#ifdef TCP_FASTOPEN_CONNECT
+    if (options.fastOpen) {
+        // 之后的 connect 立即返回，SYN 推迟到首次写并携带 ClientHello；失败时按普通建连处理
+        const int enable = 1;
+        (void)::setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &enable, sizeof(enable));
+    }
+#endif
+    const int flags = fd >= 0 ? ::fcntl(fd, F_GETFL, 0) : -1;
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 ||
+        (::connect(fd, host.sockAddr(), host.addrLen()) < 0 && errno != EINPROGRESS)) {
+        error = SslError(SslErrorCode::kConnectFailed);
+    }
+
+    return SslHandshakeSendAwaitable(&m_controller, this, m_ctx && m_ctx->asyncHandshake(), buffer, length,
+                                     options.earlyData, std::move(error));
+}
+
+void SslSocket::restoreClientSession()
+{
+    // SNI 可能在 connect() 之后才设置，所以在首次握手时再按 host:port + SNI 查缓存
+    if (!m_isServer && !m_sessionRestored && !m_peerKey.empty() && !m_engine.isHandshakeCompleted()) {
+        m_engine.restoreCachedSession(m_peerKey);
+        m_sessionRestored = true;
+    }
 }
 
 SslRecvAwaitable SslSocket::recv(char* buffer, size_t length)
@@ -152,6 +429,60 @@ SslSendAwaitable SslSocket::send(const char* buffer, size_t length)
     return SslSendAwaitable(&m_controller, this, buffer, length);
 }
 
+SslSendAwaitable::~SslSendAwaitable()
+{
+    if (!m_drain) {
+        return;
+    }
+    // 调用方协程帧在等待排空时被销毁，把节点从排空状态中摘掉
+    auto& waiters = m_drain->waiters;
+    waiters.erase(std::remove(waiters.begin(), waiters.end(), &m_waiter), waiters.end());
+    auto& waking = m_drain->waking;
+    waking.erase(std::remove(waking.begin(), waking.end(), &m_waiter), waking.end());
+}
+
+bool SslSendAwaitable::await_ready()
+{
+    const auto& drain = m_target->m_drain;
+    if (m_waiter.length > 0 && drain && m_target->m_flushQueue != nullptr) {
+        const size_t pending = m_target->m_engine.pendingEncryptedOutput();
+        // 已有等待者时排在其后，保持入队顺序
+        const size_t limit = m_target->m_flushQueue->options().maxPendingBytes;
+        if (!drain->waiters.empty() || pending + m_waiter.length > limit) {
+            m_drain = drain;
+            return false;
+        }
+    }
+    return Base::await_ready();
+}
+
+std::expected<size_t, SslError> SslSendAwaitable::await_resume()
+{
+    if (m_drain) {
+        return std::move(m_waiter.result);
+    }
+    return Base::await_resume();
+}
+
+std::expected<size_t, SslError> SslSocket::writeEarlyData(const char* buffer, size_t length)
+{
+    if (!m_engineInitialized && !initEngine()) {
+        return std::unexpected(SslError(SslErrorCode::kEarlyDataFailed));
+    }
+    restoreClientSession();
+
+    size_t written = 0;
+    if (m_engine.writeEarlyData(buffer, length, written) != SslIOResult::Success) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kEarlyDataFailed));
+    }
+    return written;
+}
+
+SslRecvAwaitable SslSocket::recvEarly(char* buffer, size_t length)
+{
+    return SslRecvAwaitable(&m_controller, this, buffer, length, true);
+}
+
 SslShutdownAwaitable SslSocket::shutdown()
 {
     return SslShutdownAwaitable(&m_controller, this);
@@ -159,7 +490,81 @@ SslShutdownAwaitable SslSocket::shutdown()
 
 CloseAwaitable SslSocket::close()
 {
+    if (m_flushQueue && m_flushSlot != SslFlushQueue::kNotQueued && !m_flushDraining) {
+        size_t written = 0;
+        m_flushQueue->flushSocket(this, written);
+        m_flushQueue->m_stats.flushed_bytes += written;
+    }
+    detachFlushQueue();
+    cancelDrain();
     return CloseAwaitable(&m_controller);
 }
 
+void SslSocket::setFlushQueue(SslFlushQueue* queue)
+{
+    if (queue == m_flushQueue) {
+        return;
+    }
+    if (m_flushQueue && m_flushSlot != SslFlushQueue::kNotQueued && !m_flushDraining) {
+        // 切换队列前把旧队列里的积压尽力写出，剩余部分由后续普通 IO 先行写出
+        size_t written = 0;
+        m_flushQueue->flushSocket(this, written);
+        m_flushQueue->m_stats.flushed_bytes += written;
+    }
+    detachFlushQueue();
+    m_flushQueue = queue;
+}
+
+SslDetachAwaitable SslSocket::detach()
+{
+    if (!m_engine.isHandshakeCompleted() || m_engine.pendingEncryptedOutput() > 0 ||
+        m_flushSlot != SslFlushQueue::kNotQueued || m_flushDraining) {
+        return SslDetachAwaitable(&m_controller, std::unexpected(SslError(SslErrorCode::kHandoffFailed)));
+    }
+    const int fd = ::fcntl(m_controller.m_handle.fd, F_DUPFD_CLOEXEC, 0);
+    if (fd < 0) {
+        return SslDetachAwaitable(&m_controller, std::unexpected(SslError(SslErrorCode::kHandoffFailed)));
+    }
+
+    detachFlushQueue();
+    GHandle handle = GHandle::invalid();
+    handle.fd = fd;
+    SslSocketHandoff handoff{handle, m_ctx, std::move(m_engine), m_isServer};
+    m_engineInitialized = false;
+    // 原 fd 由 await 期间的 CloseAwaitable 注销并关闭
+    return SslDetachAwaitable(&m_controller, std::move(handoff));
+}
+
+std::expected<SslSocketHandoff, SslError> SslDetachAwaitable::await_resume()
+{
+    if (!m_handoff) {
+        return std::move(m_handoff);
+    }
+    if (!m_close.await_resume()) {
+        // 原 fd 的登记状态未知，不能把连接交给另一个调度器
+        ::close(m_handoff->handle.fd);
+        return std::unexpected(SslError(SslErrorCode::kHandoffFailed));
+    }
+    return std::move(m_handoff);
+}
+
+void SslSocket::detachFlushQueue()
+{
+    if (m_flushQueue) {
+        m_flushQueue->remove(this);
+    }
+    m_flushQueue = nullptr;
+    m_flushSlot = SslFlushQueue::kNotQueued;
+}
+
+void SslSocket::cancelDrain()
+{
+    // 先于 detachFlushQueue() 调用会让所在队列的排空计数失准，调用方保证顺序
+    if (m_drain) {
+        SslFlushQueue::abandon(m_drain);
+        m_drain.reset();
+    }
+    m_flushDraining = false;
+}
+
 } // namespace galay::ssl
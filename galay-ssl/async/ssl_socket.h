@@ -5,12 +5,18 @@
 #include "galay-ssl/ssl/ssl_context.h"
 #include "galay-ssl/ssl/ssl_engine.h"
 #include "awaitable.h"
+#include "ssl_flush.h"
 #include <galay-kernel/common/defn.hpp>
 #include <galay-kernel/common/host.hpp>
 #include <galay-kernel/common/handle_option.h>
 #include <galay-kernel/kernel/io_scheduler.hpp>
 #include <galay-kernel/kernel/awaitable.h>
+#include <chrono>
+#include <coroutine>
 #include <expected>
+#include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace galay::ssl
@@ -18,6 +24,57 @@ namespace galay::ssl
 
 using namespace galay::kernel;
 
+/**
+ * @brief connectAndSend() 的建连选项
+ */
+struct SslConnectOptions {
+    bool fastOpen = false;   ///< 使用 TCP Fast Open（Linux TCP_FASTOPEN_CONNECT），持有 cookie 时 ClientHello 随 SYN 发出
+    bool earlyData = false;  ///< session 允许 0-RTT 时把请求作为 early data 随 ClientHello 发出，只应用于幂等请求
+};
+
+/**
+ * @brief 已握手连接的迁移载体（fd + SslEngine），见 SslSocket::detach()
+ */
+struct SslSocketHandoff {
+    GHandle handle;                 ///< dup 出的 socket 句柄，由新 SslSocket 接管
+    SslContext* ctx = nullptr;      ///< SSL 上下文（不拥有）
+    SslEngine engine;               ///< 已完成握手的引擎，含已收到未读出的密文与明文
+    bool isServer = true;           ///< 是否为服务端连接
+};
+
+/**
+ * @brief SslSocket::detach() 返回的可等待对象
+ *
+ * @details 先经 CloseAwaitable 在当前调度器上注销并关闭原 fd，再交出 dup 出的句柄。dup 出的 fd 与原 fd
+ * 共享同一个打开的文件，只关闭原 fd 不会让 epoll 撤销登记；经调度器关闭保证交出时当前调度器上
+ * 已没有该连接的登记，接收方的调度器不会与它争抢事件。
+ * 前置条件不满足时不挂起、不关闭，连接保持原样，仍由调用方 close()。
+ */
+class SslDetachAwaitable
+{
+public:
+    bool await_ready() { return !m_handoff || m_close.await_ready(); }
+
+    template <typename PromiseT>
+    auto await_suspend(std::coroutine_handle<PromiseT> handle)
+    {
+        return m_close.await_suspend(handle);
+    }
+
+    std::expected<SslSocketHandoff, SslError> await_resume();
+
+private:
+    friend class SslSocket;
+
+    SslDetachAwaitable(IOController* controller, std::expected<SslSocketHandoff, SslError> handoff)
+        : m_close(controller)
+        , m_handoff(std::move(handoff))
+    {}
+
+    CloseAwaitable m_close;
+    std::expected<SslSocketHandoff, SslError> m_handoff;
+};
+
 /**
  * @brief 异步 SSL Socket 类
  *
@@ -92,6 +149,22 @@ public:
      */
     SslSocket(SslContext* ctx, GHandle handle);
 
+    /**
+     * @brief 从已有句柄构造 SSL Socket，连接持有上下文引用
+     * @param ctx SSL 上下文，不能为空；连接存活期间保持有效，通常取自 SslContextReloader::current()
+     * @param handle 已有的 socket 句柄（如 accept 返回的句柄）
+     * @note 上下文随后被替换时，本连接继续使用构造时的上下文
+     */
+    SslSocket(std::shared_ptr<SslContext> ctx, GHandle handle);
+
+    /**
+     * @brief 接管另一个调度器上完成握手的连接
+     * @param handoff detach() 的结果
+     * @note 在目标调度器上使用，之后的 IO 都登记到该调度器。引擎已完成握手：handshake() 直接成功，
+     * 也不会再查客户端 Session 缓存
+     */
+    explicit SslSocket(SslSocketHandoff&& handoff);
+
     /**
      * @brief 析构函数
      * @note 不会自动关闭 socket，需显式调用 close()
@@ -182,7 +255,8 @@ public:
      * @param host 目标服务器地址
      * @return ConnectAwaitable 可等待对象
      *
-     * @note 连接成功后需要调用 handshake() 执行 SSL 握手
+     * @note 连接成功后需要调用 handshake() 执行 SSL 握手；上下文挂接了
+     * SslClientSessionCache 时，会记录 host:port 作为 session 缓存 key 的一部分
      */
     ConnectAwaitable connect(const Host& host);
 
@@ -192,11 +266,48 @@ public:
      * @return SslHandshakeAwaitable 可等待对象
      *
      * @note
-     * - 客户端：在 connect() 成功后调用
+     * - 客户端：在 connect() 成功后调用；上下文挂接了 SslClientSessionCache 时，
+     *   首次调用会按 host:port + SNI 自动取出缓存的 session 尝试恢复
      * - 服务端：在 accept() 后创建新 SslSocket 并调用
+     * - 上下文开启了 SslContext::asyncHandshake()（私钥卸载、keyless、证书路由）时，签名或证书加载在后台进行，
+     *   awaitable 自行等待 SslEngine::asyncWaitFd() 后继续，调度线程不被阻塞，调用方无需重试；
+     *   timeout() 限制整个握手，包括等待后台运算的时间
      */
     SslHandshakeAwaitable handshake();
 
+    /**
+     * @brief 异步握手并写出首个请求（客户端）
+     *
+     * @param buffer 请求数据指针，需在 co_await 完成前保持有效
+     * @param length 请求长度
+     * @param early_data session 允许时把请求作为 0-RTT early data 随 ClientHello 发出；
+     * 被服务端拒绝时自动随 Finished 重发
+     * @return SslHandshakeSendAwaitable，成功时返回写出的字节数（即 length）
+     *
+     * @note 在 connect() 成功后调用。请求在客户端握手完成的同一轮被加密进输出缓冲，
+     * 与 Finished 共用一次写（TLS 1.3 及 TLS 1.2 恢复握手）；超过一个 TLS 记录的部分在握手后按 send() 写出
+     */
+    SslHandshakeSendAwaitable handshakeAndSend(const char* buffer, size_t length, bool early_data = false);
+
+    /**
+     * @brief 一次 co_await 完成 TCP 建连、SSL 握手与首个请求写出（客户端）
+     *
+     * @param host 目标服务器地址
+     * @param buffer 请求数据指针，需在 co_await 完成前保持有效
+     * @param length 请求长度
+     * @param options 建连选项
+     * @return SslHandshakeSendAwaitable，成功时返回写出的字节数；建连失败返回 kConnectFailed，
+     * 连接被拒绝等异步建连错误表现为 kHandshakeFailed
+     *
+     * @note
+     * - 以非阻塞方式发起 connect，不单独等待建连完成：ClientHello 的写请求在连接可写时才执行，
+     *   省去独立的 connect() 调度往返
+     * - SNI 需在调用前通过 setHostname() 设置，以便按 host:port + SNI 从客户端缓存恢复 session
+     * - 内核不支持 TCP Fast Open 时静默退回普通建连
+     */
+    SslHandshakeSendAwaitable connectAndSend(const Host& host, const char* buffer, size_t length,
+                                             SslConnectOptions options = {});
+
     /**
      * @brief 异步接收数据
      *
@@ -215,10 +326,44 @@ public:
      * @param length 数据长度
      * @return SslSendAwaitable 可等待对象
      *
-     * @note 必须在握手完成后调用
+     * @note 必须在握手完成后调用。length 为 0 时不加密新数据，只写出引擎中积压的密文
+     * （如延迟刷写留下的部分），没有积压时立即完成
      */
     SslSendAwaitable send(const char* buffer, size_t length);
 
+    /**
+     * @brief 写入 TLS 1.3 early data（不等待 IO）
+     *
+     * @param buffer 发送数据指针
+     * @param length 数据长度，超过对端允许的 early data 上限时只写入允许的部分
+     * @return 写入引擎的字节数，失败返回 kEarlyDataFailed
+     *
+     * @note
+     * - 客户端（0-RTT）：在 connect() 之后、handshake() 之前调用，会先按 host:port + SNI 从
+     *   SslClientSessionCache 取出 session；数据随 ClientHello 由随后的 handshake() 一起发出。
+     *   握手完成后若 earlyDataStatus() 为 Rejected，需要用 send() 重发
+     * - 服务端（0.5-RTT）：在 recvEarly() 之后、handshake() 之前调用，数据随服务端首轮消息发出
+     * - early data 可被重放，只应承载幂等请求
+     */
+    std::expected<size_t, SslError> writeEarlyData(const char* buffer, size_t length);
+
+    /**
+     * @brief 异步读取 TLS 1.3 early data（服务端，握手完成前调用）
+     *
+     * @param buffer 接收缓冲区指针
+     * @param length 缓冲区大小
+     * @return SslRecvAwaitable 可等待对象；返回空数据表示 early data 已读完或未被接受，
+     * 此时继续 co_await handshake()
+     *
+     * @note 需要上下文设置 setMaxEarlyData()；不调用本接口而直接 handshake() 时 early data 会被拒绝
+     */
+    SslRecvAwaitable recvEarly(char* buffer, size_t length);
+
+    /**
+     * @brief 获取 early data 状态
+     */
+    SslEarlyDataStatus earlyDataStatus() const { return m_engine.earlyDataStatus(); }
+
     /**
      * @brief 异步关闭 SSL 连接
      *
@@ -232,9 +377,54 @@ public:
      * @brief 异步关闭底层 socket
      *
      * @return CloseAwaitable 可等待对象
+     *
+     * @note 若连接仍登记在 SslFlushQueue 中，会先尽力写出积压密文再解除登记；排空进行中时取消排空，
+     * 未写出的密文被丢弃
      */
     CloseAwaitable close();
 
+    /**
+     * @brief 绑定跨连接延迟刷写队列（opt-in）
+     *
+     * @param queue 刷写队列，nullptr 表示恢复为逐次提交写请求
+     *
+     * @note 绑定后 send() 只加密入队并立即完成，密文由 SslFlushQueue::flush() 统一写出；
+     * 队列必须与本连接属于同一个 IO 调度器，且生命周期覆盖绑定期间
+     */
+    void setFlushQueue(SslFlushQueue* queue);
+
+    /**
+     * @brief 取出已握手连接以迁移到其他调度器
+     *
+     * @return SslDetachAwaitable，成功时得到 SslSocketHandoff；握手未完成、仍有未写出的密文、
+     * 刷写队列排空未结束、dup 或关闭原 fd 失败时返回 kHandoffFailed
+     *
+     * @details 句柄以 dup 的新 fd 交出，引擎整体移出。co_await 期间在当前调度器上注销并关闭原 fd，
+     * 完成后连接只由新 fd 持有。只有前置条件不满足（未挂起）时当前对象仍持有原 fd，需要调用方 close()。
+     *
+     * @example
+     * @code
+     * auto handoff = co_await socket.detach();
+     * if (handoff) {
+     *     scheduleTask(data_scheduler, serve(SslSocket(std::move(*handoff))));
+     * } else {
+     *     co_await socket.close();
+     * }
+     * @endcode
+     */
+    SslDetachAwaitable detach();
+
+    /**
+     * @brief 获取当前绑定的延迟刷写队列
+     */
+    SslFlushQueue* flushQueue() const { return m_flushQueue; }
+
+    /**
+     * @brief 刷写队列是否正在该连接上等待可写、写出积压
+     * @details 为 true 时相当于该连接上有一个 send 在途，见 SslFlushQueue 的说明
+     */
+    bool flushDraining() const { return m_flushDraining; }
+
     /**
      * @brief 获取对端证书
      * @return X509 证书指针，需要调用者释放
@@ -287,18 +477,58 @@ private:
      */
     bool initEngine();
 
+    /**
+     * @brief 客户端首次握手或写 early data 前，按 host:port + SNI 从客户端缓存恢复 session
+     */
+    void restoreClientSession();
+
+    /**
+     * @brief 切换为客户端模式并记录客户端缓存使用的 host:port
+     */
+    void prepareClient(const Host& host);
+
 private:
     friend class SslOperationDriver;
+    friend class SslFlushQueue;
+    friend class SslHandshakeAwaitable;
+    friend class SslHandshakeSendAwaitable;
+    friend class SslSendAwaitable;
+
+    void detachFlushQueue();
+
+    /**
+     * @brief 取消进行中的排空：排空任务恢复后不再访问本连接，挂起等待排空的 send 以失败恢复
+     */
+    void cancelDrain();
+
+    /**
+     * @brief 等待 SslEngine::asyncWaitFd() 可读：私钥运算或证书加载结束
+     */
+    RecvAwaitable waitPrivateKey();
+
+    /**
+     * @brief 在剩余预算内等待后台运算结束
+     * @return 超时返回 kTimeout，等待失败返回 kHandshakeFailed
+     */
+    Task<std::expected<void, SslError>> waitAsyncJob(std::optional<std::chrono::milliseconds> budget);
 
     IOController m_controller;  ///< IO 事件控制器
-    SslContext* m_ctx;          ///< SSL 上下文（不拥有）
+    IOController m_keyWaitController{GHandle::invalid()};   ///< 私钥运算等待 fd 的控制器
+    char m_keyWaitByte = 0;                                 ///< 等待 fd 上的通知字节
+    SslContext* m_ctx;          ///< SSL 上下文（以 shared_ptr 构造时引用由 m_engine 持有）
     SslEngine m_engine;         ///< SSL 引擎
     bool m_isServer;            ///< 是否为服务端模式
     bool m_engineInitialized;   ///< SSL 引擎是否已初始化
+    bool m_sessionRestored = false;                          ///< 是否已查询过客户端 Session 缓存
+    std::string m_peerKey;                                   ///< 客户端对端地址 host:port
     std::vector<char> m_handshakeBuffer;
     std::vector<char> m_shutdownBuffer;
     std::vector<char> m_recvCipherBuffer;
     std::vector<char> m_sendCipherBuffer;
+    SslFlushQueue* m_flushQueue = nullptr;                   ///< 延迟刷写队列（不拥有）
+    size_t m_flushSlot = SslFlushQueue::kNotQueued;          ///< 在刷写队列中的位置
+    bool m_flushDraining = false;                            ///< 刷写队列正在该连接上等待可写写出积压
+    std::shared_ptr<SslFlushDrain> m_drain;                  ///< 进行中排空的共享状态
 };
 
 } // namespace galay::ssl
@@ -53,6 +53,16 @@ enum class SslIOResult : int {
     Error = -1,         ///< 错误
     ZeroReturn = -2,    ///< 对端关闭连接
     Syscall = -3,       ///< 系统调用错误
+    WantAsync = 3,      ///< 私钥运算或握手回调的后台任务未完成，等待 async fd 可读后重试
+};
+
+/**
+ * @brief TLS 1.3 early data（0-RTT）状态
+ */
+enum class SslEarlyDataStatus : int {
+    NotSent = SSL_EARLY_DATA_NOT_SENT,      ///< 未发送 / 未收到 early data
+    Rejected = SSL_EARLY_DATA_REJECTED,     ///< 对端拒绝，数据需要在握手后重发
+    Accepted = SSL_EARLY_DATA_ACCEPTED,     ///< 对端已接受
 };
 
 /**
@@ -70,6 +80,9 @@ inline SslIOResult sslErrorToResult(int ssl_error) {
             return SslIOResult::ZeroReturn;
         case SSL_ERROR_SYSCALL:
             return SslIOResult::Syscall;
+        case SSL_ERROR_WANT_ASYNC:
+        case SSL_ERROR_WANT_CLIENT_HELLO_CB:
+            return SslIOResult::WantAsync;
         default:
             return SslIOResult::Error;
     }
@@ -83,6 +96,15 @@ enum class SslFileType : int {
     ASN1 = SSL_FILETYPE_ASN1,   ///< ASN.1/DER 格式
 };
 
+/**
+ * @brief TLS 1.3 证书压缩算法（RFC 8879），取值即协议中的算法编号
+ */
+enum class SslCertCompression : int {
+    Zlib = 1,       ///< zlib
+    Brotli = 2,     ///< brotli
+    Zstd = 3,       ///< zstd
+};
+
 } // namespace galay::ssl
 
 #endif // GALAY_SSL_DEFN_HPP
@@ -68,6 +68,54 @@ std::string SslError::message() const
         case SslErrorCode::kTimeout:
             oss << "Operation timed out";
             break;
+        case SslErrorCode::kSessionCacheFailed:
+            oss << "Failed to set up session cache";
+            break;
+        case SslErrorCode::kTicketKeyFailed:
+            oss << "Failed to load session ticket keys";
+            break;
+        case SslErrorCode::kEarlyDataFailed:
+            oss << "Early data not available";
+            break;
+        case SslErrorCode::kConnectFailed:
+            oss << "TCP connect failed";
+            break;
+        case SslErrorCode::kHandshakeWantAsync:
+            oss << "SSL handshake waits for private key operation";
+            break;
+        case SslErrorCode::kHandoffFailed:
+            oss << "SSL connection handoff failed";
+            break;
+        case SslErrorCode::kKeyOperationFailed:
+            oss << "Remote private key operation failed";
+            break;
+        case SslErrorCode::kKeySharePoolFailed:
+            oss << "Key share pool creation failed";
+            break;
+        case SslErrorCode::kHandshakeShed:
+            oss << "Handshake shed by admission control";
+            break;
+        case SslErrorCode::kCertRouteFailed:
+            oss << "No certificate route for server name";
+            break;
+        case SslErrorCode::kOcspFailed:
+            oss << "OCSP response unavailable or invalid";
+            break;
+        case SslErrorCode::kCertChainBuildFailed:
+            oss << "Certificate chain build failed";
+            break;
+        case SslErrorCode::kCrlLoadFailed:
+            oss << "CRL load failed";
+            break;
+        case SslErrorCode::kPskConfigFailed:
+            oss << "Pre-shared key configuration invalid";
+            break;
+        case SslErrorCode::kCompressionUnsupported:
+            oss << "Certificate compression unsupported";
+            break;
+        case SslErrorCode::kRawPublicKeyFailed:
+            oss << "Raw public key unsupported or invalid";
+            break;
         case SslErrorCode::kUnknown:
         default:
             oss << "Unknown SSL error";
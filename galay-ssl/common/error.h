@@ -33,6 +33,22 @@ enum class SslErrorCode : uint32_t {
     kALPNSetFailed,             ///< ALPN 设置失败
     kTimeout,                   ///< 操作超时
     kUnknown,                   ///< 未知错误
+    kSessionCacheFailed,        ///< Session 缓存创建或映射失败
+    kTicketKeyFailed,           ///< Session ticket 密钥生成或加载失败
+    kEarlyDataFailed,           ///< early data 无法发送（session 不允许 0-RTT 或握手已开始）
+    kConnectFailed,             ///< TCP 建连失败
+    kHandshakeWantAsync,        ///< 握手等待私钥运算完成
+    kHandoffFailed,             ///< 已握手连接迁移失败
+    kKeyOperationFailed,        ///< 签名进程不可用、拒绝或超时
+    kKeySharePoolFailed,        ///< 临时密钥预生成池创建失败
+    kHandshakeShed,             ///< 握手被准入控制丢弃
+    kCertRouteFailed,           ///< SNI 无匹配证书或证书路由配置无效
+    kOcspFailed,                ///< OCSP 响应获取失败、无效或证书无法确定签发者
+    kCertChainBuildFailed,      ///< 证书链无法构建或校验失败
+    kCrlLoadFailed,             ///< CRL 文件读取、解析或签名校验失败
+    kPskConfigFailed,           ///< PSK 套件、身份或密钥无效
+    kCompressionUnsupported,    ///< OpenSSL 构建不支持所请求的证书压缩算法
+    kRawPublicKeyFailed,        ///< OpenSSL 不支持原始公钥或公钥 / 私钥文件无效
 };
 
 /**
@@ -74,11 +90,12 @@ public:
     bool isSuccess() const { return m_code == SslErrorCode::kSuccess; }
 
     /**
-     * @brief 检查是否需要重试（WANT_READ/WANT_WRITE）
+     * @brief 检查是否需要重试（WANT_READ/WANT_WRITE/WANT_ASYNC）
      */
     bool needsRetry() const {
         return m_code == SslErrorCode::kHandshakeWantRead ||
-               m_code == SslErrorCode::kHandshakeWantWrite;
+               m_code == SslErrorCode::kHandshakeWantWrite ||
+               m_code == SslErrorCode::kHandshakeWantAsync;
     }
 
     /**
@@ -7,8 +7,28 @@ export module galay.ssl;
 export {
 #include "galay-ssl/common/defn.hpp"
 #include "galay-ssl/common/error.h"
+#include "galay-ssl/ssl/ssl_session_cache.h"
+#include "galay-ssl/ssl/ssl_shm_session_cache.h"
+#include "galay-ssl/ssl/ssl_ticket_keys.h"
+#include "galay-ssl/ssl/ssl_client_session_cache.h"
+#include "galay-ssl/ssl/ssl_early_data.h"
+#include "galay-ssl/ssl/ssl_key_offload.h"
+#include "galay-ssl/ssl/ssl_keyless.h"
+#include "galay-ssl/ssl/ssl_key_share_pool.h"
+#include "galay-ssl/ssl/ssl_accept_filter.h"
+#include "galay-ssl/ssl/ssl_cert_router.h"
+#include "galay-ssl/ssl/ssl_context_reloader.h"
+#include "galay-ssl/ssl/ssl_ocsp_stapler.h"
+#include "galay-ssl/ssl/ssl_trust_store.h"
+#include "galay-ssl/ssl/ssl_verify_cache.h"
+#include "galay-ssl/ssl/ssl_crl_index.h"
+#include "galay-ssl/ssl/ssl_psk_store.h"
 #include "galay-ssl/ssl/ssl_context.h"
 #include "galay-ssl/ssl/ssl_engine.h"
 #include "galay-ssl/async/awaitable.h"
+#include "galay-ssl/async/ssl_flush.h"
 #include "galay-ssl/async/ssl_socket.h"
+#include "galay-ssl/async/ssl_connection_pool.h"
+#include "galay-ssl/async/ssl_handshake_admission.h"
+#include "galay-ssl/async/ssl_handshake_pool.h"
 }
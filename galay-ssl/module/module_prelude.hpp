@@ -5,9 +5,21 @@
 #if __has_include(<algorithm>)
 #include <algorithm>
 #endif
+#if __has_include(<array>)
+#include <array>
+#endif
+#if __has_include(<atomic>)
+#include <atomic>
+#endif
 #if __has_include(<cerrno>)
 #include <cerrno>
 #endif
+#if __has_include(<chrono>)
+#include <chrono>
+#endif
+#if __has_include(<condition_variable>)
+#include <condition_variable>
+#endif
 #if __has_include(<coroutine>)
 #include <coroutine>
 #endif
@@ -17,6 +29,9 @@
 #if __has_include(<cstring>)
 #include <cstring>
 #endif
+#if __has_include(<deque>)
+#include <deque>
+#endif
 #if __has_include(<expected>)
 #include <expected>
 #endif
@@ -41,6 +56,9 @@
 #if __has_include(<galay-kernel/kernel/io_scheduler.hpp>)
 #include <galay-kernel/kernel/io_scheduler.hpp>
 #endif
+#if __has_include(<galay-kernel/kernel/task.h>)
+#include <galay-kernel/kernel/task.h>
+#endif
 #if __has_include(<galay-kernel/kernel/timeout.hpp>)
 #include <galay-kernel/kernel/timeout.hpp>
 #endif
@@ -50,9 +68,18 @@
 #if __has_include(<limits>)
 #include <limits>
 #endif
+#if __has_include(<list>)
+#include <list>
+#endif
+#if __has_include(<map>)
+#include <map>
+#endif
 #if __has_include(<memory>)
 #include <memory>
 #endif
+#if __has_include(<mutex>)
+#include <mutex>
+#endif
 #if __has_include(<netinet/in.h>)
 #include <netinet/in.h>
 #endif
@@ -65,6 +92,9 @@
 #if __has_include(<openssl/x509.h>)
 #include <openssl/x509.h>
 #endif
+#if __has_include(<optional>)
+#include <optional>
+#endif
 #if __has_include(<sstream>)
 #include <sstream>
 #endif
@@ -74,6 +104,12 @@
 #if __has_include(<string_view>)
 #include <string_view>
 #endif
+#if __has_include(<shared_mutex>)
+#include <shared_mutex>
+#endif
+#if __has_include(<thread>)
+#include <thread>
+#endif
 #if __has_include(<sys/event.h>)
 #include <sys/event.h>
 #endif
@@ -83,12 +119,21 @@
 #if __has_include(<unistd.h>)
 #include <unistd.h>
 #endif
+#if __has_include(<unordered_map>)
+#include <unordered_map>
+#endif
+#if __has_include(<unordered_set>)
+#include <unordered_set>
+#endif
 #if __has_include(<vector>)
 #include <vector>
 #endif
 #if __has_include("galay-ssl/async/awaitable.h")
 #include "galay-ssl/async/awaitable.h"
 #endif
+#if __has_include("galay-ssl/async/ssl_flush.h")
+#include "galay-ssl/async/ssl_flush.h"
+#endif
 #if __has_include("galay-ssl/async/ssl_socket.h")
 #include "galay-ssl/async/ssl_socket.h"
 #endif
@@ -104,6 +149,54 @@
 #if __has_include("galay-ssl/ssl/ssl_context.h")
 #include "galay-ssl/ssl/ssl_context.h"
 #endif
+#if __has_include("galay-ssl/ssl/ssl_session_cache.h")
+#include "galay-ssl/ssl/ssl_session_cache.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_shm_session_cache.h")
+#include "galay-ssl/ssl/ssl_shm_session_cache.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_ticket_keys.h")
+#include "galay-ssl/ssl/ssl_ticket_keys.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_client_session_cache.h")
+#include "galay-ssl/ssl/ssl_client_session_cache.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_early_data.h")
+#include "galay-ssl/ssl/ssl_early_data.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_key_offload.h")
+#include "galay-ssl/ssl/ssl_key_offload.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_keyless.h")
+#include "galay-ssl/ssl/ssl_keyless.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_key_share_pool.h")
+#include "galay-ssl/ssl/ssl_key_share_pool.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_accept_filter.h")
+#include "galay-ssl/ssl/ssl_accept_filter.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_cert_router.h")
+#include "galay-ssl/ssl/ssl_cert_router.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_context_reloader.h")
+#include "galay-ssl/ssl/ssl_context_reloader.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_ocsp_stapler.h")
+#include "galay-ssl/ssl/ssl_ocsp_stapler.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_trust_store.h")
+#include "galay-ssl/ssl/ssl_trust_store.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_verify_cache.h")
+#include "galay-ssl/ssl/ssl_verify_cache.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_crl_index.h")
+#include "galay-ssl/ssl/ssl_crl_index.h"
+#endif
+#if __has_include("galay-ssl/ssl/ssl_psk_store.h")
+#include "galay-ssl/ssl/ssl_psk_store.h"
+#endif
 #if __has_include("galay-ssl/ssl/ssl_engine.h")
 #include "galay-ssl/ssl/ssl_engine.h"
 #endif
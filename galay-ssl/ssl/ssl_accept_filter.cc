@@ -0,0 +1,330 @@
+#include "ssl_accept_filter.h"
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace galay::ssl
+{
+
+namespace {
+
+constexpr size_t kShards = 16;
+constexpr uint8_t kRecordHandshake = 22;
+constexpr uint8_t kHandshakeClientHello = 1;
+constexpr size_t kMaxRecordLength = 16384;
+
+int64_t toNanos(SslAcceptFilter::Clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+uint64_t mix(uint64_t value)
+{
+    // splitmix64 终结函数
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+uint64_t loadBigEndian(const unsigned char* bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+/**
+ * @brief GCRA 一次判定：允许时推进 tat，拒绝时返回需要等待的纳秒数
+ */
+int64_t gcra(int64_t& tat, int64_t now, int64_t interval, int64_t tolerance)
+{
+    const int64_t next = std::max(tat, now) + interval;
+    const int64_t excess = next - now - tolerance;
+    if (excess > 0) {
+        return excess;
+    }
+    tat = next;
+    return 0;
+}
+
+std::chrono::microseconds waitFor(int64_t nanos)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::nanoseconds(nanos + 999));
+}
+
+} // anonymous namespace
+
+SslAcceptFilter::SslAcceptFilter(SslAcceptFilterOptions options)
+    : m_options(options)
+{
+    if (m_options.perSourceRate > 0.0) {
+        m_sourceInterval = std::max<int64_t>(1, static_cast<int64_t>(1e9 / m_options.perSourceRate));
+        m_sourceTolerance = m_sourceInterval * std::max<uint32_t>(1, m_options.perSourceBurst);
+    }
+    if (m_options.globalRate > 0.0) {
+        m_globalInterval = std::max<int64_t>(1, static_cast<int64_t>(1e9 / m_options.globalRate));
+        m_globalTolerance = m_globalInterval * std::max<uint32_t>(1, m_options.globalBurst);
+    }
+    m_options.ipv6PrefixLength = std::min<uint8_t>(m_options.ipv6PrefixLength, 128);
+
+    std::random_device device;
+    m_seed = (static_cast<uint64_t>(device()) << 32) ^ device();
+
+    const size_t per_shard = std::bit_ceil(std::max(kProbeWindow, m_options.sourceTableSize / kShards));
+    m_shards.reserve(kShards);
+    for (size_t i = 0; i < kShards; ++i) {
+        auto shard = std::make_unique<Shard>();
+        shard->slots.resize(m_sourceInterval > 0 ? per_shard : 0);
+        m_shards.push_back(std::move(shard));
+    }
+    m_shardMask = kShards - 1;
+    m_slotMask = per_shard - 1;
+}
+
+bool SslAcceptFilter::sourceKey(const sockaddr* addr, socklen_t length, SourceKey& key) const
+{
+    unsigned char bytes[16] = {};
+    bool ipv6 = false;
+    if (addr == nullptr) {
+        return false;
+    }
+    if (addr->sa_family == AF_INET && length >= static_cast<socklen_t>(sizeof(sockaddr_in))) {
+        // 按 IPv4 映射地址存放，与 ::ffff:a.b.c.d 的 IPv6 源一致
+        const auto* in = reinterpret_cast<const sockaddr_in*>(addr);
+        bytes[10] = 0xff;
+        bytes[11] = 0xff;
+        std::memcpy(bytes + 12, &in->sin_addr, 4);
+    } else if (addr->sa_family == AF_INET6 && length >= static_cast<socklen_t>(sizeof(sockaddr_in6))) {
+        const auto* in6 = reinterpret_cast<const sockaddr_in6*>(addr);
+        std::memcpy(bytes, &in6->sin6_addr, 16);
+        ipv6 = !IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr);
+    } else {
+        return false;
+    }
+
+    if (ipv6) {
+        const uint8_t prefix = m_options.ipv6PrefixLength;
+        for (size_t i = 0; i < 16; ++i) {
+            const int bits = static_cast<int>(prefix) - static_cast<int>(i * 8);
+            if (bits <= 0) {
+                bytes[i] = 0;
+            } else if (bits < 8) {
+                bytes[i] &= static_cast<unsigned char>(0xff << (8 - bits));
+            }
+        }
+    }
+    key.high = loadBigEndian(bytes);
+    key.low = loadBigEndian(bytes + 8);
+    return true;
+}
+
+uint64_t SslAcceptFilter::hash(const SourceKey& key) const
+{
+    return mix(key.high ^ m_seed) ^ mix(key.low + m_seed);
+}
+
+SslAcceptDecision SslAcceptFilter::checkSource(const SourceKey& key, int64_t now)
+{
+    if (m_sourceInterval == 0) {
+        return {};
+    }
+
+    const uint64_t h = hash(key);
+    Shard& shard = *m_shards[h & m_shardMask];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // 探测窗口内查找；未命中时取空槽，否则淘汰 tat 最小（最久未受限）的条目
+    Slot* found = nullptr;
+    Slot* victim = nullptr;
+    const size_t start = static_cast<size_t>(h >> 4);
+    for (size_t i = 0; i < kProbeWindow; ++i) {
+        Slot& slot = shard.slots[(start + i) & m_slotMask];
+        if (slot.used && slot.key == key) {
+            found = &slot;
+            break;
+        }
+        if (victim == nullptr || (victim->used && (!slot.used || slot.tat < victim->tat))) {
+            victim = &slot;
+        }
+    }
+    if (found == nullptr) {
+        if (victim->used) {
+            m_evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        victim->key = key;
+        victim->tat = 0;
+        victim->used = true;
+        found = victim;
+    }
+
+    if (const int64_t wait = gcra(found->tat, now, m_sourceInterval, m_sourceTolerance); wait > 0) {
+        return SslAcceptDecision{SslAcceptVerdict::RejectSource, waitFor(wait)};
+    }
+    return {};
+}
+
+void SslAcceptFilter::refundSource(const SourceKey& key)
+{
+    if (m_sourceInterval == 0) {
+        return;
+    }
+
+    const uint64_t h = hash(key);
+    Shard& shard = *m_shards[h & m_shardMask];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const size_t start = static_cast<size_t>(h >> 4);
+    for (size_t i = 0; i < kProbeWindow; ++i) {
+        Slot& slot = shard.slots[(start + i) & m_slotMask];
+        if (slot.used && slot.key == key) {
+            // 退回一个间隔；放行前 tat 落后于当时的 now 时退回后仍不超过 now，与未计数等价
+            slot.tat -= m_sourceInterval;
+            return;
+        }
+    }
+}
+
+SslAcceptDecision SslAcceptFilter::checkGlobal(int64_t now)
+{
+    if (m_globalInterval == 0) {
+        return {};
+    }
+    int64_t current = m_globalTat.load(std::memory_order_relaxed);
+    for (;;) {
+        int64_t next = current;
+        if (const int64_t wait = gcra(next, now, m_globalInterval, m_globalTolerance); wait > 0) {
+            return SslAcceptDecision{SslAcceptVerdict::RejectGlobal, waitFor(wait)};
+        }
+        if (m_globalTat.compare_exchange_weak(current, next, std::memory_order_relaxed)) {
+            return {};
+        }
+    }
+}
+
+SslAcceptDecision SslAcceptFilter::check(const sockaddr* addr, socklen_t length, Clock::time_point now)
+{
+    const int64_t now_ns = toNanos(now);
+    SourceKey key;
+    const bool has_source = sourceKey(addr, length, key);
+    if (has_source) {
+        if (auto decision = checkSource(key, now_ns); !decision) {
+            m_rejectedSource.fetch_add(1, std::memory_order_relaxed);
+            return decision;
+        }
+    }
+    // 先查源再查全局，被源速率拒绝的连接不消耗全局预算；被全局拒绝时退回已扣的源令牌
+    if (auto decision = checkGlobal(now_ns); !decision) {
+        if (has_source) {
+            refundSource(key);
+        }
+        m_rejectedGlobal.fetch_add(1, std::memory_order_relaxed);
+        return decision;
+    }
+    m_accepted.fetch_add(1, std::memory_order_relaxed);
+    return {};
+}
+
+SslAcceptDecision SslAcceptFilter::screen(int fd)
+{
+    const int64_t now = toNanos(Clock::now());
+    sockaddr_storage storage{};
+    socklen_t length = sizeof(storage);
+    SourceKey key;
+    const bool has_source = ::getpeername(fd, reinterpret_cast<sockaddr*>(&storage), &length) == 0 &&
+                            sourceKey(reinterpret_cast<const sockaddr*>(&storage), length, key);
+    if (has_source) {
+        if (auto decision = checkSource(key, now); !decision) {
+            m_rejectedSource.fetch_add(1, std::memory_order_relaxed);
+            return decision;
+        }
+    }
+    // 不像 TLS 的连接不消耗全局预算
+    if (m_options.requireClientHello && inspectClientHello(fd) != SslAcceptVerdict::Accept) {
+        return SslAcceptDecision{SslAcceptVerdict::RejectProtocol, {}};
+    }
+    if (auto decision = checkGlobal(now); !decision) {
+        if (has_source) {
+            refundSource(key);
+        }
+        m_rejectedGlobal.fetch_add(1, std::memory_order_relaxed);
+        return decision;
+    }
+    m_accepted.fetch_add(1, std::memory_order_relaxed);
+    return {};
+}
+
+bool SslAcceptFilter::looksLikeClientHello(const unsigned char* data, size_t length)
+{
+    // TLS 记录头：type(1) | version(2) | length(2)，随后是握手消息类型
+    if (length > 0 && data[0] != kRecordHandshake) {
+        return false;
+    }
+    if (length > 1 && data[1] != 0x03) {
+        return false;
+    }
+    if (length > 2 && data[2] > 0x04) {
+        return false;
+    }
+    if (length > 4) {
+        const size_t record = (static_cast<size_t>(data[3]) << 8) | data[4];
+        if (record < 4 || record > kMaxRecordLength) {
+            return false;
+        }
+    }
+    if (length > 5 && data[5] != kHandshakeClientHello) {
+        return false;
+    }
+    return true;
+}
+
+SslAcceptVerdict SslAcceptFilter::inspectClientHello(int fd)
+{
+    unsigned char head[6];
+    ssize_t n = 0;
+    do {
+        n = ::recv(fd, head, sizeof(head), MSG_PEEK | MSG_DONTWAIT);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        m_helloPending.fetch_add(1, std::memory_order_relaxed);
+        return SslAcceptVerdict::Accept;
+    }
+    if (n <= 0 || !looksLikeClientHello(head, static_cast<size_t>(n))) {
+        m_rejectedProtocol.fetch_add(1, std::memory_order_relaxed);
+        return SslAcceptVerdict::RejectProtocol;
+    }
+    return SslAcceptVerdict::Accept;
+}
+
+bool SslAcceptFilter::enableDeferAccept(int listenFd, std::chrono::seconds timeout)
+{
+#ifdef TCP_DEFER_ACCEPT
+    const int seconds = static_cast<int>(std::clamp<int64_t>(timeout.count(), 1, std::numeric_limits<int>::max()));
+    return ::setsockopt(listenFd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &seconds, sizeof(seconds)) == 0;
+#else
+    (void)listenFd;
+    (void)timeout;
+    return false;
+#endif
+}
+
+SslAcceptFilterStats SslAcceptFilter::stats() const
+{
+    SslAcceptFilterStats result;
+    result.accepted = m_accepted.load(std::memory_order_relaxed);
+    result.rejectedSource = m_rejectedSource.load(std::memory_order_relaxed);
+    result.rejectedGlobal = m_rejectedGlobal.load(std::memory_order_relaxed);
+    result.rejectedProtocol = m_rejectedProtocol.load(std::memory_order_relaxed);
+    result.helloPending = m_helloPending.load(std::memory_order_relaxed);
+    result.evictions = m_evictions.load(std::memory_order_relaxed);
+    return result;
+}
+
+} // namespace galay::ssl
@@ -0,0 +1,184 @@
+#ifndef GALAY_SSL_ACCEPT_FILTER_H
+#define GALAY_SSL_ACCEPT_FILTER_H
+
+#include <sys/socket.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 接入过滤配置
+ */
+struct SslAcceptFilterOptions {
+    double perSourceRate = 20.0;        ///< 每个源地址每秒允许的新连接数，<= 0 表示不按源限速
+    uint32_t perSourceBurst = 40;       ///< 每个源地址允许的突发连接数
+    double globalRate = 0.0;            ///< 全局每秒握手预算，<= 0 表示不限
+    uint32_t globalBurst = 256;         ///< 全局允许的突发连接数
+    size_t sourceTableSize = 65536;     ///< 源地址表条目数（按分片均分、向上取 2 的幂），内存固定
+    uint8_t ipv6PrefixLength = 64;      ///< IPv6 源地址按该前缀聚合
+    bool requireClientHello = true;     ///< screen() 是否检查首字节像 TLS ClientHello
+};
+
+/**
+ * @brief 接入过滤结论
+ */
+enum class SslAcceptVerdict : uint8_t {
+    Accept,             ///< 放行
+    RejectSource,       ///< 该源地址超出速率
+    RejectGlobal,       ///< 超出全局握手预算
+    RejectProtocol,     ///< 首字节不是 TLS ClientHello，或对端已关闭
+};
+
+/**
+ * @brief 接入过滤结果
+ */
+struct SslAcceptDecision {
+    SslAcceptVerdict verdict = SslAcceptVerdict::Accept;
+    std::chrono::microseconds retryAfter{0};    ///< 速率拒绝时，距离下一次可放行的时间
+
+    explicit operator bool() const { return verdict == SslAcceptVerdict::Accept; }
+};
+
+/**
+ * @brief 接入过滤统计
+ */
+struct SslAcceptFilterStats {
+    uint64_t accepted = 0;          ///< 放行的连接数
+    uint64_t rejectedSource = 0;    ///< 因源地址速率拒绝的连接数
+    uint64_t rejectedGlobal = 0;    ///< 因全局预算拒绝的连接数
+    uint64_t rejectedProtocol = 0;  ///< 因首字节不像 ClientHello 或对端已关闭拒绝的连接数
+    uint64_t helloPending = 0;      ///< 检查时 ClientHello 尚未到达、按放行处理的连接数
+    uint64_t evictions = 0;         ///< 源地址表满时淘汰的条目数
+};
+
+/**
+ * @brief 握手前的接入过滤
+ *
+ * @details 在 accept 之后、创建 SslSocket / SSL 对象之前调用，被拒绝的连接只花一次
+ * getpeername 与一次 MSG_PEEK 读：
+ * - 每个源地址一个令牌桶（GCRA，只存一个理论到达时间），IPv4 按地址、IPv6 按前缀聚合；
+ * - 全局握手预算同样是 GCRA，以单个原子量实现，无锁；
+ * - 首字节检查：TLS 记录头为 handshake(22)、版本 3.x、长度合法，且消息类型为 ClientHello。
+ *
+ * 源地址表是固定大小的分片开放寻址表，每次查找至多探测 kProbeWindow 个槽位，
+ * 未命中时淘汰窗口内最久未受限的条目，因此每次检查 O(1)、内存不随源地址数增长。
+ * 哈希带每个实例的随机种子，攻击者无法构造集中碰撞。
+ *
+ * @example
+ * @code
+ * auto filter = std::make_shared<SslAcceptFilter>(SslAcceptFilterOptions{.perSourceRate = 10, .globalRate = 2000});
+ * SslAcceptFilter::enableDeferAccept(listener.handle().fd);
+ *
+ * auto accepted = co_await listener.accept(&client_host);
+ * if (accepted && !filter->screen(accepted->fd)) {
+ *     ::close(accepted->fd);              // 没有分配任何 SSL 资源
+ * }
+ * @endcode
+ *
+ * @note 线程安全，多个 worker 可以共享同一个过滤器
+ */
+class SslAcceptFilter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 每次查找探测的槽位数
+     */
+    static constexpr size_t kProbeWindow = 4;
+
+    explicit SslAcceptFilter(SslAcceptFilterOptions options = {});
+
+    SslAcceptFilter(const SslAcceptFilter&) = delete;
+    SslAcceptFilter& operator=(const SslAcceptFilter&) = delete;
+
+    /**
+     * @brief 对已接受的连接做完整检查：源地址速率、首字节、全局预算
+     * @param fd accept 得到的套接字
+     * @details 首字节尚未到达时按放行处理（计入 helloPending），由握手本身校验；
+     * 监听套接字开启 enableDeferAccept() 后这种情况很少出现
+     */
+    SslAcceptDecision screen(int fd);
+
+    /**
+     * @brief 只按源地址与全局预算检查（不读套接字）
+     */
+    SslAcceptDecision check(const sockaddr* addr, socklen_t length, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 只检查已到达的首字节是否像 TLS ClientHello（MSG_PEEK，不消费数据）
+     * @return Accept 或 RejectProtocol；尚无数据时返回 Accept
+     */
+    SslAcceptVerdict inspectClientHello(int fd);
+
+    /**
+     * @brief 判断一段首字节是否可能是 TLS ClientHello 的开头
+     */
+    static bool looksLikeClientHello(const unsigned char* data, size_t length);
+
+    /**
+     * @brief 在监听套接字上开启 TCP_DEFER_ACCEPT：数据到达后才完成 accept
+     * @return 平台不支持或设置失败时返回 false
+     */
+    static bool enableDeferAccept(int listenFd, std::chrono::seconds timeout = std::chrono::seconds(5));
+
+    /**
+     * @brief 统计快照
+     */
+    SslAcceptFilterStats stats() const;
+
+    const SslAcceptFilterOptions& options() const { return m_options; }
+
+private:
+    struct SourceKey {
+        uint64_t high = 0;
+        uint64_t low = 0;
+
+        bool operator==(const SourceKey&) const = default;
+    };
+
+    struct Slot {
+        SourceKey key;
+        int64_t tat = 0;        ///< 理论到达时间（ns）
+        bool used = false;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::vector<Slot> slots;
+    };
+
+    bool sourceKey(const sockaddr* addr, socklen_t length, SourceKey& key) const;
+    SslAcceptDecision checkSource(const SourceKey& key, int64_t now);
+    void refundSource(const SourceKey& key);
+    SslAcceptDecision checkGlobal(int64_t now);
+    uint64_t hash(const SourceKey& key) const;
+
+    SslAcceptFilterOptions m_options;
+    int64_t m_sourceInterval = 0;
+    int64_t m_sourceTolerance = 0;
+    int64_t m_globalInterval = 0;
+    int64_t m_globalTolerance = 0;
+    uint64_t m_seed = 0;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    size_t m_shardMask = 0;
+    size_t m_slotMask = 0;
+    std::atomic<int64_t> m_globalTat{0};
+    std::atomic<uint64_t> m_accepted{0};
+    std::atomic<uint64_t> m_rejectedSource{0};
+    std::atomic<uint64_t> m_rejectedGlobal{0};
+    std::atomic<uint64_t> m_rejectedProtocol{0};
+    std::atomic<uint64_t> m_helloPending{0};
+    std::atomic<uint64_t> m_evictions{0};
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_ACCEPT_FILTER_H
@@ -0,0 +1,543 @@
+#include "ssl_cert_router.h"
+#include "ssl_engine.h"
+#include <dirent.h>
+#include <openssl/ssl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace galay::ssl
+{
+
+namespace {
+
+constexpr size_t kMaxHostLength = 253;
+
+/**
+ * @brief 主机名转小写并去掉结尾的点；含空标签、超长或非法字符时返回空串
+ */
+std::string normalizeHost(std::string_view name, bool allowWildcard)
+{
+    if (!name.empty() && name.back() == '.') {
+        name.remove_suffix(1);
+    }
+    if (name.empty() || name.size() > kMaxHostLength) {
+        return {};
+    }
+    std::string result;
+    result.reserve(name.size());
+    size_t label_length = 0;
+    for (size_t i = 0; i < name.size(); ++i) {
+        const char c = name[i];
+        if (c == '.') {
+            if (label_length == 0) {
+                return {};
+            }
+            label_length = 0;
+        } else if (c == '*') {
+            // 通配符只能独占最左侧标签
+            if (!allowWildcard || i != 0 || name.size() < 3 || name[1] != '.') {
+                return {};
+            }
+            ++label_length;
+        } else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_') {
+            ++label_length;
+        } else if (c >= 'A' && c <= 'Z') {
+            ++label_length;
+            result.push_back(static_cast<char>(c - 'A' + 'a'));
+            continue;
+        } else {
+            return {};
+        }
+        result.push_back(c);
+    }
+    return label_length == 0 ? std::string{} : result;
+}
+
+/**
+ * @brief 从 server_name 扩展中取出第一个 host_name（RFC 6066 §3）
+ */
+std::string_view parseServerName(const unsigned char* data, size_t length)
+{
+    if (length < 2) {
+        return {};
+    }
+    const size_t list_length = (static_cast<size_t>(data[0]) << 8) | data[1];
+    if (list_length + 2 != length) {
+        return {};
+    }
+    size_t offset = 2;
+    while (offset + 3 <= length) {
+        const unsigned char type = data[offset];
+        const size_t name_length = (static_cast<size_t>(data[offset + 1]) << 8) | data[offset + 2];
+        offset += 3;
+        if (offset + name_length > length) {
+            return {};
+        }
+        if (type == TLSEXT_NAMETYPE_host_name) {
+            return std::string_view(reinterpret_cast<const char*>(data + offset), name_length);
+        }
+        offset += name_length;
+    }
+    return {};
+}
+
+void freePinnedContext(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+{
+    delete static_cast<std::shared_ptr<SslContext>*>(ptr);
+}
+
+/**
+ * @brief SSL 上的 ex_data 槽位：持有连接所用主机上下文的引用
+ */
+int pinIndex()
+{
+    static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, freePinnedContext);
+    return index;
+}
+
+} // anonymous namespace
+
+/**
+ * @brief 一个等待主机加载的握手：socketpair 读端交给事件循环，加载线程写端通知
+ *
+ * @details 同时由连接（ex_data）与主机的等待列表持有，连接先释放时加载线程仍可安全通知
+ */
+struct SslCertRouter::RetryWaiter {
+    int readFd = -1;
+    int notifyFd = -1;
+    uint32_t host = 0;          ///< 等待的主机
+    uint64_t completed = 0;     ///< 开始等待时主机已结束的加载次数
+
+    ~RetryWaiter()
+    {
+        if (readFd >= 0) {
+            ::close(readFd);
+            ::close(notifyFd);
+        }
+    }
+
+    void notify() const
+    {
+        const char byte = 1;
+        (void)::send(notifyFd, &byte, 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+
+    void drain() const
+    {
+        char buffer[16];
+        while (::recv(readFd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+        }
+    }
+};
+
+void SslCertRouter::freeRetryWaiter(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+{
+    delete static_cast<std::shared_ptr<RetryWaiter>*>(ptr);
+}
+
+int SslCertRouter::waiterIndex()
+{
+    static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, freeRetryWaiter);
+    return index;
+}
+
+SslCertRouter::SslCertRouter(SslCertRouterOptions options)
+    : m_options(std::move(options))
+{
+    m_options.capacity = std::max<size_t>(1, m_options.capacity);
+    m_options.loadThreads = std::max<size_t>(1, m_options.loadThreads);
+    m_defaultHost = normalizeHost(m_options.defaultHost, false);
+    m_nodes.emplace_back();
+}
+
+SslCertRouter::~SslCertRouter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_loadCv.notify_all();
+    for (auto& loader : m_loaders) {
+        loader.join();
+    }
+}
+
+std::expected<std::shared_ptr<SslCertRouter>, SslError> SslCertRouter::create(SslCertRouterOptions options)
+{
+    std::shared_ptr<SslCertRouter> router(new SslCertRouter(std::move(options)));
+
+    router->m_front = std::make_unique<SslContext>(router->m_options.method);
+    if (!router->m_front->isValid()) {
+        return std::unexpected(router->m_front->error());
+    }
+    if (router->m_options.configure) {
+        if (auto configured = router->m_options.configure(*router->m_front); !configured) {
+            return std::unexpected(configured.error());
+        }
+    }
+    SSL_CTX_set_client_hello_cb(router->m_front->native(), &SslCertRouter::onClientHello, router.get());
+    // 主机未驻留时 ClientHello 回调返回 RETRY，握手需要等待加载线程
+    router->m_front->setAsyncHandshake(true);
+
+    for (size_t i = 0; i < router->m_options.loadThreads; ++i) {
+        router->m_loaders.emplace_back([raw = router.get()] { raw->loaderLoop(); });
+    }
+
+    if (!router->m_options.directory.empty()) {
+        if (auto scanned = router->scanDirectory(); !scanned) {
+            return std::unexpected(scanned.error());
+        }
+    }
+    return router;
+}
+
+std::expected<void, SslError> SslCertRouter::scanDirectory()
+{
+    DIR* dir = ::opendir(m_options.directory.c_str());
+    if (dir == nullptr) {
+        return std::unexpected(SslError(SslErrorCode::kCertRouteFailed));
+    }
+    const std::string& suffix = m_options.certSuffix;
+    while (const dirent* entry = ::readdir(dir)) {
+        std::string_view file = entry->d_name;
+        if (file.size() <= suffix.size() || !file.ends_with(suffix)) {
+            continue;
+        }
+        const std::string stem(file.substr(0, file.size() - suffix.size()));
+        const std::string pattern = stem.starts_with("_.") ? "*" + stem.substr(1) : stem;
+        // 文件名不是合法主机名的证书被忽略
+        (void)addHost(pattern,
+                      m_options.directory + "/" + std::string(file),
+                      m_options.directory + "/" + stem + m_options.keySuffix);
+    }
+    ::closedir(dir);
+    return {};
+}
+
+std::expected<void, SslError> SslCertRouter::addHost(std::string_view pattern, std::string certFile, std::string keyFile)
+{
+    const std::string host = normalizeHost(pattern, true);
+    if (host.empty() || host == "*") {
+        return std::unexpected(SslError(SslErrorCode::kCertRouteFailed));
+    }
+    const bool wildcard = host.starts_with("*.");
+    const std::string_view labels = wildcard ? std::string_view(host).substr(2) : std::string_view(host);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // 反转标签逐级插入：www.example.com → com → example → www
+    uint32_t node = 0;
+    size_t end = labels.size();
+    for (;;) {
+        const size_t dot = labels.rfind('.', end - 1);
+        const size_t begin = dot == std::string_view::npos ? 0 : dot + 1;
+        const std::string_view label = labels.substr(begin, end - begin);
+        auto it = m_nodes[node].children.find(label);
+        if (it == m_nodes[node].children.end()) {
+            const auto child = static_cast<uint32_t>(m_nodes.size());
+            m_nodes[node].children.emplace(std::string(label), child);
+            m_nodes.emplace_back();
+            node = child;
+        } else {
+            node = it->second;
+        }
+        if (dot == std::string_view::npos) {
+            break;
+        }
+        end = dot;
+    }
+
+    int32_t& slot = wildcard ? m_nodes[node].wildcard : m_nodes[node].exact;
+    if (slot < 0) {
+        slot = static_cast<int32_t>(m_hosts.size());
+        Host& added = m_hosts.emplace_back();
+        added.pattern = host;
+        added.certFile = std::move(certFile);
+        added.keyFile = std::move(keyFile);
+        return {};
+    }
+    Host& existing = m_hosts[static_cast<size_t>(slot)];
+    existing.certFile = std::move(certFile);
+    existing.keyFile = std::move(keyFile);
+    ++existing.generation;
+    existing.failure.reset();
+    if (existing.ctx) {
+        m_lru.erase(existing.lru);
+        existing.ctx.reset();
+    }
+    return {};
+}
+
+int32_t SslCertRouter::lookup(std::string_view name) const
+{
+    int32_t candidate = -1;
+    uint32_t node = 0;
+    size_t end = name.size();
+    for (;;) {
+        const size_t dot = name.rfind('.', end - 1);
+        const bool leftmost = dot == std::string_view::npos;
+        // 通配符只匹配最左侧的一个标签
+        if (leftmost && m_nodes[node].wildcard >= 0) {
+            candidate = m_nodes[node].wildcard;
+        }
+        const size_t begin = leftmost ? 0 : dot + 1;
+        auto it = m_nodes[node].children.find(name.substr(begin, end - begin));
+        if (it == m_nodes[node].children.end()) {
+            return candidate;
+        }
+        node = it->second;
+        if (leftmost) {
+            return m_nodes[node].exact >= 0 ? m_nodes[node].exact : candidate;
+        }
+        end = dot;
+    }
+}
+
+void SslCertRouter::touch(uint32_t index)
+{
+    m_lru.splice(m_lru.begin(), m_lru, m_hosts[index].lru);
+}
+
+void SslCertRouter::evictOne()
+{
+    const uint32_t index = m_lru.back();
+    m_lru.pop_back();
+    // 仍在使用该上下文的连接各自持有引用，淘汰只影响之后的握手
+    m_hosts[index].ctx.reset();
+    m_evictions.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::expected<std::shared_ptr<SslContext>, SslError> SslCertRouter::load(const std::string& certFile,
+                                                                        const std::string& keyFile) const
+{
+    auto ctx = std::make_shared<SslContext>(m_options.method);
+    if (!ctx->isValid()) {
+        return std::unexpected(ctx->error());
+    }
+    if (auto loaded = ctx->loadCertificateChain(certFile); !loaded) {
+        return std::unexpected(loaded.error());
+    }
+    if (auto loaded = ctx->loadPrivateKey(keyFile); !loaded) {
+        return std::unexpected(loaded.error());
+    }
+    if (m_options.configure) {
+        if (auto configured = m_options.configure(*ctx); !configured) {
+            return std::unexpected(configured.error());
+        }
+    }
+    return ctx;
+}
+
+int32_t SslCertRouter::resolveLocked(const std::string& name)
+{
+    int32_t found = name.empty() ? -1 : lookup(name);
+    if (found < 0 && !m_defaultHost.empty()) {
+        found = lookup(m_defaultHost);
+    }
+    if (found < 0) {
+        m_unknown.fetch_add(1, std::memory_order_relaxed);
+    }
+    return found;
+}
+
+void SslCertRouter::startLoadLocked(uint32_t index)
+{
+    if (m_hosts[index].loading) {
+        return;
+    }
+    m_hosts[index].loading = true;
+    m_pending.push_back(index);
+    m_loadCv.notify_one();
+}
+
+void SslCertRouter::finishLoadLocked(uint32_t index, uint64_t generation,
+                                     std::expected<std::shared_ptr<SslContext>, SslError> loaded)
+{
+    Host& host = m_hosts[index];
+    if (host.generation != generation) {
+        // 加载期间文件被替换：丢弃结果按新文件重新加载，等待者继续等待
+        m_pending.push_back(index);
+        m_loadCv.notify_one();
+        return;
+    }
+
+    host.loading = false;
+    ++host.completed;
+    if (!loaded) {
+        m_loadFailures.fetch_add(1, std::memory_order_relaxed);
+        host.failure = loaded.error();
+    } else {
+        m_loads.fetch_add(1, std::memory_order_relaxed);
+        host.failure.reset();
+        host.ctx = std::move(*loaded);
+        m_lru.push_front(index);
+        host.lru = m_lru.begin();
+        while (m_lru.size() > m_options.capacity) {
+            evictOne();
+        }
+    }
+
+    for (const auto& waiter : host.waiters) {
+        waiter->notify();
+    }
+    host.waiters.clear();
+    m_loadedCv.notify_all();
+}
+
+void SslCertRouter::loaderLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_loadCv.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+        if (m_stopping) {
+            return;
+        }
+        const uint32_t index = m_pending.front();
+        m_pending.pop_front();
+        const std::string cert_file = m_hosts[index].certFile;
+        const std::string key_file = m_hosts[index].keyFile;
+        const uint64_t generation = m_hosts[index].generation;
+
+        // 解析证书与私钥不持锁，其他主机的握手不被阻塞
+        lock.unlock();
+        auto loaded = load(cert_file, key_file);
+        lock.lock();
+        finishLoadLocked(index, generation, std::move(loaded));
+    }
+}
+
+std::expected<std::shared_ptr<SslContext>, SslError> SslCertRouter::select(std::string_view serverName)
+{
+    const std::string name = normalizeHost(serverName, false);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const int32_t found = resolveLocked(name);
+    if (found < 0) {
+        return std::unexpected(SslError(SslErrorCode::kCertRouteFailed));
+    }
+
+    const auto index = static_cast<uint32_t>(found);
+    if (m_hosts[index].ctx) {
+        touch(index);
+        m_hits.fetch_add(1, std::memory_order_relaxed);
+        return m_hosts[index].ctx;
+    }
+    for (;;) {
+        // 与其他 select() 和握手共用同一次加载
+        const uint64_t completed = m_hosts[index].completed;
+        startLoadLocked(index);
+        m_loadedCv.wait(lock, [&] { return m_hosts[index].completed != completed; });
+
+        const Host& host = m_hosts[index];
+        if (host.ctx) {
+            return host.ctx;
+        }
+        if (host.failure) {
+            return std::unexpected(*host.failure);
+        }
+        // 加载成功但在被唤醒前已被淘汰：重新加载
+    }
+}
+
+int SslCertRouter::routeClientHello(SSL* ssl, std::string_view serverName, int* alert)
+{
+    const std::string name = normalizeHost(serverName, false);
+    auto* waiter = static_cast<std::shared_ptr<RetryWaiter>*>(SSL_get_ex_data(ssl, waiterIndex()));
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const int32_t found = resolveLocked(name);
+    if (found < 0) {
+        *alert = SSL_AD_UNRECOGNIZED_NAME;
+        return SSL_CLIENT_HELLO_ERROR;
+    }
+
+    const auto index = static_cast<uint32_t>(found);
+    Host& host = m_hosts[index];
+    std::shared_ptr<SslContext> ctx = host.ctx;
+    if (ctx) {
+        touch(index);
+        m_hits.fetch_add(1, std::memory_order_relaxed);
+    } else if (waiter != nullptr && (*waiter)->host == index && (*waiter)->completed != host.completed &&
+               host.failure) {
+        // 本连接等待的加载已失败
+        *alert = SSL_AD_INTERNAL_ERROR;
+        return SSL_CLIENT_HELLO_ERROR;
+    } else {
+        // 冷主机：交给后台加载，加载结束时等待 fd 变为可读，握手再次进入回调
+        if (waiter == nullptr) {
+            int fds[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) != 0) {
+                *alert = SSL_AD_INTERNAL_ERROR;
+                return SSL_CLIENT_HELLO_ERROR;
+            }
+            auto created = std::make_shared<RetryWaiter>();
+            created->readFd = fds[0];
+            created->notifyFd = fds[1];
+            waiter = new std::shared_ptr<RetryWaiter>(std::move(created));
+            SSL_set_ex_data(ssl, waiterIndex(), waiter);
+        }
+        (*waiter)->drain();
+        (*waiter)->host = index;
+        (*waiter)->completed = host.completed;
+        if (std::find(host.waiters.begin(), host.waiters.end(), *waiter) == host.waiters.end()) {
+            host.waiters.push_back(*waiter);
+        }
+        startLoadLocked(index);
+        m_retries.fetch_add(1, std::memory_order_relaxed);
+        detail::setRetryWaitFd(ssl, (*waiter)->readFd);
+        return SSL_CLIENT_HELLO_RETRY;
+    }
+    lock.unlock();
+
+    if (waiter != nullptr) {
+        detail::setRetryWaitFd(ssl, -1);
+    }
+    if (SSL_get_SSL_CTX(ssl) != ctx->native() && SSL_set_SSL_CTX(ssl, ctx->native()) == nullptr) {
+        *alert = SSL_AD_INTERNAL_ERROR;
+        return SSL_CLIENT_HELLO_ERROR;
+    }
+    // 后端上下文的 ClientHello 回调不会执行，双证书时在这里按对端能力选择
+    if (!detail::preferEcdsaCertificate(ssl)) {
+        *alert = SSL_AD_INTERNAL_ERROR;
+        return SSL_CLIENT_HELLO_ERROR;
+    }
+
+    // HelloRetryRequest 后回调会再次进入，复用已有的槽位
+    auto* pinned = static_cast<std::shared_ptr<SslContext>*>(SSL_get_ex_data(ssl, pinIndex()));
+    if (pinned != nullptr) {
+        *pinned = std::move(ctx);
+    } else {
+        SSL_set_ex_data(ssl, pinIndex(), new std::shared_ptr<SslContext>(std::move(ctx)));
+    }
+    return SSL_CLIENT_HELLO_SUCCESS;
+}
+
+int SslCertRouter::onClientHello(SSL* ssl, int* alert, void* arg)
+{
+    auto* router = static_cast<SslCertRouter*>(arg);
+
+    std::string_view server_name;
+    const unsigned char* extension = nullptr;
+    size_t length = 0;
+    if (SSL_client_hello_get0_ext(ssl, TLSEXT_TYPE_server_name, &extension, &length) == 1) {
+        server_name = parseServerName(extension, length);
+    }
+    return router->routeClientHello(ssl, server_name, alert);
+}
+
+SslCertRouterStats SslCertRouter::stats() const
+{
+    SslCertRouterStats result;
+    result.hits = m_hits.load(std::memory_order_relaxed);
+    result.loads = m_loads.load(std::memory_order_relaxed);
+    result.loadFailures = m_loadFailures.load(std::memory_order_relaxed);
+    result.retries = m_retries.load(std::memory_order_relaxed);
+    result.evictions = m_evictions.load(std::memory_order_relaxed);
+    result.unknown = m_unknown.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    result.hosts = m_hosts.size();
+    result.resident = m_lru.size();
+    return result;
+}
+
+} // namespace galay::ssl
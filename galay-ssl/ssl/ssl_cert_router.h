@@ -0,0 +1,206 @@
+#ifndef GALAY_SSL_CERT_ROUTER_H
+#define GALAY_SSL_CERT_ROUTER_H
+
+#include "galay-ssl/common/defn.hpp"
+#include "galay-ssl/common/error.h"
+#include "galay-ssl/ssl/ssl_context.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief SNI 证书路由配置
+ */
+struct SslCertRouterOptions {
+    SslMethod method = SslMethod::TLS_Server;   ///< 前端与各主机上下文的协议方法
+    std::string directory;                      ///< 证书目录，空表示只用 addHost()
+    std::string certSuffix = ".crt";            ///< 目录中证书（可含中间证书链）文件的后缀
+    std::string keySuffix = ".key";             ///< 目录中私钥文件的后缀
+    size_t capacity = 1024;                     ///< 同时驻留的主机上下文上限，超出按 LRU 淘汰
+    size_t loadThreads = 1;                     ///< 后台加载证书的线程数
+    std::string defaultHost;                    ///< 无 SNI 或未匹配时使用的主机（须已登记），空表示拒绝握手
+    /**
+     * @brief 每个新建上下文（含前端上下文）创建后调用，用于设置 ALPN、协议版本、密码套件等
+     */
+    std::function<std::expected<void, SslError>(SslContext&)> configure;
+};
+
+/**
+ * @brief SNI 证书路由统计
+ */
+struct SslCertRouterStats {
+    uint64_t hits = 0;          ///< 命中已驻留上下文的握手数
+    uint64_t loads = 0;         ///< 从磁盘加载上下文的次数（同一主机的并发访问只加载一次）
+    uint64_t retries = 0;       ///< 因主机尚未加载而让握手稍后重试的次数
+    uint64_t loadFailures = 0;  ///< 证书或私钥加载失败的次数
+    uint64_t evictions = 0;     ///< 被 LRU 淘汰的上下文数
+    uint64_t unknown = 0;       ///< 无匹配证书且没有默认主机而被拒绝的握手数
+    size_t hosts = 0;           ///< 已登记的主机名（含通配符）数
+    size_t resident = 0;        ///< 当前驻留的上下文数
+};
+
+/**
+ * @brief 按 SNI 选择证书的多租户路由
+ *
+ * @details 前端上下文 context() 交给监听套接字；它的 ClientHello 回调从 SNI 扩展取出主机名，
+ * 在反转标签的字典树中查找（com → example → www），精确匹配优先，其次是只匹配一个标签的
+ * 通配符（*.example.com 匹配 a.example.com，不匹配 example.com 与 a.b.example.com），
+ * 再以 SSL_set_SSL_CTX() 把连接切到对应主机的上下文。
+ *
+ * 证书按需加载：create() 只列出目录中的文件名登记主机，不解析证书；某个主机第一次被访问时
+ * 才加载证书与私钥，驻留在容量为 capacity 的 LRU 中。启动时间和常驻内存因此与活跃主机数
+ * 而不是证书总数相关。连接持有所用主机上下文的引用，被淘汰的上下文在最后一个连接结束后释放。
+ *
+ * 加载在 loadThreads 个后台线程上进行，同一主机同时只有一次加载（single-flight）：握手遇到尚未
+ * 驻留的主机时 ClientHello 回调返回 SSL_CLIENT_HELLO_RETRY，SslEngine::doHandshake() 得到
+ * WantAsync，asyncWaitFd() 在加载完成（成功或失败）时变为可读，再次推进握手即可继续或以失败告终。
+ *
+ * 目录约定：<host><certSuffix> 与 <host><keySuffix> 成对，通配符证书的文件名以 "_." 开头
+ * （_.example.com.crt 登记为 *.example.com）。
+ *
+ * @example
+ * @code
+ * auto router = SslCertRouter::create({
+ *     .directory = "/etc/galay/certs",
+ *     .capacity = 4096,
+ *     .configure = [](SslContext& ctx) { return ctx.setALPNProtocols({"h2", "http/1.1"}); },
+ * });
+ * SslSocket listener((*router)->context());
+ * @endcode
+ *
+ * @note
+ * - 线程安全，多个 worker 可以共享同一个路由与前端上下文；路由必须比使用前端上下文的连接活得更久
+ * - 握手线程不解析证书；select() 会阻塞等待后台加载，可用于启动时预热
+ * - session 缓存与 ticket 密钥以前端上下文为准（OpenSSL 按初始 SSL_CTX 恢复会话），应在 configure 中统一设置
+ */
+class SslCertRouter
+{
+public:
+    /**
+     * @brief 创建前端上下文并登记目录中的主机
+     * @return 目录无法读取、前端上下文创建失败或 configure 失败时返回错误
+     */
+    static std::expected<std::shared_ptr<SslCertRouter>, SslError> create(SslCertRouterOptions options = {});
+
+    ~SslCertRouter();
+
+    SslCertRouter(const SslCertRouter&) = delete;
+    SslCertRouter& operator=(const SslCertRouter&) = delete;
+
+    /**
+     * @brief 前端上下文，交给监听套接字 / SslSocket
+     */
+    SslContext* context() const { return m_front.get(); }
+
+    /**
+     * @brief 登记或替换一个主机
+     * @param pattern 主机名或 *.domain 形式的通配符，大小写不敏感
+     * @details 替换已驻留的主机时丢弃其上下文，下一次访问按新文件加载
+     * @return 主机名不合法时返回 kCertRouteFailed
+     */
+    std::expected<void, SslError> addHost(std::string_view pattern, std::string certFile, std::string keyFile);
+
+    /**
+     * @brief 按主机名选择上下文，未驻留时等待后台加载完成
+     * @param serverName SNI 主机名，空串表示客户端未发送 SNI
+     * @return 无匹配且没有默认主机时返回 kCertRouteFailed；加载失败时返回证书 / 私钥错误
+     */
+    std::expected<std::shared_ptr<SslContext>, SslError> select(std::string_view serverName);
+
+    /**
+     * @brief 统计快照
+     */
+    SslCertRouterStats stats() const;
+
+    const SslCertRouterOptions& options() const { return m_options; }
+
+private:
+    /**
+     * @brief 支持以 string_view 查找的标签哈希
+     */
+    struct LabelHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view label) const { return std::hash<std::string_view>{}(label); }
+    };
+
+    struct RetryWaiter;
+
+    struct Node {
+        std::unordered_map<std::string, uint32_t, LabelHash, std::equal_to<>> children;
+        int32_t exact = -1;     ///< 以该节点结尾的精确主机
+        int32_t wildcard = -1;  ///< 该节点之下一个标签的通配符主机
+    };
+
+    struct Host {
+        std::string pattern;
+        std::string certFile;
+        std::string keyFile;
+        std::shared_ptr<SslContext> ctx;
+        std::list<uint32_t>::iterator lru;
+        uint64_t generation = 0;    ///< addHost() 替换文件时递增，丢弃替换前开始的加载
+        bool loading = false;       ///< 已排队或正在后台加载
+        uint64_t completed = 0;     ///< 已结束的加载次数，等待者据此判断自己等的加载是否结束
+        std::optional<SslError> failure;                    ///< 最近一次加载的错误
+        std::vector<std::shared_ptr<RetryWaiter>> waiters;  ///< 等待本次加载的握手
+    };
+
+    explicit SslCertRouter(SslCertRouterOptions options);
+
+    std::expected<void, SslError> scanDirectory();
+    int32_t lookup(std::string_view name) const;
+    int32_t resolveLocked(const std::string& name);
+    void startLoadLocked(uint32_t index);
+    void finishLoadLocked(uint32_t index, uint64_t generation,
+                          std::expected<std::shared_ptr<SslContext>, SslError> loaded);
+    void loaderLoop();
+    int routeClientHello(SSL* ssl, std::string_view serverName, int* alert);
+    std::expected<std::shared_ptr<SslContext>, SslError> load(const std::string& certFile,
+                                                              const std::string& keyFile) const;
+    void touch(uint32_t index);
+    void evictOne();
+    static int onClientHello(SSL* ssl, int* alert, void* arg);
+    /**
+     * @brief SSL 上的 ex_data 槽位：等待后台加载的握手所用的 RetryWaiter
+     */
+    static int waiterIndex();
+    static void freeRetryWaiter(void* parent, void* ptr, CRYPTO_EX_DATA* ad, int index, long argl, void* argp);
+
+    SslCertRouterOptions m_options;
+    std::unique_ptr<SslContext> m_front;
+    mutable std::mutex m_mutex;
+    std::vector<Node> m_nodes;
+    std::vector<Host> m_hosts;
+    std::list<uint32_t> m_lru;      ///< 驻留主机，最近使用的在前
+    std::string m_defaultHost;      ///< 规范化后的默认主机
+    std::deque<uint32_t> m_pending;         ///< 等待后台加载的主机
+    std::condition_variable m_loadCv;       ///< 唤醒加载线程
+    std::condition_variable m_loadedCv;     ///< 唤醒等待加载结果的 select()
+    std::vector<std::thread> m_loaders;
+    bool m_stopping = false;
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_loads{0};
+    std::atomic<uint64_t> m_loadFailures{0};
+    std::atomic<uint64_t> m_retries{0};
+    std::atomic<uint64_t> m_evictions{0};
+    std::atomic<uint64_t> m_unknown{0};
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_CERT_ROUTER_H
@@ -0,0 +1,357 @@
+#include "ssl_client_session_cache.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+namespace galay::ssl
+{
+
+namespace {
+
+constexpr char kSnapshotMagic[4] = {'G', 'S', 'C', 'S'};
+constexpr uint32_t kSnapshotVersion = 1;
+constexpr uint32_t kMaxSnapshotField = 1U << 20;
+
+bool isUsable(const SSL_SESSION* session, time_t now)
+{
+    if (SSL_SESSION_is_resumable(session) != 1) {
+        return false;
+    }
+    const long timeout = SSL_SESSION_get_timeout(session);
+    return timeout <= 0 || SSL_SESSION_get_time(session) + timeout > now;
+}
+
+bool isTls13(const SSL_SESSION* session)
+{
+    return SSL_SESSION_get_protocol_version(session) == TLS1_3_VERSION;
+}
+
+int sessionKeyIndex()
+{
+    static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr,
+        [](void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*) {
+            delete static_cast<std::string*>(ptr);
+        });
+    return index;
+}
+
+void appendU32(std::vector<unsigned char>& out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+bool readU32(const std::vector<unsigned char>& in, size_t& offset, uint32_t& value)
+{
+    if (in.size() - offset < 4) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(in[offset + static_cast<size_t>(i)]) << (8 * i);
+    }
+    offset += 4;
+    return true;
+}
+
+bool writeAll(int fd, const unsigned char* data, size_t length)
+{
+    while (length > 0) {
+        const ssize_t n = ::write(fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        length -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+SslClientSessionCache::SslClientSessionCache(SslClientSessionCacheOptions options)
+    : m_options(options)
+{
+    m_options.maxPeers = std::max<size_t>(1, m_options.maxPeers);
+    m_options.ticketsPerPeer = std::max<size_t>(1, m_options.ticketsPerPeer);
+}
+
+SslClientSessionCache::~SslClientSessionCache()
+{
+    clear();
+}
+
+std::string SslClientSessionCache::makeKey(const std::string& peer, const std::string& sni)
+{
+    std::string key;
+    key.reserve(peer.size() + sni.size() + 1);
+    key.append(peer);
+    key.push_back('|');
+    key.append(sni);
+    return key;
+}
+
+void SslClientSessionCache::bindKey(SSL* ssl, const std::string& key)
+{
+    if (!ssl) return;
+    delete static_cast<std::string*>(SSL_get_ex_data(ssl, sessionKeyIndex()));
+    SSL_set_ex_data(ssl, sessionKeyIndex(), new std::string(key));
+}
+
+const std::string* SslClientSessionCache::keyOf(const SSL* ssl)
+{
+    if (!ssl) return nullptr;
+    return static_cast<const std::string*>(SSL_get_ex_data(ssl, sessionKeyIndex()));
+}
+
+void SslClientSessionCache::touchLocked(Peer& peer, const std::string& key)
+{
+    if (peer.lru != m_lru.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, peer.lru);
+    } else {
+        m_lru.push_front(key);
+        peer.lru = m_lru.begin();
+    }
+}
+
+void SslClientSessionCache::dropPeerLocked(std::unordered_map<std::string, Peer>::iterator it)
+{
+    for (SSL_SESSION* session : it->second.sessions) {
+        SSL_SESSION_free(session);
+    }
+    m_sessionCount -= it->second.sessions.size();
+    if (it->second.lru != m_lru.end()) {
+        m_lru.erase(it->second.lru);
+    }
+    m_peers.erase(it);
+}
+
+void SslClientSessionCache::evictLocked()
+{
+    while (m_peers.size() > m_options.maxPeers && !m_lru.empty()) {
+        auto it = m_peers.find(m_lru.back());
+        if (it == m_peers.end()) {
+            m_lru.pop_back();
+            continue;
+        }
+        dropPeerLocked(it);
+        ++m_evictions;
+    }
+}
+
+bool SslClientSessionCache::store(const std::string& key, SSL_SESSION* session)
+{
+    if (!session || !isUsable(session, std::time(nullptr))) {
+        return false;
+    }
+
+    std::lock_guard lock(m_mutex);
+    auto [it, inserted] = m_peers.try_emplace(key);
+    Peer& peer = it->second;
+    if (inserted) {
+        peer.lru = m_lru.end();
+    }
+
+    // TLS 1.2 session 可重复使用，只保留最新一个；TLS 1.3 ticket 累积到上限
+    const bool tls13 = isTls13(session);
+    if (!tls13 || (!peer.sessions.empty() && !isTls13(peer.sessions.front()))) {
+        for (SSL_SESSION* old : peer.sessions) {
+            SSL_SESSION_free(old);
+        }
+        m_sessionCount -= peer.sessions.size();
+        peer.sessions.clear();
+    }
+
+    SSL_SESSION_up_ref(session);
+    peer.sessions.push_back(session);
+    ++m_sessionCount;
+    while (peer.sessions.size() > m_options.ticketsPerPeer) {
+        SSL_SESSION_free(peer.sessions.front());
+        peer.sessions.pop_front();
+        --m_sessionCount;
+    }
+
+    ++m_stored;
+    touchLocked(peer, key);
+    evictLocked();
+    return true;
+}
+
+SSL_SESSION* SslClientSessionCache::take(const std::string& key)
+{
+    const time_t now = std::time(nullptr);
+    std::lock_guard lock(m_mutex);
+    auto it = m_peers.find(key);
+    if (it == m_peers.end()) {
+        ++m_misses;
+        return nullptr;
+    }
+
+    Peer& peer = it->second;
+    while (!peer.sessions.empty()) {
+        // 优先使用最新收到的 session
+        SSL_SESSION* session = peer.sessions.back();
+        if (!isUsable(session, now)) {
+            SSL_SESSION_free(session);
+            peer.sessions.pop_back();
+            --m_sessionCount;
+            ++m_expired;
+            continue;
+        }
+        if (isTls13(session)) {
+            // ticket 单次使用：引用直接转给调用方
+            peer.sessions.pop_back();
+            --m_sessionCount;
+        } else {
+            SSL_SESSION_up_ref(session);
+        }
+        ++m_hits;
+        if (peer.sessions.empty()) {
+            dropPeerLocked(it);
+        } else {
+            touchLocked(peer, key);
+        }
+        return session;
+    }
+
+    dropPeerLocked(it);
+    ++m_misses;
+    return nullptr;
+}
+
+void SslClientSessionCache::erase(const std::string& key)
+{
+    std::lock_guard lock(m_mutex);
+    auto it = m_peers.find(key);
+    if (it != m_peers.end()) {
+        dropPeerLocked(it);
+    }
+}
+
+void SslClientSessionCache::clear()
+{
+    std::lock_guard lock(m_mutex);
+    for (auto& [key, peer] : m_peers) {
+        for (SSL_SESSION* session : peer.sessions) {
+            SSL_SESSION_free(session);
+        }
+    }
+    m_peers.clear();
+    m_lru.clear();
+    m_sessionCount = 0;
+}
+
+std::expected<size_t, SslError> SslClientSessionCache::save(const std::string& path) const
+{
+    std::vector<unsigned char> out(kSnapshotMagic, kSnapshotMagic + sizeof(kSnapshotMagic));
+    appendU32(out, kSnapshotVersion);
+
+    size_t count = 0;
+    {
+        const time_t now = std::time(nullptr);
+        std::lock_guard lock(m_mutex);
+        // 从最久未使用的对端开始写，load() 按顺序插入后 LRU 顺序保持不变
+        for (auto key = m_lru.rbegin(); key != m_lru.rend(); ++key) {
+            auto it = m_peers.find(*key);
+            if (it == m_peers.end()) continue;
+            for (SSL_SESSION* session : it->second.sessions) {
+                if (!isUsable(session, now)) continue;
+                const int length = i2d_SSL_SESSION(session, nullptr);
+                if (length <= 0) continue;
+                appendU32(out, static_cast<uint32_t>(key->size()));
+                out.insert(out.end(), key->begin(), key->end());
+                appendU32(out, static_cast<uint32_t>(length));
+                const size_t offset = out.size();
+                out.resize(offset + static_cast<size_t>(length));
+                unsigned char* der = out.data() + offset;
+                i2d_SSL_SESSION(session, &der);
+                ++count;
+            }
+        }
+    }
+
+    const std::string tmpPath = path + ".tmp";
+    const int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return std::unexpected(SslError(SslErrorCode::kSessionCacheFailed));
+    }
+    const bool written = writeAll(fd, out.data(), out.size()) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!written || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ::unlink(tmpPath.c_str());
+        return std::unexpected(SslError(SslErrorCode::kSessionCacheFailed));
+    }
+    return count;
+}
+
+std::expected<size_t, SslError> SslClientSessionCache::load(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::unexpected(SslError(SslErrorCode::kSessionCacheFailed));
+    }
+    std::vector<unsigned char> in;
+    unsigned char chunk[8192];
+    for (;;) {
+        const ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        in.insert(in.end(), chunk, chunk + n);
+    }
+    ::close(fd);
+
+    size_t offset = sizeof(kSnapshotMagic);
+    uint32_t version = 0;
+    if (in.size() < offset || !std::equal(kSnapshotMagic, kSnapshotMagic + sizeof(kSnapshotMagic), in.begin()) ||
+        !readU32(in, offset, version) || version != kSnapshotVersion) {
+        return std::unexpected(SslError(SslErrorCode::kSessionCacheFailed));
+    }
+
+    size_t count = 0;
+    while (offset < in.size()) {
+        uint32_t keyLength = 0;
+        uint32_t derLength = 0;
+        if (!readU32(in, offset, keyLength) || keyLength > kMaxSnapshotField || in.size() - offset < keyLength) {
+            return std::unexpected(SslError(SslErrorCode::kSessionCacheFailed));
+        }
+        const std::string key(reinterpret_cast<const char*>(in.data() + offset), keyLength);
+        offset += keyLength;
+        if (!readU32(in, offset, derLength) || derLength > kMaxSnapshotField || in.size() - offset < derLength) {
+            return std::unexpected(SslError(SslErrorCode::kSessionCacheFailed));
+        }
+        const unsigned char* der = in.data() + offset;
+        offset += derLength;
+
+        SSL_SESSION* session = d2i_SSL_SESSION(nullptr, &der, static_cast<long>(derLength));
+        if (!session) {
+            continue;
+        }
+        if (store(key, session)) {
+            ++count;
+        }
+        SSL_SESSION_free(session);
+    }
+    return count;
+}
+
+SslClientSessionCacheStats SslClientSessionCache::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    SslClientSessionCacheStats result;
+    result.hits = m_hits;
+    result.misses = m_misses;
+    result.stored = m_stored;
+    result.evictions = m_evictions;
+    result.expired = m_expired;
+    result.peers = m_peers.size();
+    result.sessions = m_sessionCount;
+    return result;
+}
+
+} // namespace galay::ssl
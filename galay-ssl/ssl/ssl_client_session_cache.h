@@ -0,0 +1,152 @@
+#ifndef GALAY_SSL_CLIENT_SESSION_CACHE_H
+#define GALAY_SSL_CLIENT_SESSION_CACHE_H
+
+#include "galay-ssl/common/defn.hpp"
+#include "galay-ssl/common/error.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 客户端 Session 缓存配置
+ */
+struct SslClientSessionCacheOptions {
+    size_t maxPeers = 1024;         ///< 最多缓存的对端数（host:port + SNI），超出按 LRU 淘汰
+    size_t ticketsPerPeer = 4;      ///< 每个对端最多保留的 TLS 1.3 ticket 数
+};
+
+/**
+ * @brief 客户端 Session 缓存统计
+ */
+struct SslClientSessionCacheStats {
+    uint64_t hits = 0;          ///< 连接前取到可恢复 session 的次数
+    uint64_t misses = 0;        ///< 连接前没有可用 session 的次数
+    uint64_t stored = 0;        ///< 收到并保存的 session / ticket 数
+    uint64_t evictions = 0;     ///< 因对端数超限淘汰的次数
+    uint64_t expired = 0;       ///< 取用时发现过期而丢弃的次数
+    size_t peers = 0;           ///< 当前对端数
+    size_t sessions = 0;        ///< 当前 session 总数
+};
+
+/**
+ * @brief 客户端自动 Session 缓存
+ *
+ * @details 由 SslContext::setClientSessionCache() 挂到客户端上下文：握手前按对端 key 取出 session
+ * 交给 OpenSSL，握手中 / 握手后收到的新 session 通过 new session 回调自动存回。
+ * key 为 "host:port" 加 SNI，同一地址的不同虚拟主机互不干扰。
+ *
+ * - TLS 1.3：服务端可能一次下发多张 ticket，按到达顺序保存到 ticketsPerPeer 张；
+ *   ticket 按单次使用处理，取出即移除，服务端下发的新 ticket 再补充进来
+ * - TLS 1.2：每个对端只保留最新的 session，可以被多个连接重复使用
+ *
+ * 可选地把缓存快照到文件（save() / load()），客户端重启或重新部署后直接恢复而不是完整握手。
+ *
+ * @example
+ * @code
+ * auto cache = std::make_shared<SslClientSessionCache>();
+ * cache->load("/var/cache/app/tls-sessions");     // 文件不存在时返回错误，可忽略
+ * clientCtx.setClientSessionCache(cache);
+ * // ... SslSocket::connect() / handshake() 自动取用与保存 ...
+ * cache->save("/var/cache/app/tls-sessions");
+ * @endcode
+ *
+ * @note 快照包含 session 主密钥，文件以 0600 权限写入，只应保存在本机受信任的位置
+ */
+class SslClientSessionCache
+{
+public:
+    explicit SslClientSessionCache(SslClientSessionCacheOptions options = {});
+    ~SslClientSessionCache();
+
+    SslClientSessionCache(const SslClientSessionCache&) = delete;
+    SslClientSessionCache& operator=(const SslClientSessionCache&) = delete;
+
+    /**
+     * @brief 组合缓存 key
+     * @param peer 对端地址，形如 "host:port"
+     * @param sni SNI 主机名，可为空
+     */
+    static std::string makeKey(const std::string& peer, const std::string& sni);
+
+    /**
+     * @brief 保存 session（由 new session 回调调用）
+     * @return 是否保存（不可恢复的 session 会被忽略）
+     */
+    bool store(const std::string& key, SSL_SESSION* session);
+
+    /**
+     * @brief 取出一个可恢复的 session
+     * @return 调用方持有一个引用的 SSL_SESSION，没有时返回 nullptr
+     */
+    SSL_SESSION* take(const std::string& key);
+
+    /**
+     * @brief 移除某个对端的全部 session
+     */
+    void erase(const std::string& key);
+
+    /**
+     * @brief 清空缓存
+     */
+    void clear();
+
+    /**
+     * @brief 把未过期的 session 快照写入文件（先写临时文件再 rename）
+     * @return 写入的 session 数
+     */
+    std::expected<size_t, SslError> save(const std::string& path) const;
+
+    /**
+     * @brief 从快照文件合并加载，已过期的 session 会被跳过
+     * @return 加载的 session 数
+     */
+    std::expected<size_t, SslError> load(const std::string& path);
+
+    /**
+     * @brief 统计快照
+     */
+    SslClientSessionCacheStats stats() const;
+
+    /**
+     * @brief 把缓存 key 绑定到 SSL 对象，new session 回调据此找到对端
+     */
+    static void bindKey(SSL* ssl, const std::string& key);
+
+    /**
+     * @brief 获取绑定到 SSL 对象的缓存 key，未绑定返回 nullptr
+     */
+    static const std::string* keyOf(const SSL* ssl);
+
+private:
+    struct Peer {
+        std::deque<SSL_SESSION*> sessions;     ///< 头部为最早收到的
+        std::list<std::string>::iterator lru;
+    };
+
+    void touchLocked(Peer& peer, const std::string& key);
+    void evictLocked();
+    void dropPeerLocked(std::unordered_map<std::string, Peer>::iterator it);
+
+    SslClientSessionCacheOptions m_options;
+    mutable std::mutex m_mutex;
+    std::list<std::string> m_lru;               ///< 头部为最近使用
+    std::unordered_map<std::string, Peer> m_peers;
+    size_t m_sessionCount = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    uint64_t m_stored = 0;
+    uint64_t m_evictions = 0;
+    uint64_t m_expired = 0;
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_CLIENT_SESSION_CACHE_H
@@ -1,5 +1,31 @@
 #include "ssl_context.h"
+#include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <unordered_set>
+#include <vector>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/x509v3.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#else
+#include <openssl/hmac.h>
+#endif
+
+// RFC 8879 证书压缩自 OpenSSL 3.2 起提供，构建时可用 no-comp 整体裁掉
+#if OPENSSL_VERSION_NUMBER >= 0x30200000L && !defined(OPENSSL_NO_COMP_ALG)
+#define GALAY_SSL_HAS_CERT_COMPRESSION 1
+#else
+#define GALAY_SSL_HAS_CERT_COMPRESSION 0
+#endif
+
+// RFC 7250 原始公钥（server_certificate_type / client_certificate_type）自 OpenSSL 3.2 起提供
+#if OPENSSL_VERSION_NUMBER >= 0x30200000L
+#define GALAY_SSL_HAS_RAW_PUBLIC_KEY 1
+#else
+#define GALAY_SSL_HAS_RAW_PUBLIC_KEY 0
+#endif
 
 namespace galay::ssl
 {
@@ -51,14 +77,512 @@ bool isServerMethod(SslMethod method) {
     }
 }
 
+constexpr unsigned char kSessionIdContext[] = "galay-ssl";
+
+int sessionStoreIndex() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+SslSessionStore* sessionStoreOf(SSL_CTX* ctx) {
+    if (!ctx) return nullptr;
+    return static_cast<SslSessionStore*>(SSL_CTX_get_ex_data(ctx, sessionStoreIndex()));
+}
+
+int clientCacheIndex() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+SslClientSessionCache* clientCacheOf(SSL_CTX* ctx) {
+    if (!ctx) return nullptr;
+    return static_cast<SslClientSessionCache*>(SSL_CTX_get_ex_data(ctx, clientCacheIndex()));
+}
+
+int onNewSession(SSL* ssl, SSL_SESSION* session) {
+    if (!SSL_is_server(ssl)) {
+        SslClientSessionCache* cache = clientCacheOf(SSL_get_SSL_CTX(ssl));
+        const std::string* key = SslClientSessionCache::keyOf(ssl);
+        if (cache && key) {
+            cache->store(*key, session);
+        }
+        return 0;
+    }
+
+    SslSessionStore* store = sessionStoreOf(SSL_get_SSL_CTX(ssl));
+    if (store) {
+        unsigned int length = 0;
+        const unsigned char* id = SSL_SESSION_get_id(session, &length);
+        store->store(id, length, session);
+    }
+    // 返回 0：存储自行持有引用，OpenSSL 不转移所有权
+    return 0;
+}
+
+SSL_SESSION* onGetSession(SSL* ssl, const unsigned char* id, int length, int* copy) {
+    *copy = 0;  // load() 已返回一个归 OpenSSL 所有的引用
+    SslSessionStore* store = sessionStoreOf(SSL_get_SSL_CTX(ssl));
+    if (!store || length <= 0) return nullptr;
+    return store->load(id, static_cast<size_t>(length));
+}
+
+void onRemoveSession(SSL_CTX* ctx, SSL_SESSION* session) {
+    SslSessionStore* store = sessionStoreOf(ctx);
+    if (store) {
+        unsigned int length = 0;
+        const unsigned char* id = SSL_SESSION_get_id(session, &length);
+        store->erase(id, length);
+    }
+}
+
+int ticketKeysIndex() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+SslTicketKeyRing* ticketKeysOf(SSL* ssl) {
+    SSL_CTX* ctx = SSL_get_SSL_CTX(ssl);
+    if (!ctx) return nullptr;
+    return static_cast<SslTicketKeyRing*>(SSL_CTX_get_ex_data(ctx, ticketKeysIndex()));
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+using TicketMacCtx = EVP_MAC_CTX;
+
+bool initTicketMac(EVP_MAC_CTX* mac, SslTicketKey& key) {
+    char digest[] = "SHA256";
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmacKey.data(), key.hmacKey.size()),
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+        OSSL_PARAM_construct_end(),
+    };
+    return EVP_MAC_CTX_set_params(mac, params) == 1;
+}
+#else
+using TicketMacCtx = HMAC_CTX;
+
+bool initTicketMac(HMAC_CTX* mac, SslTicketKey& key) {
+    return HMAC_Init_ex(mac, key.hmacKey.data(), static_cast<int>(key.hmacKey.size()), EVP_sha256(), nullptr) == 1;
+}
+#endif
+
+/**
+ * 返回值遵循 OpenSSL ticket key 回调约定：
+ * 加密时 1 成功、0 密钥环为空（不签发 ticket，握手继续）、-1 失败；
+ * 解密时 0 未找到密钥（走完整握手）、1 成功、2 成功且需要重新签发
+ */
+int onTicketKey(SSL* ssl, unsigned char* name, unsigned char* iv,
+                EVP_CIPHER_CTX* cipher, TicketMacCtx* mac, int enc) {
+    SslTicketKeyRing* ring = ticketKeysOf(ssl);
+    if (!ring) return enc ? -1 : 0;
+
+    SslTicketKey key;
+    if (enc) {
+        if (!ring->encryptionKey(key)) return 0;
+        if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1) return -1;
+        std::memcpy(name, key.name.data(), SslTicketKey::kNameSize);
+        if (EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aesKey.data(), iv) != 1) return -1;
+        return initTicketMac(mac, key) ? 1 : -1;
+    }
+
+    bool renew = false;
+    if (!ring->decryptionKey(name, key, renew)) return 0;
+    if (!initTicketMac(mac, key)) return -1;
+    if (EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aesKey.data(), iv) != 1) return -1;
+    return renew ? 2 : 1;
+}
+
+int earlyDataGuardIndex() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+int onAllowEarlyData(SSL* ssl, void*) {
+    auto* guard = static_cast<SslEarlyDataReplayGuard*>(
+        SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), earlyDataGuardIndex()));
+    return guard && guard->admit(ssl) ? 1 : 0;
+}
+
+int pskStoreIndex() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+/**
+ * 上下文当前启用的 TLS 1.3 套件，按优先级以冒号连接（SSL_CTX_get_ciphers 同时包含 TLS 1.2 套件）
+ */
+std::string tls13Ciphersuites(SSL_CTX* ctx) {
+    std::string names;
+    const STACK_OF(SSL_CIPHER)* ciphers = SSL_CTX_get_ciphers(ctx);
+    for (int i = 0; ciphers != nullptr && i < sk_SSL_CIPHER_num(ciphers); ++i) {
+        const SSL_CIPHER* cipher = sk_SSL_CIPHER_value(ciphers, i);
+        // TLS 1.3 套件的 IANA 编号为 0x13xx
+        if ((SSL_CIPHER_get_protocol_id(cipher) >> 8) != 0x13) continue;
+        if (!names.empty()) names += ':';
+        names += SSL_CIPHER_get_name(cipher);
+    }
+    return names;
+}
+
+SslPskStore* pskStoreOf(SSL* ssl) {
+    return static_cast<SslPskStore*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), pskStoreIndex()));
+}
+
+/**
+ * 客户端：md 非空（HelloRetryRequest 之后）时 PSK 的哈希必须与之一致，否则不发送 PSK；
+ * 返回 1 且 *session 为空表示不使用 PSK，继续证书握手
+ */
+int onPskUseSession(SSL* ssl, const EVP_MD* md, const unsigned char** id, size_t* idlen, SSL_SESSION** session) {
+    *session = nullptr;
+    SslPskStore* store = pskStoreOf(ssl);
+    if (!store || store->options().clientIdentity.empty()) return 1;
+    const EVP_MD* digest = SSL_CIPHER_get_handshake_digest(store->cipher());
+    if (md != nullptr && (digest == nullptr || !EVP_MD_is_a(md, EVP_MD_get0_name(digest)))) return 1;
+
+    const std::string& identity = store->options().clientIdentity;
+    *session = store->newSession(identity);
+    *id = reinterpret_cast<const unsigned char*>(identity.data());
+    *idlen = identity.size();
+    return 1;
+}
+
+int onPskFindSession(SSL* ssl, const unsigned char* id, size_t idlen, SSL_SESSION** session) {
+    SslPskStore* store = pskStoreOf(ssl);
+    *session = store ? store->newSession({reinterpret_cast<const char*>(id), idlen}) : nullptr;
+    return 1;
+}
+
+int certCountersIndex() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+int crlIndexIndex() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+int pinnedKeysIndex() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+#if GALAY_SSL_HAS_RAW_PUBLIC_KEY
+/**
+ * @brief 公钥的 SubjectPublicKeyInfo DER，作为固定公钥的查表键
+ */
+std::string publicKeyDer(const EVP_PKEY* key) {
+    unsigned char* der = nullptr;
+    const int length = i2d_PUBKEY(key, &der);
+    if (length <= 0) {
+        return {};
+    }
+    std::string result(reinterpret_cast<const char*>(der), static_cast<size_t>(length));
+    OPENSSL_free(der);
+    return result;
+}
+
+/**
+ * @brief 读取 PEM 文件中的全部 PUBLIC KEY；没有时按证书读取并取其公钥
+ */
+bool readPublicKeys(const std::string& file, std::unordered_set<std::string>& keys) {
+    BIO* bio = BIO_new_file(file.c_str(), "r");
+    if (bio == nullptr) {
+        return false;
+    }
+    size_t found = 0;
+    auto add = [&keys, &found](const EVP_PKEY* key) {
+        if (std::string der = publicKeyDer(key); !der.empty()) {
+            keys.insert(std::move(der));
+            ++found;
+        }
+    };
+    while (EVP_PKEY* key = PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr)) {
+        add(key);
+        EVP_PKEY_free(key);
+    }
+    if (found == 0 && BIO_reset(bio) == 0) {
+        while (X509* cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr)) {
+            add(X509_get0_pubkey(cert));
+            X509_free(cert);
+        }
+    }
+    BIO_free(bio);
+    ERR_clear_error();  // 读到文件末尾时留下的 PEM_R_NO_START_LINE
+    return found > 0;
+}
+#endif
+
+/**
+ * 对端接受 ECDSA 时连接收窄到的签名算法；验证客户端证书时改用的对端签名算法（OpenSSL 默认列表去掉 SHA-1 / DSA）
+ */
+constexpr const char* kEcdsaSigalgs = "ECDSA+SHA256:ECDSA+SHA384:ECDSA+SHA512";
+constexpr const char* kPeerSigalgs =
+    "ECDSA+SHA256:ECDSA+SHA384:ECDSA+SHA512:ed25519:ed448:"
+    "rsa_pss_pss_sha256:rsa_pss_pss_sha384:rsa_pss_pss_sha512:"
+    "rsa_pss_rsae_sha256:rsa_pss_rsae_sha384:rsa_pss_rsae_sha512:RSA+SHA256:RSA+SHA384:RSA+SHA512";
+
+/**
+ * @brief 取出 ClientHello 扩展中以 2 字节长度开头的 2 字节编号列表（signature_algorithms、supported_groups）
+ * @return 扩展不存在或格式错误时返回 nullopt
+ */
+std::optional<std::vector<uint16_t>> helloCodeList(SSL* ssl, unsigned int type) {
+    const unsigned char* data = nullptr;
+    size_t length = 0;
+    if (SSL_client_hello_get0_ext(ssl, type, &data, &length) != 1 || length < 2) {
+        return std::nullopt;
+    }
+    const size_t listLength = (static_cast<size_t>(data[0]) << 8) | data[1];
+    if (listLength + 2 != length || listLength % 2 != 0) {
+        return std::nullopt;
+    }
+    std::vector<uint16_t> codes;
+    for (size_t i = 2; i < length; i += 2) {
+        codes.push_back(static_cast<uint16_t>((data[i] << 8) | data[i + 1]));
+    }
+    return codes;
+}
+
+/**
+ * @brief 本次握手是否会协商 TLS 1.3：客户端在 supported_versions 中提供且上下文未禁用
+ */
+bool helloNegotiatesTls13(SSL* ssl) {
+    const long max = SSL_get_max_proto_version(ssl);
+    if (max != 0 && max < TLS1_3_VERSION) {
+        return false;
+    }
+    const unsigned char* data = nullptr;
+    size_t length = 0;
+    if (SSL_client_hello_get0_ext(ssl, TLSEXT_TYPE_supported_versions, &data, &length) != 1 || length < 1) {
+        return false;
+    }
+    for (size_t i = 1; i + 1 < length && i <= data[0]; i += 2) {
+        if (((data[i] << 8) | data[i + 1]) == TLS1_3_VERSION) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 对端是否可以接受给定曲线的 ECDSA 证书（在 ClientHello 回调中按原始扩展判断）
+ *
+ * TLS 1.3 的签名算法绑定曲线（ecdsa_secp256r1_sha256 等）；TLS 1.2 还需要对端提供
+ * ECDSA 认证的密码套件，并在 supported_groups 中包含证书曲线（未发送该扩展视为都支持）。
+ */
+bool peerAcceptsEcdsa(SSL* ssl, EVP_PKEY* publicKey, bool tls13) {
+    char group[64] = {};
+    if (EVP_PKEY_get_group_name(publicKey, group, sizeof(group), nullptr) != 1) {
+        return false;
+    }
+    const int curve = OBJ_txt2nid(group);
+    unsigned char tls13_hash = 0;
+    uint16_t group_id = 0;
+    switch (curve) {
+        case NID_X9_62_prime256v1: tls13_hash = 0x04; group_id = 23; break;
+        case NID_secp384r1: tls13_hash = 0x05; group_id = 24; break;
+        case NID_secp521r1: tls13_hash = 0x06; group_id = 25; break;
+        default: break;
+    }
+
+    const auto sigalgs = helloCodeList(ssl, TLSEXT_TYPE_signature_algorithms);
+    if (!sigalgs) {
+        return false;
+    }
+    bool signature = false;
+    for (uint16_t scheme : *sigalgs) {
+        // SignatureScheme 低字节 3 为 ECDSA
+        signature = signature || ((scheme & 0xff) == 0x03 && (!tls13 || (scheme >> 8) == tls13_hash));
+    }
+    if (!signature || tls13) {
+        return signature;
+    }
+
+    bool cipher = false;
+    const unsigned char* ids = nullptr;
+    const size_t id_length = SSL_client_hello_get0_ciphers(ssl, &ids);
+    for (size_t i = 0; i + 1 < id_length && !cipher; i += 2) {
+        const SSL_CIPHER* candidate = SSL_CIPHER_find(ssl, ids + i);
+        cipher = candidate != nullptr && SSL_CIPHER_get_auth_nid(candidate) == NID_auth_ecdsa;
+    }
+    if (!cipher) {
+        return false;
+    }
+    const auto groups = helloCodeList(ssl, TLSEXT_TYPE_supported_groups);
+    return !groups || std::find(groups->begin(), groups->end(), group_id) != groups->end();
+}
+
+/**
+ * @brief ECDSA 与 RSA 证书都已加载时按 ClientHello 选择
+ */
+int onSelectCertificate(SSL* ssl, int* alert, void*) {
+    if (!detail::preferEcdsaCertificate(ssl)) {
+        *alert = SSL_AD_INTERNAL_ERROR;
+        return SSL_CLIENT_HELLO_ERROR;
+    }
+    return SSL_CLIENT_HELLO_SUCCESS;
+}
+
+/**
+ * @brief 为当前证书槽位构建证书链
+ *
+ * 有信任锚时从中补齐中间证书并要求链到可信根；没有时以已加载的链作为部分信任锚（PARTIAL_CHAIN），
+ * 只检查链从叶子证书起连续、顺序正确，并丢弃无关的证书。证书文件中的链总是只作为不可信的中间证书。
+ */
+bool buildCurrentChain(SSL_CTX* ctx, X509_STORE* anchors) {
+    X509_STORE* store = anchors;
+    if (store == nullptr) {
+        store = X509_STORE_new();
+        if (store == nullptr) {
+            return false;
+        }
+        X509_STORE_set_flags(store, X509_V_FLAG_PARTIAL_CHAIN);
+        STACK_OF(X509)* loaded = nullptr;
+        SSL_CTX_get0_chain_certs(ctx, &loaded);
+        for (int i = 0; i < sk_X509_num(loaded); ++i) {
+            X509_STORE_add_cert(store, sk_X509_value(loaded, i));
+        }
+        // 自签名的叶子证书自身就是链的终点
+        X509* leaf = SSL_CTX_get0_certificate(ctx);
+        if (X509_get_extension_flags(leaf) & EXFLAG_SS) {
+            X509_STORE_add_cert(store, leaf);
+        }
+    }
+    SSL_CTX_set1_chain_cert_store(ctx, store);
+    const bool built =
+        SSL_CTX_build_cert_chain(ctx, SSL_BUILD_CHAIN_FLAG_UNTRUSTED | SSL_BUILD_CHAIN_FLAG_NO_ROOT) == 1;
+    SSL_CTX_set1_chain_cert_store(ctx, nullptr);
+    if (anchors == nullptr) {
+        X509_STORE_free(store);
+    }
+    return built;
+}
+
+/**
+ * @brief 对端证书验证：原始公钥按固定公钥查表；服务端连接经验证缓存，其余照常调用 X509_verify_cert()；
+ * 通过后再按上下文挂接的 CRL 索引检查吊销
+ */
+int onVerifyCertificate(X509_STORE_CTX* store_ctx, void* arg) {
+    auto* cache = static_cast<SslVerifyCache*>(arg);
+    SSL* ssl = static_cast<SSL*>(X509_STORE_CTX_get_ex_data(store_ctx, SSL_get_ex_data_X509_STORE_CTX_idx()));
+#if GALAY_SSL_HAS_RAW_PUBLIC_KEY
+    // 原始公钥没有证书链，只按固定公钥查表
+    auto* pins = ssl ? static_cast<const std::unordered_set<std::string>*>(
+                           SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), pinnedKeysIndex()))
+                     : nullptr;
+    if (EVP_PKEY* rpk = X509_STORE_CTX_get0_rpk(store_ctx); rpk != nullptr && pins != nullptr) {
+        if (pins->contains(publicKeyDer(rpk))) {
+            X509_STORE_CTX_set_error(store_ctx, X509_V_OK);
+            return 1;
+        }
+        X509_STORE_CTX_set_error(store_ctx, X509_V_ERR_RPK_UNTRUSTED);
+        X509_STORE_CTX_verify_cb callback = X509_STORE_CTX_get_verify_cb(store_ctx);
+        return callback != nullptr && callback(0, store_ctx) != 0 ? 1 : 0;
+    }
+#endif
+    const bool cached = cache != nullptr && ssl != nullptr && SSL_is_server(ssl);
+    int rc = cached ? cache->verify(store_ctx) : X509_verify_cert(store_ctx);
+    auto* crl = ssl ? static_cast<SslCrlIndex*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), crlIndexIndex())) : nullptr;
+    if (rc == 1 && crl != nullptr) {
+        rc = crl->check(store_ctx);
+    }
+    return rc;
+}
+
 } // anonymous namespace
 
+struct SslContext::CertificateCounters {
+    std::atomic<uint64_t> ecdsa{0};
+    std::atomic<uint64_t> rsa{0};
+    std::atomic<uint64_t> other{0};
+
+    static void onHandshake(const SSL* ssl, int where, int) {
+        if (!(where & SSL_CB_HANDSHAKE_DONE) || !SSL_is_server(ssl) || SSL_session_reused(ssl)) {
+            return;
+        }
+        auto* counters = static_cast<CertificateCounters*>(
+            SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), certCountersIndex()));
+        X509* cert = SSL_get_certificate(ssl);
+        if (counters == nullptr || cert == nullptr) {
+            return;
+        }
+        switch (EVP_PKEY_get_base_id(X509_get0_pubkey(cert))) {
+            case EVP_PKEY_EC:
+                counters->ecdsa.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case EVP_PKEY_RSA:
+            case EVP_PKEY_RSA_PSS:
+                counters->rsa.fetch_add(1, std::memory_order_relaxed);
+                break;
+            default:
+                counters->other.fetch_add(1, std::memory_order_relaxed);
+                break;
+        }
+    }
+};
+
+struct SslContext::HandshakeByteCounters {
+    static constexpr int kCertificate = 11;             ///< SSL3_MT_CERTIFICATE
+    static constexpr int kFinished = 20;                ///< SSL3_MT_FINISHED
+    static constexpr int kCompressedCertificate = 25;   ///< RFC 8879 CompressedCertificate
+
+    std::atomic<uint64_t> handshakes{0};
+    std::atomic<uint64_t> bytesSent{0};
+    std::atomic<uint64_t> bytesReceived{0};
+    std::atomic<uint64_t> certificateBytesSent{0};
+    std::atomic<uint64_t> certificateBytesReceived{0};
+    std::atomic<uint64_t> compressedCertificatesSent{0};
+    std::atomic<uint64_t> compressedCertificatesReceived{0};
+
+    static void onMessage(int write_p, int, int content_type, const void* buf, size_t len, SSL*, void* arg) {
+        if (content_type != SSL3_RT_HANDSHAKE || arg == nullptr || len == 0) {
+            return;
+        }
+        auto* counters = static_cast<HandshakeByteCounters*>(arg);
+        const int type = static_cast<const unsigned char*>(buf)[0];
+        const bool certificate = type == kCertificate || type == kCompressedCertificate;
+        if (write_p) {
+            counters->bytesSent.fetch_add(len, std::memory_order_relaxed);
+            if (certificate) {
+                counters->certificateBytesSent.fetch_add(len, std::memory_order_relaxed);
+            }
+            if (type == kCompressedCertificate) {
+                counters->compressedCertificatesSent.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (type == kFinished) {
+                counters->handshakes.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else {
+            counters->bytesReceived.fetch_add(len, std::memory_order_relaxed);
+            if (certificate) {
+                counters->certificateBytesReceived.fetch_add(len, std::memory_order_relaxed);
+            }
+            if (type == kCompressedCertificate) {
+                counters->compressedCertificatesReceived.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+struct SslContext::PinnedKeys {
+    std::unordered_set<std::string> spki;   ///< SubjectPublicKeyInfo DER
+};
+
 SslContext::SslContext(SslMethod method)
+    : SslContext(method, nullptr)
+{
+}
+
+SslContext::SslContext(SslMethod method, std::shared_ptr<SslKeySharePool> keyShares)
     : m_ctx(nullptr)
+    , m_keyShares(std::move(keyShares))
+    , m_server(isServerMethod(method))
 {
     initializeOpenSSL();
 
-    m_ctx = SSL_CTX_new(getMethod(method));
+    // 属性查询只能在创建时指定：带上它后 X25519 / EC 的 KEYMGMT 优先选中该池的 provider 实例
+    m_ctx = m_keyShares ? SSL_CTX_new_ex(nullptr, m_keyShares->propertyQuery().c_str(), getMethod(method))
+                        : SSL_CTX_new(getMethod(method));
     if (!m_ctx) {
         m_error = SslError::fromOpenSSL(SslErrorCode::kContextCreateFailed);
         return;
@@ -76,6 +600,10 @@ SslContext::SslContext(SslMethod method)
     if (isServerMethod(method)) {
         SSL_CTX_set_options(m_ctx, SSL_OP_NO_TICKET);
         SSL_CTX_set_num_tickets(m_ctx, 0);
+
+        m_certCounters = std::make_unique<CertificateCounters>();
+        SSL_CTX_set_ex_data(m_ctx, certCountersIndex(), m_certCounters.get());
+        SSL_CTX_set_info_callback(m_ctx, &CertificateCounters::onHandshake);
     }
 
     // 根据方法设置版本限制
@@ -98,6 +626,9 @@ SslContext::SslContext(SslMethod method)
 
 SslContext::~SslContext()
 {
+    if (m_ctx && m_ocspStapler) {
+        m_ocspStapler->detach(m_ctx);
+    }
     if (m_ctx) {
         SSL_CTX_free(m_ctx);
         m_ctx = nullptr;
@@ -108,6 +639,26 @@ SslContext::SslContext(SslContext&& other) noexcept
     : m_ctx(other.m_ctx)
     , m_error(std::move(other.m_error))
     , m_verifyCallback(std::move(other.m_verifyCallback))
+    , m_sessionCache(std::move(other.m_sessionCache))
+    , m_ticketKeys(std::move(other.m_ticketKeys))
+    , m_clientSessionCache(std::move(other.m_clientSessionCache))
+    , m_earlyDataGuard(std::move(other.m_earlyDataGuard))
+    , m_pskStore(std::move(other.m_pskStore))
+    , m_ciphersuitesBeforePsk(std::move(other.m_ciphersuitesBeforePsk))
+    , m_keyOffload(std::move(other.m_keyOffload))
+    , m_keyShares(std::move(other.m_keyShares))
+    , m_ocspStapler(std::move(other.m_ocspStapler))
+    , m_trustStore(std::move(other.m_trustStore))
+    , m_verifyCache(std::move(other.m_verifyCache))
+    , m_crlIndex(std::move(other.m_crlIndex))
+    , m_certCounters(std::move(other.m_certCounters))
+    , m_byteCounters(std::move(other.m_byteCounters))
+    , m_pinnedKeys(std::move(other.m_pinnedKeys))
+    , m_savedNumTickets(other.m_savedNumTickets)
+    , m_leafCertificates(std::move(other.m_leafCertificates))
+    , m_server(other.m_server)
+    , m_asyncHandshake(other.m_asyncHandshake)
+    , m_certCompression(other.m_certCompression)
 {
     other.m_ctx = nullptr;
 }
@@ -115,12 +666,35 @@ SslContext::SslContext(SslContext&& other) noexcept
 SslContext& SslContext::operator=(SslContext&& other) noexcept
 {
     if (this != &other) {
+        if (m_ctx && m_ocspStapler) {
+            m_ocspStapler->detach(m_ctx);
+        }
         if (m_ctx) {
             SSL_CTX_free(m_ctx);
         }
         m_ctx = other.m_ctx;
         m_error = std::move(other.m_error);
         m_verifyCallback = std::move(other.m_verifyCallback);
+        m_sessionCache = std::move(other.m_sessionCache);
+        m_ticketKeys = std::move(other.m_ticketKeys);
+        m_clientSessionCache = std::move(other.m_clientSessionCache);
+        m_earlyDataGuard = std::move(other.m_earlyDataGuard);
+        m_pskStore = std::move(other.m_pskStore);
+        m_ciphersuitesBeforePsk = std::move(other.m_ciphersuitesBeforePsk);
+        m_keyOffload = std::move(other.m_keyOffload);
+        m_keyShares = std::move(other.m_keyShares);
+        m_ocspStapler = std::move(other.m_ocspStapler);
+        m_trustStore = std::move(other.m_trustStore);
+        m_verifyCache = std::move(other.m_verifyCache);
+        m_crlIndex = std::move(other.m_crlIndex);
+        m_certCounters = std::move(other.m_certCounters);
+        m_byteCounters = std::move(other.m_byteCounters);
+        m_pinnedKeys = std::move(other.m_pinnedKeys);
+        m_savedNumTickets = other.m_savedNumTickets;
+        m_leafCertificates = std::move(other.m_leafCertificates);
+        m_server = other.m_server;
+        m_asyncHandshake = other.m_asyncHandshake;
+        m_certCompression = other.m_certCompression;
         other.m_ctx = nullptr;
     }
     return *this;
@@ -138,7 +712,8 @@ std::expected<void, SslError> SslContext::loadCertificate(
         return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kCertificateLoadFailed));
     }
 
-    return {};
+    updateCertificateSelection();
+    return recompressCertificates();
 }
 
 std::expected<void, SslError> SslContext::loadCertificateChain(const std::string& certChainFile)
@@ -151,7 +726,8 @@ std::expected<void, SslError> SslContext::loadCertificateChain(const std::string
         return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kCertificateLoadFailed));
     }
 
-    return {};
+    updateCertificateSelection();
+    return recompressCertificates();
 }
 
 std::expected<void, SslError> SslContext::loadPrivateKey(
@@ -174,16 +750,123 @@ std::expected<void, SslError> SslContext::loadPrivateKey(
     return {};
 }
 
+std::expected<void, SslError> SslContext::loadCertificateKeyPair(const std::string& certChainFile,
+                                                                 const std::string& keyFile)
+{
+    if (auto loaded = loadCertificateChain(certChainFile); !loaded) {
+        return loaded;
+    }
+    return loadPrivateKey(keyFile);
+}
+
+void SslContext::updateCertificateSelection()
+{
+    // 刚加载的证书是当前槽位；按证书公钥而不是私钥判断类型，keyless 与私钥卸载同样适用
+    X509* loaded = SSL_CTX_get0_certificate(m_ctx);
+    if (loaded == nullptr) {
+        return;
+    }
+    const int type = EVP_PKEY_get_base_id(X509_get0_pubkey(loaded));
+    auto same = std::find_if(m_leafCertificates.begin(), m_leafCertificates.end(), [type](const auto& cert) {
+        return EVP_PKEY_get_base_id(X509_get0_pubkey(cert.get())) == type;
+    });
+    X509_up_ref(loaded);
+    std::shared_ptr<X509> leaf(loaded, X509_free);
+    if (same != m_leafCertificates.end()) {
+        *same = std::move(leaf);
+    } else {
+        m_leafCertificates.push_back(std::move(leaf));
+    }
+
+    bool ecdsa = false;
+    bool rsa = false;
+    for (const auto& cert : m_leafCertificates) {
+        const int base = EVP_PKEY_get_base_id(X509_get0_pubkey(cert.get()));
+        ecdsa = ecdsa || base == EVP_PKEY_EC;
+        rsa = rsa || base == EVP_PKEY_RSA;
+    }
+    if (ecdsa && rsa) {
+        SSL_CTX_set_client_hello_cb(m_ctx, onSelectCertificate, nullptr);
+    }
+}
+
+SslCertificateStats SslContext::certificateStats() const
+{
+    SslCertificateStats result;
+    if (m_certCounters) {
+        result.ecdsa = m_certCounters->ecdsa.load(std::memory_order_relaxed);
+        result.rsa = m_certCounters->rsa.load(std::memory_order_relaxed);
+        result.other = m_certCounters->other.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+void SslContext::setHandshakeByteStats(bool enable)
+{
+    if (!m_ctx) return;
+
+    if (!enable) {
+        SSL_CTX_set_msg_callback(m_ctx, nullptr);
+        SSL_CTX_set_msg_callback_arg(m_ctx, nullptr);
+        return;
+    }
+    if (!m_byteCounters) {
+        m_byteCounters = std::make_unique<HandshakeByteCounters>();
+    }
+    SSL_CTX_set_msg_callback_arg(m_ctx, m_byteCounters.get());
+    SSL_CTX_set_msg_callback(m_ctx, &HandshakeByteCounters::onMessage);
+}
+
+SslHandshakeByteStats SslContext::handshakeByteStats() const
+{
+    SslHandshakeByteStats result;
+    if (m_byteCounters) {
+        result.handshakes = m_byteCounters->handshakes.load(std::memory_order_relaxed);
+        result.bytesSent = m_byteCounters->bytesSent.load(std::memory_order_relaxed);
+        result.bytesReceived = m_byteCounters->bytesReceived.load(std::memory_order_relaxed);
+        result.certificateBytesSent = m_byteCounters->certificateBytesSent.load(std::memory_order_relaxed);
+        result.certificateBytesReceived = m_byteCounters->certificateBytesReceived.load(std::memory_order_relaxed);
+        result.compressedCertificatesSent = m_byteCounters->compressedCertificatesSent.load(std::memory_order_relaxed);
+        result.compressedCertificatesReceived =
+            m_byteCounters->compressedCertificatesReceived.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+std::expected<void, SslError> SslContext::setOcspStapler(std::shared_ptr<SslOcspStapler> stapler)
+{
+    if (!m_ctx) {
+        return std::unexpected(SslError(SslErrorCode::kContextCreateFailed));
+    }
+
+    if (m_ocspStapler) {
+        m_ocspStapler->detach(m_ctx);
+        m_ocspStapler.reset();
+    }
+    if (!stapler) {
+        return {};
+    }
+    if (auto attached = stapler->attach(m_ctx); !attached) {
+        return std::unexpected(attached.error());
+    }
+    m_ocspStapler = std::move(stapler);
+    return {};
+}
+
 std::expected<void, SslError> SslContext::loadCACertificate(const std::string& caFile)
 {
     if (!m_ctx) {
         return std::unexpected(SslError(SslErrorCode::kContextCreateFailed));
     }
+    if (m_trustStore) {
+        return std::unexpected(SslError(SslErrorCode::kCACertificateLoadFailed));
+    }
 
     if (SSL_CTX_load_verify_locations(m_ctx, caFile.c_str(), nullptr) != 1) {
         return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kCACertificateLoadFailed));
     }
 
+    SslTrustStore::renewGeneration(SSL_CTX_get_cert_store(m_ctx));
     return {};
 }
 
@@ -192,11 +875,16 @@ std::expected<void, SslError> SslContext::loadCAPath(const std::string& caPath)
     if (!m_ctx) {
         return std::unexpected(SslError(SslErrorCode::kContextCreateFailed));
     }
+    if (m_trustStore) {
+        return std::unexpected(SslError(SslErrorCode::kCACertificateLoadFailed));
+    }
 
     if (SSL_CTX_load_verify_locations(m_ctx, nullptr, caPath.c_str()) != 1) {
         return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kCACertificateLoadFailed));
     }
 
+    SslTrustStore::renewGeneration(SSL_CTX_get_cert_store(m_ctx));
+    SslTrustStore::addLookupPath(SSL_CTX_get_cert_store(m_ctx), caPath);
     return {};
 }
 
@@ -205,12 +893,236 @@ std::expected<void, SslError> SslContext::useDefaultCA()
     if (!m_ctx) {
         return std::unexpected(SslError(SslErrorCode::kContextCreateFailed));
     }
+    if (m_trustStore) {
+        return std::unexpected(SslError(SslErrorCode::kCACertificateLoadFailed));
+    }
 
     if (SSL_CTX_set_default_verify_paths(m_ctx) != 1) {
         return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kCACertificateLoadFailed));
     }
 
+    SslTrustStore::renewGeneration(SSL_CTX_get_cert_store(m_ctx));
+    SslTrustStore::addLookupPath(SSL_CTX_get_cert_store(m_ctx), SslTrustStore::defaultLookupPath());
+    return {};
+}
+
+void SslContext::setTrustStore(std::shared_ptr<SslTrustStore> store)
+{
+    if (!m_ctx) return;
+
+    if (store) {
+        SSL_CTX_set1_cert_store(m_ctx, store->native());
+    } else if (m_trustStore) {
+        SSL_CTX_set_cert_store(m_ctx, X509_STORE_new());
+        SslTrustStore::renewGeneration(SSL_CTX_get_cert_store(m_ctx));
+    }
+    m_trustStore = std::move(store);
+}
+
+void SslContext::setVerifyCache(std::shared_ptr<SslVerifyCache> cache)
+{
+    if (!m_ctx) return;
+
+    // 私有信任库此前未经 SslContext 修改时没有代数，先标记，避免与其他上下文的空信任库共用缓存条目
+    X509_STORE* store = SSL_CTX_get_cert_store(m_ctx);
+    if (cache && SslTrustStore::generationOf(store) == 0) {
+        SslTrustStore::renewGeneration(store);
+    }
+    m_verifyCache = std::move(cache);
+    updateVerifyCallback();
+}
+
+void SslContext::setCrlIndex(std::shared_ptr<SslCrlIndex> index)
+{
+    if (!m_ctx) return;
+
+    SSL_CTX_set_ex_data(m_ctx, crlIndexIndex(), index.get());
+    m_crlIndex = std::move(index);
+    updateVerifyCallback();
+}
+
+void SslContext::updateVerifyCallback()
+{
+    const bool hooked = m_verifyCache || m_crlIndex || m_pinnedKeys;
+    SSL_CTX_set_cert_verify_callback(m_ctx, hooked ? onVerifyCertificate : nullptr, m_verifyCache.get());
+}
+
+bool SslContext::rawPublicKeySupported()
+{
+    return GALAY_SSL_HAS_RAW_PUBLIC_KEY != 0;
+}
+
+std::expected<void, SslError> SslContext::loadRawPublicKey(const std::string& keyFile, SslFileType type)
+{
+    if (!m_ctx) {
+        return std::unexpected(SslError(SslErrorCode::kContextCreateFailed));
+    }
+
+#if GALAY_SSL_HAS_RAW_PUBLIC_KEY
+    // 不调用 SSL_CTX_check_private_key()：只发送原始公钥时不需要证书
+    if (SSL_CTX_use_PrivateKey_file(m_ctx, keyFile.c_str(), static_cast<int>(type)) != 1) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kRawPublicKeyFailed));
+    }
+    // 已有证书时保留 X.509 作为不支持 RPK 的对端的回退
+    const bool withCertificate = SSL_CTX_get0_certificate(m_ctx) != nullptr;
+    const unsigned char types[] = {TLSEXT_cert_type_rpk, TLSEXT_cert_type_x509};
+    const size_t count = withCertificate ? 2 : 1;
+    const int rc = m_server ? SSL_CTX_set1_server_cert_type(m_ctx, types, count)
+                            : SSL_CTX_set1_client_cert_type(m_ctx, types, count);
+    if (rc != 1) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kRawPublicKeyFailed));
+    }
     return {};
+#else
+    (void)keyFile;
+    (void)type;
+    return std::unexpected(SslError(SslErrorCode::kRawPublicKeyFailed));
+#endif
+}
+
+std::expected<void, SslError> SslContext::setPinnedPublicKeys(const std::vector<std::string>& keyFiles)
+{
+    if (!m_ctx) {
+        return std::unexpected(SslError(SslErrorCode::kContextCreateFailed));
+    }
+
+    if (keyFiles.empty()) {
+#if GALAY_SSL_HAS_RAW_PUBLIC_KEY
+        if (m_server) {
+            SSL_CTX_set1_client_cert_type(m_ctx, nullptr, 0);
+        } else {
+            SSL_CTX_set1_server_cert_type(m_ctx, nullptr, 0);
+        }
+#endif
+        SSL_CTX_set_ex_data(m_ctx, pinnedKeysIndex(), nullptr);
+        m_pinnedKeys.reset();
+        updateVerifyCallback();
+        return {};
+    }
+
+#if GALAY_SSL_HAS_RAW_PUBLIC_KEY
+    auto pins = std::make_unique<PinnedKeys>();
+    for (const auto& file : keyFiles) {
+        if (!readPublicKeys(file, pins->spki)) {
+            return std::unexpected(SslError(SslErrorCode::kRawPublicKeyFailed));
+        }
+    }
+
+    // 对端只能发送原始公钥：客户端约束 server_certificate_type，服务端约束 client_certificate_type
+    const unsigned char types[] = {TLSEXT_cert_type_rpk};
+    const int rc = m_server ? SSL_CTX_set1_client_cert_type(m_ctx, types, sizeof(types))
+                            : SSL_CTX_set1_server_cert_type(m_ctx, types, sizeof(types));
+    if (rc != 1) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kRawPublicKeyFailed));
+    }
+    const int mode = SSL_VERIFY_PEER | (m_server ? SSL_VERIFY_FAIL_IF_NO_PEER_CERT : 0);
+    SSL_CTX_set_verify(m_ctx, SSL_CTX_get_verify_mode(m_ctx) | mode, SSL_CTX_get_verify_callback(m_ctx));
+
+    SSL_CTX_set_ex_data(m_ctx, pinnedKeysIndex(), &pins->spki);
+    m_pinnedKeys = std::move(pins);
+    updateVerifyCallback();
+    return {};
+#else
+    return std::unexpected(SslError(SslErrorCode::kRawPublicKeyFailed));
+#endif
+}
+
+size_t SslContext::pinnedPublicKeyCount() const
+{
+    return m_pinnedKeys ? m_pinnedKeys->spki.size() : 0;
+}
+
+std::expected<void, SslError> SslContext::buildCertificateChain(const std::shared_ptr<SslTrustStore>& anchors)
+{
+    if (!m_ctx) {
+        return std::unexpected(SslError(SslErrorCode::kContextCreateFailed));
+    }
+
+    bool built = false;
+    bool ok = true;
+    for (int rc = SSL_CTX_set_current_cert(m_ctx, SSL_CERT_SET_FIRST); rc == 1 && ok;
+         rc = SSL_CTX_set_current_cert(m_ctx, SSL_CERT_SET_NEXT)) {
+        if (SSL_CTX_get0_certificate(m_ctx) == nullptr) {
+            continue;
+        }
+        ok = buildCurrentChain(m_ctx, anchors ? anchors->native() : nullptr);
+        built = true;
+    }
+    if (!ok || !built) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kCertChainBuildFailed));
+    }
+
+    SSL_CTX_set_mode(m_ctx, SSL_MODE_NO_AUTO_CHAIN);
+    return recompressCertificates();
+}
+
+std::expected<void, SslError> SslContext::recompressCertificates()
+{
+#if GALAY_SSL_HAS_CERT_COMPRESSION
+    // 0 表示按偏好中的每种算法各压缩一份，结果缓存在所有已加载证书的槽位上；
+    // 发送时只使用预压缩结果，证书或证书链变化后都要重新压缩
+    if (m_certCompression && SSL_CTX_get0_certificate(m_ctx) != nullptr && SSL_CTX_compress_certs(m_ctx, 0) == 0) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kCompressionUnsupported));
+    }
+#endif
+    return {};
+}
+
+bool SslContext::certificateCompressionSupported(SslCertCompression algorithm)
+{
+#if GALAY_SSL_HAS_CERT_COMPRESSION
+    // 未编入的算法会被 set1_cert_comp_preference 跳过，只剩它一个时设置失败
+    SSL_CTX* probe = SSL_CTX_new(TLS_method());
+    if (probe == nullptr) {
+        return false;
+    }
+    int alg = static_cast<int>(algorithm);
+    const bool supported = SSL_CTX_set1_cert_comp_preference(probe, &alg, 1) == 1;
+    SSL_CTX_free(probe);
+    ERR_clear_error();
+    return supported;
+#else
+    (void)algorithm;
+    return false;
+#endif
+}
+
+std::expected<void, SslError> SslContext::setCertificateCompression(const std::vector<SslCertCompression>& algorithms)
+{
+    if (!m_ctx) {
+        return std::unexpected(SslError(SslErrorCode::kContextCreateFailed));
+    }
+
+#if GALAY_SSL_HAS_CERT_COMPRESSION
+    if (algorithms.empty()) {
+        SSL_CTX_set1_cert_comp_preference(m_ctx, nullptr, 0);
+        SSL_CTX_set_options(m_ctx, SSL_OP_NO_TX_CERTIFICATE_COMPRESSION | SSL_OP_NO_RX_CERTIFICATE_COMPRESSION);
+        m_certCompression = false;
+        return {};
+    }
+
+    std::vector<int> preference;
+    for (SslCertCompression algorithm : algorithms) {
+        const int alg = static_cast<int>(algorithm);
+        if (std::find(preference.begin(), preference.end(), alg) == preference.end() &&
+            certificateCompressionSupported(algorithm)) {
+            preference.push_back(alg);
+        }
+    }
+    if (preference.empty() ||
+        SSL_CTX_set1_cert_comp_preference(m_ctx, preference.data(), preference.size()) != 1) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kCompressionUnsupported));
+    }
+    SSL_CTX_clear_options(m_ctx, SSL_OP_NO_TX_CERTIFICATE_COMPRESSION | SSL_OP_NO_RX_CERTIFICATE_COMPRESSION);
+    m_certCompression = true;
+    return recompressCertificates();
+#else
+    // 早于 3.2 的 OpenSSL 不会协商证书压缩，关闭即默认状态
+    if (algorithms.empty()) {
+        return {};
+    }
+    return std::unexpected(SslError(SslErrorCode::kCompressionUnsupported));
+#endif
 }
 
 void SslContext::setVerifyMode(SslVerifyMode mode,
@@ -329,4 +1241,289 @@ void SslContext::setSessionTimeout(long timeout)
     }
 }
 
+void SslContext::saveSessionDefaults()
+{
+    if (!m_sessionCache && !m_ticketKeys) {
+        m_savedNumTickets = SSL_CTX_get_num_tickets(m_ctx);
+    }
+}
+
+void SslContext::restoreSessionDefaults()
+{
+    if (m_sessionCache || m_ticketKeys || !m_savedNumTickets) {
+        return;
+    }
+    SSL_CTX_set_num_tickets(m_ctx, *m_savedNumTickets);
+    // 固定的 session id context 只由缓存与 ticket 密钥环设置，两者都分离后恢复为未设置
+    SSL_CTX_set_session_id_context(m_ctx, kSessionIdContext, 0);
+    m_savedNumTickets.reset();
+}
+
+void SslContext::setSessionCache(std::shared_ptr<SslSessionStore> cache)
+{
+    if (!m_ctx) return;
+
+    if (cache) {
+        saveSessionDefaults();
+    }
+    m_sessionCache = std::move(cache);
+    SSL_CTX_set_ex_data(m_ctx, sessionStoreIndex(), m_sessionCache.get());
+
+    if (!m_sessionCache) {
+        SSL_CTX_sess_set_new_cb(m_ctx, m_clientSessionCache ? onNewSession : nullptr);
+        SSL_CTX_sess_set_get_cb(m_ctx, nullptr);
+        SSL_CTX_sess_set_remove_cb(m_ctx, nullptr);
+        SSL_CTX_set_session_cache_mode(m_ctx, SSL_SESS_CACHE_BOTH);
+        restoreSessionDefaults();
+        return;
+    }
+
+    SSL_CTX_set_session_cache_mode(m_ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+    SSL_CTX_set_session_id_context(m_ctx, kSessionIdContext, sizeof(kSessionIdContext) - 1);
+    SSL_CTX_sess_set_new_cb(m_ctx, onNewSession);
+    SSL_CTX_sess_set_get_cb(m_ctx, onGetSession);
+    SSL_CTX_sess_set_remove_cb(m_ctx, onRemoveSession);
+
+    if (SSL_CTX_get_num_tickets(m_ctx) == 0) {
+        SSL_CTX_set_num_tickets(m_ctx, 1);
+    }
+}
+
+void SslContext::setSessionTicketKeys(std::shared_ptr<SslTicketKeyRing> ring)
+{
+    if (!m_ctx) return;
+
+    if (ring) {
+        saveSessionDefaults();
+    }
+    m_ticketKeys = std::move(ring);
+    SSL_CTX_set_ex_data(m_ctx, ticketKeysIndex(), m_ticketKeys.get());
+
+    if (!m_ticketKeys) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        SSL_CTX_set_tlsext_ticket_key_evp_cb(m_ctx, nullptr);
+#else
+        SSL_CTX_set_tlsext_ticket_key_cb(m_ctx, nullptr);
+#endif
+        SSL_CTX_set_options(m_ctx, SSL_OP_NO_TICKET);
+        // 挂有外部缓存时保留 TLS 1.3 有状态 ticket，否则恢复挂接前的 num_tickets
+        restoreSessionDefaults();
+        return;
+    }
+
+    SSL_CTX_clear_options(m_ctx, SSL_OP_NO_TICKET);
+    SSL_CTX_set_session_id_context(m_ctx, kSessionIdContext, sizeof(kSessionIdContext) - 1);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(m_ctx, onTicketKey);
+#else
+    SSL_CTX_set_tlsext_ticket_key_cb(m_ctx, onTicketKey);
+#endif
+
+    if (SSL_CTX_get_num_tickets(m_ctx) == 0) {
+        SSL_CTX_set_num_tickets(m_ctx, 1);
+    }
+}
+
+void SslContext::setClientSessionCache(std::shared_ptr<SslClientSessionCache> cache)
+{
+    if (!m_ctx) return;
+
+    m_clientSessionCache = std::move(cache);
+    SSL_CTX_set_ex_data(m_ctx, clientCacheIndex(), m_clientSessionCache.get());
+
+    if (!m_clientSessionCache) {
+        if (!m_sessionCache) {
+            SSL_CTX_sess_set_new_cb(m_ctx, nullptr);
+        }
+        SSL_CTX_set_session_cache_mode(m_ctx, SSL_SESS_CACHE_BOTH);
+        return;
+    }
+
+    SSL_CTX_set_session_cache_mode(m_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(m_ctx, onNewSession);
+}
+
+void SslContext::setMaxEarlyData(uint32_t bytes)
+{
+    if (!m_ctx) return;
+
+    SSL_CTX_set_max_early_data(m_ctx, bytes);
+    SSL_CTX_set_recv_max_early_data(m_ctx, bytes);
+}
+
+uint32_t SslContext::maxEarlyData() const
+{
+    return m_ctx ? SSL_CTX_get_max_early_data(m_ctx) : 0;
+}
+
+void SslContext::setEarlyDataReplayGuard(std::shared_ptr<SslEarlyDataReplayGuard> guard)
+{
+    if (!m_ctx) return;
+
+    m_earlyDataGuard = std::move(guard);
+    SSL_CTX_set_ex_data(m_ctx, earlyDataGuardIndex(), m_earlyDataGuard.get());
+
+    if (!m_earlyDataGuard) {
+        SSL_CTX_set_allow_early_data_cb(m_ctx, nullptr, nullptr);
+        SSL_CTX_clear_options(m_ctx, SSL_OP_NO_ANTI_REPLAY);
+        return;
+    }
+
+    SSL_CTX_set_options(m_ctx, SSL_OP_NO_ANTI_REPLAY);
+    SSL_CTX_set_allow_early_data_cb(m_ctx, onAllowEarlyData, nullptr);
+}
+
+std::expected<void, SslError> SslContext::setPreSharedKeys(std::shared_ptr<SslPskStore> store, SslPskMode mode)
+{
+    if (!m_ctx) {
+        return std::unexpected(SslError(SslErrorCode::kContextCreateFailed));
+    }
+
+#ifdef SSL_OP_PREFER_NO_DHE_KEX
+    constexpr uint64_t kNoDheOptions = SSL_OP_ALLOW_NO_DHE_KEX | SSL_OP_PREFER_NO_DHE_KEX;
+#else
+    constexpr uint64_t kNoDheOptions = SSL_OP_ALLOW_NO_DHE_KEX;
+#endif
+    if (!store) {
+        SSL_CTX_set_psk_use_session_callback(m_ctx, nullptr);
+        SSL_CTX_set_psk_find_session_callback(m_ctx, nullptr);
+        SSL_CTX_clear_options(m_ctx, kNoDheOptions);
+        SSL_CTX_set_ex_data(m_ctx, pskStoreIndex(), nullptr);
+        m_pskStore.reset();
+        if (m_ciphersuitesBeforePsk) {
+            const int restored = SSL_CTX_set_ciphersuites(m_ctx, m_ciphersuitesBeforePsk->c_str());
+            m_ciphersuitesBeforePsk.reset();
+            if (restored != 1) {
+                return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kPskConfigFailed));
+            }
+        }
+        return {};
+    }
+
+    // 服务端先于 PSK 扩展选定套件，哈希不一致的 PSK 会被忽略，所以挂接期间只保留 store 的套件；
+    // 只在首次挂接时记录原配置，切换 store 或模式时不覆盖
+    if (!m_ciphersuitesBeforePsk) {
+        m_ciphersuitesBeforePsk = tls13Ciphersuites(m_ctx);
+    }
+    if (SSL_CTX_set_ciphersuites(m_ctx, SSL_CIPHER_get_name(store->cipher())) != 1) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kPskConfigFailed));
+    }
+    if (mode == SslPskMode::PskKe) {
+        SSL_CTX_set_options(m_ctx, kNoDheOptions);
+    } else {
+        SSL_CTX_clear_options(m_ctx, kNoDheOptions);
+    }
+    m_pskStore = std::move(store);
+    SSL_CTX_set_ex_data(m_ctx, pskStoreIndex(), m_pskStore.get());
+    SSL_CTX_set_psk_use_session_callback(m_ctx, onPskUseSession);
+    SSL_CTX_set_psk_find_session_callback(m_ctx, onPskFindSession);
+    return {};
+}
+
+std::expected<void, SslError> SslContext::setPrivateKeyOffload(std::shared_ptr<SslKeyBackend> offload)
+{
+    if (!m_ctx) {
+        return std::unexpected(SslError(SslErrorCode::kContextCreateFailed));
+    }
+    if (!offload) {
+        return std::unexpected(SslError(SslErrorCode::kPrivateKeyLoadFailed));
+    }
+
+    auto replace = [&](EVP_PKEY* key) -> std::expected<void, SslError> {
+        auto replacement = offload->wrap(key);
+        if (!replacement) {
+            return std::unexpected(replacement.error());
+        }
+        const int used = SSL_CTX_use_PrivateKey(m_ctx, *replacement);
+        EVP_PKEY_free(*replacement);
+        if (used != 1) {
+            return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kPrivateKeyLoadFailed));
+        }
+        return {};
+    };
+
+    // 逐个证书槽位替换私钥（RSA 与 ECDSA 证书可同时加载）；遍历只覆盖已配齐私钥的槽位
+    size_t wrapped = 0;
+    for (int rc = SSL_CTX_set_current_cert(m_ctx, SSL_CERT_SET_FIRST); rc == 1;
+         rc = SSL_CTX_set_current_cert(m_ctx, SSL_CERT_SET_NEXT)) {
+        EVP_PKEY* key = SSL_CTX_get0_privatekey(m_ctx);
+        if (key == nullptr) {
+            continue;
+        }
+        if (auto replaced = replace(key); !replaced) {
+            return replaced;
+        }
+        ++wrapped;
+    }
+    if (wrapped == 0) {
+        // keyless：只加载了证书，以每个证书槽位的公钥生成由后端运算的密钥（ECDSA 与 RSA 可同时存在）
+        for (const auto& cert : m_leafCertificates) {
+            if (auto replaced = replace(X509_get0_pubkey(cert.get())); !replaced) {
+                return replaced;
+            }
+            ++wrapped;
+        }
+        if (wrapped == 0) {
+            return std::unexpected(SslError(SslErrorCode::kPrivateKeyLoadFailed));
+        }
+    }
+
+    SSL_CTX_set_mode(m_ctx, SSL_MODE_ASYNC);
+    m_keyOffload = std::move(offload);
+    m_asyncHandshake = true;
+    return {};
+}
+
+bool detail::preferEcdsaCertificate(SSL* ssl)
+{
+    if (!SSL_is_server(ssl)) {
+        return true;
+    }
+    EVP_PKEY* ecdsa = nullptr;
+    bool rsa = false;
+    for (long rc = SSL_set_current_cert(ssl, SSL_CERT_SET_FIRST); rc == 1;
+         rc = SSL_set_current_cert(ssl, SSL_CERT_SET_NEXT)) {
+        X509* candidate = SSL_get_certificate(ssl);
+        if (candidate == nullptr || SSL_get_privatekey(ssl) == nullptr) {
+            continue;
+        }
+        const int base = EVP_PKEY_get_base_id(X509_get0_pubkey(candidate));
+        if (base == EVP_PKEY_EC) {
+            ecdsa = X509_get0_pubkey(candidate);
+        }
+        rsa = rsa || base == EVP_PKEY_RSA;
+    }
+    const bool tls13 = helloNegotiatesTls13(ssl);
+    if (ecdsa == nullptr || !rsa || !peerAcceptsEcdsa(ssl, ecdsa, tls13)) {
+        return true;
+    }
+
+    // TLS 1.2 的密码套件决定证书类型，且不因签名算法收窄而排除 RSA 认证的套件：只保留已配置的 ECDSA 套件
+    std::string names;
+    if (!tls13) {
+        STACK_OF(SSL_CIPHER)* ciphers = SSL_get_ciphers(ssl);
+        for (int i = 0; ciphers != nullptr && i < sk_SSL_CIPHER_num(ciphers); ++i) {
+            const SSL_CIPHER* cipher = sk_SSL_CIPHER_value(ciphers, i);
+            if ((SSL_CIPHER_get_protocol_id(cipher) >> 8) != 0x13 &&
+                SSL_CIPHER_get_auth_nid(cipher) == NID_auth_ecdsa) {
+                names += (names.empty() ? "" : ":") + std::string(SSL_CIPHER_get_name(cipher));
+            }
+        }
+        if (names.empty()) {
+            return true;
+        }
+    }
+
+    // 签名算法在 ClientHello 回调之后才与对端求交集，此时收窄为 ECDSA，OpenSSL 便只会选用已有的 ECDSA 槽位；
+    // 证书与预压缩结果都不复制
+    if (SSL_set1_sigalgs_list(ssl, kEcdsaSigalgs) != 1 || (!tls13 && SSL_set_cipher_list(ssl, names.c_str()) != 1)) {
+        return false;
+    }
+    // 服务端验证客户端证书时 CertificateRequest 与 CertificateVerify 改用 client sigalgs，不受上面的收窄影响
+    if ((SSL_get_verify_mode(ssl) & SSL_VERIFY_PEER) != 0 && SSL_set1_client_sigalgs_list(ssl, kPeerSigalgs) != 1) {
+        return false;
+    }
+    return true;
+}
+
 } // namespace galay::ssl
@@ -3,14 +3,50 @@
 
 #include "galay-ssl/common/defn.hpp"
 #include "galay-ssl/common/error.h"
+#include "galay-ssl/ssl/ssl_client_session_cache.h"
+#include "galay-ssl/ssl/ssl_crl_index.h"
+#include "galay-ssl/ssl/ssl_early_data.h"
+#include "galay-ssl/ssl/ssl_key_offload.h"
+#include "galay-ssl/ssl/ssl_key_share_pool.h"
+#include "galay-ssl/ssl/ssl_ocsp_stapler.h"
+#include "galay-ssl/ssl/ssl_psk_store.h"
+#include "galay-ssl/ssl/ssl_session_cache.h"
+#include "galay-ssl/ssl/ssl_ticket_keys.h"
+#include "galay-ssl/ssl/ssl_trust_store.h"
+#include "galay-ssl/ssl/ssl_verify_cache.h"
+#include <cstdint>
 #include <expected>
 #include <string>
 #include <memory>
 #include <functional>
+#include <optional>
+#include <vector>
 
 namespace galay::ssl
 {
 
+/**
+ * @brief 服务端完整握手所用证书的密钥类型统计
+ */
+struct SslCertificateStats {
+    uint64_t ecdsa = 0;     ///< 以 ECDSA 证书完成的完整握手数
+    uint64_t rsa = 0;       ///< 以 RSA 证书完成的完整握手数
+    uint64_t other = 0;     ///< 以其他类型（如 Ed25519）证书完成的完整握手数
+};
+
+/**
+ * @brief 握手消息字节统计（握手层消息长度，不含记录层头部、加密开销与 ChangeCipherSpec）
+ */
+struct SslHandshakeByteStats {
+    uint64_t handshakes = 0;                    ///< 本端发出 Finished 的握手数（含会话恢复）
+    uint64_t bytesSent = 0;                     ///< 发出的握手消息字节
+    uint64_t bytesReceived = 0;                 ///< 收到的握手消息字节
+    uint64_t certificateBytesSent = 0;          ///< 其中 Certificate / CompressedCertificate 消息发出的字节
+    uint64_t certificateBytesReceived = 0;      ///< 其中 Certificate / CompressedCertificate 消息收到的字节
+    uint64_t compressedCertificatesSent = 0;    ///< 以 CompressedCertificate 发出证书的次数
+    uint64_t compressedCertificatesReceived = 0;///< 收到 CompressedCertificate 的次数
+};
+
 /**
  * @brief SSL 上下文类
  *
@@ -43,6 +79,15 @@ public:
      */
     explicit SslContext(SslMethod method);
 
+    /**
+     * @brief 构造从预生成池取 ECDHE 临时密钥的 SSL 上下文
+     * @param method SSL/TLS 协议方法
+     * @param keyShares 临时密钥预生成池，为空时与 SslContext(method) 相同
+     * @details SSL_CTX 以 keyShares->propertyQuery() 创建，握手生成 X25519 / EC key share 时
+     * 优先取这个池中的密钥；上下文持有池的引用
+     */
+    SslContext(SslMethod method, std::shared_ptr<SslKeySharePool> keyShares);
+
     /**
      * @brief 析构函数
      */
@@ -102,6 +147,21 @@ public:
         const std::string& keyFile,
         SslFileType type = SslFileType::PEM);
 
+    /**
+     * @brief 加载一对证书链与私钥
+     *
+     * @param certChainFile 证书链文件路径（叶子证书在前）
+     * @param keyFile 私钥文件路径
+     * @return 成功返回 void，失败返回 SslError
+     *
+     * @details 证书按密钥类型占用各自的槽位，ECDSA 与 RSA 可以各加载一对。两种都加载后，
+     * 服务端按每个 ClientHello 选择：对端签名算法（TLS 1.3 还要求与证书曲线一致）、
+     * 支持的曲线与密码套件允许 ECDSA 时只提供 ECDSA 证书，否则回退到 RSA。
+     * 实际使用的证书类型见 certificateStats()。
+     */
+    std::expected<void, SslError> loadCertificateKeyPair(const std::string& certChainFile,
+                                                         const std::string& keyFile);
+
     /**
      * @brief 加载 CA 证书文件
      *
@@ -124,6 +184,89 @@ public:
      */
     std::expected<void, SslError> useDefaultCA();
 
+    /**
+     * @brief 挂接共享信任库，替换上下文自己的 CA 存储
+     *
+     * @param store 只读信任库，可被多个上下文共享；nullptr 表示换回一个空的私有存储
+     *
+     * @details 以引用计数挂接同一个 X509_STORE（SSL_CTX_set1_cert_store），用于验证对端证书。
+     * 之前通过 loadCACertificate() 等加载的 CA 被丢弃；挂接期间 loadCACertificate() / loadCAPath() /
+     * useDefaultCA() 返回 kCACertificateLoadFailed，避免修改其他上下文共享的信任库。
+     */
+    void setTrustStore(std::shared_ptr<SslTrustStore> store);
+
+    /**
+     * @brief 获取当前挂接的共享信任库
+     */
+    const std::shared_ptr<SslTrustStore>& trustStore() const { return m_trustStore; }
+
+    /**
+     * @brief 预先构建并校验服务端证书链
+     *
+     * @param anchors 信任锚；为空时只用已加载的证书链自身校验（中间证书齐全、顺序正确）
+     * @return 成功返回 void；没有证书或证书链无法构建到可信根时返回 kCertChainBuildFailed
+     *
+     * @details 必须在加载证书之后调用，对每个证书槽位（双证书时两个都构建）调用 SSL_CTX_build_cert_chain()：
+     * 补齐 anchors 中的中间证书、按签发顺序排列、去掉根证书，结果保存在上下文中。
+     * 之后设置 SSL_MODE_NO_AUTO_CHAIN，握手直接发送预构建的链，不再逐次查找和验证证书链。
+     * 重新加载证书后需要再次调用。
+     */
+    std::expected<void, SslError> buildCertificateChain(const std::shared_ptr<SslTrustStore>& anchors = nullptr);
+
+    /**
+     * @brief 设置 TLS 1.3 证书压缩（RFC 8879）的算法偏好
+     *
+     * @param algorithms 按偏好排列的算法；空表示关闭证书压缩（收发都不使用）
+     * @return 成功返回 void；OpenSSL 早于 3.2 或列表中没有本机构建支持的算法时返回 kCompressionUnsupported
+     *
+     * @details 同时决定本端愿意接收的压缩格式（compress_certificate 扩展）与发送证书时可选的算法，
+     * 不支持的算法被忽略、重复的只保留第一次出现。已加载证书时立即按每种算法预压缩证书链
+     * （SSL_CTX_compress_certs），握手直接发送缓存的压缩结果，不再逐次压缩。
+     * 之后再 loadCertificate*() 或 buildCertificateChain() 时自动重新预压缩所有证书槽位。
+     */
+    std::expected<void, SslError> setCertificateCompression(const std::vector<SslCertCompression>& algorithms);
+
+    /**
+     * @brief 本机 OpenSSL 是否支持以该算法压缩证书
+     */
+    static bool certificateCompressionSupported(SslCertCompression algorithm);
+
+    /**
+     * @brief 以原始公钥（RFC 7250 raw public key）代替证书向对端证明身份
+     *
+     * @param keyFile 私钥文件，握手发送它的公钥（SubjectPublicKeyInfo），不发送证书
+     * @param type 文件类型，默认 PEM
+     * @return OpenSSL 早于 3.2、私钥无法读取或与已加载的证书不匹配时返回 kRawPublicKeyFailed
+     *
+     * @details 服务端向在 server_certificate_type 中提供 RPK 的客户端发送原始公钥；之前已加载同一私钥的证书时
+     * 其余客户端照常拿到证书，否则只能与 RPK 客户端握手。客户端在服务端要求客户端认证时发送原始公钥。
+     * 证书须在此之前加载。
+     */
+    std::expected<void, SslError> loadRawPublicKey(const std::string& keyFile, SslFileType type = SslFileType::PEM);
+
+    /**
+     * @brief 固定对端公钥：只接受以原始公钥认证、且公钥在列表中的对端
+     *
+     * @param keyFiles PEM 文件，每个文件可以包含多个 PUBLIC KEY，也可以是证书（取其公钥）；空表示关闭
+     * @return OpenSSL 早于 3.2、文件无法读取或不含公钥时返回 kRawPublicKeyFailed，此时原有配置不变
+     *
+     * @details 客户端只接受服务端发送原始公钥，服务端要求客户端以原始公钥认证。验证时以公钥的
+     * SubjectPublicKeyInfo DER 查表，不解析证书、不构建也不验证证书链，不经过验证缓存与 CRL 索引。
+     * 同时开启 SSL_VERIFY_PEER（服务端另加 SSL_VERIFY_FAIL_IF_NO_PEER_CERT），保留已设置的验证回调；
+     * 关闭时恢复默认的证书类型，不改变验证模式。
+     */
+    std::expected<void, SslError> setPinnedPublicKeys(const std::vector<std::string>& keyFiles);
+
+    /**
+     * @brief 当前固定的对端公钥数
+     */
+    size_t pinnedPublicKeyCount() const;
+
+    /**
+     * @brief 本机 OpenSSL 是否支持原始公钥（3.2 起）
+     */
+    static bool rawPublicKeySupported();
+
     /**
      * @brief 设置验证模式
      *
@@ -133,6 +276,39 @@ public:
     void setVerifyMode(SslVerifyMode mode,
                        std::function<bool(bool, X509_STORE_CTX*)> callback = nullptr);
 
+    /**
+     * @brief 挂接对端证书验证结果缓存（服务端验证客户端证书）
+     *
+     * @param cache 验证缓存，可被验证设置相同的多个上下文共享；nullptr 表示关闭
+     *
+     * @details 通过 SSL_CTX_set_cert_verify_callback() 接管 setVerifyMode() 开启的对端证书验证：
+     * 客户端证书（叶子指纹 + 信任库代数）命中时复用上次验证出的可信链，未命中时完整验证并缓存通过的结果。
+     * 只作用于服务端连接，客户端验证服务端证书时仍逐次验证（主机名等按连接设置的参数不进入缓存键）。
+     */
+    void setVerifyCache(std::shared_ptr<SslVerifyCache> cache);
+
+    /**
+     * @brief 获取当前挂接的验证缓存
+     */
+    const std::shared_ptr<SslVerifyCache>& verifyCache() const { return m_verifyCache; }
+
+    /**
+     * @brief 挂接 CRL 索引，检查对端证书链是否已被吊销
+     *
+     * @param index CRL 索引，可被多个上下文共享；nullptr 表示关闭
+     *
+     * @details 与 setVerifyCache() 共用证书验证回调：链验证（或验证缓存命中）通过后，
+     * 对链上每张非根证书按签发者与序列号查表，吊销时以 X509_V_ERR_CERT_REVOKED 失败。
+     * 检查在缓存之后进行，CRL 更新后已缓存的证书同样会被拒绝，无需清空验证缓存。
+     * 服务端与客户端连接都生效。
+     */
+    void setCrlIndex(std::shared_ptr<SslCrlIndex> index);
+
+    /**
+     * @brief 获取当前挂接的 CRL 索引
+     */
+    const std::shared_ptr<SslCrlIndex>& crlIndex() const { return m_crlIndex; }
+
     /**
      * @brief 设置验证深度
      * @param depth 证书链验证深度
@@ -187,17 +363,242 @@ public:
      */
     void setSessionTimeout(long timeout);
 
+    /**
+     * @brief 挂接外部服务端 Session 缓存
+     *
+     * @param cache Session 存储（如 SslSessionCache），nullptr 表示分离并恢复 OpenSSL 内置缓存
+     *
+     * @details 通过 new/get/remove session 回调接入，并关闭 OpenSSL 内置查找与存储
+     * （SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL）。同一个缓存可以挂到多个
+     * SslContext 上，让多 worker 共享 session。
+     *
+     * @note
+     * - 同时设置固定的 session id context，跨上下文恢复时两端必须一致
+     * - 服务端默认 num_tickets 为 0，此时会改为 1（TLS 1.3 有状态 ticket 也走该缓存）
+     * - 分离且没有 ticket 密钥环时恢复挂接前的 num_tickets，并清除固定的 session id context
+     */
+    void setSessionCache(std::shared_ptr<SslSessionStore> cache);
+
+    /**
+     * @brief 获取当前挂接的 Session 缓存
+     */
+    const std::shared_ptr<SslSessionStore>& sessionCache() const { return m_sessionCache; }
+
+    /**
+     * @brief 启用无状态 session ticket（服务端）
+     *
+     * @param ring 共享密钥环，nullptr 表示关闭 ticket、恢复服务端默认的 SSL_OP_NO_TICKET
+     *
+     * @details 清除 SSL_OP_NO_TICKET 并通过 ticket key 回调用密钥环加解密 ticket：
+     * TLS 1.2 走 RFC 5077 ticket，TLS 1.3 的 NewSessionTicket 也改为无状态。同一密钥环
+     * 可以挂到多个 SslContext 上，密钥文件相同的多个进程之间也能互相恢复。
+     *
+     * @note
+     * - 同时设置固定的 session id context，与 setSessionCache() 一致
+     * - num_tickets 为 0 时改为 1；用旧密钥解密成功时会重新签发 ticket
+     * - 关闭且没有外部缓存时恢复挂接前的 num_tickets，并清除固定的 session id context
+     */
+    void setSessionTicketKeys(std::shared_ptr<SslTicketKeyRing> ring);
+
+    /**
+     * @brief 获取当前挂接的 ticket 密钥环
+     */
+    const std::shared_ptr<SslTicketKeyRing>& sessionTicketKeys() const { return m_ticketKeys; }
+
+    /**
+     * @brief 挂接客户端自动 Session 缓存（客户端）
+     *
+     * @param cache 客户端缓存，nullptr 表示关闭并恢复 OpenSSL 默认缓存模式
+     *
+     * @details 设置 SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE，新 session
+     * （含 TLS 1.3 握手后下发的多张 ticket）经 new session 回调存入缓存；握手前由
+     * SslEngine::restoreCachedSession() / SslSocket::handshake() 按 host:port + SNI 自动取出。
+     */
+    void setClientSessionCache(std::shared_ptr<SslClientSessionCache> cache);
+
+    /**
+     * @brief 获取当前挂接的客户端 Session 缓存
+     */
+    const std::shared_ptr<SslClientSessionCache>& clientSessionCache() const { return m_clientSessionCache; }
+
+    /**
+     * @brief 设置 TLS 1.3 early data（0-RTT）上限（服务端）
+     *
+     * @param bytes 单个连接最多接受的 early data 字节数，0 表示关闭 0-RTT
+     *
+     * @details 同时设置 max_early_data（写入签发的 ticket，告知客户端可发送多少）与
+     * recv_max_early_data（实际接受的上限）。服务端还需要能签发 ticket：挂接
+     * setSessionTicketKeys() 或 setSessionCache() 之一。客户端无需设置，可发送量取决于 ticket。
+     */
+    void setMaxEarlyData(uint32_t bytes);
+
+    /**
+     * @brief 获取 early data 上限
+     */
+    uint32_t maxEarlyData() const;
+
+    /**
+     * @brief 挂接 0-RTT 防重放窗口（服务端）
+     *
+     * @param guard 防重放窗口，nullptr 表示恢复 OpenSSL 内置防重放
+     *
+     * @details 通过 allow early data 回调判断是否接受 early data，并设置 SSL_OP_NO_ANTI_REPLAY
+     * 关闭内置防重放（内置实现依赖有状态 session 缓存，无状态 ticket 的 0-RTT 不受保护）。
+     * 被拒绝时握手照常以 1-RTT 完成，客户端需要在握手后重发 early data。
+     */
+    void setEarlyDataReplayGuard(std::shared_ptr<SslEarlyDataReplayGuard> guard);
+
+    /**
+     * @brief 获取当前挂接的防重放窗口
+     */
+    const std::shared_ptr<SslEarlyDataReplayGuard>& earlyDataReplayGuard() const { return m_earlyDataGuard; }
+
+    /**
+     * @brief 挂接 TLS 1.3 外部预共享密钥（服务端与客户端均可）
+     *
+     * @param store PSK 存储，可被多个上下文共享；nullptr 表示关闭
+     * @param mode psk_dhe_ke（默认，保留 ECDHE）或 psk_ke（不做 ECDHE）
+     * @return 成功返回 void；无法设置密码套件时返回 kPskConfigFailed
+     *
+     * @details 服务端按客户端发送的身份查找密钥，客户端发送 store 的 clientIdentity。
+     * PSK 的哈希必须与协商出的套件一致，因此 TLS 1.3 套件被限制为 store 的 cipherSuite。
+     * PskKe 设置 SSL_OP_ALLOW_NO_DHE_KEX；OpenSSL 3.3 起服务端同时设置 SSL_OP_PREFER_NO_DHE_KEX
+     * 优先选择 psk_ke，更早的版本只有客户端不提供 psk_dhe_ke 时才会选择 psk_ke。
+     * 关闭时恢复默认的 ECDHE 要求，并恢复挂接前的 TLS 1.3 套件（挂接期间 setCiphersuites() 的修改被覆盖）。
+     */
+    std::expected<void, SslError> setPreSharedKeys(std::shared_ptr<SslPskStore> store,
+                                                   SslPskMode mode = SslPskMode::PskDheKe);
+
+    /**
+     * @brief 获取当前挂接的 PSK 存储
+     */
+    const std::shared_ptr<SslPskStore>& preSharedKeys() const { return m_pskStore; }
+
+    /**
+     * @brief 把私钥运算交给签名后端（服务端）
+     *
+     * @param offload 签名后端（SslKeyOffload 线程池或 SslKeylessClient），可被多个上下文共享
+     * @return 成功返回 void；没有可替换的密钥或后端不支持该密钥时返回 kPrivateKeyLoadFailed
+     *
+     * @details 必须在 loadCertificate() / loadPrivateKey() 之后调用：已加载的每个私钥被替换为
+     * 在 offload 上运算的等价密钥，并开启 SSL_MODE_ASYNC。未加载私钥时（keyless）改用当前证书的公钥，
+     * 私钥只存在于签名进程中。之后握手中的签名 / 解密不再阻塞调度线程，SslSocket::handshake()
+     * 在运算进行中挂起，运算结束后自动继续。
+     * 设置后不能撤销；重新 loadPrivateKey() 即恢复同步运算。
+     */
+    std::expected<void, SslError> setPrivateKeyOffload(std::shared_ptr<SslKeyBackend> offload);
+
+    /**
+     * @brief 获取当前挂接的签名后端
+     */
+    const std::shared_ptr<SslKeyBackend>& privateKeyOffload() const { return m_keyOffload; }
+
+    /**
+     * @brief 握手是否可能等待后台运算（doHandshake() 返回 WantAsync）
+     *
+     * @details setPrivateKeyOffload() 与 SslCertRouter 的前端上下文自动开启。开启后 SslSocket::handshake()
+     * 在调度器上的任务中推进握手并等待 asyncWaitFd()；未开启时直接在调用协程上推进，没有额外开销。
+     * 自行安装会返回 WantAsync 的回调（如 SSL_CLIENT_HELLO_RETRY）时需要手动开启。
+     */
+    bool asyncHandshake() const { return m_asyncHandshake; }
+    void setAsyncHandshake(bool enable) { m_asyncHandshake = enable; }
+
+    /**
+     * @brief 挂接 OCSP stapling（服务端）
+     *
+     * @param stapler 响应缓存，可被多个上下文共享；nullptr 表示关闭 stapling
+     * @return 没有证书或找不到证书的签发者时返回 kOcspFailed
+     *
+     * @details 必须在加载证书（含证书链）之后调用：已加载的每张证书登记到 stapler 并立即获取一次响应，
+     * 之后由 stapler 在后台刷新。客户端发送 status_request 时握手附带缓存中的响应。
+     * 上下文析构或替换 stapler 时撤销登记。
+     */
+    std::expected<void, SslError> setOcspStapler(std::shared_ptr<SslOcspStapler> stapler);
+
+    /**
+     * @brief 获取当前挂接的 OCSP stapler
+     */
+    const std::shared_ptr<SslOcspStapler>& ocspStapler() const { return m_ocspStapler; }
+
+    /**
+     * @brief 获取构造时挂接的临时密钥预生成池
+     */
+    const std::shared_ptr<SslKeySharePool>& keySharePool() const { return m_keyShares; }
+
+    /**
+     * @brief 服务端完整握手所用证书类型的统计（会话恢复不计入）
+     */
+    SslCertificateStats certificateStats() const;
+
+    /**
+     * @brief 开启或关闭握手消息字节统计（服务端与客户端均可）
+     *
+     * @details 通过 SSL_CTX_set_msg_callback 累计由本上下文创建的连接收发的握手消息，
+     * 用于衡量证书压缩、预构建证书链等对首轮消息大小的影响。设置只影响之后创建的连接；
+     * 关闭后保留已累计的数值。SNI 切换上下文的连接计入最初创建它的上下文。
+     */
+    void setHandshakeByteStats(bool enable);
+
+    /**
+     * @brief 握手消息字节统计快照，未开启过时全部为 0
+     */
+    SslHandshakeByteStats handshakeByteStats() const;
+
     /**
      * @brief 获取创建时的错误
      */
     const SslError& error() const { return m_error; }
 
 private:
+    struct CertificateCounters;
+    struct HandshakeByteCounters;
+    struct PinnedKeys;
+
+    void updateCertificateSelection();
+    std::expected<void, SslError> recompressCertificates();
+    void updateVerifyCallback();
+    void saveSessionDefaults();
+    void restoreSessionDefaults();
+
     SSL_CTX* m_ctx;                                             ///< OpenSSL SSL_CTX
     SslError m_error;                                           ///< 创建时的错误
     std::function<bool(bool, X509_STORE_CTX*)> m_verifyCallback;///< 验证回调
+    std::shared_ptr<SslSessionStore> m_sessionCache;            ///< 外部 Session 缓存
+    std::shared_ptr<SslTicketKeyRing> m_ticketKeys;             ///< Session ticket 密钥环
+    std::shared_ptr<SslClientSessionCache> m_clientSessionCache;///< 客户端 Session 缓存
+    std::shared_ptr<SslEarlyDataReplayGuard> m_earlyDataGuard;  ///< 0-RTT 防重放窗口
+    std::shared_ptr<SslPskStore> m_pskStore;                    ///< TLS 1.3 外部 PSK
+    std::optional<std::string> m_ciphersuitesBeforePsk;         ///< 挂接 PSK 前的 TLS 1.3 套件，关闭时恢复
+    std::shared_ptr<SslKeyBackend> m_keyOffload;                ///< 私钥运算签名后端
+    std::shared_ptr<SslKeySharePool> m_keyShares;               ///< 临时密钥预生成池
+    std::shared_ptr<SslOcspStapler> m_ocspStapler;              ///< OCSP 响应缓存
+    std::shared_ptr<SslTrustStore> m_trustStore;                ///< 共享信任库
+    std::shared_ptr<SslVerifyCache> m_verifyCache;              ///< 对端证书验证缓存
+    std::shared_ptr<SslCrlIndex> m_crlIndex;                    ///< 证书吊销索引
+    std::unique_ptr<CertificateCounters> m_certCounters;        ///< 证书类型计数（地址在移动后不变）
+    std::unique_ptr<HandshakeByteCounters> m_byteCounters;      ///< 握手字节计数（地址在移动后不变）
+    std::unique_ptr<PinnedKeys> m_pinnedKeys;                   ///< 固定的对端原始公钥
+    std::optional<size_t> m_savedNumTickets;                    ///< 挂接 session 缓存 / ticket 前的 num_tickets
+    std::vector<std::shared_ptr<X509>> m_leafCertificates;      ///< 每种密钥类型最后加载的叶子证书
+    bool m_server = false;                                      ///< 是否为服务端上下文
+    bool m_asyncHandshake = false;                              ///< 握手可能等待后台运算
+    bool m_certCompression = false;                             ///< 已开启证书压缩，加载证书后重新预压缩
 };
 
+namespace detail
+{
+
+/**
+ * @brief ECDSA 与 RSA 证书都已加载、且对端接受 ECDSA 时把连接的签名算法收窄为 ECDSA
+ *
+ * @details 只能在 ClientHello 回调中调用。上下文在同时加载两种证书时自行安装该回调；
+ * SslCertRouter 切换到后端上下文后代为调用（后端上下文自己的 ClientHello 回调不会执行）。
+ * @return 设置签名算法失败时返回 false
+ */
+bool preferEcdsaCertificate(SSL* ssl);
+
+} // namespace detail
+
 } // namespace galay::ssl
 
 #endif // GALAY_SSL_CONTEXT_H
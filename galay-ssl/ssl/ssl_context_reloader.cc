@@ -0,0 +1,143 @@
+#include "ssl_context_reloader.h"
+#include <sys/stat.h>
+
+namespace galay::ssl
+{
+
+SslContextReloader::SslContextReloader(SslContextReloaderOptions options)
+    : m_options(std::move(options))
+{
+    for (const std::string* file : {&m_options.certFile, &m_options.keyFile, &m_options.caFile}) {
+        if (!m_options.factory && !file->empty()) {
+            m_watched.push_back(*file);
+        }
+    }
+    m_watched.insert(m_watched.end(), m_options.watchFiles.begin(), m_options.watchFiles.end());
+}
+
+std::expected<std::shared_ptr<SslContextReloader>, SslError> SslContextReloader::create(
+    SslContextReloaderOptions options)
+{
+    std::shared_ptr<SslContextReloader> reloader(new SslContextReloader(std::move(options)));
+    if (auto reloaded = reloader->reload(); !reloaded) {
+        return std::unexpected(reloaded.error());
+    }
+    return reloader;
+}
+
+std::shared_ptr<SslContext> SslContextReloader::current() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_current;
+}
+
+std::expected<void, SslError> SslContextReloader::reload()
+{
+    std::lock_guard<std::mutex> guard(m_reloadMutex);
+    // 先记录文件身份再构建：构建期间文件再次变化时，下一次 reloadIfChanged() 仍会发现
+    auto stamps = snapshot();
+    auto built = build();
+    if (!built) {
+        m_failures.fetch_add(1, std::memory_order_relaxed);
+        return std::unexpected(built.error());
+    }
+    m_stamps = std::move(stamps);
+    publish(std::move(*built));
+    return {};
+}
+
+std::expected<bool, SslError> SslContextReloader::reloadIfChanged()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_reloadMutex);
+        if (snapshot() == m_stamps) {
+            return false;
+        }
+    }
+    if (auto reloaded = reload(); !reloaded) {
+        return std::unexpected(reloaded.error());
+    }
+    return true;
+}
+
+void SslContextReloader::replace(std::shared_ptr<SslContext> ctx)
+{
+    if (!ctx) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(m_reloadMutex);
+    publish(std::move(ctx));
+}
+
+SslContextReloadStats SslContextReloader::stats() const
+{
+    SslContextReloadStats result;
+    result.generation = m_generation.load(std::memory_order_acquire);
+    result.reloads = m_reloads.load(std::memory_order_relaxed);
+    result.failures = m_failures.load(std::memory_order_relaxed);
+    return result;
+}
+
+std::expected<std::shared_ptr<SslContext>, SslError> SslContextReloader::build() const
+{
+    if (m_options.factory) {
+        auto built = m_options.factory();
+        if (built && (!*built || !(*built)->isValid())) {
+            return std::unexpected(SslError(SslErrorCode::kContextCreateFailed));
+        }
+        return built;
+    }
+
+    auto ctx = std::make_shared<SslContext>(m_options.method);
+    if (!ctx->isValid()) {
+        return std::unexpected(ctx->error());
+    }
+    if (auto loaded = ctx->loadCertificateChain(m_options.certFile); !loaded) {
+        return std::unexpected(loaded.error());
+    }
+    if (auto loaded = ctx->loadPrivateKey(m_options.keyFile); !loaded) {
+        return std::unexpected(loaded.error());
+    }
+    if (!m_options.caFile.empty()) {
+        if (auto loaded = ctx->loadCACertificate(m_options.caFile); !loaded) {
+            return std::unexpected(loaded.error());
+        }
+    }
+    if (m_options.configure) {
+        if (auto configured = m_options.configure(*ctx); !configured) {
+            return std::unexpected(configured.error());
+        }
+    }
+    return ctx;
+}
+
+std::vector<SslContextReloader::FileStamp> SslContextReloader::snapshot() const
+{
+    std::vector<FileStamp> stamps(m_watched.size());
+    for (size_t i = 0; i < m_watched.size(); ++i) {
+        struct stat st{};
+        if (::stat(m_watched[i].c_str(), &st) != 0) {
+            continue;   // 不存在的文件保持 size = -1
+        }
+        stamps[i].device = static_cast<uint64_t>(st.st_dev);
+        stamps[i].inode = static_cast<uint64_t>(st.st_ino);
+        stamps[i].size = static_cast<int64_t>(st.st_size);
+        stamps[i].mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+    return stamps;
+}
+
+void SslContextReloader::publish(std::shared_ptr<SslContext> ctx)
+{
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        // 旧上下文在锁外释放：仍被连接持有时这里只是减引用
+        m_current.swap(ctx);
+    }
+    m_generation.fetch_add(1, std::memory_order_acq_rel);
+    if (ctx) {
+        m_reloads.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace galay::ssl
@@ -0,0 +1,159 @@
+#ifndef GALAY_SSL_CONTEXT_RELOADER_H
+#define GALAY_SSL_CONTEXT_RELOADER_H
+
+#include "galay-ssl/common/defn.hpp"
+#include "galay-ssl/common/error.h"
+#include "galay-ssl/ssl/ssl_context.h"
+#include <atomic>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 上下文构建回调：每次重载调用一次，返回完整配置好的新上下文
+ */
+using SslContextFactory = std::function<std::expected<std::shared_ptr<SslContext>, SslError>()>;
+
+/**
+ * @brief 可热重载上下文配置
+ */
+struct SslContextReloaderOptions {
+    SslMethod method = SslMethod::TLS_Server;   ///< 由文件构建时的协议方法
+    std::string certFile;                       ///< 证书（可含中间证书链）文件
+    std::string keyFile;                        ///< 私钥文件
+    std::string caFile;                         ///< CA bundle，空表示不加载（用于验证客户端证书）
+    /**
+     * @brief 由文件构建的上下文加载证书后调用，用于设置密码套件、协议版本、验证模式、
+     * 共享的 session 缓存与 ticket 密钥等
+     */
+    std::function<std::expected<void, SslError>(SslContext&)> configure;
+    SslContextFactory factory;                  ///< 非空时替代上面的文件加载，完全由调用方构建
+    std::vector<std::string> watchFiles;        ///< reloadIfChanged() 额外检查的文件（证书、私钥与 CA 已自动包含）
+};
+
+/**
+ * @brief 热重载统计
+ */
+struct SslContextReloadStats {
+    uint64_t generation = 0;    ///< 当前上下文的代数，create() 后为 1，每次成功替换加 1
+    uint64_t reloads = 0;       ///< 成功替换的次数（含 replace()）
+    uint64_t failures = 0;      ///< 构建失败、保留旧上下文的次数
+};
+
+/**
+ * @brief 可原子替换的服务端上下文
+ *
+ * @details 监听方每接受一个连接调用 current() 取得当前上下文的引用，交给
+ * SslSocket(std::shared_ptr<SslContext>, GHandle) 或 SslHandshakePool::submit()；
+ * 连接的 SslEngine 持有该引用直到连接结束。reload() 在调用线程上构建新上下文，
+ * 成功后一次指针交换发布：之后的握手使用新证书、CA 与密码策略，已建立或握手中的连接
+ * 继续使用各自的旧上下文，旧上下文在最后一个连接结束后释放。构建失败时保留旧上下文，
+ * 监听不会停顿也不会拿到半配置的上下文。
+ *
+ * 所有上下文使用相同的 session id context，configure 中挂接同一个 SslSessionCache /
+ * SslTicketKeyRing 时，重载前签发的 session 与 ticket 在重载后仍可恢复。
+ *
+ * @example
+ * @code
+ * auto reloader = SslContextReloader::create({
+ *     .certFile = "/etc/galay/server.crt",
+ *     .keyFile = "/etc/galay/server.key",
+ *     .configure = [ring](SslContext& ctx) { ctx.setSessionTicketKeys(ring); return std::expected<void, SslError>{}; },
+ * });
+ * // accept 循环
+ * SslSocket client((*reloader)->current(), handle);
+ * // 定时器或 SIGHUP
+ * (*reloader)->reloadIfChanged();
+ * @endcode
+ *
+ * @note
+ * - 线程安全，current() 只在交换指针的瞬间与 reload() 竞争一把读写锁
+ * - 证书文件应由外部原子替换（写临时文件后 rename），reloadIfChanged() 按 inode、大小与修改时间判断变化
+ */
+class SslContextReloader
+{
+public:
+    /**
+     * @brief 构建第一个上下文
+     * @return 构建失败时返回错误
+     */
+    static std::expected<std::shared_ptr<SslContextReloader>, SslError> create(SslContextReloaderOptions options);
+
+    SslContextReloader(const SslContextReloader&) = delete;
+    SslContextReloader& operator=(const SslContextReloader&) = delete;
+
+    /**
+     * @brief 当前上下文，新连接应持有该引用
+     */
+    std::shared_ptr<SslContext> current() const;
+
+    /**
+     * @brief 当前上下文的代数
+     */
+    uint64_t generation() const { return m_generation.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 重新构建并替换上下文
+     * @return 构建失败时返回错误并保留旧上下文
+     */
+    std::expected<void, SslError> reload();
+
+    /**
+     * @brief 被监视的文件自上次成功构建后发生变化时重载
+     * @return 是否执行了替换；文件变化但构建失败时返回错误，下一次调用会重试
+     */
+    std::expected<bool, SslError> reloadIfChanged();
+
+    /**
+     * @brief 直接发布一个外部构建好的上下文
+     */
+    void replace(std::shared_ptr<SslContext> ctx);
+
+    /**
+     * @brief 统计快照
+     */
+    SslContextReloadStats stats() const;
+
+    const SslContextReloaderOptions& options() const { return m_options; }
+
+private:
+    /**
+     * @brief 单个文件的身份：inode、大小与修改时间
+     */
+    struct FileStamp {
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        int64_t size = -1;
+        int64_t mtimeNs = 0;
+
+        bool operator==(const FileStamp&) const = default;
+    };
+
+    explicit SslContextReloader(SslContextReloaderOptions options);
+
+    std::expected<std::shared_ptr<SslContext>, SslError> build() const;
+    std::vector<FileStamp> snapshot() const;
+    void publish(std::shared_ptr<SslContext> ctx);
+
+    SslContextReloaderOptions m_options;
+    std::vector<std::string> m_watched;         ///< 证书、私钥、CA 与 watchFiles
+    mutable std::shared_mutex m_mutex;          ///< 保护 m_current
+    std::shared_ptr<SslContext> m_current;
+    std::mutex m_reloadMutex;                   ///< 串行化 reload()，保护 m_stamps
+    std::vector<FileStamp> m_stamps;            ///< 上次成功构建前记录的文件身份
+    std::atomic<uint64_t> m_generation{0};
+    std::atomic<uint64_t> m_reloads{0};
+    std::atomic<uint64_t> m_failures{0};
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_CONTEXT_RELOADER_H
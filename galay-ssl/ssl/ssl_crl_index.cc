@@ -0,0 +1,338 @@
+#include "ssl_crl_index.h"
+#include <openssl/pem.h>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace galay::ssl
+{
+
+namespace {
+
+/**
+ * @brief 以 mmap 读取文件中的全部 CRL（PEM 可包含多个，否则按单个 DER 解析）
+ */
+bool readCrls(const std::string& file, std::vector<X509_CRL*>& out)
+{
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    const size_t before = out.size();
+    BIO* bio = BIO_new_mem_buf(data, static_cast<int>(size));
+    if (bio != nullptr) {
+        constexpr char kPemMarker[] = "-----BEGIN";
+        const bool pem = size >= sizeof(kPemMarker) - 1 &&
+                         ::memmem(data, size, kPemMarker, sizeof(kPemMarker) - 1) != nullptr;
+        if (pem) {
+            while (X509_CRL* crl = PEM_read_bio_X509_CRL(bio, nullptr, nullptr, nullptr)) {
+                out.push_back(crl);
+            }
+        } else if (X509_CRL* crl = d2i_X509_CRL_bio(bio, nullptr)) {
+            out.push_back(crl);
+        }
+        BIO_free(bio);
+    }
+    ::munmap(data, size);
+    // PEM 读到末尾时留下的 “no start line” 不是错误
+    ERR_clear_error();
+    return out.size() > before;
+}
+
+/**
+ * @brief 用信任库中与 CRL 签发者同名的任一证书校验 CRL 签名
+ */
+bool verifyCrlSignature(X509_CRL* crl, X509_STORE* store)
+{
+    X509_STORE_CTX* ctx = X509_STORE_CTX_new();
+    if (ctx == nullptr || X509_STORE_CTX_init(ctx, store, nullptr, nullptr) != 1) {
+        X509_STORE_CTX_free(ctx);
+        return false;
+    }
+    STACK_OF(X509)* candidates = X509_STORE_CTX_get1_certs(ctx, X509_CRL_get_issuer(crl));
+    bool verified = false;
+    for (int i = 0; !verified && i < sk_X509_num(candidates); ++i) {
+        EVP_PKEY* key = X509_get0_pubkey(sk_X509_value(candidates, i));
+        verified = key != nullptr && X509_CRL_verify(crl, key) == 1;
+    }
+    sk_X509_pop_free(candidates, X509_free);
+    X509_STORE_CTX_free(ctx);
+    return verified;
+}
+
+time_t toTime(const ASN1_TIME* time)
+{
+    struct tm tm{};
+    if (time == nullptr || ASN1_TIME_to_tm(time, &tm) != 1) {
+        return 0;
+    }
+    return ::timegm(&tm);
+}
+
+std::string_view nameKey(const X509_NAME* name)
+{
+    const unsigned char* der = nullptr;
+    size_t length = 0;
+    if (name == nullptr || X509_NAME_get0_der(name, &der, &length) != 1) {
+        return {};
+    }
+    return {reinterpret_cast<const char*>(der), length};
+}
+
+std::string_view serialKey(const ASN1_INTEGER* serial)
+{
+    if (serial == nullptr) {
+        return {};
+    }
+    return {reinterpret_cast<const char*>(ASN1_STRING_get0_data(serial)),
+            static_cast<size_t>(ASN1_STRING_length(serial))};
+}
+
+} // anonymous namespace
+
+SslCrlIndex::SslCrlIndex(SslCrlIndexOptions options)
+    : m_options(std::move(options))
+{
+}
+
+SslCrlIndex::~SslCrlIndex()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+std::expected<std::shared_ptr<SslCrlIndex>, SslError> SslCrlIndex::create(SslCrlIndexOptions options)
+{
+    if (options.crlFiles.empty() || !options.issuers) {
+        return std::unexpected(SslError(SslErrorCode::kCrlLoadFailed));
+    }
+
+    std::shared_ptr<SslCrlIndex> index(new SslCrlIndex(std::move(options)));
+    auto stamps = index->snapshot();
+    auto built = index->build();
+    if (!built) {
+        return std::unexpected(built.error());
+    }
+    index->m_stamps = std::move(stamps);
+    index->publish(std::move(*built));
+    if (index->m_options.reloadInterval.count() > 0) {
+        index->m_thread = std::thread([raw = index.get()] { raw->reloadLoop(); });
+    }
+    return index;
+}
+
+std::expected<void, SslError> SslCrlIndex::reload()
+{
+    std::lock_guard<std::mutex> guard(m_reloadMutex);
+    // 先记录文件身份再构建：构建期间文件再次变化时，下一次 reloadIfChanged() 仍会发现
+    auto stamps = snapshot();
+    auto built = build();
+    if (!built) {
+        m_failures.fetch_add(1, std::memory_order_relaxed);
+        return std::unexpected(built.error());
+    }
+    m_stamps = std::move(stamps);
+    publish(std::move(*built));
+    m_reloads.fetch_add(1, std::memory_order_relaxed);
+    return {};
+}
+
+std::expected<bool, SslError> SslCrlIndex::reloadIfChanged()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_reloadMutex);
+        if (snapshot() == m_stamps) {
+            return false;
+        }
+    }
+    if (auto reloaded = reload(); !reloaded) {
+        return std::unexpected(reloaded.error());
+    }
+    return true;
+}
+
+int SslCrlIndex::check(X509_STORE_CTX* ctx)
+{
+    auto index = current();
+    STACK_OF(X509)* chain = X509_STORE_CTX_get0_chain(ctx);
+    if (!index || chain == nullptr) {
+        return 1;
+    }
+    m_checks.fetch_add(1, std::memory_order_relaxed);
+
+    // 链尾是信任锚，不做吊销检查
+    const int count = sk_X509_num(chain);
+    for (int depth = 0; depth + 1 < count; ++depth) {
+        X509* cert = sk_X509_value(chain, depth);
+        const int status = lookup(*index, cert, sk_X509_value(chain, depth + 1), m_options.allowExpired);
+        if (status == X509_V_OK) {
+            continue;
+        }
+        if (status == X509_V_ERR_CERT_REVOKED) {
+            m_revoked.fetch_add(1, std::memory_order_relaxed);
+        }
+        X509_STORE_CTX_set_error(ctx, status);
+        X509_STORE_CTX_set_error_depth(ctx, depth);
+        X509_STORE_CTX_set_current_cert(ctx, cert);
+        X509_STORE_CTX_verify_cb callback = X509_STORE_CTX_get_verify_cb(ctx);
+        if (callback == nullptr || callback(0, ctx) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+bool SslCrlIndex::isRevoked(X509* cert, X509* issuer) const
+{
+    auto index = current();
+    return index && cert && issuer && lookup(*index, cert, issuer, true) == X509_V_ERR_CERT_REVOKED;
+}
+
+SslCrlIndexStats SslCrlIndex::stats() const
+{
+    SslCrlIndexStats result;
+    result.generation = m_generation.load(std::memory_order_acquire);
+    result.reloads = m_reloads.load(std::memory_order_relaxed);
+    result.failures = m_failures.load(std::memory_order_relaxed);
+    result.checks = m_checks.load(std::memory_order_relaxed);
+    result.revoked = m_revoked.load(std::memory_order_relaxed);
+    if (auto index = current()) {
+        result.crls = index->crls;
+        result.entries = index->entries;
+    }
+    return result;
+}
+
+std::expected<std::shared_ptr<const SslCrlIndex::Index>, SslError> SslCrlIndex::build() const
+{
+    std::vector<X509_CRL*> crls;
+    bool ok = true;
+    for (const auto& file : m_options.crlFiles) {
+        ok = ok && readCrls(file, crls);
+    }
+    X509_STORE* store = m_options.issuers->native();
+    for (size_t i = 0; ok && i < crls.size(); ++i) {
+        ok = verifyCrlSignature(crls[i], store);
+    }
+    if (!ok) {
+        for (X509_CRL* crl : crls) {
+            X509_CRL_free(crl);
+        }
+        return std::unexpected(SslError(SslErrorCode::kCrlLoadFailed));
+    }
+
+    auto index = std::make_shared<Index>();
+    for (X509_CRL* crl : crls) {
+        const std::string_view name = nameKey(X509_CRL_get_issuer(crl));
+        const time_t thisUpdate = toTime(X509_CRL_get0_lastUpdate(crl));
+        auto it = index->issuers.find(name);
+        if (it == index->issuers.end()) {
+            it = index->issuers.emplace(std::string(name), Issuer{}).first;
+            ++index->crls;
+        } else if (thisUpdate <= it->second.thisUpdate) {
+            continue;   // 同一签发者只保留最新的 CRL
+        } else {
+            index->entries -= it->second.serials.size();
+            it->second.serials.clear();
+        }
+
+        Issuer& issuer = it->second;
+        issuer.thisUpdate = thisUpdate;
+        issuer.nextUpdate = toTime(X509_CRL_get0_nextUpdate(crl));
+        STACK_OF(X509_REVOKED)* revoked = X509_CRL_get_REVOKED(crl);
+        const int count = sk_X509_REVOKED_num(revoked);
+        issuer.serials.reserve(static_cast<size_t>(count > 0 ? count : 0));
+        for (int i = 0; i < count; ++i) {
+            issuer.serials.emplace(serialKey(X509_REVOKED_get0_serialNumber(sk_X509_REVOKED_value(revoked, i))));
+        }
+        index->entries += issuer.serials.size();
+    }
+    for (X509_CRL* crl : crls) {
+        X509_CRL_free(crl);
+    }
+    return std::shared_ptr<const Index>(std::move(index));
+}
+
+std::vector<SslCrlIndex::FileStamp> SslCrlIndex::snapshot() const
+{
+    std::vector<FileStamp> stamps(m_options.crlFiles.size());
+    for (size_t i = 0; i < m_options.crlFiles.size(); ++i) {
+        struct stat st{};
+        if (::stat(m_options.crlFiles[i].c_str(), &st) != 0) {
+            continue;   // 不存在的文件保持 size = -1
+        }
+        stamps[i].device = static_cast<uint64_t>(st.st_dev);
+        stamps[i].inode = static_cast<uint64_t>(st.st_ino);
+        stamps[i].size = static_cast<int64_t>(st.st_size);
+        stamps[i].mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+    return stamps;
+}
+
+std::shared_ptr<const SslCrlIndex::Index> SslCrlIndex::current() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_current;
+}
+
+void SslCrlIndex::publish(std::shared_ptr<const Index> index)
+{
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        // 旧索引在锁外释放：正在检查的连接仍持有它时这里只是减引用
+        m_current.swap(index);
+    }
+    m_generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+int SslCrlIndex::lookup(const Index& index, X509* cert, X509* issuer, bool allowExpired)
+{
+    auto it = index.issuers.find(nameKey(X509_get_subject_name(issuer)));
+    if (it == index.issuers.end()) {
+        return X509_V_OK;
+    }
+    if (it->second.serials.contains(serialKey(X509_get0_serialNumber(cert)))) {
+        return X509_V_ERR_CERT_REVOKED;
+    }
+    if (!allowExpired && it->second.nextUpdate != 0 && it->second.nextUpdate < ::time(nullptr)) {
+        return X509_V_ERR_CRL_HAS_EXPIRED;
+    }
+    return X509_V_OK;
+}
+
+void SslCrlIndex::reloadLoop()
+{
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    while (!m_stopping) {
+        if (m_cv.wait_for(lock, m_options.reloadInterval, [this] { return m_stopping; })) {
+            break;
+        }
+        lock.unlock();
+        // 失败已计入统计，旧索引继续生效，下一个周期重试
+        (void)reloadIfChanged();
+        lock.lock();
+    }
+}
+
+} // namespace galay::ssl
@@ -0,0 +1,182 @@
+#ifndef GALAY_SSL_CRL_INDEX_H
+#define GALAY_SSL_CRL_INDEX_H
+
+#include "galay-ssl/common/defn.hpp"
+#include "galay-ssl/common/error.h"
+#include "galay-ssl/ssl/ssl_trust_store.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief CRL 索引配置
+ */
+struct SslCrlIndexOptions {
+    std::vector<std::string> crlFiles;          ///< CRL 文件，PEM（可包含多个 CRL）或 DER 格式
+    std::shared_ptr<SslTrustStore> issuers;     ///< CRL 签发者（CA 与中间 CA），用于校验 CRL 签名
+    bool allowExpired = false;                  ///< nextUpdate 已过的 CRL 仍然生效；默认按 X509_V_ERR_CRL_HAS_EXPIRED 拒绝
+    std::chrono::milliseconds reloadInterval{0};///< 后台线程检查文件变化的间隔，0 表示不启动线程
+};
+
+/**
+ * @brief CRL 索引统计
+ */
+struct SslCrlIndexStats {
+    uint64_t generation = 0;    ///< 当前索引的代数，create() 后为 1，每次成功重建加 1
+    uint64_t reloads = 0;       ///< 成功重建的次数（不含 create()）
+    uint64_t failures = 0;      ///< 重建失败、保留旧索引的次数
+    uint64_t checks = 0;        ///< 检查过的证书链数
+    uint64_t revoked = 0;       ///< 因证书已吊销而拒绝的次数
+    size_t crls = 0;            ///< 当前索引中的 CRL 数（每个签发者只保留 thisUpdate 最新的一份）
+    size_t entries = 0;         ///< 当前索引中的吊销序列号数
+};
+
+/**
+ * @brief 按序列号哈希索引的证书吊销列表
+ *
+ * @details 构建时以 mmap 读取 CRL 文件，用 issuers 中同名签发者的公钥校验签名，
+ * 再把吊销条目展开为“签发者名称 DER → 序列号集合”的哈希表。SslContext::setCrlIndex() 挂接后，
+ * 对端证书链验证通过时对链上每张非根证书查表，单次查找为 O(1)，与 CRL 的条目数无关；
+ * 而 X509_V_FLAG_CRL_CHECK 每次验证都要在 X509_STORE 中查找 CRL 并逐条比对。
+ *
+ * reload() 在调用线程（或后台线程）上构建完整的新索引，成功后一次指针交换发布：
+ * 握手只在取当前索引的瞬间持读锁，不会被构建阻塞，也不会看到半构建的索引；
+ * 任一文件读取、解析或签名校验失败时保留旧索引。
+ *
+ * @example
+ * @code
+ * auto index = SslCrlIndex::create({
+ *     .crlFiles = {"/etc/galay/ca.crl"},
+ *     .issuers = trust,
+ *     .reloadInterval = std::chrono::seconds(30),
+ * });
+ * for (auto& worker : workers) {
+ *     worker.ctx->setCrlIndex(*index);
+ * }
+ * @endcode
+ *
+ * @note
+ * - 线程安全，多个上下文可以共享同一个索引
+ * - 没有加载 CRL 的签发者所签发的证书不做吊销检查
+ * - 不支持 delta CRL 与间接 CRL；CRL 文件应由外部原子替换（写临时文件后 rename）
+ */
+class SslCrlIndex
+{
+public:
+    /**
+     * @brief 加载 CRL 并构建索引
+     * @return 没有 CRL 文件或签发者、任一 CRL 读取、解析或签名校验失败时返回 kCrlLoadFailed
+     */
+    static std::expected<std::shared_ptr<SslCrlIndex>, SslError> create(SslCrlIndexOptions options);
+
+    ~SslCrlIndex();
+
+    SslCrlIndex(const SslCrlIndex&) = delete;
+    SslCrlIndex& operator=(const SslCrlIndex&) = delete;
+
+    /**
+     * @brief 重新加载全部 CRL 并原子替换索引
+     * @return 失败时保留旧索引并返回 kCrlLoadFailed
+     */
+    std::expected<void, SslError> reload();
+
+    /**
+     * @brief CRL 文件的 inode、大小或修改时间变化时重新加载
+     * @return 是否发生了替换
+     */
+    std::expected<bool, SslError> reloadIfChanged();
+
+    /**
+     * @brief 检查已验证通过的证书链（由证书验证回调调用）
+     * @return 与 X509_verify_cert() 相同：1 表示通过；吊销或 CRL 过期时把错误写入 ctx，
+     * 并交给 ctx 的验证回调决定是否放行
+     */
+    int check(X509_STORE_CTX* ctx);
+
+    /**
+     * @brief 查询 cert 是否被 issuer 的 CRL 吊销
+     */
+    bool isRevoked(X509* cert, X509* issuer) const;
+
+    /**
+     * @brief 获取统计快照
+     */
+    SslCrlIndexStats stats() const;
+
+    const SslCrlIndexOptions& options() const { return m_options; }
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+    };
+
+    using Serials = std::unordered_set<std::string, Hash, std::equal_to<>>;
+
+    struct Issuer {
+        Serials serials;                ///< 吊销证书序列号（ASN1_INTEGER 内容字节）
+        time_t thisUpdate = 0;
+        time_t nextUpdate = 0;          ///< 0 表示 CRL 没有 nextUpdate
+    };
+
+    struct Index {
+        std::unordered_map<std::string, Issuer, Hash, std::equal_to<>> issuers;   ///< 键为签发者名称 DER
+        size_t crls = 0;
+        size_t entries = 0;
+    };
+
+    struct FileStamp {
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        int64_t size = -1;
+        int64_t mtimeNs = 0;
+
+        bool operator==(const FileStamp&) const = default;
+    };
+
+    explicit SslCrlIndex(SslCrlIndexOptions options);
+
+    std::expected<std::shared_ptr<const Index>, SslError> build() const;
+    std::vector<FileStamp> snapshot() const;
+    std::shared_ptr<const Index> current() const;
+    void publish(std::shared_ptr<const Index> index);
+    static int lookup(const Index& index, X509* cert, X509* issuer, bool allowExpired);
+    void reloadLoop();
+
+    SslCrlIndexOptions m_options;
+    mutable std::shared_mutex m_mutex;          ///< 保护 m_current
+    std::shared_ptr<const Index> m_current;
+    std::mutex m_reloadMutex;                   ///< 串行化 reload()，保护 m_stamps
+    std::vector<FileStamp> m_stamps;
+    std::atomic<uint64_t> m_generation{0};
+    std::atomic<uint64_t> m_reloads{0};
+    std::atomic<uint64_t> m_failures{0};
+    std::atomic<uint64_t> m_checks{0};
+    std::atomic<uint64_t> m_revoked{0};
+
+    std::thread m_thread;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_cv;
+    bool m_stopping = false;
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_CRL_INDEX_H
@@ -0,0 +1,87 @@
+#include "ssl_early_data.h"
+#include <algorithm>
+#include <openssl/evp.h>
+
+namespace galay::ssl
+{
+
+namespace {
+
+constexpr std::chrono::seconds kMinReplayWindow{10};
+
+} // anonymous namespace
+
+SslEarlyDataReplayGuard::SslEarlyDataReplayGuard(SslEarlyDataOptions options)
+    : m_options(options)
+{
+    m_options.replayWindow = std::max(m_options.replayWindow, kMinReplayWindow);
+    m_options.capacity = std::max<size_t>(1, m_options.capacity);
+}
+
+bool SslEarlyDataReplayGuard::admit(SSL* ssl)
+{
+    SSL_SESSION* session = ssl ? SSL_get_session(ssl) : nullptr;
+    if (!session) {
+        return false;
+    }
+
+    // 恢复出的 PSK 对每张 ticket 唯一，只记录其摘要
+    unsigned char secret[SSL_MAX_MASTER_KEY_LENGTH];
+    const size_t length = SSL_SESSION_get_master_key(session, secret, sizeof(secret));
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLength = 0;
+    const bool hashed = length > 0 &&
+        EVP_Digest(secret, length, digest, &digestLength, EVP_sha256(), nullptr) == 1;
+    OPENSSL_cleanse(secret, sizeof(secret));
+    if (!hashed) {
+        return false;
+    }
+    return admit(std::string(reinterpret_cast<const char*>(digest), digestLength));
+}
+
+bool SslEarlyDataReplayGuard::admit(const std::string& fingerprint, Clock::time_point now)
+{
+    std::lock_guard lock(m_mutex);
+    pruneLocked(now);
+    if (m_seen.contains(fingerprint)) {
+        ++m_replayed;
+        return false;
+    }
+    if (m_seen.size() >= m_options.capacity) {
+        // 无法记录就无法识别重放，宁可退回 1-RTT
+        ++m_overflow;
+        return false;
+    }
+    m_seen.insert(fingerprint);
+    m_order.emplace_back(now, fingerprint);
+    ++m_accepted;
+    return true;
+}
+
+void SslEarlyDataReplayGuard::pruneLocked(Clock::time_point now)
+{
+    while (!m_order.empty() && now - m_order.front().first >= m_options.replayWindow) {
+        m_seen.erase(m_order.front().second);
+        m_order.pop_front();
+    }
+}
+
+SslEarlyDataStats SslEarlyDataReplayGuard::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    SslEarlyDataStats result;
+    result.accepted = m_accepted;
+    result.replayed = m_replayed;
+    result.overflow = m_overflow;
+    result.recorded = m_seen.size();
+    return result;
+}
+
+void SslEarlyDataReplayGuard::clear()
+{
+    std::lock_guard lock(m_mutex);
+    m_seen.clear();
+    m_order.clear();
+}
+
+} // namespace galay::ssl
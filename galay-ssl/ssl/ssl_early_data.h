@@ -0,0 +1,95 @@
+#ifndef GALAY_SSL_EARLY_DATA_H
+#define GALAY_SSL_EARLY_DATA_H
+
+#include "galay-ssl/common/defn.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 0-RTT 防重放配置
+ */
+struct SslEarlyDataOptions {
+    std::chrono::seconds replayWindow{10};  ///< 记录窗口，不小于 OpenSSL 的 ticket age 容差（10 秒）
+    size_t capacity = 65536;                ///< 窗口内最多记录的 ticket 数，记满后拒绝 0-RTT
+};
+
+/**
+ * @brief 0-RTT 防重放统计
+ */
+struct SslEarlyDataStats {
+    uint64_t accepted = 0;      ///< 允许 0-RTT 的次数
+    uint64_t replayed = 0;      ///< 窗口内重复出现而拒绝的次数
+    uint64_t overflow = 0;      ///< 记录已满而拒绝的次数
+    size_t recorded = 0;        ///< 当前窗口内的记录数
+};
+
+/**
+ * @brief TLS 1.3 0-RTT 防重放窗口
+ *
+ * @details 由 SslContext::setEarlyDataReplayGuard() 通过 allow early data 回调接入。
+ * 每个 ticket 恢复出的 PSK 各不相同，窗口内按 PSK 指纹记录，同一 ticket 第二次携带 early data 时
+ * 拒绝 0-RTT（握手照常以 1-RTT 完成）。窗口之外的重放由 OpenSSL 的 ticket age 检查拒绝，
+ * 因此窗口不会短于其 10 秒容差。
+ *
+ * 与 OpenSSL 内置防重放（依赖有状态 session 缓存）不同，本窗口同样适用于无状态 ticket；
+ * 多个 worker 上下文共享同一实例即可覆盖整个进程。跨进程部署需要每个进程各自的 ticket 密钥，
+ * 或接受进程间的重放风险。
+ *
+ * @note early data 本身没有前向安全且可被重放，只应承载幂等请求
+ */
+class SslEarlyDataReplayGuard
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit SslEarlyDataReplayGuard(SslEarlyDataOptions options = {});
+
+    SslEarlyDataReplayGuard(const SslEarlyDataReplayGuard&) = delete;
+    SslEarlyDataReplayGuard& operator=(const SslEarlyDataReplayGuard&) = delete;
+
+    /**
+     * @brief 判断当前恢复的 session 是否可以接受 early data（由回调调用）
+     * @return 首次出现返回 true 并记录，窗口内重复或记录已满返回 false
+     */
+    bool admit(SSL* ssl);
+
+    /**
+     * @brief 按指纹判断并记录
+     */
+    bool admit(const std::string& fingerprint, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 统计快照
+     */
+    SslEarlyDataStats stats() const;
+
+    /**
+     * @brief 清空记录
+     */
+    void clear();
+
+    const SslEarlyDataOptions& options() const { return m_options; }
+
+private:
+    void pruneLocked(Clock::time_point now);
+
+    SslEarlyDataOptions m_options;
+    mutable std::mutex m_mutex;
+    std::unordered_set<std::string> m_seen;
+    std::deque<std::pair<Clock::time_point, std::string>> m_order;  ///< 按记录时间排序
+    uint64_t m_accepted = 0;
+    uint64_t m_replayed = 0;
+    uint64_t m_overflow = 0;
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_EARLY_DATA_H
@@ -1,8 +1,28 @@
 #include "ssl_engine.h"
+#include <algorithm>
+#include <cstdint>
 
 namespace galay::ssl
 {
 
+namespace {
+
+/**
+ * @brief SSL 上的 ex_data 槽位：握手回调登记的重试等待 fd，以 fd + 1 存放（0 表示未登记）
+ */
+int retryWaitFdIndex()
+{
+    static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+} // anonymous namespace
+
+void detail::setRetryWaitFd(SSL* ssl, int fd)
+{
+    SSL_set_ex_data(ssl, retryWaitFdIndex(), reinterpret_cast<void*>(static_cast<intptr_t>(fd + 1)));
+}
+
 SslEngine::SslEngine(SslContext* ctx)
     : m_ssl(nullptr)
     , m_ctx(ctx)
@@ -13,6 +33,12 @@ SslEngine::SslEngine(SslContext* ctx)
     }
 }
 
+SslEngine::SslEngine(std::shared_ptr<SslContext> ctx)
+    : SslEngine(ctx.get())
+{
+    m_ctxRef = std::move(ctx);
+}
+
 SslEngine::~SslEngine()
 {
     if (m_ssl) {
@@ -24,6 +50,7 @@ SslEngine::~SslEngine()
 SslEngine::SslEngine(SslEngine&& other) noexcept
     : m_ssl(other.m_ssl)
     , m_ctx(other.m_ctx)
+    , m_ctxRef(std::move(other.m_ctxRef))
     , m_handshakeState(other.m_handshakeState)
     , m_rbio(other.m_rbio)
     , m_wbio(other.m_wbio)
@@ -43,6 +70,7 @@ SslEngine& SslEngine::operator=(SslEngine&& other) noexcept
         }
         m_ssl = other.m_ssl;
         m_ctx = other.m_ctx;
+        m_ctxRef = std::move(other.m_ctxRef);
         m_handshakeState = other.m_handshakeState;
         m_rbio = other.m_rbio;
         m_wbio = other.m_wbio;
@@ -107,6 +135,37 @@ size_t SslEngine::pendingEncryptedOutput() const
     return BIO_ctrl_pending(m_wbio);
 }
 
+size_t SslEngine::peekEncryptedOutput(const char** data) const
+{
+    if (!m_wbio || !data) return 0;
+    char* ptr = nullptr;
+    const long length = BIO_get_mem_data(m_wbio, &ptr);
+    if (length <= 0 || !ptr) {
+        *data = nullptr;
+        return 0;
+    }
+    *data = ptr;
+    return static_cast<size_t>(length);
+}
+
+size_t SslEngine::consumeEncryptedOutput(size_t length)
+{
+    if (!m_wbio) return 0;
+
+    // Memory BIO 没有 skip 接口，借助栈上缓冲区按块丢弃已发送的密文
+    char scratch[4096];
+    size_t consumed = 0;
+    while (consumed < length) {
+        const size_t chunk = std::min(length - consumed, sizeof(scratch));
+        const int n = BIO_read(m_wbio, scratch, static_cast<int>(chunk));
+        if (n <= 0) {
+            break;
+        }
+        consumed += static_cast<size_t>(n);
+    }
+    return consumed;
+}
+
 std::expected<void, SslError> SslEngine::setHostname(const std::string& hostname)
 {
     if (!m_ssl) {
@@ -323,4 +382,124 @@ bool SslEngine::isSessionReused() const
     return SSL_session_reused(m_ssl) == 1;
 }
 
+bool SslEngine::restoreCachedSession(const std::string& peer)
+{
+    if (!m_ssl || !m_ctx || !m_ctx->clientSessionCache()) {
+        return false;
+    }
+
+    const char* sni = SSL_get_servername(m_ssl, TLSEXT_NAMETYPE_host_name);
+    const std::string key = SslClientSessionCache::makeKey(peer, sni ? sni : "");
+    SslClientSessionCache::bindKey(m_ssl, key);
+    if (SSL_get0_session(m_ssl) != nullptr) {
+        return false;
+    }
+
+    SSL_SESSION* session = m_ctx->clientSessionCache()->take(key);
+    if (!session) {
+        return false;
+    }
+    const bool restored = SSL_set_session(m_ssl, session) == 1;
+    SSL_SESSION_free(session);
+    return restored;
+}
+
+SslIOResult SslEngine::writeEarlyData(const char* buffer, size_t length, size_t& bytesWritten)
+{
+    bytesWritten = 0;
+    if (!m_ssl) {
+        return SslIOResult::Error;
+    }
+
+    const uint32_t limit = maxEarlyData();
+    if (limit == 0) {
+        return SslIOResult::Error;
+    }
+    length = std::min<size_t>(length, limit);
+
+    ERR_clear_error();
+    size_t written = 0;
+    const int ret = SSL_write_early_data(m_ssl, buffer, length, &written);
+    if (ret == 1) {
+        bytesWritten = written;
+        return SslIOResult::Success;
+    }
+    return sslErrorToResult(SSL_get_error(m_ssl, ret));
+}
+
+SslIOResult SslEngine::readEarlyData(char* buffer, size_t length, size_t& bytesRead)
+{
+    bytesRead = 0;
+    if (!m_ssl) {
+        return SslIOResult::Error;
+    }
+
+    ERR_clear_error();
+    size_t readBytes = 0;
+    const int ret = SSL_read_early_data(m_ssl, buffer, length, &readBytes);
+    switch (ret) {
+    case SSL_READ_EARLY_DATA_SUCCESS:
+        bytesRead = readBytes;
+        return SslIOResult::Success;
+    case SSL_READ_EARLY_DATA_FINISH:
+        if (SSL_is_init_finished(m_ssl)) {
+            m_handshakeState = SslHandshakeState::Completed;
+        }
+        return SslIOResult::ZeroReturn;
+    default:
+        break;
+    }
+
+    const SslIOResult result = sslErrorToResult(SSL_get_error(m_ssl, ret));
+    if (result == SslIOResult::Error || result == SslIOResult::Syscall) {
+        m_handshakeState = SslHandshakeState::Failed;
+    } else {
+        m_handshakeState = SslHandshakeState::InProgress;
+    }
+    return result;
+}
+
+SslEarlyDataStatus SslEngine::earlyDataStatus() const
+{
+    if (!m_ssl) {
+        return SslEarlyDataStatus::NotSent;
+    }
+    return static_cast<SslEarlyDataStatus>(SSL_get_early_data_status(m_ssl));
+}
+
+uint32_t SslEngine::maxEarlyData() const
+{
+    if (!m_ssl) {
+        return 0;
+    }
+    if (SSL_is_server(m_ssl)) {
+        return SSL_get_max_early_data(m_ssl);
+    }
+    const SSL_SESSION* session = SSL_get0_session(m_ssl);
+    return session ? SSL_SESSION_get_max_early_data(session) : 0;
+}
+
+int SslEngine::asyncWaitFd() const
+{
+    if (!m_ssl) {
+        return -1;
+    }
+    // 握手回调只在等待期间登记重试 fd，继续握手前会清除，因此优先于 async job 的等待 fd
+    const int retry_fd = static_cast<int>(reinterpret_cast<intptr_t>(SSL_get_ex_data(m_ssl, retryWaitFdIndex()))) - 1;
+    if (retry_fd >= 0) {
+        return retry_fd;
+    }
+    // 每个连接只登记一个等待 fd（见 SslKeyOffload），取第一个即可
+    OSSL_ASYNC_FD fd = -1;
+    size_t count = 0;
+    if (SSL_get_all_async_fds(m_ssl, nullptr, &count) != 1 || count == 0) {
+        return -1;
+    }
+    count = 1;
+    if (SSL_get_all_async_fds(m_ssl, &fd, &count) != 1) {
+        return -1;
+    }
+    return fd;
+}
+
 } // namespace galay::ssl
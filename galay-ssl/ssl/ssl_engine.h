@@ -5,6 +5,7 @@
 #include "galay-ssl/common/error.h"
 #include "ssl_context.h"
 #include <expected>
+#include <memory>
 #include <string>
 
 namespace galay::ssl
@@ -29,6 +30,12 @@ public:
      */
     explicit SslEngine(SslContext* ctx);
 
+    /**
+     * @brief 构造持有上下文引用的 SSL 引擎
+     * @param ctx SSL 上下文，引擎存活期间保持有效（用于上下文热重载，见 SslContextReloader）
+     */
+    explicit SslEngine(std::shared_ptr<SslContext> ctx);
+
     /**
      * @brief 析构函数
      */
@@ -94,6 +101,21 @@ public:
      */
     size_t pendingEncryptedOutput() const;
 
+    /**
+     * @brief 零拷贝查看 wbio 中待发送的密文
+     * @param data 输出参数，指向连续的待发送密文
+     * @return 可读取的密文字节数，0 表示无数据
+     * @note 返回的指针在下一次写入/消费 wbio 前有效，需配合 consumeEncryptedOutput() 使用
+     */
+    size_t peekEncryptedOutput(const char** data) const;
+
+    /**
+     * @brief 丢弃 wbio 头部已经发送出去的密文
+     * @param length 需要丢弃的字节数
+     * @return 实际丢弃的字节数
+     */
+    size_t consumeEncryptedOutput(size_t length);
+
     /**
      * @brief 设置 SNI 主机名
      * @param hostname 服务器主机名
@@ -113,7 +135,8 @@ public:
 
     /**
      * @brief 执行握手（非阻塞）
-     * @return 握手结果
+     * @return 握手结果；WantAsync 表示私钥运算已交给签名线程或握手回调在等待后台任务（如证书路由加载证书），
+     * asyncWaitFd() 可读后再次调用
      */
     SslIOResult doHandshake();
 
@@ -214,14 +237,82 @@ public:
      */
     bool isSessionReused() const;
 
+    /**
+     * @brief 从上下文的客户端 Session 缓存恢复 session（握手前调用）
+     *
+     * @param peer 对端地址，形如 "host:port"；与已设置的 SNI 一起组成缓存 key
+     * @return 是否取到并设置了 session
+     *
+     * @note 上下文未挂接 SslClientSessionCache 时什么也不做；已通过 setSession() 手动设置时不覆盖，
+     * 但仍会绑定 key，使本连接收到的新 session 存回缓存
+     */
+    bool restoreCachedSession(const std::string& peer);
+
+    /**
+     * @brief 写入 early data（非阻塞）
+     *
+     * @details 客户端：握手开始前调用，数据随 ClientHello 一起进入写 BIO（0-RTT），要求已设置的
+     * session 允许 early data；服务端：在 readEarlyData() 之后、握手完成前调用，数据随服务端首轮
+     * 消息发出（0.5-RTT）。
+     *
+     * @param buffer 数据
+     * @param length 数据长度，超过 maxEarlyData() 时只写入允许的部分
+     * @param bytesWritten 输出实际写入的字节数
+     * @return IO 结果
+     */
+    SslIOResult writeEarlyData(const char* buffer, size_t length, size_t& bytesWritten);
+
+    /**
+     * @brief 读取 early data（服务端，握手完成前调用）
+     *
+     * @param buffer 接收缓冲区
+     * @param length 缓冲区大小
+     * @param bytesRead 输出实际读取的字节数
+     * @return Success 读到数据；WantRead / WantWrite 需要更多网络 IO；
+     * ZeroReturn 表示 early data 已读完或未被接受，之后继续 doHandshake()
+     */
+    SslIOResult readEarlyData(char* buffer, size_t length, size_t& bytesRead);
+
+    /**
+     * @brief 获取 early data 状态（客户端握手完成后据此判断是否需要重发）
+     */
+    SslEarlyDataStatus earlyDataStatus() const;
+
+    /**
+     * @brief 获取可发送的 early data 上限
+     * @return 客户端为当前 session 允许的字节数（0 表示不能 0-RTT），服务端为上下文配置的上限
+     */
+    uint32_t maxEarlyData() const;
+
+    /**
+     * @brief 获取私钥运算或握手回调的等待 fd
+     * @return doHandshake() 返回 WantAsync 后该 fd 可读即可继续握手：握手回调以 detail::setRetryWaitFd()
+     * 登记了 fd 时返回它，否则返回 async job 的等待 fd；都没有返回 -1
+     */
+    int asyncWaitFd() const;
+
 private:
     SSL* m_ssl;                         ///< OpenSSL SSL 对象
-    SslContext* m_ctx;                  ///< SSL 上下文（不拥有）
+    SslContext* m_ctx;                  ///< SSL 上下文
+    std::shared_ptr<SslContext> m_ctxRef; ///< 以 shared_ptr 构造时持有的上下文引用
     SslHandshakeState m_handshakeState; ///< 握手状态
     BIO* m_rbio = nullptr;             ///< read BIO（网络密文 → SSL）
     BIO* m_wbio = nullptr;             ///< write BIO（SSL → 网络密文）
 };
 
+namespace detail
+{
+
+/**
+ * @brief 登记握手回调的重试等待 fd
+ *
+ * @details 握手回调把工作交给后台并返回重试（如 SSL_CLIENT_HELLO_RETRY）时登记一个在工作完成时变为可读的 fd，
+ * SslEngine::asyncWaitFd() 据此让事件循环等待。fd 归登记方所有，须在 SSL 释放前保持有效；-1 表示清除
+ */
+void setRetryWaitFd(SSL* ssl, int fd);
+
+} // namespace detail
+
 } // namespace galay::ssl
 
 #endif // GALAY_SSL_ENGINE_H
@@ -0,0 +1,344 @@
+// RSA_METHOD / EC_KEY_METHOD 在 OpenSSL 3 中已标记为 deprecated，但仍是让旧式密钥在 async job 中运算的唯一途径
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "ssl_key_offload.h"
+#include <openssl/async.h>
+#include <openssl/ec.h>
+#include <openssl/rsa.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace galay::ssl
+{
+
+namespace {
+
+/**
+ * @brief 一次异步运算的共享状态，位于暂停中的 async job 栈上
+ */
+struct PendingOperation {
+    std::atomic<bool> done{false};
+    int result = -1;
+};
+
+/**
+ * @brief 等待 fd 在 ASYNC_WAIT_CTX 中的键，各后端共用，保证每个连接只有一个等待 fd
+ */
+const void* waitFdKey()
+{
+    static const char key = 0;
+    return &key;
+}
+
+void closeWaitFds(ASYNC_WAIT_CTX*, const void*, OSSL_ASYNC_FD fd, void* custom)
+{
+    ::close(fd);
+    ::close(static_cast<int>(reinterpret_cast<intptr_t>(custom)));
+}
+
+/**
+ * @brief 取连接上的等待 fd：每个 SSL 首次卸载时创建一对 socket，随 ASYNC_WAIT_CTX 释放
+ * @return 读端（交给事件循环）与写端（签名线程通知），失败返回 false
+ */
+bool waitFds(ASYNC_WAIT_CTX* wait_ctx, int& read_fd, int& notify_fd)
+{
+    OSSL_ASYNC_FD fd = -1;
+    void* custom = nullptr;
+    if (ASYNC_WAIT_CTX_get_fd(wait_ctx, waitFdKey(), &fd, &custom) == 1) {
+        read_fd = fd;
+        notify_fd = static_cast<int>(reinterpret_cast<intptr_t>(custom));
+        return true;
+    }
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) != 0) {
+        return false;
+    }
+    if (ASYNC_WAIT_CTX_set_wait_fd(wait_ctx, waitFdKey(), fds[0],
+                                   reinterpret_cast<void*>(static_cast<intptr_t>(fds[1])), closeWaitFds) != 1) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+    read_fd = fds[0];
+    notify_fd = fds[1];
+    return true;
+}
+
+void drainWaitFd(int fd)
+{
+    char buffer[64];
+    while (::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+    }
+}
+
+using RsaPrivFn = int (*)(int, const unsigned char*, unsigned char*, RSA*, int);
+using EcSignFn = int (*)(int, const unsigned char*, int, unsigned char*, unsigned int*,
+                         const BIGNUM*, const BIGNUM*, EC_KEY*);
+
+int rsaIndex()
+{
+    static const int index = RSA_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+int ecIndex()
+{
+    static const int index = EC_KEY_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+int rsaPrivEnc(int flen, const unsigned char* from, unsigned char* to, RSA* rsa, int padding)
+{
+    static const RsaPrivFn fallback = RSA_meth_get_priv_enc(RSA_PKCS1_OpenSSL());
+    auto* offload = static_cast<SslKeyOffload*>(RSA_get_ex_data(rsa, rsaIndex()));
+    if (offload == nullptr) {
+        return fallback(flen, from, to, rsa, padding);
+    }
+    return offload->run([&] { return fallback(flen, from, to, rsa, padding); });
+}
+
+int rsaPrivDec(int flen, const unsigned char* from, unsigned char* to, RSA* rsa, int padding)
+{
+    static const RsaPrivFn fallback = RSA_meth_get_priv_dec(RSA_PKCS1_OpenSSL());
+    auto* offload = static_cast<SslKeyOffload*>(RSA_get_ex_data(rsa, rsaIndex()));
+    if (offload == nullptr) {
+        return fallback(flen, from, to, rsa, padding);
+    }
+    return offload->run([&] { return fallback(flen, from, to, rsa, padding); });
+}
+
+EcSignFn defaultEcSign()
+{
+    EcSignFn sign = nullptr;
+    EC_KEY_METHOD_get_sign(EC_KEY_OpenSSL(), &sign, nullptr, nullptr);
+    return sign;
+}
+
+int ecSign(int type, const unsigned char* dgst, int dlen, unsigned char* sig, unsigned int* siglen,
+           const BIGNUM* kinv, const BIGNUM* r, EC_KEY* eckey)
+{
+    static const EcSignFn fallback = defaultEcSign();
+    auto* offload = static_cast<SslKeyOffload*>(EC_KEY_get_ex_data(eckey, ecIndex()));
+    if (offload == nullptr) {
+        return fallback(type, dgst, dlen, sig, siglen, kinv, r, eckey);
+    }
+    return offload->run([&] { return fallback(type, dgst, dlen, sig, siglen, kinv, r, eckey); });
+}
+
+// 方法表在进程内共享且不释放：包装后的密钥可能比线程池活得更久
+RSA_METHOD* rsaMethod()
+{
+    static RSA_METHOD* method = [] {
+        RSA_METHOD* m = RSA_meth_dup(RSA_PKCS1_OpenSSL());
+        if (m != nullptr) {
+            RSA_meth_set1_name(m, "galay-ssl offload RSA");
+            RSA_meth_set_priv_enc(m, rsaPrivEnc);
+            RSA_meth_set_priv_dec(m, rsaPrivDec);
+        }
+        return m;
+    }();
+    return method;
+}
+
+EC_KEY_METHOD* ecMethod()
+{
+    static EC_KEY_METHOD* method = [] {
+        EC_KEY_METHOD* m = EC_KEY_METHOD_new(EC_KEY_OpenSSL());
+        if (m != nullptr) {
+            int (*sign_setup)(EC_KEY*, BN_CTX*, BIGNUM**, BIGNUM**) = nullptr;
+            ECDSA_SIG* (*sign_sig)(const unsigned char*, int, const BIGNUM*, const BIGNUM*, EC_KEY*) = nullptr;
+            EC_KEY_METHOD_get_sign(EC_KEY_OpenSSL(), nullptr, &sign_setup, &sign_sig);
+            EC_KEY_METHOD_set_sign(m, ecSign, sign_setup, sign_sig);
+        }
+        return m;
+    }();
+    return method;
+}
+
+} // anonymous namespace
+
+namespace detail
+{
+
+std::optional<int> runAsyncKeyOperation(const std::function<bool(SslKeyCompletion)>& start)
+{
+    ASYNC_JOB* job = ASYNC_get_current_job();
+    ASYNC_WAIT_CTX* wait_ctx = job ? ASYNC_get_wait_ctx(job) : nullptr;
+    int read_fd = -1;
+    int notify_fd = -1;
+    if (wait_ctx == nullptr || !waitFds(wait_ctx, read_fd, notify_fd)) {
+        return std::nullopt;
+    }
+    // 通知端 dup 一份交给完成方：job 返回后连接可能立即释放并关闭原 fd
+    const int worker_fd = ::dup(notify_fd);
+    if (worker_fd < 0) {
+        return std::nullopt;
+    }
+
+    PendingOperation pending;
+    const bool started = start([&pending, worker_fd](int result) {
+        pending.result = result;
+        pending.done.store(true, std::memory_order_release);
+        const char byte = 1;
+        (void)::send(worker_fd, &byte, 1, MSG_NOSIGNAL);
+        ::close(worker_fd);
+    });
+    if (!started) {
+        ::close(worker_fd);
+        return std::nullopt;
+    }
+
+    // 至少暂停一次：运算抢先完成时（如单核）也把调度线程交还事件循环，调用方看到的流程一致；
+    // 调用方可能在通知到达前再次推进握手，未完成时继续暂停
+    do {
+        ASYNC_pause_job();
+    } while (!pending.done.load(std::memory_order_acquire));
+    drainWaitFd(read_fd);
+    return pending.result;
+}
+
+} // namespace detail
+
+SslKeyOffload::SslKeyOffload(SslKeyOffloadOptions options)
+    : m_options(options)
+{
+    m_options.threads = std::max<size_t>(1, m_options.threads);
+    m_workers.reserve(m_options.threads);
+    for (size_t i = 0; i < m_options.threads; ++i) {
+        m_workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+SslKeyOffload::~SslKeyOffload()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+std::expected<EVP_PKEY*, SslError> SslKeyOffload::wrap(EVP_PKEY* key)
+{
+    if (key == nullptr) {
+        return std::unexpected(SslError(SslErrorCode::kPrivateKeyLoadFailed));
+    }
+
+    EVP_PKEY* wrapped = EVP_PKEY_new();
+    if (wrapped == nullptr) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kPrivateKeyLoadFailed));
+    }
+
+    switch (EVP_PKEY_get_base_id(key)) {
+        case EVP_PKEY_RSA: {
+            const RSA* source = EVP_PKEY_get0_RSA(key);
+            const BIGNUM* d = nullptr;
+            if (source != nullptr) {
+                RSA_get0_key(source, nullptr, nullptr, &d);
+            }
+            RSA* rsa = d ? RSAPrivateKey_dup(source) : nullptr;
+            if (rsa != nullptr && rsaMethod() != nullptr &&
+                RSA_set_method(rsa, rsaMethod()) == 1 &&
+                RSA_set_ex_data(rsa, rsaIndex(), this) == 1 &&
+                EVP_PKEY_assign_RSA(wrapped, rsa) == 1) {
+                return wrapped;
+            }
+            RSA_free(rsa);
+            break;
+        }
+        case EVP_PKEY_EC: {
+            const EC_KEY* source = EVP_PKEY_get0_EC_KEY(key);
+            EC_KEY* ec = source && EC_KEY_get0_private_key(source) ? EC_KEY_dup(source) : nullptr;
+            if (ec != nullptr && ecMethod() != nullptr &&
+                EC_KEY_set_method(ec, ecMethod()) == 1 &&
+                EC_KEY_set_ex_data(ec, ecIndex(), this) == 1 &&
+                EVP_PKEY_assign_EC_KEY(wrapped, ec) == 1) {
+                return wrapped;
+            }
+            EC_KEY_free(ec);
+            break;
+        }
+        default:
+            break;
+    }
+
+    EVP_PKEY_free(wrapped);
+    return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kPrivateKeyLoadFailed));
+}
+
+SslKeyOffloadStats SslKeyOffload::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SslKeyOffloadStats result;
+    result.offloaded = m_offloaded;
+    result.inlined = m_inlined;
+    result.failures = m_failures;
+    result.queued = m_queue.size();
+    return result;
+}
+
+int SslKeyOffload::run(const std::function<int()>& operation)
+{
+    if (ASYNC_get_current_job() == nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_inlined;
+        }
+        return operation();
+    }
+
+    bool submitted = false;
+    const auto result = detail::runAsyncKeyOperation([&](detail::SslKeyCompletion complete) {
+        submitted = true;
+        return submit([&operation, complete = std::move(complete)] { complete(operation()); });
+    });
+    if (result) {
+        return *result;
+    }
+    if (!submitted) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_failures;
+    }
+    // 队列已满时 submit() 已计入 inlined
+    return operation();
+}
+
+bool SslKeyOffload::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping || m_queue.size() >= m_options.queueCapacity) {
+            ++m_inlined;
+            return false;
+        }
+        m_queue.push_back(std::move(task));
+        ++m_offloaded;
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+void SslKeyOffload::workerLoop()
+{
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            task = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace galay::ssl
@@ -0,0 +1,139 @@
+#ifndef GALAY_SSL_KEY_OFFLOAD_H
+#define GALAY_SSL_KEY_OFFLOAD_H
+
+#include "galay-ssl/common/defn.hpp"
+#include "galay-ssl/common/error.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <functional>
+#include <mutex>
+#include <openssl/async.h>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 私钥运算后端
+ *
+ * @details SslContext::setPrivateKeyOffload() 通过 wrap() 把证书槽位上的密钥替换为在后端运算的
+ * 等价密钥。内置实现有进程内签名线程池 SslKeyOffload 与本地签名进程客户端 SslKeylessClient。
+ */
+class SslKeyBackend
+{
+public:
+    virtual ~SslKeyBackend() = default;
+
+    /**
+     * @brief 生成在本后端运算的等价密钥
+     * @param key 上下文已加载的私钥；未加载私钥时为证书公钥
+     * @return 新的 EVP_PKEY（调用者释放），不支持的密钥返回 kPrivateKeyLoadFailed
+     */
+    virtual std::expected<EVP_PKEY*, SslError> wrap(EVP_PKEY* key) = 0;
+};
+
+namespace detail
+{
+
+/**
+ * @brief 私钥运算完成回调，参数为 OpenSSL 私钥回调的返回值，必须且只能调用一次
+ */
+using SslKeyCompletion = std::function<void(int result)>;
+
+/**
+ * @brief 在当前 async job 中发起一次异步私钥运算并暂停 job 直到完成
+ *
+ * @param start 发起运算，完成时（任意线程）调用传入的回调；返回 false 表示未发起
+ * @return 运算结果；不在 async job 中、创建等待 fd 失败或 start 返回 false 时为 nullopt，
+ * 由调用方同步运算
+ *
+ * @details 每个连接一个等待 fd，登记在 ASYNC_WAIT_CTX 上，即 SslEngine::asyncWaitFd()
+ */
+std::optional<int> runAsyncKeyOperation(const std::function<bool(SslKeyCompletion)>& start);
+
+} // namespace detail
+
+/**
+ * @brief 私钥运算卸载配置
+ */
+struct SslKeyOffloadOptions {
+    size_t threads = 2;             ///< 签名线程数
+    size_t queueCapacity = 1024;    ///< 排队上限，队列满时在调用线程上同步运算
+};
+
+/**
+ * @brief 私钥运算卸载统计
+ */
+struct SslKeyOffloadStats {
+    uint64_t offloaded = 0;     ///< 交给签名线程的运算次数
+    uint64_t inlined = 0;       ///< 不在 async job 中或队列已满而同步运算的次数
+    uint64_t failures = 0;      ///< 创建等待 fd 失败而同步运算的次数
+    size_t queued = 0;          ///< 当前排队数
+};
+
+/**
+ * @brief 私钥运算签名线程池
+ *
+ * @details 由 SslContext::setPrivateKeyOffload() 接入：上下文的 RSA / ECDSA 私钥被替换为
+ * 使用自定义 RSA_METHOD / EC_KEY_METHOD 的等价密钥，并开启 SSL_MODE_ASYNC。握手在 OpenSSL
+ * async job 中执行私钥运算时，运算被投递到签名线程，job 暂停并通过一个等待 fd 通知完成：
+ * SSL_do_handshake() 返回 SSL_ERROR_WANT_ASYNC（SslIOResult::WantAsync），调度线程继续服务
+ * 其他连接，等待 fd 可读后再次推进握手即可取回签名。
+ *
+ * 同一线程池可挂到多个上下文；不在 async job 中的调用（如 SSL_MODE_ASYNC 未生效）与队列
+ * 已满时退回调用线程同步运算，结果相同。
+ *
+ * @note 线程池必须比挂接它的上下文与其上的连接活得更久；析构时会先执行完已排队的运算
+ */
+class SslKeyOffload : public SslKeyBackend
+{
+public:
+    explicit SslKeyOffload(SslKeyOffloadOptions options = {});
+    ~SslKeyOffload() override;
+
+    SslKeyOffload(const SslKeyOffload&) = delete;
+    SslKeyOffload& operator=(const SslKeyOffload&) = delete;
+
+    /**
+     * @brief 生成使用本线程池运算的等价私钥
+     * @param key RSA 或 EC 私钥
+     * @return 新的 EVP_PKEY（调用者释放），不支持的密钥类型或只有公钥时返回 kPrivateKeyLoadFailed
+     */
+    std::expected<EVP_PKEY*, SslError> wrap(EVP_PKEY* key) override;
+
+    /**
+     * @brief 统计快照
+     */
+    SslKeyOffloadStats stats() const;
+
+    const SslKeyOffloadOptions& options() const { return m_options; }
+
+    /**
+     * @brief 在当前 async job 中把运算交给签名线程并暂停 job，不在 job 中时同步运算
+     * @return 运算结果（OpenSSL 私钥回调的返回值）
+     */
+    int run(const std::function<int()>& operation);
+
+private:
+    bool submit(std::function<void()> task);
+    void workerLoop();
+
+    SslKeyOffloadOptions m_options;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_queue;
+    std::vector<std::thread> m_workers;
+    bool m_stopping = false;
+    uint64_t m_offloaded = 0;
+    uint64_t m_inlined = 0;
+    uint64_t m_failures = 0;
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_KEY_OFFLOAD_H
@@ -0,0 +1,874 @@
+#include "ssl_key_share_pool.h"
+#include <openssl/core_dispatch.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/objects.h>
+#include <openssl/params.h>
+#include <openssl/provider.h>
+#include <strings.h>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+namespace galay::ssl
+{
+
+namespace {
+
+constexpr const char* kProviderName = "galay-keyshare";
+constexpr const char* kDefaultQuery = "provider=default";
+
+/**
+ * @brief 组名解析为 NID：X25519 或 EC 曲线
+ */
+int groupNid(const std::string& name)
+{
+    if (::strcasecmp(name.c_str(), "X25519") == 0) {
+        return NID_X25519;
+    }
+    int nid = EC_curve_nist2nid(name.c_str());
+    if (nid == NID_undef) {
+        nid = OBJ_sn2nid(name.c_str());
+    }
+    if (nid == NID_undef) {
+        nid = OBJ_ln2nid(name.c_str());
+    }
+    return nid;
+}
+
+/**
+ * @brief 在 default provider 上生成一个密钥对
+ */
+EVP_PKEY* generateKey(int nid)
+{
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_from_name(nullptr, nid == NID_X25519 ? "X25519" : "EC", kDefaultQuery);
+    EVP_PKEY* key = nullptr;
+    if (ctx != nullptr && EVP_PKEY_keygen_init(ctx) == 1 &&
+        (nid == NID_X25519 || EVP_PKEY_CTX_set_group_name(ctx, OBJ_nid2sn(nid)) == 1)) {
+        (void)EVP_PKEY_keygen(ctx, &key);
+    }
+    EVP_PKEY_CTX_free(ctx);
+    return key;
+}
+
+/**
+ * @brief 有界无锁 MPMC 环形队列（按序号区分槽位状态）
+ */
+class KeyRing
+{
+public:
+    explicit KeyRing(size_t capacity)
+        : m_cells(std::bit_ceil(std::max<size_t>(2, capacity)))
+        , m_mask(m_cells.size() - 1)
+    {
+        for (size_t i = 0; i < m_cells.size(); ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~KeyRing()
+    {
+        while (EVP_PKEY* key = pop()) {
+            EVP_PKEY_free(key);
+        }
+    }
+
+    bool push(EVP_PKEY* key)
+    {
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[pos & m_mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.key = key;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    EVP_PKEY* pop()
+    {
+        size_t pos = m_head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[pos & m_mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    EVP_PKEY* key = cell.key;
+                    cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return key;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = m_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return m_cells.size(); }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        EVP_PKEY* key = nullptr;
+    };
+
+    std::vector<Cell> m_cells;
+    const size_t m_mask;
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+};
+
+// ==================== provider ====================
+//
+// KEYMGMT 的 keydata 包一个 default provider 的 EVP_PKEY，除生成外的操作全部委托给它；
+// KEYEXCH 直接在包住的 EVP_PKEY 上做 ECDH / X25519，免去每次握手把临时密钥导出到 default provider；
+// 签名由 OpenSSL 把密钥导出到 default provider 后完成（导出结果缓存在证书私钥上）。
+
+enum class KeyKind {
+    X25519,
+    Ec,
+};
+
+struct PoolKey {
+    KeyKind kind;
+    EVP_PKEY* pkey = nullptr;
+};
+
+/**
+ * @brief 每个池独占的 provider 实例（provctx）
+ *
+ * @details 算法以属性 galay.keyshare=<池编号> 注册，上下文按编号选中自己池的实例，生成时只从该池取密钥；
+ * 池销毁后实例可能因 OpenSSL 的方法缓存留存到进程退出，届时 pool 为空、现场生成
+ */
+struct PoolProvider {
+    std::atomic<SslKeySharePool*> pool{nullptr};
+    std::string property;
+    OSSL_ALGORITHM keymgmt[3] = {};
+    OSSL_ALGORITHM keyexch[3] = {};
+};
+
+struct PoolGen {
+    KeyKind kind;
+    int selection = 0;
+    std::string group;
+    const PoolProvider* provider = nullptr;
+};
+
+const char* algorithmName(KeyKind kind)
+{
+    return kind == KeyKind::X25519 ? "X25519" : "EC";
+}
+
+EVP_KEYMGMT* defaultKeymgmt(KeyKind kind)
+{
+    static EVP_KEYMGMT* x25519 = EVP_KEYMGMT_fetch(nullptr, "X25519", kDefaultQuery);
+    static EVP_KEYMGMT* ec = EVP_KEYMGMT_fetch(nullptr, "EC", kDefaultQuery);
+    return kind == KeyKind::X25519 ? x25519 : ec;
+}
+
+EVP_PKEY_CTX* defaultFromdataCtx(KeyKind kind)
+{
+    auto make = [](const char* name) {
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_from_name(nullptr, name, kDefaultQuery);
+        if (ctx != nullptr && EVP_PKEY_fromdata_init(ctx) != 1) {
+            EVP_PKEY_CTX_free(ctx);
+            ctx = nullptr;
+        }
+        return ctx;
+    };
+    static EVP_PKEY_CTX* x25519 = make("X25519");
+    static EVP_PKEY_CTX* ec = make("EC");
+    return kind == KeyKind::X25519 ? x25519 : ec;
+}
+
+template <KeyKind Kind>
+void* keyNew(void*)
+{
+    return new PoolKey{Kind};
+}
+
+void keyFree(void* keydata)
+{
+    auto* key = static_cast<PoolKey*>(keydata);
+    if (key != nullptr) {
+        EVP_PKEY_free(key->pkey);
+        delete key;
+    }
+}
+
+int keyHas(const void* keydata, int selection)
+{
+    const auto* key = static_cast<const PoolKey*>(keydata);
+    if (key == nullptr || key->pkey == nullptr) {
+        return 0;
+    }
+    if ((selection & OSSL_KEYMGMT_SELECT_KEYPAIR) == 0) {
+        return 1;
+    }
+    // 按导出内容判断公私钥是否齐全
+    struct Probe {
+        int selection;
+        bool ok = false;
+    } probe{selection};
+    auto check = [](const OSSL_PARAM params[], void* arg) -> int {
+        auto* p = static_cast<Probe*>(arg);
+        const bool want_pub = (p->selection & OSSL_KEYMGMT_SELECT_PUBLIC_KEY) != 0;
+        const bool want_priv = (p->selection & OSSL_KEYMGMT_SELECT_PRIVATE_KEY) != 0;
+        p->ok = (!want_pub || OSSL_PARAM_locate_const(params, OSSL_PKEY_PARAM_PUB_KEY) != nullptr) &&
+                (!want_priv || OSSL_PARAM_locate_const(params, OSSL_PKEY_PARAM_PRIV_KEY) != nullptr);
+        return 1;
+    };
+    return EVP_PKEY_export(key->pkey, selection & OSSL_KEYMGMT_SELECT_KEYPAIR, check, &probe) == 1 && probe.ok;
+}
+
+int keyMatch(const void* keydata1, const void* keydata2, int selection)
+{
+    const auto* a = static_cast<const PoolKey*>(keydata1);
+    const auto* b = static_cast<const PoolKey*>(keydata2);
+    if (a->pkey == nullptr || b->pkey == nullptr) {
+        return 0;
+    }
+    if ((selection & OSSL_KEYMGMT_SELECT_KEYPAIR) != 0) {
+        return EVP_PKEY_eq(a->pkey, b->pkey) == 1;
+    }
+    return EVP_PKEY_parameters_eq(a->pkey, b->pkey) == 1;
+}
+
+int keyValidate(const void* keydata, int selection, int)
+{
+    const auto* key = static_cast<const PoolKey*>(keydata);
+    if (key->pkey == nullptr) {
+        return 0;
+    }
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_from_pkey(nullptr, key->pkey, kDefaultQuery);
+    int ok = 0;
+    if (ctx != nullptr) {
+        if ((selection & OSSL_KEYMGMT_SELECT_KEYPAIR) == OSSL_KEYMGMT_SELECT_KEYPAIR) {
+            ok = EVP_PKEY_check(ctx);
+        } else if ((selection & OSSL_KEYMGMT_SELECT_PUBLIC_KEY) != 0) {
+            ok = EVP_PKEY_public_check(ctx);
+        } else if ((selection & OSSL_KEYMGMT_SELECT_PRIVATE_KEY) != 0) {
+            ok = EVP_PKEY_private_check(ctx);
+        } else {
+            ok = EVP_PKEY_param_check(ctx);
+        }
+    }
+    EVP_PKEY_CTX_free(ctx);
+    return ok == 1;
+}
+
+template <KeyKind Kind>
+int keyImport(void* keydata, int selection, const OSSL_PARAM params[])
+{
+    auto* key = static_cast<PoolKey*>(keydata);
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_from_name(nullptr, algorithmName(Kind), kDefaultQuery);
+    EVP_PKEY* imported = nullptr;
+    const bool ok = ctx != nullptr && EVP_PKEY_fromdata_init(ctx) == 1 &&
+                    EVP_PKEY_fromdata(ctx, &imported, selection, const_cast<OSSL_PARAM*>(params)) == 1;
+    EVP_PKEY_CTX_free(ctx);
+    if (!ok) {
+        return 0;
+    }
+    EVP_PKEY_free(key->pkey);
+    key->pkey = imported;
+    return 1;
+}
+
+template <KeyKind Kind>
+const OSSL_PARAM* keyImportTypes(int selection)
+{
+    EVP_PKEY_CTX* ctx = defaultFromdataCtx(Kind);
+    return ctx ? EVP_PKEY_fromdata_settable(ctx, selection) : nullptr;
+}
+
+int keyExport(void* keydata, int selection, OSSL_CALLBACK* cb, void* cbarg)
+{
+    const auto* key = static_cast<const PoolKey*>(keydata);
+    return key->pkey != nullptr && EVP_PKEY_export(key->pkey, selection, cb, cbarg) == 1;
+}
+
+void* keyDup(const void* keydata, int)
+{
+    const auto* key = static_cast<const PoolKey*>(keydata);
+    auto* copy = new PoolKey{key->kind};
+    if (key->pkey != nullptr && (copy->pkey = EVP_PKEY_dup(key->pkey)) == nullptr) {
+        delete copy;
+        return nullptr;
+    }
+    return copy;
+}
+
+int keyGetParams(void* keydata, OSSL_PARAM params[])
+{
+    const auto* key = static_cast<const PoolKey*>(keydata);
+    return key->pkey != nullptr && EVP_PKEY_get_params(key->pkey, params) == 1;
+}
+
+template <KeyKind Kind>
+const OSSL_PARAM* keyGettableParams(void*)
+{
+    return EVP_KEYMGMT_gettable_params(defaultKeymgmt(Kind));
+}
+
+int keySetParams(void* keydata, const OSSL_PARAM params[])
+{
+    auto* key = static_cast<PoolKey*>(keydata);
+    return key->pkey != nullptr && EVP_PKEY_set_params(key->pkey, const_cast<OSSL_PARAM*>(params)) == 1;
+}
+
+template <KeyKind Kind>
+const OSSL_PARAM* keySettableParams(void*)
+{
+    return EVP_KEYMGMT_settable_params(defaultKeymgmt(Kind));
+}
+
+const char* ecOperationName(int operation_id)
+{
+    switch (operation_id) {
+        case OSSL_OP_KEYEXCH:
+            return "ECDH";
+        case OSSL_OP_SIGNATURE:
+            return "ECDSA";
+        default:
+            return nullptr;
+    }
+}
+
+template <KeyKind Kind>
+void* genInit(void* provctx, int selection, const OSSL_PARAM params[])
+{
+    auto* gen = new PoolGen{Kind, selection, {}, static_cast<const PoolProvider*>(provctx)};
+    if (const OSSL_PARAM* p = OSSL_PARAM_locate_const(params, OSSL_PKEY_PARAM_GROUP_NAME)) {
+        const char* name = nullptr;
+        if (OSSL_PARAM_get_utf8_string_ptr(p, &name) == 1) {
+            gen->group = name;
+        }
+    }
+    return gen;
+}
+
+int genSetTemplate(void* genctx, void* templ)
+{
+    auto* gen = static_cast<PoolGen*>(genctx);
+    const auto* key = static_cast<const PoolKey*>(templ);
+    if (gen->kind == KeyKind::Ec && key != nullptr && key->pkey != nullptr) {
+        char name[80];
+        size_t length = 0;
+        if (EVP_PKEY_get_group_name(key->pkey, name, sizeof(name), &length) == 1) {
+            gen->group.assign(name, length);
+        }
+    }
+    return 1;
+}
+
+int genSetParams(void* genctx, const OSSL_PARAM params[])
+{
+    auto* gen = static_cast<PoolGen*>(genctx);
+    if (const OSSL_PARAM* p = OSSL_PARAM_locate_const(params, OSSL_PKEY_PARAM_GROUP_NAME)) {
+        const char* name = nullptr;
+        if (OSSL_PARAM_get_utf8_string_ptr(p, &name) != 1) {
+            return 0;
+        }
+        gen->group = name;
+    }
+    return 1;
+}
+
+template <KeyKind Kind>
+const OSSL_PARAM* genSettableParams(void*, void*)
+{
+    static const OSSL_PARAM settable[] = {
+        OSSL_PARAM_utf8_string(OSSL_PKEY_PARAM_GROUP_NAME, nullptr, 0),
+        OSSL_PARAM_END,
+    };
+    return settable;
+}
+
+void* gen(void* genctx, OSSL_CALLBACK*, void*)
+{
+    const auto* gen = static_cast<const PoolGen*>(genctx);
+    int nid = NID_X25519;
+    if (gen->kind == KeyKind::Ec) {
+        nid = gen->group.empty() ? NID_undef : groupNid(gen->group);
+        if (nid == NID_undef) {
+            return nullptr;
+        }
+    }
+
+    auto* key = new PoolKey{gen->kind};
+    if ((gen->selection & OSSL_KEYMGMT_SELECT_KEYPAIR) != 0) {
+        if (SslKeySharePool* pool = gen->provider->pool.load(std::memory_order_acquire)) {
+            key->pkey = pool->take(nid);
+        }
+        if (key->pkey == nullptr) {
+            key->pkey = generateKey(nid);
+        }
+    } else {
+        // 只要参数（对端公钥的容器）：生成无密钥材料的对象
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_from_name(nullptr, algorithmName(gen->kind), kDefaultQuery);
+        if (ctx != nullptr && EVP_PKEY_paramgen_init(ctx) == 1 &&
+            (gen->kind == KeyKind::X25519 || EVP_PKEY_CTX_set_group_name(ctx, OBJ_nid2sn(nid)) == 1)) {
+            (void)EVP_PKEY_paramgen(ctx, &key->pkey);
+        }
+        EVP_PKEY_CTX_free(ctx);
+    }
+    if (key->pkey == nullptr) {
+        delete key;
+        return nullptr;
+    }
+    return key;
+}
+
+void genCleanup(void* genctx)
+{
+    delete static_cast<PoolGen*>(genctx);
+}
+
+struct PoolExchange {
+    EVP_PKEY_CTX* ctx = nullptr;
+};
+
+EVP_KEYEXCH* defaultKeyexch(KeyKind kind)
+{
+    static EVP_KEYEXCH* x25519 = EVP_KEYEXCH_fetch(nullptr, "X25519", kDefaultQuery);
+    static EVP_KEYEXCH* ecdh = EVP_KEYEXCH_fetch(nullptr, "ECDH", kDefaultQuery);
+    return kind == KeyKind::X25519 ? x25519 : ecdh;
+}
+
+void* exchangeNew(void*)
+{
+    return new PoolExchange{};
+}
+
+void exchangeFree(void* vctx)
+{
+    auto* exchange = static_cast<PoolExchange*>(vctx);
+    if (exchange != nullptr) {
+        EVP_PKEY_CTX_free(exchange->ctx);
+        delete exchange;
+    }
+}
+
+void* exchangeDup(void* vctx)
+{
+    const auto* exchange = static_cast<const PoolExchange*>(vctx);
+    auto* copy = new PoolExchange{};
+    if (exchange->ctx != nullptr && (copy->ctx = EVP_PKEY_CTX_dup(exchange->ctx)) == nullptr) {
+        delete copy;
+        return nullptr;
+    }
+    return copy;
+}
+
+int exchangeInit(void* vctx, void* vkey, const OSSL_PARAM params[])
+{
+    auto* exchange = static_cast<PoolExchange*>(vctx);
+    const auto* key = static_cast<const PoolKey*>(vkey);
+    if (key == nullptr || key->pkey == nullptr) {
+        return 0;
+    }
+    EVP_PKEY_CTX_free(exchange->ctx);
+    exchange->ctx = EVP_PKEY_CTX_new_from_pkey(nullptr, key->pkey, kDefaultQuery);
+    return exchange->ctx != nullptr && EVP_PKEY_derive_init_ex(exchange->ctx, params) == 1;
+}
+
+int exchangeSetPeer(void* vctx, void* vpeer)
+{
+    auto* exchange = static_cast<PoolExchange*>(vctx);
+    const auto* peer = static_cast<const PoolKey*>(vpeer);
+    // 对端公钥已由上层经 KEYMGMT_VALIDATE 校验过
+    return exchange->ctx != nullptr && peer != nullptr && peer->pkey != nullptr &&
+           EVP_PKEY_derive_set_peer_ex(exchange->ctx, peer->pkey, 0) == 1;
+}
+
+int exchangeDerive(void* vctx, unsigned char* secret, size_t* secretlen, size_t outlen)
+{
+    auto* exchange = static_cast<PoolExchange*>(vctx);
+    size_t length = secret == nullptr ? 0 : outlen;
+    if (exchange->ctx == nullptr || EVP_PKEY_derive(exchange->ctx, secret, &length) != 1) {
+        return 0;
+    }
+    *secretlen = length;
+    return 1;
+}
+
+int exchangeSetParams(void* vctx, const OSSL_PARAM params[])
+{
+    auto* exchange = static_cast<PoolExchange*>(vctx);
+    return exchange->ctx != nullptr && EVP_PKEY_CTX_set_params(exchange->ctx, params) == 1;
+}
+
+int exchangeGetParams(void* vctx, OSSL_PARAM params[])
+{
+    auto* exchange = static_cast<PoolExchange*>(vctx);
+    return exchange->ctx != nullptr && EVP_PKEY_CTX_get_params(exchange->ctx, params) == 1;
+}
+
+template <KeyKind Kind>
+const OSSL_PARAM* exchangeSettableParams(void*, void*)
+{
+    return EVP_KEYEXCH_settable_ctx_params(defaultKeyexch(Kind));
+}
+
+template <KeyKind Kind>
+const OSSL_PARAM* exchangeGettableParams(void*, void*)
+{
+    return EVP_KEYEXCH_gettable_ctx_params(defaultKeyexch(Kind));
+}
+
+using Fn = void (*)();
+
+template <KeyKind Kind>
+const OSSL_DISPATCH* keyexchDispatch()
+{
+    static const OSSL_DISPATCH table[] = {
+        {OSSL_FUNC_KEYEXCH_NEWCTX, reinterpret_cast<Fn>(exchangeNew)},
+        {OSSL_FUNC_KEYEXCH_INIT, reinterpret_cast<Fn>(exchangeInit)},
+        {OSSL_FUNC_KEYEXCH_SET_PEER, reinterpret_cast<Fn>(exchangeSetPeer)},
+        {OSSL_FUNC_KEYEXCH_DERIVE, reinterpret_cast<Fn>(exchangeDerive)},
+        {OSSL_FUNC_KEYEXCH_FREECTX, reinterpret_cast<Fn>(exchangeFree)},
+        {OSSL_FUNC_KEYEXCH_DUPCTX, reinterpret_cast<Fn>(exchangeDup)},
+        {OSSL_FUNC_KEYEXCH_SET_CTX_PARAMS, reinterpret_cast<Fn>(exchangeSetParams)},
+        {OSSL_FUNC_KEYEXCH_SETTABLE_CTX_PARAMS, reinterpret_cast<Fn>(exchangeSettableParams<Kind>)},
+        {OSSL_FUNC_KEYEXCH_GET_CTX_PARAMS, reinterpret_cast<Fn>(exchangeGetParams)},
+        {OSSL_FUNC_KEYEXCH_GETTABLE_CTX_PARAMS, reinterpret_cast<Fn>(exchangeGettableParams<Kind>)},
+        {0, nullptr},
+    };
+    return table;
+}
+
+template <KeyKind Kind>
+const OSSL_DISPATCH* keymgmtDispatch()
+{
+    static const OSSL_DISPATCH table[] = {
+        {OSSL_FUNC_KEYMGMT_NEW, reinterpret_cast<Fn>(keyNew<Kind>)},
+        {OSSL_FUNC_KEYMGMT_FREE, reinterpret_cast<Fn>(keyFree)},
+        {OSSL_FUNC_KEYMGMT_GEN_INIT, reinterpret_cast<Fn>(genInit<Kind>)},
+        {OSSL_FUNC_KEYMGMT_GEN_SET_TEMPLATE, reinterpret_cast<Fn>(genSetTemplate)},
+        {OSSL_FUNC_KEYMGMT_GEN_SET_PARAMS, reinterpret_cast<Fn>(genSetParams)},
+        {OSSL_FUNC_KEYMGMT_GEN_SETTABLE_PARAMS, reinterpret_cast<Fn>(genSettableParams<Kind>)},
+        {OSSL_FUNC_KEYMGMT_GEN, reinterpret_cast<Fn>(gen)},
+        {OSSL_FUNC_KEYMGMT_GEN_CLEANUP, reinterpret_cast<Fn>(genCleanup)},
+        {OSSL_FUNC_KEYMGMT_GET_PARAMS, reinterpret_cast<Fn>(keyGetParams)},
+        {OSSL_FUNC_KEYMGMT_GETTABLE_PARAMS, reinterpret_cast<Fn>(keyGettableParams<Kind>)},
+        {OSSL_FUNC_KEYMGMT_SET_PARAMS, reinterpret_cast<Fn>(keySetParams)},
+        {OSSL_FUNC_KEYMGMT_SETTABLE_PARAMS, reinterpret_cast<Fn>(keySettableParams<Kind>)},
+        {OSSL_FUNC_KEYMGMT_HAS, reinterpret_cast<Fn>(keyHas)},
+        {OSSL_FUNC_KEYMGMT_MATCH, reinterpret_cast<Fn>(keyMatch)},
+        {OSSL_FUNC_KEYMGMT_VALIDATE, reinterpret_cast<Fn>(keyValidate)},
+        {OSSL_FUNC_KEYMGMT_IMPORT, reinterpret_cast<Fn>(keyImport<Kind>)},
+        {OSSL_FUNC_KEYMGMT_IMPORT_TYPES, reinterpret_cast<Fn>(keyImportTypes<Kind>)},
+        {OSSL_FUNC_KEYMGMT_EXPORT, reinterpret_cast<Fn>(keyExport)},
+        {OSSL_FUNC_KEYMGMT_EXPORT_TYPES, reinterpret_cast<Fn>(keyImportTypes<Kind>)},
+        {OSSL_FUNC_KEYMGMT_DUP, reinterpret_cast<Fn>(keyDup)},
+        {Kind == KeyKind::Ec ? OSSL_FUNC_KEYMGMT_QUERY_OPERATION_NAME : 0,
+         Kind == KeyKind::Ec ? reinterpret_cast<Fn>(ecOperationName) : nullptr},
+        {0, nullptr},
+    };
+    return table;
+}
+
+/**
+ * @brief 按实例的属性填写算法表
+ */
+void fillAlgorithms(PoolProvider& provider)
+{
+    const char* property = provider.property.c_str();
+    provider.keymgmt[0] = {"X25519:1.3.101.110", property, keymgmtDispatch<KeyKind::X25519>(),
+                           "galay-ssl pooled X25519"};
+    provider.keymgmt[1] = {"EC:id-ecPublicKey:1.2.840.10045.2.1", property, keymgmtDispatch<KeyKind::Ec>(),
+                           "galay-ssl pooled EC"};
+    provider.keyexch[0] = {"X25519", property, keyexchDispatch<KeyKind::X25519>(),
+                           "galay-ssl pooled X25519 key exchange"};
+    provider.keyexch[1] = {"ECDH", property, keyexchDispatch<KeyKind::Ec>(), "galay-ssl pooled ECDH"};
+}
+
+const OSSL_ALGORITHM* queryOperation(void* provctx, int operation_id, int* no_cache)
+{
+    const auto* provider = static_cast<const PoolProvider*>(provctx);
+    *no_cache = 0;
+    switch (operation_id) {
+        case OSSL_OP_KEYMGMT:
+            return provider->keymgmt;
+        case OSSL_OP_KEYEXCH:
+            return provider->keyexch;
+        default:
+            return nullptr;
+    }
+}
+
+/**
+ * @brief 本 provider 宣告的 TLS 组
+ *
+ * @details libssl 只保留 KEYMGMT 取自宣告者本身的组：上下文选中本 provider 的 X25519 / EC KEYMGMT 后，
+ * default provider 宣告的同名组被丢弃，因此这里要重新宣告（取值与 default provider 相同）
+ */
+struct TlsGroup {
+    const char* name;
+    const char* internal;
+    const char* algorithm;
+    unsigned int id;
+    unsigned int securityBits;
+};
+
+constexpr TlsGroup kTlsGroups[] = {
+    {"x25519", "X25519", "X25519", 0x001d, 128},
+    {"secp256r1", "prime256v1", "EC", 0x0017, 128},
+    {"secp384r1", "secp384r1", "EC", 0x0018, 192},
+    {"secp521r1", "secp521r1", "EC", 0x0019, 256},
+    {"P-256", "prime256v1", "EC", 0x0017, 128},
+    {"P-384", "secp384r1", "EC", 0x0018, 192},
+    {"P-521", "secp521r1", "EC", 0x0019, 256},
+};
+
+int getCapabilities(void*, const char* capability, OSSL_CALLBACK* cb, void* arg)
+{
+    if (::strcasecmp(capability, "TLS-GROUP") != 0) {
+        return 0;
+    }
+    for (const auto& group : kTlsGroups) {
+        unsigned int id = group.id;
+        unsigned int bits = group.securityBits;
+        unsigned int is_kem = 0;
+        int min_tls = TLS1_VERSION;
+        int max_tls = 0;
+        int min_dtls = DTLS1_VERSION;
+        int max_dtls = 0;
+        OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_utf8_string(OSSL_CAPABILITY_TLS_GROUP_NAME, const_cast<char*>(group.name), 0),
+            OSSL_PARAM_construct_utf8_string(OSSL_CAPABILITY_TLS_GROUP_NAME_INTERNAL,
+                                             const_cast<char*>(group.internal), 0),
+            OSSL_PARAM_construct_utf8_string(OSSL_CAPABILITY_TLS_GROUP_ALG, const_cast<char*>(group.algorithm), 0),
+            OSSL_PARAM_construct_uint(OSSL_CAPABILITY_TLS_GROUP_ID, &id),
+            OSSL_PARAM_construct_uint(OSSL_CAPABILITY_TLS_GROUP_SECURITY_BITS, &bits),
+            OSSL_PARAM_construct_uint(OSSL_CAPABILITY_TLS_GROUP_IS_KEM, &is_kem),
+            OSSL_PARAM_construct_int(OSSL_CAPABILITY_TLS_GROUP_MIN_TLS, &min_tls),
+            OSSL_PARAM_construct_int(OSSL_CAPABILITY_TLS_GROUP_MAX_TLS, &max_tls),
+            OSSL_PARAM_construct_int(OSSL_CAPABILITY_TLS_GROUP_MIN_DTLS, &min_dtls),
+            OSSL_PARAM_construct_int(OSSL_CAPABILITY_TLS_GROUP_MAX_DTLS, &max_dtls),
+            OSSL_PARAM_construct_end(),
+        };
+        if (!cb(params, arg)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void providerTeardown(void* provctx)
+{
+    delete static_cast<PoolProvider*>(provctx);
+}
+
+// OSSL_PROVIDER_load 在调用线程上同步初始化实例，加载期间持锁交出待绑定的 provctx
+std::mutex g_initMutex;
+PoolProvider* g_initProvider = nullptr;
+OSSL_PROVIDER* g_defaultProvider = nullptr;
+
+int providerInit(const OSSL_CORE_HANDLE*, const OSSL_DISPATCH*, const OSSL_DISPATCH** out, void** provctx)
+{
+    static const OSSL_DISPATCH dispatch[] = {
+        {OSSL_FUNC_PROVIDER_TEARDOWN, reinterpret_cast<Fn>(providerTeardown)},
+        {OSSL_FUNC_PROVIDER_QUERY_OPERATION, reinterpret_cast<Fn>(queryOperation)},
+        {OSSL_FUNC_PROVIDER_GET_CAPABILITIES, reinterpret_cast<Fn>(getCapabilities)},
+        {0, nullptr},
+    };
+    *out = dispatch;
+    *provctx = std::exchange(g_initProvider, nullptr);
+    return *provctx != nullptr;
+}
+
+/**
+ * @brief 在默认 libctx 中为池注册并加载一个独立的 provider 实例
+ * @return 实例句柄（池销毁时卸载），失败返回 nullptr
+ */
+OSSL_PROVIDER* loadProvider(SslKeySharePool* pool, uint64_t id)
+{
+    static const bool default_loaded = [] {
+        // 显式加载任一 provider 后 default 不再自动加载，需一并加载；句柄在 OPENSSL_cleanup 时释放
+        g_defaultProvider = OSSL_PROVIDER_load(nullptr, "default");
+        return g_defaultProvider != nullptr && OPENSSL_atexit([] { OSSL_PROVIDER_unload(g_defaultProvider); }) == 1;
+    }();
+    if (!default_loaded) {
+        return nullptr;
+    }
+
+    const std::string name = std::string(kProviderName) + "-" + std::to_string(id);
+    auto* provider = new PoolProvider;
+    provider->pool.store(pool, std::memory_order_relaxed);
+    provider->property = "provider=" + name + ",galay.keyshare=" + std::to_string(id);
+    fillAlgorithms(*provider);
+
+    std::lock_guard<std::mutex> lock(g_initMutex);
+    g_initProvider = provider;
+    OSSL_PROVIDER* handle = nullptr;
+    if (OSSL_PROVIDER_add_builtin(nullptr, name.c_str(), providerInit) == 1) {
+        handle = OSSL_PROVIDER_load(nullptr, name.c_str());
+    }
+    // 未走到初始化时实例仍归这里
+    delete std::exchange(g_initProvider, nullptr);
+    return handle;
+}
+
+} // anonymous namespace
+
+struct SslKeySharePool::Group {
+    int nid;
+    KeyRing ring;
+
+    Group(int groupNid, size_t capacity)
+        : nid(groupNid)
+        , ring(capacity)
+    {
+    }
+};
+
+std::expected<std::shared_ptr<SslKeySharePool>, SslError> SslKeySharePool::create(SslKeySharePoolOptions options)
+{
+    static std::atomic<uint64_t> next_id{0};
+
+    std::shared_ptr<SslKeySharePool> pool(new SslKeySharePool(std::move(options)));
+    for (const auto& name : pool->m_options.groups) {
+        const int nid = groupNid(name);
+        if (nid == NID_undef) {
+            return std::unexpected(SslError(SslErrorCode::kKeySharePoolFailed));
+        }
+        pool->m_groups.push_back(std::make_unique<Group>(nid, pool->m_options.capacity));
+    }
+    const uint64_t id = next_id.fetch_add(1, std::memory_order_relaxed) + 1;
+    pool->m_provider = loadProvider(pool.get(), id);
+    if (pool->m_provider == nullptr) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kKeySharePoolFailed));
+    }
+    pool->m_propertyQuery = "?galay.keyshare=" + std::to_string(id);
+    // 先同步填满，第一波握手即可命中
+    for (auto& group : pool->m_groups) {
+        (void)pool->refill(*group);
+    }
+    pool->m_thread = std::thread([raw = pool.get()] { raw->refillLoop(); });
+    return pool;
+}
+
+SslKeySharePool::SslKeySharePool(SslKeySharePoolOptions options)
+    : m_options(std::move(options))
+{
+    m_options.refillThreshold = std::min(m_options.refillThreshold, m_options.capacity);
+}
+
+SslKeySharePool::~SslKeySharePool()
+{
+    if (m_provider != nullptr) {
+        auto* provider = static_cast<PoolProvider*>(OSSL_PROVIDER_get0_provider_ctx(m_provider));
+        provider->pool.store(nullptr, std::memory_order_release);
+        OSSL_PROVIDER_unload(m_provider);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+SslKeySharePoolStats SslKeySharePool::stats() const
+{
+    SslKeySharePoolStats result;
+    result.generated = m_generated.load(std::memory_order_relaxed);
+    result.served = m_served.load(std::memory_order_relaxed);
+    result.misses = m_misses.load(std::memory_order_relaxed);
+    for (const auto& group : m_groups) {
+        result.available += group->ring.size();
+    }
+    return result;
+}
+
+EVP_PKEY* SslKeySharePool::take(int nid)
+{
+    for (auto& group : m_groups) {
+        if (group->nid != nid) {
+            continue;
+        }
+        EVP_PKEY* key = group->ring.pop();
+        if (group->ring.size() < m_options.refillThreshold &&
+            !m_refillRequested.exchange(true, std::memory_order_acq_rel)) {
+            m_cv.notify_one();
+        }
+        if (key != nullptr) {
+            m_served.fetch_add(1, std::memory_order_relaxed);
+            return key;
+        }
+        break;
+    }
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+void SslKeySharePool::refillLoop()
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // 握手线程不持锁通知，可能错过唤醒；定期检查兜底
+            m_cv.wait_for(lock, std::chrono::milliseconds(50), [this] {
+                return m_stopping || m_refillRequested.load(std::memory_order_acquire);
+            });
+            if (m_stopping) {
+                return;
+            }
+        }
+        m_refillRequested.store(false, std::memory_order_release);
+        for (auto& group : m_groups) {
+            if (!refill(*group)) {
+                break;
+            }
+        }
+    }
+}
+
+bool SslKeySharePool::refill(Group& group)
+{
+    while (group.ring.size() < group.ring.capacity()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopping) {
+                return false;
+            }
+        }
+        EVP_PKEY* key = generateKey(group.nid);
+        if (key == nullptr) {
+            return false;
+        }
+        if (!group.ring.push(key)) {
+            EVP_PKEY_free(key);
+            break;
+        }
+        m_generated.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+} // namespace galay::ssl
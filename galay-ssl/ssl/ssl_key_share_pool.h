@@ -0,0 +1,109 @@
+#ifndef GALAY_SSL_KEY_SHARE_POOL_H
+#define GALAY_SSL_KEY_SHARE_POOL_H
+
+#include "galay-ssl/common/defn.hpp"
+#include "galay-ssl/common/error.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 临时密钥预生成池配置
+ */
+struct SslKeySharePoolOptions {
+    std::vector<std::string> groups{"X25519", "P-256"};    ///< 预生成的组，EC 曲线可写 NIST 名或 OpenSSL 短名
+    size_t capacity = 256;                                  ///< 每组缓存的密钥数（向上取 2 的幂）
+    size_t refillThreshold = 128;                           ///< 某组剩余低于该值时唤醒生成线程
+};
+
+/**
+ * @brief 临时密钥预生成池统计
+ */
+struct SslKeySharePoolStats {
+    uint64_t generated = 0;     ///< 后台线程生成的密钥数
+    uint64_t served = 0;        ///< 握手从池中取走的密钥数
+    uint64_t misses = 0;        ///< 池空或组未预生成时在握手线程上现场生成的次数
+    size_t available = 0;       ///< 当前池中的密钥数
+};
+
+/**
+ * @brief ECDHE 临时密钥预生成池
+ *
+ * @details 后台线程为每个组预先生成密钥对，放入无锁环形队列。以
+ * SslContext(SslMethod, std::shared_ptr<SslKeySharePool>) 构造的上下文在生成 key share
+ * （TLS 1.3 KeyShare、TLS 1.2 ServerKeyExchange / ClientKeyExchange）时从池中取用，
+ * 握手线程省去一次标量乘法；池空时现场生成，结果相同。
+ *
+ * 接入方式是进程内注册的 OpenSSL provider：每个池加载一个实例，以可选属性 galay.keyshare=<池编号>
+ * 提供 X25519 与 EC 的 KEYMGMT，其余操作委托给 default provider。只有以 propertyQuery() 创建的
+ * SSL_CTX 会选中该实例，生成 key share 时只从这个池取密钥。
+ *
+ * @note 多个池可以同时存在；每个密钥只交出一次，不会在连接之间复用
+ */
+class SslKeySharePool
+{
+public:
+    /**
+     * @brief 注册本池的 provider 实例、填满池并启动生成线程
+     * @return 组名无法识别或 provider 注册失败时返回 kKeySharePoolFailed
+     */
+    static std::expected<std::shared_ptr<SslKeySharePool>, SslError> create(SslKeySharePoolOptions options = {});
+
+    ~SslKeySharePool();
+
+    SslKeySharePool(const SslKeySharePool&) = delete;
+    SslKeySharePool& operator=(const SslKeySharePool&) = delete;
+
+    /**
+     * @brief 统计快照
+     */
+    SslKeySharePoolStats stats() const;
+
+    const SslKeySharePoolOptions& options() const { return m_options; }
+
+    /**
+     * @brief 上下文创建 SSL_CTX 时使用的属性查询，选中本池的 provider 实例
+     */
+    const std::string& propertyQuery() const { return m_propertyQuery; }
+
+    /**
+     * @brief 取出一个预生成的密钥对（供 provider 调用）
+     * @param nid NID_X25519 或 EC 曲线的 NID
+     * @return 密钥（调用者释放），池空或组未预生成时返回 nullptr
+     */
+    EVP_PKEY* take(int nid);
+
+private:
+    struct Group;
+
+    explicit SslKeySharePool(SslKeySharePoolOptions options);
+    void refillLoop();
+    bool refill(Group& group);
+
+    SslKeySharePoolOptions m_options;
+    OSSL_PROVIDER* m_provider = nullptr;     ///< 本池的 provider 实例，销毁时卸载
+    std::string m_propertyQuery;
+    std::vector<std::unique_ptr<Group>> m_groups;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stopping = false;
+    std::atomic<bool> m_refillRequested{false};
+    std::atomic<uint64_t> m_generated{0};
+    std::atomic<uint64_t> m_served{0};
+    std::atomic<uint64_t> m_misses{0};
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_KEY_SHARE_POOL_H
@@ -0,0 +1,849 @@
+// RSA_METHOD / EC_KEY_METHOD 在 OpenSSL 3 中已标记为 deprecated，但仍是让旧式密钥在 async job 中运算的唯一途径
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "ssl_keyless.h"
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <memory>
+
+namespace galay::ssl
+{
+
+namespace {
+
+constexpr size_t kRequestHeader = 8 + 1 + 4 + 32;   // id | op | padding | key id
+constexpr size_t kResponseHeader = 8 + 1;           // id | status
+constexpr size_t kMaxFrame = 64 * 1024;
+
+void putU32(std::vector<unsigned char>& out, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<unsigned char>(value >> shift));
+    }
+}
+
+void putU64(std::vector<unsigned char>& out, uint64_t value)
+{
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<unsigned char>(value >> shift));
+    }
+}
+
+uint32_t getU32(const unsigned char* in)
+{
+    return (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) | (uint32_t(in[2]) << 8) | uint32_t(in[3]);
+}
+
+uint64_t getU64(const unsigned char* in)
+{
+    return (uint64_t(getU32(in)) << 32) | getU32(in + 4);
+}
+
+bool setNonBlock(int fd)
+{
+    const int flags = ::fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool makeWakePipe(int& read_fd, int& write_fd)
+{
+    int fds[2];
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        return false;
+    }
+    read_fd = fds[0];
+    write_fd = fds[1];
+    return true;
+}
+
+void wake(int fd)
+{
+    const char byte = 1;
+    (void)::write(fd, &byte, 1);
+}
+
+void drain(int fd)
+{
+    char buffer[64];
+    while (::read(fd, buffer, sizeof(buffer)) > 0) {
+    }
+}
+
+bool fillAddress(const std::string& path, sockaddr_un& addr)
+{
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    return true;
+}
+
+/**
+ * @brief 写出缓冲区中尽可能多的数据
+ * @return false 表示连接出错
+ */
+bool writeSome(int fd, std::vector<unsigned char>& buffer)
+{
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+        const ssize_t n = ::send(fd, buffer.data() + offset, buffer.size() - offset, MSG_NOSIGNAL);
+        if (n > 0) {
+            offset += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        return false;
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(offset));
+    return true;
+}
+
+/**
+ * @brief 读出当前可读的全部数据
+ * @return false 表示对端关闭或连接出错
+ */
+bool readAvailable(int fd, std::vector<unsigned char>& buffer)
+{
+    unsigned char chunk[16 * 1024];
+    for (;;) {
+        const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            buffer.insert(buffer.end(), chunk, chunk + n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+// ==================== 握手侧密钥 ====================
+
+/**
+ * @brief 包装密钥上的 ex_data：所属客户端与密钥 id，随密钥释放
+ */
+struct KeylessBinding {
+    SslKeylessClient* client = nullptr;
+    SslKeylessKeyId id{};
+};
+
+void freeBinding(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+{
+    delete static_cast<KeylessBinding*>(ptr);
+}
+
+int rsaIndex()
+{
+    static const int index = RSA_get_ex_new_index(0, nullptr, nullptr, nullptr, freeBinding);
+    return index;
+}
+
+int ecIndex()
+{
+    static const int index = EC_KEY_get_ex_new_index(0, nullptr, nullptr, nullptr, freeBinding);
+    return index;
+}
+
+/**
+ * @brief 在签名进程上执行一次运算
+ * @return 输出长度，失败返回 -1
+ *
+ * @details 在 async job 中时暂停 job 等待响应；否则阻塞当前线程等待。输出先收进堆上缓冲，
+ * job 恢复后再复制到 OpenSSL 的缓冲区：连接在等待期间释放时 job 不会恢复，响应不会写入已释放的内存
+ */
+int execute(const KeylessBinding& binding, SslKeylessOp op, int padding,
+            const unsigned char* from, size_t flen, unsigned char* to, size_t capacity)
+{
+    auto output = std::make_shared<std::vector<unsigned char>>();
+    auto collect = [output, capacity](std::expected<std::vector<unsigned char>, SslError>& result) {
+        if (!result || result->size() > capacity) {
+            return -1;
+        }
+        *output = std::move(*result);
+        return static_cast<int>(output->size());
+    };
+
+    auto length = detail::runAsyncKeyOperation([&](detail::SslKeyCompletion complete) {
+        return binding.client->submit(op, binding.id, padding, from, flen,
+            [collect, complete = std::move(complete)](auto result) { complete(collect(result)); });
+    });
+    if (!length) {
+        auto promise = std::make_shared<std::promise<int>>();
+        auto future = promise->get_future();
+        if (!binding.client->submit(op, binding.id, padding, from, flen,
+                [collect, promise](auto result) { promise->set_value(collect(result)); })) {
+            return -1;
+        }
+        length = future.get();
+    }
+    if (*length > 0) {
+        std::memcpy(to, output->data(), static_cast<size_t>(*length));
+    }
+    return *length;
+}
+
+int rsaPrivEnc(int flen, const unsigned char* from, unsigned char* to, RSA* rsa, int padding)
+{
+    auto* binding = static_cast<KeylessBinding*>(RSA_get_ex_data(rsa, rsaIndex()));
+    if (binding == nullptr || flen < 0) {
+        return -1;
+    }
+    return execute(*binding, SslKeylessOp::RsaPrivateEncrypt, padding, from, static_cast<size_t>(flen),
+                   to, static_cast<size_t>(RSA_size(rsa)));
+}
+
+int rsaPrivDec(int flen, const unsigned char* from, unsigned char* to, RSA* rsa, int padding)
+{
+    auto* binding = static_cast<KeylessBinding*>(RSA_get_ex_data(rsa, rsaIndex()));
+    if (binding == nullptr || flen < 0) {
+        return -1;
+    }
+    return execute(*binding, SslKeylessOp::RsaPrivateDecrypt, padding, from, static_cast<size_t>(flen),
+                   to, static_cast<size_t>(RSA_size(rsa)));
+}
+
+int ecSign(int, const unsigned char* dgst, int dlen, unsigned char* sig, unsigned int* siglen,
+           const BIGNUM*, const BIGNUM*, EC_KEY* eckey)
+{
+    auto* binding = static_cast<KeylessBinding*>(EC_KEY_get_ex_data(eckey, ecIndex()));
+    if (binding == nullptr || dlen < 0) {
+        return 0;
+    }
+    const int length = execute(*binding, SslKeylessOp::EcdsaSign, 0, dgst, static_cast<size_t>(dlen),
+                               sig, static_cast<size_t>(ECDSA_size(eckey)));
+    if (length < 0) {
+        return 0;
+    }
+    *siglen = static_cast<unsigned int>(length);
+    return 1;
+}
+
+// 方法表在进程内共享且不释放：包装后的密钥可能比客户端活得更久
+RSA_METHOD* rsaMethod()
+{
+    static RSA_METHOD* method = [] {
+        RSA_METHOD* m = RSA_meth_dup(RSA_PKCS1_OpenSSL());
+        if (m != nullptr) {
+            RSA_meth_set1_name(m, "galay-ssl keyless RSA");
+            RSA_meth_set_priv_enc(m, rsaPrivEnc);
+            RSA_meth_set_priv_dec(m, rsaPrivDec);
+        }
+        return m;
+    }();
+    return method;
+}
+
+EC_KEY_METHOD* ecMethod()
+{
+    static EC_KEY_METHOD* method = [] {
+        EC_KEY_METHOD* m = EC_KEY_METHOD_new(EC_KEY_OpenSSL());
+        if (m != nullptr) {
+            // sign_setup / sign_sig 只在本地有私钥时可用，签名一律走 ecSign
+            EC_KEY_METHOD_set_sign(m, ecSign, nullptr, nullptr);
+        }
+        return m;
+    }();
+    return method;
+}
+
+} // anonymous namespace
+
+std::expected<SslKeylessKeyId, SslError> keylessKeyId(EVP_PKEY* key)
+{
+    unsigned char* der = nullptr;
+    const int length = key ? i2d_PUBKEY(key, &der) : -1;
+    if (length <= 0) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kPrivateKeyLoadFailed));
+    }
+    SslKeylessKeyId id{};
+    const bool ok = EVP_Digest(der, static_cast<size_t>(length), id.data(), nullptr, EVP_sha256(), nullptr) == 1;
+    OPENSSL_free(der);
+    if (!ok) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kPrivateKeyLoadFailed));
+    }
+    return id;
+}
+
+// ==================== SslKeylessClient ====================
+
+SslKeylessClient::SslKeylessClient(std::string socketPath, SslKeylessOptions options)
+    : m_socketPath(std::move(socketPath))
+    , m_options(options)
+{
+    m_options.maxBatch = std::max<size_t>(1, m_options.maxBatch);
+    if (makeWakePipe(m_wakeRead, m_wakeWrite)) {
+        m_thread = std::thread([this] { ioLoop(); });
+    }
+}
+
+SslKeylessClient::~SslKeylessClient()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    if (m_thread.joinable()) {
+        wake(m_wakeWrite);
+        m_thread.join();
+    }
+    if (m_wakeRead >= 0) {
+        ::close(m_wakeRead);
+        ::close(m_wakeWrite);
+    }
+}
+
+std::expected<EVP_PKEY*, SslError> SslKeylessClient::wrap(EVP_PKEY* key)
+{
+    auto id = keylessKeyId(key);
+    if (!id) {
+        return std::unexpected(id.error());
+    }
+
+    EVP_PKEY* wrapped = EVP_PKEY_new();
+    if (wrapped == nullptr) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kPrivateKeyLoadFailed));
+    }
+    auto binding = std::make_unique<KeylessBinding>();
+    binding->client = this;
+    binding->id = *id;
+
+    switch (EVP_PKEY_get_base_id(key)) {
+        case EVP_PKEY_RSA: {
+            const RSA* source = EVP_PKEY_get0_RSA(key);
+            RSA* rsa = source ? RSAPublicKey_dup(source) : nullptr;
+            if (rsa != nullptr && rsaMethod() != nullptr &&
+                RSA_set_method(rsa, rsaMethod()) == 1 &&
+                RSA_set_ex_data(rsa, rsaIndex(), binding.get()) == 1) {
+                binding.release();
+                if (EVP_PKEY_assign_RSA(wrapped, rsa) == 1) {
+                    return wrapped;
+                }
+            }
+            RSA_free(rsa);
+            break;
+        }
+        case EVP_PKEY_EC: {
+            const EC_KEY* source = EVP_PKEY_get0_EC_KEY(key);
+            EC_KEY* ec = EC_KEY_new();
+            if (ec != nullptr && source != nullptr &&
+                EC_KEY_set_group(ec, EC_KEY_get0_group(source)) == 1 &&
+                EC_KEY_set_public_key(ec, EC_KEY_get0_public_key(source)) == 1 &&
+                ecMethod() != nullptr &&
+                EC_KEY_set_method(ec, ecMethod()) == 1 &&
+                EC_KEY_set_ex_data(ec, ecIndex(), binding.get()) == 1) {
+                binding.release();
+                if (EVP_PKEY_assign_EC_KEY(wrapped, ec) == 1) {
+                    return wrapped;
+                }
+            }
+            EC_KEY_free(ec);
+            break;
+        }
+        default:
+            break;
+    }
+
+    EVP_PKEY_free(wrapped);
+    return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kPrivateKeyLoadFailed));
+}
+
+bool SslKeylessClient::submit(SslKeylessOp op, const SslKeylessKeyId& keyId, int padding,
+                              const unsigned char* input, size_t length, SslKeylessCallback done)
+{
+    if (kRequestHeader + length > kMaxFrame) {
+        return false;
+    }
+    std::vector<unsigned char> frame;
+    frame.reserve(4 + kRequestHeader + length);
+    putU32(frame, static_cast<uint32_t>(kRequestHeader + length));
+    putU64(frame, 0);   // id 在入队时填写
+    frame.push_back(static_cast<unsigned char>(op));
+    putU32(frame, static_cast<uint32_t>(padding));
+    frame.insert(frame.end(), keyId.begin(), keyId.end());
+    frame.insert(frame.end(), input, input + length);
+
+    bool was_empty = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping || !m_thread.joinable() || m_pending.size() >= m_options.maxInflight) {
+            return false;
+        }
+        const uint64_t id = m_nextId++;
+        for (int i = 0; i < 8; ++i) {
+            frame[4 + i] = static_cast<unsigned char>(id >> (56 - 8 * i));
+        }
+        was_empty = m_queue.empty();
+        m_queue.emplace_back(id, std::move(frame));
+        m_pending.emplace(id, Pending{std::move(done), std::chrono::steady_clock::now() + m_options.timeout});
+    }
+    // 队列非空时 IO 线程已被唤醒，后续请求与之合并写出
+    if (was_empty) {
+        wake(m_wakeWrite);
+    }
+    return true;
+}
+
+SslKeylessStats SslKeylessClient::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SslKeylessStats result;
+    result.requests = m_requests;
+    result.batches = m_batches;
+    result.failures = m_failures;
+    result.timeouts = m_timeouts;
+    result.reconnects = m_reconnects;
+    result.inflight = m_pending.size();
+    return result;
+}
+
+void SslKeylessClient::ioLoop()
+{
+    for (;;) {
+        bool has_queue = false;
+        bool has_pending = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopping) {
+                break;
+            }
+            has_queue = !m_queue.empty();
+            has_pending = !m_pending.empty();
+        }
+        if (has_queue && m_output.empty() && ensureConnected()) {
+            flushQueue();
+        }
+
+        pollfd fds[2] = {{m_wakeRead, POLLIN, 0}, {m_fd, POLLIN, 0}};
+        if (!m_output.empty()) {
+            fds[1].events |= POLLOUT;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            has_queue = !m_queue.empty();
+        }
+        // 还有排队请求且上一批已写完时立即进入下一轮；有在途请求时定期检查超时
+        const int timeout = (has_queue && m_output.empty() && m_fd >= 0) ? 0 : (has_pending ? 10 : -1);
+        const int ready = ::poll(fds, m_fd >= 0 ? 2 : 1, timeout);
+        if (ready > 0) {
+            if (fds[0].revents & POLLIN) {
+                drain(m_wakeRead);
+            }
+            if (m_fd >= 0 && fds[1].revents != 0) {
+                if (fds[1].revents & POLLIN) {
+                    readResponses();
+                }
+                if (m_fd >= 0 && (fds[1].revents & POLLOUT) && !writeSome(m_fd, m_output)) {
+                    disconnect();
+                }
+                if (m_fd >= 0 && (fds[1].revents & (POLLHUP | POLLERR))) {
+                    disconnect();
+                }
+            }
+        }
+        expire(std::chrono::steady_clock::now());
+    }
+
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    std::vector<Pending> completions;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& [id, pending] : m_pending) {
+            completions.push_back(std::move(pending));
+        }
+        m_failures += m_pending.size();
+        m_pending.clear();
+        m_queue.clear();
+    }
+    completeAll(completions);
+}
+
+bool SslKeylessClient::ensureConnected()
+{
+    if (m_fd >= 0) {
+        return true;
+    }
+    sockaddr_un addr{};
+    int fd = fillAddress(m_socketPath, addr) ? ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) : -1;
+    if (fd >= 0 && (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || !setNonBlock(fd))) {
+        ::close(fd);
+        fd = -1;
+    }
+    if (fd < 0) {
+        // 签名进程不可用：排队与在途的运算全部失败，握手随之失败
+        disconnect();
+        return false;
+    }
+    m_fd = fd;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_reconnects;
+    return true;
+}
+
+void SslKeylessClient::disconnect()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_output.clear();
+    m_input.clear();
+    std::vector<Pending> completions;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& [id, pending] : m_pending) {
+            completions.push_back(std::move(pending));
+        }
+        m_failures += m_pending.size();
+        m_pending.clear();
+        m_queue.clear();
+    }
+    completeAll(completions);
+}
+
+void SslKeylessClient::flushQueue()
+{
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (!m_queue.empty() && count < m_options.maxBatch) {
+            auto& [id, frame] = m_queue.front();
+            // 已超时的请求不再发出
+            if (m_pending.count(id) != 0) {
+                m_output.insert(m_output.end(), frame.begin(), frame.end());
+                ++count;
+            }
+            m_queue.pop_front();
+        }
+        if (count > 0) {
+            m_requests += count;
+            ++m_batches;
+        }
+    }
+    if (!m_output.empty() && !writeSome(m_fd, m_output)) {
+        disconnect();
+    }
+}
+
+void SslKeylessClient::readResponses()
+{
+    const bool open = readAvailable(m_fd, m_input);
+
+    struct Completion {
+        Pending pending;
+        std::expected<std::vector<unsigned char>, SslError> output;
+    };
+    std::vector<Completion> completions;
+    size_t offset = 0;
+    bool corrupt = false;
+    while (m_input.size() - offset >= 4) {
+        const uint32_t length = getU32(m_input.data() + offset);
+        if (length < kResponseHeader || length > kMaxFrame) {
+            corrupt = true;
+            break;
+        }
+        if (m_input.size() - offset - 4 < length) {
+            break;
+        }
+        const unsigned char* body = m_input.data() + offset + 4;
+        const uint64_t id = getU64(body);
+        const bool ok = body[8] == 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto it = m_pending.find(id);
+        if (it != m_pending.end()) {
+            if (!ok) {
+                ++m_failures;
+            }
+            Completion completion{std::move(it->second), std::unexpected(SslError(SslErrorCode::kKeyOperationFailed))};
+            m_pending.erase(it);
+            lock.unlock();
+            if (ok) {
+                completion.output = std::vector<unsigned char>(body + kResponseHeader, body + length);
+            }
+            completions.push_back(std::move(completion));
+        }
+        offset += 4 + length;
+    }
+    m_input.erase(m_input.begin(), m_input.begin() + static_cast<std::ptrdiff_t>(offset));
+
+    for (auto& completion : completions) {
+        completion.pending.done(std::move(completion.output));
+    }
+    if (!open || corrupt) {
+        disconnect();
+    }
+}
+
+void SslKeylessClient::expire(std::chrono::steady_clock::time_point now)
+{
+    std::vector<Pending> completions;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_pending.begin(); it != m_pending.end();) {
+            if (it->second.deadline <= now) {
+                completions.push_back(std::move(it->second));
+                it = m_pending.erase(it);
+                ++m_timeouts;
+            } else {
+                ++it;
+            }
+        }
+    }
+    // 迟到的响应因 id 已不在 m_pending 中被丢弃
+    completeAll(completions);
+}
+
+void SslKeylessClient::completeAll(std::vector<Pending>& completions)
+{
+    for (auto& pending : completions) {
+        pending.done(std::unexpected(SslError(SslErrorCode::kKeyOperationFailed)));
+    }
+    completions.clear();
+}
+
+// ==================== SslKeylessSigner ====================
+
+SslKeylessSigner::SslKeylessSigner(std::string socketPath)
+    : m_socketPath(std::move(socketPath))
+{
+}
+
+SslKeylessSigner::~SslKeylessSigner()
+{
+    stop();
+    for (auto& [id, key] : m_keys) {
+        EVP_PKEY_free(key);
+    }
+}
+
+std::expected<void, SslError> SslKeylessSigner::addKey(const std::string& keyFile, SslFileType type)
+{
+    if (m_thread.joinable()) {
+        return std::unexpected(SslError(SslErrorCode::kPrivateKeyLoadFailed));
+    }
+    EVP_PKEY* key = nullptr;
+    if (FILE* file = std::fopen(keyFile.c_str(), "rb")) {
+        key = type == SslFileType::PEM ? PEM_read_PrivateKey(file, nullptr, nullptr, nullptr)
+                                       : d2i_PrivateKey_fp(file, nullptr);
+        std::fclose(file);
+    }
+    const int base = key ? EVP_PKEY_get_base_id(key) : EVP_PKEY_NONE;
+    if (base != EVP_PKEY_RSA && base != EVP_PKEY_EC) {
+        EVP_PKEY_free(key);
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kPrivateKeyLoadFailed));
+    }
+    auto id = keylessKeyId(key);
+    if (!id) {
+        EVP_PKEY_free(key);
+        return std::unexpected(id.error());
+    }
+    auto [it, inserted] = m_keys.emplace(*id, key);
+    if (!inserted) {
+        EVP_PKEY_free(key);
+    }
+    return {};
+}
+
+std::expected<void, SslError> SslKeylessSigner::start()
+{
+    if (m_thread.joinable()) {
+        return {};
+    }
+    sockaddr_un addr{};
+    if (!fillAddress(m_socketPath, addr)) {
+        return std::unexpected(SslError(SslErrorCode::kKeyOperationFailed));
+    }
+    ::unlink(m_socketPath.c_str());
+    m_listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0 ||
+        ::bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(m_listenFd, 128) != 0 ||
+        !makeWakePipe(m_wakeRead, m_wakeWrite)) {
+        if (m_listenFd >= 0) {
+            ::close(m_listenFd);
+            m_listenFd = -1;
+        }
+        return std::unexpected(SslError(SslErrorCode::kKeyOperationFailed));
+    }
+    m_thread = std::thread([this] { loop(); });
+    return {};
+}
+
+void SslKeylessSigner::stop()
+{
+    if (!m_thread.joinable()) {
+        return;
+    }
+    wake(m_wakeWrite);
+    m_thread.join();
+    ::close(m_listenFd);
+    ::close(m_wakeRead);
+    ::close(m_wakeWrite);
+    m_listenFd = m_wakeRead = m_wakeWrite = -1;
+    ::unlink(m_socketPath.c_str());
+}
+
+SslKeylessSignerStats SslKeylessSigner::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SslKeylessSignerStats result;
+    result.requests = m_requests;
+    result.batches = m_batches;
+    result.errors = m_errors;
+    result.connections = m_connections;
+    return result;
+}
+
+void SslKeylessSigner::loop()
+{
+    std::vector<Connection> connections;
+    std::vector<pollfd> fds;
+    for (;;) {
+        fds.clear();
+        fds.push_back({m_wakeRead, POLLIN, 0});
+        fds.push_back({m_listenFd, POLLIN, 0});
+        for (const auto& conn : connections) {
+            fds.push_back({conn.fd, static_cast<short>(POLLIN | (conn.output.empty() ? 0 : POLLOUT)), 0});
+        }
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            break;
+        }
+
+        // 先处理已有连接（fds 与 connections 下标对应），再接受新连接
+        std::vector<Connection> alive;
+        alive.reserve(connections.size());
+        for (size_t i = 0; i < connections.size(); ++i) {
+            Connection& conn = connections[i];
+            if (fds[i + 2].revents == 0 || serve(conn)) {
+                alive.push_back(std::move(conn));
+            } else {
+                ::close(conn.fd);
+            }
+        }
+        connections = std::move(alive);
+
+        if (fds[1].revents & POLLIN) {
+            for (;;) {
+                const int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    break;
+                }
+                connections.push_back(Connection{fd, {}, {}});
+            }
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_connections = connections.size();
+    }
+
+    for (const auto& conn : connections) {
+        ::close(conn.fd);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_connections = 0;
+}
+
+bool SslKeylessSigner::serve(Connection& conn)
+{
+    const bool open = readAvailable(conn.fd, conn.input);
+
+    // 这一轮到达的请求逐个运算，响应合并为一次写出
+    const size_t before = conn.output.size();
+    size_t offset = 0;
+    while (conn.input.size() - offset >= 4) {
+        const uint32_t length = getU32(conn.input.data() + offset);
+        if (length < kRequestHeader || length > kMaxFrame) {
+            return false;
+        }
+        if (conn.input.size() - offset - 4 < length) {
+            break;
+        }
+        handleFrame(conn.input.data() + offset + 4, length, conn.output);
+        offset += 4 + length;
+    }
+    conn.input.erase(conn.input.begin(), conn.input.begin() + static_cast<std::ptrdiff_t>(offset));
+
+    if (conn.output.size() > before) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_batches;
+    }
+    return writeSome(conn.fd, conn.output) && open;
+}
+
+void SslKeylessSigner::handleFrame(const unsigned char* body, size_t length, std::vector<unsigned char>& output)
+{
+    const uint64_t id = getU64(body);
+    const auto op = static_cast<SslKeylessOp>(body[8]);
+    const int padding = static_cast<int>(getU32(body + 9));
+    SslKeylessKeyId key_id{};
+    std::memcpy(key_id.data(), body + 13, key_id.size());
+    const unsigned char* input = body + kRequestHeader;
+    const int input_length = static_cast<int>(length - kRequestHeader);
+
+    std::vector<unsigned char> result;
+    bool ok = false;
+    auto it = m_keys.find(key_id);
+    if (it != m_keys.end()) {
+        EVP_PKEY* key = it->second;
+        if (op == SslKeylessOp::RsaPrivateEncrypt || op == SslKeylessOp::RsaPrivateDecrypt) {
+            RSA* rsa = const_cast<RSA*>(EVP_PKEY_get0_RSA(key));
+            if (rsa != nullptr) {
+                result.resize(static_cast<size_t>(RSA_size(rsa)));
+                const int n = op == SslKeylessOp::RsaPrivateEncrypt
+                    ? RSA_private_encrypt(input_length, input, result.data(), rsa, padding)
+                    : RSA_private_decrypt(input_length, input, result.data(), rsa, padding);
+                ok = n >= 0;
+                result.resize(ok ? static_cast<size_t>(n) : 0);
+            }
+        } else if (op == SslKeylessOp::EcdsaSign) {
+            EC_KEY* ec = const_cast<EC_KEY*>(EVP_PKEY_get0_EC_KEY(key));
+            if (ec != nullptr) {
+                result.resize(static_cast<size_t>(ECDSA_size(ec)));
+                unsigned int n = 0;
+                ok = ECDSA_sign(0, input, input_length, result.data(), &n, ec) == 1;
+                result.resize(ok ? n : 0);
+            }
+        }
+    }
+
+    putU32(output, static_cast<uint32_t>(kResponseHeader + result.size()));
+    putU64(output, id);
+    output.push_back(ok ? 0 : 1);
+    output.insert(output.end(), result.begin(), result.end());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_requests;
+    if (!ok) {
+        ++m_errors;
+    }
+}
+
+} // namespace galay::ssl
@@ -0,0 +1,242 @@
+#ifndef GALAY_SSL_KEYLESS_H
+#define GALAY_SSL_KEYLESS_H
+
+#include "galay-ssl/common/defn.hpp"
+#include "galay-ssl/common/error.h"
+#include "ssl_key_offload.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 签名进程协议中的私钥运算
+ *
+ * @details 帧格式（整数均为大端）：
+ * - 请求：u32 长度 | u64 id | u8 运算 | i32 padding | 32 字节密钥 id | 输入
+ * - 响应：u32 长度 | u64 id | u8 状态（0 成功）| 输出
+ *
+ * 长度不含自身的 4 字节；密钥 id 为公钥 SubjectPublicKeyInfo DER 的 SHA-256。
+ * 同一连接上请求可流水线发送，响应按完成顺序返回并以 id 对应。
+ */
+enum class SslKeylessOp : uint8_t {
+    RsaPrivateEncrypt = 1,  ///< RSA 私钥加密（签名），输入为已填充的摘要
+    RsaPrivateDecrypt = 2,  ///< RSA 私钥解密（TLS 1.2 RSA 密钥交换）
+    EcdsaSign = 3,          ///< ECDSA 签名，输入为摘要，输出为 DER 签名
+};
+
+using SslKeylessKeyId = std::array<unsigned char, 32>;
+
+/**
+ * @brief 计算密钥在签名进程协议中的 id
+ * @param key 私钥或公钥
+ * @return 公钥 DER 的 SHA-256，编码失败返回 kPrivateKeyLoadFailed
+ */
+std::expected<SslKeylessKeyId, SslError> keylessKeyId(EVP_PKEY* key);
+
+/**
+ * @brief 签名进程客户端配置
+ */
+struct SslKeylessOptions {
+    std::chrono::milliseconds timeout{2000};    ///< 单次运算超时，超时的运算以失败完成
+    size_t maxBatch = 64;                       ///< 一次写出合并的最大请求数
+    size_t maxInflight = 4096;                  ///< 已发出未响应的请求上限，超出时 submit() 拒绝
+};
+
+/**
+ * @brief 签名进程客户端统计
+ */
+struct SslKeylessStats {
+    uint64_t requests = 0;      ///< 发出的运算请求数
+    uint64_t batches = 0;       ///< 写出批次数，requests / batches 即平均批量
+    uint64_t failures = 0;      ///< 签名进程返回失败或连接断开的运算数
+    uint64_t timeouts = 0;      ///< 超时的运算数
+    uint64_t reconnects = 0;    ///< 建立连接的次数
+    size_t inflight = 0;        ///< 已发出未响应的运算数
+};
+
+/**
+ * @brief 私钥运算结果回调，在客户端 IO 线程上调用
+ */
+using SslKeylessCallback = std::function<void(std::expected<std::vector<unsigned char>, SslError> output)>;
+
+/**
+ * @brief keyless 签名后端：把私钥运算交给本地签名进程
+ *
+ * @details 作为 SslKeyBackend 由 SslContext::setPrivateKeyOffload() 接入。上下文只需加载证书，
+ * 握手中的 RSA 签名 / 解密与 ECDSA 签名被编码为请求，经 Unix 域套接字发给签名进程
+ * （参考实现见 SslKeylessSigner 与 benchmark/keyless_signer）。
+ *
+ * 客户端持有一个 IO 线程与一条连接：各调度线程提交的请求先入队，IO 线程每轮把排队的请求
+ * 合并成一次写出（最多 maxBatch 个），响应以 id 匹配后唤醒对应的 async job，握手因此与
+ * 线程池卸载一样返回 WantAsync，SslSocket::handshake() 等待后自动继续。连接在首次请求时建立，断开后
+ * 在途运算以失败完成，下一次请求时重连。
+ *
+ * @note 客户端必须比挂接它的上下文与其上的连接活得更久；析构时在途运算以失败完成
+ */
+class SslKeylessClient : public SslKeyBackend
+{
+public:
+    /**
+     * @param socketPath 签名进程监听的 Unix 域套接字路径
+     */
+    explicit SslKeylessClient(std::string socketPath, SslKeylessOptions options = {});
+    ~SslKeylessClient() override;
+
+    SslKeylessClient(const SslKeylessClient&) = delete;
+    SslKeylessClient& operator=(const SslKeylessClient&) = delete;
+
+    /**
+     * @brief 以证书公钥（或私钥）生成由签名进程运算的密钥
+     * @param key RSA 或 EC 密钥，只用到公钥部分
+     * @return 新的 EVP_PKEY（调用者释放），不支持的密钥类型返回 kPrivateKeyLoadFailed
+     */
+    std::expected<EVP_PKEY*, SslError> wrap(EVP_PKEY* key) override;
+
+    /**
+     * @brief 提交一次私钥运算
+     *
+     * @param op 运算类型
+     * @param keyId 密钥 id，见 keylessKeyId()
+     * @param padding RSA 填充方式，ECDSA 忽略
+     * @param input 输入数据
+     * @param length 输入长度
+     * @param done 完成回调，在 IO 线程上调用且只调用一次
+     * @return false 表示在途请求已达上限或客户端正在析构，done 不会被调用
+     */
+    bool submit(SslKeylessOp op, const SslKeylessKeyId& keyId, int padding,
+                const unsigned char* input, size_t length, SslKeylessCallback done);
+
+    /**
+     * @brief 统计快照
+     */
+    SslKeylessStats stats() const;
+
+    const std::string& socketPath() const { return m_socketPath; }
+    const SslKeylessOptions& options() const { return m_options; }
+
+private:
+    struct Pending {
+        SslKeylessCallback done;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void ioLoop();
+    bool ensureConnected();
+    void disconnect();
+    void flushQueue();
+    void readResponses();
+    void expire(std::chrono::steady_clock::time_point now);
+    void completeAll(std::vector<Pending>& completions);
+
+    std::string m_socketPath;
+    SslKeylessOptions m_options;
+    int m_fd = -1;
+    int m_wakeRead = -1;
+    int m_wakeWrite = -1;
+    std::thread m_thread;
+
+    mutable std::mutex m_mutex;
+    bool m_stopping = false;
+    uint64_t m_nextId = 1;
+    std::deque<std::pair<uint64_t, std::vector<unsigned char>>> m_queue;  ///< 待写出的已编码请求
+    std::unordered_map<uint64_t, Pending> m_pending;                     ///< 含排队与在途的请求
+    uint64_t m_requests = 0;
+    uint64_t m_batches = 0;
+    uint64_t m_failures = 0;
+    uint64_t m_timeouts = 0;
+    uint64_t m_reconnects = 0;
+
+    // 以下只在 IO 线程访问
+    std::vector<unsigned char> m_output;
+    std::vector<unsigned char> m_input;
+};
+
+/**
+ * @brief 签名进程统计
+ */
+struct SslKeylessSignerStats {
+    uint64_t requests = 0;      ///< 处理的请求数
+    uint64_t batches = 0;       ///< 写出响应的批次数
+    uint64_t errors = 0;        ///< 未知密钥或运算失败的请求数
+    size_t connections = 0;     ///< 当前连接数
+};
+
+/**
+ * @brief 参考签名进程：持有私钥，在 Unix 域套接字上应答 SslKeylessClient 的请求
+ *
+ * @details 单线程事件循环：每轮读取各连接上所有到达的请求，逐个运算后把这一轮的响应合并成
+ * 一次写出。供测试与基准在进程内运行，也可由独立进程（benchmark/keyless_signer）承载。
+ */
+class SslKeylessSigner
+{
+public:
+    explicit SslKeylessSigner(std::string socketPath);
+    ~SslKeylessSigner();
+
+    SslKeylessSigner(const SslKeylessSigner&) = delete;
+    SslKeylessSigner& operator=(const SslKeylessSigner&) = delete;
+
+    /**
+     * @brief 加载一个私钥，按公钥计算的 id 登记
+     * @return 失败返回 kPrivateKeyLoadFailed
+     */
+    std::expected<void, SslError> addKey(const std::string& keyFile, SslFileType type = SslFileType::PEM);
+
+    /**
+     * @brief 绑定套接字（已存在的路径会被替换）并启动事件循环线程
+     */
+    std::expected<void, SslError> start();
+
+    /**
+     * @brief 停止事件循环，关闭所有连接并删除套接字文件
+     */
+    void stop();
+
+    /**
+     * @brief 统计快照
+     */
+    SslKeylessSignerStats stats() const;
+
+    const std::string& socketPath() const { return m_socketPath; }
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::vector<unsigned char> input;
+        std::vector<unsigned char> output;
+    };
+
+    void loop();
+    bool serve(Connection& conn);
+    void handleFrame(const unsigned char* body, size_t length, std::vector<unsigned char>& output);
+
+    std::string m_socketPath;
+    std::map<SslKeylessKeyId, EVP_PKEY*> m_keys;
+    int m_listenFd = -1;
+    int m_wakeRead = -1;
+    int m_wakeWrite = -1;
+    std::thread m_thread;
+
+    mutable std::mutex m_mutex;
+    uint64_t m_requests = 0;
+    uint64_t m_batches = 0;
+    uint64_t m_errors = 0;
+    size_t m_connections = 0;
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_KEYLESS_H
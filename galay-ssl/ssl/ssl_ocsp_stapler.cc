@@ -0,0 +1,452 @@
+#include "ssl_ocsp_stapler.h"
+#include <openssl/bn.h>
+#include <openssl/ocsp.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+namespace galay::ssl
+{
+
+namespace {
+
+constexpr long kValiditySkewSeconds = 300;
+
+/**
+ * @brief 证书的 SHA-1 指纹（OpenSSL 缓存在 X509 对象中）
+ */
+std::string certificateKey(X509* cert)
+{
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    if (X509_digest(cert, EVP_sha1(), digest, &length) != 1) {
+        return {};
+    }
+    return std::string(reinterpret_cast<const char*>(digest), length);
+}
+
+/**
+ * @brief 证书序列号的大写十六进制，与 openssl x509 -serial 的输出一致
+ */
+std::string serialHex(X509* cert)
+{
+    BIGNUM* bn = ASN1_INTEGER_to_BN(X509_get0_serialNumber(cert), nullptr);
+    char* hex = bn ? BN_bn2hex(bn) : nullptr;
+    std::string result = hex ? hex : "";
+    OPENSSL_free(hex);
+    BN_free(bn);
+    return result;
+}
+
+/**
+ * @brief 在证书链或上下文的证书库中查找签发者（引用计数加一）
+ */
+X509* findIssuer(SSL_CTX* ctx, X509* cert, STACK_OF(X509)* chain)
+{
+    for (int i = 0; chain && i < sk_X509_num(chain); ++i) {
+        X509* candidate = sk_X509_value(chain, i);
+        if (X509_check_issued(candidate, cert) == X509_V_OK) {
+            X509_up_ref(candidate);
+            return candidate;
+        }
+    }
+    if (X509_check_issued(cert, cert) == X509_V_OK) {
+        X509_up_ref(cert);
+        return cert;
+    }
+    X509* issuer = nullptr;
+    X509_STORE_CTX* store_ctx = X509_STORE_CTX_new();
+    if (store_ctx && X509_STORE_CTX_init(store_ctx, SSL_CTX_get_cert_store(ctx), cert, nullptr) == 1) {
+        if (X509_STORE_CTX_get1_issuer(&issuer, store_ctx, cert) != 1) {
+            issuer = nullptr;
+        }
+    }
+    X509_STORE_CTX_free(store_ctx);
+    return issuer;
+}
+
+/**
+ * @brief 上下文各证书槽位中的证书及其签发者
+ */
+struct CertificatePair {
+    X509* cert = nullptr;
+    X509* issuer = nullptr;
+};
+
+/**
+ * @brief 列出上下文中已加载的证书；找不到签发者时 issuer 为空。返回的证书与签发者引用计数已加一
+ */
+std::vector<CertificatePair> listCertificates(SSL_CTX* ctx)
+{
+    std::vector<CertificatePair> pairs;
+    for (long rc = SSL_CTX_set_current_cert(ctx, SSL_CERT_SET_FIRST); rc == 1;
+         rc = SSL_CTX_set_current_cert(ctx, SSL_CERT_SET_NEXT)) {
+        X509* cert = SSL_CTX_get0_certificate(ctx);
+        if (cert == nullptr) {
+            continue;
+        }
+        STACK_OF(X509)* chain = nullptr;
+        SSL_CTX_get0_chain_certs(ctx, &chain);
+        X509_up_ref(cert);
+        pairs.push_back({cert, findIssuer(ctx, cert, chain)});
+    }
+    return pairs;
+}
+
+void freePairs(std::vector<CertificatePair>& pairs)
+{
+    for (auto& pair : pairs) {
+        X509_free(pair.cert);
+        X509_free(pair.issuer);
+    }
+    pairs.clear();
+}
+
+} // namespace
+
+SslOcspStapler::SslOcspStapler(SslOcspStaplerOptions options)
+    : m_options(std::move(options))
+{
+}
+
+std::expected<std::shared_ptr<SslOcspStapler>, SslError> SslOcspStapler::create(SslOcspStaplerOptions options)
+{
+    if (!options.fetch && options.directory.empty()) {
+        return std::unexpected(SslError(SslErrorCode::kOcspFailed));
+    }
+    std::shared_ptr<SslOcspStapler> stapler(new SslOcspStapler(std::move(options)));
+    if (stapler->m_options.backgroundRefresh) {
+        stapler->m_thread = std::thread([raw = stapler.get()] { raw->refreshLoop(); });
+    }
+    return stapler;
+}
+
+SslOcspStapler::~SslOcspStapler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    for (auto& [key, entry] : m_entries) {
+        X509_free(entry.cert);
+        X509_free(entry.issuer);
+    }
+}
+
+std::expected<void, SslError> SslOcspStapler::attach(SSL_CTX* ctx)
+{
+    if (ctx == nullptr) {
+        return std::unexpected(SslError(SslErrorCode::kContextCreateFailed));
+    }
+    auto pairs = listCertificates(ctx);
+    const bool complete = !pairs.empty() &&
+                          std::all_of(pairs.begin(), pairs.end(), [](const auto& pair) { return pair.issuer; });
+    if (!complete) {
+        freePairs(pairs);
+        return std::unexpected(SslError(SslErrorCode::kOcspFailed));
+    }
+
+    std::vector<std::string> added;
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        for (auto& pair : pairs) {
+            std::string key = certificateKey(pair.cert);
+            auto [it, inserted] = m_entries.try_emplace(key);
+            ++it->second.users;
+            if (inserted) {
+                it->second.cert = std::exchange(pair.cert, nullptr);
+                it->second.issuer = std::exchange(pair.issuer, nullptr);
+                it->second.refreshAt = Clock::now();
+                added.push_back(std::move(key));
+            }
+        }
+    }
+    freePairs(pairs);
+
+    SSL_CTX_set_tlsext_status_cb(ctx, &SslOcspStapler::onStatusRequest);
+    SSL_CTX_set_tlsext_status_arg(ctx, this);
+
+    // 新证书先在调用线程上获取一次，首批握手即可附带响应
+    for (const auto& key : added) {
+        refreshEntry(key);
+    }
+    if (!added.empty()) {
+        wake();
+    }
+    return {};
+}
+
+void SslOcspStapler::detach(SSL_CTX* ctx)
+{
+    if (ctx == nullptr) {
+        return;
+    }
+    void* arg = nullptr;
+    SSL_CTX_get_tlsext_status_arg(ctx, &arg);
+    if (arg != this) {
+        return;
+    }
+    SSL_CTX_set_tlsext_status_cb(ctx, nullptr);
+    SSL_CTX_set_tlsext_status_arg(ctx, nullptr);
+
+    auto pairs = listCertificates(ctx);
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        for (const auto& pair : pairs) {
+            auto it = m_entries.find(certificateKey(pair.cert));
+            if (it == m_entries.end() || --it->second.users > 0) {
+                continue;
+            }
+            X509_free(it->second.cert);
+            X509_free(it->second.issuer);
+            m_entries.erase(it);
+        }
+    }
+    freePairs(pairs);
+}
+
+size_t SslOcspStapler::refresh(bool force)
+{
+    size_t refreshed = 0;
+    for (const auto& key : dueKeys(Clock::now(), force, nullptr)) {
+        if (refreshEntry(key)) {
+            ++refreshed;
+        }
+    }
+    return refreshed;
+}
+
+std::vector<unsigned char> SslOcspStapler::response(X509* cert) const
+{
+    const std::string key = certificateKey(cert);
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_entries.find(key);
+    if (it == m_entries.end() || !it->second.der || it->second.expires <= Clock::now()) {
+        return {};
+    }
+    return *it->second.der;
+}
+
+SslOcspStats SslOcspStapler::stats() const
+{
+    SslOcspStats result;
+    result.stapled = m_stapled.load(std::memory_order_relaxed);
+    result.unavailable = m_unavailable.load(std::memory_order_relaxed);
+    result.refreshes = m_refreshes.load(std::memory_order_relaxed);
+    result.refreshFailures = m_refreshFailures.load(std::memory_order_relaxed);
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    result.certificates = m_entries.size();
+    return result;
+}
+
+std::expected<SslOcspStapler::Fetched, SslError> SslOcspStapler::fetch(X509* cert, X509* issuer) const
+{
+    if (m_options.fetch) {
+        auto der = m_options.fetch(cert, issuer);
+        if (!der) {
+            return std::unexpected(der.error());
+        }
+        return validate(std::move(*der), cert, issuer);
+    }
+
+    const std::string serial = serialHex(cert);
+    std::ifstream file(m_options.directory + "/" + serial + ".der", std::ios::binary);
+    if (serial.empty() || !file) {
+        return std::unexpected(SslError(SslErrorCode::kOcspFailed));
+    }
+    std::vector<unsigned char> der((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return validate(std::move(der), cert, issuer);
+}
+
+std::expected<SslOcspStapler::Fetched, SslError> SslOcspStapler::validate(std::vector<unsigned char> der,
+                                                                         X509* cert,
+                                                                         X509* issuer) const
+{
+    const unsigned char* cursor = der.data();
+    OCSP_RESPONSE* response = d2i_OCSP_RESPONSE(nullptr, &cursor, static_cast<long>(der.size()));
+    OCSP_BASICRESP* basic = nullptr;
+    OCSP_CERTID* id = nullptr;
+    bool ok = response != nullptr && cursor == der.data() + der.size() &&
+              OCSP_response_status(response) == OCSP_RESPONSE_STATUS_SUCCESSFUL &&
+              (basic = OCSP_response_get1_basic(response)) != nullptr;
+
+    if (ok && m_options.verifySignature) {
+        // 签发者作为信任锚（可能是中间 CA），响应须由它或它授权的 OCSP 签名证书签名
+        STACK_OF(X509)* certs = sk_X509_new_null();
+        X509_STORE* store = X509_STORE_new();
+        ok = certs && store && sk_X509_push(certs, issuer) > 0 && X509_STORE_add_cert(store, issuer) == 1 &&
+             X509_STORE_set_flags(store, X509_V_FLAG_PARTIAL_CHAIN) == 1 &&
+             OCSP_basic_verify(basic, certs, store, 0) > 0;
+        X509_STORE_free(store);
+        sk_X509_free(certs);
+    }
+
+    int status = -1;
+    int reason = -1;
+    ASN1_GENERALIZEDTIME* revoked_at = nullptr;
+    ASN1_GENERALIZEDTIME* this_update = nullptr;
+    ASN1_GENERALIZEDTIME* next_update = nullptr;
+    ok = ok && (id = OCSP_cert_to_id(nullptr, cert, issuer)) != nullptr &&
+         OCSP_resp_find_status(basic, id, &status, &reason, &revoked_at, &this_update, &next_update) == 1 &&
+         status == V_OCSP_CERTSTATUS_GOOD &&
+         OCSP_check_validity(this_update, next_update, kValiditySkewSeconds, -1) == 1;
+
+    Fetched fetched;
+    if (ok) {
+        const auto now = Clock::now();
+        fetched.expires = now + m_options.defaultValidity;
+        int days = 0;
+        int seconds = 0;
+        if (next_update && ASN1_TIME_diff(&days, &seconds, nullptr, next_update) == 1) {
+            fetched.expires = now + std::chrono::seconds(static_cast<int64_t>(days) * 86400 + seconds);
+        }
+        fetched.der = std::make_shared<const std::vector<unsigned char>>(std::move(der));
+    }
+
+    OCSP_CERTID_free(id);
+    OCSP_BASICRESP_free(basic);
+    OCSP_RESPONSE_free(response);
+    ERR_clear_error();
+    if (!ok) {
+        return std::unexpected(SslError(SslErrorCode::kOcspFailed));
+    }
+    return fetched;
+}
+
+bool SslOcspStapler::refreshEntry(const std::string& key)
+{
+    X509* cert = nullptr;
+    X509* issuer = nullptr;
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it == m_entries.end() || it->second.refreshing) {
+            return false;
+        }
+        it->second.refreshing = true;
+        // 获取期间条目可能被 detach() 删除，先持有引用
+        cert = it->second.cert;
+        issuer = it->second.issuer;
+        X509_up_ref(cert);
+        X509_up_ref(issuer);
+    }
+
+    auto fetched = fetch(cert, issuer);
+    X509_free(cert);
+    X509_free(issuer);
+
+    const auto now = Clock::now();
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            Entry& entry = it->second;
+            entry.refreshing = false;
+            if (fetched) {
+                // 剩余有效期过半或到达 refreshMargin 时刷新，取较早者
+                const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(fetched->expires - now);
+                const auto wait = std::max(m_options.retryInterval,
+                                           std::min(remaining - m_options.refreshMargin, remaining / 2));
+                entry.der = std::move(fetched->der);
+                entry.expires = fetched->expires;
+                entry.refreshAt = now + wait;
+            } else {
+                entry.refreshAt = now + m_options.retryInterval;
+            }
+        }
+    }
+
+    if (!fetched) {
+        m_refreshFailures.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    m_refreshes.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::vector<std::string> SslOcspStapler::dueKeys(Clock::time_point now, bool force, Clock::time_point* next) const
+{
+    std::vector<std::string> keys;
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    for (const auto& [key, entry] : m_entries) {
+        if (entry.refreshing) {
+            continue;
+        }
+        if (force || entry.refreshAt <= now) {
+            keys.push_back(key);
+        } else if (next && entry.refreshAt < *next) {
+            *next = entry.refreshAt;
+        }
+    }
+    return keys;
+}
+
+void SslOcspStapler::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wake = true;
+    }
+    m_cv.notify_all();
+}
+
+void SslOcspStapler::refreshLoop()
+{
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    while (!m_stopping) {
+        const auto now = Clock::now();
+        auto next = now + m_options.defaultValidity;
+        const auto due = dueKeys(now, false, &next);
+        if (!due.empty()) {
+            lock.unlock();
+            for (const auto& key : due) {
+                refreshEntry(key);
+            }
+            lock.lock();
+            continue;
+        }
+        m_cv.wait_until(lock, next, [this] { return m_stopping || m_wake; });
+        m_wake = false;
+    }
+}
+
+int SslOcspStapler::onStatusRequest(SSL* ssl, void* arg)
+{
+    auto* self = static_cast<SslOcspStapler*>(arg);
+    X509* cert = self ? SSL_get_certificate(ssl) : nullptr;
+    if (cert == nullptr) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    const std::string key = certificateKey(cert);
+    std::shared_ptr<const std::vector<unsigned char>> der;
+    {
+        std::shared_lock<std::shared_mutex> lock(self->m_mutex);
+        auto it = self->m_entries.find(key);
+        if (it != self->m_entries.end() && it->second.expires > Clock::now()) {
+            der = it->second.der;
+        }
+    }
+    if (!der || der->empty()) {
+        self->m_unavailable.fetch_add(1, std::memory_order_relaxed);
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    // OpenSSL 接管这块内存并在连接释放时 OPENSSL_free
+    auto* copy = static_cast<unsigned char*>(OPENSSL_malloc(der->size()));
+    if (copy == nullptr) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    std::memcpy(copy, der->data(), der->size());
+    SSL_set_tlsext_status_ocsp_resp(ssl, copy, static_cast<long>(der->size()));
+    self->m_stapled.fetch_add(1, std::memory_order_relaxed);
+    return SSL_TLSEXT_ERR_OK;
+}
+
+} // namespace galay::ssl
@@ -0,0 +1,172 @@
+#ifndef GALAY_SSL_OCSP_STAPLER_H
+#define GALAY_SSL_OCSP_STAPLER_H
+
+#include "galay-ssl/common/defn.hpp"
+#include "galay-ssl/common/error.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief OCSP 响应来源：为 cert（签发者为 issuer）返回 DER 编码的 OCSPResponse
+ * @note 在刷新线程（或 attach() / refresh() 的调用线程）上调用，可以阻塞
+ */
+using SslOcspSource = std::function<std::expected<std::vector<unsigned char>, SslError>(X509* cert, X509* issuer)>;
+
+/**
+ * @brief OCSP stapling 配置
+ */
+struct SslOcspStaplerOptions {
+    std::string directory;                                  ///< 文件来源目录，响应文件名为证书序列号的大写十六进制加 .der
+    SslOcspSource fetch;                                    ///< 回调来源，非空时优先于 directory
+    std::chrono::milliseconds refreshMargin{std::chrono::hours(1)};   ///< 最晚在 nextUpdate 之前多久刷新（剩余有效期过半时也会刷新）
+    std::chrono::milliseconds retryInterval{std::chrono::minutes(1)}; ///< 获取失败后的重试间隔，也是两次刷新的最小间隔
+    std::chrono::milliseconds defaultValidity{std::chrono::hours(1)}; ///< 响应没有 nextUpdate 时的刷新周期
+    bool verifySignature = true;                            ///< 以签发者校验响应签名（签发者本身或其授权的 OCSP 签名证书）
+    bool backgroundRefresh = true;                          ///< 启动后台刷新线程，关闭时由调用方定期调用 refresh()
+};
+
+/**
+ * @brief OCSP stapling 统计
+ */
+struct SslOcspStats {
+    uint64_t stapled = 0;           ///< 附带了 OCSP 响应的握手数
+    uint64_t unavailable = 0;       ///< 客户端请求了状态但没有有效响应的握手数
+    uint64_t refreshes = 0;         ///< 成功获取并通过校验的响应数
+    uint64_t refreshFailures = 0;   ///< 获取失败或响应无效（过期、非 good、签名错误）的次数
+    size_t certificates = 0;        ///< 当前登记的证书数
+};
+
+/**
+ * @brief 服务端 OCSP stapling 与响应缓存
+ *
+ * @details 每张登记的证书（按 SHA-1 指纹去重）保存一份 DER 响应。响应来自 fetch 回调或
+ * directory 中的文件，取回后解析并检查：响应状态 successful、证书状态 good、
+ * thisUpdate / nextUpdate 有效，可选校验签名；不合格的响应不会替换现有响应。
+ * 后台线程在剩余有效期过半或 nextUpdate - refreshMargin（取较早者）时重新获取，
+ * 失败按 retryInterval 重试，旧响应在过期前继续使用。
+ *
+ * 握手路径只读缓存：客户端发送 status_request 时，状态回调按当前证书（双证书时为实际选中的证书）
+ * 查出响应附加到 CertificateStatus / TLS 1.3 Certificate 扩展中，不做任何网络或磁盘 IO；
+ * 没有有效响应时不附加，握手照常进行。
+ *
+ * @example
+ * @code
+ * auto stapler = SslOcspStapler::create({.directory = "/var/lib/galay/ocsp"});
+ * ctx.loadCertificateChain("server.crt");   // 证书链须包含签发者
+ * ctx.loadPrivateKey("server.key");
+ * ctx.setOcspStapler(*stapler);
+ * @endcode
+ *
+ * @note
+ * - 线程安全，多个上下文可以共享同一个 stapler，相同证书只获取一次
+ * - 证书的签发者从上下文的证书链中查找，自签名证书以自身为签发者
+ */
+class SslOcspStapler
+{
+public:
+    /**
+     * @brief 创建 stapler，按配置启动刷新线程
+     * @return 既没有 fetch 也没有 directory 时返回 kOcspFailed
+     */
+    static std::expected<std::shared_ptr<SslOcspStapler>, SslError> create(SslOcspStaplerOptions options);
+
+    ~SslOcspStapler();
+
+    SslOcspStapler(const SslOcspStapler&) = delete;
+    SslOcspStapler& operator=(const SslOcspStapler&) = delete;
+
+    /**
+     * @brief 登记上下文中已加载的所有证书并安装状态回调（由 SslContext::setOcspStapler() 调用）
+     *
+     * @details 新登记的证书在调用线程上立即获取一次响应；获取失败不影响登记，由刷新线程重试。
+     * @return 上下文没有证书或找不到证书的签发者时返回 kOcspFailed
+     */
+    std::expected<void, SslError> attach(SSL_CTX* ctx);
+
+    /**
+     * @brief 撤销 attach() 的登记与状态回调，证书不再被任何上下文使用时停止刷新
+     */
+    void detach(SSL_CTX* ctx);
+
+    /**
+     * @brief 立即刷新到期的证书
+     * @param force 为 true 时刷新所有证书
+     * @return 本次成功刷新的证书数
+     */
+    size_t refresh(bool force = false);
+
+    /**
+     * @brief 证书当前缓存的 DER 响应
+     * @return 没有有效响应时返回空
+     */
+    std::vector<unsigned char> response(X509* cert) const;
+
+    /**
+     * @brief 统计快照
+     */
+    SslOcspStats stats() const;
+
+    const SslOcspStaplerOptions& options() const { return m_options; }
+
+private:
+    using Clock = std::chrono::system_clock;
+
+    struct Entry {
+        X509* cert = nullptr;
+        X509* issuer = nullptr;
+        size_t users = 0;                                   ///< 登记该证书的上下文数
+        std::shared_ptr<const std::vector<unsigned char>> der;
+        Clock::time_point expires{};                        ///< 缓存响应的 nextUpdate
+        Clock::time_point refreshAt{};                      ///< 下一次获取的时间
+        bool refreshing = false;                            ///< 正在某个线程上获取
+    };
+
+    /**
+     * @brief 一次通过校验的获取结果
+     */
+    struct Fetched {
+        std::shared_ptr<const std::vector<unsigned char>> der;
+        Clock::time_point expires{};
+    };
+
+    explicit SslOcspStapler(SslOcspStaplerOptions options);
+
+    std::expected<Fetched, SslError> fetch(X509* cert, X509* issuer) const;
+    std::expected<Fetched, SslError> validate(std::vector<unsigned char> der, X509* cert, X509* issuer) const;
+    bool refreshEntry(const std::string& key);
+    std::vector<std::string> dueKeys(Clock::time_point now, bool force, Clock::time_point* next) const;
+    void wake();
+    void refreshLoop();
+    static int onStatusRequest(SSL* ssl, void* arg);
+
+    SslOcspStaplerOptions m_options;
+    mutable std::shared_mutex m_mutex;                      ///< 保护 m_entries
+    std::unordered_map<std::string, Entry> m_entries;       ///< 键为证书 SHA-1 指纹
+    std::thread m_thread;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_cv;
+    bool m_stopping = false;
+    bool m_wake = false;                                    ///< 有新登记的证书，重新计算等待时间
+    std::atomic<uint64_t> m_stapled{0};
+    std::atomic<uint64_t> m_unavailable{0};
+    std::atomic<uint64_t> m_refreshes{0};
+    std::atomic<uint64_t> m_refreshFailures{0};
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_OCSP_STAPLER_H
@@ -0,0 +1,143 @@
+#include "ssl_psk_store.h"
+#include <openssl/crypto.h>
+#include <mutex>
+#include <utility>
+
+namespace galay::ssl
+{
+
+namespace {
+
+/**
+ * @brief 按标准名称查找本机支持的 TLS 1.3 套件；表项为静态对象，指针长期有效
+ */
+const SSL_CIPHER* findTls13Cipher(const std::string& name)
+{
+    if (name.empty() || name.find(':') != std::string::npos) {
+        return nullptr;
+    }
+    SSL_CTX* ctx = SSL_CTX_new(TLS_method());
+    if (ctx == nullptr) {
+        return nullptr;
+    }
+    const SSL_CIPHER* found = nullptr;
+    if (SSL_CTX_set_ciphersuites(ctx, name.c_str()) == 1) {
+        STACK_OF(SSL_CIPHER)* ciphers = SSL_CTX_get_ciphers(ctx);
+        for (int i = 0; found == nullptr && i < sk_SSL_CIPHER_num(ciphers); ++i) {
+            const SSL_CIPHER* cipher = sk_SSL_CIPHER_value(ciphers, i);
+            if (name == SSL_CIPHER_get_name(cipher)) {
+                found = cipher;
+            }
+        }
+    }
+    SSL_CTX_free(ctx);
+    ERR_clear_error();
+    return found;
+}
+
+void cleanse(std::vector<unsigned char>& key)
+{
+    if (!key.empty()) {
+        OPENSSL_cleanse(key.data(), key.size());
+    }
+}
+
+} // anonymous namespace
+
+SslPskStore::SslPskStore(SslPskStoreOptions options, const SSL_CIPHER* cipher)
+    : m_options(std::move(options))
+    , m_cipher(cipher)
+{
+}
+
+SslPskStore::~SslPskStore()
+{
+    for (auto& [identity, key] : m_keys) {
+        cleanse(key);
+    }
+}
+
+std::expected<std::shared_ptr<SslPskStore>, SslError> SslPskStore::create(SslPskStoreOptions options)
+{
+    const SSL_CIPHER* cipher = findTls13Cipher(options.cipherSuite);
+    if (cipher == nullptr) {
+        return std::unexpected(SslError(SslErrorCode::kPskConfigFailed));
+    }
+    return std::shared_ptr<SslPskStore>(new SslPskStore(std::move(options), cipher));
+}
+
+std::expected<void, SslError> SslPskStore::add(std::string identity, std::vector<unsigned char> key)
+{
+    if (identity.empty() || key.size() < kMinKeySize || key.size() > kMaxKeySize) {
+        cleanse(key);
+        return std::unexpected(SslError(SslErrorCode::kPskConfigFailed));
+    }
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_keys.try_emplace(std::move(identity)).first;
+    cleanse(it->second);
+    it->second = std::move(key);
+    return {};
+}
+
+bool SslPskStore::remove(std::string_view identity)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_keys.find(identity);
+    if (it == m_keys.end()) {
+        return false;
+    }
+    cleanse(it->second);
+    m_keys.erase(it);
+    return true;
+}
+
+size_t SslPskStore::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_keys.size();
+}
+
+SSL_SESSION* SslPskStore::newSession(std::string_view identity)
+{
+    SSL_SESSION* session = SSL_SESSION_new();
+    if (session == nullptr) {
+        return nullptr;
+    }
+    bool ok = false;
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        if (auto it = m_keys.find(identity); it != m_keys.end()) {
+            ok = SSL_SESSION_set1_master_key(session, it->second.data(), it->second.size()) == 1;
+            m_found.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!ok && m_options.lookup) {
+        if (auto key = m_options.lookup(identity)) {
+            if (key->size() >= kMinKeySize && key->size() <= kMaxKeySize) {
+                ok = SSL_SESSION_set1_master_key(session, key->data(), key->size()) == 1;
+                m_resolved.fetch_add(1, std::memory_order_relaxed);
+            }
+            cleanse(*key);
+        }
+    }
+    ok = ok && SSL_SESSION_set_cipher(session, m_cipher) == 1 &&
+         SSL_SESSION_set_protocol_version(session, TLS1_3_VERSION) == 1;
+    if (!ok) {
+        m_unknown.fetch_add(1, std::memory_order_relaxed);
+        SSL_SESSION_free(session);
+        return nullptr;
+    }
+    return session;
+}
+
+SslPskStats SslPskStore::stats() const
+{
+    SslPskStats result;
+    result.found = m_found.load(std::memory_order_relaxed);
+    result.resolved = m_resolved.load(std::memory_order_relaxed);
+    result.unknown = m_unknown.load(std::memory_order_relaxed);
+    result.keys = size();
+    return result;
+}
+
+} // namespace galay::ssl
@@ -0,0 +1,148 @@
+#ifndef GALAY_SSL_PSK_STORE_H
+#define GALAY_SSL_PSK_STORE_H
+
+#include "galay-ssl/common/defn.hpp"
+#include "galay-ssl/common/error.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief TLS 1.3 外部 PSK 的密钥交换模式（RFC 8446 psk_key_exchange_modes）
+ */
+enum class SslPskMode {
+    PskDheKe,   ///< psk_dhe_ke：PSK 认证加 ECDHE，保留前向保密
+    PskKe,      ///< psk_ke：只由 PSK 派生密钥，省去 ECDHE，没有前向保密
+};
+
+/**
+ * @brief 按身份解析 PSK，返回空表示未知身份
+ * @note 在握手线程上调用，不应阻塞
+ */
+using SslPskLookup = std::function<std::optional<std::vector<unsigned char>>(std::string_view identity)>;
+
+/**
+ * @brief PSK 存储配置
+ */
+struct SslPskStoreOptions {
+    std::string cipherSuite = "TLS_AES_128_GCM_SHA256"; ///< PSK 绑定的 TLS 1.3 套件，其哈希用于 binder 与密钥派生
+    std::string clientIdentity;                         ///< 作为客户端时发送的身份，空表示只用于服务端
+    SslPskLookup lookup;                                ///< 哈希表中没有该身份时调用，结果不写回哈希表
+};
+
+/**
+ * @brief PSK 统计
+ */
+struct SslPskStats {
+    uint64_t found = 0;     ///< 在哈希表中找到身份的次数
+    uint64_t resolved = 0;  ///< 由 lookup 回调解析出密钥的次数
+    uint64_t unknown = 0;   ///< 身份未知、回退到证书握手（或失败）的次数
+    size_t keys = 0;        ///< 哈希表中的身份数
+};
+
+/**
+ * @brief TLS 1.3 外部预共享密钥（RFC 8446 §2.2 external PSK）存储
+ *
+ * @details 以身份为键保存预先分发的对称密钥。SslContext::setPreSharedKeys() 挂接后：
+ * - 服务端按客户端发送的身份在哈希表（其次是 lookup 回调）中查找密钥，找到且 binder 校验通过时
+ *   以 PSK 完成认证，不发送证书、不做签名；找不到时回退到证书握手（没有证书时握手失败）
+ * - 客户端发送 clientIdentity 对应的 PSK，服务端接受后不再验证服务端证书链
+ *
+ * 服务间内部链路用它代替证书认证，完整握手省去证书链的传输、解析、验证与签名运算；
+ * 选择 SslPskMode::PskKe 时还省去 ECDHE。
+ *
+ * @example
+ * @code
+ * auto psk = SslPskStore::create({.clientIdentity = "billing"});
+ * (*psk)->add("billing", secret);                    // 两端分发同一份 32 字节随机密钥
+ * serverCtx.setPreSharedKeys(*psk, SslPskMode::PskKe);
+ * clientCtx.setPreSharedKeys(*psk, SslPskMode::PskKe);
+ * @endcode
+ *
+ * @note
+ * - 线程安全，add() / remove() 可以与握手并发，多个上下文可以共享一个存储
+ * - 密钥应为至少 16 字节的高熵随机数；同一密钥不要同时用于其他协议
+ */
+class SslPskStore
+{
+public:
+    static constexpr size_t kMinKeySize = 16;
+    static constexpr size_t kMaxKeySize = SSL_MAX_MASTER_KEY_LENGTH;
+
+    /**
+     * @brief 创建存储
+     * @return cipherSuite 不是本机 OpenSSL 支持的单个 TLS 1.3 套件时返回 kPskConfigFailed
+     */
+    static std::expected<std::shared_ptr<SslPskStore>, SslError> create(SslPskStoreOptions options = {});
+
+    ~SslPskStore();
+
+    SslPskStore(const SslPskStore&) = delete;
+    SslPskStore& operator=(const SslPskStore&) = delete;
+
+    /**
+     * @brief 添加或替换身份的密钥
+     * @return 身份为空或密钥长度不在 [kMinKeySize, kMaxKeySize] 内时返回 kPskConfigFailed
+     */
+    std::expected<void, SslError> add(std::string identity, std::vector<unsigned char> key);
+
+    /**
+     * @brief 删除身份，返回是否存在
+     */
+    bool remove(std::string_view identity);
+
+    /**
+     * @brief 哈希表中的身份数
+     */
+    size_t size() const;
+
+    /**
+     * @brief 为身份创建 PSK 会话（由 PSK 回调调用）
+     * @return 归调用方所有的 SSL_SESSION；未知身份返回 nullptr
+     */
+    SSL_SESSION* newSession(std::string_view identity);
+
+    /**
+     * @brief PSK 绑定的 TLS 1.3 套件
+     */
+    const SSL_CIPHER* cipher() const { return m_cipher; }
+
+    /**
+     * @brief 获取统计快照
+     */
+    SslPskStats stats() const;
+
+    const SslPskStoreOptions& options() const { return m_options; }
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+    };
+
+    SslPskStore(SslPskStoreOptions options, const SSL_CIPHER* cipher);
+
+    SslPskStoreOptions m_options;
+    const SSL_CIPHER* m_cipher;
+    mutable std::shared_mutex m_mutex;          ///< 保护 m_keys
+    std::unordered_map<std::string, std::vector<unsigned char>, Hash, std::equal_to<>> m_keys;
+    std::atomic<uint64_t> m_found{0};
+    std::atomic<uint64_t> m_resolved{0};
+    std::atomic<uint64_t> m_unknown{0};
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_PSK_STORE_H
@@ -0,0 +1,174 @@
+#include "ssl_session_cache.h"
+#include <algorithm>
+#include <ctime>
+
+namespace galay::ssl
+{
+
+namespace {
+
+size_t roundUpPow2(size_t value)
+{
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+bool isExpired(const SSL_SESSION* session, time_t now)
+{
+    const long timeout = SSL_SESSION_get_timeout(session);
+    if (timeout <= 0) {
+        return false;
+    }
+    return SSL_SESSION_get_time(session) + timeout <= now;
+}
+
+} // anonymous namespace
+
+SslSessionCache::SslSessionCache(SslSessionCacheOptions options)
+{
+    const size_t shards = roundUpPow2(std::max<size_t>(1, options.shards));
+    m_shards.reserve(shards);
+    for (size_t i = 0; i < shards; ++i) {
+        m_shards.push_back(std::make_unique<Shard>());
+    }
+    m_shardMask = shards - 1;
+    m_shardCapacity = std::max<size_t>(1, (options.capacity + shards - 1) / shards);
+}
+
+SslSessionCache::~SslSessionCache()
+{
+    clear();
+}
+
+SslSessionCache::Shard& SslSessionCache::shardFor(const unsigned char* id, size_t length)
+{
+    // session id 由 OpenSSL 随机生成，取前 8 字节即可均匀分布
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < std::min<size_t>(length, 8); ++i) {
+        hash = (hash ^ id[i]) * 1099511628211ULL;
+    }
+    return *m_shards[static_cast<size_t>(hash) & m_shardMask];
+}
+
+void SslSessionCache::dropLocked(Shard& shard, std::unordered_map<std::string, Entry>::iterator it)
+{
+    SSL_SESSION_free(it->second.session);
+    shard.lru.erase(it->second.lru);
+    shard.entries.erase(it);
+}
+
+bool SslSessionCache::store(const unsigned char* id, size_t length, SSL_SESSION* session)
+{
+    if (id == nullptr || length == 0 || session == nullptr) {
+        return false;
+    }
+
+    std::string key(reinterpret_cast<const char*>(id), length);
+    Shard& shard = shardFor(id, length);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        dropLocked(shard, it);
+    }
+
+    while (shard.entries.size() >= m_shardCapacity && !shard.lru.empty()) {
+        dropLocked(shard, shard.entries.find(shard.lru.back()));
+        ++shard.evictions;
+    }
+
+    SSL_SESSION_up_ref(session);
+    shard.lru.push_front(key);
+    shard.entries.emplace(std::move(key), Entry{session, shard.lru.begin()});
+    ++shard.inserts;
+    return true;
+}
+
+SSL_SESSION* SslSessionCache::load(const unsigned char* id, size_t length)
+{
+    if (id == nullptr || length == 0) {
+        return nullptr;
+    }
+
+    const std::string key(reinterpret_cast<const char*>(id), length);
+    Shard& shard = shardFor(id, length);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+        ++shard.misses;
+        return nullptr;
+    }
+    if (isExpired(it->second.session, std::time(nullptr))) {
+        dropLocked(shard, it);
+        ++shard.expired;
+        ++shard.misses;
+        return nullptr;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+    ++shard.hits;
+    // 在锁内加引用，避免返回后被并发淘汰释放
+    SSL_SESSION_up_ref(it->second.session);
+    return it->second.session;
+}
+
+void SslSessionCache::erase(const unsigned char* id, size_t length)
+{
+    if (id == nullptr || length == 0) {
+        return;
+    }
+
+    const std::string key(reinterpret_cast<const char*>(id), length);
+    Shard& shard = shardFor(id, length);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        dropLocked(shard, it);
+        ++shard.removals;
+    }
+}
+
+void SslSessionCache::clear()
+{
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (auto& [key, entry] : shard->entries) {
+            SSL_SESSION_free(entry.session);
+        }
+        shard->entries.clear();
+        shard->lru.clear();
+    }
+}
+
+size_t SslSessionCache::size() const
+{
+    size_t total = 0;
+    for (const auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->entries.size();
+    }
+    return total;
+}
+
+SslSessionCacheStats SslSessionCache::stats() const
+{
+    SslSessionCacheStats result;
+    for (const auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        result.hits += shard->hits;
+        result.misses += shard->misses;
+        result.inserts += shard->inserts;
+        result.evictions += shard->evictions;
+        result.expired += shard->expired;
+        result.removals += shard->removals;
+        result.size += shard->entries.size();
+    }
+    return result;
+}
+
+} // namespace galay::ssl
@@ -0,0 +1,156 @@
+#ifndef GALAY_SSL_SESSION_CACHE_H
+#define GALAY_SSL_SESSION_CACHE_H
+
+#include "galay-ssl/common/defn.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 服务端 Session 存储统计
+ */
+struct SslSessionCacheStats {
+    uint64_t hits = 0;          ///< 命中次数
+    uint64_t misses = 0;        ///< 未命中次数（含已过期）
+    uint64_t inserts = 0;       ///< 新增 session 次数
+    uint64_t evictions = 0;     ///< 因容量淘汰的次数
+    uint64_t expired = 0;       ///< 查找时发现已过期而删除的次数
+    uint64_t removals = 0;      ///< OpenSSL 主动移除的次数
+    uint64_t rejected = 0;      ///< 未能写入的次数（session 过大或槽位正被占用）
+    size_t size = 0;            ///< 当前条目数
+};
+
+/**
+ * @brief 服务端 Session 存储接口
+ *
+ * @details 由 SslContext::setSessionCache() 通过 OpenSSL 的 new/get/remove session 回调接入，
+ * 替代 SSL_CTX 内置的单锁 session cache。实现必须线程安全：同一个存储可以同时挂到多个
+ * SslContext（多个 worker / scheduler）上。
+ */
+class SslSessionStore
+{
+public:
+    virtual ~SslSessionStore() = default;
+
+    /**
+     * @brief 保存 session
+     * @param id session id
+     * @param length session id 长度
+     * @param session OpenSSL session，实现自行决定持有引用或序列化
+     * @return 是否保存成功
+     */
+    virtual bool store(const unsigned char* id, size_t length, SSL_SESSION* session) = 0;
+
+    /**
+     * @brief 查找 session
+     * @return 命中时返回调用方持有一个引用的 SSL_SESSION，未命中返回 nullptr
+     */
+    virtual SSL_SESSION* load(const unsigned char* id, size_t length) = 0;
+
+    /**
+     * @brief 移除 session
+     */
+    virtual void erase(const unsigned char* id, size_t length) = 0;
+
+    /**
+     * @brief 获取统计快照
+     */
+    virtual SslSessionCacheStats stats() const = 0;
+};
+
+/**
+ * @brief 分片 Session 缓存配置
+ */
+struct SslSessionCacheOptions {
+    size_t capacity = 20480;    ///< 总容量（条目数），按分片均分
+    size_t shards = 16;         ///< 分片数（锁条带数），会向上取整为 2 的幂
+};
+
+/**
+ * @brief 进程内分片 Session 缓存
+ *
+ * @details 按 session id 哈希分到多个分片，每个分片独立加锁并维护自己的 LRU，
+ * 多个 worker 线程并发握手时只会在同一分片上竞争。条目直接持有 SSL_SESSION 引用，
+ * 命中时不需要反序列化。
+ *
+ * @example
+ * @code
+ * auto cache = std::make_shared<SslSessionCache>(SslSessionCacheOptions{.capacity = 100000});
+ * for (auto& worker : workers) {
+ *     worker.ctx->setSessionCache(cache);   // 所有 worker 共享同一个缓存
+ * }
+ * @endcode
+ *
+ * @note 过期时间沿用 session 自身的 timeout（SslContext::setSessionTimeout()）
+ */
+class SslSessionCache : public SslSessionStore
+{
+public:
+    explicit SslSessionCache(SslSessionCacheOptions options = {});
+    ~SslSessionCache() override;
+
+    SslSessionCache(const SslSessionCache&) = delete;
+    SslSessionCache& operator=(const SslSessionCache&) = delete;
+
+    bool store(const unsigned char* id, size_t length, SSL_SESSION* session) override;
+    SSL_SESSION* load(const unsigned char* id, size_t length) override;
+    void erase(const unsigned char* id, size_t length) override;
+    SslSessionCacheStats stats() const override;
+
+    /**
+     * @brief 清空所有分片
+     */
+    void clear();
+
+    /**
+     * @brief 当前条目数
+     */
+    size_t size() const;
+
+    /**
+     * @brief 分片数
+     */
+    size_t shardCount() const { return m_shards.size(); }
+
+    /**
+     * @brief 单个分片容量
+     */
+    size_t shardCapacity() const { return m_shardCapacity; }
+
+private:
+    struct Entry {
+        SSL_SESSION* session = nullptr;
+        std::list<std::string>::iterator lru;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::list<std::string> lru;     ///< 头部为最近使用
+        std::unordered_map<std::string, Entry> entries;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t inserts = 0;
+        uint64_t evictions = 0;
+        uint64_t expired = 0;
+        uint64_t removals = 0;
+    };
+
+    Shard& shardFor(const unsigned char* id, size_t length);
+    static void dropLocked(Shard& shard, std::unordered_map<std::string, Entry>::iterator it);
+
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    size_t m_shardMask = 0;
+    size_t m_shardCapacity = 0;
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_SESSION_CACHE_H
@@ -0,0 +1,376 @@
+#include "ssl_shm_session_cache.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace galay::ssl
+{
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared-memory seqlock requires lock-free 32-bit atomics");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory counters require lock-free 64-bit atomics");
+
+namespace {
+
+constexpr uint64_t kShmMagic = 0x47414c4159534553ULL;   // "GALAYSES"
+constexpr uint32_t kShmVersion = 1;
+constexpr int kReadRetries = 8;
+constexpr int kLockSpins = 64;
+constexpr int kStoreAttempts = 2;     // 加锁后发现槽已被其他进程占用时重新选槽的次数
+
+size_t roundUpPow2(size_t value)
+{
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+constexpr size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // anonymous namespace
+
+struct alignas(64) SslShmSessionCache::Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotStride;
+    uint32_t maxSessionBytes;
+    uint32_t probe;
+    uint32_t reserved;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> inserts;
+    std::atomic<uint64_t> evictions;
+    std::atomic<uint64_t> expired;
+    std::atomic<uint64_t> removals;
+    std::atomic<uint64_t> rejected;
+};
+
+struct alignas(64) SslShmSessionCache::Slot {
+    std::atomic<uint32_t> seq;          ///< 奇数表示写者持有
+    std::atomic<uint32_t> idLength;     ///< 0 表示空槽
+    std::atomic<uint32_t> derLength;
+    uint32_t reserved;
+    std::atomic<int64_t> expiresAt;
+    unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+
+    unsigned char* der() { return reinterpret_cast<unsigned char*>(this) + sizeof(Slot); }
+};
+
+std::expected<std::shared_ptr<SslShmSessionCache>, SslError> SslShmSessionCache::open(
+    const std::string& path,
+    SslShmSessionCacheOptions options)
+{
+    const size_t slots = roundUpPow2(std::max<size_t>(1, options.slots));
+    const size_t stride = alignUp(sizeof(Slot) + std::max<size_t>(1, options.maxSessionBytes), 64);
+    const size_t probe = std::clamp<size_t>(options.probe, 1, slots);
+    const size_t total = sizeof(Header) + slots * stride;
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return std::unexpected(SslError(SslErrorCode::kSessionCacheFailed));
+    }
+
+    // 文件锁只用于串行化初始化，映射建立后立即释放
+    auto fail = [fd]() {
+        ::flock(fd, LOCK_UN);
+        ::close(fd);
+        return std::unexpected(SslError(SslErrorCode::kSessionCacheFailed));
+    };
+    if (::flock(fd, LOCK_EX) != 0) {
+        return fail();
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        return fail();
+    }
+    // 持锁时 magic 仍为 0 说明创建者在写完头部前退出，没有进程映射过它，按新文件重新初始化
+    uint64_t magic = 0;
+    const bool fresh = st.st_size == 0 ||
+                       (static_cast<size_t>(st.st_size) >= sizeof(magic) &&
+                        ::pread(fd, &magic, sizeof(magic), offsetof(Header, magic)) == sizeof(magic) && magic == 0);
+    if (fresh) {
+        if (::ftruncate(fd, 0) != 0 || ::ftruncate(fd, static_cast<off_t>(total)) != 0) {
+            return fail();
+        }
+    } else if (static_cast<size_t>(st.st_size) != total) {
+        return fail();
+    }
+
+    void* base = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        return fail();
+    }
+
+    auto* header = static_cast<Header*>(base);
+    if (fresh) {
+        // ftruncate 保证全零，零值即合法的原子对象初值
+        header->version = kShmVersion;
+        header->slotCount = static_cast<uint32_t>(slots);
+        header->slotStride = static_cast<uint32_t>(stride);
+        header->maxSessionBytes = static_cast<uint32_t>(stride - sizeof(Slot));
+        header->probe = static_cast<uint32_t>(probe);
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = kShmMagic;
+    } else if (header->magic != kShmMagic || header->version != kShmVersion ||
+               header->slotCount != slots || header->slotStride != stride ||
+               header->probe != probe) {
+        ::munmap(base, total);
+        return fail();
+    }
+
+    ::flock(fd, LOCK_UN);
+    ::close(fd);
+    return std::shared_ptr<SslShmSessionCache>(new SslShmSessionCache(path, base, total));
+}
+
+SslShmSessionCache::SslShmSessionCache(std::string path, void* base, size_t mappedBytes)
+    : m_path(std::move(path))
+    , m_base(base)
+    , m_mappedBytes(mappedBytes)
+    , m_header(static_cast<Header*>(base))
+{}
+
+SslShmSessionCache::~SslShmSessionCache()
+{
+    if (m_base) {
+        ::munmap(m_base, m_mappedBytes);
+        m_base = nullptr;
+    }
+}
+
+size_t SslShmSessionCache::slotCount() const
+{
+    return m_header->slotCount;
+}
+
+SslShmSessionCache::Slot* SslShmSessionCache::slotAt(size_t index) const
+{
+    auto* first = static_cast<unsigned char*>(m_base) + sizeof(Header);
+    return reinterpret_cast<Slot*>(first + (index & (m_header->slotCount - 1)) * m_header->slotStride);
+}
+
+size_t SslShmSessionCache::homeIndex(const unsigned char* id, size_t length) const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ id[i]) * 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+}
+
+bool SslShmSessionCache::lockSlot(Slot* slot) const
+{
+    for (int i = 0; i < kLockSpins; ++i) {
+        uint32_t seq = slot->seq.load(std::memory_order_relaxed);
+        if ((seq & 1U) == 0 &&
+            slot->seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            // seqlock 写端：奇数 seq 必须先于随后的数据写入对读端可见
+            std::atomic_thread_fence(std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+void SslShmSessionCache::unlockSlot(Slot* slot)
+{
+    slot->seq.fetch_add(1, std::memory_order_release);
+}
+
+bool SslShmSessionCache::store(const unsigned char* id, size_t length, SSL_SESSION* session)
+{
+    if (id == nullptr || length == 0 || length > SSL_MAX_SSL_SESSION_ID_LENGTH || session == nullptr) {
+        return false;
+    }
+
+    const int derLength = i2d_SSL_SESSION(session, nullptr);
+    if (derLength <= 0 || static_cast<size_t>(derLength) > m_header->maxSessionBytes) {
+        m_header->rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const int64_t now = static_cast<int64_t>(std::time(nullptr));
+    const long timeout = SSL_SESSION_get_timeout(session);
+    const int64_t expiresAt = static_cast<int64_t>(SSL_SESSION_get_time(session)) + (timeout > 0 ? timeout : 300);
+
+    const size_t home = homeIndex(id, length);
+    for (int attempt = 0; attempt < kStoreAttempts; ++attempt) {
+        // 选槽：同 id > 空槽/过期槽 > 探测范围内最早过期的槽
+        Slot* target = nullptr;
+        bool evicting = false;
+        int64_t oldest = INT64_MAX;
+        Slot* victim = nullptr;
+        for (size_t i = 0; i < m_header->probe; ++i) {
+            Slot* slot = slotAt(home + i);
+            const uint32_t slotIdLength = slot->idLength.load(std::memory_order_relaxed);
+            const int64_t slotExpires = slot->expiresAt.load(std::memory_order_relaxed);
+            if (slotIdLength == length && std::memcmp(slot->id, id, length) == 0) {
+                target = slot;
+                break;
+            }
+            if (target == nullptr && (slotIdLength == 0 || slotExpires <= now)) {
+                target = slot;
+            }
+            if (slotExpires < oldest) {
+                oldest = slotExpires;
+                victim = slot;
+            }
+        }
+        if (target == nullptr) {
+            target = victim;
+            evicting = true;
+        }
+        if (target == nullptr || !lockSlot(target)) {
+            break;
+        }
+
+        // 加锁后再确认一次：选槽时的读取未加锁，其他进程可能已把该槽写成另一个未过期的 session
+        const uint32_t lockedIdLength = target->idLength.load(std::memory_order_relaxed);
+        const int64_t lockedExpires = target->expiresAt.load(std::memory_order_relaxed);
+        const bool same = lockedIdLength == length && std::memcmp(target->id, id, length) == 0;
+        const bool reusable = lockedIdLength == 0 || lockedExpires <= now;
+        if (!same && !reusable && !(evicting && lockedExpires == oldest)) {
+            unlockSlot(target);
+            continue;
+        }
+
+        unsigned char* out = target->der();
+        i2d_SSL_SESSION(session, &out);
+        std::memcpy(target->id, id, length);
+        target->derLength.store(static_cast<uint32_t>(derLength), std::memory_order_relaxed);
+        target->expiresAt.store(expiresAt, std::memory_order_relaxed);
+        target->idLength.store(static_cast<uint32_t>(length), std::memory_order_relaxed);
+        unlockSlot(target);
+
+        m_header->inserts.fetch_add(1, std::memory_order_relaxed);
+        if (evicting && !same && !reusable) {
+            m_header->evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    m_header->rejected.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+SSL_SESSION* SslShmSessionCache::load(const unsigned char* id, size_t length)
+{
+    if (id == nullptr || length == 0 || length > SSL_MAX_SSL_SESSION_ID_LENGTH) {
+        return nullptr;
+    }
+
+    const int64_t now = static_cast<int64_t>(std::time(nullptr));
+    const size_t home = homeIndex(id, length);
+    std::vector<unsigned char> der;
+
+    for (size_t i = 0; i < m_header->probe; ++i) {
+        Slot* slot = slotAt(home + i);
+        for (int attempt = 0; attempt < kReadRetries; ++attempt) {
+            const uint32_t before = slot->seq.load(std::memory_order_acquire);
+            if ((before & 1U) != 0) {
+                continue;
+            }
+
+            const uint32_t slotIdLength = slot->idLength.load(std::memory_order_relaxed);
+            bool matched = slotIdLength == length && std::memcmp(slot->id, id, length) == 0;
+            const uint32_t derLength = slot->derLength.load(std::memory_order_relaxed);
+            const int64_t expiresAt = slot->expiresAt.load(std::memory_order_relaxed);
+            if (matched && derLength > 0 && derLength <= m_header->maxSessionBytes) {
+                der.assign(slot->der(), slot->der() + derLength);
+            } else {
+                matched = false;
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->seq.load(std::memory_order_relaxed) != before) {
+                continue;   // 读期间被改写，重读
+            }
+            if (!matched) {
+                break;
+            }
+            if (expiresAt <= now) {
+                m_header->expired.fetch_add(1, std::memory_order_relaxed);
+                m_header->misses.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            const unsigned char* in = der.data();
+            SSL_SESSION* session = d2i_SSL_SESSION(nullptr, &in, static_cast<long>(der.size()));
+            if (session == nullptr) {
+                break;
+            }
+            m_header->hits.fetch_add(1, std::memory_order_relaxed);
+            return session;
+        }
+    }
+
+    m_header->misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+void SslShmSessionCache::erase(const unsigned char* id, size_t length)
+{
+    if (id == nullptr || length == 0 || length > SSL_MAX_SSL_SESSION_ID_LENGTH) {
+        return;
+    }
+
+    const size_t home = homeIndex(id, length);
+    for (size_t i = 0; i < m_header->probe; ++i) {
+        Slot* slot = slotAt(home + i);
+        if (slot->idLength.load(std::memory_order_relaxed) != length ||
+            std::memcmp(slot->id, id, length) != 0) {
+            continue;
+        }
+        if (!lockSlot(slot)) {
+            return;
+        }
+        // 加锁后再确认一次，避免清掉刚被覆盖的其他 session
+        if (slot->idLength.load(std::memory_order_relaxed) == length &&
+            std::memcmp(slot->id, id, length) == 0) {
+            slot->idLength.store(0, std::memory_order_relaxed);
+            slot->derLength.store(0, std::memory_order_relaxed);
+            m_header->removals.fetch_add(1, std::memory_order_relaxed);
+        }
+        unlockSlot(slot);
+        return;
+    }
+}
+
+SslSessionCacheStats SslShmSessionCache::stats() const
+{
+    SslSessionCacheStats result;
+    result.hits = m_header->hits.load(std::memory_order_relaxed);
+    result.misses = m_header->misses.load(std::memory_order_relaxed);
+    result.inserts = m_header->inserts.load(std::memory_order_relaxed);
+    result.evictions = m_header->evictions.load(std::memory_order_relaxed);
+    result.expired = m_header->expired.load(std::memory_order_relaxed);
+    result.removals = m_header->removals.load(std::memory_order_relaxed);
+    result.rejected = m_header->rejected.load(std::memory_order_relaxed);
+
+    const int64_t now = static_cast<int64_t>(std::time(nullptr));
+    for (size_t i = 0; i < m_header->slotCount; ++i) {
+        const Slot* slot = slotAt(i);
+        if (slot->idLength.load(std::memory_order_relaxed) != 0 &&
+            slot->expiresAt.load(std::memory_order_relaxed) > now) {
+            ++result.size;
+        }
+    }
+    return result;
+}
+
+} // namespace galay::ssl
@@ -0,0 +1,100 @@
+#ifndef GALAY_SSL_SHM_SESSION_CACHE_H
+#define GALAY_SSL_SHM_SESSION_CACHE_H
+
+#include "galay-ssl/common/error.h"
+#include "galay-ssl/ssl/ssl_session_cache.h"
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 共享内存 Session 缓存配置
+ */
+struct SslShmSessionCacheOptions {
+    size_t slots = 16384;               ///< 槽位数，向上取整为 2 的幂
+    size_t maxSessionBytes = 2048;      ///< 单个 session DER 的最大字节数，超出的 session 不缓存
+    size_t probe = 4;                   ///< 开放寻址探测长度
+};
+
+/**
+ * @brief 跨进程共享内存 Session 缓存
+ *
+ * @details 把一个文件（推荐放在 /dev/shm 下）以 MAP_SHARED 映射为定长槽位哈希表，
+ * 多个 SO_REUSEPORT 服务进程打开同一路径即可共享 session。每个槽位由 seqlock 保护：
+ * 写者以 CAS 把序号置为奇数独占槽位，读者在前后两次读到相同偶数序号时才接受拷贝，
+ * 查找路径不加锁。session 以 DER 形式存放，命中时在本进程内反序列化。
+ *
+ * @example
+ * @code
+ * auto cache = SslShmSessionCache::open("/dev/shm/galay-ssl-sessions");
+ * if (cache) {
+ *     ctx.setSessionCache(*cache);
+ * }
+ * @endcode
+ *
+ * @note
+ * - 所有进程必须使用相同的槽位参数，参数不一致时 open() 返回 kSessionCacheFailed
+ * - 写入是尽力而为：槽位正被其他写者占用时放弃本次写入
+ * - 写者在持有槽位期间崩溃会使该槽位停止服务，直到文件被删除重建
+ */
+class SslShmSessionCache : public SslSessionStore
+{
+public:
+    /**
+     * @brief 打开或创建共享缓存文件
+     * @param path 映射文件路径
+     * @param options 槽位参数（创建时写入文件头，后续打开必须一致）
+     */
+    static std::expected<std::shared_ptr<SslShmSessionCache>, SslError> open(
+        const std::string& path,
+        SslShmSessionCacheOptions options = {});
+
+    ~SslShmSessionCache() override;
+
+    SslShmSessionCache(const SslShmSessionCache&) = delete;
+    SslShmSessionCache& operator=(const SslShmSessionCache&) = delete;
+
+    bool store(const unsigned char* id, size_t length, SSL_SESSION* session) override;
+    SSL_SESSION* load(const unsigned char* id, size_t length) override;
+    void erase(const unsigned char* id, size_t length) override;
+
+    /**
+     * @brief 统计快照（计数器跨进程共享，size 需要扫描全部槽位）
+     */
+    SslSessionCacheStats stats() const override;
+
+    /**
+     * @brief 槽位数
+     */
+    size_t slotCount() const;
+
+    /**
+     * @brief 映射文件路径
+     */
+    const std::string& path() const { return m_path; }
+
+private:
+    struct Header;
+    struct Slot;
+
+    SslShmSessionCache(std::string path, void* base, size_t mappedBytes);
+
+    Slot* slotAt(size_t index) const;
+    size_t homeIndex(const unsigned char* id, size_t length) const;
+    bool lockSlot(Slot* slot) const;
+    static void unlockSlot(Slot* slot);
+
+    std::string m_path;
+    void* m_base = nullptr;
+    size_t m_mappedBytes = 0;
+    Header* m_header = nullptr;
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_SHM_SESSION_CACHE_H
@@ -0,0 +1,315 @@
+#include "ssl_ticket_keys.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <openssl/rand.h>
+
+namespace galay::ssl
+{
+
+namespace {
+
+int64_t steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::expected<std::vector<SslTicketKey>, SslError> readKeyFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return std::unexpected(SslError(SslErrorCode::kTicketKeyFailed));
+    }
+    const std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.empty() || bytes.size() % SslTicketKey::kSerializedSize != 0) {
+        return std::unexpected(SslError(SslErrorCode::kTicketKeyFailed));
+    }
+
+    std::vector<SslTicketKey> keys;
+    keys.reserve(bytes.size() / SslTicketKey::kSerializedSize);
+    for (size_t offset = 0; offset < bytes.size(); offset += SslTicketKey::kSerializedSize) {
+        auto key = SslTicketKey::fromBytes(bytes.data() + offset, SslTicketKey::kSerializedSize);
+        if (!key) {
+            return std::unexpected(key.error());
+        }
+        keys.push_back(*key);
+    }
+    return keys;
+}
+
+} // anonymous namespace
+
+std::expected<SslTicketKey, SslError> SslTicketKey::generate()
+{
+    SslTicketKey key;
+    if (RAND_bytes(key.name.data(), static_cast<int>(key.name.size())) != 1 ||
+        RAND_priv_bytes(key.hmacKey.data(), static_cast<int>(key.hmacKey.size())) != 1 ||
+        RAND_priv_bytes(key.aesKey.data(), static_cast<int>(key.aesKey.size())) != 1) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kTicketKeyFailed));
+    }
+    return key;
+}
+
+std::expected<SslTicketKey, SslError> SslTicketKey::fromBytes(const unsigned char* data, size_t length)
+{
+    if (data == nullptr || length != kSerializedSize) {
+        return std::unexpected(SslError(SslErrorCode::kTicketKeyFailed));
+    }
+    SslTicketKey key;
+    std::memcpy(key.name.data(), data, kNameSize);
+    std::memcpy(key.hmacKey.data(), data + kNameSize, kSecretSize);
+    std::memcpy(key.aesKey.data(), data + kNameSize + kSecretSize, kSecretSize);
+    return key;
+}
+
+std::array<unsigned char, SslTicketKey::kSerializedSize> SslTicketKey::toBytes() const
+{
+    std::array<unsigned char, kSerializedSize> bytes{};
+    std::memcpy(bytes.data(), name.data(), kNameSize);
+    std::memcpy(bytes.data() + kNameSize, hmacKey.data(), kSecretSize);
+    std::memcpy(bytes.data() + kNameSize + kSecretSize, aesKey.data(), kSecretSize);
+    return bytes;
+}
+
+SslTicketKeyRing::SslTicketKeyRing(SslTicketKeyRingOptions options)
+    : m_options(options)
+{
+    m_options.maxKeys = std::max<size_t>(1, m_options.maxKeys);
+    if (auto key = SslTicketKey::generate()) {
+        m_keys.push_back(*key);
+    } else {
+        m_rotateFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+    scheduleNext();
+    startRotation();
+}
+
+SslTicketKeyRing::SslTicketKeyRing(SslTicketKeyRingOptions options,
+                                   SslTicketKeySource source,
+                                   std::vector<SslTicketKey> keys)
+    : m_options(options)
+    , m_source(std::move(source))
+{
+    m_options.maxKeys = std::max<size_t>(1, m_options.maxKeys);
+    installLocked(std::move(keys));
+    scheduleNext();
+    startRotation();
+}
+
+SslTicketKeyRing::~SslTicketKeyRing()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+std::expected<std::shared_ptr<SslTicketKeyRing>, SslError> SslTicketKeyRing::create(SslTicketKeyRingOptions options)
+{
+    auto key = SslTicketKey::generate();
+    if (!key) {
+        return std::unexpected(key.error());
+    }
+    return std::shared_ptr<SslTicketKeyRing>(new SslTicketKeyRing(options, nullptr, {*key}));
+}
+
+std::expected<std::shared_ptr<SslTicketKeyRing>, SslError> SslTicketKeyRing::fromFile(
+    const std::string& path,
+    SslTicketKeyRingOptions options)
+{
+    return fromSource([path]() { return readKeyFile(path); }, options);
+}
+
+std::expected<std::shared_ptr<SslTicketKeyRing>, SslError> SslTicketKeyRing::fromSource(
+    SslTicketKeySource source,
+    SslTicketKeyRingOptions options)
+{
+    if (!source) {
+        return std::unexpected(SslError(SslErrorCode::kTicketKeyFailed));
+    }
+    auto keys = source();
+    if (!keys) {
+        return std::unexpected(keys.error());
+    }
+    if (keys->empty()) {
+        return std::unexpected(SslError(SslErrorCode::kTicketKeyFailed));
+    }
+    return std::shared_ptr<SslTicketKeyRing>(new SslTicketKeyRing(options, std::move(source), std::move(*keys)));
+}
+
+void SslTicketKeyRing::installLocked(std::vector<SslTicketKey> keys)
+{
+    // 新密钥在前，原有密钥按顺序后移；同名密钥只保留新值
+    for (const auto& old : m_keys) {
+        const bool present = std::any_of(keys.begin(), keys.end(),
+            [&](const SslTicketKey& key) { return key.name == old.name; });
+        if (!present) {
+            keys.push_back(old);
+        }
+    }
+    if (keys.size() > m_options.maxKeys) {
+        keys.resize(m_options.maxKeys);
+    }
+    m_keys = std::move(keys);
+}
+
+void SslTicketKeyRing::scheduleNext()
+{
+    if (m_options.rotationInterval.count() <= 0) {
+        m_nextRotation.store(0, std::memory_order_relaxed);
+        return;
+    }
+    const int64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(m_options.rotationInterval).count();
+    m_nextRotation.store(steadyNowNs() + interval, std::memory_order_relaxed);
+}
+
+void SslTicketKeyRing::startRotation()
+{
+    if (m_options.rotationInterval.count() > 0) {
+        m_thread = std::thread([this] { rotationLoop(); });
+    }
+}
+
+void SslTicketKeyRing::rotationLoop()
+{
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    while (!m_stopping) {
+        // 环为空时每秒重试，否则等到下一个轮换时间
+        const bool empty = keyCount() == 0;
+        const int64_t due = m_nextRotation.load(std::memory_order_relaxed);
+        std::chrono::nanoseconds wait = m_options.rotationInterval;
+        if (due != 0) {
+            wait = std::chrono::nanoseconds(std::max<int64_t>(0, due - steadyNowNs()));
+        }
+        if (empty) {
+            wait = std::min<std::chrono::nanoseconds>(wait, std::chrono::seconds(1));
+        }
+        if (m_cv.wait_for(lock, wait, [this] { return m_stopping; })) {
+            break;
+        }
+        lock.unlock();
+        // 失败已计入统计并回调，现有密钥继续生效
+        if (empty) {
+            (void)rotate();
+        } else {
+            (void)rotateIfDue();
+        }
+        lock.lock();
+    }
+}
+
+std::expected<void, SslError> SslTicketKeyRing::rotateFailed(SslError error)
+{
+    m_rotateFailures.fetch_add(1, std::memory_order_relaxed);
+    if (m_options.onRotateFailure) {
+        m_options.onRotateFailure(error);
+    }
+    return std::unexpected(std::move(error));
+}
+
+std::expected<void, SslError> SslTicketKeyRing::rotate()
+{
+    std::vector<SslTicketKey> keys;
+    if (m_source) {
+        auto loaded = m_source();
+        if (!loaded || loaded->empty()) {
+            return rotateFailed(loaded ? SslError(SslErrorCode::kTicketKeyFailed) : loaded.error());
+        }
+        keys = std::move(*loaded);
+    } else {
+        auto key = SslTicketKey::generate();
+        if (!key) {
+            return rotateFailed(key.error());
+        }
+        keys.push_back(*key);
+    }
+
+    {
+        std::unique_lock lock(m_mutex);
+        installLocked(std::move(keys));
+    }
+    m_rotations.fetch_add(1, std::memory_order_relaxed);
+    scheduleNext();
+    return {};
+}
+
+bool SslTicketKeyRing::rotateIfDue()
+{
+    int64_t due = m_nextRotation.load(std::memory_order_relaxed);
+    if (due == 0 || steadyNowNs() < due) {
+        return false;
+    }
+    // 只让一个线程执行轮换；失败时也推迟到下一个周期，避免每次握手都重读来源
+    if (!m_nextRotation.compare_exchange_strong(due, 0, std::memory_order_relaxed)) {
+        return false;
+    }
+    const bool rotated = rotate().has_value();
+    if (!rotated) {
+        scheduleNext();
+    }
+    return rotated;
+}
+
+void SslTicketKeyRing::addKey(const SslTicketKey& key)
+{
+    std::unique_lock lock(m_mutex);
+    installLocked({key});
+}
+
+bool SslTicketKeyRing::encryptionKey(SslTicketKey& key)
+{
+    std::shared_lock lock(m_mutex);
+    if (m_keys.empty()) {
+        m_missingKey.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    key = m_keys.front();
+    m_issued.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool SslTicketKeyRing::decryptionKey(const unsigned char* name, SslTicketKey& key, bool& renew)
+{
+    std::shared_lock lock(m_mutex);
+    for (size_t i = 0; i < m_keys.size(); ++i) {
+        if (std::memcmp(m_keys[i].name.data(), name, SslTicketKey::kNameSize) == 0) {
+            key = m_keys[i];
+            renew = i != 0;
+            m_resumed.fetch_add(1, std::memory_order_relaxed);
+            if (renew) {
+                m_renewed.fetch_add(1, std::memory_order_relaxed);
+            }
+            return true;
+        }
+    }
+    m_unknownKey.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+size_t SslTicketKeyRing::keyCount() const
+{
+    std::shared_lock lock(m_mutex);
+    return m_keys.size();
+}
+
+SslTicketStats SslTicketKeyRing::stats() const
+{
+    SslTicketStats result;
+    result.issued = m_issued.load(std::memory_order_relaxed);
+    result.resumed = m_resumed.load(std::memory_order_relaxed);
+    result.renewed = m_renewed.load(std::memory_order_relaxed);
+    result.unknownKey = m_unknownKey.load(std::memory_order_relaxed);
+    result.rotations = m_rotations.load(std::memory_order_relaxed);
+    result.rotateFailures = m_rotateFailures.load(std::memory_order_relaxed);
+    result.missingKey = m_missingKey.load(std::memory_order_relaxed);
+    return result;
+}
+
+} // namespace galay::ssl
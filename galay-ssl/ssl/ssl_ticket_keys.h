@@ -0,0 +1,217 @@
+#ifndef GALAY_SSL_TICKET_KEYS_H
+#define GALAY_SSL_TICKET_KEYS_H
+
+#include "galay-ssl/common/defn.hpp"
+#include "galay-ssl/common/error.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief Session ticket 密钥
+ *
+ * @details 序列化格式为 80 字节：16 字节 key name + 32 字节 HMAC-SHA256 密钥 + 32 字节 AES-256-CBC 密钥，
+ * 与 nginx ssl_session_ticket_key 的 80 字节格式一致。
+ */
+struct SslTicketKey {
+    static constexpr size_t kNameSize = 16;
+    static constexpr size_t kSecretSize = 32;
+    static constexpr size_t kSerializedSize = kNameSize + 2 * kSecretSize;
+
+    std::array<unsigned char, kNameSize> name{};
+    std::array<unsigned char, kSecretSize> hmacKey{};
+    std::array<unsigned char, kSecretSize> aesKey{};
+
+    /**
+     * @brief 生成随机密钥
+     */
+    static std::expected<SslTicketKey, SslError> generate();
+
+    /**
+     * @brief 从 80 字节序列化数据解析
+     */
+    static std::expected<SslTicketKey, SslError> fromBytes(const unsigned char* data, size_t length);
+
+    /**
+     * @brief 序列化为 80 字节
+     */
+    std::array<unsigned char, kSerializedSize> toBytes() const;
+};
+
+/**
+ * @brief 密钥来源：返回的第一个密钥作为当前加密密钥，其余只用于解密
+ */
+using SslTicketKeySource = std::function<std::expected<std::vector<SslTicketKey>, SslError>()>;
+
+/**
+ * @brief Ticket 密钥环配置
+ */
+struct SslTicketKeyRingOptions {
+    std::chrono::seconds rotationInterval{3600};    ///< 后台线程自动轮换的间隔，0 表示只手动 rotate()
+    size_t maxKeys = 2;                             ///< 保留的密钥数（当前 + 旧密钥），至少为 1
+    /**
+     * @brief 轮换失败（随机数生成或来源加载失败）时调用，可能在后台轮换线程上执行
+     */
+    std::function<void(const SslError&)> onRotateFailure;
+};
+
+/**
+ * @brief Ticket 密钥环统计
+ */
+struct SslTicketStats {
+    uint64_t issued = 0;        ///< 用当前密钥加密签发的 ticket 数
+    uint64_t resumed = 0;       ///< 成功解密的 ticket 数
+    uint64_t renewed = 0;       ///< 用旧密钥解密、要求客户端换新 ticket 的次数
+    uint64_t unknownKey = 0;    ///< key name 不在环内（已淘汰或来自其他集群）的次数
+    uint64_t rotations = 0;     ///< 轮换次数
+    uint64_t rotateFailures = 0;///< 来源加载失败、保留旧密钥的次数
+    uint64_t missingKey = 0;    ///< 环为空而没有签发 ticket 的次数
+};
+
+/**
+ * @brief 无状态 session ticket 的共享密钥环
+ *
+ * @details 持有当前密钥与若干旧密钥：新 ticket 总是用当前密钥加密，旧密钥仍可解密，
+ * 命中旧密钥时让 OpenSSL 重新签发 ticket。多个 worker 的 SslContext 可以挂同一个密钥环；
+ * 多个进程通过同一密钥文件（或同一来源回调）共享密钥，任意进程都能恢复任意客户端。
+ *
+ * 轮换时机：rotationInterval > 0 时由密钥环自己的后台线程按间隔调用 rotate()，签发与解密 ticket
+ * 的回调只在共享锁下读取密钥，不做文件 I/O；也可以由应用自己的定时器调用 rotate() / rotateIfDue()。
+ * 轮换失败时保留现有密钥，计入 rotateFailures 并调用 onRotateFailure；环为空时后台线程每秒重试，
+ * 期间握手不签发 ticket（计入 missingKey）。
+ * - 默认（随机来源）：生成新密钥放到最前，超过 maxKeys 的最旧密钥被淘汰
+ * - 文件 / 回调来源：重新加载来源，来源返回的密钥排在前面，原有密钥依次后移
+ *
+ * @example
+ * @code
+ * auto ring = SslTicketKeyRing::fromFile("/etc/galay/ticket.key");
+ * if (ring) {
+ *     for (auto& worker : workers) {
+ *         worker.ctx->setSessionTicketKeys(*ring);
+ *     }
+ * }
+ * @endcode
+ *
+ * @note 密钥文件由外部负责原子替换（写临时文件后 rename），所有进程需使用相同的轮换间隔
+ */
+class SslTicketKeyRing
+{
+public:
+    /**
+     * @brief 以随机密钥创建（仅适合单进程共享）
+     * @note 随机数生成失败时环为空，keyCount() 为 0；需要立即得知失败时使用 create()
+     */
+    explicit SslTicketKeyRing(SslTicketKeyRingOptions options = {});
+
+    ~SslTicketKeyRing();
+
+    /**
+     * @brief 以随机密钥创建
+     * @return 随机数生成失败时返回 kTicketKeyFailed
+     */
+    static std::expected<std::shared_ptr<SslTicketKeyRing>, SslError> create(SslTicketKeyRingOptions options = {});
+
+    /**
+     * @brief 从密钥文件创建，文件内容为一个或多个 80 字节密钥，第一个为当前密钥
+     */
+    static std::expected<std::shared_ptr<SslTicketKeyRing>, SslError> fromFile(
+        const std::string& path,
+        SslTicketKeyRingOptions options = {});
+
+    /**
+     * @brief 从回调来源创建，创建时立即调用一次
+     */
+    static std::expected<std::shared_ptr<SslTicketKeyRing>, SslError> fromSource(
+        SslTicketKeySource source,
+        SslTicketKeyRingOptions options = {});
+
+    SslTicketKeyRing(const SslTicketKeyRing&) = delete;
+    SslTicketKeyRing& operator=(const SslTicketKeyRing&) = delete;
+
+    /**
+     * @brief 立即轮换
+     * @return 来源失败时返回错误并保留现有密钥
+     */
+    std::expected<void, SslError> rotate();
+
+    /**
+     * @brief 到达轮换时间时轮换，返回是否执行了轮换
+     */
+    bool rotateIfDue();
+
+    /**
+     * @brief 手动放入一个密钥作为当前密钥
+     */
+    void addKey(const SslTicketKey& key);
+
+    /**
+     * @brief 获取当前加密密钥（签发 ticket 时调用，计入 issued）
+     * @details 只在共享锁下读取，不触发轮换
+     * @return 环为空时返回 false，计入 missingKey
+     */
+    bool encryptionKey(SslTicketKey& key);
+
+    /**
+     * @brief 按 key name 查找解密密钥
+     * @param name 16 字节 key name
+     * @param key 输出密钥
+     * @param renew 输出是否为旧密钥（需要重新签发）
+     * @return 是否找到
+     */
+    bool decryptionKey(const unsigned char* name, SslTicketKey& key, bool& renew);
+
+    /**
+     * @brief 当前保留的密钥数
+     */
+    size_t keyCount() const;
+
+    /**
+     * @brief 统计快照
+     */
+    SslTicketStats stats() const;
+
+private:
+    SslTicketKeyRing(SslTicketKeyRingOptions options, SslTicketKeySource source, std::vector<SslTicketKey> keys);
+
+    void installLocked(std::vector<SslTicketKey> keys);
+    void scheduleNext();
+    void startRotation();
+    void rotationLoop();
+    std::expected<void, SslError> rotateFailed(SslError error);
+
+    SslTicketKeyRingOptions m_options;
+    SslTicketKeySource m_source;
+    mutable std::shared_mutex m_mutex;
+    std::vector<SslTicketKey> m_keys;                   ///< 下标 0 为当前密钥
+    std::atomic<int64_t> m_nextRotation{0};             ///< steady_clock 纳秒，0 表示不自动轮换
+    std::atomic<uint64_t> m_issued{0};
+    std::atomic<uint64_t> m_resumed{0};
+    std::atomic<uint64_t> m_renewed{0};
+    std::atomic<uint64_t> m_unknownKey{0};
+    std::atomic<uint64_t> m_rotations{0};
+    std::atomic<uint64_t> m_rotateFailures{0};
+    std::atomic<uint64_t> m_missingKey{0};
+
+    std::thread m_thread;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_cv;
+    bool m_stopping = false;
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_TICKET_KEYS_H
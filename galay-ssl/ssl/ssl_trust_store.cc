@@ -0,0 +1,153 @@
+#include "ssl_trust_store.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <utility>
+
+namespace galay::ssl
+{
+
+namespace {
+
+int generationIndex()
+{
+    static const int index = X509_STORE_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+std::atomic<uint64_t> g_nextGeneration{1};
+
+using LookupPaths = std::vector<std::string>;
+
+void freeLookupPaths(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+{
+    delete static_cast<LookupPaths*>(ptr);
+}
+
+int lookupPathsIndex()
+{
+    static const int index = X509_STORE_get_ex_new_index(0, nullptr, nullptr, nullptr, freeLookupPaths);
+    return index;
+}
+
+} // anonymous namespace
+
+SslTrustStore::SslTrustStore(X509_STORE* store, SslTrustStoreOptions options)
+    : m_store(store)
+    , m_options(std::move(options))
+{
+    renewGeneration(m_store);
+    // 目录来源在验证时才把证书缓存进 store，这里只统计创建时载入的证书
+    STACK_OF(X509_OBJECT)* objects = X509_STORE_get0_objects(m_store);
+    for (int i = 0; i < sk_X509_OBJECT_num(objects); ++i) {
+        if (X509_OBJECT_get_type(sk_X509_OBJECT_value(objects, i)) == X509_LU_X509) {
+            ++m_certificates;
+        }
+    }
+}
+
+SslTrustStore::~SslTrustStore()
+{
+    X509_STORE_free(m_store);
+}
+
+std::expected<std::shared_ptr<SslTrustStore>, SslError> SslTrustStore::create(SslTrustStoreOptions options)
+{
+    if (options.caFiles.empty() && options.caPaths.empty() && !options.useDefaultPaths) {
+        return std::unexpected(SslError(SslErrorCode::kCACertificateLoadFailed));
+    }
+
+    X509_STORE* store = X509_STORE_new();
+    if (store == nullptr) {
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kCACertificateLoadFailed));
+    }
+    bool ok = true;
+    for (const auto& file : options.caFiles) {
+        ok = ok && X509_STORE_load_file(store, file.c_str()) == 1;
+    }
+    for (const auto& path : options.caPaths) {
+        ok = ok && X509_STORE_load_path(store, path.c_str()) == 1;
+        addLookupPath(store, path);
+    }
+    if (options.useDefaultPaths) {
+        ok = ok && X509_STORE_set_default_paths(store) == 1;
+        addLookupPath(store, defaultLookupPath());
+    }
+    if (!ok) {
+        X509_STORE_free(store);
+        return std::unexpected(SslError::fromOpenSSL(SslErrorCode::kCACertificateLoadFailed));
+    }
+    return std::shared_ptr<SslTrustStore>(new SslTrustStore(store, std::move(options)));
+}
+
+uint64_t SslTrustStore::generationOf(X509_STORE* store)
+{
+    if (store == nullptr) {
+        return 0;
+    }
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(X509_STORE_get_ex_data(store, generationIndex())));
+}
+
+void SslTrustStore::renewGeneration(X509_STORE* store)
+{
+    if (store == nullptr) {
+        return;
+    }
+    const uint64_t generation = g_nextGeneration.fetch_add(1, std::memory_order_relaxed);
+    X509_STORE_set_ex_data(store, generationIndex(), reinterpret_cast<void*>(static_cast<uintptr_t>(generation)));
+}
+
+void SslTrustStore::addLookupPath(X509_STORE* store, const std::string& path)
+{
+    if (store == nullptr) {
+        return;
+    }
+    auto* paths = static_cast<LookupPaths*>(X509_STORE_get_ex_data(store, lookupPathsIndex()));
+    if (paths == nullptr) {
+        paths = new LookupPaths();
+        X509_STORE_set_ex_data(store, lookupPathsIndex(), paths);
+    }
+    size_t begin = 0;
+    while (begin <= path.size()) {
+        const size_t end = std::min(path.find(':', begin), path.size());
+        if (end > begin) {
+            paths->emplace_back(path, begin, end - begin);
+        }
+        begin = end + 1;
+    }
+}
+
+std::string SslTrustStore::defaultLookupPath()
+{
+    const char* env = std::getenv(X509_get_default_cert_dir_env());
+    return env != nullptr ? env : X509_get_default_cert_dir();
+}
+
+uint64_t SslTrustStore::lookupStampOf(X509_STORE* store)
+{
+    const auto* paths = store ? static_cast<const LookupPaths*>(X509_STORE_get_ex_data(store, lookupPathsIndex()))
+                              : nullptr;
+    if (paths == nullptr) {
+        return 0;
+    }
+    // FNV-1a 混合各目录的修改时间；不存在的目录按 0 计入，之后创建也能反映出来
+    uint64_t stamp = 1469598103934665603ULL;
+    for (const auto& path : *paths) {
+        struct stat st {};
+        const uint64_t mtime = ::stat(path.c_str(), &st) == 0
+            ? static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ULL + static_cast<uint64_t>(st.st_mtim.tv_nsec)
+            : 0;
+        stamp = (stamp ^ mtime) * 1099511628211ULL;
+    }
+    return stamp;
+}
+
+std::expected<std::shared_ptr<SslTrustStore>, SslError> SslTrustStore::fromFile(const std::string& caFile)
+{
+    SslTrustStoreOptions options;
+    options.caFiles.push_back(caFile);
+    return create(std::move(options));
+}
+
+} // namespace galay::ssl
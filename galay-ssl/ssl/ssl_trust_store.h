@@ -0,0 +1,120 @@
+#ifndef GALAY_SSL_TRUST_STORE_H
+#define GALAY_SSL_TRUST_STORE_H
+
+#include "galay-ssl/common/defn.hpp"
+#include "galay-ssl/common/error.h"
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 信任库来源
+ */
+struct SslTrustStoreOptions {
+    std::vector<std::string> caFiles;   ///< PEM CA 证书文件，创建时一次性解析
+    std::vector<std::string> caPaths;   ///< c_rehash 格式的 CA 目录，验证时按需查找
+    bool useDefaultPaths = false;       ///< 同时加入系统默认 CA 位置
+};
+
+/**
+ * @brief 可被多个上下文共享的只读信任库
+ *
+ * @details 创建时解析一次 CA 证书，之后不再修改。SslContext::setTrustStore() 以引用计数挂接同一个
+ * X509_STORE，每个 worker 上下文不再各自解析 CA bundle、各自保存一份证书；
+ * SslContext::buildCertificateChain() 也以它为信任锚预先构建服务端证书链。
+ *
+ * @example
+ * @code
+ * auto trust = SslTrustStore::create({.caFiles = {"/etc/galay/ca.crt"}});
+ * for (auto& worker : workers) {
+ *     worker.ctx->setTrustStore(*trust);
+ * }
+ * @endcode
+ *
+ * @note
+ * - 线程安全：X509_STORE 的查找自带锁，可被任意多个上下文与连接并发使用
+ * - 不要通过 native() 修改信任库，需要更换 CA 时创建新的 SslTrustStore 并重新挂接
+ */
+class SslTrustStore
+{
+public:
+    /**
+     * @brief 按来源创建信任库
+     * @return 任一来源加载失败或来源为空时返回 kCACertificateLoadFailed
+     */
+    static std::expected<std::shared_ptr<SslTrustStore>, SslError> create(SslTrustStoreOptions options);
+
+    /**
+     * @brief 从单个 CA 文件创建
+     */
+    static std::expected<std::shared_ptr<SslTrustStore>, SslError> fromFile(const std::string& caFile);
+
+    ~SslTrustStore();
+
+    SslTrustStore(const SslTrustStore&) = delete;
+    SslTrustStore& operator=(const SslTrustStore&) = delete;
+
+    /**
+     * @brief 底层 X509_STORE（只读使用）
+     */
+    X509_STORE* native() const { return m_store; }
+
+    /**
+     * @brief 创建时载入内存的证书数（caPaths 中按需查找的证书不计入）
+     */
+    size_t certificateCount() const { return m_certificates; }
+
+    /**
+     * @brief 信任库代数，进程内唯一，创建后不变
+     */
+    uint64_t generation() const { return generationOf(m_store); }
+
+    /**
+     * @brief X509_STORE 当前的代数；没有标记过的信任库返回 0
+     * @details 代数随信任库内容变化（SslTrustStore 创建、SslContext 加载 CA）而更新，
+     * 供 SslVerifyCache 等以信任库内容为键的缓存判断是否仍然有效
+     */
+    static uint64_t generationOf(X509_STORE* store);
+
+    /**
+     * @brief 为原地修改过的 X509_STORE 分配新的代数
+     */
+    static void renewGeneration(X509_STORE* store);
+
+    /**
+     * @brief 登记 X509_STORE 按需查找的 CA 目录（多个目录以 ':' 分隔）
+     * @details 目录中的证书在验证时才载入，增删文件不会更新代数；登记后由 lookupStampOf() 反映这些变化
+     */
+    static void addLookupPath(X509_STORE* store, const std::string& path);
+
+    /**
+     * @brief 系统默认 CA 目录（SSL_CERT_DIR 环境变量优先），供 useDefaultPaths 登记
+     */
+    static std::string defaultLookupPath();
+
+    /**
+     * @brief 已登记 CA 目录的修改时间摘要；没有登记目录时返回 0
+     * @details 目录中增删、重命名证书（c_rehash 重建链接）都会改变目录的修改时间。
+     * 每次调用对每个目录做一次 stat()
+     */
+    static uint64_t lookupStampOf(X509_STORE* store);
+
+    const SslTrustStoreOptions& options() const { return m_options; }
+
+private:
+    SslTrustStore(X509_STORE* store, SslTrustStoreOptions options);
+
+    X509_STORE* m_store;
+    SslTrustStoreOptions m_options;
+    size_t m_certificates = 0;
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_TRUST_STORE_H
@@ -0,0 +1,227 @@
+#include "ssl_verify_cache.h"
+#include "ssl_trust_store.h"
+#include <algorithm>
+#include <cstring>
+
+namespace galay::ssl
+{
+
+namespace {
+
+size_t roundUpPow2(size_t value)
+{
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/**
+ * @brief 链中最早的 notAfter 距现在的秒数，无法解析时返回 0
+ */
+int64_t secondsUntilExpiry(STACK_OF(X509)* chain)
+{
+    int64_t remaining = INT64_MAX;
+    for (int i = 0; i < sk_X509_num(chain); ++i) {
+        int days = 0;
+        int seconds = 0;
+        if (ASN1_TIME_diff(&days, &seconds, nullptr, X509_get0_notAfter(sk_X509_value(chain, i))) != 1) {
+            return 0;
+        }
+        remaining = std::min<int64_t>(remaining, static_cast<int64_t>(days) * 86400 + seconds);
+    }
+    return remaining;
+}
+
+/**
+ * @brief 命中时按 X509_verify_cert() 的顺序（从根到叶子）以 ok=1 调用验证回调
+ * @return 回调拒绝任一证书时返回 0
+ */
+int notifyVerified(X509_STORE_CTX* ctx, STACK_OF(X509)* chain)
+{
+    X509_STORE_CTX_verify_cb callback = X509_STORE_CTX_get_verify_cb(ctx);
+    if (callback == nullptr) {
+        return 1;
+    }
+    for (int depth = sk_X509_num(chain) - 1; depth >= 0; --depth) {
+        X509_STORE_CTX_set_error_depth(ctx, depth);
+        X509_STORE_CTX_set_current_cert(ctx, sk_X509_value(chain, depth));
+        if (callback(1, ctx) == 0) {
+            if (X509_STORE_CTX_get_error(ctx) == X509_V_OK) {
+                X509_STORE_CTX_set_error(ctx, X509_V_ERR_APPLICATION_VERIFICATION);
+            }
+            return 0;
+        }
+    }
+    return 1;
+}
+
+} // anonymous namespace
+
+SslVerifyCache::SslVerifyCache(SslVerifyCacheOptions options)
+    : m_options(options)
+{
+    const size_t shards = roundUpPow2(std::max<size_t>(1, options.shards));
+    m_shards.reserve(shards);
+    for (size_t i = 0; i < shards; ++i) {
+        m_shards.push_back(std::make_unique<Shard>());
+    }
+    m_shardMask = shards - 1;
+    m_shardCapacity = std::max<size_t>(1, (options.capacity + shards - 1) / shards);
+}
+
+SslVerifyCache::~SslVerifyCache()
+{
+    for (auto& shard : m_shards) {
+        for (auto& [key, entry] : shard->entries) {
+            sk_X509_pop_free(entry.chain, X509_free);
+        }
+    }
+}
+
+int SslVerifyCache::verify(X509_STORE_CTX* ctx)
+{
+    X509* leaf = X509_STORE_CTX_get0_cert(ctx);
+    X509_STORE* store = X509_STORE_CTX_get0_store(ctx);
+    const uint64_t generation = SslTrustStore::generationOf(store);
+    const X509_VERIFY_PARAM* param = X509_STORE_CTX_get0_param(ctx);
+    const unsigned long flags = X509_VERIFY_PARAM_get_flags(param);
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    // 没有代数的信任库无法判断缓存是否仍然有效；CRL 检查依赖随时加入 store 的 CRL，
+    // 这些变化不更新代数，两种情况都直接验证
+    if (leaf == nullptr || generation == 0 || (flags & (X509_V_FLAG_CRL_CHECK | X509_V_FLAG_CRL_CHECK_ALL)) != 0 ||
+        X509_digest(leaf, EVP_sha256(), digest, &length) != 1) {
+        return X509_verify_cert(ctx);
+    }
+
+    // 键：叶子指纹 + 代数 + CA 目录修改时间 + 验证标志与深度，任一变化都不再命中旧条目
+    const uint64_t stamp = SslTrustStore::lookupStampOf(store);
+    const int depth = X509_VERIFY_PARAM_get_depth(param);
+    std::string key(reinterpret_cast<const char*>(digest), length);
+    key.append(reinterpret_cast<const char*>(&generation), sizeof(generation));
+    key.append(reinterpret_cast<const char*>(&stamp), sizeof(stamp));
+    key.append(reinterpret_cast<const char*>(&flags), sizeof(flags));
+    key.append(reinterpret_cast<const char*>(&depth), sizeof(depth));
+    if (STACK_OF(X509)* chain = find(key)) {
+        X509_STORE_CTX_set0_verified_chain(ctx, chain);
+        X509_STORE_CTX_set_error(ctx, X509_V_OK);
+        return notifyVerified(ctx, chain);
+    }
+
+    const int verified = X509_verify_cert(ctx);
+    // 验证回调放行的错误不缓存
+    if (verified == 1 && X509_STORE_CTX_get_error(ctx) == X509_V_OK) {
+        if (STACK_OF(X509)* chain = X509_STORE_CTX_get1_chain(ctx)) {
+            insert(std::move(key), chain);
+        }
+    }
+    return verified;
+}
+
+SslVerifyCache::Shard& SslVerifyCache::shardFor(const std::string& key)
+{
+    // 指纹本身均匀分布，取前 8 字节即可
+    uint64_t hash = 0;
+    std::memcpy(&hash, key.data(), std::min(key.size(), sizeof(hash)));
+    return *m_shards[static_cast<size_t>(hash) & m_shardMask];
+}
+
+void SslVerifyCache::dropLocked(Shard& shard, std::unordered_map<std::string, Entry>::iterator it)
+{
+    sk_X509_pop_free(it->second.chain, X509_free);
+    shard.lru.erase(it->second.lru);
+    shard.entries.erase(it);
+}
+
+STACK_OF(X509)* SslVerifyCache::find(const std::string& key)
+{
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+        ++shard.misses;
+        return nullptr;
+    }
+    if (Clock::now() >= it->second.expires) {
+        dropLocked(shard, it);
+        ++shard.expired;
+        ++shard.misses;
+        return nullptr;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+    ++shard.hits;
+    // 在锁内加引用，避免返回后被并发淘汰释放
+    return X509_chain_up_ref(it->second.chain);
+}
+
+void SslVerifyCache::insert(std::string key, STACK_OF(X509)* chain)
+{
+    const int64_t remaining = secondsUntilExpiry(chain);
+    if (remaining <= 0) {
+        sk_X509_pop_free(chain, X509_free);
+        return;
+    }
+    const auto now = Clock::now();
+    const auto expires = std::min(now + m_options.ttl, now + std::chrono::seconds(remaining));
+
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        dropLocked(shard, it);
+    }
+    while (shard.entries.size() >= m_shardCapacity && !shard.lru.empty()) {
+        dropLocked(shard, shard.entries.find(shard.lru.back()));
+        ++shard.evictions;
+    }
+
+    shard.lru.push_front(key);
+    shard.entries.emplace(std::move(key), Entry{chain, expires, shard.lru.begin()});
+    ++shard.inserts;
+}
+
+void SslVerifyCache::invalidate()
+{
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (auto& [key, entry] : shard->entries) {
+            sk_X509_pop_free(entry.chain, X509_free);
+        }
+        shard->entries.clear();
+        shard->lru.clear();
+    }
+    m_invalidations.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t SslVerifyCache::size() const
+{
+    size_t total = 0;
+    for (const auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->entries.size();
+    }
+    return total;
+}
+
+SslVerifyCacheStats SslVerifyCache::stats() const
+{
+    SslVerifyCacheStats result;
+    for (const auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        result.hits += shard->hits;
+        result.misses += shard->misses;
+        result.inserts += shard->inserts;
+        result.evictions += shard->evictions;
+        result.expired += shard->expired;
+        result.size += shard->entries.size();
+    }
+    result.invalidations = m_invalidations.load(std::memory_order_relaxed);
+    return result;
+}
+
+} // namespace galay::ssl
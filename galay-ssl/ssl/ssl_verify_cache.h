@@ -0,0 +1,139 @@
+#ifndef GALAY_SSL_VERIFY_CACHE_H
+#define GALAY_SSL_VERIFY_CACHE_H
+
+#include "galay-ssl/common/defn.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace galay::ssl
+{
+
+/**
+ * @brief 证书验证缓存配置
+ */
+struct SslVerifyCacheOptions {
+    size_t capacity = 10000;                ///< 总容量（条目数），按分片均分
+    size_t shards = 16;                     ///< 分片数（锁条带数），会向上取整为 2 的幂
+    std::chrono::milliseconds ttl{std::chrono::minutes(5)};    ///< 条目有效期，另受链中证书的 notAfter 限制
+};
+
+/**
+ * @brief 证书验证缓存统计
+ */
+struct SslVerifyCacheStats {
+    uint64_t hits = 0;          ///< 命中、跳过链验证的次数
+    uint64_t misses = 0;        ///< 未命中、执行完整链验证的次数（含已过期）
+    uint64_t inserts = 0;       ///< 验证通过后写入的次数
+    uint64_t evictions = 0;     ///< 因容量淘汰的次数
+    uint64_t expired = 0;       ///< 查找时发现已过期而删除的次数
+    uint64_t invalidations = 0; ///< invalidate() 调用次数
+    size_t size = 0;            ///< 当前条目数
+};
+
+/**
+ * @brief 对端证书链验证结果缓存（服务端验证客户端证书）
+ *
+ * @details 键为叶子证书 SHA-256 指纹、信任库代数（SslTrustStore::generationOf()）、CA 目录的修改时间
+ * （SslTrustStore::lookupStampOf()）以及验证标志与深度，值为上一次验证通过时构建出的可信链。
+ * 命中时直接把缓存的链作为验证结果，跳过 X509_verify_cert() 的链构建与逐级签名验证，
+ * 但仍按从根到叶子的顺序以 ok=1 调用 setVerifyMode() 传入的验证回调，回调拒绝时验证失败；
+ * 只缓存验证通过的结果，失败的证书每次都完整验证。
+ *
+ * 失效方式：
+ * - 条目在 ttl 或链中最早的 notAfter 到达后过期
+ * - 更换信任库（setTrustStore()、SslContextReloader 重建上下文）或通过 SslContext 加载 CA 后代数变化，
+ *   旧条目不再命中，随 LRU 淘汰
+ * - caPaths / loadCAPath() / 默认 CA 目录中增删证书改变目录修改时间，旧条目同样不再命中
+ * - 修改验证标志或深度后按新的键查找
+ * - 验证参数带 X509_V_FLAG_CRL_CHECK(_ALL) 时完全不经过缓存：store 中的 CRL 变化不会更新代数
+ * - 吊销证书后调用 invalidate() 清空缓存；挂接 SslCrlIndex 时吊销检查在缓存之后进行，无需清空
+ *
+ * @example
+ * @code
+ * auto cache = std::make_shared<SslVerifyCache>(SslVerifyCacheOptions{.capacity = 50000});
+ * for (auto& worker : workers) {
+ *     worker.ctx->setVerifyMode(SslVerifyMode::Peer);
+ *     worker.ctx->setTrustStore(trust);
+ *     worker.ctx->setVerifyCache(cache);
+ * }
+ * @endcode
+ *
+ * @note
+ * - 线程安全，可以被多个上下文共享；键不包含用途、主机名等其余验证参数，这些设置不同的上下文不要共享
+ * - 每次查找对登记的每个 CA 目录做一次 stat()
+ */
+class SslVerifyCache
+{
+public:
+    explicit SslVerifyCache(SslVerifyCacheOptions options = {});
+    ~SslVerifyCache();
+
+    SslVerifyCache(const SslVerifyCache&) = delete;
+    SslVerifyCache& operator=(const SslVerifyCache&) = delete;
+
+    /**
+     * @brief 代替 X509_verify_cert() 验证 ctx 中的证书链（由证书验证回调调用）
+     * @return 与 X509_verify_cert() 相同：1 表示通过，错误码在 ctx 中
+     */
+    int verify(X509_STORE_CTX* ctx);
+
+    /**
+     * @brief 清空所有条目（证书吊销后调用）
+     */
+    void invalidate();
+
+    /**
+     * @brief 获取统计快照
+     */
+    SslVerifyCacheStats stats() const;
+
+    /**
+     * @brief 当前条目数
+     */
+    size_t size() const;
+
+    const SslVerifyCacheOptions& options() const { return m_options; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        STACK_OF(X509)* chain = nullptr;    ///< 持有引用的可信链（叶子在前）
+        Clock::time_point expires{};
+        std::list<std::string>::iterator lru;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::list<std::string> lru;         ///< 头部为最近使用
+        std::unordered_map<std::string, Entry> entries;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t inserts = 0;
+        uint64_t evictions = 0;
+        uint64_t expired = 0;
+    };
+
+    Shard& shardFor(const std::string& key);
+    STACK_OF(X509)* find(const std::string& key);
+    void insert(std::string key, STACK_OF(X509)* chain);
+    static void dropLocked(Shard& shard, std::unordered_map<std::string, Entry>::iterator it);
+
+    SslVerifyCacheOptions m_options;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    size_t m_shardMask = 0;
+    size_t m_shardCapacity = 0;
+    std::atomic<uint64_t> m_invalidations{0};
+};
+
+} // namespace galay::ssl
+
+#endif // GALAY_SSL_VERIFY_CACHE_H
@@ -0,0 +1,70 @@
+#!/bin/bash
+# 同一份二进制、同一组参数依次压测所有已编译进来的 IO 后端（epoll / io_uring / kqueue）
+#
+# 用法：
+#   bash scripts/S3-Bench-Backend.sh [build_dir]
+# 需要以 Release + GALAY_SSL_DUAL_BACKEND=ON 构建，才能在 Linux 上同时对比 epoll 与 io_uring：
+#   cmake -S . -B build -DCMAKE_BUILD_TYPE=Release -DGALAY_SSL_DUAL_BACKEND=ON && cmake --build build -j
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+PROJECT_DIR="$(dirname "$SCRIPT_DIR")"
+BUILD_DIR="${1:-$PROJECT_DIR/build}"
+BIN_DIR="$BUILD_DIR/bin"
+BENCH_BIN="$BIN_DIR/b2_backend"
+BASE_PORT=9443
+
+if [ ! -x "$BENCH_BIN" ]; then
+    echo "ERROR: $BENCH_BIN not found. Please build first."
+    exit 1
+fi
+
+# b2_backend 从工作目录读取 certs/server.crt / certs/server.key
+cd "$BIN_DIR"
+
+BACKENDS=$("$BENCH_BIN" list)
+if [ "$(echo "$BACKENDS" | wc -l)" -lt 2 ]; then
+    echo "WARNING: only '$BACKENDS' compiled in; rebuild with -DGALAY_SSL_DUAL_BACKEND=ON to compare backends"
+fi
+
+run_case() {
+    local connections=$1
+    local requests=$2
+    local payload=$3
+
+    echo ""
+    echo "=== $connections conns x $requests reqs, payload ${payload}B ==="
+    printf "%-10s %12s %10s %10s %12s\n" "backend" "requests" "errors" "ms" "QPS"
+
+    for backend in $BACKENDS; do
+        local output
+        output=$("$BENCH_BIN" "$backend" "$connections" "$requests" "$payload" "$BASE_PORT" 2>&1 || true)
+        BASE_PORT=$((BASE_PORT + 1))
+
+        local total=$(echo "$output" | grep "Total requests:" | awk '{print $3}')
+        local errors=$(echo "$output" | grep "Total errors:" | awk '{print $3}')
+        local duration=$(echo "$output" | grep "Duration:" | awk '{print $2}')
+        local qps=$(echo "$output" | grep "Requests/sec:" | awk '{print $2}')
+        printf "%-10s %12s %10s %10s %12s\n" "$backend" "${total:-?}" "${errors:-?}" "${duration:-?}" "${qps:-?}"
+    done
+}
+
+main() {
+    echo "=========================================="
+    echo "  galay-ssl Backend Sweep"
+    echo "=========================================="
+    echo "Backends: $(echo $BACKENDS)"
+
+    run_case 1 5000 47
+    run_case 10 1000 47
+    run_case 100 100 47
+    run_case 10 200 65536
+
+    echo ""
+    echo "=========================================="
+    echo "  Sweep Complete"
+    echo "=========================================="
+}
+
+main "$@"
@@ -0,0 +1,213 @@
+/**
+ * @file t15_flush.cc
+ * @brief 用途：锁定 SslFlushQueue 的跨连接延迟刷写语义。
+ * 关键覆盖点：绑定队列后 `SslOperationDriver::pollSend()` 只加密入队、不发起写等待；
+ * `SslFlushQueue::flush()` 写出密文；积压超过 `maxPendingBytes` 时回退为普通 send；零长度 send 写出积压；
+ * `SslSocket::setFlushQueue(nullptr)`、移动与析构对队列登记的维护。
+ * 通过条件：flush 前对端读不到任何字节，flush 后对端解密得到完整明文，统计计数符合预期。
+ */
+
+#include "galay-ssl/async/ssl_await.h"
+#include "galay-ssl/async/ssl_socket.h"
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace galay::ssl;
+using namespace galay::kernel;
+
+namespace {
+
+constexpr std::string_view kPayloadA = "deferred-flush-payload-a";
+constexpr std::string_view kPayloadB = "deferred-flush-payload-b";
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * @brief 以 SslOperationDriver 驱动服务端握手，客户端为纯内存 BIO 引擎
+ */
+void driveHandshake(SslSocket& server, SslEngine& client)
+{
+    SslOperationDriver driver(&server);
+    driver.startHandshake();
+
+    for (int i = 0; i < 64 && !driver.completed(); ++i) {
+        const auto wait = driver.poll();
+        if (wait.kind == SslOperationDriver::WaitKind::kWrite) {
+            auto& ctx = driver.sendContext();
+            expect(client.feedEncryptedInput(ctx.m_buffer, ctx.m_length) == static_cast<int>(ctx.m_length),
+                   "client feed failed");
+            driver.onWrite(ctx.m_length);
+            continue;
+        }
+        if (wait.kind == SslOperationDriver::WaitKind::kRead) {
+            if (client.pendingEncryptedOutput() == 0) {
+                const auto ret = client.doHandshake();
+                expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead,
+                       "client handshake failed");
+            }
+            auto& ctx = driver.recvContext();
+            const int produced = client.extractEncryptedOutput(ctx.m_buffer, ctx.m_length);
+            expect(produced > 0, "client produced no handshake bytes");
+            driver.onRead(static_cast<size_t>(produced));
+        }
+    }
+
+    expect(driver.completed(), "server handshake did not complete");
+    expect(driver.takeHandshakeResult().has_value(), "server handshake failed");
+    if (!client.isHandshakeCompleted()) {
+        expect(client.doHandshake() == SslIOResult::Success, "client handshake did not finish");
+    }
+}
+
+size_t readAvailable(int fd, std::vector<char>& out)
+{
+    size_t total = 0;
+    std::array<char, 4096> chunk{};
+    while (true) {
+        const ssize_t n = ::recv(fd, chunk.data(), chunk.size(), MSG_DONTWAIT);
+        if (n <= 0) {
+            break;
+        }
+        out.insert(out.end(), chunk.data(), chunk.data() + n);
+        total += static_cast<size_t>(n);
+    }
+    return total;
+}
+
+std::string decryptAll(SslEngine& client, const std::vector<char>& ciphertext)
+{
+    expect(client.feedEncryptedInput(ciphertext.data(), ciphertext.size()) == static_cast<int>(ciphertext.size()),
+           "client feed ciphertext failed");
+    std::string plaintext;
+    std::array<char, 256> buffer{};
+    while (true) {
+        size_t bytes_read = 0;
+        const auto ret = client.read(buffer.data(), buffer.size(), bytes_read);
+        if (ret != SslIOResult::Success) {
+            break;
+        }
+        plaintext.append(buffer.data(), bytes_read);
+    }
+    return plaintext;
+}
+
+std::expected<size_t, SslError> sendOnce(SslSocket& socket, std::string_view payload, SslOperationDriver::WaitKind& kind)
+{
+    SslOperationDriver driver(&socket);
+    driver.startSend(payload.data(), payload.size());
+    kind = driver.poll().kind;
+    expect(driver.completed() == (kind == SslOperationDriver::WaitKind::kNone), "unexpected send state");
+    if (!driver.completed()) {
+        return std::unexpected(SslError(SslErrorCode::kWriteFailed));
+    }
+    return driver.takeSendResult();
+}
+
+} // namespace
+
+int main()
+{
+    int fds[2];
+    expect(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0, "socketpair failed");
+
+    SslContext server_ctx(SslMethod::TLS_Server);
+    SslContext client_ctx(SslMethod::TLS_Client);
+    expect(server_ctx.isValid(), "server context invalid");
+    expect(client_ctx.isValid(), "client context invalid");
+    expect(server_ctx.loadCertificate("certs/server.crt").has_value(), "load server cert failed");
+    expect(server_ctx.loadPrivateKey("certs/server.key").has_value(), "load server key failed");
+
+    GHandle handle = GHandle::invalid();
+    handle.fd = fds[1];
+    SslSocket server(&server_ctx, handle);
+
+    SslEngine client(&client_ctx);
+    expect(client.initMemoryBIO().has_value(), "client memory BIO failed");
+    client.setConnectState();
+
+    driveHandshake(server, client);
+
+    std::vector<char> wire;
+    readAvailable(fds[0], wire);
+    expect(wire.empty(), "handshake bytes leaked to the socket");
+
+    SslFlushQueue queue({.maxDelay = std::chrono::seconds(10), .maxPendingBytes = 64 * 1024});
+    server.setFlushQueue(&queue);
+    expect(server.flushQueue() == &queue, "flush queue not bound");
+
+    // 两次 send 都应立即完成，且不触碰 socket
+    SslOperationDriver::WaitKind kind{};
+    auto sent_a = sendOnce(server, kPayloadA, kind);
+    expect(kind == SslOperationDriver::WaitKind::kNone, "deferred send waited for IO");
+    expect(sent_a.has_value() && *sent_a == kPayloadA.size(), "deferred send result mismatch");
+    auto sent_b = sendOnce(server, kPayloadB, kind);
+    expect(sent_b.has_value() && *sent_b == kPayloadB.size(), "second deferred send result mismatch");
+    expect(queue.size() == 1, "socket should be queued exactly once");
+    expect(queue.deadline() != SslFlushQueue::Clock::time_point::max(), "deadline not armed");
+    expect(readAvailable(fds[0], wire) == 0, "deferred send wrote before flush");
+
+    const size_t flushed = queue.flush();
+    expect(flushed > 0 && queue.empty(), "flush did not drain the queue");
+    expect(readAvailable(fds[0], wire) == flushed, "flushed bytes mismatch");
+    expect(decryptAll(client, wire) == std::string(kPayloadA) + std::string(kPayloadB),
+           "decrypted payload mismatch");
+    expect(queue.stats().deferred_sends == 2, "deferred_sends mismatch");
+    expect(queue.stats().flushed_bytes == flushed, "flushed_bytes mismatch");
+
+    // 解绑时尽力写出积压并解除登记
+    (void)sendOnce(server, kPayloadA, kind);
+    expect(queue.size() == 1, "socket not queued before detach");
+    server.setFlushQueue(nullptr);
+    expect(queue.empty() && server.flushQueue() == nullptr, "setFlushQueue(nullptr) did not detach");
+    wire.clear();
+    readAvailable(fds[0], wire);
+    expect(decryptAll(client, wire) == kPayloadA, "detach did not flush pending ciphertext");
+
+    // 连接移动后队列登记随之迁移，析构时解除登记
+    server.setFlushQueue(&queue);
+    (void)sendOnce(server, kPayloadB, kind);
+    expect(queue.size() == 1, "socket not queued before move");
+    {
+        SslSocket moved(std::move(server));
+        expect(moved.flushQueue() == &queue && server.flushQueue() == nullptr, "move did not transfer queue");
+        expect(queue.size() == 1, "move changed queue size");
+        wire.clear();
+        expect(queue.flush() > 0 && readAvailable(fds[0], wire) > 0, "moved socket not flushed");
+        expect(decryptAll(client, wire) == kPayloadB, "moved socket payload mismatch");
+
+        // 超过积压上限时回退为普通 send：需要写等待，不再入队
+        std::string large(queue.options().maxPendingBytes + 1, 'x');
+        auto fallback = sendOnce(moved, large, kind);
+        expect(!fallback.has_value() && kind == SslOperationDriver::WaitKind::kWrite, "oversized send was deferred");
+        expect(queue.empty() && queue.stats().fallback_sends == 1, "fallback not accounted");
+
+        (void)sendOnce(moved, kPayloadA, kind);
+        expect(queue.size() == 1, "socket not queued before destruction");
+
+        // 零长度 send 不走延迟路径，而是把积压交给普通写路径（调度器模式下的排空即用它等待可写）
+        SslOperationDriver drain(&moved);
+        drain.startSend(nullptr, 0);
+        expect(drain.poll().kind == SslOperationDriver::WaitKind::kWrite && drain.sendContext().m_length > 0,
+               "zero-length send did not write the backlog");
+    }
+    expect(queue.empty(), "socket destruction did not detach");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return 0;
+}
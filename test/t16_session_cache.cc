@@ -0,0 +1,231 @@
+/**
+ * @file t16_session_cache.cc
+ * @brief 用途：锁定 SslSessionCache 与 SslContext::setSessionCache() 的服务端恢复语义。
+ * 关键覆盖点：两个服务端上下文共享同一缓存时跨上下文恢复（TLS 1.2 session id / TLS 1.3 有状态 ticket）、
+ * 命中/未命中计数、分片 LRU 淘汰、过期条目在查找时删除、分离缓存后恢复 num_tickets 与 session id context。
+ * 通过条件：第二次握手 `isSessionReused()` 为 true 且缓存命中计数增加，淘汰与过期计数符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_session_cache.h"
+
+#include <array>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    while (from.pendingEncryptedOutput() > 0) {
+        std::vector<char> buffer(from.pendingEncryptedOutput());
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        expect(produced > 0, "extractEncryptedOutput failed");
+        expect(to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) == produced,
+               "feedEncryptedInput failed");
+    }
+}
+
+void completeHandshake(SslEngine& client, SslEngine& server)
+{
+    for (int i = 0; i < 64; ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead ||
+                       ret == SslIOResult::WantWrite,
+                   "client handshake failed");
+        }
+        transferPending(client, server);
+        if (!server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead ||
+                       ret == SslIOResult::WantWrite,
+                   "server handshake failed");
+        }
+        transferPending(server, client);
+        if (client.isHandshakeCompleted() && server.isHandshakeCompleted()) {
+            // TLS 1.3 的 NewSessionTicket 在握手后到达，读一次让客户端处理
+            std::array<char, 16> scratch{};
+            size_t bytes_read = 0;
+            (void)client.read(scratch.data(), scratch.size(), bytes_read);
+            return;
+        }
+    }
+    throw std::runtime_error("handshake did not complete");
+}
+
+/**
+ * @brief 建立一次连接；resume 非空时尝试恢复，返回客户端拿到的新 session
+ */
+SSL_SESSION* connectOnce(SslContext& client_ctx, SslContext& server_ctx, SSL_SESSION* resume, bool& reused)
+{
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value(), "client memory BIO failed");
+    expect(server.initMemoryBIO().has_value(), "server memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+    if (resume) {
+        expect(client.setSession(resume), "client setSession failed");
+    }
+
+    completeHandshake(client, server);
+    reused = server.isSessionReused();
+    expect(reused == client.isSessionReused(), "client/server reuse flag mismatch");
+    SSL_SESSION* session = SSL_get1_session(client.native());
+
+    // 未发送 close_notify 就释放的连接会被 OpenSSL 视为坏 session 并从缓存中移除
+    (void)server.shutdown();
+    (void)client.shutdown();
+    return session;
+}
+
+void loadServer(SslContext& ctx)
+{
+    expect(ctx.isValid(), "server context invalid");
+    expect(ctx.loadCertificate("certs/server.crt").has_value(), "load server cert failed");
+    expect(ctx.loadPrivateKey("certs/server.key").has_value(), "load server key failed");
+}
+
+void checkResumption(SslMethod server_method, SslMethod client_method)
+{
+    auto cache = std::make_shared<SslSessionCache>(SslSessionCacheOptions{.capacity = 64, .shards = 4});
+
+    // 两个 worker 各自的上下文共享同一缓存
+    SslContext worker_a(server_method);
+    SslContext worker_b(server_method);
+    loadServer(worker_a);
+    loadServer(worker_b);
+    worker_a.setSessionCache(cache);
+    worker_b.setSessionCache(cache);
+    expect(worker_a.sessionCache() == cache, "session cache not attached");
+
+    SslContext client_ctx(client_method);
+    expect(client_ctx.isValid(), "client context invalid");
+
+    bool reused = true;
+    SSL_SESSION* session = connectOnce(client_ctx, worker_a, nullptr, reused);
+    expect(session != nullptr, "client did not receive a session");
+    expect(!reused, "first handshake should be full");
+    expect(cache->stats().inserts >= 1 && cache->size() >= 1, "session not stored in cache");
+
+    SSL_SESSION* resumed = connectOnce(client_ctx, worker_b, session, reused);
+    expect(reused, "second handshake did not resume through the shared cache");
+    expect(cache->stats().hits == 1, "cache hit not counted");
+
+    SSL_SESSION_free(resumed);
+    SSL_SESSION_free(session);
+}
+
+void checkDetach()
+{
+    auto cache = std::make_shared<SslSessionCache>(SslSessionCacheOptions{.capacity = 8, .shards = 1});
+    SslContext server(SslMethod::TLS_1_3_Server);
+    loadServer(server);
+    SSL_CTX_set_num_tickets(server.native(), 0);
+    server.setSessionCache(cache);
+    expect(SSL_CTX_get_num_tickets(server.native()) == 1, "num_tickets not raised");
+    server.setSessionCache(nullptr);
+    expect(SSL_CTX_get_num_tickets(server.native()) == 0, "num_tickets not restored");
+
+    // 用户自己设置的 num_tickets 原样保留
+    SSL_CTX_set_num_tickets(server.native(), 3);
+    server.setSessionCache(cache);
+    server.setSessionCache(nullptr);
+    expect(SSL_CTX_get_num_tickets(server.native()) == 3, "custom num_tickets lost");
+
+    // 分离后新 session 不再带固定的 session id context
+    SslContext client_ctx(SslMethod::TLS_1_3_Client);
+    SslEngine client(&client_ctx);
+    SslEngine engine(&server);
+    expect(client.initMemoryBIO().has_value() && engine.initMemoryBIO().has_value(), "memory BIO failed");
+    client.setConnectState();
+    engine.setAcceptState();
+    completeHandshake(client, engine);
+    unsigned int length = 1;
+    (void)SSL_SESSION_get0_id_context(SSL_get_session(engine.native()), &length);
+    expect(length == 0, "session id context not cleared");
+}
+
+SSL_SESSION* makeSession(unsigned char tag, long timeout)
+{
+    SSL_SESSION* session = SSL_SESSION_new();
+    std::array<unsigned char, 32> id{};
+    id.fill(tag);
+    SSL_SESSION_set1_id(session, id.data(), static_cast<unsigned int>(id.size()));
+    SSL_SESSION_set_time(session, static_cast<long>(std::time(nullptr)));
+    SSL_SESSION_set_timeout(session, timeout);
+    return session;
+}
+
+void checkEvictionAndExpiry()
+{
+    SslSessionCache cache(SslSessionCacheOptions{.capacity = 2, .shards = 1});
+    expect(cache.shardCount() == 1 && cache.shardCapacity() == 2, "unexpected shard layout");
+
+    std::array<unsigned char, 32> id_a{};
+    std::array<unsigned char, 32> id_c{};
+    id_a.fill(1);
+    id_c.fill(3);
+
+    for (unsigned char tag = 1; tag <= 2; ++tag) {
+        SSL_SESSION* session = makeSession(tag, 300);
+        expect(cache.store(std::array<unsigned char, 32>{}.data(), 0, session) == false, "empty id accepted");
+        std::array<unsigned char, 32> id{};
+        id.fill(tag);
+        expect(cache.store(id.data(), id.size(), session), "store failed");
+        SSL_SESSION_free(session);
+    }
+
+    // 访问 1 使 2 成为最久未使用
+    SSL_SESSION* hit = cache.load(id_a.data(), id_a.size());
+    expect(hit != nullptr, "lookup of stored session failed");
+    SSL_SESSION_free(hit);
+
+    SSL_SESSION* third = makeSession(3, 300);
+    expect(cache.store(id_c.data(), id_c.size(), third), "store third failed");
+    SSL_SESSION_free(third);
+
+    std::array<unsigned char, 32> id_b{};
+    id_b.fill(2);
+    expect(cache.load(id_b.data(), id_b.size()) == nullptr, "LRU victim still present");
+    expect(cache.stats().evictions == 1, "eviction not counted");
+
+    // 过期条目在查找时删除
+    SSL_SESSION* stale = makeSession(4, 1);
+    SSL_SESSION_set_time(stale, static_cast<long>(std::time(nullptr)) - 10);
+    std::array<unsigned char, 32> id_d{};
+    id_d.fill(4);
+    expect(cache.store(id_d.data(), id_d.size(), stale), "store stale failed");
+    SSL_SESSION_free(stale);
+    expect(cache.load(id_d.data(), id_d.size()) == nullptr, "expired session returned");
+    expect(cache.stats().expired == 1, "expiry not counted");
+
+    cache.erase(id_c.data(), id_c.size());
+    expect(cache.stats().removals == 1, "removal not counted");
+    cache.clear();
+    expect(cache.size() == 0, "clear left entries behind");
+}
+
+} // namespace
+
+int main()
+{
+    checkResumption(SslMethod::TLS_1_2_Server, SslMethod::TLS_1_2_Client);
+    checkResumption(SslMethod::TLS_1_3_Server, SslMethod::TLS_1_3_Client);
+    checkEvictionAndExpiry();
+    checkDetach();
+    return 0;
+}
@@ -0,0 +1,273 @@
+/**
+ * @file t17_shm_session_cache.cc
+ * @brief 用途：锁定 SslShmSessionCache 的跨进程共享语义。
+ * 关键覆盖点：父进程握手写入的 session 在 fork 出的子进程（独立映射）中恢复、
+ * 槽位参数不一致时 open() 失败、超长 session 被拒绝、过期与删除计数、创建者未写完头部即退出的文件重新初始化。
+ * 通过条件：子进程 `isSessionReused()` 为 true 并以 0 退出，共享计数与预期一致。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_shm_session_cache.h"
+
+#include <array>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    while (from.pendingEncryptedOutput() > 0) {
+        std::vector<char> buffer(from.pendingEncryptedOutput());
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        expect(produced > 0, "extractEncryptedOutput failed");
+        expect(to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) == produced,
+               "feedEncryptedInput failed");
+    }
+}
+
+void completeHandshake(SslEngine& client, SslEngine& server)
+{
+    for (int i = 0; i < 64; ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead ||
+                       ret == SslIOResult::WantWrite,
+                   "client handshake failed");
+        }
+        transferPending(client, server);
+        if (!server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead ||
+                       ret == SslIOResult::WantWrite,
+                   "server handshake failed");
+        }
+        transferPending(server, client);
+        if (client.isHandshakeCompleted() && server.isHandshakeCompleted()) {
+            std::array<char, 16> scratch{};
+            size_t bytes_read = 0;
+            (void)client.read(scratch.data(), scratch.size(), bytes_read);
+            return;
+        }
+    }
+    throw std::runtime_error("handshake did not complete");
+}
+
+SSL_SESSION* connectOnce(SslContext& client_ctx, SslContext& server_ctx, SSL_SESSION* resume, bool& reused)
+{
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value(), "client memory BIO failed");
+    expect(server.initMemoryBIO().has_value(), "server memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+    if (resume) {
+        expect(client.setSession(resume), "client setSession failed");
+    }
+
+    completeHandshake(client, server);
+    reused = server.isSessionReused();
+    expect(reused == client.isSessionReused(), "client/server reuse flag mismatch");
+    SSL_SESSION* session = SSL_get1_session(client.native());
+
+    (void)server.shutdown();
+    (void)client.shutdown();
+    return session;
+}
+
+std::unique_ptr<SslContext> makeServer(SslMethod method, std::shared_ptr<SslSessionStore> cache)
+{
+    auto ctx = std::make_unique<SslContext>(method);
+    expect(ctx->isValid(), "server context invalid");
+    expect(ctx->loadCertificate("certs/server.crt").has_value(), "load server cert failed");
+    expect(ctx->loadPrivateKey("certs/server.key").has_value(), "load server key failed");
+    ctx->setSessionCache(std::move(cache));
+    return ctx;
+}
+
+std::string tempPath(const char* tag)
+{
+    return "/tmp/galay-ssl-t17-" + std::to_string(::getpid()) + "-" + tag;
+}
+
+void checkCrossProcessResumption(SslMethod server_method, SslMethod client_method, const char* tag)
+{
+    const std::string path = tempPath(tag);
+    ::unlink(path.c_str());
+    const SslShmSessionCacheOptions options{.slots = 256, .maxSessionBytes = 4096};
+
+    auto cache = SslShmSessionCache::open(path, options);
+    expect(cache.has_value(), "open shared cache failed");
+    auto server_ctx = makeServer(server_method, *cache);
+    SslContext client_ctx(client_method);
+    expect(client_ctx.isValid(), "client context invalid");
+
+    bool reused = true;
+    SSL_SESSION* session = connectOnce(client_ctx, *server_ctx, nullptr, reused);
+    expect(session != nullptr, "client did not receive a session");
+    expect(!reused, "first handshake should be full");
+    expect((*cache)->stats().inserts >= 1, "session not stored in shared cache");
+
+    // 子进程独立映射同一文件并用自己的服务端上下文恢复，模拟 SO_REUSEPORT 下的另一个进程
+    const pid_t pid = ::fork();
+    expect(pid >= 0, "fork failed");
+    if (pid == 0) {
+        int code = 1;
+        try {
+            auto peer_cache = SslShmSessionCache::open(path, options);
+            expect(peer_cache.has_value(), "child open failed");
+            auto peer_ctx = makeServer(server_method, *peer_cache);
+            bool child_reused = false;
+            SSL_SESSION* resumed = connectOnce(client_ctx, *peer_ctx, session, child_reused);
+            SSL_SESSION_free(resumed);
+            code = child_reused ? 0 : 2;
+        } catch (...) {
+            code = 3;
+        }
+        ::_exit(code);
+    }
+
+    int status = 0;
+    expect(::waitpid(pid, &status, 0) == pid, "waitpid failed");
+    expect(WIFEXITED(status) && WEXITSTATUS(status) == 0, "child process did not resume through the shared cache");
+    expect((*cache)->stats().hits >= 1, "cross-process hit not visible in shared counters");
+
+    SSL_SESSION_free(session);
+    ::unlink(path.c_str());
+}
+
+/**
+ * @brief 构造可序列化的 session（i2d 要求协议版本与 cipher 已设置）
+ */
+SSL_SESSION* makeSession(unsigned char tag, long timeout)
+{
+    SslContext ctx(SslMethod::TLS_1_2_Client);
+    SSL* ssl = SSL_new(ctx.native());
+    const SSL_CIPHER* cipher = SSL_CIPHER_find(ssl, reinterpret_cast<const unsigned char*>("\xc0\x2f"));
+    SSL_free(ssl);
+    expect(cipher != nullptr, "cipher lookup failed");
+
+    SSL_SESSION* session = SSL_SESSION_new();
+    SSL_SESSION_set_protocol_version(session, TLS1_2_VERSION);
+    SSL_SESSION_set_cipher(session, cipher);
+    std::array<unsigned char, 32> id{};
+    id.fill(tag);
+    SSL_SESSION_set1_id(session, id.data(), static_cast<unsigned int>(id.size()));
+    SSL_SESSION_set_time(session, static_cast<long>(std::time(nullptr)));
+    SSL_SESSION_set_timeout(session, timeout);
+    return session;
+}
+
+void checkSlotSemantics()
+{
+    const std::string path = tempPath("slots");
+    ::unlink(path.c_str());
+
+    auto cache = SslShmSessionCache::open(path, SslShmSessionCacheOptions{.slots = 100, .maxSessionBytes = 512});
+    expect(cache.has_value(), "open failed");
+    expect((*cache)->slotCount() == 128, "slot count not rounded up to a power of two");
+
+    auto mismatch = SslShmSessionCache::open(path, SslShmSessionCacheOptions{.slots = 64, .maxSessionBytes = 512});
+    expect(!mismatch.has_value() && mismatch.error().code() == SslErrorCode::kSessionCacheFailed,
+           "mismatched layout accepted");
+
+    // 第二个映射与第一个看到同一份数据
+    auto other = SslShmSessionCache::open(path, SslShmSessionCacheOptions{.slots = 100, .maxSessionBytes = 512});
+    expect(other.has_value(), "second mapping failed");
+
+    std::array<unsigned char, 32> id_a{};
+    id_a.fill(1);
+    SSL_SESSION* session = makeSession(1, 300);
+    expect((*cache)->store(id_a.data(), id_a.size(), session), "store failed");
+    SSL_SESSION_free(session);
+
+    SSL_SESSION* hit = (*other)->load(id_a.data(), id_a.size());
+    expect(hit != nullptr, "lookup through second mapping failed");
+    unsigned int hit_length = 0;
+    const unsigned char* hit_id = SSL_SESSION_get_id(hit, &hit_length);
+    expect(hit_length == id_a.size() && hit_id[0] == 1, "loaded session id mismatch");
+    SSL_SESSION_free(hit);
+
+    // 超过 maxSessionBytes 的 session 不缓存
+    SSL_SESSION* large = makeSession(2, 300);
+    expect(SSL_SESSION_set1_hostname(large, std::string(600, 'h').c_str()) == 1, "set hostname failed");
+    std::array<unsigned char, 32> id_b{};
+    id_b.fill(2);
+    expect(!(*cache)->store(id_b.data(), id_b.size(), large), "oversized session accepted");
+    SSL_SESSION_free(large);
+    expect((*other)->stats().rejected == 1, "rejection not counted");
+
+    // 过期条目不返回
+    SSL_SESSION* stale = makeSession(3, 1);
+    SSL_SESSION_set_time(stale, static_cast<long>(std::time(nullptr)) - 10);
+    std::array<unsigned char, 32> id_c{};
+    id_c.fill(3);
+    expect((*cache)->store(id_c.data(), id_c.size(), stale), "store stale failed");
+    SSL_SESSION_free(stale);
+    expect((*other)->load(id_c.data(), id_c.size()) == nullptr, "expired session returned");
+    expect((*cache)->stats().expired == 1, "expiry not counted");
+
+    (*other)->erase(id_a.data(), id_a.size());
+    expect((*cache)->load(id_a.data(), id_a.size()) == nullptr, "erased session still present");
+    const auto stats = (*cache)->stats();
+    expect(stats.removals == 1 && stats.hits == 1 && stats.size == 0, "unexpected shared counters");
+
+    ::unlink(path.c_str());
+}
+
+/**
+ * @brief 模拟创建者 ftruncate 后、写 magic 前退出：留下大小任意、全零的文件
+ */
+void checkInterruptedCreation()
+{
+    const std::string path = tempPath("interrupted");
+    for (const off_t size : {static_cast<off_t>(4096), static_cast<off_t>(1 << 20)}) {
+        ::unlink(path.c_str());
+        FILE* file = std::fopen(path.c_str(), "w");
+        expect(file != nullptr && ::ftruncate(::fileno(file), size) == 0, "create zeroed file failed");
+        std::fclose(file);
+
+        const SslShmSessionCacheOptions options{.slots = 16, .maxSessionBytes = 512};
+        auto cache = SslShmSessionCache::open(path, options);
+        expect(cache.has_value(), "half-initialized file not recovered");
+        auto other = SslShmSessionCache::open(path, options);
+        expect(other.has_value(), "recovered file not reopened");
+
+        std::array<unsigned char, 32> id{};
+        id.fill(4);
+        SSL_SESSION* session = makeSession(4, 300);
+        expect((*cache)->store(id.data(), id.size(), session), "store after recovery failed");
+        SSL_SESSION_free(session);
+        SSL_SESSION* hit = (*other)->load(id.data(), id.size());
+        expect(hit != nullptr, "lookup after recovery failed");
+        SSL_SESSION_free(hit);
+    }
+    ::unlink(path.c_str());
+}
+
+} // namespace
+
+int main()
+{
+    checkSlotSemantics();
+    checkInterruptedCreation();
+    checkCrossProcessResumption(SslMethod::TLS_1_2_Server, SslMethod::TLS_1_2_Client, "tls12");
+    checkCrossProcessResumption(SslMethod::TLS_1_3_Server, SslMethod::TLS_1_3_Client, "tls13");
+    return 0;
+}
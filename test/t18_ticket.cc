@@ -0,0 +1,281 @@
+/**
+ * @file t18_ticket.cc
+ * @brief 用途：锁定 SslTicketKeyRing 与 SslContext::setSessionTicketKeys() 的无状态恢复语义。
+ * 关键覆盖点：不同服务端上下文共享密钥环时跨上下文恢复（TLS 1.2 / TLS 1.3）、轮换后旧密钥仍可解密并要求换新、
+ * 旧密钥被淘汰后回退完整握手、同一密钥文件加载出的两个密钥环互相恢复、关闭后不再签发 ticket、
+ * 后台线程按间隔轮换（不依赖握手触发），来源失败时经 onRotateFailure 上报并保留原密钥。
+ * 通过条件：各场景 `isSessionReused()` 与密钥环计数符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_ticket_keys.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    while (from.pendingEncryptedOutput() > 0) {
+        std::vector<char> buffer(from.pendingEncryptedOutput());
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        expect(produced > 0, "extractEncryptedOutput failed");
+        expect(to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) == produced,
+               "feedEncryptedInput failed");
+    }
+}
+
+void completeHandshake(SslEngine& client, SslEngine& server)
+{
+    for (int i = 0; i < 64; ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead ||
+                       ret == SslIOResult::WantWrite,
+                   "client handshake failed");
+        }
+        transferPending(client, server);
+        if (!server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead ||
+                       ret == SslIOResult::WantWrite,
+                   "server handshake failed");
+        }
+        transferPending(server, client);
+        if (client.isHandshakeCompleted() && server.isHandshakeCompleted()) {
+            // TLS 1.3 的 NewSessionTicket 在握手后到达，读一次让客户端处理
+            std::array<char, 16> scratch{};
+            size_t bytes_read = 0;
+            (void)client.read(scratch.data(), scratch.size(), bytes_read);
+            return;
+        }
+    }
+    throw std::runtime_error("handshake did not complete");
+}
+
+SSL_SESSION* connectOnce(SslContext& client_ctx, SslContext& server_ctx, SSL_SESSION* resume, bool& reused)
+{
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value(), "client memory BIO failed");
+    expect(server.initMemoryBIO().has_value(), "server memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+    if (resume) {
+        expect(client.setSession(resume), "client setSession failed");
+    }
+
+    completeHandshake(client, server);
+    reused = server.isSessionReused();
+    expect(reused == client.isSessionReused(), "client/server reuse flag mismatch");
+    SSL_SESSION* session = SSL_get1_session(client.native());
+
+    (void)server.shutdown();
+    (void)client.shutdown();
+    return session;
+}
+
+/**
+ * @brief 每次新建服务端上下文，保证恢复只能来自 ticket 而不是上下文内置缓存
+ */
+std::unique_ptr<SslContext> makeServer(SslMethod method, std::shared_ptr<SslTicketKeyRing> ring)
+{
+    auto ctx = std::make_unique<SslContext>(method);
+    expect(ctx->isValid(), "server context invalid");
+    expect(ctx->loadCertificate("certs/server.crt").has_value(), "load server cert failed");
+    expect(ctx->loadPrivateKey("certs/server.key").has_value(), "load server key failed");
+    ctx->setSessionTicketKeys(std::move(ring));
+    return ctx;
+}
+
+void checkSharedRing(SslMethod server_method, SslMethod client_method)
+{
+    auto ring = std::make_shared<SslTicketKeyRing>();
+    auto worker_a = makeServer(server_method, ring);
+    auto worker_b = makeServer(server_method, ring);
+    expect(worker_a->sessionTicketKeys() == ring, "ticket keys not attached");
+
+    SslContext client_ctx(client_method);
+    bool reused = true;
+    SSL_SESSION* session = connectOnce(client_ctx, *worker_a, nullptr, reused);
+    expect(session != nullptr && SSL_SESSION_has_ticket(session) == 1, "client did not receive a ticket");
+    expect(!reused, "first handshake should be full");
+    expect(ring->stats().issued >= 1, "ticket issue not counted");
+
+    SSL_SESSION* resumed = connectOnce(client_ctx, *worker_b, session, reused);
+    expect(reused, "ticket did not resume on another context");
+    expect(ring->stats().resumed == 1, "ticket decrypt not counted");
+
+    SSL_SESSION_free(resumed);
+    SSL_SESSION_free(session);
+}
+
+void checkRotation()
+{
+    auto ring = std::make_shared<SslTicketKeyRing>(SslTicketKeyRingOptions{
+        .rotationInterval = std::chrono::seconds(0),
+        .maxKeys = 2,
+    });
+    SslContext client_ctx(SslMethod::TLS_1_2_Client);
+
+    bool reused = true;
+    auto first = makeServer(SslMethod::TLS_1_2_Server, ring);
+    SSL_SESSION* session = connectOnce(client_ctx, *first, nullptr, reused);
+    expect(session != nullptr && !reused, "initial handshake failed");
+    // 续签时 OpenSSL 客户端会把原 session 标记为不可恢复，先留一份序列化副本给最后一轮
+    std::vector<unsigned char> der(static_cast<size_t>(i2d_SSL_SESSION(session, nullptr)));
+    unsigned char* der_out = der.data();
+    i2d_SSL_SESSION(session, &der_out);
+
+    // 轮换一次：旧密钥仍在环内，可恢复且要求换新 ticket
+    expect(ring->rotate().has_value(), "rotate failed");
+    expect(ring->keyCount() == 2, "previous key not retained");
+    auto second = makeServer(SslMethod::TLS_1_2_Server, ring);
+    SSL_SESSION* renewed = connectOnce(client_ctx, *second, session, reused);
+    expect(reused, "ticket under previous key did not resume");
+    expect(ring->stats().renewed == 1, "renewal not counted");
+    SSL_SESSION_free(renewed);
+
+    // 再轮换一次：最初的密钥被淘汰，回退完整握手
+    expect(ring->rotate().has_value(), "second rotate failed");
+    auto third = makeServer(SslMethod::TLS_1_2_Server, ring);
+    const unsigned char* der_in = der.data();
+    SSL_SESSION* stale = d2i_SSL_SESSION(nullptr, &der_in, static_cast<long>(der.size()));
+    expect(stale != nullptr, "session copy failed");
+    SSL_SESSION* fresh = connectOnce(client_ctx, *third, stale, reused);
+    expect(!reused, "ticket under retired key still resumed");
+    const auto stats = ring->stats();
+    expect(stats.unknownKey == 1 && stats.rotations == 2, "unexpected rotation counters");
+
+    SSL_SESSION_free(fresh);
+    SSL_SESSION_free(stale);
+    SSL_SESSION_free(session);
+}
+
+void checkKeyFile()
+{
+    const std::string path = "/tmp/galay-ssl-t18-" + std::to_string(::getpid()) + ".key";
+    auto key = SslTicketKey::generate();
+    expect(key.has_value(), "generate key failed");
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        const auto bytes = key->toBytes();
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    // 两个独立加载的密钥环模拟两个进程
+    auto ring_a = SslTicketKeyRing::fromFile(path);
+    auto ring_b = SslTicketKeyRing::fromFile(path);
+    expect(ring_a.has_value() && ring_b.has_value(), "load key file failed");
+    expect((*ring_a)->keyCount() == 1, "unexpected key count from file");
+
+    auto server_a = makeServer(SslMethod::TLS_1_3_Server, *ring_a);
+    auto server_b = makeServer(SslMethod::TLS_1_3_Server, *ring_b);
+    SslContext client_ctx(SslMethod::TLS_1_3_Client);
+
+    bool reused = true;
+    SSL_SESSION* session = connectOnce(client_ctx, *server_a, nullptr, reused);
+    expect(session != nullptr && !reused, "initial handshake failed");
+    SSL_SESSION* resumed = connectOnce(client_ctx, *server_b, session, reused);
+    expect(reused, "ticket from key file did not resume in the other ring");
+    SSL_SESSION_free(resumed);
+    SSL_SESSION_free(session);
+
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write("short", 5);
+    }
+    auto broken = SslTicketKeyRing::fromFile(path);
+    expect(!broken.has_value() && broken.error().code() == SslErrorCode::kTicketKeyFailed,
+           "truncated key file accepted");
+    // 来源失败时保留原有密钥
+    expect(!(*ring_a)->rotate().has_value(), "rotate from broken file succeeded");
+    expect((*ring_a)->keyCount() == 1 && (*ring_a)->stats().rotateFailures == 1, "keys lost on failed reload");
+
+    ::unlink(path.c_str());
+}
+
+void checkDisable()
+{
+    auto server = makeServer(SslMethod::TLS_1_2_Server, std::make_shared<SslTicketKeyRing>());
+    server->setSessionTicketKeys(nullptr);
+    expect((SSL_CTX_get_options(server->native()) & SSL_OP_NO_TICKET) != 0, "SSL_OP_NO_TICKET not restored");
+
+    SslContext client_ctx(SslMethod::TLS_1_2_Client);
+    bool reused = true;
+    SSL_SESSION* session = connectOnce(client_ctx, *server, nullptr, reused);
+    expect(session != nullptr && SSL_SESSION_has_ticket(session) == 0, "ticket issued after disabling");
+    SSL_SESSION_free(session);
+}
+
+void checkBackgroundRotation()
+{
+    auto key = SslTicketKey::generate();
+    expect(key.has_value(), "generate key failed");
+
+    // 来源第一次返回密钥，之后失败
+    std::atomic<int> calls{0};
+    std::atomic<int> reported{0};
+    SslTicketKeyRingOptions options;
+    options.rotationInterval = std::chrono::seconds(1);
+    options.onRotateFailure = [&](const SslError& error) {
+        if (error.code() == SslErrorCode::kTicketKeyFailed) {
+            reported.fetch_add(1);
+        }
+    };
+    auto failing = SslTicketKeyRing::fromSource(
+        [&]() -> std::expected<std::vector<SslTicketKey>, SslError> {
+            if (calls.fetch_add(1) == 0) {
+                return std::vector<SslTicketKey>{*key};
+            }
+            return std::unexpected(SslError(SslErrorCode::kTicketKeyFailed));
+        },
+        options);
+    expect(failing.has_value(), "create ring from source failed");
+
+    SslTicketKeyRingOptions random_options;
+    random_options.rotationInterval = std::chrono::seconds(1);
+    auto random = SslTicketKeyRing::create(random_options);
+    expect(random.has_value() && (*random)->keyCount() == 1, "create random ring failed");
+
+    // 没有任何握手，轮换由密钥环自己的线程完成
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((reported.load() == 0 || (*random)->stats().rotations == 0) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    expect((*random)->stats().rotations >= 1 && (*random)->keyCount() == 2, "background rotation did not run");
+    expect(reported.load() >= 1 && (*failing)->stats().rotateFailures >= 1, "source failure not reported");
+    expect((*failing)->keyCount() == 1, "keys lost on failed background rotation");
+}
+
+} // namespace
+
+int main()
+{
+    checkSharedRing(SslMethod::TLS_1_2_Server, SslMethod::TLS_1_2_Client);
+    checkSharedRing(SslMethod::TLS_1_3_Server, SslMethod::TLS_1_3_Client);
+    checkRotation();
+    checkKeyFile();
+    checkDisable();
+    checkBackgroundRotation();
+    return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file t19_client_session_cache.cc
+ * @brief 用途：锁定 SslClientSessionCache 与 SslContext::setClientSessionCache() 的客户端自动恢复语义。
+ * 关键覆盖点：握手前按 host:port + SNI 自动取用、握手后自动存回；TLS 1.2 session 可重复使用；
+ * TLS 1.3 多张 ticket 逐张消费；不同 SNI 互不干扰；快照写盘后新缓存加载即可恢复。
+ * 通过条件：各场景 `isSessionReused()` 与缓存计数符合预期，调用方无需持有 SSL_SESSION。
+ */
+
+#include "galay-ssl/ssl/ssl_client_session_cache.h"
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+constexpr const char* kPeer = "127.0.0.1:8443";
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    while (from.pendingEncryptedOutput() > 0) {
+        std::vector<char> buffer(from.pendingEncryptedOutput());
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        expect(produced > 0, "extractEncryptedOutput failed");
+        expect(to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) == produced,
+               "feedEncryptedInput failed");
+    }
+}
+
+void completeHandshake(SslEngine& client, SslEngine& server)
+{
+    for (int i = 0; i < 64; ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead ||
+                       ret == SslIOResult::WantWrite,
+                   "client handshake failed");
+        }
+        transferPending(client, server);
+        if (!server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead ||
+                       ret == SslIOResult::WantWrite,
+                   "server handshake failed");
+        }
+        transferPending(server, client);
+        if (client.isHandshakeCompleted() && server.isHandshakeCompleted()) {
+            // TLS 1.3 的 NewSessionTicket 在握手后到达，读一次让客户端处理
+            std::array<char, 16> scratch{};
+            size_t bytes_read = 0;
+            (void)client.read(scratch.data(), scratch.size(), bytes_read);
+            return;
+        }
+    }
+    throw std::runtime_error("handshake did not complete");
+}
+
+/**
+ * @brief 按 SslSocket::handshake() 的顺序建立一次连接：设置 SNI，再从缓存恢复
+ */
+bool connectOnce(SslContext& client_ctx, SslContext& server_ctx, const std::string& sni, bool& restored)
+{
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value(), "client memory BIO failed");
+    expect(server.initMemoryBIO().has_value(), "server memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+    if (!sni.empty()) {
+        expect(client.setHostname(sni).has_value(), "set SNI failed");
+    }
+    restored = client.restoreCachedSession(kPeer);
+
+    completeHandshake(client, server);
+    const bool reused = server.isSessionReused();
+    expect(reused == client.isSessionReused(), "client/server reuse flag mismatch");
+
+    (void)server.shutdown();
+    (void)client.shutdown();
+    return reused;
+}
+
+std::unique_ptr<SslContext> makeServer(SslMethod method, int tickets)
+{
+    auto ctx = std::make_unique<SslContext>(method);
+    expect(ctx->isValid(), "server context invalid");
+    expect(ctx->loadCertificate("certs/server.crt").has_value(), "load server cert failed");
+    expect(ctx->loadPrivateKey("certs/server.key").has_value(), "load server key failed");
+    ctx->setSessionTicketKeys(std::make_shared<SslTicketKeyRing>());
+    SSL_CTX_set_num_tickets(ctx->native(), static_cast<size_t>(tickets));
+    return ctx;
+}
+
+void checkTls12Reuse()
+{
+    auto server = makeServer(SslMethod::TLS_1_2_Server, 1);
+    auto cache = std::make_shared<SslClientSessionCache>();
+    SslContext client_ctx(SslMethod::TLS_1_2_Client);
+    client_ctx.setClientSessionCache(cache);
+    expect(client_ctx.clientSessionCache() == cache, "client cache not attached");
+
+    bool restored = true;
+    expect(!connectOnce(client_ctx, *server, "localhost", restored) && !restored, "first handshake should be full");
+    expect(cache->stats().sessions == 1, "TLS 1.2 session not stored");
+
+    // TLS 1.2 session 可重复使用，连续两次都恢复
+    for (int i = 0; i < 2; ++i) {
+        expect(connectOnce(client_ctx, *server, "localhost", restored) && restored, "TLS 1.2 session not resumed");
+    }
+    expect(cache->stats().hits == 2 && cache->stats().sessions == 1, "unexpected TLS 1.2 cache counters");
+
+    // 不同 SNI 使用不同 key
+    expect(!connectOnce(client_ctx, *server, "other.local", restored) && !restored, "SNI keys not separated");
+    expect(cache->stats().peers == 2, "second SNI not stored separately");
+}
+
+void checkTls13MultiTicket()
+{
+    auto server = makeServer(SslMethod::TLS_1_3_Server, 4);
+    auto cache = std::make_shared<SslClientSessionCache>(SslClientSessionCacheOptions{.ticketsPerPeer = 3});
+    SslContext client_ctx(SslMethod::TLS_1_3_Client);
+    client_ctx.setClientSessionCache(cache);
+
+    bool restored = true;
+    expect(!connectOnce(client_ctx, *server, "localhost", restored), "first handshake should be full");
+    expect(cache->stats().sessions == 3, "TLS 1.3 tickets not bounded by ticketsPerPeer");
+
+    // 每次恢复消费一张 ticket；密钥未过期时 OpenSSL 恢复握手不再补发
+    expect(connectOnce(client_ctx, *server, "localhost", restored) && restored, "TLS 1.3 ticket not resumed");
+    expect(cache->stats().sessions == 2, "ticket not consumed");
+    expect(connectOnce(client_ctx, *server, "localhost", restored) && restored, "second ticket not resumed");
+    expect(cache->stats().hits == 2 && cache->stats().sessions == 1, "unexpected ticket counters");
+}
+
+void checkSnapshot()
+{
+    const std::string path = "/tmp/galay-ssl-t19-" + std::to_string(::getpid()) + ".sessions";
+    auto server = makeServer(SslMethod::TLS_1_3_Server, 2);
+
+    {
+        auto cache = std::make_shared<SslClientSessionCache>();
+        SslContext client_ctx(SslMethod::TLS_1_3_Client);
+        client_ctx.setClientSessionCache(cache);
+        bool restored = true;
+        expect(!connectOnce(client_ctx, *server, "localhost", restored), "first handshake should be full");
+        auto saved = cache->save(path);
+        expect(saved.has_value() && *saved == 2, "snapshot save failed");
+    }
+
+    // 模拟进程重启：新上下文、新缓存，从快照加载后直接恢复
+    auto cache = std::make_shared<SslClientSessionCache>();
+    auto loaded = cache->load(path);
+    expect(loaded.has_value() && *loaded == 2, "snapshot load failed");
+    SslContext client_ctx(SslMethod::TLS_1_3_Client);
+    client_ctx.setClientSessionCache(cache);
+    bool restored = false;
+    expect(connectOnce(client_ctx, *server, "localhost", restored) && restored, "snapshot session not resumed");
+
+    expect(::truncate(path.c_str(), 3) == 0, "truncate failed");
+    expect(!cache->load(path).has_value(), "truncated snapshot accepted");
+    ::unlink(path.c_str());
+}
+
+} // namespace
+
+int main()
+{
+    checkTls12Reuse();
+    checkTls13MultiTicket();
+    checkSnapshot();
+    return 0;
+}
@@ -0,0 +1,249 @@
+/**
+ * @file t20_early_data.cc
+ * @brief 用途：锁定 TLS 1.3 early data（0-RTT / 0.5-RTT）与 SslEarlyDataReplayGuard 的语义。
+ * 关键覆盖点：客户端随 ClientHello 发送 early data、服务端握手完成前读取并以 0.5-RTT 回写；
+ * 同一 ClientHello 重放时 0-RTT 被拒绝而握手仍完成；ticket 无法解密时客户端看到 Rejected；
+ * 服务端关闭 early data 后客户端不能 0-RTT。
+ * 通过条件：两端读到的数据、earlyDataStatus() 与防重放计数符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_early_data.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+constexpr const char* kPeer = "127.0.0.1:8443";
+constexpr uint32_t kMaxEarlyData = 4096;
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+std::vector<char> drain(SslEngine& from)
+{
+    std::vector<char> out(from.pendingEncryptedOutput());
+    if (!out.empty()) {
+        const int produced = from.extractEncryptedOutput(out.data(), out.size());
+        expect(produced == static_cast<int>(out.size()), "extractEncryptedOutput failed");
+    }
+    return out;
+}
+
+void feed(SslEngine& to, const std::vector<char>& data)
+{
+    if (!data.empty()) {
+        expect(to.feedEncryptedInput(data.data(), data.size()) == static_cast<int>(data.size()),
+               "feedEncryptedInput failed");
+    }
+}
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    feed(to, drain(from));
+}
+
+void stepOk(SslIOResult ret, const char* message)
+{
+    expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead || ret == SslIOResult::WantWrite, message);
+}
+
+/**
+ * @brief 服务端读完所有 early data，返回读到的内容
+ */
+std::string readAllEarlyData(SslEngine& server)
+{
+    std::string data;
+    std::array<char, 256> buffer{};
+    for (;;) {
+        size_t bytes_read = 0;
+        const auto ret = server.readEarlyData(buffer.data(), buffer.size(), bytes_read);
+        if (ret == SslIOResult::Success) {
+            data.append(buffer.data(), bytes_read);
+            continue;
+        }
+        if (ret == SslIOResult::ZeroReturn || ret == SslIOResult::WantRead) {
+            return data;
+        }
+        throw std::runtime_error("readEarlyData failed");
+    }
+}
+
+void finishHandshake(SslEngine& client, SslEngine& server)
+{
+    for (int i = 0; i < 64; ++i) {
+        if (!client.isHandshakeCompleted()) {
+            stepOk(client.doHandshake(), "client handshake failed");
+        }
+        transferPending(client, server);
+        if (!server.isHandshakeCompleted()) {
+            stepOk(server.doHandshake(), "server handshake failed");
+        }
+        transferPending(server, client);
+        if (client.isHandshakeCompleted() && server.isHandshakeCompleted()) {
+            return;
+        }
+    }
+    throw std::runtime_error("handshake did not complete");
+}
+
+std::string readPlain(SslEngine& engine)
+{
+    std::array<char, 256> buffer{};
+    size_t bytes_read = 0;
+    const auto ret = engine.read(buffer.data(), buffer.size(), bytes_read);
+    return ret == SslIOResult::Success ? std::string(buffer.data(), bytes_read) : std::string();
+}
+
+std::unique_ptr<SslContext> makeServer(std::shared_ptr<SslTicketKeyRing> ring,
+                                       std::shared_ptr<SslEarlyDataReplayGuard> guard,
+                                       uint32_t max_early_data)
+{
+    auto ctx = std::make_unique<SslContext>(SslMethod::TLS_1_3_Server);
+    expect(ctx->isValid(), "server context invalid");
+    expect(ctx->loadCertificate("certs/server.crt").has_value(), "load server cert failed");
+    expect(ctx->loadPrivateKey("certs/server.key").has_value(), "load server key failed");
+    ctx->setSessionTicketKeys(std::move(ring));
+    ctx->setMaxEarlyData(max_early_data);
+    ctx->setEarlyDataReplayGuard(std::move(guard));
+    return ctx;
+}
+
+struct Client {
+    std::shared_ptr<SslClientSessionCache> cache = std::make_shared<SslClientSessionCache>();
+    SslContext ctx{SslMethod::TLS_1_3_Client};
+
+    Client() { ctx.setClientSessionCache(cache); }
+};
+
+std::unique_ptr<SslEngine> newClientEngine(Client& client)
+{
+    auto engine = std::make_unique<SslEngine>(&client.ctx);
+    expect(engine->initMemoryBIO().has_value(), "client memory BIO failed");
+    engine->setConnectState();
+    expect(engine->setHostname("localhost").has_value(), "set SNI failed");
+    engine->restoreCachedSession(kPeer);
+    return engine;
+}
+
+std::unique_ptr<SslEngine> newServerEngine(SslContext& ctx)
+{
+    auto engine = std::make_unique<SslEngine>(&ctx);
+    expect(engine->initMemoryBIO().has_value(), "server memory BIO failed");
+    engine->setAcceptState();
+    return engine;
+}
+
+/**
+ * @brief 完整握手一次，让客户端缓存拿到带 early data 额度的 ticket
+ */
+void primeTicket(Client& client, SslContext& server_ctx)
+{
+    auto c = newClientEngine(client);
+    auto s = newServerEngine(server_ctx);
+    finishHandshake(*c, *s);
+    (void)readPlain(*c);  // 处理 NewSessionTicket
+    expect(client.cache->stats().sessions > 0, "no ticket cached");
+    // 未发送 close_notify 就释放会让 OpenSSL 把 session 标记为不可恢复
+    (void)s->shutdown();
+    (void)c->shutdown();
+}
+
+void checkZeroRtt()
+{
+    auto guard = std::make_shared<SslEarlyDataReplayGuard>();
+    auto server_ctx = makeServer(std::make_shared<SslTicketKeyRing>(), guard, kMaxEarlyData);
+    expect(server_ctx->maxEarlyData() == kMaxEarlyData, "max early data not set");
+    Client client;
+    primeTicket(client, *server_ctx);
+
+    auto c = newClientEngine(client);
+    expect(c->maxEarlyData() == kMaxEarlyData, "ticket does not allow early data");
+    const std::string request = "GET /ping";
+    size_t written = 0;
+    expect(c->writeEarlyData(request.data(), request.size(), written) == SslIOResult::Success &&
+               written == request.size(),
+           "client writeEarlyData failed");
+    const std::vector<char> first_flight = drain(*c);
+
+    auto s = newServerEngine(*server_ctx);
+    feed(*s, first_flight);
+    expect(readAllEarlyData(*s) == request, "server did not read early data");
+
+    // 0.5-RTT：服务端在客户端 Finished 之前回写
+    const std::string response = "pong";
+    expect(s->writeEarlyData(response.data(), response.size(), written) == SslIOResult::Success,
+           "server writeEarlyData failed");
+    transferPending(*s, *c);
+    expect(c->doHandshake() == SslIOResult::Success, "client handshake did not complete");
+    expect(readPlain(*c) == response, "client did not read 0.5-RTT data");
+    transferPending(*c, *s);
+    expect(readAllEarlyData(*s).empty(), "unexpected extra early data");
+    finishHandshake(*c, *s);
+
+    expect(c->earlyDataStatus() == SslEarlyDataStatus::Accepted, "client status not accepted");
+    expect(s->earlyDataStatus() == SslEarlyDataStatus::Accepted, "server status not accepted");
+    expect(s->isSessionReused(), "0-RTT handshake not resumed");
+    expect(guard->stats().accepted == 1, "guard did not record ticket");
+
+    // 重放同一首轮报文：0-RTT 被拒绝，握手本身仍可推进
+    auto replay = newServerEngine(*server_ctx);
+    feed(*replay, first_flight);
+    expect(readAllEarlyData(*replay).empty(), "replayed early data accepted");
+    expect(replay->earlyDataStatus() == SslEarlyDataStatus::Rejected, "replay not rejected");
+    expect(guard->stats().replayed == 1, "replay not counted");
+}
+
+void checkRejected()
+{
+    auto guard = std::make_shared<SslEarlyDataReplayGuard>();
+    auto origin = makeServer(std::make_shared<SslTicketKeyRing>(), guard, kMaxEarlyData);
+    Client client;
+    primeTicket(client, *origin);
+
+    // 另一个密钥环解不开 ticket：退回完整握手，early data 需要重发
+    auto other = makeServer(std::make_shared<SslTicketKeyRing>(), guard, kMaxEarlyData);
+    auto c = newClientEngine(client);
+    size_t written = 0;
+    expect(c->writeEarlyData("retry", 5, written) == SslIOResult::Success, "client writeEarlyData failed");
+    auto s = newServerEngine(*other);
+    transferPending(*c, *s);
+    expect(readAllEarlyData(*s).empty(), "early data accepted without a valid ticket");
+    finishHandshake(*c, *s);
+    expect(c->earlyDataStatus() == SslEarlyDataStatus::Rejected, "client did not see rejection");
+    expect(!s->isSessionReused(), "unexpected resumption");
+}
+
+void checkDisabled()
+{
+    auto server_ctx = makeServer(std::make_shared<SslTicketKeyRing>(), nullptr, 0);
+    Client client;
+    primeTicket(client, *server_ctx);
+
+    auto c = newClientEngine(client);
+    expect(c->maxEarlyData() == 0, "ticket allows early data while disabled");
+    size_t written = 0;
+    expect(c->writeEarlyData("x", 1, written) == SslIOResult::Error && written == 0,
+           "early data written without allowance");
+}
+
+} // namespace
+
+int main()
+{
+    checkZeroRtt();
+    checkRejected();
+    checkDisabled();
+    return 0;
+}
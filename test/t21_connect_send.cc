@@ -0,0 +1,215 @@
+/**
+ * @file t21_connect_send.cc
+ * @brief 用途：锁定 `SslSocket::connectAndSend()` 一次 co_await 完成建连、握手与首个请求写出的语义。
+ * 关键覆盖点：首次完整握手时请求随 Finished 写出；session 恢复并请求 early data 而服务端未读取时，
+ * 0-RTT 被拒绝后请求自动重发；目标端口未监听时返回错误而不是挂起。
+ * 通过条件：服务端每次读到完整请求、客户端读到响应，拒绝连接的场景返回失败。
+ */
+
+#include "galay-ssl/async/ssl_socket.h"
+#include "galay-ssl/ssl/ssl_client_session_cache.h"
+#include "galay-ssl/ssl/ssl_context.h"
+#include <galay-kernel/common/defn.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef USE_IOURING
+#include <galay-kernel/kernel/io_uring_scheduler.h>
+using TestScheduler = galay::kernel::IOUringScheduler;
+#elif defined(USE_EPOLL)
+#include <galay-kernel/kernel/epoll_scheduler.h>
+using TestScheduler = galay::kernel::EpollScheduler;
+#elif defined(USE_KQUEUE)
+#include <galay-kernel/kernel/kqueue_scheduler.h>
+using TestScheduler = galay::kernel::KqueueScheduler;
+#endif
+
+using namespace galay::ssl;
+using namespace galay::kernel;
+
+namespace {
+
+constexpr uint16_t kPort = 19461;
+constexpr uint16_t kClosedPort = 19462;
+constexpr int kRounds = 2;
+const std::string kRequest = "GET /ping HTTP/1.1\r\nHost: localhost\r\n\r\n";
+const std::string kResponse = "pong";
+
+struct TestState {
+    std::atomic<bool> server_ready{false};
+    std::atomic<int> server_requests{0};
+    std::atomic<int> client_responses{0};
+    std::atomic<bool> refused_failed{false};
+    std::atomic<bool> client_done{false};
+    std::atomic<bool> failed{false};
+    std::mutex failure_mu;
+    std::string failure;
+};
+
+void fail(TestState* state, std::string message)
+{
+    state->failed.store(true, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(state->failure_mu);
+    if (state->failure.empty()) {
+        state->failure = std::move(message);
+    }
+}
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+Task<void> runServer(SslContext* ctx, TestState* state)
+{
+    SslSocket listener(ctx);
+    listener.option().handleReuseAddr();
+    listener.option().handleNonBlock();
+    if (!listener.bind(Host(IPType::IPV4, "127.0.0.1", kPort)) || !listener.listen(16)) {
+        fail(state, "server bind/listen failed");
+        co_return;
+    }
+    state->server_ready.store(true, std::memory_order_release);
+
+    for (int i = 0; i < kRounds; ++i) {
+        Host client_host;
+        auto accepted = co_await listener.accept(&client_host);
+        if (!accepted) {
+            fail(state, "accept failed");
+            break;
+        }
+        SslSocket conn(ctx, accepted.value());
+        conn.option().handleNonBlock();
+        // 不调用 recvEarly()：客户端的 early data 被拒绝，必须随 Finished 重发
+        if (!co_await conn.handshake()) {
+            fail(state, "server handshake failed");
+            (void)co_await conn.close();
+            break;
+        }
+        std::string request;
+        char buffer[256];
+        while (request.size() < kRequest.size()) {
+            auto received = co_await conn.recv(buffer, sizeof(buffer));
+            if (!received || received->size() == 0) {
+                break;
+            }
+            request.append(received->toStringView());
+        }
+        if (request != kRequest) {
+            fail(state, "server did not receive the full request");
+        } else {
+            state->server_requests.fetch_add(1, std::memory_order_relaxed);
+        }
+        (void)co_await conn.send(kResponse.data(), kResponse.size());
+        (void)co_await conn.shutdown();
+        (void)co_await conn.close();
+    }
+    (void)co_await listener.close();
+}
+
+Task<void> runClient(SslContext* ctx, TestState* state)
+{
+    for (int i = 0; i < kRounds; ++i) {
+        SslSocket socket(ctx);
+        if (!socket.setHostname("localhost")) {
+            fail(state, "set hostname failed");
+            break;
+        }
+        SslConnectOptions options;
+        options.fastOpen = true;
+        options.earlyData = i > 0;
+        auto sent = co_await socket.connectAndSend(Host(IPType::IPV4, "127.0.0.1", kPort),
+                                                   kRequest.data(), kRequest.size(), options);
+        if (!sent || sent.value() != kRequest.size()) {
+            fail(state, "connectAndSend failed");
+            (void)co_await socket.close();
+            break;
+        }
+        if (i > 0 && (!socket.isSessionReused() ||
+                      socket.earlyDataStatus() != SslEarlyDataStatus::Rejected)) {
+            fail(state, "second round did not resume with rejected early data");
+        }
+        char buffer[64];
+        auto received = co_await socket.recv(buffer, sizeof(buffer));
+        if (received && received->toStringView() == kResponse) {
+            state->client_responses.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            fail(state, "client did not receive the response");
+        }
+        (void)co_await socket.shutdown();
+        (void)co_await socket.close();
+    }
+
+    SslSocket refused(ctx);
+    auto sent = co_await refused.connectAndSend(Host(IPType::IPV4, "127.0.0.1", kClosedPort),
+                                                kRequest.data(), kRequest.size());
+    state->refused_failed.store(!sent.has_value(), std::memory_order_relaxed);
+    (void)co_await refused.close();
+    state->client_done.store(true, std::memory_order_release);
+}
+
+void waitFor(std::atomic<bool>& flag, TestState& state, std::chrono::seconds limit, const char* message)
+{
+    const auto deadline = std::chrono::steady_clock::now() + limit;
+    while (!flag.load(std::memory_order_acquire)) {
+        if (state.failed.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(state.failure_mu);
+            throw std::runtime_error(state.failure);
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            throw std::runtime_error(message);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+} // namespace
+
+int main()
+{
+    SslContext server_ctx(SslMethod::TLS_1_3_Server);
+    SslContext client_ctx(SslMethod::TLS_1_3_Client);
+    expect(server_ctx.isValid() && client_ctx.isValid(), "context invalid");
+    expect(server_ctx.loadCertificate("certs/server.crt").has_value(), "load server cert failed");
+    expect(server_ctx.loadPrivateKey("certs/server.key").has_value(), "load server key failed");
+    server_ctx.setSessionTicketKeys(std::make_shared<SslTicketKeyRing>());
+    server_ctx.setMaxEarlyData(4096);
+    client_ctx.setClientSessionCache(std::make_shared<SslClientSessionCache>());
+
+    TestScheduler scheduler;
+    scheduler.start();
+
+    TestState state;
+    int rc = 0;
+    try {
+        expect(scheduleTask(scheduler, runServer(&server_ctx, &state)), "schedule server failed");
+        waitFor(state.server_ready, state, std::chrono::seconds(2), "server did not become ready");
+        expect(scheduleTask(scheduler, runClient(&client_ctx, &state)), "schedule client failed");
+        waitFor(state.client_done, state, std::chrono::seconds(10), "client timed out");
+        expect(state.server_requests.load() == kRounds, "server request count mismatch");
+        expect(state.client_responses.load() == kRounds, "client response count mismatch");
+        expect(state.refused_failed.load(), "connectAndSend to a closed port did not fail");
+    } catch (const std::exception& ex) {
+        std::cerr << "[T21] " << ex.what() << "\n";
+        rc = 1;
+    }
+
+    if (rc != 0) {
+        std::cerr.flush();
+        std::_Exit(rc);
+    }
+
+    scheduler.stop();
+    std::cout << "t21_connect_send PASS\n";
+    return 0;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file t22_connection_pool.cc
+ * @brief 用途：锁定 SslConnectionPool 的取用、归还、single-flight 建连与预热语义。
+ * 关键覆盖点：冷目标并发 acquire 只放行一个完整握手，其余等待后以 session 恢复建连；
+ * 归还的连接被下一次 acquire 直接取用；不可复用的连接被关闭；prewarm() 在后台补足空闲连接。
+ * 通过条件：echo 往返成功，统计中的 dials / waits / resumed / hits / idle 符合预期。
+ */
+
+#include "galay-ssl/async/ssl_connection_pool.h"
+#include "galay-ssl/ssl/ssl_context.h"
+#include <galay-kernel/common/defn.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef USE_IOURING
+#include <galay-kernel/kernel/io_uring_scheduler.h>
+using TestScheduler = galay::kernel::IOUringScheduler;
+#elif defined(USE_EPOLL)
+#include <galay-kernel/kernel/epoll_scheduler.h>
+using TestScheduler = galay::kernel::EpollScheduler;
+#elif defined(USE_KQUEUE)
+#include <galay-kernel/kernel/kqueue_scheduler.h>
+using TestScheduler = galay::kernel::KqueueScheduler;
+#endif
+
+using namespace galay::ssl;
+using namespace galay::kernel;
+
+namespace {
+
+constexpr uint16_t kPort = 19463;
+constexpr int kConcurrent = 4;
+const std::string kPayload = "pool-ping";
+
+struct TestState {
+    std::atomic<bool> server_ready{false};
+    std::atomic<int> round_trips{0};
+    std::atomic<int> finished{0};
+    std::atomic<bool> failed{false};
+    std::mutex failure_mu;
+    std::string failure;
+    SslConnectionPoolStats snapshot;
+    std::atomic<bool> snapshot_ready{false};
+};
+
+void fail(TestState* state, std::string message)
+{
+    state->failed.store(true, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(state->failure_mu);
+    if (state->failure.empty()) {
+        state->failure = std::move(message);
+    }
+}
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+Host target()
+{
+    return Host(IPType::IPV4, "127.0.0.1", kPort);
+}
+
+Task<void> echoConnection(SslContext* ctx, GHandle handle)
+{
+    SslSocket conn(ctx, handle);
+    conn.option().handleNonBlock();
+    if (co_await conn.handshake()) {
+        char buffer[256];
+        for (;;) {
+            auto received = co_await conn.recv(buffer, sizeof(buffer));
+            if (!received || received->size() == 0) {
+                break;
+            }
+            if (!co_await conn.send(buffer, received->size())) {
+                break;
+            }
+        }
+    }
+    (void)co_await conn.close();
+}
+
+Task<void> runServer(IOScheduler* scheduler, SslContext* ctx, TestState* state)
+{
+    SslSocket listener(ctx);
+    listener.option().handleReuseAddr();
+    listener.option().handleNonBlock();
+    if (!listener.bind(target()) || !listener.listen(64)) {
+        fail(state, "server bind/listen failed");
+        co_return;
+    }
+    state->server_ready.store(true, std::memory_order_release);
+    for (;;) {
+        Host client_host;
+        auto accepted = co_await listener.accept(&client_host);
+        if (!accepted) {
+            break;
+        }
+        (void)scheduleTask(scheduler, echoConnection(ctx, accepted.value()));
+    }
+}
+
+/**
+ * @brief 取一个连接做一次 echo 往返后归还
+ */
+Task<void> useOnce(SslConnectionPool* pool, SslContext* ctx, std::string sni, bool reusable,
+                   bool expect_reused, TestState* state)
+{
+    auto conn = co_await pool->acquire(ctx, target(), sni);
+    if (!conn) {
+        fail(state, "acquire failed");
+    } else {
+        if (expect_reused && !conn->reused) {
+            fail(state, "idle connection was not reused");
+        }
+        char buffer[64];
+        auto sent = co_await (*conn)->send(kPayload.data(), kPayload.size());
+        auto received = sent ? co_await (*conn)->recv(buffer, sizeof(buffer))
+                             : std::expected<Bytes, SslError>(std::unexpected(sent.error()));
+        if (received && received->toStringView() == kPayload) {
+            state->round_trips.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            fail(state, "echo round trip failed");
+        }
+        pool->release(std::move(*conn), reusable && received.has_value());
+    }
+    state->finished.fetch_add(1, std::memory_order_release);
+}
+
+Task<void> startPrewarm(SslConnectionPool* pool, SslContext* ctx, TestState* state)
+{
+    if (pool->prewarm(ctx, target(), "warm.local", 2) != 2) {
+        fail(state, "prewarm did not start two dials");
+    }
+    state->finished.fetch_add(1, std::memory_order_release);
+    co_return;
+}
+
+Task<void> takeSnapshot(SslConnectionPool* pool, TestState* state)
+{
+    state->snapshot = pool->stats();
+    state->snapshot_ready.store(true, std::memory_order_release);
+    co_return;
+}
+
+void waitUntil(TestState& state, const std::function<bool()>& done, const char* message)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done()) {
+        if (state.failed.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(state.failure_mu);
+            throw std::runtime_error(state.failure);
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            throw std::runtime_error(message);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+SslConnectionPoolStats snapshot(TestScheduler& scheduler, SslConnectionPool& pool, TestState& state)
+{
+    state.snapshot_ready.store(false, std::memory_order_release);
+    expect(scheduleTask(scheduler, takeSnapshot(&pool, &state)), "schedule snapshot failed");
+    waitUntil(state, [&] { return state.snapshot_ready.load(std::memory_order_acquire); }, "snapshot timed out");
+    return state.snapshot;
+}
+
+} // namespace
+
+int main()
+{
+    // TLS 1.2 session 在握手结束时即可用，恢复次数是确定的
+    SslContext server_ctx(SslMethod::TLS_1_2_Server);
+    SslContext client_ctx(SslMethod::TLS_1_2_Client);
+    expect(server_ctx.isValid() && client_ctx.isValid(), "context invalid");
+    expect(server_ctx.loadCertificate("certs/server.crt").has_value(), "load server cert failed");
+    expect(server_ctx.loadPrivateKey("certs/server.key").has_value(), "load server key failed");
+
+    TestScheduler scheduler;
+    scheduler.start();
+    // 恢复次数依赖 session 缓存：由连接池为客户端上下文挂接
+    SslConnectionPoolOptions pool_options;
+    pool_options.attachSessionCache = true;
+    SslConnectionPool pool(&scheduler, pool_options);
+
+    TestState state;
+    int rc = 0;
+    try {
+        expect(scheduleTask(scheduler, runServer(&scheduler, &server_ctx, &state)), "schedule server failed");
+        waitUntil(state, [&] { return state.server_ready.load(std::memory_order_acquire); },
+                  "server did not become ready");
+
+        // 冷目标并发取用：一个完整握手，其余等待后恢复 session
+        for (int i = 0; i < kConcurrent; ++i) {
+            expect(scheduleTask(scheduler, useOnce(&pool, &client_ctx, "localhost", true, false, &state)),
+                   "schedule client failed");
+        }
+        waitUntil(state, [&] { return state.finished.load(std::memory_order_acquire) == kConcurrent; },
+                  "concurrent acquire timed out");
+        auto stats = snapshot(scheduler, pool, state);
+        expect(stats.dials == kConcurrent, "unexpected dial count");
+        expect(stats.waits == kConcurrent - 1, "cold dials were not single-flighted");
+        expect(stats.resumed == kConcurrent - 1, "waiting dials did not resume the session");
+        expect(stats.idle == kConcurrent, "released connections not kept idle");
+
+        // 归还的连接直接复用；标记为不可复用的连接被关闭
+        expect(scheduleTask(scheduler, useOnce(&pool, &client_ctx, "localhost", false, true, &state)),
+               "schedule reuse failed");
+        waitUntil(state, [&] { return state.finished.load(std::memory_order_acquire) == kConcurrent + 1; },
+                  "reuse timed out");
+        stats = snapshot(scheduler, pool, state);
+        expect(stats.hits == 1 && stats.dials == kConcurrent, "idle connection not reused");
+        expect(stats.idle == kConcurrent - 1, "non-reusable connection kept idle");
+
+        // 预热：后台建立两个连接放入空闲列表
+        expect(scheduleTask(scheduler, startPrewarm(&pool, &client_ctx, &state)), "schedule prewarm failed");
+        waitUntil(state, [&] { return snapshot(scheduler, pool, state).idle == kConcurrent + 1; },
+                  "prewarm did not fill idle connections");
+        expect(state.round_trips.load() == kConcurrent + 1, "round trip count mismatch");
+    } catch (const std::exception& ex) {
+        std::cerr << "[T22] " << ex.what() << "\n";
+        rc = 1;
+    }
+
+    if (rc != 0) {
+        std::cerr.flush();
+        std::_Exit(rc);
+    }
+
+    scheduler.stop();
+    std::cout << "t22_connection_pool PASS\n";
+    return 0;
+}
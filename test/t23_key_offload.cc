@@ -0,0 +1,206 @@
+/**
+ * @file t23_key_offload.cc
+ * @brief 用途：锁定 SslContext::setPrivateKeyOffload() 把握手私钥运算交给签名线程的语义。
+ * 关键覆盖点：RSA（TLS 1.3 / TLS 1.2）与 ECDSA 私钥的签名在签名线程完成，doHandshake() 期间返回
+ * WantAsync 且 asyncWaitFd() 可读后握手继续；不在 async job 中的运算同步完成；未加载私钥时拒绝挂接。
+ * 通过条件：握手完成、应用数据往返成功，SslKeyOffload 统计符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_key_offload.h"
+
+#include <openssl/ec.h>
+#include <openssl/pem.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    std::vector<char> out(from.pendingEncryptedOutput());
+    if (out.empty()) {
+        return;
+    }
+    expect(from.extractEncryptedOutput(out.data(), out.size()) == static_cast<int>(out.size()),
+           "extractEncryptedOutput failed");
+    expect(to.feedEncryptedInput(out.data(), out.size()) == static_cast<int>(out.size()),
+           "feedEncryptedInput failed");
+}
+
+void waitReadable(int fd)
+{
+    expect(fd >= 0, "no async wait fd");
+    pollfd pfd{fd, POLLIN, 0};
+    expect(::poll(&pfd, 1, 5000) == 1, "private key operation did not complete");
+}
+
+/**
+ * @brief 推进握手直到完成
+ * @return 服务端返回 WantAsync 的次数
+ */
+int finishHandshake(SslEngine& client, SslEngine& server)
+{
+    int async_waits = 0;
+    for (int i = 0; i < 64; ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "client handshake failed");
+        }
+        transferPending(client, server);
+        while (!server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            if (ret == SslIOResult::WantAsync) {
+                // 调度线程此时可服务其他连接；这里直接等待通知
+                ++async_waits;
+                waitReadable(server.asyncWaitFd());
+                continue;
+            }
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "server handshake failed");
+            break;
+        }
+        transferPending(server, client);
+        if (client.isHandshakeCompleted() && server.isHandshakeCompleted()) {
+            return async_waits;
+        }
+    }
+    throw std::runtime_error("handshake did not complete");
+}
+
+void roundTrip(SslEngine& client, SslEngine& server)
+{
+    const std::string payload = "offload-ping";
+    size_t written = 0;
+    expect(client.write(payload.data(), payload.size(), written) == SslIOResult::Success, "client write failed");
+    transferPending(client, server);
+    std::array<char, 64> buffer{};
+    size_t bytes_read = 0;
+    expect(server.read(buffer.data(), buffer.size(), bytes_read) == SslIOResult::Success, "server read failed");
+    expect(std::string(buffer.data(), bytes_read) == payload, "payload mismatch");
+}
+
+/**
+ * @brief 一次完整握手，返回服务端 WantAsync 次数
+ */
+int handshakeOnce(SslContext& server_ctx, SslMethod client_method)
+{
+    SslContext client_ctx(client_method);
+    expect(client_ctx.isValid(), "client context invalid");
+
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+
+    const int async_waits = finishHandshake(client, server);
+    roundTrip(client, server);
+    return async_waits;
+}
+
+void checkRsa(SslMethod server_method, SslMethod client_method)
+{
+    auto offload = std::make_shared<SslKeyOffload>(SslKeyOffloadOptions{.threads = 1});
+    SslContext server_ctx(server_method);
+    expect(server_ctx.isValid(), "server context invalid");
+    expect(server_ctx.loadCertificate("certs/server.crt").has_value(), "load server cert failed");
+    expect(server_ctx.loadPrivateKey("certs/server.key").has_value(), "load server key failed");
+    expect(server_ctx.setPrivateKeyOffload(offload).has_value(), "attach offload failed");
+    expect(server_ctx.privateKeyOffload() == offload, "offload not kept");
+
+    expect(handshakeOnce(server_ctx, client_method) > 0, "handshake did not wait for the signer");
+    const auto stats = offload->stats();
+    expect(stats.offloaded >= 1, "signature not offloaded");
+    expect(stats.failures == 0 && stats.queued == 0, "unexpected offload stats");
+}
+
+/**
+ * @brief 生成 P-256 自签名证书写入临时文件
+ */
+void writeEcIdentity(const std::string& cert_path, const std::string& key_path)
+{
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    expect(key && cert, "EC key generation failed");
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    expect(X509_sign(cert, key, EVP_sha256()) > 0, "EC certificate signing failed");
+
+    FILE* cert_file = std::fopen(cert_path.c_str(), "w");
+    FILE* key_file = std::fopen(key_path.c_str(), "w");
+    expect(cert_file && key_file, "open temp identity files failed");
+    const bool ok = PEM_write_X509(cert_file, cert) == 1 &&
+                    PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    std::fclose(cert_file);
+    std::fclose(key_file);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    expect(ok, "write EC identity failed");
+}
+
+void checkEcdsa()
+{
+    const std::string base = "/tmp/galay_ssl_t23_" + std::to_string(::getpid());
+    const std::string cert_path = base + ".crt";
+    const std::string key_path = base + ".key";
+    writeEcIdentity(cert_path, key_path);
+
+    auto offload = std::make_shared<SslKeyOffload>();
+    SslContext server_ctx(SslMethod::TLS_1_3_Server);
+    const bool loaded = server_ctx.loadCertificate(cert_path).has_value() &&
+                        server_ctx.loadPrivateKey(key_path).has_value();
+    ::unlink(cert_path.c_str());
+    ::unlink(key_path.c_str());
+    expect(loaded, "load EC identity failed");
+    expect(server_ctx.setPrivateKeyOffload(offload).has_value(), "attach offload to EC key failed");
+
+    expect(handshakeOnce(server_ctx, SslMethod::TLS_1_3_Client) > 0, "ECDSA handshake did not wait for the signer");
+    expect(offload->stats().offloaded >= 1, "ECDSA signature not offloaded");
+}
+
+void checkInlineAndErrors()
+{
+    SslKeyOffload offload;
+    expect(offload.run([] { return 42; }) == 42, "inline operation result mismatch");
+    const auto stats = offload.stats();
+    expect(stats.inlined == 1 && stats.offloaded == 0, "operation outside an async job was offloaded");
+
+    SslContext no_key(SslMethod::TLS_1_3_Server);
+    auto attached = no_key.setPrivateKeyOffload(std::make_shared<SslKeyOffload>());
+    expect(!attached && attached.error().code() == SslErrorCode::kPrivateKeyLoadFailed,
+           "offload attached without a private key");
+    expect(!no_key.privateKeyOffload(), "offload kept after failure");
+}
+
+} // namespace
+
+int main()
+{
+    checkRsa(SslMethod::TLS_1_3_Server, SslMethod::TLS_1_3_Client);
+    checkRsa(SslMethod::TLS_1_2_Server, SslMethod::TLS_1_2_Client);
+    checkEcdsa();
+    checkInlineAndErrors();
+    return 0;
+}
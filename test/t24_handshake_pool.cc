@@ -0,0 +1,256 @@
+/**
+ * @file t24_handshake_pool.cc
+ * @brief 用途：锁定 SslHandshakePool 在握手调度器上完成握手、再把连接迁移到数据调度器的语义。
+ * 关键覆盖点：握手在握手调度器线程进行（含私钥卸载等待），handler 在数据调度器线程运行并轮询分布；
+ * 迁移后连接可以继续收发，随握手到达的请求不丢失；握手失败的连接计入 failed 并被关闭。
+ * 通过条件：所有客户端 echo 往返成功，handler 线程均属于数据调度器，统计符合预期。
+ */
+
+#include "galay-ssl/async/ssl_handshake_pool.h"
+#include "galay-ssl/ssl/ssl_context.h"
+#include <galay-kernel/common/defn.hpp>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef USE_IOURING
+#include <galay-kernel/kernel/io_uring_scheduler.h>
+using TestScheduler = galay::kernel::IOUringScheduler;
+#elif defined(USE_EPOLL)
+#include <galay-kernel/kernel/epoll_scheduler.h>
+using TestScheduler = galay::kernel::EpollScheduler;
+#elif defined(USE_KQUEUE)
+#include <galay-kernel/kernel/kqueue_scheduler.h>
+using TestScheduler = galay::kernel::KqueueScheduler;
+#endif
+
+using namespace galay::ssl;
+using namespace galay::kernel;
+
+namespace {
+
+constexpr uint16_t kPort = 19464;
+constexpr int kClients = 4;
+const std::string kPayload = "handoff-ping";
+
+struct TestState {
+    std::atomic<bool> server_ready{false};
+    std::atomic<int> round_trips{0};
+    std::atomic<int> clients_done{0};
+    std::atomic<int> probes{0};
+    std::atomic<bool> failed{false};
+    std::mutex mu;
+    std::string failure;
+    std::set<std::thread::id> data_threads;
+    std::set<std::thread::id> handler_threads;
+    std::thread::id handshake_thread;
+};
+
+void fail(TestState* state, std::string message)
+{
+    state->failed.store(true, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(state->mu);
+    if (state->failure.empty()) {
+        state->failure = std::move(message);
+    }
+}
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+Host target()
+{
+    return Host(IPType::IPV4, "127.0.0.1", kPort);
+}
+
+Task<void> probeThread(TestState* state, bool data_plane)
+{
+    {
+        std::lock_guard<std::mutex> lock(state->mu);
+        if (data_plane) {
+            state->data_threads.insert(std::this_thread::get_id());
+        } else {
+            state->handshake_thread = std::this_thread::get_id();
+        }
+    }
+    state->probes.fetch_add(1, std::memory_order_release);
+    co_return;
+}
+
+Task<void> echo(TestState* state, SslSocket conn)
+{
+    {
+        std::lock_guard<std::mutex> lock(state->mu);
+        state->handler_threads.insert(std::this_thread::get_id());
+    }
+    char buffer[256];
+    for (;;) {
+        auto received = co_await conn.recv(buffer, sizeof(buffer));
+        if (!received || received->size() == 0) {
+            break;
+        }
+        if (!co_await conn.send(buffer, received->size())) {
+            break;
+        }
+    }
+    (void)co_await conn.close();
+}
+
+Task<void> runAcceptor(SslContext* ctx, SslHandshakePool* pool, TestState* state)
+{
+    SslSocket listener(ctx);
+    listener.option().handleReuseAddr();
+    listener.option().handleNonBlock();
+    if (!listener.bind(target()) || !listener.listen(64)) {
+        fail(state, "server bind/listen failed");
+        co_return;
+    }
+    state->server_ready.store(true, std::memory_order_release);
+    for (;;) {
+        Host client_host;
+        auto accepted = co_await listener.accept(&client_host);
+        if (!accepted) {
+            break;
+        }
+        if (!pool->submit(ctx, accepted.value())) {
+            ::close(accepted.value().fd);
+            fail(state, "handshake pool rejected a connection");
+        }
+    }
+}
+
+Task<void> runClient(SslContext* ctx, TestState* state)
+{
+    SslSocket socket(ctx);
+    // 请求随 Finished 写出，服务端握手完成时请求已在引擎中，迁移后必须仍能读到
+    auto sent = co_await socket.connectAndSend(target(), kPayload.data(), kPayload.size());
+    if (!sent) {
+        fail(state, "client connectAndSend failed");
+    } else {
+        char buffer[64];
+        auto received = co_await socket.recv(buffer, sizeof(buffer));
+        if (received && received->toStringView() == kPayload) {
+            state->round_trips.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            fail(state, "echo round trip failed");
+        }
+        (void)co_await socket.shutdown();
+    }
+    (void)co_await socket.close();
+    state->clients_done.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief 连上后不发 ClientHello 直接断开，服务端握手失败
+ */
+void connectAndAbort()
+{
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    const Host host = target();
+    expect(fd >= 0 && ::connect(fd, host.sockAddr(), host.addrLen()) == 0, "aborting client connect failed");
+    ::close(fd);
+}
+
+void waitUntil(TestState& state, const std::function<bool()>& done, const char* message)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done()) {
+        if (state.failed.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(state.mu);
+            throw std::runtime_error(state.failure);
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            throw std::runtime_error(message);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+} // namespace
+
+int main()
+{
+    SslContext server_ctx(SslMethod::TLS_1_3_Server);
+    SslContext client_ctx(SslMethod::TLS_1_3_Client);
+    expect(server_ctx.isValid() && client_ctx.isValid(), "context invalid");
+    expect(server_ctx.loadCertificate("certs/server.crt").has_value(), "load server cert failed");
+    expect(server_ctx.loadPrivateKey("certs/server.key").has_value(), "load server key failed");
+    auto offload = std::make_shared<SslKeyOffload>(SslKeyOffloadOptions{.threads = 1});
+    expect(server_ctx.setPrivateKeyOffload(offload).has_value(), "attach key offload failed");
+
+    TestScheduler acceptor;
+    TestScheduler handshaker;
+    TestScheduler data0;
+    TestScheduler data1;
+    for (auto* scheduler : {&acceptor, &handshaker, &data0, &data1}) {
+        scheduler->start();
+    }
+
+    TestState state;
+    SslHandshakePool pool({&handshaker}, {&data0, &data1},
+                          [&state](SslSocket conn) { return echo(&state, std::move(conn)); });
+
+    int rc = 0;
+    try {
+        expect(scheduleTask(handshaker, probeThread(&state, false)), "schedule probe failed");
+        expect(scheduleTask(data0, probeThread(&state, true)), "schedule probe failed");
+        expect(scheduleTask(data1, probeThread(&state, true)), "schedule probe failed");
+        waitUntil(state, [&] { return state.probes.load(std::memory_order_acquire) == 3; }, "probes timed out");
+
+        expect(scheduleTask(acceptor, runAcceptor(&server_ctx, &pool, &state)), "schedule acceptor failed");
+        waitUntil(state, [&] { return state.server_ready.load(std::memory_order_acquire); },
+                  "server did not become ready");
+
+        for (int i = 0; i < kClients; ++i) {
+            expect(scheduleTask(acceptor, runClient(&client_ctx, &state)), "schedule client failed");
+        }
+        connectAndAbort();
+        waitUntil(state, [&] { return state.clients_done.load(std::memory_order_acquire) == kClients; },
+                  "clients timed out");
+        waitUntil(state, [&] { return pool.stats().failed == 1; }, "aborted handshake not counted");
+
+        const auto stats = pool.stats();
+        expect(state.round_trips.load() == kClients, "round trip count mismatch");
+        expect(stats.submitted == kClients + 1 && stats.completed == kClients, "unexpected pool stats");
+        expect(stats.rejected == 0 && stats.inflight == 0, "unexpected pool stats");
+        expect(offload->stats().offloaded >= kClients, "handshake signatures were not offloaded");
+
+        std::lock_guard<std::mutex> lock(state.mu);
+        expect(state.handler_threads.size() == 2, "connections were not spread over data schedulers");
+        for (const auto& id : state.handler_threads) {
+            expect(state.data_threads.count(id) == 1, "handler ran outside the data schedulers");
+            expect(id != state.handshake_thread, "handler ran on the handshake scheduler");
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "[T24] " << ex.what() << "\n";
+        rc = 1;
+    }
+
+    if (rc != 0) {
+        std::cerr.flush();
+        std::_Exit(rc);
+    }
+
+    for (auto* scheduler : {&data1, &data0, &handshaker, &acceptor}) {
+        scheduler->stop();
+    }
+    std::cout << "t24_handshake_pool PASS\n";
+    return 0;
+}
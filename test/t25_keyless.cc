@@ -0,0 +1,283 @@
+/**
+ * @file t25_keyless.cc
+ * @brief 用途：锁定 SslKeylessClient 把握手私钥运算交给签名进程（SslKeylessSigner）的语义。
+ * 关键覆盖点：服务端上下文只加载证书，RSA（TLS 1.3 / TLS 1.2）与 ECDSA 签名经 Unix 域套接字在签名进程完成，
+ * 握手期间返回 WantAsync；直接提交的流水线请求全部按 id 返回；签名进程不可用或不持有密钥时握手失败。
+ * 通过条件：握手完成、应用数据往返成功，客户端与签名进程统计符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_keyless.h"
+
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+std::string socketPath(const char* tag)
+{
+    return "/tmp/galay_ssl_t25_" + std::to_string(::getpid()) + "_" + tag + ".sock";
+}
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    std::vector<char> out(from.pendingEncryptedOutput());
+    if (out.empty()) {
+        return;
+    }
+    expect(from.extractEncryptedOutput(out.data(), out.size()) == static_cast<int>(out.size()),
+           "extractEncryptedOutput failed");
+    expect(to.feedEncryptedInput(out.data(), out.size()) == static_cast<int>(out.size()),
+           "feedEncryptedInput failed");
+}
+
+/**
+ * @brief 推进握手直到完成或失败
+ * @return 服务端返回 WantAsync 的次数，握手失败返回 -1
+ */
+int runHandshake(SslContext& server_ctx, SslMethod client_method)
+{
+    SslContext client_ctx(client_method);
+    expect(client_ctx.isValid(), "client context invalid");
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+
+    int async_waits = 0;
+    for (int i = 0; i < 64; ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            if (ret != SslIOResult::Success && ret != SslIOResult::WantRead) {
+                return -1;
+            }
+        }
+        transferPending(client, server);
+        while (!server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            if (ret == SslIOResult::WantAsync) {
+                ++async_waits;
+                pollfd pfd{server.asyncWaitFd(), POLLIN, 0};
+                expect(pfd.fd >= 0 && ::poll(&pfd, 1, 5000) == 1, "remote key operation did not complete");
+                continue;
+            }
+            if (ret != SslIOResult::Success && ret != SslIOResult::WantRead) {
+                return -1;
+            }
+            break;
+        }
+        transferPending(server, client);
+        if (client.isHandshakeCompleted() && server.isHandshakeCompleted()) {
+            const std::string payload = "keyless-ping";
+            size_t written = 0;
+            expect(client.write(payload.data(), payload.size(), written) == SslIOResult::Success, "client write failed");
+            transferPending(client, server);
+            std::array<char, 64> buffer{};
+            size_t bytes_read = 0;
+            expect(server.read(buffer.data(), buffer.size(), bytes_read) == SslIOResult::Success, "server read failed");
+            expect(std::string(buffer.data(), bytes_read) == payload, "payload mismatch");
+            return async_waits;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 只加载证书并挂接 keyless 客户端的服务端上下文
+ */
+std::unique_ptr<SslContext> keylessContext(SslMethod method, const std::string& cert,
+                                           const std::shared_ptr<SslKeylessClient>& client)
+{
+    auto ctx = std::make_unique<SslContext>(method);
+    expect(ctx->isValid(), "server context invalid");
+    expect(ctx->loadCertificate(cert).has_value(), "load server cert failed");
+    expect(ctx->setPrivateKeyOffload(client).has_value(), "attach keyless client failed");
+    return ctx;
+}
+
+void checkRsa(SslKeylessSigner& signer, const std::string& path)
+{
+    auto client = std::make_shared<SslKeylessClient>(path);
+    auto tls13 = keylessContext(SslMethod::TLS_1_3_Server, "certs/server.crt", client);
+    auto tls12 = keylessContext(SslMethod::TLS_1_2_Server, "certs/server.crt", client);
+    expect(tls13->privateKeyOffload() == client, "keyless client not kept");
+
+    expect(runHandshake(*tls13, SslMethod::TLS_1_3_Client) > 0, "TLS 1.3 handshake did not wait for the signer");
+    expect(runHandshake(*tls12, SslMethod::TLS_1_2_Client) > 0, "TLS 1.2 handshake did not wait for the signer");
+
+    const auto stats = client->stats();
+    expect(stats.requests >= 2 && stats.failures == 0 && stats.timeouts == 0, "unexpected client stats");
+    expect(stats.inflight == 0 && stats.reconnects == 1, "unexpected client connection stats");
+    expect(signer.stats().requests >= 2 && signer.stats().errors == 0, "unexpected signer stats");
+}
+
+/**
+ * @brief 生成 P-256 密钥与自签名证书写入临时文件
+ */
+void writeEcIdentity(const std::string& cert_path, const std::string& key_path)
+{
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    expect(key && cert, "EC key generation failed");
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    expect(X509_sign(cert, key, EVP_sha256()) > 0, "EC certificate signing failed");
+
+    FILE* cert_file = std::fopen(cert_path.c_str(), "w");
+    FILE* key_file = std::fopen(key_path.c_str(), "w");
+    expect(cert_file && key_file, "open temp identity files failed");
+    const bool ok = PEM_write_X509(cert_file, cert) == 1 &&
+                    PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    std::fclose(cert_file);
+    std::fclose(key_file);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    expect(ok, "write EC identity failed");
+}
+
+void checkEcdsa()
+{
+    const std::string base = "/tmp/galay_ssl_t25_" + std::to_string(::getpid());
+    const std::string cert_path = base + ".crt";
+    const std::string key_path = base + ".key";
+    writeEcIdentity(cert_path, key_path);
+
+    const std::string path = socketPath("ec");
+    SslKeylessSigner signer(path);
+    const bool loaded = signer.addKey(key_path).has_value();
+    ::unlink(key_path.c_str());
+    expect(loaded, "signer failed to load EC key");
+    expect(signer.start().has_value(), "signer start failed");
+
+    auto client = std::make_shared<SslKeylessClient>(path);
+    auto ctx = keylessContext(SslMethod::TLS_1_3_Server, cert_path, client);
+    ::unlink(cert_path.c_str());
+    expect(runHandshake(*ctx, SslMethod::TLS_1_3_Client) > 0, "ECDSA handshake did not wait for the signer");
+    expect(client->stats().requests >= 1 && client->stats().failures == 0, "ECDSA signature not done remotely");
+}
+
+/**
+ * @brief 直接流水线提交：所有请求按 id 返回，PKCS#1 v1.5 签名与本地私钥结果一致
+ */
+void checkPipelining(const std::string& path)
+{
+    FILE* file = std::fopen("certs/server.key", "r");
+    expect(file != nullptr, "open server key failed");
+    EVP_PKEY* key = PEM_read_PrivateKey(file, nullptr, nullptr, nullptr);
+    std::fclose(file);
+    expect(key != nullptr, "read server key failed");
+    auto id = keylessKeyId(key);
+    expect(id.has_value(), "key id failed");
+
+    std::array<unsigned char, 32> digest{};
+    digest.fill(0x5a);
+    std::vector<unsigned char> expected(static_cast<size_t>(EVP_PKEY_get_size(key)));
+    {
+        EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new(key, nullptr);
+        size_t length = expected.size();
+        expect(pctx && EVP_PKEY_sign_init(pctx) == 1 &&
+               EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PADDING) == 1 &&
+               EVP_PKEY_sign(pctx, expected.data(), &length, digest.data(), digest.size()) == 1,
+               "local signature failed");
+        expected.resize(length);
+        EVP_PKEY_CTX_free(pctx);
+    }
+    EVP_PKEY_free(key);
+
+    constexpr int kRequests = 32;
+    SslKeylessClient client(path, SslKeylessOptions{.maxBatch = 8});
+    std::mutex mu;
+    std::vector<std::vector<unsigned char>> results;
+    std::atomic<int> completed{0};
+    for (int i = 0; i < kRequests; ++i) {
+        expect(client.submit(SslKeylessOp::RsaPrivateEncrypt, *id, RSA_PKCS1_PADDING, digest.data(), digest.size(),
+                             [&](auto output) {
+                                 std::lock_guard<std::mutex> lock(mu);
+                                 results.push_back(output ? *output : std::vector<unsigned char>{});
+                                 completed.fetch_add(1, std::memory_order_release);
+                             }),
+               "submit rejected");
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (completed.load(std::memory_order_acquire) < kRequests) {
+        expect(std::chrono::steady_clock::now() < deadline, "pipelined requests timed out");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (const auto& result : results) {
+        expect(result == expected, "remote signature mismatch");
+    }
+    const auto stats = client.stats();
+    expect(stats.requests == kRequests && stats.inflight == 0, "unexpected pipelining stats");
+    expect(stats.batches >= kRequests / 8 && stats.batches <= kRequests, "batches exceed maxBatch");
+}
+
+void checkFailures(const std::string& path)
+{
+    // 签名进程不可用：握手失败而不是挂起
+    auto missing = std::make_shared<SslKeylessClient>(socketPath("missing"));
+    auto ctx = keylessContext(SslMethod::TLS_1_3_Server, "certs/server.crt", missing);
+    expect(runHandshake(*ctx, SslMethod::TLS_1_3_Client) < 0, "handshake succeeded without a signer");
+    expect(missing->stats().failures >= 1, "unavailable signer not counted");
+
+    // 签名进程不持有该密钥
+    const std::string empty_path = socketPath("empty");
+    SslKeylessSigner empty(empty_path);
+    expect(empty.start().has_value(), "empty signer start failed");
+    auto unknown = std::make_shared<SslKeylessClient>(empty_path);
+    auto unknown_ctx = keylessContext(SslMethod::TLS_1_3_Server, "certs/server.crt", unknown);
+    expect(runHandshake(*unknown_ctx, SslMethod::TLS_1_3_Client) < 0, "handshake succeeded with an unknown key");
+    expect(empty.stats().errors >= 1, "unknown key not reported by the signer");
+
+    // 没有证书也没有私钥时无法挂接
+    SslContext bare(SslMethod::TLS_1_3_Server);
+    auto attached = bare.setPrivateKeyOffload(std::make_shared<SslKeylessClient>(path));
+    expect(!attached && attached.error().code() == SslErrorCode::kPrivateKeyLoadFailed,
+           "keyless client attached without a certificate");
+}
+
+} // namespace
+
+int main()
+{
+    const std::string path = socketPath("rsa");
+    SslKeylessSigner signer(path);
+    expect(signer.addKey("certs/server.key").has_value(), "signer failed to load RSA key");
+    expect(signer.start().has_value(), "signer start failed");
+
+    checkRsa(signer, path);
+    checkEcdsa();
+    checkPipelining(path);
+    checkFailures(path);
+    signer.stop();
+    expect(::access(path.c_str(), F_OK) != 0, "signer socket not removed");
+    return 0;
+}
@@ -0,0 +1,259 @@
+/**
+ * @file t26_key_share_pool.cc
+ * @brief 用途：锁定以 SslKeySharePool 构造的上下文从预生成池取 ECDHE 临时密钥的语义。
+ * 关键覆盖点：TLS 1.3 X25519 / P-256 与 TLS 1.2 ECDHE 的服务端 key share 取自池，客户端上下文同样可用；
+ * 每次握手的临时公钥都不同；池被取空后现场生成并由后台线程补齐；ECDSA 证书在该上下文下照常签名；
+ * 多个池同时存在时每个上下文只从自己的池取密钥，未挂池的上下文不取。
+ * 通过条件：握手完成、应用数据往返成功，池统计符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_key_share_pool.h"
+
+#include <openssl/ec.h>
+#include <openssl/pem.h>
+#include <unistd.h>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    std::vector<char> out(from.pendingEncryptedOutput());
+    if (out.empty()) {
+        return;
+    }
+    expect(from.extractEncryptedOutput(out.data(), out.size()) == static_cast<int>(out.size()),
+           "extractEncryptedOutput failed");
+    expect(to.feedEncryptedInput(out.data(), out.size()) == static_cast<int>(out.size()),
+           "feedEncryptedInput failed");
+}
+
+/**
+ * @brief 完成一次握手并往返一次应用数据
+ * @return 客户端看到的服务端临时公钥
+ */
+std::string handshake(SslContext& server_ctx, SslContext& client_ctx)
+{
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+
+    for (int i = 0; i < 64 && !(client.isHandshakeCompleted() && server.isHandshakeCompleted()); ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "client handshake failed");
+        }
+        transferPending(client, server);
+        if (!server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "server handshake failed");
+        }
+        transferPending(server, client);
+    }
+    expect(client.isHandshakeCompleted() && server.isHandshakeCompleted(), "handshake did not complete");
+
+    const std::string payload = "keyshare-ping";
+    size_t written = 0;
+    expect(client.write(payload.data(), payload.size(), written) == SslIOResult::Success, "client write failed");
+    transferPending(client, server);
+    std::array<char, 64> buffer{};
+    size_t bytes_read = 0;
+    expect(server.read(buffer.data(), buffer.size(), bytes_read) == SslIOResult::Success, "server read failed");
+    expect(std::string(buffer.data(), bytes_read) == payload, "payload mismatch");
+
+    EVP_PKEY* peer = nullptr;
+    expect(SSL_get_peer_tmp_key(client.native(), &peer) == 1, "no server key share");
+    unsigned char* encoded = nullptr;
+    const size_t length = EVP_PKEY_get1_encoded_public_key(peer, &encoded);
+    std::string result(reinterpret_cast<char*>(encoded), length);
+    OPENSSL_free(encoded);
+    EVP_PKEY_free(peer);
+    expect(length > 0, "empty server key share");
+    return result;
+}
+
+std::unique_ptr<SslContext> serverContext(SslMethod method, const std::shared_ptr<SslKeySharePool>& pool,
+                                          const std::string& cert, const std::string& key)
+{
+    auto ctx = std::make_unique<SslContext>(method, pool);
+    expect(ctx->isValid(), "server context invalid");
+    expect(ctx->keySharePool() == pool, "key share pool not kept");
+    expect(ctx->loadCertificate(cert).has_value(), "load server cert failed");
+    expect(ctx->loadPrivateKey(key).has_value(), "load server key failed");
+    return ctx;
+}
+
+void checkGroups(const std::shared_ptr<SslKeySharePool>& pool)
+{
+    auto server = serverContext(SslMethod::TLS_1_3_Server, pool, "certs/server.crt", "certs/server.key");
+    SslContext client(SslMethod::TLS_1_3_Client);
+
+    uint64_t served = pool->stats().served;
+    std::set<std::string> shares;
+    for (int i = 0; i < 3; ++i) {
+        shares.insert(handshake(*server, client));
+    }
+    expect(shares.size() == 3, "ephemeral key share reused");
+    expect(pool->stats().served >= served + 3, "X25519 key shares not served from the pool");
+
+    served = pool->stats().served;
+    expect(SSL_CTX_set1_groups_list(server->native(), "P-256") == 1 &&
+           SSL_CTX_set1_groups_list(client.native(), "P-256") == 1, "set P-256 failed");
+    handshake(*server, client);
+    expect(pool->stats().served >= served + 1, "P-256 key share not served from the pool");
+
+    // 客户端上下文同样从池中生成 key share
+    served = pool->stats().served;
+    SslContext pooled_client(SslMethod::TLS_1_3_Client, pool);
+    SslContext plain_server(SslMethod::TLS_1_3_Server);
+    expect(plain_server.loadCertificate("certs/server.crt").has_value() &&
+           plain_server.loadPrivateKey("certs/server.key").has_value(), "load plain server identity failed");
+    handshake(plain_server, pooled_client);
+    expect(pool->stats().served >= served + 1, "client key share not served from the pool");
+
+    // TLS 1.2 ECDHE
+    served = pool->stats().served;
+    auto tls12 = serverContext(SslMethod::TLS_1_2_Server, pool, "certs/server.crt", "certs/server.key");
+    SslContext tls12_client(SslMethod::TLS_1_2_Client);
+    handshake(*tls12, tls12_client);
+    expect(pool->stats().served >= served + 1, "TLS 1.2 ECDHE key not served from the pool");
+}
+
+/**
+ * @brief 生成 P-256 自签名证书写入临时文件
+ */
+void writeEcIdentity(const std::string& cert_path, const std::string& key_path)
+{
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    expect(key && cert, "EC key generation failed");
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    expect(X509_sign(cert, key, EVP_sha256()) > 0, "EC certificate signing failed");
+
+    FILE* cert_file = std::fopen(cert_path.c_str(), "w");
+    FILE* key_file = std::fopen(key_path.c_str(), "w");
+    expect(cert_file && key_file, "open temp identity files failed");
+    const bool ok = PEM_write_X509(cert_file, cert) == 1 &&
+                    PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    std::fclose(cert_file);
+    std::fclose(key_file);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    expect(ok, "write EC identity failed");
+}
+
+void checkEcdsaCertificate(const std::shared_ptr<SslKeySharePool>& pool)
+{
+    const std::string base = "/tmp/galay_ssl_t26_" + std::to_string(::getpid());
+    writeEcIdentity(base + ".crt", base + ".key");
+    std::unique_ptr<SslContext> server;
+    try {
+        server = serverContext(SslMethod::TLS_1_3_Server, pool, base + ".crt", base + ".key");
+    } catch (...) {
+        ::unlink((base + ".crt").c_str());
+        ::unlink((base + ".key").c_str());
+        throw;
+    }
+    ::unlink((base + ".crt").c_str());
+    ::unlink((base + ".key").c_str());
+
+    SslContext client(SslMethod::TLS_1_3_Client);
+    handshake(*server, client);
+}
+
+void checkRefill(const std::shared_ptr<SslKeySharePool>& pool)
+{
+    auto server = serverContext(SslMethod::TLS_1_3_Server, pool, "certs/server.crt", "certs/server.key");
+    SslContext client(SslMethod::TLS_1_3_Client);
+    // 客户端不从池取，服务端每次握手取一个；超过容量后出现现场生成或后台补齐
+    const auto before = pool->stats();
+    for (size_t i = 0; i < pool->options().capacity * 2; ++i) {
+        handshake(*server, client);
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pool->stats().available < pool->options().capacity) {
+        expect(std::chrono::steady_clock::now() < deadline, "pool was not refilled");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    const auto after = pool->stats();
+    expect(after.generated > before.generated, "background thread did not generate keys");
+    expect(after.served + after.misses >= before.served + before.misses + pool->options().capacity * 2,
+           "handshakes did not draw key shares");
+}
+
+/**
+ * @brief 两个池并存：上下文只从构造时传入的池取密钥
+ */
+void checkSeparatePools(const std::shared_ptr<SslKeySharePool>& pool)
+{
+    auto second = SslKeySharePool::create(SslKeySharePoolOptions{.groups = {"X25519"}, .capacity = 4});
+    expect(second.has_value(), "second pool rejected");
+    expect((*second)->propertyQuery() != pool->propertyQuery(), "pools share a property query");
+
+    auto server = serverContext(SslMethod::TLS_1_3_Server, *second, "certs/server.crt", "certs/server.key");
+    SslContext client(SslMethod::TLS_1_3_Client);
+    const auto first_before = pool->stats();
+    const auto second_before = (*second)->stats();
+    handshake(*server, client);
+    expect((*second)->stats().served == second_before.served + 1, "key share not served from the context's pool");
+
+    SslContext plain_server(SslMethod::TLS_1_3_Server);
+    expect(plain_server.loadCertificate("certs/server.crt").has_value() &&
+           plain_server.loadPrivateKey("certs/server.key").has_value(), "load plain server identity failed");
+    handshake(plain_server, client);
+    const auto first_after = pool->stats();
+    expect(first_after.served == first_before.served && first_after.misses == first_before.misses,
+           "key share drawn from another context's pool");
+}
+
+} // namespace
+
+int main()
+{
+    auto pool = SslKeySharePool::create(SslKeySharePoolOptions{.capacity = 8, .refillThreshold = 4});
+    expect(pool.has_value(), "create key share pool failed");
+    const auto initial = (*pool)->stats();
+    expect(initial.available == 16 && initial.generated == 16, "pool not prefilled");
+
+    auto unknown = SslKeySharePool::create(SslKeySharePoolOptions{.groups = {"no-such-curve"}});
+    expect(!unknown && unknown.error().code() == SslErrorCode::kKeySharePoolFailed, "unknown group accepted");
+
+    checkGroups(*pool);
+    checkEcdsaCertificate(*pool);
+    checkRefill(*pool);
+    checkSeparatePools(*pool);
+
+    // 释放后可以重新创建
+    pool->reset();
+    auto again = SslKeySharePool::create(SslKeySharePoolOptions{.groups = {"X25519"}, .capacity = 2});
+    expect(again.has_value(), "pool could not be recreated");
+    return 0;
+}
@@ -0,0 +1,324 @@
+/**
+ * @file t27_handshake_admission.cc
+ * @brief 用途：锁定 SslHandshakeAdmission 的并发上限、排队、丢弃与唤醒顺序，以及 SslHandshakePool 接入后的行为。
+ * 关键覆盖点：超过上限的申请排队、排满即丢弃并返回 kHandshakeShed；名额释放后排队者经调度器恢复，
+ * 排在已就绪的任务之后；排队超时由定时器丢弃；握手池在唯一名额被占用时丢弃新连接，名额释放后恢复服务。
+ * 通过条件：计数与恢复顺序符合预期，被丢弃的连接握手失败，之后的连接 echo 往返成功。
+ */
+
+#include "galay-ssl/async/ssl_handshake_admission.h"
+#include "galay-ssl/async/ssl_handshake_pool.h"
+#include "galay-ssl/ssl/ssl_context.h"
+#include <galay-kernel/common/defn.hpp>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef USE_IOURING
+#include <galay-kernel/kernel/io_uring_scheduler.h>
+using TestScheduler = galay::kernel::IOUringScheduler;
+#elif defined(USE_EPOLL)
+#include <galay-kernel/kernel/epoll_scheduler.h>
+using TestScheduler = galay::kernel::EpollScheduler;
+#elif defined(USE_KQUEUE)
+#include <galay-kernel/kernel/kqueue_scheduler.h>
+using TestScheduler = galay::kernel::KqueueScheduler;
+#endif
+
+using namespace galay::ssl;
+using namespace galay::kernel;
+
+namespace {
+
+constexpr uint16_t kPort = 19465;
+const std::string kPayload = "admission-ping";
+
+struct TestState {
+    std::atomic<bool> server_ready{false};
+    std::atomic<int> admitted{0};
+    std::atomic<int> shed{0};
+    std::atomic<int> order{0};
+    std::atomic<int> data_order{0};
+    std::atomic<int> waiter_order{0};
+    std::atomic<int> round_trips{0};
+    std::atomic<int> clients_done{0};
+    std::atomic<int> client_failures{0};
+    std::atomic<bool> failed{false};
+    std::mutex mu;
+    std::string failure;
+    std::vector<SslHandshakePermit> held;   ///< 只在 admission 所属调度器线程上访问
+};
+
+void fail(TestState* state, std::string message)
+{
+    state->failed.store(true, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(state->mu);
+    if (state->failure.empty()) {
+        state->failure = std::move(message);
+    }
+}
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+void waitUntil(TestState& state, const std::function<bool()>& done, const char* message)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done()) {
+        if (state.failed.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(state.mu);
+            throw std::runtime_error(state.failure);
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            throw std::runtime_error(message);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+Host target()
+{
+    return Host(IPType::IPV4, "127.0.0.1", kPort);
+}
+
+// ==================== SslHandshakeAdmission ====================
+
+Task<void> contender(SslHandshakeAdmission* admission, TestState* state, bool record_order)
+{
+    auto permit = co_await admission->acquire();
+    if (!permit) {
+        if (permit.error().code() != SslErrorCode::kHandshakeShed) {
+            fail(state, "unexpected admission error");
+        }
+        state->shed.fetch_add(1, std::memory_order_release);
+        co_return;
+    }
+    if (record_order) {
+        state->waiter_order.store(state->order.fetch_add(1) + 1, std::memory_order_release);
+    }
+    state->held.push_back(std::move(*permit));
+    state->admitted.fetch_add(1, std::memory_order_release);
+}
+
+Task<void> dataWork(TestState* state)
+{
+    state->data_order.store(state->order.fetch_add(1) + 1, std::memory_order_release);
+    co_return;
+}
+
+/**
+ * @brief 先投递一个数据任务，再归还一个许可：被唤醒的排队者必须排在数据任务之后
+ */
+Task<void> releaseBehindData(IOScheduler* scheduler, TestState* state)
+{
+    if (!scheduleTask(scheduler, dataWork(state))) {
+        fail(state, "schedule data work failed");
+    }
+    if (!state->held.empty()) {
+        state->held.erase(state->held.begin());
+    }
+    co_return;
+}
+
+Task<void> releaseAll(TestState* state)
+{
+    state->held.clear();
+    co_return;
+}
+
+void checkAdmission(TestScheduler& scheduler)
+{
+    TestState state;
+    SslHandshakeAdmission admission(&scheduler, {.maxInflight = 2, .maxQueued = 2});
+
+    for (int i = 0; i < 5; ++i) {
+        // 第 3 个申请排队并记录恢复顺序
+        expect(scheduleTask(scheduler, contender(&admission, &state, i == 2)), "schedule contender failed");
+    }
+    waitUntil(state, [&] { return state.admitted.load() == 2 && state.shed.load() == 1; },
+              "admission did not cap in-flight handshakes");
+    auto stats = admission.stats();
+    expect(stats.inflight == 2 && stats.queued == 2 && stats.limit == 2, "unexpected admission snapshot");
+    expect(stats.queuedTotal == 2 && stats.shed == 1, "unexpected admission counters");
+
+    expect(scheduleTask(scheduler, releaseBehindData(&scheduler, &state)), "schedule release failed");
+    waitUntil(state, [&] { return state.admitted.load() == 3; }, "queued handshake was not admitted");
+    expect(state.data_order.load() != 0 && state.data_order.load() < state.waiter_order.load(),
+           "woken handshake ran ahead of ready data work");
+
+    expect(scheduleTask(scheduler, releaseAll(&state)), "schedule release failed");
+    waitUntil(state, [&] { return state.admitted.load() == 4; }, "last queued handshake was not admitted");
+    expect(scheduleTask(scheduler, releaseAll(&state)), "schedule release failed");
+    waitUntil(state, [&] { return admission.stats().inflight == 0; }, "permits were not returned");
+    expect(admission.stats().admitted == 4 && admission.stats().shed == 1, "unexpected final counters");
+
+    // 排队超时：占满唯一名额后，没有新的申请或归还，排队定时器也会按时丢弃排队者
+    TestState timed;
+    SslHandshakeAdmission short_queue(&scheduler, {.maxInflight = 1, .queueTimeout = std::chrono::milliseconds(20)});
+    expect(scheduleTask(scheduler, contender(&short_queue, &timed, false)), "schedule contender failed");
+    expect(scheduleTask(scheduler, contender(&short_queue, &timed, false)), "schedule contender failed");
+    waitUntil(timed, [&] { return timed.shed.load() == 1; }, "expired waiter was not shed by the timer");
+    expect(timed.admitted.load() == 1 && short_queue.stats().queued == 0, "expired waiter was admitted");
+    expect(scheduleTask(scheduler, releaseAll(&timed)), "schedule release failed");
+    waitUntil(timed, [&] { return short_queue.stats().inflight == 0; }, "permit was not returned");
+
+    // 自适应：持续高于目标的延迟把上限压到下界
+    SslHandshakeAdmission adaptive(&scheduler, {.maxInflight = 64, .adaptive = true, .minInflight = 4,
+                                                .targetLatency = std::chrono::microseconds(100)});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (adaptive.stats().limit > 4 && std::chrono::steady_clock::now() < deadline) {
+        adaptive.observeLoopLatency(std::chrono::microseconds(1000));
+        std::this_thread::sleep_for(std::chrono::milliseconds(11));
+    }
+    expect(adaptive.stats().limit == 4, "adaptive limit did not shrink");
+    expect(adaptive.stats().loopLatency >= std::chrono::microseconds(500), "loop latency not tracked");
+}
+
+// ==================== SslHandshakePool ====================
+
+Task<void> echo(SslSocket conn)
+{
+    char buffer[256];
+    for (;;) {
+        auto received = co_await conn.recv(buffer, sizeof(buffer));
+        if (!received || received->size() == 0) {
+            break;
+        }
+        if (!co_await conn.send(buffer, received->size())) {
+            break;
+        }
+    }
+    (void)co_await conn.close();
+}
+
+Task<void> runAcceptor(SslContext* ctx, SslHandshakePool* pool, TestState* state)
+{
+    SslSocket listener(ctx);
+    listener.option().handleReuseAddr();
+    listener.option().handleNonBlock();
+    if (!listener.bind(target()) || !listener.listen(64)) {
+        fail(state, "server bind/listen failed");
+        co_return;
+    }
+    state->server_ready.store(true, std::memory_order_release);
+    for (;;) {
+        Host client_host;
+        auto accepted = co_await listener.accept(&client_host);
+        if (!accepted) {
+            break;
+        }
+        if (!pool->submit(ctx, accepted.value())) {
+            ::close(accepted.value().fd);
+            fail(state, "handshake pool rejected a connection");
+        }
+    }
+}
+
+Task<void> runClient(SslContext* ctx, TestState* state)
+{
+    SslSocket socket(ctx);
+    auto sent = co_await socket.connectAndSend(target(), kPayload.data(), kPayload.size());
+    if (!sent) {
+        state->client_failures.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        char buffer[64];
+        auto received = co_await socket.recv(buffer, sizeof(buffer));
+        if (received && received->toStringView() == kPayload) {
+            state->round_trips.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            state->client_failures.fetch_add(1, std::memory_order_relaxed);
+        }
+        (void)co_await socket.shutdown();
+    }
+    (void)co_await socket.close();
+    state->clients_done.fetch_add(1, std::memory_order_release);
+}
+
+void checkPool(TestScheduler& acceptor, TestScheduler& handshaker, TestScheduler& data)
+{
+    SslContext server_ctx(SslMethod::TLS_1_3_Server);
+    SslContext client_ctx(SslMethod::TLS_1_3_Client);
+    expect(server_ctx.isValid() && client_ctx.isValid(), "context invalid");
+    expect(server_ctx.loadCertificate("certs/server.crt").has_value(), "load server cert failed");
+    expect(server_ctx.loadPrivateKey("certs/server.key").has_value(), "load server key failed");
+
+    TestState state;
+    SslHandshakePoolOptions options;
+    options.admission = SslHandshakeAdmissionOptions{.maxInflight = 1, .maxQueued = 0};
+    SslHandshakePool pool({&handshaker}, {&data}, echo, options);
+
+    expect(scheduleTask(acceptor, runAcceptor(&server_ctx, &pool, &state)), "schedule acceptor failed");
+    waitUntil(state, [&] { return state.server_ready.load(std::memory_order_acquire); },
+              "server did not become ready");
+
+    // 连上但不发 ClientHello，占住唯一的握手名额
+    const int staller = ::socket(AF_INET, SOCK_STREAM, 0);
+    const Host host = target();
+    expect(staller >= 0 && ::connect(staller, host.sockAddr(), host.addrLen()) == 0, "staller connect failed");
+    waitUntil(state, [&] { return pool.stats().submitted == 1; }, "staller was not submitted");
+
+    expect(scheduleTask(acceptor, runClient(&client_ctx, &state)), "schedule client failed");
+    waitUntil(state, [&] { return state.clients_done.load(std::memory_order_acquire) == 1; },
+              "shed client timed out");
+    expect(state.client_failures.load() == 1 && state.round_trips.load() == 0, "client was not shed");
+    expect(pool.stats().shed == 1, "shed connection not counted");
+
+    ::close(staller);
+    waitUntil(state, [&] { return pool.stats().failed == 2; }, "stalled handshake did not release its slot");
+
+    expect(scheduleTask(acceptor, runClient(&client_ctx, &state)), "schedule client failed");
+    waitUntil(state, [&] { return state.clients_done.load(std::memory_order_acquire) == 2; },
+              "admitted client timed out");
+    expect(state.round_trips.load() == 1, "client after release did not complete");
+
+    const auto stats = pool.stats();
+    expect(stats.submitted == 3 && stats.completed == 1 && stats.shed == 1, "unexpected pool stats");
+    expect(stats.inflight == 0 && stats.queued == 0, "pool not drained");
+}
+
+} // namespace
+
+int main()
+{
+    TestScheduler acceptor;
+    TestScheduler handshaker;
+    TestScheduler data;
+    for (auto* scheduler : {&acceptor, &handshaker, &data}) {
+        scheduler->start();
+    }
+
+    int rc = 0;
+    try {
+        checkAdmission(handshaker);
+        checkPool(acceptor, handshaker, data);
+    } catch (const std::exception& ex) {
+        std::cerr << "[T27] " << ex.what() << "\n";
+        rc = 1;
+    }
+
+    if (rc != 0) {
+        std::cerr.flush();
+        std::_Exit(rc);
+    }
+
+    for (auto* scheduler : {&data, &handshaker, &acceptor}) {
+        scheduler->stop();
+    }
+    std::cout << "t27_handshake_admission PASS\n";
+    return 0;
+}
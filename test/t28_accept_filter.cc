@@ -0,0 +1,268 @@
+/**
+ * @file t28_accept_filter.cc
+ * @brief 用途：锁定 SslAcceptFilter 在握手前拒绝连接的语义。
+ * 关键覆盖点：每源令牌桶的突发、回填与 retryAfter；IPv6 按前缀聚合、IPv4 映射地址与 IPv4 同源；
+ * 全局预算，被全局拒绝的连接不消耗源令牌；源地址表满时淘汰而不增长；ClientHello 首字节判定；screen() 对真实 ClientHello、
+ * 明文协议、已关闭连接和尚无数据的连接的结论。
+ * 通过条件：各结论与统计符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_accept_filter.h"
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace galay::ssl;
+using namespace std::chrono_literals;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+sockaddr_in ipv4(const char* text)
+{
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    expect(::inet_pton(AF_INET, text, &addr.sin_addr) == 1, "bad ipv4 literal");
+    return addr;
+}
+
+sockaddr_in6 ipv6(const char* text)
+{
+    sockaddr_in6 addr{};
+    addr.sin6_family = AF_INET6;
+    expect(::inet_pton(AF_INET6, text, &addr.sin6_addr) == 1, "bad ipv6 literal");
+    return addr;
+}
+
+template <typename Addr>
+SslAcceptDecision check(SslAcceptFilter& filter, const Addr& addr, SslAcceptFilter::Clock::time_point now)
+{
+    return filter.check(reinterpret_cast<const sockaddr*>(&addr), sizeof(addr), now);
+}
+
+void checkSourceBucket()
+{
+    SslAcceptFilter filter(SslAcceptFilterOptions{.perSourceRate = 10, .perSourceBurst = 3});
+    const auto t0 = SslAcceptFilter::Clock::now();
+    const auto a = ipv4("192.0.2.1");
+
+    for (int i = 0; i < 3; ++i) {
+        expect(static_cast<bool>(check(filter, a, t0)), "burst rejected");
+    }
+    const auto over = check(filter, a, t0);
+    expect(over.verdict == SslAcceptVerdict::RejectSource, "over-burst accepted");
+    expect(over.retryAfter >= 99ms && over.retryAfter <= 101ms, "unexpected retryAfter");
+
+    // 其他源不受影响
+    expect(static_cast<bool>(check(filter, ipv4("192.0.2.2"), t0)), "other source rejected");
+
+    // 一个间隔后回填一个令牌
+    expect(static_cast<bool>(check(filter, a, t0 + 100ms)), "refilled token rejected");
+    expect(!check(filter, a, t0 + 100ms), "second token after refill accepted");
+    expect(static_cast<bool>(check(filter, a, t0 + 10s)), "idle source not refilled");
+
+    const auto stats = filter.stats();
+    expect(stats.accepted == 6 && stats.rejectedSource == 2, "unexpected source stats");
+}
+
+void checkAggregation()
+{
+    SslAcceptFilter filter(SslAcceptFilterOptions{.perSourceRate = 1, .perSourceBurst = 1, .ipv6PrefixLength = 64});
+    const auto now = SslAcceptFilter::Clock::now();
+
+    expect(static_cast<bool>(check(filter, ipv6("2001:db8:1:2::1"), now)), "first ipv6 rejected");
+    expect(!check(filter, ipv6("2001:db8:1:2:ffff::9"), now), "same /64 not aggregated");
+    expect(static_cast<bool>(check(filter, ipv6("2001:db8:1:3::1"), now)), "other /64 rejected");
+
+    expect(static_cast<bool>(check(filter, ipv4("198.51.100.7"), now)), "first ipv4 rejected");
+    expect(!check(filter, ipv6("::ffff:198.51.100.7"), now), "v4-mapped not treated as ipv4");
+    expect(static_cast<bool>(check(filter, ipv4("198.51.100.8"), now)), "neighbouring ipv4 aggregated");
+}
+
+void checkGlobalBudget()
+{
+    SslAcceptFilter filter(SslAcceptFilterOptions{.perSourceRate = 0, .globalRate = 100, .globalBurst = 2});
+    const auto now = SslAcceptFilter::Clock::now();
+
+    expect(static_cast<bool>(check(filter, ipv4("203.0.113.1"), now)), "global first rejected");
+    expect(static_cast<bool>(check(filter, ipv4("203.0.113.2"), now)), "global second rejected");
+    const auto over = check(filter, ipv4("203.0.113.3"), now);
+    expect(over.verdict == SslAcceptVerdict::RejectGlobal && over.retryAfter > 0us, "global budget not enforced");
+    expect(static_cast<bool>(check(filter, ipv4("203.0.113.3"), now + 10ms)), "global budget not refilled");
+    expect(filter.stats().rejectedGlobal == 1, "unexpected global stats");
+}
+
+void checkGlobalRefund()
+{
+    SslAcceptFilter filter(SslAcceptFilterOptions{
+        .perSourceRate = 1, .perSourceBurst = 2, .globalRate = 100, .globalBurst = 1});
+    const auto now = SslAcceptFilter::Clock::now();
+    const auto a = ipv4("203.0.113.10");
+
+    expect(static_cast<bool>(check(filter, a, now)), "first connection rejected");
+    // 全局预算耗尽期间的重试不扣源令牌
+    for (int i = 0; i < 4; ++i) {
+        expect(check(filter, a, now).verdict == SslAcceptVerdict::RejectGlobal, "global budget not enforced");
+    }
+    expect(static_cast<bool>(check(filter, a, now + 10ms)), "global rejection consumed the source burst");
+    expect(check(filter, a, now + 20ms).verdict == SslAcceptVerdict::RejectSource, "source burst not enforced");
+}
+
+void checkEviction()
+{
+    // 16 个分片 × 每片 kProbeWindow 个槽位
+    SslAcceptFilter filter(SslAcceptFilterOptions{.perSourceRate = 1, .perSourceBurst = 1, .sourceTableSize = 16});
+    const auto now = SslAcceptFilter::Clock::now();
+
+    for (uint32_t i = 0; i < 4096; ++i) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(0x0a000000u + i);
+        expect(static_cast<bool>(filter.check(reinterpret_cast<const sockaddr*>(&addr), sizeof(addr), now)),
+               "fresh source rejected");
+    }
+    const auto stats = filter.stats();
+    expect(stats.evictions >= 4096 - 16 * SslAcceptFilter::kProbeWindow, "table grew instead of evicting");
+}
+
+void checkHelloBytes()
+{
+    const unsigned char hello[] = {0x16, 0x03, 0x01, 0x02, 0x00, 0x01};
+    expect(SslAcceptFilter::looksLikeClientHello(hello, sizeof(hello)), "valid ClientHello rejected");
+    expect(SslAcceptFilter::looksLikeClientHello(hello, 3), "valid prefix rejected");
+
+    const unsigned char http[] = {'G', 'E', 'T', ' ', '/', ' '};
+    const unsigned char alert[] = {0x15, 0x03, 0x03, 0x00, 0x02, 0x02};
+    const unsigned char server_hello[] = {0x16, 0x03, 0x03, 0x00, 0x40, 0x02};
+    const unsigned char empty_record[] = {0x16, 0x03, 0x01, 0x00, 0x00, 0x01};
+    const unsigned char huge_record[] = {0x16, 0x03, 0x01, 0xff, 0xff, 0x01};
+    const unsigned char ssl2[] = {0x80, 0x2e, 0x01, 0x03, 0x01, 0x00};
+    expect(!SslAcceptFilter::looksLikeClientHello(http, sizeof(http)), "http accepted");
+    expect(!SslAcceptFilter::looksLikeClientHello(alert, sizeof(alert)), "alert accepted");
+    expect(!SslAcceptFilter::looksLikeClientHello(server_hello, sizeof(server_hello)), "ServerHello accepted");
+    expect(!SslAcceptFilter::looksLikeClientHello(empty_record, sizeof(empty_record)), "empty record accepted");
+    expect(!SslAcceptFilter::looksLikeClientHello(huge_record, sizeof(huge_record)), "oversized record accepted");
+    expect(!SslAcceptFilter::looksLikeClientHello(ssl2, sizeof(ssl2)), "SSLv2 hello accepted");
+}
+
+std::string clientHello()
+{
+    SslContext ctx(SslMethod::TLS_Client);
+    SslEngine engine(&ctx);
+    expect(engine.initMemoryBIO().has_value(), "memory BIO failed");
+    engine.setConnectState();
+    expect(engine.doHandshake() == SslIOResult::WantRead, "client did not start handshake");
+    std::string out(engine.pendingEncryptedOutput(), '\0');
+    expect(engine.extractEncryptedOutput(out.data(), out.size()) == static_cast<int>(out.size()),
+           "extractEncryptedOutput failed");
+    return out;
+}
+
+class Loopback
+{
+public:
+    Loopback()
+    {
+        m_listen = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = ipv4("127.0.0.1");
+        expect(::bind(m_listen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0, "bind failed");
+        expect(::listen(m_listen, 16) == 0, "listen failed");
+        socklen_t length = sizeof(m_addr);
+        expect(::getsockname(m_listen, reinterpret_cast<sockaddr*>(&m_addr), &length) == 0, "getsockname failed");
+    }
+
+    ~Loopback() { ::close(m_listen); }
+
+    /**
+     * @brief 建立一条连接，客户端发送 payload（可选地随后关闭），返回服务端 fd 与客户端 fd
+     */
+    std::pair<int, int> connect(const std::string& payload, bool close_client)
+    {
+        int client = ::socket(AF_INET, SOCK_STREAM, 0);
+        expect(::connect(client, reinterpret_cast<sockaddr*>(&m_addr), sizeof(m_addr)) == 0, "connect failed");
+        if (!payload.empty()) {
+            expect(::send(client, payload.data(), payload.size(), 0) == static_cast<ssize_t>(payload.size()),
+                   "send failed");
+        }
+        if (close_client) {
+            ::close(client);
+            client = -1;
+        }
+        int server = ::accept(m_listen, nullptr, nullptr);
+        expect(server >= 0, "accept failed");
+        // 回环上数据与 FIN 几乎立即可见，留一点余量
+        std::this_thread::sleep_for(20ms);
+        return {server, client};
+    }
+
+    int fd() const { return m_listen; }
+
+private:
+    int m_listen = -1;
+    sockaddr_in m_addr{};
+};
+
+void checkScreen()
+{
+    SslAcceptFilter filter(SslAcceptFilterOptions{.perSourceRate = 1000, .perSourceBurst = 100});
+    Loopback loopback;
+
+    auto [tls, tls_client] = loopback.connect(clientHello(), false);
+    expect(static_cast<bool>(filter.screen(tls)), "real ClientHello rejected");
+    // MSG_PEEK 不消费数据
+    char first = 0;
+    expect(::recv(tls, &first, 1, MSG_DONTWAIT) == 1 && first == 0x16, "screen consumed ClientHello");
+
+    auto [http, http_client] = loopback.connect("GET / HTTP/1.1\r\n\r\n", false);
+    expect(filter.screen(http).verdict == SslAcceptVerdict::RejectProtocol, "plaintext request accepted");
+
+    auto [closed, closed_client] = loopback.connect("", true);
+    expect(filter.screen(closed).verdict == SslAcceptVerdict::RejectProtocol, "closed connection accepted");
+
+    auto [silent, silent_client] = loopback.connect("", false);
+    expect(static_cast<bool>(filter.screen(silent)), "silent connection rejected");
+
+    const auto stats = filter.stats();
+    expect(stats.accepted == 2 && stats.rejectedProtocol == 2 && stats.helloPending == 1, "unexpected screen stats");
+
+    for (int fd : {tls, tls_client, http, http_client, closed, silent, silent_client}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    (void)closed_client;
+
+#ifdef TCP_DEFER_ACCEPT
+    Loopback deferred;
+    expect(SslAcceptFilter::enableDeferAccept(deferred.fd()), "TCP_DEFER_ACCEPT not applied");
+#endif
+}
+
+} // namespace
+
+int main()
+{
+    checkSourceBucket();
+    checkAggregation();
+    checkGlobalBudget();
+    checkGlobalRefund();
+    checkEviction();
+    checkHelloBytes();
+    checkScreen();
+    return 0;
+}
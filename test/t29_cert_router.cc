@@ -0,0 +1,364 @@
+/**
+ * @file t29_cert_router.cc
+ * @brief 用途：锁定 SslCertRouter 按 SNI 选择证书的语义。
+ * 关键覆盖点：反转标签字典树的精确 / 通配符匹配（通配符只匹配一个标签、精确优先、大小写与结尾点）；
+ * 目录登记不加载证书、首次访问才加载；LRU 淘汰后仍在使用的上下文不失效；addHost() 替换证书；
+ * 默认主机；真实握手中客户端按 SNI 拿到对应证书，无匹配时握手失败；冷主机在后台加载，握手先得到
+ * WantAsync 并在 asyncWaitFd() 可读后继续，同一主机的并发握手只加载一次。
+ * 通过条件：选择结果、握手结果与统计符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_cert_router.h"
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * @brief 生成 CN 为 commonName 的 P-256 自签名证书
+ */
+void writeIdentity(const std::string& cert_path, const std::string& key_path, const std::string& commonName)
+{
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    expect(key && cert, "EC key generation failed");
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               reinterpret_cast<const unsigned char*>(commonName.c_str()), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    expect(X509_sign(cert, key, EVP_sha256()) > 0, "EC certificate signing failed");
+
+    FILE* cert_file = std::fopen(cert_path.c_str(), "w");
+    FILE* key_file = std::fopen(key_path.c_str(), "w");
+    expect(cert_file && key_file, "open identity files failed");
+    const bool ok = PEM_write_X509(cert_file, cert) == 1 &&
+                    PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    std::fclose(cert_file);
+    std::fclose(key_file);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    expect(ok, "write identity failed");
+}
+
+std::string commonName(SslContext& ctx)
+{
+    X509* cert = SSL_CTX_get0_certificate(ctx.native());
+    expect(cert != nullptr, "context has no certificate");
+    char buffer[256] = {};
+    X509_NAME_get_text_by_NID(X509_get_subject_name(cert), NID_commonName, buffer, sizeof(buffer));
+    return buffer;
+}
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    std::vector<char> out(from.pendingEncryptedOutput());
+    if (out.empty()) {
+        return;
+    }
+    expect(from.extractEncryptedOutput(out.data(), out.size()) == static_cast<int>(out.size()),
+           "extractEncryptedOutput failed");
+    expect(to.feedEncryptedInput(out.data(), out.size()) == static_cast<int>(out.size()),
+           "feedEncryptedInput failed");
+}
+
+/**
+ * @brief 等待路由后台加载结束（asyncWaitFd() 可读）
+ */
+void waitForLoad(SslEngine& server)
+{
+    pollfd pfd{server.asyncWaitFd(), POLLIN, 0};
+    expect(pfd.fd >= 0, "no wait fd for pending load");
+    expect(::poll(&pfd, 1, 5000) == 1, "router load did not complete");
+}
+
+/**
+ * @brief 推进服务端握手，冷主机的 WantAsync 等待加载结束后重试
+ */
+SslIOResult serverStep(SslEngine& server)
+{
+    auto ret = server.doHandshake();
+    while (ret == SslIOResult::WantAsync) {
+        waitForLoad(server);
+        ret = server.doHandshake();
+    }
+    return ret;
+}
+
+/**
+ * @brief 以给定 SNI 对路由前端上下文握手
+ * @return 客户端看到的服务端证书 CN；握手失败返回空串
+ */
+std::string handshake(SslCertRouter& router, const std::string& sni)
+{
+    SslContext client_ctx(SslMethod::TLS_Client);
+    SslEngine client(&client_ctx);
+    SslEngine server(router.context());
+    expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+    if (!sni.empty()) {
+        expect(client.setHostname(sni).has_value(), "set SNI failed");
+    }
+    client.setConnectState();
+    server.setAcceptState();
+
+    for (int i = 0; i < 16 && !(client.isHandshakeCompleted() && server.isHandshakeCompleted()); ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            if (ret != SslIOResult::Success && ret != SslIOResult::WantRead) {
+                return {};
+            }
+        }
+        transferPending(client, server);
+        if (!server.isHandshakeCompleted()) {
+            const auto ret = serverStep(server);
+            if (ret != SslIOResult::Success && ret != SslIOResult::WantRead) {
+                return {};
+            }
+        }
+        transferPending(server, client);
+    }
+    if (!client.isHandshakeCompleted()) {
+        return {};
+    }
+    X509* peer = SSL_get1_peer_certificate(client.native());
+    expect(peer != nullptr, "no peer certificate");
+    char buffer[256] = {};
+    X509_NAME_get_text_by_NID(X509_get_subject_name(peer), NID_commonName, buffer, sizeof(buffer));
+    X509_free(peer);
+    return buffer;
+}
+
+struct CertDir {
+    std::string path;
+
+    CertDir()
+    {
+        char tmpl[] = "/tmp/galay_ssl_t29_XXXXXX";
+        expect(::mkdtemp(tmpl) != nullptr, "mkdtemp failed");
+        path = tmpl;
+    }
+
+    ~CertDir()
+    {
+        const std::string command = "rm -rf " + path;
+        (void)std::system(command.c_str());
+    }
+
+    void add(const std::string& stem, const std::string& cn)
+    {
+        writeIdentity(path + "/" + stem + ".crt", path + "/" + stem + ".key", cn);
+    }
+};
+
+void checkMatching(const CertDir& dir)
+{
+    auto router = SslCertRouter::create({.directory = dir.path});
+    expect(router.has_value(), "create router failed");
+    auto& r = **router;
+
+    // 只登记文件名，不加载
+    auto stats = r.stats();
+    expect(stats.hosts == 4 && stats.loads == 0 && stats.resident == 0, "directory scan loaded certificates");
+
+    auto exact = r.select("a.example.com");
+    expect(exact && commonName(**exact) == "a.example.com", "exact match failed");
+    auto wild = r.select("WWW.Example.COM.");
+    expect(wild && commonName(**wild) == "*.example.com", "wildcard / case / trailing dot failed");
+    auto apex = r.select("example.com");
+    expect(apex && commonName(**apex) == "example.com", "apex should not use wildcard");
+    auto deep = r.select("x.y.example.com");
+    expect(!deep && deep.error().code() == SslErrorCode::kCertRouteFailed, "wildcard matched two labels");
+    expect(!r.select("other.test"), "unknown host matched");
+    expect(!r.select(""), "empty SNI matched without default host");
+    expect(!r.select("bad host!"), "invalid host matched");
+
+    // 第二次访问命中驻留上下文
+    auto again = r.select("a.example.com");
+    expect(again && again->get() == exact->get(), "resident context not reused");
+
+    stats = r.stats();
+    expect(stats.loads == 3 && stats.hits == 1 && stats.resident == 3 && stats.unknown == 4, "unexpected stats");
+}
+
+void checkLru(const CertDir& dir)
+{
+    auto router = SslCertRouter::create({.directory = dir.path, .capacity = 2});
+    expect(router.has_value(), "create router failed");
+    auto& r = **router;
+
+    auto first = r.select("a.example.com");
+    expect(first.has_value(), "select a failed");
+    expect(r.select("b.example.com").has_value(), "select b failed");
+    expect(r.select("example.com").has_value(), "select apex failed");
+
+    auto stats = r.stats();
+    expect(stats.evictions == 1 && stats.resident == 2, "LRU did not evict");
+    // 淘汰只丢弃路由的引用，持有者仍可使用
+    expect(commonName(**first) == "a.example.com", "evicted context invalidated");
+
+    auto reloaded = r.select("a.example.com");
+    expect(reloaded && reloaded->get() != first->get(), "evicted host not reloaded");
+    expect(r.stats().loads == 4, "unexpected load count");
+}
+
+void checkReplaceAndDefault(const CertDir& dir)
+{
+    auto router = SslCertRouter::create({.directory = dir.path, .defaultHost = "example.com"});
+    expect(router.has_value(), "create router failed");
+    auto& r = **router;
+
+    auto fallback = r.select("");
+    expect(fallback && commonName(**fallback) == "example.com", "default host not used for empty SNI");
+    auto unknown = r.select("nowhere.test");
+    expect(unknown && commonName(**unknown) == "example.com", "default host not used for unknown SNI");
+
+    expect(r.select("a.example.com").has_value(), "select a failed");
+    expect(r.addHost("A.EXAMPLE.COM", dir.path + "/example.com.crt", dir.path + "/example.com.key").has_value(),
+           "replace host failed");
+    auto replaced = r.select("a.example.com");
+    expect(replaced && commonName(**replaced) == "example.com", "replaced certificate not used");
+    expect(r.stats().hosts == 4, "replacement registered a new host");
+
+    expect(!r.addHost("a.*.example.com", "x", "y"), "inner wildcard accepted");
+    expect(!r.addHost("*", "x", "y"), "bare wildcard accepted");
+
+    expect(r.addHost("missing.test", dir.path + "/missing.crt", dir.path + "/missing.key").has_value(),
+           "add missing host failed");
+    auto missing = r.select("missing.test");
+    expect(!missing && missing.error().code() == SslErrorCode::kCertificateLoadFailed, "missing file not reported");
+    expect(r.stats().loadFailures == 1, "load failure not counted");
+}
+
+void checkHandshake(const CertDir& dir)
+{
+    auto router = SslCertRouter::create({.directory = dir.path, .capacity = 1});
+    expect(router.has_value(), "create router failed");
+    auto& r = **router;
+
+    expect(handshake(r, "a.example.com") == "a.example.com", "exact SNI handshake failed");
+    expect(handshake(r, "api.example.com") == "*.example.com", "wildcard SNI handshake failed");
+    expect(handshake(r, "b.example.com") == "b.example.com", "second exact SNI handshake failed");
+    expect(handshake(r, "other.test").empty(), "unknown SNI handshake succeeded");
+    expect(handshake(r, "").empty(), "handshake without SNI succeeded");
+
+    // 容量为 1：每次切换主机都会淘汰上一个，握手中途被淘汰的上下文由连接持有
+    const auto stats = r.stats();
+    expect(stats.loads == 3 && stats.evictions == 2 && stats.unknown == 2, "unexpected handshake stats");
+    expect(stats.retries == 3 && stats.hits == 3, "cold hosts not loaded in the background");
+
+    // 加载失败时等待中的握手以失败告终
+    expect(r.addHost("missing.test", dir.path + "/missing.crt", dir.path + "/missing.key").has_value(),
+           "add missing host failed");
+    expect(handshake(r, "missing.test").empty(), "handshake succeeded without certificate");
+    expect(r.stats().loadFailures == 1, "load failure not counted");
+}
+
+void checkSingleFlight(const CertDir& dir)
+{
+    // 阻塞主机上下文的 configure，让三个握手都在加载完成前进入回调（第一次调用是前端上下文）
+    std::atomic<bool> released{false};
+    std::atomic<int> configured{0};
+    SslCertRouterOptions options;
+    options.directory = dir.path;
+    options.loadThreads = 2;
+    options.configure = [&](SslContext&) -> std::expected<void, SslError> {
+        if (configured.fetch_add(1) > 0) {
+            while (!released.load()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        return {};
+    };
+    auto router = SslCertRouter::create(std::move(options));
+    expect(router.has_value(), "create router failed");
+    auto& r = **router;
+
+    constexpr int kConnections = 3;
+    SslContext client_ctx(SslMethod::TLS_Client);
+    std::vector<std::unique_ptr<SslEngine>> clients;
+    std::vector<std::unique_ptr<SslEngine>> servers;
+    for (int i = 0; i < kConnections; ++i) {
+        auto& client = *clients.emplace_back(std::make_unique<SslEngine>(&client_ctx));
+        auto& server = *servers.emplace_back(std::make_unique<SslEngine>(r.context()));
+        expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+        expect(client.setHostname("a.example.com").has_value(), "set SNI failed");
+        client.setConnectState();
+        server.setAcceptState();
+        expect(client.doHandshake() == SslIOResult::WantRead, "client hello failed");
+        transferPending(client, server);
+        expect(server.doHandshake() == SslIOResult::WantAsync, "cold host did not defer the handshake");
+    }
+    auto stats = r.stats();
+    expect(stats.retries == kConnections && stats.loads == 0, "handshake thread loaded the certificate");
+
+    released.store(true);
+    for (auto& server : servers) {
+        waitForLoad(*server);
+    }
+    stats = r.stats();
+    expect(stats.loads == 1 && configured.load() == 2, "concurrent handshakes were not single-flighted");
+
+    for (int i = 0; i < kConnections; ++i) {
+        SslEngine& client = *clients[i];
+        SslEngine& server = *servers[i];
+        for (int step = 0; step < 16 && !(client.isHandshakeCompleted() && server.isHandshakeCompleted()); ++step) {
+            if (!server.isHandshakeCompleted()) {
+                const auto ret = serverStep(server);
+                expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "server handshake failed");
+            }
+            transferPending(server, client);
+            if (!client.isHandshakeCompleted()) {
+                const auto ret = client.doHandshake();
+                expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "client handshake failed");
+            }
+            transferPending(client, server);
+        }
+        expect(client.isHandshakeCompleted() && server.isHandshakeCompleted(), "waiting handshake did not finish");
+    }
+    expect(r.stats().loads == 1, "waiting handshakes loaded again");
+}
+
+} // namespace
+
+int main()
+{
+    CertDir dir;
+    dir.add("a.example.com", "a.example.com");
+    dir.add("b.example.com", "b.example.com");
+    dir.add("_.example.com", "*.example.com");
+    dir.add("example.com", "example.com");
+
+    checkMatching(dir);
+    checkLru(dir);
+    checkReplaceAndDefault(dir);
+    checkHandshake(dir);
+    checkSingleFlight(dir);
+    return 0;
+}
@@ -0,0 +1,257 @@
+/**
+ * @file t30_dual_certificate.cc
+ * @brief 用途：锁定同一上下文同时加载 ECDSA 与 RSA 证书时按 ClientHello 选择证书的语义。
+ * 关键覆盖点：TLS 1.3 客户端即使把 RSA 签名算法排在前面也拿到 ECDSA；只支持 RSA 签名算法、
+ * 或 ECDSA 签名算法与证书曲线不符时回退到 RSA；TLS 1.2 只提供 RSA 密码套件或不支持证书曲线时
+ * 回退到 RSA；certificateStats() 按实际使用的证书类型计数；只加载证书（keyless）时按证书公钥
+ * 识别类型，私钥后端为两个槽位各生成一把密钥并同样按 ClientHello 选择。
+ * 通过条件：客户端看到的证书类型与统计符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * @brief 生成自签名证书写入临时文件
+ */
+void writeIdentity(EVP_PKEY* key, const std::string& cert_path, const std::string& key_path)
+{
+    X509* cert = X509_new();
+    expect(key && cert, "key generation failed");
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    expect(X509_sign(cert, key, EVP_sha256()) > 0, "certificate signing failed");
+
+    FILE* cert_file = std::fopen(cert_path.c_str(), "w");
+    FILE* key_file = std::fopen(key_path.c_str(), "w");
+    expect(cert_file && key_file, "open temp identity files failed");
+    const bool ok = PEM_write_X509(cert_file, cert) == 1 &&
+                    PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    std::fclose(cert_file);
+    std::fclose(key_file);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    expect(ok, "write identity failed");
+}
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    std::vector<char> out(from.pendingEncryptedOutput());
+    if (out.empty()) {
+        return;
+    }
+    expect(from.extractEncryptedOutput(out.data(), out.size()) == static_cast<int>(out.size()),
+           "extractEncryptedOutput failed");
+    expect(to.feedEncryptedInput(out.data(), out.size()) == static_cast<int>(out.size()),
+           "feedEncryptedInput failed");
+}
+
+/**
+ * @brief 以按 configure 定制的客户端握手
+ * @return 客户端看到的服务端证书密钥类型（EVP_PKEY_EC / EVP_PKEY_RSA）
+ */
+int handshake(SslContext& server_ctx, const std::function<void(SSL_CTX*)>& configure)
+{
+    SslContext client_ctx(SslMethod::TLS_Client);
+    configure(client_ctx.native());
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+
+    for (int i = 0; i < 16 && !(client.isHandshakeCompleted() && server.isHandshakeCompleted()); ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "client handshake failed");
+        }
+        transferPending(client, server);
+        if (!server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "server handshake failed");
+        }
+        transferPending(server, client);
+    }
+    expect(client.isHandshakeCompleted() && server.isHandshakeCompleted(), "handshake did not complete");
+
+    X509* peer = SSL_get1_peer_certificate(client.native());
+    expect(peer != nullptr, "no peer certificate");
+    const int type = EVP_PKEY_get_base_id(X509_get0_pubkey(peer));
+    X509_free(peer);
+    return type;
+}
+
+void tls13(SSL_CTX* ctx, const char* sigalgs)
+{
+    SSL_CTX_set_min_proto_version(ctx, TLS1_3_VERSION);
+    if (sigalgs) {
+        expect(SSL_CTX_set1_sigalgs_list(ctx, sigalgs) == 1, "set sigalgs failed");
+    }
+}
+
+void tls12(SSL_CTX* ctx, const char* ciphers, const char* groups)
+{
+    SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+    expect(SSL_CTX_set_cipher_list(ctx, ciphers) == 1, "set ciphers failed");
+    if (groups) {
+        expect(SSL_CTX_set1_groups_list(ctx, groups) == 1, "set groups failed");
+    }
+}
+
+/**
+ * @brief 测试用私钥后端：按证书公钥找回写入文件的私钥
+ */
+class FileKeyBackend : public SslKeyBackend
+{
+public:
+    explicit FileKeyBackend(const std::vector<std::string>& keyFiles)
+    {
+        for (const auto& path : keyFiles) {
+            FILE* file = std::fopen(path.c_str(), "r");
+            expect(file != nullptr, "open key file failed");
+            m_keys.push_back(PEM_read_PrivateKey(file, nullptr, nullptr, nullptr));
+            std::fclose(file);
+            expect(m_keys.back() != nullptr, "read key file failed");
+        }
+    }
+
+    ~FileKeyBackend() override
+    {
+        for (EVP_PKEY* key : m_keys) {
+            EVP_PKEY_free(key);
+        }
+    }
+
+    std::expected<EVP_PKEY*, SslError> wrap(EVP_PKEY* key) override
+    {
+        for (EVP_PKEY* candidate : m_keys) {
+            if (EVP_PKEY_eq(candidate, key) == 1) {
+                ++wrapped;
+                EVP_PKEY_up_ref(candidate);
+                return candidate;
+            }
+        }
+        return std::unexpected(SslError(SslErrorCode::kPrivateKeyLoadFailed));
+    }
+
+    int wrapped = 0;
+
+private:
+    std::vector<EVP_PKEY*> m_keys;
+};
+
+void checkKeyless(const std::string& base)
+{
+    writeIdentity(EVP_EC_gen("P-256"), base + "_ec.crt", base + "_ec.key");
+    writeIdentity(EVP_RSA_gen(2048), base + "_rsa.crt", base + "_rsa.key");
+    auto backend = std::make_shared<FileKeyBackend>(std::vector<std::string>{base + "_ec.key", base + "_rsa.key"});
+
+    // 只加载证书：类型来自证书公钥，私钥由后端提供
+    SslContext server(SslMethod::TLS_Server);
+    const bool loaded = server.loadCertificate(base + "_rsa.crt").has_value() &&
+                        server.loadCertificate(base + "_ec.crt").has_value();
+    for (const char* suffix : {"_ec.crt", "_ec.key", "_rsa.crt", "_rsa.key"}) {
+        ::unlink((base + suffix).c_str());
+    }
+    expect(loaded, "load keyless certificates failed");
+    expect(server.setPrivateKeyOffload(backend).has_value(), "keyless offload failed");
+    expect(backend->wrapped == 2, "keyless offload did not cover both certificates");
+
+    expect(handshake(server, [](SSL_CTX* ctx) { tls13(ctx, nullptr); }) == EVP_PKEY_EC,
+           "keyless TLS 1.3 client did not get ECDSA");
+    expect(handshake(server, [](SSL_CTX* ctx) { tls13(ctx, "rsa_pss_rsae_sha256:rsa_pkcs1_sha256"); }) == EVP_PKEY_RSA,
+           "keyless RSA-only client did not get RSA");
+    const auto stats = server.certificateStats();
+    expect(stats.ecdsa == 1 && stats.rsa == 1, "keyless certificate stats not counted");
+}
+
+} // namespace
+
+int main()
+{
+    const std::string base = "/tmp/galay_ssl_t30_" + std::to_string(::getpid());
+    writeIdentity(EVP_EC_gen("P-256"), base + "_ec.crt", base + "_ec.key");
+    writeIdentity(EVP_RSA_gen(2048), base + "_rsa.crt", base + "_rsa.key");
+
+    SslContext server(SslMethod::TLS_Server);
+    const bool loaded = server.loadCertificateKeyPair(base + "_rsa.crt", base + "_rsa.key").has_value() &&
+                        server.loadCertificateKeyPair(base + "_ec.crt", base + "_ec.key").has_value();
+    for (const char* suffix : {"_ec.crt", "_ec.key", "_rsa.crt", "_rsa.key"}) {
+        ::unlink((base + suffix).c_str());
+    }
+    expect(loaded, "load certificate pairs failed");
+    expect(!server.loadCertificateKeyPair(base + "_missing.crt", base + "_missing.key"), "missing pair accepted");
+
+    // TLS 1.3
+    expect(handshake(server, [](SSL_CTX* ctx) { tls13(ctx, nullptr); }) == EVP_PKEY_EC,
+           "default TLS 1.3 client did not get ECDSA");
+    expect(handshake(server, [](SSL_CTX* ctx) {
+               tls13(ctx, "rsa_pss_rsae_sha256:ecdsa_secp256r1_sha256");
+           }) == EVP_PKEY_EC,
+           "ECDSA not preferred over client RSA preference");
+    expect(handshake(server, [](SSL_CTX* ctx) { tls13(ctx, "rsa_pss_rsae_sha256:rsa_pkcs1_sha256"); }) == EVP_PKEY_RSA,
+           "RSA-only client did not get RSA");
+    expect(handshake(server, [](SSL_CTX* ctx) {
+               tls13(ctx, "ecdsa_secp384r1_sha384:rsa_pss_rsae_sha256");
+           }) == EVP_PKEY_RSA,
+           "curve mismatch did not fall back to RSA");
+
+    // TLS 1.2
+    expect(handshake(server, [](SSL_CTX* ctx) {
+               tls12(ctx, "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256", nullptr);
+           }) == EVP_PKEY_EC,
+           "TLS 1.2 ECDSA-capable client did not get ECDSA");
+    expect(handshake(server, [](SSL_CTX* ctx) {
+               tls12(ctx, "ECDHE-RSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES128-GCM-SHA256", nullptr);
+           }) == EVP_PKEY_EC,
+           "TLS 1.2 ECDSA not preferred over client cipher order");
+    expect(handshake(server, [](SSL_CTX* ctx) { tls12(ctx, "ECDHE-RSA-AES128-GCM-SHA256", nullptr); }) == EVP_PKEY_RSA,
+           "TLS 1.2 RSA-only ciphers did not get RSA");
+    expect(handshake(server, [](SSL_CTX* ctx) {
+               tls12(ctx, "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256", "P-384");
+           }) == EVP_PKEY_RSA,
+           "TLS 1.2 unsupported curve did not fall back to RSA");
+
+    const auto stats = server.certificateStats();
+    expect(stats.ecdsa == 4 && stats.rsa == 4 && stats.other == 0, "unexpected certificate stats");
+
+    // 只有一种证书时不介入选择
+    SslContext rsa_only(SslMethod::TLS_Server);
+    writeIdentity(EVP_RSA_gen(2048), base + "_rsa.crt", base + "_rsa.key");
+    const bool rsa_loaded = rsa_only.loadCertificateKeyPair(base + "_rsa.crt", base + "_rsa.key").has_value();
+    ::unlink((base + "_rsa.crt").c_str());
+    ::unlink((base + "_rsa.key").c_str());
+    expect(rsa_loaded, "load RSA pair failed");
+    expect(handshake(rsa_only, [](SSL_CTX* ctx) { tls13(ctx, nullptr); }) == EVP_PKEY_RSA, "RSA-only server failed");
+    expect(rsa_only.certificateStats().rsa == 1, "RSA-only stats not counted");
+
+    checkKeyless(base);
+    return 0;
+}
@@ -0,0 +1,293 @@
+/**
+ * @file t31_context_reload.cc
+ * @brief 用途：锁定 SslContextReloader 热替换上下文的语义。
+ * 关键覆盖点：握手中途替换上下文时，进行中的连接用旧证书完成握手、新连接拿到新证书；
+ * 旧上下文只由连接持有也不失效；reloadIfChanged() 只在文件变化时重载；构建失败保留旧上下文并在下次重试；
+ * 共享 ticket 密钥环时重载前签发的 ticket 在重载后仍可恢复；replace() 与 factory 构建。
+ * 通过条件：客户端看到的证书、恢复结果与统计符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_context_reloader.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_ticket_keys.h"
+
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+struct CertDir {
+    std::string path;
+
+    CertDir()
+    {
+        char tmpl[] = "/tmp/galay_ssl_t31_XXXXXX";
+        expect(::mkdtemp(tmpl) != nullptr, "mkdtemp failed");
+        path = tmpl;
+    }
+
+    ~CertDir()
+    {
+        const std::string command = "rm -rf " + path;
+        (void)std::system(command.c_str());
+    }
+
+    std::string cert() const { return path + "/server.crt"; }
+    std::string key() const { return path + "/server.key"; }
+
+    /**
+     * @brief 以写临时文件后 rename 的方式替换为 CN 为 commonName 的 P-256 自签名证书
+     */
+    void write(const std::string& commonName) const
+    {
+        EVP_PKEY* pkey = EVP_EC_gen("P-256");
+        X509* x509 = X509_new();
+        expect(pkey && x509, "EC key generation failed");
+        ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+        X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+        X509_gmtime_adj(X509_getm_notAfter(x509), 3600);
+        X509_set_pubkey(x509, pkey);
+        X509_NAME* name = X509_get_subject_name(x509);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                   reinterpret_cast<const unsigned char*>(commonName.c_str()), -1, -1, 0);
+        X509_set_issuer_name(x509, name);
+        expect(X509_sign(x509, pkey, EVP_sha256()) > 0, "certificate signing failed");
+
+        FILE* cert_file = std::fopen((cert() + ".tmp").c_str(), "w");
+        FILE* key_file = std::fopen((key() + ".tmp").c_str(), "w");
+        expect(cert_file && key_file, "open identity files failed");
+        const bool ok = PEM_write_X509(cert_file, x509) == 1 &&
+                        PEM_write_PrivateKey(key_file, pkey, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        std::fclose(cert_file);
+        std::fclose(key_file);
+        X509_free(x509);
+        EVP_PKEY_free(pkey);
+        expect(ok, "write identity failed");
+        expect(std::rename((key() + ".tmp").c_str(), key().c_str()) == 0, "rename key failed");
+        expect(std::rename((cert() + ".tmp").c_str(), cert().c_str()) == 0, "rename cert failed");
+    }
+
+    void corruptKey() const
+    {
+        std::ofstream(key() + ".tmp") << "not a key\n";
+        expect(std::rename((key() + ".tmp").c_str(), key().c_str()) == 0, "rename key failed");
+    }
+};
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    while (from.pendingEncryptedOutput() > 0) {
+        std::vector<char> buffer(from.pendingEncryptedOutput());
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        expect(produced > 0, "extractEncryptedOutput failed");
+        expect(to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) == produced,
+               "feedEncryptedInput failed");
+    }
+}
+
+void step(SslEngine& client, SslEngine& server)
+{
+    if (!client.isHandshakeCompleted()) {
+        const auto ret = client.doHandshake();
+        expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "client handshake failed");
+    }
+    transferPending(client, server);
+    if (!server.isHandshakeCompleted()) {
+        const auto ret = server.doHandshake();
+        expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "server handshake failed");
+    }
+    transferPending(server, client);
+}
+
+void finish(SslEngine& client, SslEngine& server)
+{
+    for (int i = 0; i < 16 && !(client.isHandshakeCompleted() && server.isHandshakeCompleted()); ++i) {
+        step(client, server);
+    }
+    expect(client.isHandshakeCompleted() && server.isHandshakeCompleted(), "handshake did not complete");
+    // TLS 1.3 的 NewSessionTicket 在握手后到达，读一次让客户端处理
+    std::array<char, 16> scratch{};
+    size_t bytes_read = 0;
+    (void)client.read(scratch.data(), scratch.size(), bytes_read);
+}
+
+std::string peerName(SslEngine& client)
+{
+    X509* peer = SSL_get1_peer_certificate(client.native());
+    expect(peer != nullptr, "no peer certificate");
+    char buffer[256] = {};
+    X509_NAME_get_text_by_NID(X509_get_subject_name(peer), NID_commonName, buffer, sizeof(buffer));
+    X509_free(peer);
+    return buffer;
+}
+
+/**
+ * @brief 一条内存 BIO 连接，服务端引擎持有 accept 时的上下文引用
+ */
+struct Connection {
+    SslEngine client;
+    SslEngine server;
+
+    Connection(SslContext& client_ctx, std::shared_ptr<SslContext> server_ctx)
+        : client(&client_ctx)
+        , server(std::move(server_ctx))
+    {
+        expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+        client.setConnectState();
+        server.setAcceptState();
+    }
+};
+
+void checkInFlightKeepsOldContext(const CertDir& dir)
+{
+    dir.write("one");
+    auto reloader = SslContextReloader::create({.certFile = dir.cert(), .keyFile = dir.key()});
+    expect(reloader.has_value(), "create reloader failed");
+    auto& r = **reloader;
+    expect(r.generation() == 1, "unexpected initial generation");
+
+    SslContext client_ctx(SslMethod::TLS_Client);
+    auto in_flight = std::make_unique<Connection>(client_ctx, r.current());
+    step(in_flight->client, in_flight->server);     // ClientHello 已到达服务端，服务端已回复
+
+    expect(*r.reloadIfChanged() == false, "unchanged files reloaded");
+    dir.write("two");
+    auto changed = r.reloadIfChanged();
+    expect(changed && *changed, "changed files not reloaded");
+    expect(r.generation() == 2 && r.stats().reloads == 1, "unexpected reload stats");
+
+    // 旧上下文此时只由进行中的连接持有
+    finish(in_flight->client, in_flight->server);
+    expect(peerName(in_flight->client) == "one", "in-flight connection switched context");
+
+    Connection fresh(client_ctx, r.current());
+    finish(fresh.client, fresh.server);
+    expect(peerName(fresh.client) == "two", "new connection did not use reloaded context");
+}
+
+void checkFailedReload(const CertDir& dir)
+{
+    dir.write("good");
+    auto reloader = SslContextReloader::create({.certFile = dir.cert(), .keyFile = dir.key()});
+    expect(reloader.has_value(), "create reloader failed");
+    auto& r = **reloader;
+    const auto before = r.current();
+
+    dir.corruptKey();
+    auto failed = r.reloadIfChanged();
+    expect(!failed && failed.error().code() == SslErrorCode::kPrivateKeyLoadFailed, "bad key not reported");
+    expect(r.current() == before && r.generation() == 1, "failed reload replaced context");
+    expect(!r.reloadIfChanged(), "failed reload not retried");
+    expect(r.stats().failures == 2, "failures not counted");
+
+    dir.write("fixed");
+    expect(r.reloadIfChanged().value_or(false), "fixed files not reloaded");
+
+    SslContext client_ctx(SslMethod::TLS_Client);
+    Connection conn(client_ctx, r.current());
+    finish(conn.client, conn.server);
+    expect(peerName(conn.client) == "fixed", "fixed certificate not used");
+
+    // 缺失的文件也视为变化，构建失败时保留旧上下文
+    ::unlink(dir.cert().c_str());
+    expect(!r.reloadIfChanged() && r.generation() == 2, "missing file replaced context");
+
+    expect(!SslContextReloader::create({.certFile = dir.cert(), .keyFile = dir.key()}), "missing file accepted");
+}
+
+void checkResumptionAcrossReload(const CertDir& dir)
+{
+    dir.write("ticket");
+    auto ring = std::make_shared<SslTicketKeyRing>();
+    auto reloader = SslContextReloader::create({
+        .certFile = dir.cert(),
+        .keyFile = dir.key(),
+        .configure = [ring](SslContext& ctx) -> std::expected<void, SslError> {
+            ctx.setSessionTicketKeys(ring);
+            return {};
+        },
+    });
+    expect(reloader.has_value(), "create reloader failed");
+    auto& r = **reloader;
+
+    SslContext client_ctx(SslMethod::TLS_Client);
+    SSL_SESSION* session = nullptr;
+    {
+        Connection conn(client_ctx, r.current());
+        finish(conn.client, conn.server);
+        expect(!conn.server.isSessionReused(), "first handshake should be full");
+        session = SSL_get1_session(conn.client.native());
+        // 未正常关闭的连接会让 OpenSSL 把 session 标记为不可恢复
+        (void)conn.server.shutdown();
+        (void)conn.client.shutdown();
+    }
+    expect(session != nullptr && SSL_SESSION_has_ticket(session) == 1, "client did not receive a ticket");
+
+    expect(r.reload().has_value(), "reload failed");
+    Connection resumed(client_ctx, r.current());
+    expect(resumed.client.setSession(session), "client setSession failed");
+    finish(resumed.client, resumed.server);
+    expect(resumed.server.isSessionReused(), "ticket did not resume after reload");
+    SSL_SESSION_free(session);
+}
+
+void checkFactoryAndReplace(const CertDir& dir)
+{
+    dir.write("factory");
+    int builds = 0;
+    auto reloader = SslContextReloader::create({
+        .factory = [&dir, &builds]() -> std::expected<std::shared_ptr<SslContext>, SslError> {
+            ++builds;
+            auto ctx = std::make_shared<SslContext>(SslMethod::TLS_Server);
+            if (auto loaded = ctx->loadCertificateKeyPair(dir.cert(), dir.key()); !loaded) {
+                return std::unexpected(loaded.error());
+            }
+            return ctx;
+        },
+        .watchFiles = {dir.cert()},
+    });
+    expect(reloader.has_value() && builds == 1, "factory not used");
+    auto& r = **reloader;
+
+    expect(*r.reloadIfChanged() == false && builds == 1, "factory rebuilt without changes");
+    dir.write("factory-2");
+    expect(r.reloadIfChanged().value_or(false) && builds == 2, "watched file change ignored");
+
+    auto manual = std::make_shared<SslContext>(SslMethod::TLS_Server);
+    dir.write("manual");
+    expect(manual->loadCertificateKeyPair(dir.cert(), dir.key()).has_value(), "load manual pair failed");
+    r.replace(manual);
+    expect(r.current() == manual && r.generation() == 3 && r.stats().reloads == 2, "replace not published");
+}
+
+} // namespace
+
+int main()
+{
+    CertDir dir;
+    checkInFlightKeepsOldContext(dir);
+    checkFailedReload(dir);
+    checkResumptionAcrossReload(dir);
+    checkFactoryAndReplace(dir);
+    return 0;
+}
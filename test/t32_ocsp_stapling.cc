@@ -0,0 +1,320 @@
+/**
+ * @file t32_ocsp_stapling.cc
+ * @brief 用途：锁定 SslOcspStapler 与 SslContext::setOcspStapler() 的 stapling 语义。
+ * 关键覆盖点：请求 status 的 TLS 1.2 / 1.3 客户端拿到缓存的响应、未请求的客户端不附带；
+ * 吊销、过期与签名错误的响应被拒绝且不影响握手；共享 stapler 的上下文对同一证书只获取一次并随析构撤销登记；
+ * 目录来源按序列号查找；后台线程按有效期刷新；找不到签发者时登记失败。
+ * 通过条件：客户端收到的响应、获取次数与统计符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_ocsp_stapler.h"
+
+#include <openssl/ocsp.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace galay::ssl;
+using namespace std::chrono_literals;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+X509* makeCertificate(EVP_PKEY* key, const char* commonName, long serial, X509* issuer, EVP_PKEY* issuerKey)
+{
+    X509* cert = X509_new();
+    expect(cert != nullptr, "X509_new failed");
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), serial);
+    X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>(commonName), -1, -1, 0);
+    X509_set_issuer_name(cert, issuer ? X509_get_subject_name(issuer) : name);
+    if (!issuer) {
+        X509V3_CTX v3;
+        X509V3_set_ctx_nodb(&v3);
+        X509V3_set_ctx(&v3, cert, cert, nullptr, nullptr, 0);
+        X509_EXTENSION* ext = X509V3_EXT_conf_nid(nullptr, &v3, NID_basic_constraints, "critical,CA:TRUE");
+        X509_add_ext(cert, ext, -1);
+        X509_EXTENSION_free(ext);
+    }
+    expect(X509_sign(cert, issuer ? issuerKey : key, EVP_sha256()) > 0, "certificate signing failed");
+    return cert;
+}
+
+/**
+ * @brief 测试用 PKI：CA、由 CA 签发的服务端证书，以及一个无关的签名者
+ */
+struct Pki {
+    EVP_PKEY* caKey = EVP_EC_gen("P-256");
+    EVP_PKEY* leafKey = EVP_EC_gen("P-256");
+    EVP_PKEY* rogueKey = EVP_EC_gen("P-256");
+    X509* ca = nullptr;
+    X509* leaf = nullptr;
+    X509* rogue = nullptr;
+    std::string dir;
+
+    Pki()
+    {
+        expect(caKey && leafKey && rogueKey, "key generation failed");
+        ca = makeCertificate(caKey, "Test CA", 1, nullptr, nullptr);
+        leaf = makeCertificate(leafKey, "localhost", 0x1A2B, ca, caKey);
+        rogue = makeCertificate(rogueKey, "Rogue", 7, nullptr, nullptr);
+
+        char tmpl[] = "/tmp/galay_ssl_t32_XXXXXX";
+        expect(::mkdtemp(tmpl) != nullptr, "mkdtemp failed");
+        dir = tmpl;
+        FILE* chain = std::fopen((dir + "/chain.crt").c_str(), "w");
+        FILE* leaf_only = std::fopen((dir + "/leaf.crt").c_str(), "w");
+        FILE* key = std::fopen((dir + "/leaf.key").c_str(), "w");
+        expect(chain && leaf_only && key, "open PKI files failed");
+        const bool ok = PEM_write_X509(chain, leaf) == 1 && PEM_write_X509(chain, ca) == 1 &&
+                        PEM_write_X509(leaf_only, leaf) == 1 &&
+                        PEM_write_PrivateKey(key, leafKey, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        std::fclose(chain);
+        std::fclose(leaf_only);
+        std::fclose(key);
+        expect(ok, "write PKI files failed");
+    }
+
+    ~Pki()
+    {
+        X509_free(ca);
+        X509_free(leaf);
+        X509_free(rogue);
+        EVP_PKEY_free(caKey);
+        EVP_PKEY_free(leafKey);
+        EVP_PKEY_free(rogueKey);
+        const std::string command = "rm -rf " + dir;
+        (void)std::system(command.c_str());
+    }
+
+    /**
+     * @brief 生成一个 OCSP 响应
+     * @param nextUpdate 相对现在的秒数，0 表示不带 nextUpdate
+     */
+    std::vector<unsigned char> response(int status, long thisUpdate, long nextUpdate, bool rogueSigner = false) const
+    {
+        OCSP_BASICRESP* basic = OCSP_BASICRESP_new();
+        OCSP_CERTID* id = OCSP_cert_to_id(nullptr, leaf, ca);
+        ASN1_TIME* this_time = X509_gmtime_adj(nullptr, thisUpdate);
+        ASN1_TIME* next_time = nextUpdate != 0 ? X509_gmtime_adj(nullptr, nextUpdate) : nullptr;
+        const bool revoked = status == V_OCSP_CERTSTATUS_REVOKED;
+        expect(OCSP_basic_add1_status(basic, id, status, revoked ? OCSP_REVOKED_STATUS_KEYCOMPROMISE : 0,
+                                      revoked ? this_time : nullptr, this_time, next_time) != nullptr,
+               "add OCSP status failed");
+        expect(OCSP_basic_sign(basic, rogueSigner ? rogue : ca, rogueSigner ? rogueKey : caKey, EVP_sha256(),
+                               nullptr, 0) == 1,
+               "sign OCSP response failed");
+        OCSP_RESPONSE* resp = OCSP_response_create(OCSP_RESPONSE_STATUS_SUCCESSFUL, basic);
+        std::vector<unsigned char> der(static_cast<size_t>(i2d_OCSP_RESPONSE(resp, nullptr)));
+        unsigned char* out = der.data();
+        i2d_OCSP_RESPONSE(resp, &out);
+        OCSP_RESPONSE_free(resp);
+        ASN1_TIME_free(this_time);
+        ASN1_TIME_free(next_time);
+        OCSP_CERTID_free(id);
+        OCSP_BASICRESP_free(basic);
+        return der;
+    }
+
+    std::unique_ptr<SslContext> server(bool withChain = true) const
+    {
+        auto ctx = std::make_unique<SslContext>(SslMethod::TLS_Server);
+        expect(ctx->loadCertificateKeyPair(dir + (withChain ? "/chain.crt" : "/leaf.crt"), dir + "/leaf.key")
+                   .has_value(),
+               "load server identity failed");
+        return ctx;
+    }
+};
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    while (from.pendingEncryptedOutput() > 0) {
+        std::vector<char> buffer(from.pendingEncryptedOutput());
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        expect(produced > 0, "extractEncryptedOutput failed");
+        expect(to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) == produced,
+               "feedEncryptedInput failed");
+    }
+}
+
+/**
+ * @brief 握手并返回客户端收到的 stapled 响应（未收到时为空）
+ */
+std::vector<unsigned char> handshake(SslContext& server_ctx, bool requestStatus, int maxVersion = TLS1_3_VERSION)
+{
+    SslContext client_ctx(SslMethod::TLS_Client);
+    SSL_CTX_set_max_proto_version(client_ctx.native(), maxVersion);
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+    if (requestStatus) {
+        SSL_set_tlsext_status_type(client.native(), TLSEXT_STATUSTYPE_ocsp);
+    }
+    client.setConnectState();
+    server.setAcceptState();
+
+    for (int i = 0; i < 16 && !(client.isHandshakeCompleted() && server.isHandshakeCompleted()); ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "client handshake failed");
+        }
+        transferPending(client, server);
+        if (!server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "server handshake failed");
+        }
+        transferPending(server, client);
+    }
+    expect(client.isHandshakeCompleted() && server.isHandshakeCompleted(), "handshake did not complete");
+
+    const unsigned char* data = nullptr;
+    const long length = SSL_get_tlsext_status_ocsp_resp(client.native(), &data);
+    return length > 0 ? std::vector<unsigned char>(data, data + length) : std::vector<unsigned char>{};
+}
+
+void checkStapling(const Pki& pki)
+{
+    const auto good = pki.response(V_OCSP_CERTSTATUS_GOOD, -60, 3600);
+    std::atomic<int> fetches{0};
+    auto stapler = SslOcspStapler::create({
+        .fetch = [&](X509* cert, X509* issuer) -> std::expected<std::vector<unsigned char>, SslError> {
+            expect(X509_cmp(cert, pki.leaf) == 0 && X509_cmp(issuer, pki.ca) == 0, "unexpected cert / issuer");
+            ++fetches;
+            return good;
+        },
+        .backgroundRefresh = false,
+    });
+    expect(stapler.has_value(), "create stapler failed");
+    auto& s = **stapler;
+
+    auto first = pki.server();
+    auto second = pki.server();
+    expect(first->setOcspStapler(*stapler).has_value() && second->setOcspStapler(*stapler).has_value(),
+           "attach stapler failed");
+    expect(fetches == 1 && s.stats().certificates == 1, "shared certificate fetched twice");
+    expect(s.response(pki.leaf) == good, "cached response mismatch");
+    expect(s.refresh() == 0 && fetches == 1, "fresh response refreshed early");
+
+    expect(handshake(*first, true) == good, "TLS 1.3 client did not get stapled response");
+    expect(handshake(*second, true, TLS1_2_VERSION) == good, "TLS 1.2 client did not get stapled response");
+    expect(handshake(*first, false).empty(), "response stapled without status_request");
+
+    auto stats = s.stats();
+    expect(stats.stapled == 2 && stats.unavailable == 0 && stats.refreshes == 1, "unexpected stapling stats");
+
+    first.reset();
+    expect(s.stats().certificates == 1, "certificate dropped while still in use");
+    expect(second->setOcspStapler(nullptr).has_value() && s.stats().certificates == 0, "detach did not unregister");
+    expect(handshake(*second, true).empty(), "detached context still stapled");
+}
+
+void checkRejectedResponses(const Pki& pki)
+{
+    std::vector<unsigned char> current = pki.response(V_OCSP_CERTSTATUS_REVOKED, -60, 3600);
+    auto stapler = SslOcspStapler::create({
+        .fetch = [&current](X509*, X509*) -> std::expected<std::vector<unsigned char>, SslError> { return current; },
+        .backgroundRefresh = false,
+    });
+    expect(stapler.has_value(), "create stapler failed");
+    auto& s = **stapler;
+
+    auto ctx = pki.server();
+    expect(ctx->setOcspStapler(*stapler).has_value(), "attach with failing source should succeed");
+    expect(s.response(pki.leaf).empty(), "revoked response cached");
+
+    current = pki.response(V_OCSP_CERTSTATUS_GOOD, -7200, -3600);
+    expect(s.refresh(true) == 0 && s.response(pki.leaf).empty(), "expired response cached");
+    current = pki.response(V_OCSP_CERTSTATUS_GOOD, -60, 3600, true);
+    expect(s.refresh(true) == 0 && s.response(pki.leaf).empty(), "rogue-signed response cached");
+    current = {0x30, 0x03, 0x0a, 0x01, 0x00};
+    expect(s.refresh(true) == 0 && s.response(pki.leaf).empty(), "garbage response cached");
+
+    expect(handshake(*ctx, true).empty(), "invalid response stapled");
+    expect(s.stats().unavailable == 1 && s.stats().refreshFailures == 4, "unexpected failure stats");
+
+    // 来源恢复后替换；之后的无效响应不覆盖有效响应
+    current = pki.response(V_OCSP_CERTSTATUS_GOOD, -60, 3600);
+    const auto good = current;
+    expect(s.refresh(true) == 1 && handshake(*ctx, true) == good, "recovered response not stapled");
+    current = pki.response(V_OCSP_CERTSTATUS_REVOKED, -60, 3600);
+    expect(s.refresh(true) == 0 && s.response(pki.leaf) == good, "invalid response replaced valid one");
+
+    // 不带 nextUpdate 的响应按 defaultValidity 使用
+    current = pki.response(V_OCSP_CERTSTATUS_GOOD, -60, 0);
+    expect(s.refresh(true) == 1 && s.response(pki.leaf) == current, "response without nextUpdate rejected");
+}
+
+void checkDirectory(const Pki& pki)
+{
+    const auto good = pki.response(V_OCSP_CERTSTATUS_GOOD, -60, 3600);
+    std::ofstream(pki.dir + "/1A2B.der", std::ios::binary)
+        .write(reinterpret_cast<const char*>(good.data()), static_cast<std::streamsize>(good.size()));
+
+    auto stapler = SslOcspStapler::create({.directory = pki.dir, .backgroundRefresh = false});
+    expect(stapler.has_value(), "create directory stapler failed");
+    auto ctx = pki.server();
+    expect(ctx->setOcspStapler(*stapler).has_value(), "attach directory stapler failed");
+    expect(handshake(*ctx, true) == good, "directory response not stapled");
+
+    auto no_issuer = pki.server(false);
+    auto attached = no_issuer->setOcspStapler(*stapler);
+    expect(!attached && attached.error().code() == SslErrorCode::kOcspFailed, "missing issuer accepted");
+    expect(!SslOcspStapler::create({}), "stapler without source accepted");
+}
+
+void checkBackgroundRefresh(const Pki& pki)
+{
+    std::atomic<int> fetches{0};
+    auto stapler = SslOcspStapler::create({
+        .fetch = [&](X509*, X509*) -> std::expected<std::vector<unsigned char>, SslError> {
+            ++fetches;
+            // 有效期 1 秒：过半即刷新，受 retryInterval 下限约束
+            return pki.response(V_OCSP_CERTSTATUS_GOOD, -60, 1);
+        },
+        .retryInterval = 50ms,
+    });
+    expect(stapler.has_value(), "create stapler failed");
+    auto ctx = pki.server();
+    expect(ctx->setOcspStapler(*stapler).has_value(), "attach stapler failed");
+
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (fetches < 3 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(10ms);
+    }
+    expect(fetches >= 3, "background thread did not refresh");
+    expect(!handshake(*ctx, true).empty(), "refreshed response not stapled");
+}
+
+} // namespace
+
+int main()
+{
+    Pki pki;
+    checkStapling(pki);
+    checkRejectedResponses(pki);
+    checkDirectory(pki);
+    checkBackgroundRefresh(pki);
+    return 0;
+}
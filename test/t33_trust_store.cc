@@ -0,0 +1,293 @@
+/**
+ * @file t33_trust_store.cc
+ * @brief 用途：锁定 SslTrustStore 共享信任库与 SslContext::buildCertificateChain() 预构建证书链的语义。
+ * 关键覆盖点：多个上下文挂接同一个 X509_STORE、挂接期间拒绝修改 CA；
+ * 无信任锚时整理证书文件中的链（丢弃无关证书与根证书、修正顺序），链不完整时报错；
+ * 以信任锚补齐只含叶子证书的链；双证书的每个槽位都被构建；握手后客户端收到完整的中间证书。
+ * 通过条件：上下文中的链、客户端验证结果与错误码符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_trust_store.h"
+
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+X509* makeCertificate(EVP_PKEY* key, const char* commonName, long serial, bool ca, X509* issuer, EVP_PKEY* issuerKey)
+{
+    X509* cert = X509_new();
+    expect(cert != nullptr, "X509_new failed");
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), serial);
+    X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>(commonName), -1, -1, 0);
+    X509_set_issuer_name(cert, issuer ? X509_get_subject_name(issuer) : name);
+    if (ca) {
+        X509V3_CTX v3;
+        X509V3_set_ctx_nodb(&v3);
+        X509V3_set_ctx(&v3, issuer ? issuer : cert, cert, nullptr, nullptr, 0);
+        X509_EXTENSION* ext = X509V3_EXT_conf_nid(nullptr, &v3, NID_basic_constraints, "critical,CA:TRUE");
+        X509_add_ext(cert, ext, -1);
+        X509_EXTENSION_free(ext);
+    }
+    expect(X509_sign(cert, issuer ? issuerKey : key, EVP_sha256()) > 0, "certificate signing failed");
+    return cert;
+}
+
+/**
+ * @brief 测试用 PKI：根 CA → 中间 CA → ECDSA / RSA 服务端证书，以及一个无关的自签名证书
+ */
+struct Pki {
+    EVP_PKEY* rootKey = EVP_EC_gen("P-256");
+    EVP_PKEY* interKey = EVP_EC_gen("P-256");
+    EVP_PKEY* leafKey = EVP_EC_gen("P-256");
+    EVP_PKEY* rsaKey = EVP_RSA_gen(2048);
+    EVP_PKEY* strayKey = EVP_EC_gen("P-256");
+    X509* root = nullptr;
+    X509* inter = nullptr;
+    X509* leaf = nullptr;
+    X509* rsaLeaf = nullptr;
+    X509* stray = nullptr;
+    std::string dir;
+
+    Pki()
+    {
+        expect(rootKey && interKey && leafKey && rsaKey && strayKey, "key generation failed");
+        root = makeCertificate(rootKey, "Test Root", 1, true, nullptr, nullptr);
+        inter = makeCertificate(interKey, "Test Intermediate", 2, true, root, rootKey);
+        leaf = makeCertificate(leafKey, "localhost", 3, false, inter, interKey);
+        rsaLeaf = makeCertificate(rsaKey, "localhost", 4, false, inter, interKey);
+        stray = makeCertificate(strayKey, "Stray", 5, false, nullptr, nullptr);
+
+        char tmpl[] = "/tmp/galay_ssl_t33_XXXXXX";
+        expect(::mkdtemp(tmpl) != nullptr, "mkdtemp failed");
+        dir = tmpl;
+        writeCerts("root.crt", {root});
+        writeCerts("bundle.crt", {root, inter});
+        writeCerts("leaf.crt", {leaf});
+        writeCerts("rsa.crt", {rsaLeaf});
+        writeCerts("stray.crt", {stray});
+        // 无关证书、根证书在前、中间证书在后
+        writeCerts("messy.crt", {leaf, stray, root, inter});
+        writeKey("leaf.key", leafKey);
+        writeKey("rsa.key", rsaKey);
+        writeKey("stray.key", strayKey);
+    }
+
+    ~Pki()
+    {
+        for (X509* cert : {root, inter, leaf, rsaLeaf, stray}) {
+            X509_free(cert);
+        }
+        for (EVP_PKEY* key : {rootKey, interKey, leafKey, rsaKey, strayKey}) {
+            EVP_PKEY_free(key);
+        }
+        const std::string command = "rm -rf " + dir;
+        (void)std::system(command.c_str());
+    }
+
+    std::string path(const char* name) const { return dir + "/" + name; }
+
+    void writeCerts(const char* name, std::initializer_list<X509*> certs) const
+    {
+        FILE* file = std::fopen(path(name).c_str(), "w");
+        expect(file != nullptr, "open certificate file failed");
+        bool ok = true;
+        for (X509* cert : certs) {
+            ok = ok && PEM_write_X509(file, cert) == 1;
+        }
+        std::fclose(file);
+        expect(ok, "write certificate failed");
+    }
+
+    void writeKey(const char* name, EVP_PKEY* key) const
+    {
+        FILE* file = std::fopen(path(name).c_str(), "w");
+        expect(file != nullptr, "open key file failed");
+        const bool ok = PEM_write_PrivateKey(file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        std::fclose(file);
+        expect(ok, "write key failed");
+    }
+
+    SslContext server(const char* cert, const char* key = "leaf.key") const
+    {
+        SslContext ctx(SslMethod::TLS_Server);
+        expect(ctx.loadCertificateKeyPair(path(cert), path(key)).has_value(), "load server identity failed");
+        return ctx;
+    }
+};
+
+std::vector<X509*> chainCerts(SslContext& ctx)
+{
+    STACK_OF(X509)* chain = nullptr;
+    SSL_CTX_get0_chain_certs(ctx.native(), &chain);
+    std::vector<X509*> certs;
+    for (int i = 0; i < sk_X509_num(chain); ++i) {
+        certs.push_back(sk_X509_value(chain, i));
+    }
+    return certs;
+}
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    while (from.pendingEncryptedOutput() > 0) {
+        std::vector<char> buffer(from.pendingEncryptedOutput());
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        expect(produced > 0, "extractEncryptedOutput failed");
+        expect(to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) == produced,
+               "feedEncryptedInput failed");
+    }
+}
+
+/**
+ * @brief 以验证服务端证书的客户端握手，返回客户端收到的证书数（叶子 + 中间证书）
+ */
+int handshake(SslContext& server_ctx, SslContext& client_ctx)
+{
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+
+    for (int i = 0; i < 16 && !(client.isHandshakeCompleted() && server.isHandshakeCompleted()); ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "client handshake failed");
+        }
+        transferPending(client, server);
+        if (!server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "server handshake failed");
+        }
+        transferPending(server, client);
+    }
+    expect(client.isHandshakeCompleted() && server.isHandshakeCompleted(), "handshake did not complete");
+    expect(SSL_get_verify_result(client.native()) == X509_V_OK, "client verification failed");
+    return sk_X509_num(SSL_get_peer_cert_chain(client.native()));
+}
+
+void checkSharedStore(const Pki& pki)
+{
+    expect(!SslTrustStore::create({}), "empty trust store accepted");
+    auto missing = SslTrustStore::fromFile(pki.path("missing.crt"));
+    expect(!missing && missing.error().code() == SslErrorCode::kCACertificateLoadFailed, "missing CA file accepted");
+    auto bundle = SslTrustStore::create({.caFiles = {pki.path("root.crt"), pki.path("stray.crt")}});
+    expect(bundle && (*bundle)->certificateCount() == 2, "unexpected certificate count");
+
+    auto trust = SslTrustStore::fromFile(pki.path("root.crt"));
+    expect(trust && (*trust)->certificateCount() == 1, "load root store failed");
+
+    SslContext first(SslMethod::TLS_Client);
+    SslContext second(SslMethod::TLS_Client);
+    for (SslContext* ctx : {&first, &second}) {
+        ctx->setVerifyMode(SslVerifyMode::Peer);
+        ctx->setTrustStore(*trust);
+        expect(SSL_CTX_get_cert_store(ctx->native()) == (*trust)->native(), "trust store not shared");
+    }
+    auto loaded = first.loadCACertificate(pki.path("stray.crt"));
+    expect(!loaded && loaded.error().code() == SslErrorCode::kCACertificateLoadFailed, "shared store modified");
+    expect(!first.useDefaultCA() && (*trust)->certificateCount() == 1, "shared store modified by default CA");
+
+    // 证书文件中带中间证书时，两个客户端都能以共享的根验证
+    SslContext server(SslMethod::TLS_Server);
+    pki.writeCerts("chain.crt", {pki.leaf, pki.inter});
+    expect(server.loadCertificateKeyPair(pki.path("chain.crt"), pki.path("leaf.key")).has_value(),
+           "load chain failed");
+    expect(handshake(server, first) == 2 && handshake(server, second) == 2, "shared store verification failed");
+
+    second.setTrustStore(nullptr);
+    expect(SSL_CTX_get_cert_store(second.native()) != (*trust)->native(), "trust store not detached");
+    expect(second.loadCACertificate(pki.path("root.crt")).has_value(), "private store not restored");
+    expect(handshake(server, second) == 2, "private store verification failed");
+}
+
+void checkBuildWithoutAnchors(const Pki& pki)
+{
+    auto trust = SslTrustStore::fromFile(pki.path("root.crt"));
+    expect(trust.has_value(), "load root store failed");
+    SslContext client(SslMethod::TLS_Client);
+    client.setVerifyMode(SslVerifyMode::Peer);
+    client.setTrustStore(*trust);
+
+    auto messy = pki.server("messy.crt");
+    expect(messy.buildCertificateChain().has_value(), "build from loaded chain failed");
+    const auto chain = chainCerts(messy);
+    expect(chain.size() == 1 && X509_cmp(chain[0], pki.inter) == 0, "stray or root certificate kept");
+    expect((SSL_CTX_get_mode(messy.native()) & SSL_MODE_NO_AUTO_CHAIN) != 0, "auto chain still enabled");
+    expect(handshake(messy, client) == 2, "prebuilt chain not sent");
+
+    auto leaf_only = pki.server("leaf.crt");
+    auto built = leaf_only.buildCertificateChain();
+    expect(!built && built.error().code() == SslErrorCode::kCertChainBuildFailed, "incomplete chain accepted");
+
+    auto self_signed = pki.server("stray.crt", "stray.key");
+    expect(self_signed.buildCertificateChain().has_value() && chainCerts(self_signed).empty(),
+           "self-signed certificate rejected");
+
+    SslContext empty(SslMethod::TLS_Server);
+    expect(!empty.buildCertificateChain(), "context without certificate accepted");
+}
+
+void checkBuildWithAnchors(const Pki& pki)
+{
+    auto anchors = SslTrustStore::fromFile(pki.path("bundle.crt"));
+    auto root_only = SslTrustStore::fromFile(pki.path("root.crt"));
+    expect(anchors && root_only, "load anchors failed");
+
+    auto missing_inter = pki.server("leaf.crt");
+    expect(!missing_inter.buildCertificateChain(*root_only), "chain built without intermediate");
+
+    // ECDSA 与 RSA 两个槽位都只加载叶子证书，由信任锚补齐中间证书
+    auto dual = pki.server("leaf.crt");
+    expect(dual.loadCertificateKeyPair(pki.path("rsa.crt"), pki.path("rsa.key")).has_value(), "load RSA failed");
+    expect(dual.buildCertificateChain(*anchors).has_value(), "build with anchors failed");
+    int slots = 0;
+    for (int rc = SSL_CTX_set_current_cert(dual.native(), SSL_CERT_SET_FIRST); rc == 1;
+         rc = SSL_CTX_set_current_cert(dual.native(), SSL_CERT_SET_NEXT)) {
+        const auto chain = chainCerts(dual);
+        expect(chain.size() == 1 && X509_cmp(chain[0], pki.inter) == 0, "slot chain not built");
+        ++slots;
+    }
+    expect(slots == 2, "unexpected slot count");
+
+    SslContext client(SslMethod::TLS_Client);
+    client.setVerifyMode(SslVerifyMode::Peer);
+    client.setTrustStore(*root_only);
+    expect(handshake(dual, client) == 2, "ECDSA chain not sent");
+    SSL_CTX_set1_sigalgs_list(client.native(), "RSA-PSS+SHA256:rsa_pss_rsae_sha256");
+    expect(handshake(dual, client) == 2, "RSA chain not sent");
+}
+
+} // namespace
+
+int main()
+{
+    Pki pki;
+    checkSharedStore(pki);
+    checkBuildWithoutAnchors(pki);
+    checkBuildWithAnchors(pki);
+    return 0;
+}
@@ -0,0 +1,386 @@
+/**
+ * @file t34_verify_cache.cc
+ * @brief 用途：锁定 SslVerifyCache 对客户端证书验证结果的缓存语义。
+ * 关键覆盖点：同一客户端证书第二次握手命中并得到完整的可信链；验证失败的证书不缓存；
+ * 更换共享信任库、在私有信任库上加载 CA 与 invalidate() 都让旧条目失效；TTL 过期与容量淘汰；
+ * 多个上下文共享同一个缓存；客户端验证服务端证书时不经过缓存；命中时仍以 ok=1 调用验证回调，回调可拒绝；
+ * 修改验证标志或深度不命中旧条目，开启 CRL 检查时不经过缓存；CA 目录增删证书后旧条目失效。
+ * 通过条件：握手结果、验证链与命中 / 未命中统计符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_trust_store.h"
+#include "galay-ssl/ssl/ssl_verify_cache.h"
+
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace galay::ssl;
+using namespace std::chrono_literals;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+X509* makeCertificate(EVP_PKEY* key, const std::string& commonName, long serial, X509* issuer, EVP_PKEY* issuerKey)
+{
+    X509* cert = X509_new();
+    expect(cert != nullptr, "X509_new failed");
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), serial);
+    X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               reinterpret_cast<const unsigned char*>(commonName.c_str()), -1, -1, 0);
+    X509_set_issuer_name(cert, issuer ? X509_get_subject_name(issuer) : name);
+    if (!issuer) {
+        X509V3_CTX v3;
+        X509V3_set_ctx_nodb(&v3);
+        X509V3_set_ctx(&v3, cert, cert, nullptr, nullptr, 0);
+        X509_EXTENSION* ext = X509V3_EXT_conf_nid(nullptr, &v3, NID_basic_constraints, "critical,CA:TRUE");
+        X509_add_ext(cert, ext, -1);
+        X509_EXTENSION_free(ext);
+    }
+    expect(X509_sign(cert, issuer ? issuerKey : key, EVP_sha256()) > 0, "certificate signing failed");
+    return cert;
+}
+
+/**
+ * @brief 测试用 PKI：客户端 CA 与它签发的若干客户端证书，以及一个不受信任的自签名客户端证书
+ */
+struct Pki {
+    std::string dir;
+
+    Pki()
+    {
+        char tmpl[] = "/tmp/galay_ssl_t34_XXXXXX";
+        expect(::mkdtemp(tmpl) != nullptr, "mkdtemp failed");
+        dir = tmpl;
+
+        EVP_PKEY* ca_key = EVP_EC_gen("P-256");
+        EVP_PKEY* other_key = EVP_EC_gen("P-256");
+        expect(ca_key && other_key, "key generation failed");
+        X509* ca = makeCertificate(ca_key, "Client CA", 1, nullptr, nullptr);
+        X509* other = makeCertificate(other_key, "Other CA", 2, nullptr, nullptr);
+        write("ca.crt", ca, nullptr);
+        write("other.crt", other, nullptr);
+        EVP_PKEY* server_key = EVP_EC_gen("P-256");
+        expect(server_key != nullptr, "key generation failed");
+        write("server", makeCertificate(server_key, "localhost", 3, other, other_key), server_key);
+        EVP_PKEY_free(server_key);
+        for (int i = 0; i < 3; ++i) {
+            EVP_PKEY* key = EVP_EC_gen("P-256");
+            expect(key != nullptr, "key generation failed");
+            write("client" + std::to_string(i), makeCertificate(key, "client", 10 + i, ca, ca_key), key);
+            EVP_PKEY_free(key);
+        }
+        EVP_PKEY* stray_key = EVP_EC_gen("P-256");
+        expect(stray_key != nullptr, "key generation failed");
+        write("stray", makeCertificate(stray_key, "stray", 20, nullptr, nullptr), stray_key);
+        EVP_PKEY_free(stray_key);
+        X509_free(ca);
+        X509_free(other);
+        EVP_PKEY_free(ca_key);
+        EVP_PKEY_free(other_key);
+    }
+
+    ~Pki()
+    {
+        const std::string command = "rm -rf " + dir;
+        (void)std::system(command.c_str());
+    }
+
+    std::string path(const std::string& name) const { return dir + "/" + name; }
+
+    /**
+     * @brief 写出 name.crt / name.key（key 为空时 name 即文件名），并释放 cert
+     */
+    void write(const std::string& name, X509* cert, EVP_PKEY* key) const
+    {
+        FILE* cert_file = std::fopen(path(key ? name + ".crt" : name).c_str(), "w");
+        expect(cert_file != nullptr, "open certificate file failed");
+        bool ok = PEM_write_X509(cert_file, cert) == 1;
+        std::fclose(cert_file);
+        if (key) {
+            FILE* key_file = std::fopen(path(name + ".key").c_str(), "w");
+            expect(key_file != nullptr, "open key file failed");
+            ok = ok && PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+            std::fclose(key_file);
+            X509_free(cert);
+        }
+        expect(ok, "write PKI file failed");
+    }
+
+    SslContext server(const std::shared_ptr<SslTrustStore>& trust, const std::shared_ptr<SslVerifyCache>& cache) const
+    {
+        SslContext ctx(SslMethod::TLS_Server);
+        expect(ctx.loadCertificateKeyPair(path("server.crt"), path("server.key")).has_value(), "load server failed");
+        ctx.setVerifyMode(static_cast<SslVerifyMode>(SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT));
+        if (trust) {
+            ctx.setTrustStore(trust);
+        }
+        ctx.setVerifyCache(cache);
+        return ctx;
+    }
+
+    SslContext client(const std::string& name) const
+    {
+        SslContext ctx(SslMethod::TLS_Client);
+        expect(ctx.loadCertificateKeyPair(path(name + ".crt"), path(name + ".key")).has_value(),
+               "load client failed");
+        return ctx;
+    }
+};
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    while (from.pendingEncryptedOutput() > 0) {
+        std::vector<char> buffer(from.pendingEncryptedOutput());
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        expect(produced > 0, "extractEncryptedOutput failed");
+        expect(to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) == produced,
+               "feedEncryptedInput failed");
+    }
+}
+
+/**
+ * @brief 握手，返回服务端是否接受客户端证书；接受时检查服务端拿到了到 CA 的可信链
+ */
+bool handshake(SslContext& server_ctx, SslContext& client_ctx)
+{
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+
+    bool failed = false;
+    for (int i = 0; i < 16 && !failed && !(client.isHandshakeCompleted() && server.isHandshakeCompleted()); ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            failed = ret != SslIOResult::Success && ret != SslIOResult::WantRead;
+        }
+        transferPending(client, server);
+        if (!failed && !server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            failed = ret != SslIOResult::Success && ret != SslIOResult::WantRead;
+        }
+        transferPending(server, client);
+    }
+    if (failed || !server.isHandshakeCompleted()) {
+        return false;
+    }
+    STACK_OF(X509)* verified = SSL_get0_verified_chain(server.native());
+    expect(SSL_get_verify_result(server.native()) == X509_V_OK, "verify result not OK");
+    expect(verified != nullptr && sk_X509_num(verified) == 2, "verified chain missing");
+    return true;
+}
+
+void checkHitsAndFailures(const Pki& pki)
+{
+    auto trust = SslTrustStore::fromFile(pki.path("ca.crt"));
+    expect(trust.has_value(), "load trust store failed");
+    auto cache = std::make_shared<SslVerifyCache>();
+    // 两个 worker 上下文共享信任库与缓存
+    auto first = pki.server(*trust, cache);
+    auto second = pki.server(*trust, cache);
+    auto client = pki.client("client0");
+
+    expect(handshake(first, client), "first handshake failed");
+    auto stats = cache->stats();
+    expect(stats.misses == 1 && stats.inserts == 1 && stats.hits == 0, "first handshake not a miss");
+    expect(handshake(second, client), "cached handshake failed");
+    expect(handshake(first, client), "cached handshake failed");
+    expect(cache->stats().hits == 2 && cache->size() == 1, "shared cache not hit");
+
+    auto stray = pki.client("stray");
+    expect(!handshake(first, stray) && !handshake(first, stray), "untrusted client accepted");
+    stats = cache->stats();
+    expect(stats.misses == 3 && stats.hits == 2 && stats.inserts == 1, "failed verification cached");
+
+    cache->invalidate();
+    expect(cache->size() == 0 && handshake(first, client), "handshake after invalidate failed");
+    stats = cache->stats();
+    expect(stats.invalidations == 1 && stats.misses == 4, "invalidate did not force verification");
+
+    // 换成另一个信任库（即使内容相同）后旧条目不再命中；不信任该 CA 的信任库拒绝客户端
+    auto reloaded = SslTrustStore::fromFile(pki.path("ca.crt"));
+    auto other = SslTrustStore::fromFile(pki.path("other.crt"));
+    expect(reloaded && other && (*reloaded)->generation() != (*trust)->generation(), "generation not unique");
+    first.setTrustStore(*reloaded);
+    expect(handshake(first, client) && cache->stats().misses == 5, "reloaded store hit old entry");
+    first.setTrustStore(*other);
+    expect(!handshake(first, client), "client accepted by store without its CA");
+    expect(handshake(second, client) && cache->stats().hits == 3, "unchanged context lost its entry");
+}
+
+void checkPrivateStore(const Pki& pki)
+{
+    auto cache = std::make_shared<SslVerifyCache>();
+    auto server = pki.server(nullptr, cache);
+    auto client = pki.client("client1");
+
+    // 空的私有信任库先被标记，之后加载 CA 换代
+    expect(!handshake(server, client), "client accepted by empty store");
+    expect(server.loadCACertificate(pki.path("ca.crt")).has_value(), "load CA failed");
+    expect(handshake(server, client) && handshake(server, client), "private store handshake failed");
+    expect(cache->stats().hits == 1 && cache->stats().misses == 2, "private store not cached");
+    expect(server.loadCACertificate(pki.path("other.crt")).has_value(), "load other CA failed");
+    expect(handshake(server, client) && cache->stats().misses == 3, "CA load did not change generation");
+
+    // 客户端验证服务端证书不经过缓存
+    auto verifying_client = pki.client("client1");
+    verifying_client.setVerifyMode(SslVerifyMode::Peer);
+    expect(verifying_client.loadCACertificate(pki.path("other.crt")).has_value(), "load client CA failed");
+    verifying_client.setVerifyCache(cache);
+    const auto before = cache->stats();
+    expect(handshake(server, verifying_client), "verifying client handshake failed");
+    const auto after = cache->stats();
+    // 只有服务端验证客户端证书命中一次，客户端一侧没有查找或写入
+    expect(after.hits == before.hits + 1 && after.misses == before.misses && after.inserts == before.inserts,
+           "client side used cache");
+
+    server.setVerifyCache(nullptr);
+    expect(handshake(server, client) && cache->stats().misses == after.misses, "detached cache still used");
+}
+
+void checkExpiryAndCapacity(const Pki& pki)
+{
+    auto trust = SslTrustStore::fromFile(pki.path("ca.crt"));
+    expect(trust.has_value(), "load trust store failed");
+
+    auto short_lived = std::make_shared<SslVerifyCache>(SslVerifyCacheOptions{.ttl = 50ms});
+    auto server = pki.server(*trust, short_lived);
+    auto client = pki.client("client0");
+    expect(handshake(server, client) && handshake(server, client), "handshake failed");
+    expect(short_lived->stats().hits == 1, "entry not hit before ttl");
+    std::this_thread::sleep_for(100ms);
+    expect(handshake(server, client), "handshake after ttl failed");
+    expect(short_lived->stats().expired == 1 && short_lived->stats().misses == 2, "entry did not expire");
+
+    auto small = std::make_shared<SslVerifyCache>(SslVerifyCacheOptions{.capacity = 2, .shards = 1});
+    auto bounded = pki.server(*trust, small);
+    for (int i = 0; i < 3; ++i) {
+        auto each = pki.client("client" + std::to_string(i));
+        expect(handshake(bounded, each), "bounded handshake failed");
+    }
+    auto stats = small->stats();
+    expect(stats.size == 2 && stats.evictions == 1, "capacity not enforced");
+    auto oldest = pki.client("client0");
+    expect(handshake(bounded, oldest) && small->stats().misses == 4, "evicted entry still hit");
+}
+
+void checkCallbackAndParams(const Pki& pki)
+{
+    auto trust = SslTrustStore::fromFile(pki.path("ca.crt"));
+    expect(trust.has_value(), "load trust store failed");
+    auto cache = std::make_shared<SslVerifyCache>();
+    auto server = pki.server(*trust, cache);
+    int calls = 0;
+    bool accept = true;
+    server.setVerifyMode(static_cast<SslVerifyMode>(SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT),
+                         [&](bool ok, X509_STORE_CTX*) {
+                             ++calls;
+                             return ok && accept;
+                         });
+    auto client = pki.client("client0");
+
+    // 命中时回调与完整验证一样对链中每张证书以 ok=1 调用一次，拒绝时握手失败
+    expect(handshake(server, client), "first handshake failed");
+    const int per_chain = calls;
+    expect(per_chain >= 2, "callback not called on miss");
+    expect(handshake(server, client) && cache->stats().hits == 1, "second handshake not a hit");
+    expect(calls == 2 * per_chain, "callback not replayed on hit");
+    accept = false;
+    expect(!handshake(server, client) && cache->stats().hits == 2, "callback rejection ignored on hit");
+    accept = true;
+
+    // 验证标志与深度是键的一部分
+    X509_VERIFY_PARAM* param = SSL_CTX_get0_param(server.native());
+    X509_VERIFY_PARAM_set_flags(param, X509_V_FLAG_CHECK_SS_SIGNATURE);
+    auto before = cache->stats();
+    expect(handshake(server, client) && cache->stats().misses == before.misses + 1, "flag change hit old entry");
+    X509_VERIFY_PARAM_set_depth(param, 5);
+    before = cache->stats();
+    expect(handshake(server, client) && cache->stats().misses == before.misses + 1, "depth change hit old entry");
+
+    // 开启 CRL 检查后不再查缓存：没有 CRL 时验证失败，而不是命中旧条目
+    X509_VERIFY_PARAM_set_flags(param, X509_V_FLAG_CRL_CHECK);
+    before = cache->stats();
+    expect(!handshake(server, client), "CRL check passed without a CRL");
+    expect(cache->stats().hits == before.hits && cache->stats().misses == before.misses, "CRL check used the cache");
+}
+
+/**
+ * @brief 以 c_rehash 的命名（subject hash + ".0"）把 CA 证书写进目录
+ */
+void addHashedCertificate(const Pki& pki, const std::string& dir, const std::string& file)
+{
+    FILE* in = std::fopen(pki.path(file).c_str(), "r");
+    expect(in != nullptr, "open CA failed");
+    X509* cert = PEM_read_X509(in, nullptr, nullptr, nullptr);
+    std::fclose(in);
+    expect(cert != nullptr, "read CA failed");
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%08lx.0", X509_subject_name_hash(cert));
+    FILE* out = std::fopen((dir + name).c_str(), "w");
+    const bool ok = out != nullptr && PEM_write_X509(out, cert) == 1;
+    if (out != nullptr) {
+        std::fclose(out);
+    }
+    X509_free(cert);
+    expect(ok, "write hashed CA failed");
+}
+
+void checkLookupPath(const Pki& pki)
+{
+    const std::string dir = pki.path("capath");
+    expect(::mkdir(dir.c_str(), 0700) == 0, "mkdir failed");
+    addHashedCertificate(pki, dir, "ca.crt");
+
+    SslTrustStoreOptions options;
+    options.caPaths.push_back(dir);
+    auto trust = SslTrustStore::create(options);
+    expect(trust.has_value(), "create directory trust store failed");
+    auto cache = std::make_shared<SslVerifyCache>();
+    auto server = pki.server(*trust, cache);
+    auto client = pki.client("client2");
+    expect(handshake(server, client) && handshake(server, client), "directory store handshake failed");
+    expect(cache->stats().hits == 1 && cache->stats().misses == 1, "directory store not cached");
+
+    // 目录中增加证书改变其修改时间，旧条目不再命中
+    std::this_thread::sleep_for(10ms);
+    addHashedCertificate(pki, dir, "other.crt");
+    expect(handshake(server, client) && cache->stats().misses == 2, "directory change hit old entry");
+    expect(handshake(server, client) && cache->stats().hits == 2, "entry after directory change not cached");
+}
+
+} // namespace
+
+int main()
+{
+    Pki pki;
+    checkHitsAndFailures(pki);
+    checkPrivateStore(pki);
+    checkExpiryAndCapacity(pki);
+    checkCallbackAndParams(pki);
+    checkLookupPath(pki);
+    return 0;
+}
@@ -0,0 +1,466 @@
+/**
+ * @file t35_crl_index.cc
+ * @brief 用途：锁定 SslCrlIndex 的吊销检查与原子重载语义。
+ * 关键覆盖点：叶子与中间证书被吊销时握手以 X509_V_ERR_CERT_REVOKED 失败；PEM / DER、同一签发者多份 CRL 取最新；
+ * 过期 CRL 默认拒绝、allowExpired 放行；reloadIfChanged() 与后台线程发布新索引，签名错误或损坏的 CRL
+ * 保留旧索引；验证缓存命中后仍检查吊销；客户端验证服务端证书同样生效；create() 的参数与签发者校验。
+ * 通过条件：握手结果、验证错误码与索引统计符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_crl_index.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_trust_store.h"
+#include "galay-ssl/ssl/ssl_verify_cache.h"
+
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace galay::ssl;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr long kIntermediateSerial = 2;
+constexpr long kServerSerial = 3;
+constexpr long kClientSerial = 10;      ///< client0..client2 依次为 10..12
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+X509* makeCertificate(EVP_PKEY* key, const std::string& commonName, long serial, X509* issuer, EVP_PKEY* issuerKey,
+                      bool ca)
+{
+    X509* cert = X509_new();
+    expect(cert != nullptr, "X509_new failed");
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), serial);
+    X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               reinterpret_cast<const unsigned char*>(commonName.c_str()), -1, -1, 0);
+    X509_set_issuer_name(cert, issuer ? X509_get_subject_name(issuer) : name);
+    if (ca) {
+        X509V3_CTX v3;
+        X509V3_set_ctx_nodb(&v3);
+        X509V3_set_ctx(&v3, issuer ? issuer : cert, cert, nullptr, nullptr, 0);
+        X509_EXTENSION* ext = X509V3_EXT_conf_nid(nullptr, &v3, NID_basic_constraints, "critical,CA:TRUE");
+        X509_add_ext(cert, ext, -1);
+        X509_EXTENSION_free(ext);
+    }
+    expect(X509_sign(cert, issuer ? issuerKey : key, EVP_sha256()) > 0, "certificate signing failed");
+    return cert;
+}
+
+/**
+ * @brief 由 issuer 签发、吊销 serials 的 CRL；时间为相对当前的秒数
+ */
+X509_CRL* makeCrl(X509* issuer, EVP_PKEY* key, const std::vector<long>& serials, long lastUpdate = -60,
+                  long nextUpdate = 3600)
+{
+    X509_CRL* crl = X509_CRL_new();
+    expect(crl != nullptr, "X509_CRL_new failed");
+    X509_CRL_set_version(crl, 1);
+    X509_CRL_set_issuer_name(crl, X509_get_subject_name(issuer));
+    ASN1_TIME* last = X509_gmtime_adj(nullptr, lastUpdate);
+    ASN1_TIME* next = X509_gmtime_adj(nullptr, nextUpdate);
+    X509_CRL_set1_lastUpdate(crl, last);
+    X509_CRL_set1_nextUpdate(crl, next);
+    for (long serial : serials) {
+        X509_REVOKED* revoked = X509_REVOKED_new();
+        ASN1_INTEGER* number = ASN1_INTEGER_new();
+        ASN1_INTEGER_set(number, serial);
+        X509_REVOKED_set_serialNumber(revoked, number);
+        X509_REVOKED_set_revocationDate(revoked, last);
+        ASN1_INTEGER_free(number);
+        X509_CRL_add0_revoked(crl, revoked);
+    }
+    ASN1_TIME_free(last);
+    ASN1_TIME_free(next);
+    X509_CRL_sort(crl);
+    expect(X509_CRL_sign(crl, key, EVP_sha256()) > 0, "CRL signing failed");
+    return crl;
+}
+
+/**
+ * @brief 测试用 PKI：根 CA → 中间 CA → 服务端与客户端证书，另有一个与中间 CA 同名的伪造签发者
+ */
+struct Pki {
+    std::string dir;
+    EVP_PKEY* rootKey = nullptr;
+    EVP_PKEY* issuingKey = nullptr;
+    EVP_PKEY* rogueKey = nullptr;
+    X509* root = nullptr;
+    X509* issuing = nullptr;
+    X509* rogue = nullptr;
+
+    Pki()
+    {
+        char tmpl[] = "/tmp/galay_ssl_t35_XXXXXX";
+        expect(::mkdtemp(tmpl) != nullptr, "mkdtemp failed");
+        dir = tmpl;
+
+        rootKey = EVP_EC_gen("P-256");
+        issuingKey = EVP_EC_gen("P-256");
+        rogueKey = EVP_EC_gen("P-256");
+        expect(rootKey && issuingKey && rogueKey, "key generation failed");
+        root = makeCertificate(rootKey, "Root CA", 1, nullptr, nullptr, true);
+        issuing = makeCertificate(issuingKey, "Issuing CA", kIntermediateSerial, root, rootKey, true);
+        rogue = makeCertificate(rogueKey, "Issuing CA", 99, nullptr, nullptr, true);
+        writeCerts("root.crt", {root});
+        writeCerts("issuing.crt", {issuing});
+
+        issue("server", "localhost", kServerSerial);
+        for (int i = 0; i < 3; ++i) {
+            issue("client" + std::to_string(i), "client", kClientSerial + i);
+        }
+    }
+
+    ~Pki()
+    {
+        X509_free(root);
+        X509_free(issuing);
+        X509_free(rogue);
+        EVP_PKEY_free(rootKey);
+        EVP_PKEY_free(issuingKey);
+        EVP_PKEY_free(rogueKey);
+        const std::string command = "rm -rf " + dir;
+        (void)std::system(command.c_str());
+    }
+
+    std::string path(const std::string& name) const { return dir + "/" + name; }
+
+    void writeCerts(const std::string& name, const std::vector<X509*>& certs) const
+    {
+        FILE* file = std::fopen(path(name).c_str(), "w");
+        expect(file != nullptr, "open certificate file failed");
+        bool ok = true;
+        for (X509* cert : certs) {
+            ok = ok && PEM_write_X509(file, cert) == 1;
+        }
+        std::fclose(file);
+        expect(ok, "write certificate failed");
+    }
+
+    /**
+     * @brief 由中间 CA 签发 name.crt（含中间证书）/ name.key
+     */
+    void issue(const std::string& name, const std::string& commonName, long serial) const
+    {
+        EVP_PKEY* key = EVP_EC_gen("P-256");
+        expect(key != nullptr, "key generation failed");
+        X509* cert = makeCertificate(key, commonName, serial, issuing, issuingKey, false);
+        writeCerts(name + ".crt", {cert, issuing});
+        FILE* key_file = std::fopen(path(name + ".key").c_str(), "w");
+        expect(key_file != nullptr, "open key file failed");
+        const bool ok = PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        std::fclose(key_file);
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        expect(ok, "write key failed");
+    }
+
+    /**
+     * @brief 写临时文件后 rename 原子替换 name，并释放 crls
+     */
+    void writeCrls(const std::string& name, const std::vector<X509_CRL*>& crls, bool der = false) const
+    {
+        const std::string tmp = path(name + ".tmp");
+        FILE* file = std::fopen(tmp.c_str(), "w");
+        expect(file != nullptr, "open CRL file failed");
+        bool ok = true;
+        for (X509_CRL* crl : crls) {
+            ok = ok && (der ? i2d_X509_CRL_fp(file, crl) == 1 : PEM_write_X509_CRL(file, crl) == 1);
+            X509_CRL_free(crl);
+        }
+        std::fclose(file);
+        expect(ok && std::rename(tmp.c_str(), path(name).c_str()) == 0, "write CRL failed");
+    }
+
+    void writeRaw(const std::string& name, const std::string& content) const
+    {
+        FILE* file = std::fopen(path(name).c_str(), "w");
+        expect(file != nullptr, "open file failed");
+        std::fputs(content.c_str(), file);
+        std::fclose(file);
+    }
+
+    std::shared_ptr<SslTrustStore> issuers() const
+    {
+        auto store = SslTrustStore::create({.caFiles = {path("root.crt"), path("issuing.crt")}});
+        expect(store.has_value(), "load issuers failed");
+        return *store;
+    }
+
+    std::shared_ptr<SslCrlIndex> index(std::vector<std::string> files, bool allowExpired = false) const
+    {
+        for (auto& file : files) {
+            file = path(file);
+        }
+        auto created = SslCrlIndex::create({.crlFiles = std::move(files), .issuers = issuers(),
+                                            .allowExpired = allowExpired});
+        expect(created.has_value(), "create CRL index failed");
+        return *created;
+    }
+
+    SslContext server(const std::shared_ptr<SslCrlIndex>& crl, const std::shared_ptr<SslVerifyCache>& cache = nullptr)
+        const
+    {
+        SslContext ctx(SslMethod::TLS_Server);
+        expect(ctx.loadCertificateKeyPair(path("server.crt"), path("server.key")).has_value(), "load server failed");
+        ctx.setVerifyMode(static_cast<SslVerifyMode>(SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT));
+        expect(ctx.loadCACertificate(path("root.crt")).has_value(), "load CA failed");
+        ctx.setVerifyCache(cache);
+        ctx.setCrlIndex(crl);
+        return ctx;
+    }
+
+    SslContext client(const std::string& name) const
+    {
+        SslContext ctx(SslMethod::TLS_Client);
+        expect(ctx.loadCertificateKeyPair(path(name + ".crt"), path(name + ".key")).has_value(),
+               "load client failed");
+        return ctx;
+    }
+
+    std::vector<long> clients(std::initializer_list<int> indexes) const
+    {
+        std::vector<long> serials;
+        for (int i : indexes) {
+            serials.push_back(kClientSerial + i);
+        }
+        return serials;
+    }
+};
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    while (from.pendingEncryptedOutput() > 0) {
+        std::vector<char> buffer(from.pendingEncryptedOutput());
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        expect(produced > 0, "extractEncryptedOutput failed");
+        expect(to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) == produced,
+               "feedEncryptedInput failed");
+    }
+}
+
+/**
+ * @brief 握手，成功返回 X509_V_OK，失败返回验证方（clientVerifies 为 true 时是客户端）记录的验证错误
+ */
+long handshake(SslContext& server_ctx, SslContext& client_ctx, bool clientVerifies = false)
+{
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+
+    bool failed = false;
+    for (int i = 0; i < 16 && !failed && !(client.isHandshakeCompleted() && server.isHandshakeCompleted()); ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            failed = ret != SslIOResult::Success && ret != SslIOResult::WantRead;
+        }
+        transferPending(client, server);
+        if (!failed && !server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            failed = ret != SslIOResult::Success && ret != SslIOResult::WantRead;
+        }
+        transferPending(server, client);
+    }
+    const long result = SSL_get_verify_result(clientVerifies ? client.native() : server.native());
+    if (!failed && server.isHandshakeCompleted() && client.isHandshakeCompleted()) {
+        expect(result == X509_V_OK, "handshake succeeded with verify error");
+        return X509_V_OK;
+    }
+    expect(result != X509_V_OK, "handshake failed without verify error");
+    return result;
+}
+
+X509* loadLeaf(const Pki& pki, const std::string& name)
+{
+    FILE* file = std::fopen(pki.path(name + ".crt").c_str(), "r");
+    expect(file != nullptr, "open certificate failed");
+    X509* cert = PEM_read_X509(file, nullptr, nullptr, nullptr);
+    std::fclose(file);
+    expect(cert != nullptr, "read certificate failed");
+    return cert;
+}
+
+void checkRevocation(const Pki& pki)
+{
+    // 大量无关条目之外吊销 client1；根 CRL 以 DER 保存
+    std::vector<long> serials = pki.clients({1});
+    for (long i = 0; i < 20000; ++i) {
+        serials.push_back(1000000 + i);
+    }
+    pki.writeCrls("issuing.crl", {makeCrl(pki.issuing, pki.issuingKey, serials)});
+    pki.writeCrls("root.crl", {makeCrl(pki.root, pki.rootKey, {})}, true);
+    auto crl = pki.index({"issuing.crl", "root.crl"});
+    auto stats = crl->stats();
+    expect(stats.generation == 1 && stats.crls == 2 && stats.entries == 20001, "index not built");
+
+    auto server = pki.server(crl);
+    auto good = pki.client("client0");
+    auto revoked = pki.client("client1");
+    expect(handshake(server, good) == X509_V_OK, "valid client rejected");
+    expect(handshake(server, revoked) == X509_V_ERR_CERT_REVOKED, "revoked client accepted");
+    stats = crl->stats();
+    expect(stats.checks == 2 && stats.revoked == 1, "check stats wrong");
+
+    X509* leaf0 = loadLeaf(pki, "client0");
+    X509* leaf1 = loadLeaf(pki, "client1");
+    expect(!crl->isRevoked(leaf0, pki.issuing) && crl->isRevoked(leaf1, pki.issuing), "isRevoked wrong");
+    expect(!crl->isRevoked(leaf1, pki.root), "serial matched under wrong issuer");
+    X509_free(leaf0);
+    X509_free(leaf1);
+
+    // 根 CRL 吊销中间 CA 后，它签发的所有证书都被拒绝
+    pki.writeCrls("root.crl", {makeCrl(pki.root, pki.rootKey, {kIntermediateSerial}, -30)}, true);
+    expect(crl->reload().has_value(), "reload failed");
+    expect(handshake(server, good) == X509_V_ERR_CERT_REVOKED, "client of revoked intermediate accepted");
+
+    server.setCrlIndex(nullptr);
+    expect(handshake(server, revoked) == X509_V_OK, "detached index still used");
+}
+
+void checkReload(const Pki& pki)
+{
+    pki.writeCrls("issuing.crl", {makeCrl(pki.issuing, pki.issuingKey, pki.clients({1}))});
+    auto crl = pki.index({"issuing.crl"});
+    auto server = pki.server(crl);
+    auto client2 = pki.client("client2");
+    expect(handshake(server, client2) == X509_V_OK, "client2 rejected");
+
+    auto unchanged = crl->reloadIfChanged();
+    expect(unchanged.has_value() && !*unchanged, "unchanged file reloaded");
+    pki.writeCrls("issuing.crl", {makeCrl(pki.issuing, pki.issuingKey, pki.clients({1, 2}), -30)});
+    auto changed = crl->reloadIfChanged();
+    expect(changed.has_value() && *changed, "changed file not reloaded");
+    expect(crl->stats().generation == 2 && crl->stats().reloads == 1, "generation not advanced");
+    expect(handshake(server, client2) == X509_V_ERR_CERT_REVOKED, "newly revoked client accepted");
+
+    // 同名伪造签发者签名的 CRL 与损坏文件都不替换当前索引
+    pki.writeCrls("issuing.crl", {makeCrl(pki.rogue, pki.rogueKey, {})});
+    auto rogue = crl->reloadIfChanged();
+    expect(!rogue && rogue.error().code() == SslErrorCode::kCrlLoadFailed, "rogue CRL accepted");
+    pki.writeRaw("issuing.crl", "-----BEGIN X509 CRL-----\ngarbage\n-----END X509 CRL-----\n");
+    expect(!crl->reload(), "garbage CRL accepted");
+    auto stats = crl->stats();
+    expect(stats.failures == 2 && stats.generation == 2, "failed reload replaced index");
+    expect(handshake(server, client2) == X509_V_ERR_CERT_REVOKED, "old index lost after failed reload");
+    auto client0 = pki.client("client0");
+    expect(handshake(server, client0) == X509_V_OK, "valid client rejected after failed reload");
+
+    // 同一签发者的多份 CRL 只采用 thisUpdate 最新的一份
+    pki.writeCrls("multi.crl", {makeCrl(pki.issuing, pki.issuingKey, pki.clients({0}), -120),
+                                makeCrl(pki.issuing, pki.issuingKey, {}, -60)});
+    auto multi = pki.index({"multi.crl"});
+    expect(multi->stats().crls == 1 && multi->stats().entries == 0, "older CRL kept");
+    auto multi_server = pki.server(multi);
+    expect(handshake(multi_server, client0) == X509_V_OK, "stale CRL applied");
+}
+
+void checkBackgroundReload(const Pki& pki)
+{
+    pki.writeCrls("background.crl", {makeCrl(pki.issuing, pki.issuingKey, {})});
+    auto created = SslCrlIndex::create({.crlFiles = {pki.path("background.crl")}, .issuers = pki.issuers(),
+                                        .reloadInterval = 20ms});
+    expect(created.has_value(), "create background index failed");
+    auto crl = *created;
+    auto server = pki.server(crl);
+    auto client0 = pki.client("client0");
+    expect(handshake(server, client0) == X509_V_OK, "client0 rejected");
+
+    pki.writeCrls("background.crl", {makeCrl(pki.issuing, pki.issuingKey, pki.clients({0}), -30)});
+    for (int i = 0; i < 200 && crl->stats().generation < 2; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+    expect(crl->stats().generation == 2, "background thread did not reload");
+    expect(handshake(server, client0) == X509_V_ERR_CERT_REVOKED, "background reload not applied");
+}
+
+void checkExpiredCrl(const Pki& pki)
+{
+    pki.writeCrls("expired.crl", {makeCrl(pki.issuing, pki.issuingKey, {}, -7200, -3600)});
+    auto client0 = pki.client("client0");
+    auto strict = pki.server(pki.index({"expired.crl"}));
+    expect(handshake(strict, client0) == X509_V_ERR_CRL_HAS_EXPIRED, "expired CRL accepted");
+    auto lenient = pki.server(pki.index({"expired.crl"}, true));
+    expect(handshake(lenient, client0) == X509_V_OK, "allowExpired ignored");
+}
+
+void checkWithVerifyCache(const Pki& pki)
+{
+    pki.writeCrls("cached.crl", {makeCrl(pki.issuing, pki.issuingKey, {})});
+    auto crl = pki.index({"cached.crl"});
+    auto cache = std::make_shared<SslVerifyCache>();
+    auto server = pki.server(crl, cache);
+    auto client0 = pki.client("client0");
+    expect(handshake(server, client0) == X509_V_OK && handshake(server, client0) == X509_V_OK, "handshake failed");
+    expect(cache->stats().hits == 1, "verification not cached");
+
+    // 吊销后缓存仍命中，但 CRL 检查拒绝
+    pki.writeCrls("cached.crl", {makeCrl(pki.issuing, pki.issuingKey, pki.clients({0}), -30)});
+    expect(crl->reload().has_value(), "reload failed");
+    expect(handshake(server, client0) == X509_V_ERR_CERT_REVOKED, "cached revoked client accepted");
+    expect(cache->stats().hits == 2, "cache not consulted before CRL check");
+}
+
+void checkClientSide(const Pki& pki)
+{
+    pki.writeCrls("server.crl", {makeCrl(pki.issuing, pki.issuingKey, {kServerSerial})});
+    SslContext server(SslMethod::TLS_Server);
+    expect(server.loadCertificateKeyPair(pki.path("server.crt"), pki.path("server.key")).has_value(),
+           "load server failed");
+    SslContext client(SslMethod::TLS_Client);
+    client.setVerifyMode(SslVerifyMode::Peer);
+    expect(client.loadCACertificate(pki.path("root.crt")).has_value(), "load client CA failed");
+    expect(handshake(server, client, true) == X509_V_OK, "client rejected server without index");
+    client.setCrlIndex(pki.index({"server.crl"}));
+    expect(handshake(server, client, true) == X509_V_ERR_CERT_REVOKED, "client accepted revoked server");
+}
+
+void checkCreateErrors(const Pki& pki)
+{
+    auto issuers = pki.issuers();
+    expect(!SslCrlIndex::create({.issuers = issuers}), "empty file list accepted");
+    pki.writeCrls("plain.crl", {makeCrl(pki.issuing, pki.issuingKey, {})});
+    expect(!SslCrlIndex::create({.crlFiles = {pki.path("plain.crl")}}), "missing issuers accepted");
+    expect(!SslCrlIndex::create({.crlFiles = {pki.path("missing.crl")}, .issuers = issuers}), "missing file accepted");
+
+    // 只有根 CA 时无法校验中间 CA 签发的 CRL
+    auto root_only = SslTrustStore::fromFile(pki.path("root.crt"));
+    expect(root_only.has_value(), "load root failed");
+    auto unverifiable = SslCrlIndex::create({.crlFiles = {pki.path("plain.crl")}, .issuers = *root_only});
+    expect(!unverifiable && unverifiable.error().code() == SslErrorCode::kCrlLoadFailed, "unverifiable CRL accepted");
+}
+
+} // namespace
+
+int main()
+{
+    Pki pki;
+    checkRevocation(pki);
+    checkReload(pki);
+    checkBackgroundReload(pki);
+    checkExpiredCrl(pki);
+    checkWithVerifyCache(pki);
+    checkClientSide(pki);
+    checkCreateErrors(pki);
+    return 0;
+}
@@ -0,0 +1,300 @@
+/**
+ * @file t36_psk.cc
+ * @brief 用途：锁定 SslPskStore 与 SslContext::setPreSharedKeys() 的 TLS 1.3 外部 PSK 语义。
+ * 关键覆盖点：没有证书的服务端以 PSK 完成握手；psk_dhe_ke / psk_ke 模式；lookup 回调解析身份；
+ * 未知身份回退证书握手或失败；密钥不一致时 binder 校验失败；SHA-384 套件；关闭后不再接受 PSK；
+ * 关闭后恢复挂接前的 TLS 1.3 套件；套件、身份与密钥长度校验。
+ * 通过条件：握手结果、是否做了 ECDHE 与统计计数符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+#include "galay-ssl/ssl/ssl_psk_store.h"
+
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+std::vector<unsigned char> secret(unsigned char seed, size_t size = 32)
+{
+    std::vector<unsigned char> key(size);
+    for (size_t i = 0; i < size; ++i) {
+        key[i] = static_cast<unsigned char>(seed + i * 7);
+    }
+    return key;
+}
+
+std::shared_ptr<SslPskStore> store(SslPskStoreOptions options = {})
+{
+    auto created = SslPskStore::create(std::move(options));
+    expect(created.has_value(), "create PSK store failed");
+    return *created;
+}
+
+/**
+ * @brief 自签名服务端证书，用于验证 PSK 与证书握手的回退
+ */
+struct ServerCert {
+    std::string dir;
+
+    ServerCert()
+    {
+        char tmpl[] = "/tmp/galay_ssl_t36_XXXXXX";
+        expect(::mkdtemp(tmpl) != nullptr, "mkdtemp failed");
+        dir = tmpl;
+
+        EVP_PKEY* key = EVP_EC_gen("P-256");
+        X509* cert = X509_new();
+        expect(key && cert, "key generation failed");
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"),
+                                   -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        expect(X509_sign(cert, key, EVP_sha256()) > 0, "certificate signing failed");
+
+        FILE* cert_file = std::fopen(path("server.crt").c_str(), "w");
+        FILE* key_file = std::fopen(path("server.key").c_str(), "w");
+        expect(cert_file && key_file, "open PKI file failed");
+        const bool ok = PEM_write_X509(cert_file, cert) == 1 &&
+                        PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        std::fclose(cert_file);
+        std::fclose(key_file);
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        expect(ok, "write PKI file failed");
+    }
+
+    ~ServerCert()
+    {
+        const std::string command = "rm -rf " + dir;
+        (void)std::system(command.c_str());
+    }
+
+    std::string path(const std::string& name) const { return dir + "/" + name; }
+
+    void load(SslContext& ctx) const
+    {
+        expect(ctx.loadCertificateKeyPair(path("server.crt"), path("server.key")).has_value(), "load server failed");
+    }
+};
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    while (from.pendingEncryptedOutput() > 0) {
+        std::vector<char> buffer(from.pendingEncryptedOutput());
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        expect(produced > 0, "extractEncryptedOutput failed");
+        expect(to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) == produced,
+               "feedEncryptedInput failed");
+    }
+}
+
+/**
+ * @brief 握手结果：是否完成、服务端是否以 PSK 认证、是否做了 ECDHE
+ */
+struct Outcome {
+    bool ok = false;
+    bool psk = false;
+    bool ecdhe = false;
+};
+
+Outcome handshake(SslContext& server_ctx, SslContext& client_ctx)
+{
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+
+    bool failed = false;
+    for (int i = 0; i < 16 && !failed && !(client.isHandshakeCompleted() && server.isHandshakeCompleted()); ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            failed = ret != SslIOResult::Success && ret != SslIOResult::WantRead;
+        }
+        transferPending(client, server);
+        if (!failed && !server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            failed = ret != SslIOResult::Success && ret != SslIOResult::WantRead;
+        }
+        transferPending(server, client);
+    }
+
+    Outcome outcome;
+    outcome.ok = !failed && client.isHandshakeCompleted() && server.isHandshakeCompleted();
+    if (outcome.ok) {
+        outcome.psk = SSL_session_reused(server.native()) == 1;
+        expect(outcome.psk == (SSL_session_reused(client.native()) == 1), "PSK use differs between peers");
+        EVP_PKEY* peer = nullptr;
+        outcome.ecdhe = SSL_get_peer_tmp_key(client.native(), &peer) == 1;
+        EVP_PKEY_free(peer);
+    }
+    return outcome;
+}
+
+SslContext pskContext(SslMethod method, const std::shared_ptr<SslPskStore>& keys, SslPskMode mode)
+{
+    SslContext ctx(method);
+    expect(ctx.setPreSharedKeys(keys, mode).has_value(), "setPreSharedKeys failed");
+    return ctx;
+}
+
+void checkModes()
+{
+    auto keys = store({.clientIdentity = "billing"});
+    expect(keys->add("billing", secret(1)).has_value(), "add key failed");
+
+    // 服务端没有证书，只能以 PSK 完成握手
+    auto dhe_server = pskContext(SslMethod::TLS_Server, keys, SslPskMode::PskDheKe);
+    auto dhe_client = pskContext(SslMethod::TLS_Client, keys, SslPskMode::PskDheKe);
+    dhe_client.setVerifyMode(SslVerifyMode::Peer);  // PSK 认证不验证证书链
+    auto dhe = handshake(dhe_server, dhe_client);
+    expect(dhe.ok && dhe.psk && dhe.ecdhe, "psk_dhe_ke handshake failed");
+    expect(keys->stats().found == 2 && keys->stats().unknown == 0, "PSK lookups not counted");
+
+    auto ke_server = pskContext(SslMethod::TLS_Server, keys, SslPskMode::PskKe);
+    auto ke_client = pskContext(SslMethod::TLS_Client, keys, SslPskMode::PskKe);
+    auto ke = handshake(ke_server, ke_client);
+    expect(ke.ok && ke.psk, "psk_ke handshake failed");
+#ifdef SSL_OP_PREFER_NO_DHE_KEX
+    expect(!ke.ecdhe, "psk_ke still performed ECDHE");
+#endif
+    expect((SSL_CTX_get_options(ke_server.native()) & SSL_OP_ALLOW_NO_DHE_KEX) != 0, "psk_ke not enabled");
+
+    // 同一个上下文切回 psk_dhe_ke
+    expect(ke_server.setPreSharedKeys(keys, SslPskMode::PskDheKe).has_value(), "switch mode failed");
+    expect((SSL_CTX_get_options(ke_server.native()) & SSL_OP_ALLOW_NO_DHE_KEX) == 0, "psk_ke not cleared");
+    auto back = handshake(ke_server, dhe_client);
+    expect(back.ok && back.psk && back.ecdhe, "mode switch handshake failed");
+
+    // SHA-384 套件与 48 字节密钥
+    auto wide = store({.cipherSuite = "TLS_AES_256_GCM_SHA384", .clientIdentity = "wide"});
+    expect(wide->add("wide", secret(9, SslPskStore::kMaxKeySize)).has_value(), "add 48-byte key failed");
+    auto wide_server = pskContext(SslMethod::TLS_Server, wide, SslPskMode::PskDheKe);
+    auto wide_client = pskContext(SslMethod::TLS_Client, wide, SslPskMode::PskDheKe);
+    auto sha384 = handshake(wide_server, wide_client);
+    expect(sha384.ok && sha384.psk, "SHA-384 PSK handshake failed");
+}
+
+void checkLookupAndFallback(const ServerCert& cert)
+{
+    // 服务端只有 lookup 回调
+    int lookups = 0;
+    auto server_keys = store({.lookup = [&lookups](std::string_view identity)
+                                  -> std::optional<std::vector<unsigned char>> {
+        ++lookups;
+        if (identity == "orders") {
+            return secret(3);
+        }
+        return std::nullopt;
+    }});
+    auto server = pskContext(SslMethod::TLS_Server, server_keys, SslPskMode::PskDheKe);
+
+    auto orders = store({.clientIdentity = "orders"});
+    expect(orders->add("orders", secret(3)).has_value(), "add key failed");
+    auto orders_client = pskContext(SslMethod::TLS_Client, orders, SslPskMode::PskDheKe);
+    auto resolved = handshake(server, orders_client);
+    expect(resolved.ok && resolved.psk && lookups == 1 && server_keys->stats().resolved == 1, "lookup not used");
+
+    // 未知身份：没有证书时失败，加载证书后回退证书握手
+    auto stranger = store({.clientIdentity = "stranger"});
+    expect(stranger->add("stranger", secret(4)).has_value(), "add key failed");
+    auto stranger_client = pskContext(SslMethod::TLS_Client, stranger, SslPskMode::PskDheKe);
+    expect(!handshake(server, stranger_client).ok, "unknown identity accepted without certificate");
+    expect(server_keys->stats().unknown == 1, "unknown identity not counted");
+    cert.load(server);
+    auto fallback = handshake(server, stranger_client);
+    expect(fallback.ok && !fallback.psk, "certificate fallback failed");
+
+    // 身份相同、密钥不同：binder 校验失败，握手中止
+    auto forged = store({.clientIdentity = "orders"});
+    expect(forged->add("orders", secret(5)).has_value(), "add key failed");
+    auto forged_client = pskContext(SslMethod::TLS_Client, forged, SslPskMode::PskDheKe);
+    expect(!handshake(server, forged_client).ok, "mismatched key accepted");
+
+    // 没有 PSK 的客户端照常走证书握手；关闭 PSK 后带 PSK 的客户端也走证书握手
+    SslContext plain_client(SslMethod::TLS_Client);
+    auto plain = handshake(server, plain_client);
+    expect(plain.ok && !plain.psk, "plain client handshake failed");
+    expect(server.setPreSharedKeys(nullptr).has_value() && !server.preSharedKeys(), "detach failed");
+    auto detached = handshake(server, orders_client);
+    expect(detached.ok && !detached.psk, "detached PSK still accepted");
+}
+
+void checkCiphersuiteRestore()
+{
+    const std::string custom = "TLS_CHACHA20_POLY1305_SHA256:TLS_AES_256_GCM_SHA384";
+    auto tls13 = [](SslContext& ctx) {
+        std::string names;
+        STACK_OF(SSL_CIPHER)* ciphers = SSL_CTX_get_ciphers(ctx.native());
+        for (int i = 0; i < sk_SSL_CIPHER_num(ciphers); ++i) {
+            const SSL_CIPHER* cipher = sk_SSL_CIPHER_value(ciphers, i);
+            if ((SSL_CIPHER_get_protocol_id(cipher) >> 8) == 0x13) {
+                names += (names.empty() ? "" : ":") + std::string(SSL_CIPHER_get_name(cipher));
+            }
+        }
+        return names;
+    };
+
+    SslContext ctx(SslMethod::TLS_Server);
+    expect(ctx.setCiphersuites(custom).has_value(), "setCiphersuites failed");
+    auto keys = store();
+    expect(ctx.setPreSharedKeys(keys).has_value(), "attach failed");
+    expect(tls13(ctx) == "TLS_AES_128_GCM_SHA256", "PSK suite not applied");
+    // 切换模式不覆盖记录的原配置
+    expect(ctx.setPreSharedKeys(keys, SslPskMode::PskKe).has_value(), "switch mode failed");
+    expect(ctx.setPreSharedKeys(nullptr).has_value(), "detach failed");
+    expect(tls13(ctx) == custom, "ciphersuites not restored on detach");
+}
+
+void checkValidation()
+{
+    expect(!SslPskStore::create({.cipherSuite = "TLS_NO_SUCH_SUITE"}), "unknown suite accepted");
+    expect(!SslPskStore::create({.cipherSuite = "ECDHE-RSA-AES128-GCM-SHA256"}), "TLS 1.2 suite accepted");
+    auto bad = SslPskStore::create({.cipherSuite = "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384"});
+    expect(!bad && bad.error().code() == SslErrorCode::kPskConfigFailed, "suite list accepted");
+
+    auto keys = store();
+    expect(!keys->add("", secret(1)), "empty identity accepted");
+    expect(!keys->add("short", secret(1, SslPskStore::kMinKeySize - 1)), "short key accepted");
+    expect(!keys->add("long", secret(1, SslPskStore::kMaxKeySize + 1)), "long key accepted");
+    expect(keys->add("svc", secret(1)).has_value() && keys->add("svc", secret(2)).has_value(), "replace failed");
+    expect(keys->size() == 1 && keys->stats().keys == 1, "size wrong");
+    expect(keys->remove("svc") && !keys->remove("svc") && keys->size() == 0, "remove failed");
+    expect(keys->newSession("svc") == nullptr, "removed identity still resolved");
+}
+
+} // namespace
+
+int main()
+{
+    ServerCert cert;
+    checkModes();
+    checkLookupAndFallback(cert);
+    checkCiphersuiteRestore();
+    checkValidation();
+    return 0;
+}
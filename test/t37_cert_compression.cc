@@ -0,0 +1,286 @@
+/**
+ * @file t37_cert_compression.cc
+ * @brief 用途：锁定 SslContext::setCertificateCompression() 与握手字节统计的语义。
+ * 关键覆盖点：两端握手字节互相吻合；证书消息字节与 Finished 计数；关闭统计后不再累计；移动上下文后继续累计；
+ * 本机支持时证书以 CompressedCertificate 发送且字节更少，不支持时返回 kCompressionUnsupported；
+ * 空列表关闭压缩；先开启压缩再加载 RSA 与 ECDSA 双证书，两个槽位都以压缩形式发送，重新加载后保持压缩。
+ * 通过条件：握手成功，统计与返回值符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+
+#include <openssl/pem.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * @brief 自签名服务端证书：server.* 为 ECDSA，rsa.* 为 RSA
+ */
+struct ServerCert {
+    std::string dir;
+
+    ServerCert()
+    {
+        char tmpl[] = "/tmp/galay_ssl_t37_XXXXXX";
+        expect(::mkdtemp(tmpl) != nullptr, "mkdtemp failed");
+        dir = tmpl;
+        writePair("server", EVP_EC_gen("P-256"));
+        writePair("rsa", EVP_RSA_gen(2048));
+    }
+
+    void writePair(const std::string& stem, EVP_PKEY* key) const
+    {
+        X509* cert = X509_new();
+        expect(key && cert, "key generation failed");
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "O", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("galay-ssl test"),
+                                   -1, -1, 0);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"),
+                                   -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        expect(X509_sign(cert, key, EVP_sha256()) > 0, "certificate signing failed");
+
+        FILE* cert_file = std::fopen(path(stem + ".crt").c_str(), "w");
+        FILE* key_file = std::fopen(path(stem + ".key").c_str(), "w");
+        expect(cert_file && key_file, "open PKI file failed");
+        const bool ok = PEM_write_X509(cert_file, cert) == 1 &&
+                        PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        std::fclose(cert_file);
+        std::fclose(key_file);
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        expect(ok, "write PKI file failed");
+    }
+
+    ~ServerCert()
+    {
+        const std::string command = "rm -rf " + dir;
+        (void)std::system(command.c_str());
+    }
+
+    std::string path(const std::string& name) const { return dir + "/" + name; }
+
+    SslContext server() const
+    {
+        SslContext ctx(SslMethod::TLS_1_3_Server);
+        expect(ctx.loadCertificateKeyPair(path("server.crt"), path("server.key")).has_value(), "load server failed");
+        return ctx;
+    }
+
+    std::expected<void, SslError> loadRsa(SslContext& ctx) const
+    {
+        return ctx.loadCertificateKeyPair(path("rsa.crt"), path("rsa.key"));
+    }
+};
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    while (from.pendingEncryptedOutput() > 0) {
+        std::vector<char> buffer(from.pendingEncryptedOutput());
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        expect(produced > 0, "extractEncryptedOutput failed");
+        expect(to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) == produced,
+               "feedEncryptedInput failed");
+    }
+}
+
+void handshake(SslContext& server_ctx, SslContext& client_ctx)
+{
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+
+    for (int i = 0; i < 16 && !(client.isHandshakeCompleted() && server.isHandshakeCompleted()); ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "client handshake failed");
+        }
+        transferPending(client, server);
+        if (!server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            expect(ret == SslIOResult::Success || ret == SslIOResult::WantRead, "server handshake failed");
+        }
+        transferPending(server, client);
+    }
+    expect(client.isHandshakeCompleted() && server.isHandshakeCompleted(), "handshake did not complete");
+}
+
+SslHandshakeByteStats delta(const SslHandshakeByteStats& after, const SslHandshakeByteStats& before)
+{
+    SslHandshakeByteStats result;
+    result.handshakes = after.handshakes - before.handshakes;
+    result.bytesSent = after.bytesSent - before.bytesSent;
+    result.bytesReceived = after.bytesReceived - before.bytesReceived;
+    result.certificateBytesSent = after.certificateBytesSent - before.certificateBytesSent;
+    result.certificateBytesReceived = after.certificateBytesReceived - before.certificateBytesReceived;
+    result.compressedCertificatesSent = after.compressedCertificatesSent - before.compressedCertificatesSent;
+    result.compressedCertificatesReceived =
+        after.compressedCertificatesReceived - before.compressedCertificatesReceived;
+    return result;
+}
+
+/**
+ * @return 未压缩时服务端发送 Certificate 消息的字节数
+ */
+uint64_t checkByteStats(const ServerCert& cert)
+{
+    SslContext server = cert.server();
+    SslContext client(SslMethod::TLS_1_3_Client);
+    expect(server.setCertificateCompression({}).has_value() && client.setCertificateCompression({}).has_value(),
+           "disable compression failed");
+    expect(server.handshakeByteStats().bytesSent == 0, "stats counted before enabling");
+
+    server.setHandshakeByteStats(true);
+    client.setHandshakeByteStats(true);
+    handshake(server, client);
+
+    const auto s = server.handshakeByteStats();
+    const auto c = client.handshakeByteStats();
+    expect(s.handshakes == 1 && c.handshakes == 1, "Finished not counted once per side");
+    expect(s.bytesSent > 0 && s.bytesSent == c.bytesReceived, "server to client bytes differ");
+    expect(c.bytesSent > 0 && c.bytesSent == s.bytesReceived, "client to server bytes differ");
+    expect(s.certificateBytesSent > 0 && s.certificateBytesSent == c.certificateBytesReceived,
+           "certificate bytes differ");
+    expect(s.certificateBytesSent < s.bytesSent, "certificate bytes exceed flight");
+    expect(c.certificateBytesSent == 0 && s.certificateBytesReceived == 0, "client sent a certificate");
+    expect(s.compressedCertificatesSent == 0 && c.compressedCertificatesReceived == 0, "compression not disabled");
+
+    // 移动后计数器地址不变，已创建与新建的连接继续累计
+    SslContext moved = std::move(server);
+    handshake(moved, client);
+    const auto after_move = moved.handshakeByteStats();
+    // ECDSA 签名的 DER 长度每次相差 1-2 字节，只比较长度固定的证书消息
+    expect(after_move.handshakes == 2 && after_move.bytesSent > s.bytesSent &&
+           after_move.certificateBytesSent == 2 * s.certificateBytesSent, "moved context not counting");
+
+    // 关闭后保留已累计的数值
+    moved.setHandshakeByteStats(false);
+    handshake(moved, client);
+    const auto disabled = moved.handshakeByteStats();
+    expect(disabled.handshakes == 2 && disabled.bytesSent == after_move.bytesSent, "disabled stats still counting");
+    expect(client.handshakeByteStats().handshakes == 3, "client stats stopped");
+    return s.certificateBytesSent;
+}
+
+void checkCompression(const ServerCert& cert, uint64_t uncompressed)
+{
+    std::vector<SslCertCompression> supported;
+    for (auto algorithm : {SslCertCompression::Zstd, SslCertCompression::Brotli, SslCertCompression::Zlib}) {
+        if (SslContext::certificateCompressionSupported(algorithm)) {
+            supported.push_back(algorithm);
+        }
+    }
+
+    SslContext server = cert.server();
+    SslContext client(SslMethod::TLS_1_3_Client);
+    const std::vector<SslCertCompression> all = {
+        SslCertCompression::Zlib, SslCertCompression::Brotli, SslCertCompression::Zstd, SslCertCompression::Zlib};
+    auto configured = server.setCertificateCompression(all);
+    if (supported.empty()) {
+        expect(!configured && configured.error().code() == SslErrorCode::kCompressionUnsupported,
+               "unsupported compression accepted");
+        expect(server.setCertificateCompression({}).has_value(), "disabling compression failed");
+        return;
+    }
+    expect(configured.has_value(), "enable compression failed");
+    expect(client.setCertificateCompression(supported).has_value(), "client compression failed");
+
+    server.setHandshakeByteStats(true);
+    client.setHandshakeByteStats(true);
+    for (int i = 0; i < 2; ++i) {
+        handshake(server, client);
+    }
+    const auto s = server.handshakeByteStats();
+    const auto c = client.handshakeByteStats();
+    expect(s.compressedCertificatesSent == 2 && c.compressedCertificatesReceived == 2, "certificate not compressed");
+    expect(s.certificateBytesSent == c.certificateBytesReceived, "compressed bytes differ");
+    expect(s.certificateBytesSent / 2 < uncompressed, "compressed certificate not smaller");
+
+    // 客户端关闭压缩后服务端回退到未压缩的 Certificate
+    expect(client.setCertificateCompression({}).has_value(), "disabling client compression failed");
+    const auto before = server.handshakeByteStats();
+    handshake(server, client);
+    const auto plain = delta(server.handshakeByteStats(), before);
+    expect(plain.compressedCertificatesSent == 0 && plain.certificateBytesSent == uncompressed,
+           "uncompressed fallback failed");
+}
+
+/**
+ * @brief 先开启压缩再加载证书：RSA 与 ECDSA 槽位都按客户端的签名算法以压缩形式发送
+ */
+void checkDualReload(const ServerCert& cert)
+{
+    std::vector<SslCertCompression> supported;
+    for (auto algorithm : {SslCertCompression::Zstd, SslCertCompression::Brotli, SslCertCompression::Zlib}) {
+        if (SslContext::certificateCompressionSupported(algorithm)) {
+            supported.push_back(algorithm);
+        }
+    }
+    if (supported.empty()) {
+        return;
+    }
+
+    SslContext server(SslMethod::TLS_1_3_Server);
+    expect(server.setCertificateCompression(supported).has_value(), "enable compression failed");
+    expect(cert.loadRsa(server).has_value(), "load RSA pair failed");
+    expect(server.loadCertificateKeyPair(cert.path("server.crt"), cert.path("server.key")).has_value(),
+           "load ECDSA pair failed");
+    server.setHandshakeByteStats(true);
+
+    SslContext ecdsa_client(SslMethod::TLS_1_3_Client);
+    SslContext rsa_client(SslMethod::TLS_1_3_Client);
+    expect(ecdsa_client.setCertificateCompression(supported).has_value() &&
+           rsa_client.setCertificateCompression(supported).has_value(), "client compression failed");
+    expect(SSL_CTX_set1_sigalgs_list(ecdsa_client.native(), "ecdsa_secp256r1_sha256") == 1 &&
+           SSL_CTX_set1_sigalgs_list(rsa_client.native(), "rsa_pss_rsae_sha256:rsa_pkcs1_sha256") == 1,
+           "client sigalgs failed");
+
+    for (auto* client : {&ecdsa_client, &rsa_client}) {
+        const auto before = server.handshakeByteStats();
+        handshake(server, *client);
+        expect(delta(server.handshakeByteStats(), before).compressedCertificatesSent == 1,
+               "certificate loaded after enabling compression not compressed");
+    }
+
+    // 重新加载 RSA 槽位后继续以压缩形式发送
+    expect(cert.loadRsa(server).has_value(), "reload RSA pair failed");
+    const auto before = server.handshakeByteStats();
+    handshake(server, rsa_client);
+    expect(delta(server.handshakeByteStats(), before).compressedCertificatesSent == 1,
+           "reloaded certificate not compressed");
+}
+
+} // namespace
+
+int main()
+{
+    ServerCert cert;
+    const uint64_t uncompressed = checkByteStats(cert);
+    checkCompression(cert, uncompressed);
+    checkDualReload(cert);
+    return 0;
+}
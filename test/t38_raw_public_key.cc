@@ -0,0 +1,262 @@
+/**
+ * @file t38_raw_public_key.cc
+ * @brief 用途：锁定 SslContext::loadRawPublicKey() / setPinnedPublicKeys() 的 RFC 7250 原始公钥语义。
+ * 关键覆盖点：只有私钥的服务端以原始公钥完成握手；固定公钥不匹配或客户端未固定时握手失败；
+ * 证书与原始公钥并存时按客户端选择；服务端固定客户端公钥；从证书文件读取固定公钥；关闭固定；
+ * 文件校验；OpenSSL 早于 3.2 时返回 kRawPublicKeyFailed。
+ * 通过条件：握手结果、对端是否发送证书与返回值符合预期。
+ */
+
+#include "galay-ssl/ssl/ssl_context.h"
+#include "galay-ssl/ssl/ssl_engine.h"
+
+#include <openssl/pem.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace galay::ssl;
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * @brief 服务端与客户端各一把 P-256 密钥：私钥、公钥与服务端自签名证书
+ */
+struct Keys {
+    std::string dir;
+
+    Keys()
+    {
+        char tmpl[] = "/tmp/galay_ssl_t38_XXXXXX";
+        expect(::mkdtemp(tmpl) != nullptr, "mkdtemp failed");
+        dir = tmpl;
+
+        EVP_PKEY* server = EVP_EC_gen("P-256");
+        EVP_PKEY* client = EVP_EC_gen("P-256");
+        EVP_PKEY* other = EVP_EC_gen("P-256");
+        expect(server && client && other, "key generation failed");
+        writeKeys("server", server);
+        writeKeys("client", client);
+        writeKeys("other", other);
+
+        // 一个文件两把公钥
+        FILE* both = std::fopen(path("both.pub").c_str(), "w");
+        expect(both && PEM_write_PUBKEY(both, other) == 1 && PEM_write_PUBKEY(both, server) == 1,
+               "write key list failed");
+        std::fclose(both);
+
+        X509* cert = X509_new();
+        expect(cert != nullptr, "certificate allocation failed");
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+        X509_set_pubkey(cert, server);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"),
+                                   -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        expect(X509_sign(cert, server, EVP_sha256()) > 0, "certificate signing failed");
+        FILE* cert_file = std::fopen(path("server.crt").c_str(), "w");
+        expect(cert_file && PEM_write_X509(cert_file, cert) == 1, "write certificate failed");
+        std::fclose(cert_file);
+
+        X509_free(cert);
+        EVP_PKEY_free(server);
+        EVP_PKEY_free(client);
+        EVP_PKEY_free(other);
+    }
+
+    ~Keys()
+    {
+        const std::string command = "rm -rf " + dir;
+        (void)std::system(command.c_str());
+    }
+
+    std::string path(const std::string& name) const { return dir + "/" + name; }
+
+    void writeKeys(const std::string& name, EVP_PKEY* key) const
+    {
+        FILE* key_file = std::fopen(path(name + ".key").c_str(), "w");
+        FILE* pub_file = std::fopen(path(name + ".pub").c_str(), "w");
+        expect(key_file && pub_file, "open key file failed");
+        const bool ok = PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1 &&
+                        PEM_write_PUBKEY(pub_file, key) == 1;
+        std::fclose(key_file);
+        std::fclose(pub_file);
+        expect(ok, "write key failed");
+    }
+};
+
+void transferPending(SslEngine& from, SslEngine& to)
+{
+    while (from.pendingEncryptedOutput() > 0) {
+        std::vector<char> buffer(from.pendingEncryptedOutput());
+        const int produced = from.extractEncryptedOutput(buffer.data(), buffer.size());
+        expect(produced > 0, "extractEncryptedOutput failed");
+        expect(to.feedEncryptedInput(buffer.data(), static_cast<size_t>(produced)) == produced,
+               "feedEncryptedInput failed");
+    }
+}
+
+/**
+ * @brief 握手结果：是否完成、服务端是否发送了 X.509 证书
+ */
+struct Outcome {
+    bool ok = false;
+    bool certificate = false;
+};
+
+Outcome handshake(SslContext& server_ctx, SslContext& client_ctx)
+{
+    SslEngine client(&client_ctx);
+    SslEngine server(&server_ctx);
+    expect(client.initMemoryBIO().has_value() && server.initMemoryBIO().has_value(), "memory BIO failed");
+    client.setConnectState();
+    server.setAcceptState();
+
+    bool failed = false;
+    for (int i = 0; i < 16 && !failed && !(client.isHandshakeCompleted() && server.isHandshakeCompleted()); ++i) {
+        if (!client.isHandshakeCompleted()) {
+            const auto ret = client.doHandshake();
+            failed = ret != SslIOResult::Success && ret != SslIOResult::WantRead;
+        }
+        transferPending(client, server);
+        if (!failed && !server.isHandshakeCompleted()) {
+            const auto ret = server.doHandshake();
+            failed = ret != SslIOResult::Success && ret != SslIOResult::WantRead;
+        }
+        transferPending(server, client);
+    }
+
+    Outcome outcome;
+    outcome.ok = !failed && client.isHandshakeCompleted() && server.isHandshakeCompleted();
+    outcome.certificate = outcome.ok && SSL_get0_peer_certificate(client.native()) != nullptr;
+    return outcome;
+}
+
+SslContext pinnedClient(const std::vector<std::string>& keyFiles)
+{
+    SslContext ctx(SslMethod::TLS_1_3_Client);
+    expect(ctx.setPinnedPublicKeys(keyFiles).has_value(), "setPinnedPublicKeys failed");
+    return ctx;
+}
+
+void checkUnsupported(const Keys& keys)
+{
+    SslContext server(SslMethod::TLS_1_3_Server);
+    auto loaded = server.loadRawPublicKey(keys.path("server.key"));
+    expect(!loaded && loaded.error().code() == SslErrorCode::kRawPublicKeyFailed, "raw public key accepted");
+
+    SslContext client(SslMethod::TLS_1_3_Client);
+    auto pinned = client.setPinnedPublicKeys({keys.path("server.pub")});
+    expect(!pinned && pinned.error().code() == SslErrorCode::kRawPublicKeyFailed, "pinned keys accepted");
+    expect(client.pinnedPublicKeyCount() == 0, "pinned keys kept");
+    expect(client.setPinnedPublicKeys({}).has_value(), "clearing pins failed");
+}
+
+void checkServerKey(const Keys& keys)
+{
+    // 服务端只有私钥，没有证书
+    SslContext server(SslMethod::TLS_1_3_Server);
+    expect(server.loadRawPublicKey(keys.path("server.key")).has_value(), "loadRawPublicKey failed");
+
+    auto client = pinnedClient({keys.path("server.pub")});
+    expect(client.pinnedPublicKeyCount() == 1, "pinned key not counted");
+    auto rpk = handshake(server, client);
+    expect(rpk.ok && !rpk.certificate, "raw public key handshake failed");
+
+    auto wrong = pinnedClient({keys.path("other.pub")});
+    expect(!handshake(server, wrong).ok, "unpinned server key accepted");
+
+    SslContext plain(SslMethod::TLS_1_3_Client);
+    expect(!handshake(server, plain).ok, "server without certificate served a plain client");
+
+    // 固定列表可以来自多把公钥的文件或证书文件
+    auto listed = pinnedClient({keys.path("both.pub")});
+    expect(listed.pinnedPublicKeyCount() == 2 && handshake(server, listed).ok, "key list pin failed");
+    auto from_cert = pinnedClient({keys.path("server.crt")});
+    expect(from_cert.pinnedPublicKeyCount() == 1 && handshake(server, from_cert).ok, "certificate pin failed");
+}
+
+void checkMixed(const Keys& keys)
+{
+    // 证书与原始公钥并存：RPK 客户端拿到公钥，其余客户端拿到证书
+    SslContext server(SslMethod::TLS_1_3_Server);
+    expect(server.loadCertificate(keys.path("server.crt")).has_value(), "load certificate failed");
+    expect(server.loadRawPublicKey(keys.path("server.key")).has_value(), "loadRawPublicKey failed");
+
+    SslContext plain(SslMethod::TLS_1_3_Client);
+    auto x509 = handshake(server, plain);
+    expect(x509.ok && x509.certificate, "certificate fallback failed");
+
+    auto client = pinnedClient({keys.path("server.pub")});
+    auto rpk = handshake(server, client);
+    expect(rpk.ok && !rpk.certificate, "mixed server did not send raw public key");
+
+    // 关闭固定后回到证书握手
+    expect(client.setPinnedPublicKeys({}).has_value() && client.pinnedPublicKeyCount() == 0, "clearing pins failed");
+    auto cleared = handshake(server, client);
+    expect(cleared.ok && cleared.certificate, "cleared pins still request raw public key");
+}
+
+void checkClientKey(const Keys& keys)
+{
+    // 服务端固定客户端公钥，客户端以原始公钥认证
+    SslContext server(SslMethod::TLS_1_3_Server);
+    expect(server.loadRawPublicKey(keys.path("server.key")).has_value(), "loadRawPublicKey failed");
+    expect(server.setPinnedPublicKeys({keys.path("client.pub")}).has_value(), "server pins failed");
+
+    auto client = pinnedClient({keys.path("server.pub")});
+    expect(client.loadRawPublicKey(keys.path("client.key")).has_value(), "client raw public key failed");
+    expect(handshake(server, client).ok, "client raw public key rejected");
+
+    auto anonymous = pinnedClient({keys.path("server.pub")});
+    expect(!handshake(server, anonymous).ok, "client without key accepted");
+
+    auto impostor = pinnedClient({keys.path("server.pub")});
+    expect(impostor.loadRawPublicKey(keys.path("other.key")).has_value(), "impostor key failed");
+    expect(!handshake(server, impostor).ok, "unpinned client key accepted");
+}
+
+void checkValidation(const Keys& keys)
+{
+    SslContext client(SslMethod::TLS_1_3_Client);
+    expect(client.setPinnedPublicKeys({keys.path("server.pub")}).has_value(), "setPinnedPublicKeys failed");
+
+    auto missing = client.setPinnedPublicKeys({keys.path("missing.pub")});
+    expect(!missing && missing.error().code() == SslErrorCode::kRawPublicKeyFailed, "missing file accepted");
+    auto no_key = client.setPinnedPublicKeys({keys.path("server.key")});
+    expect(!no_key && no_key.error().code() == SslErrorCode::kRawPublicKeyFailed, "private key file accepted");
+    expect(client.pinnedPublicKeyCount() == 1, "failed update replaced pins");
+
+    SslContext server(SslMethod::TLS_1_3_Server);
+    auto bad_key = server.loadRawPublicKey(keys.path("missing.key"));
+    expect(!bad_key && bad_key.error().code() == SslErrorCode::kRawPublicKeyFailed, "missing key accepted");
+}
+
+} // namespace
+
+int main()
+{
+    Keys keys;
+    if (!SslContext::rawPublicKeySupported()) {
+        checkUnsupported(keys);
+        return 0;
+    }
+    checkServerKey(keys);
+    checkMixed(keys);
+    checkClientKey(keys);
+    checkValidation(keys);
+    return 0;
+}